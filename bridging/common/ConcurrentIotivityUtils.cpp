@@ -46,6 +46,7 @@ void ConcurrentIotivityUtils::startWorkerThreads()
 void ConcurrentIotivityUtils::stopWorkerThreads()
 {
     m_shutDownOCProcessThread = true;
+    OCWakeProcess();
     m_queue->shutdown();
     m_processWorkQueueThread.join();
     m_ocProcessThread.join();
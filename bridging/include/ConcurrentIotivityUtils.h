@@ -90,13 +90,20 @@ namespace OC
                 {
                     while (!m_shutDownOCProcessThread)
                     {
+                        uint32_t timeout;
                         {
                             std::lock_guard<std::mutex> lock(m_iotivityApiCallMutex);
                             OCProcess();
+                            timeout = OCGetProcessTimeout();
+                        }
+                        // Block until the stack has work, without holding the mutex so the
+                        // work queue can keep calling into Iotivity. OCProcess() consumes
+                        // wakeups, so look at the shutdown flag again first.
+                        if (!m_shutDownOCProcessThread &&
+                            OC_STACK_ERROR == OCWaitForProcess(timeout))
+                        {
+                            usleep(OCPROCESS_SLEEP_MICROSECONDS);
                         }
-                        // Hopefully it's enough for other threads to be scheduled
-                        // instead of the spin here. OCProcess is very lightweight though.
-                        usleep(OCPROCESS_SLEEP_MICROSECONDS);
                     }
                 }
 
@@ -25,14 +25,14 @@ package org.iotivity.base;
 public class ObservationInfo {
 
     private ObserveAction mObserveAction;
-    private byte mOcObservationId;
+    private int mOcObservationId;
 
-    private ObservationInfo(int observationAction, byte observationId) {
+    private ObservationInfo(int observationAction, int observationId) {
         this.mObserveAction = ObserveAction.get(observationAction);
         this.mOcObservationId = observationId;
     }
 
-    public ObservationInfo(ObserveAction observeAction, byte observationId) {
+    public ObservationInfo(ObserveAction observeAction, int observationId) {
         this.mObserveAction = observeAction;
         this.mOcObservationId = observationId;
     }
@@ -45,11 +45,11 @@ public class ObservationInfo {
         this.mObserveAction = observeAction;
     }
 
-    public byte getOcObservationId() {
+    public int getOcObservationId() {
         return mOcObservationId;
     }
 
-    public void setOcObservationId(byte ocObservationId) {
+    public void setOcObservationId(int ocObservationId) {
         this.mOcObservationId = ocObservationId;
     }
 }
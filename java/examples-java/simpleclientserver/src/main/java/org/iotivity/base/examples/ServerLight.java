@@ -199,7 +199,7 @@ public class ServerLight extends SimpleLight implements OcPlatform.EntityHandler
         }
     }
 
-    private List<Byte> mObservationIds = new LinkedList<>();
+    private List<Integer> mObservationIds = new LinkedList<>();
 
     private EntityHandlerResult handleObserver(final OcResourceRequest request) {
         ObservationInfo observationInfo = request.getObservationInfo();
@@ -208,7 +208,7 @@ public class ServerLight extends SimpleLight implements OcPlatform.EntityHandler
             mObservationIds.add(observationInfo.getOcObservationId());
             break;
         case UNREGISTER:
-            mObservationIds.remove((Byte) observationInfo.getOcObservationId());
+            mObservationIds.remove((Integer) observationInfo.getOcObservationId());
             break;
         }
         // Observation happens on a different thread in notifyObservers method.
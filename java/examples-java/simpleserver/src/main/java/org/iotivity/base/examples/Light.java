@@ -224,7 +224,7 @@ public class Light implements OcPlatform.EntityHandler {
         sendResponse(response);
     }
 
-    private List<Byte> mObservationIds; //IDs of observes
+    private List<Integer> mObservationIds; //IDs of observes
 
     private EntityHandlerResult handleObserver(final OcResourceRequest request) {
         ObservationInfo observationInfo = request.getObservationInfo();
@@ -236,7 +236,7 @@ public class Light implements OcPlatform.EntityHandler {
                 mObservationIds.add(observationInfo.getOcObservationId());
                 break;
             case UNREGISTER:
-                mObservationIds.remove((Byte)observationInfo.getOcObservationId());
+                mObservationIds.remove((Integer)observationInfo.getOcObservationId());
                 break;
         }
         // Observation happens on a different thread in notifyObservers method.
@@ -1542,7 +1542,7 @@ public class SmokeTest extends InstrumentationTestCase {
             }
         };
 
-        final List<Byte> observationIdList = new LinkedList<Byte>();
+        final List<Integer> observationIdList = new LinkedList<Integer>();
         OcPlatform.EntityHandler entityHandler = new OcPlatform.EntityHandler() {
             @Override
             public EntityHandlerResult handleEntity(OcResourceRequest ocResourceRequest) {
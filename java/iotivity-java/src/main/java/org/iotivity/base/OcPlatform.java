@@ -195,7 +195,7 @@ public final class OcPlatform {
      */
     public static void notifyListOfObservers(
             OcResourceHandle ocResourceHandle,
-            List<Byte> ocObservationIdList,
+            List<Integer> ocObservationIdList,
             OcResourceResponse ocResourceResponse) throws OcException {
         OcPlatform.initCheck();
 
@@ -203,11 +203,11 @@ public final class OcPlatform {
             throw new OcException(ErrorCode.INVALID_PARAM, "ocObservationIdList cannot be null");
         }
 
-        byte[] idArr = new byte[ocObservationIdList.size()];
-        Iterator<Byte> it = ocObservationIdList.iterator();
+        int[] idArr = new int[ocObservationIdList.size()];
+        Iterator<Integer> it = ocObservationIdList.iterator();
         int i = 0;
         while (it.hasNext()) {
-            idArr[i++] = (byte) it.next();
+            idArr[i++] = it.next();
         }
 
         OcPlatform.notifyListOfObservers2(
@@ -218,7 +218,7 @@ public final class OcPlatform {
 
     private static native void notifyListOfObservers2(
             OcResourceHandle ocResourceHandle,
-            byte[] ocObservationIdArray,
+            int[] ocObservationIdArray,
             OcResourceResponse ocResourceResponse) throws OcException;
 
     /**
@@ -237,7 +237,7 @@ public final class OcPlatform {
      */
     public static void notifyListOfObservers(
             OcResourceHandle ocResourceHandle,
-            List<Byte> ocObservationIdList,
+            List<Integer> ocObservationIdList,
             OcResourceResponse ocResourceResponse,
             QualityOfService qualityOfService) throws OcException {
         OcPlatform.initCheck();
@@ -246,11 +246,11 @@ public final class OcPlatform {
             throw new OcException(ErrorCode.INVALID_PARAM, "ocObservationIdList cannot be null");
         }
 
-        byte[] idArr = new byte[ocObservationIdList.size()];
-        Iterator<Byte> it = ocObservationIdList.iterator();
+        int[] idArr = new int[ocObservationIdList.size()];
+        Iterator<Integer> it = ocObservationIdList.iterator();
         int i = 0;
         while (it.hasNext()) {
-            idArr[i++] = (byte) it.next();
+            idArr[i++] = it.next();
         }
 
         OcPlatform.notifyListOfObservers3(
@@ -263,7 +263,7 @@ public final class OcPlatform {
 
     private static native void notifyListOfObservers3(
             OcResourceHandle ocResourceHandle,
-            byte[] ocObservationIdArray,
+            int[] ocObservationIdArray,
             OcResourceResponse ocResourceResponse,
             int qualityOfService) throws OcException;
 
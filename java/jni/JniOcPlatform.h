@@ -110,18 +110,18 @@ extern "C" {
     /*
     * Class:     org_iotivity_base_OcPlatform
     * Method:    notifyListOfObservers2
-    * Signature: (Lorg/iotivity/base/OcResourceHandle;[BLorg/iotivity/base/OcResourceResponse;)V
+    * Signature: (Lorg/iotivity/base/OcResourceHandle;[ILorg/iotivity/base/OcResourceResponse;)V
     */
     JNIEXPORT void JNICALL Java_org_iotivity_base_OcPlatform_notifyListOfObservers2
-        (JNIEnv *, jclass, jobject, jbyteArray, jobject);
+        (JNIEnv *, jclass, jobject, jintArray, jobject);
 
     /*
     * Class:     org_iotivity_base_OcPlatform
     * Method:    notifyListOfObservers3
-    * Signature: (Lorg/iotivity/base/OcResourceHandle;[BLorg/iotivity/base/OcResourceResponse;I)V
+    * Signature: (Lorg/iotivity/base/OcResourceHandle;[ILorg/iotivity/base/OcResourceResponse;I)V
     */
     JNIEXPORT void JNICALL Java_org_iotivity_base_OcPlatform_notifyListOfObservers3
-        (JNIEnv *, jclass, jobject, jbyteArray, jobject, jint);
+        (JNIEnv *, jclass, jobject, jintArray, jobject, jint);
 
     /*
     * Class:     org_iotivity_base_OcPlatform
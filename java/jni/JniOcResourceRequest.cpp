@@ -215,7 +215,7 @@ JNIEXPORT jobject JNICALL Java_org_iotivity_base_OcResourceRequest_getObservatio
     ObservationInfo oInfo = request->getObservationInfo();
 
     jobject jObservationInfo = env->NewObject(g_cls_ObservationInfo, g_mid_ObservationInfo_N_ctor,
-        (jint)oInfo.action, (jbyte)oInfo.obsId);
+        (jint)oInfo.action, (jint)oInfo.obsId);
 
     if (!jObservationInfo)
     {
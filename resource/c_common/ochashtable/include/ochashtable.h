@@ -0,0 +1,204 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+/**
+ * @file
+ *
+ * Hash functions and an intrusive chained hash table.
+ *
+ * The table does not own its entries. An entry embeds an OCHashLink and is found again
+ * from it with OC_HASH_ENTRY(). The table grows by doubling when it holds as many entries
+ * as it has buckets. If growing fails the entries are chained deeper into the buckets
+ * there are, so lookups stay correct and only get slower. Entries with the same hash are
+ * found in the order they were inserted.
+ */
+
+#ifndef OC_HASHTABLE_H_
+#define OC_HASHTABLE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+/** Starting value of a 32 bit FNV-1a hash. */
+#define OC_HASH_INIT (2166136261u)
+
+/**
+ * Get the entry that embeds a link.
+ *
+ * @param link    Pointer to the OCHashLink.
+ * @param type    Type of the entry.
+ * @param member  Name of the OCHashLink member of @p type.
+ */
+#define OC_HASH_ENTRY(link, type, member) \
+    ((type *)(void *)((char *)(link) - offsetof(type, member)))
+
+/** Link of an entry into an OCHashTable. */
+typedef struct OCHashLink
+{
+    /** Next entry in the same bucket. */
+    struct OCHashLink *next;
+
+    /** Hash the entry was inserted with. */
+    uint32_t hash;
+} OCHashLink;
+
+/** Intrusive chained hash table. A zeroed table is empty and valid. */
+typedef struct OCHashTable
+{
+    /** Buckets, NULL until the first insertion. */
+    OCHashLink **buckets;
+
+    /** Number of buckets, a power of two or 0. */
+    size_t bucketCount;
+
+    /** Number of entries. */
+    size_t count;
+
+    /** Number of buckets allocated on the first insertion, a power of two. */
+    size_t initialBuckets;
+} OCHashTable;
+
+/** Initializer of an empty table that starts with @p buckets buckets. */
+#define OC_HASH_TABLE_INITIALIZER(buckets) { NULL, 0, 0, (buckets) }
+
+/**
+ * Continue a 32 bit FNV-1a hash over a block of bytes.
+ *
+ * @param hash  Hash so far, OC_HASH_INIT to start one.
+ * @param data  Bytes to hash.
+ * @param size  Number of bytes.
+ *
+ * @return the updated hash.
+ */
+uint32_t OCHashBytes(uint32_t hash, const void *data, size_t size);
+
+/**
+ * Continue a 32 bit FNV-1a hash over a NUL terminated string, without the NUL.
+ *
+ * @param hash  Hash so far, OC_HASH_INIT to start one.
+ * @param str   String to hash.
+ *
+ * @return the updated hash.
+ */
+uint32_t OCHashString(uint32_t hash, const char *str);
+
+/**
+ * Hash a pointer to an allocation. The low bits, which alignment keeps at zero, are dropped.
+ *
+ * @param ptr  Pointer to hash.
+ *
+ * @return the hash.
+ */
+uint32_t OCHashPointer(const void *ptr);
+
+/**
+ * Set up an empty table.
+ *
+ * @param table           Table to set up.
+ * @param initialBuckets  Buckets allocated on the first insertion, a power of two.
+ */
+void OCHashTableInit(OCHashTable *table, size_t initialBuckets);
+
+/**
+ * Insert an entry. The entry must not be in a table already.
+ *
+ * @param table  Table to insert into.
+ * @param link   Link of the entry.
+ * @param hash   Hash of the key of the entry.
+ *
+ * @return false if the table has no buckets and none could be allocated.
+ */
+bool OCHashTableInsert(OCHashTable *table, OCHashLink *link, uint32_t hash);
+
+/**
+ * Remove an entry. Nothing happens if the entry is not in the table.
+ *
+ * @param table  Table to remove from.
+ * @param link   Link of the entry.
+ */
+void OCHashTableRemove(OCHashTable *table, OCHashLink *link);
+
+/**
+ * Get the first entry inserted with a hash. The caller compares the keys and goes on with
+ * OCHashTableNext() until one matches.
+ *
+ * @param table  Table to look in.
+ * @param hash   Hash of the key looked for.
+ *
+ * @return the link of the entry, or NULL.
+ */
+OCHashLink *OCHashTableFirst(const OCHashTable *table, uint32_t hash);
+
+/**
+ * Get the next entry inserted with the same hash as @p link.
+ *
+ * @param link  Link returned by OCHashTableFirst() or OCHashTableNext().
+ *
+ * @return the link of the entry, or NULL.
+ */
+OCHashLink *OCHashTableNext(const OCHashLink *link);
+
+/**
+ * Get the first entry of a table, to visit every entry in no particular order.
+ *
+ * @param table  Table to walk.
+ *
+ * @return the link of the entry, or NULL if the table is empty.
+ */
+OCHashLink *OCHashTableFirstEntry(const OCHashTable *table);
+
+/**
+ * Get the entry after @p link in the order of OCHashTableFirstEntry(). The table must not
+ * grow during the walk. To remove the current entry, get the next one first.
+ *
+ * @param table  Table to walk.
+ * @param link   Link of an entry that is in the table.
+ *
+ * @return the link of the entry, or NULL after the last entry.
+ */
+OCHashLink *OCHashTableNextEntry(const OCHashTable *table, const OCHashLink *link);
+
+/**
+ * Remove and return any entry, to empty a table whose entries are being freed.
+ *
+ * @param table  Table to take from.
+ *
+ * @return the link of the entry, or NULL if the table is empty.
+ */
+OCHashLink *OCHashTablePop(OCHashTable *table);
+
+/**
+ * Release the buckets. The entries are not touched and the table is left empty.
+ *
+ * @param table  Table to clear.
+ */
+void OCHashTableClear(OCHashTable *table);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // OC_HASHTABLE_H_
@@ -0,0 +1,220 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include "ochashtable.h"
+#include "oic_malloc.h"
+
+/** Buckets of a table set up without OCHashTableInit(). */
+#define OC_HASH_DEFAULT_BUCKETS (16)
+
+#define OC_HASH_PRIME (16777619u)
+
+uint32_t OCHashBytes(uint32_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * OC_HASH_PRIME;
+    }
+    return hash;
+}
+
+uint32_t OCHashString(uint32_t hash, const char *str)
+{
+    for (const uint8_t *c = (const uint8_t *)str; *c; c++)
+    {
+        hash = (hash ^ *c) * OC_HASH_PRIME;
+    }
+    return hash;
+}
+
+uint32_t OCHashPointer(const void *ptr)
+{
+    uintptr_t value = (uintptr_t)ptr >> 3;
+    // Fibonacci hashing spreads the consecutive values of neighbouring allocations.
+    return (uint32_t)value * 2654435761u;
+}
+
+void OCHashTableInit(OCHashTable *table, size_t initialBuckets)
+{
+    table->buckets = NULL;
+    table->bucketCount = 0;
+    table->count = 0;
+    table->initialBuckets = initialBuckets;
+}
+
+static OCHashLink **Bucket(const OCHashTable *table, uint32_t hash)
+{
+    return &table->buckets[hash & (table->bucketCount - 1)];
+}
+
+static void Append(OCHashLink **bucket, OCHashLink *link)
+{
+    while (*bucket)
+    {
+        bucket = &(*bucket)->next;
+    }
+    link->next = NULL;
+    *bucket = link;
+}
+
+static bool Resize(OCHashTable *table, size_t bucketCount)
+{
+    OCHashLink **buckets = (OCHashLink **)OICCalloc(bucketCount, sizeof(OCHashLink *));
+    if (!buckets)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < table->bucketCount; i++)
+    {
+        OCHashLink *link = table->buckets[i];
+        while (link)
+        {
+            OCHashLink *next = link->next;
+            Append(&buckets[link->hash & (bucketCount - 1)], link);
+            link = next;
+        }
+    }
+
+    OICFree(table->buckets);
+    table->buckets = buckets;
+    table->bucketCount = bucketCount;
+    return true;
+}
+
+bool OCHashTableInsert(OCHashTable *table, OCHashLink *link, uint32_t hash)
+{
+    if (table->count >= table->bucketCount)
+    {
+        size_t bucketCount = table->bucketCount;
+        if (0 == bucketCount)
+        {
+            bucketCount = table->initialBuckets ? table->initialBuckets
+                                                : OC_HASH_DEFAULT_BUCKETS;
+        }
+        else
+        {
+            bucketCount *= 2;
+        }
+
+        if (!Resize(table, bucketCount) && !table->buckets)
+        {
+            return false;
+        }
+    }
+
+    link->hash = hash;
+    Append(Bucket(table, hash), link);
+    table->count++;
+    return true;
+}
+
+void OCHashTableRemove(OCHashTable *table, OCHashLink *link)
+{
+    if (!table->buckets)
+    {
+        return;
+    }
+
+    for (OCHashLink **prev = Bucket(table, link->hash); *prev; prev = &(*prev)->next)
+    {
+        if (*prev == link)
+        {
+            *prev = link->next;
+            link->next = NULL;
+            table->count--;
+            return;
+        }
+    }
+}
+
+static OCHashLink *SkipToHash(OCHashLink *link, uint32_t hash)
+{
+    while (link && link->hash != hash)
+    {
+        link = link->next;
+    }
+    return link;
+}
+
+OCHashLink *OCHashTableFirst(const OCHashTable *table, uint32_t hash)
+{
+    if (!table->buckets)
+    {
+        return NULL;
+    }
+    return SkipToHash(*Bucket(table, hash), hash);
+}
+
+OCHashLink *OCHashTableNext(const OCHashLink *link)
+{
+    return SkipToHash(link->next, link->hash);
+}
+
+static OCHashLink *FirstFromBucket(const OCHashTable *table, size_t index)
+{
+    for (; index < table->bucketCount; index++)
+    {
+        if (table->buckets[index])
+        {
+            return table->buckets[index];
+        }
+    }
+    return NULL;
+}
+
+OCHashLink *OCHashTableFirstEntry(const OCHashTable *table)
+{
+    return FirstFromBucket(table, 0);
+}
+
+OCHashLink *OCHashTableNextEntry(const OCHashTable *table, const OCHashLink *link)
+{
+    if (link->next)
+    {
+        return link->next;
+    }
+    return FirstFromBucket(table, (link->hash & (table->bucketCount - 1)) + 1);
+}
+
+OCHashLink *OCHashTablePop(OCHashTable *table)
+{
+    for (size_t i = 0; i < table->bucketCount; i++)
+    {
+        OCHashLink *link = table->buckets[i];
+        if (link)
+        {
+            table->buckets[i] = link->next;
+            link->next = NULL;
+            table->count--;
+            return link;
+        }
+    }
+    return NULL;
+}
+
+void OCHashTableClear(OCHashTable *table)
+{
+    OICFree(table->buckets);
+    table->buckets = NULL;
+    table->bucketCount = 0;
+    table->count = 0;
+}
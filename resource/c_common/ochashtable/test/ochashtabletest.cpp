@@ -0,0 +1,217 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include "ochashtable.h"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+namespace
+{
+struct Entry
+{
+    int key;
+    OCHashLink link;
+};
+
+uint32_t HashKey(int key)
+{
+    return OCHashBytes(OC_HASH_INIT, &key, sizeof(key));
+}
+
+Entry *Find(const OCHashTable *table, int key)
+{
+    for (OCHashLink *link = OCHashTableFirst(table, HashKey(key)); link;
+         link = OCHashTableNext(link))
+    {
+        Entry *entry = OC_HASH_ENTRY(link, Entry, link);
+        if (entry->key == key)
+        {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+}
+
+TEST(HashTests, FnvMatchesReferenceValues)
+{
+    EXPECT_EQ(2166136261u, OCHashBytes(OC_HASH_INIT, "", 0));
+    EXPECT_EQ(0xe40c292cu, OCHashBytes(OC_HASH_INIT, "a", 1));
+    EXPECT_EQ(0xbf9cf968u, OCHashString(OC_HASH_INIT, "foobar"));
+}
+
+TEST(HashTests, HashesCanBeContinued)
+{
+    EXPECT_EQ(OCHashString(OC_HASH_INIT, "foobar"),
+              OCHashString(OCHashString(OC_HASH_INIT, "foo"), "bar"));
+    EXPECT_EQ(OCHashString(OC_HASH_INIT, "foobar"),
+              OCHashBytes(OCHashBytes(OC_HASH_INIT, "foo", 3), "bar", 3));
+}
+
+TEST(HashTests, PointerHashIgnoresAlignmentBits)
+{
+    int values[2];
+    EXPECT_NE(OCHashPointer(&values[0]), OCHashPointer(&values[0] + 2));
+    EXPECT_EQ(0u, OCHashPointer(NULL));
+}
+
+TEST(HashTableTests, EmptyTableFindsNothing)
+{
+    OCHashTable table = OC_HASH_TABLE_INITIALIZER(4);
+    EXPECT_EQ(nullptr, OCHashTableFirst(&table, 0));
+    EXPECT_EQ(nullptr, OCHashTablePop(&table));
+
+    Entry entry = { 1, { NULL, 0 } };
+    OCHashTableRemove(&table, &entry.link);
+    EXPECT_EQ(0u, table.count);
+    OCHashTableClear(&table);
+}
+
+TEST(HashTableTests, InsertFindRemoveWhileGrowing)
+{
+    OCHashTable table;
+    OCHashTableInit(&table, 2);
+
+    std::vector<Entry> entries(1000);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        entries[i].key = (int)i;
+        ASSERT_TRUE(OCHashTableInsert(&table, &entries[i].link, HashKey(entries[i].key)));
+    }
+    EXPECT_EQ(entries.size(), table.count);
+    EXPECT_GE(table.bucketCount, entries.size());
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        EXPECT_EQ(&entries[i], Find(&table, (int)i));
+    }
+    EXPECT_EQ(nullptr, Find(&table, -1));
+
+    for (size_t i = 0; i < entries.size(); i += 2)
+    {
+        OCHashTableRemove(&table, &entries[i].link);
+    }
+    EXPECT_EQ(entries.size() / 2, table.count);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        EXPECT_EQ((i % 2) ? &entries[i] : nullptr, Find(&table, (int)i));
+    }
+
+    OCHashTableClear(&table);
+    EXPECT_EQ(0u, table.count);
+    EXPECT_EQ(nullptr, Find(&table, 1));
+}
+
+TEST(HashTableTests, NextYieldsEveryEntryWithTheSameHash)
+{
+    OCHashTable table = OC_HASH_TABLE_INITIALIZER(4);
+    Entry entries[3] = { { 1, { NULL, 0 } }, { 2, { NULL, 0 } }, { 3, { NULL, 0 } } };
+    for (Entry &entry : entries)
+    {
+        ASSERT_TRUE(OCHashTableInsert(&table, &entry.link, 7));
+    }
+
+    size_t found = 0;
+    for (OCHashLink *link = OCHashTableFirst(&table, 7); link; link = OCHashTableNext(link))
+    {
+        EXPECT_EQ(&entries[found], OC_HASH_ENTRY(link, Entry, link));
+        found++;
+    }
+    EXPECT_EQ(3u, found);
+    EXPECT_EQ(nullptr, OCHashTableFirst(&table, 11));
+    OCHashTableClear(&table);
+}
+
+TEST(HashTableTests, GrowingKeepsInsertionOrder)
+{
+    OCHashTable table = OC_HASH_TABLE_INITIALIZER(2);
+    std::vector<Entry> entries(64);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        entries[i].key = (int)i;
+        ASSERT_TRUE(OCHashTableInsert(&table, &entries[i].link, (uint32_t)(i % 3)));
+    }
+
+    for (uint32_t hash = 0; hash < 3; hash++)
+    {
+        size_t expected = hash;
+        for (OCHashLink *link = OCHashTableFirst(&table, hash); link;
+             link = OCHashTableNext(link))
+        {
+            EXPECT_EQ((int)expected, OC_HASH_ENTRY(link, Entry, link)->key);
+            expected += 3;
+        }
+        EXPECT_LE(entries.size(), expected);
+    }
+    OCHashTableClear(&table);
+}
+
+TEST(HashTableTests, WalkVisitsEveryEntryOnce)
+{
+    OCHashTable table = OC_HASH_TABLE_INITIALIZER(4);
+    EXPECT_EQ(nullptr, OCHashTableFirstEntry(&table));
+
+    std::vector<Entry> entries(50);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        entries[i].key = (int)i;
+        ASSERT_TRUE(OCHashTableInsert(&table, &entries[i].link, HashKey(entries[i].key)));
+    }
+
+    std::vector<int> seen(entries.size(), 0);
+    OCHashLink *next = NULL;
+    for (OCHashLink *link = OCHashTableFirstEntry(&table); link; link = next)
+    {
+        next = OCHashTableNextEntry(&table, link);
+        Entry *entry = OC_HASH_ENTRY(link, Entry, link);
+        seen[entry->key]++;
+        if (entry->key % 2)
+        {
+            OCHashTableRemove(&table, link);
+        }
+    }
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        EXPECT_EQ(1, seen[i]);
+    }
+    EXPECT_EQ(entries.size() / 2, table.count);
+    OCHashTableClear(&table);
+}
+
+TEST(HashTableTests, PopDrainsTheTable)
+{
+    OCHashTable table = OC_HASH_TABLE_INITIALIZER(4);
+    std::vector<Entry> entries(20);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        entries[i].key = (int)i;
+        ASSERT_TRUE(OCHashTableInsert(&table, &entries[i].link, HashKey(entries[i].key)));
+    }
+
+    size_t popped = 0;
+    while (OCHashTablePop(&table))
+    {
+        popped++;
+    }
+    EXPECT_EQ(entries.size(), popped);
+    EXPECT_EQ(0u, table.count);
+    OCHashTableClear(&table);
+}
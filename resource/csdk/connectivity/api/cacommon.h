@@ -304,7 +304,8 @@ typedef enum
     CA_BLOCK_SIZE_128_BYTE = 3,   /**< 128byte */
     CA_BLOCK_SIZE_256_BYTE = 4,   /**< 256byte */
     CA_BLOCK_SIZE_512_BYTE = 5,   /**< 512byte */
-    CA_BLOCK_SIZE_1024_BYTE = 6     /**< 1Kbyte */
+    CA_BLOCK_SIZE_1024_BYTE = 6,    /**< 1Kbyte */
+    CA_BLOCK_SIZE_BERT = 7          /**< 1Kbyte units, several per message (TCP only) */
 } CABlockSize_t;
 
 /**
@@ -477,6 +478,28 @@ typedef struct
     char optionData[CA_MAX_HEADER_OPTION_DATA_LENGTH];      /**< Optional data values**/
 } CAHeaderOption_t;
 
+/**
+ * Callback function type for the parts of an outgoing payload.
+ * It is called every time a part of the payload is put in a message, so the payload
+ * never has to be held in memory as a whole. Parts may be asked for more than once,
+ * e.g. when the remote endpoint requests a block again.
+ * @param[in]   context     ::CAInfo_t::payloadProducerContext of the message.
+ * @param[in]   offset      offset of the part in the payload.
+ * @param[out]  buffer      buffer to write the part to.
+ * @param[in]   length      number of bytes to write to buffer.
+ * @return true if the part was written, false if the message can not be sent.
+ */
+typedef bool (*CAPayloadProducer)(void *context, size_t offset, uint8_t *buffer,
+                                  size_t length);
+
+/**
+ * Callback function type to release the context of a ::CAPayloadProducer.
+ * It is called once no part of the payload will be produced any more, whether the
+ * message was sent, failed or timed out.
+ * @param[in]   context     ::CAInfo_t::payloadProducerContext of the message.
+ */
+typedef void (*CAPayloadRelease)(void *context);
+
 /**
  * Base Information received.
  *
@@ -505,6 +528,14 @@ typedef struct
     CAURI_t resourceUri;        /**< Resource URI information **/
     CARemoteId_t identity;      /**< endpoint identity */
     CADataType_t dataType;      /**< data type */
+    CAPayloadProducer payloadProducer;  /**< if set, payload is NULL and the payloadSize
+                                             bytes are produced part by part when sent */
+    void *payloadProducerContext;       /**< context passed to payloadProducer, it has to
+                                             stay valid as long as parts may be sent */
+    CAPayloadRelease payloadRelease;    /**< if set, CA calls it with payloadProducerContext
+                                             once for every CASendRequest() or
+                                             CASendResponse() the info is given to, when
+                                             no part is produced any more */
 } CAInfo_t;
 
 /**
@@ -611,6 +642,9 @@ typedef struct
 
     CAPorts_t ports;
 
+    int32_t threadPoolSize; /**< worker threads started with the CA thread pool, 0 for default */
+    int32_t dispatchShardCount; /**< threads requests are dispatched on, 0 for OCProcess */
+
     struct sockets
     {
         void *threadpool;           /**< threadpool between Initialize and Start */
@@ -651,6 +685,7 @@ typedef struct
     struct calayer
     {
         CAHistory_t requestHistory;  /**< filter IP family in requests */
+        bool qBlockEnabled;          /**< send and accept Q-Block transfers over UDP */
     } ca;
 
 #ifdef TCP_ADAPTER
@@ -666,6 +701,9 @@ typedef struct
         CASocket_t ipv6s;       /**< IPv6 accept socket secure */
         int selectTimeout;      /**< in seconds */
         int listenBacklog;      /**< backlog counts*/
+        int connectTimeout;     /**< in seconds */
+        uint32_t maxMessageSize;/**< Max-Message-Size announced in our CSM */
+        bool bertDisabled;      /**< send 1Kbyte blocks even if the peer supports BERT */
 #if defined(_WIN32)
         WSAEVENT updateEvent;   /**< Event used to signal thread to stop or update the FD list */
 #else
@@ -722,6 +760,30 @@ typedef void (*CAErrorCallback)(const CAEndpoint_t *object,
 typedef CAResult_t (*CAHandshakeErrorCallback)(const CAEndpoint_t *object,
                                                const CAErrorInfo_t *errorInfo);
 
+/**
+ * Callback function type for the blocks of a block-wise transfer, delivered as they are
+ * received instead of being reassembled. It is called from the receive thread with the
+ * first block of every transfer, offset 0. If it returns false, the transfer is
+ * reassembled and delivered to the request or response callback as usual. If it returns
+ * true, it gets every following block and the request or response callback gets the
+ * message once the last block is received, without a payload. A transfer restarted
+ * after a lost block is offered again from offset 0.
+ * @param[out]   object           Endpoint object from which the block is received.
+ * @param[out]   requestInfo      Info of the request, or NULL for a response.
+ * @param[out]   responseInfo     Info of the response, or NULL for a request.
+ * @param[out]   offset           Offset of the block in the payload.
+ * @param[out]   data             Payload of the block.
+ * @param[out]   length           Length of the block.
+ * @param[out]   totalLength      Length of the payload if the remote endpoint gave it
+ *                                with a size option, 0 otherwise.
+ * @return true to take the transfer, the return value of later blocks is ignored.
+ */
+typedef bool (*CABlockDataCallback)(const CAEndpoint_t *object,
+                                    const CARequestInfo_t *requestInfo,
+                                    const CAResponseInfo_t *responseInfo,
+                                    size_t offset, const uint8_t *data, size_t length,
+                                    size_t totalLength);
+
 /**
  * Callback function type for network status changes delivery from CA common logic.
  * @param[out]   info       Endpoint object from which the network status is changed.
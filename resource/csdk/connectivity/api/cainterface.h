@@ -132,6 +132,16 @@ CAResult_t CAStartDiscoveryServer();
 void CARegisterHandler(CARequestCallback ReqHandler, CAResponseCallback RespHandler,
                        CAErrorCallback ErrorHandler);
 
+/**
+ * Register the callback to get the blocks of block-wise transfers as they are received.
+ * Pass NULL to have every transfer reassembled again.
+ * @param[in]   BlockHandler  Block data callback.
+ * @return  ::CA_STATUS_OK, ::CA_STATUS_NOT_INITIALIZED or ::CA_NOT_SUPPORTED if the
+ *          stack is built without block-wise transfer.
+ * @see     CABlockDataCallback
+ */
+CAResult_t CARegisterBlockDataHandler(CABlockDataCallback BlockHandler);
+
 /**
  * Create an endpoint description.
  * @param[in]   flags                 how the adapter should be used.
@@ -231,6 +241,26 @@ CATransportAdapter_t CAGetSelectedNetwork();
  */
 CAResult_t CAHandleRequestResponse();
 
+/**
+ * Get a descriptor that becomes readable when CAHandleRequestResponse() has work, for use
+ * in an application's own poll, select or epoll loop.
+ * @return  file descriptor, or -1 if not initialized or the platform has none.
+ */
+int CAGetWakeupFd();
+
+/**
+ * Wake up a caller blocked in CAWaitForWakeup() or polling the wakeup descriptor.
+ * @return   ::CA_STATUS_OK or ::CA_STATUS_NOT_INITIALIZED
+ */
+CAResult_t CAWakeup();
+
+/**
+ * Block until CAHandleRequestResponse() has work, CAWakeup() is called or the timeout passes.
+ * @param[in]   timeoutMs     timeout in milliseconds, UINT32_MAX to wait without limit.
+ * @return   ::CA_STATUS_OK, ::CA_STATUS_FAILED on timeout or ::CA_STATUS_NOT_INITIALIZED
+ */
+CAResult_t CAWaitForWakeup(uint32_t timeoutMs);
+
 #ifdef RA_ADAPTER
 /**
  * Set Remote Access information for XMPP Client.
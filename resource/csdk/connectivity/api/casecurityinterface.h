@@ -183,6 +183,14 @@ typedef void (*CAgetPkixInfoHandler)(PkiInfo_t * inf);
  */
 CAResult_t CAregisterPkixInfoHandler(CAgetPkixInfoHandler getPkixInfoHandler);
 
+/**
+ * Drop the PKIX info parsed for (D)TLS handshakes and the sessions kept for resumption,
+ * so that the next handshakes get the PKIX info again and are full handshakes.
+ * To be called when the credentials change.
+ * @return  ::CA_STATUS_OK or appropriate error code.
+ */
+CAResult_t CAinvalidateSslCredentials(void);
+
 /**
  * Select the cipher suite for dtls handshake.
  *
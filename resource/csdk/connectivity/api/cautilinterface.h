@@ -133,6 +133,61 @@ CAResult_t CASetPortNumberToAssign(CATransportAdapter_t adapter,
  */
 uint16_t CAGetAssignedPortNumber(CATransportAdapter_t adapter, CATransportFlags_t flag);
 
+/**
+ * Set the number of worker threads the CA thread pool starts with.
+ * Has to be called before CAInitialize() to take effect.
+ * @param[in]   size        Number of worker threads.
+ *
+ * @return  ::CA_STATUS_OK or ::CA_STATUS_INVALID_PARAM.
+ */
+CAResult_t CASetThreadPoolSize(int32_t size);
+
+/**
+ * Set the number of threads received requests are dispatched on. Requests are assigned to
+ * a thread by the path of their resource, so requests to one resource keep their order.
+ * With 0, the default, every request is dispatched from CAHandleRequestResponse() on the
+ * thread that calls it. Has to be called before CAInitialize() to take effect.
+ * @param[in]   count       Number of dispatch threads, or 0.
+ *
+ * @return  ::CA_STATUS_OK or ::CA_STATUS_INVALID_PARAM.
+ */
+CAResult_t CASetDispatchShardCount(int32_t count);
+
+/**
+ * Use Q-Block1 and Q-Block2 (RFC 9177) for block-wise transfers over UDP. A set of blocks
+ * is sent without waiting for a response to each block, and lost blocks are sent again
+ * when the receiver reports them missing. Peers answering Q-Block1 with 4.02 Bad Option
+ * get Block1 and Block2 as before, so peers have to know Q-Block or reject the options
+ * they don't know. When disabled, the default, Q-Block1 requests are answered with 4.02
+ * and Q-Block2 in requests is ignored.
+ * @param[in]   enable      true to use Q-Block transfers.
+ *
+ * @return  ::CA_STATUS_OK.
+ */
+CAResult_t CASetQBlockTransfer(bool enable);
+
+#ifdef TCP_ADAPTER
+/**
+ * Set how long an outgoing TCP connection may take before it is abandoned.
+ * Data sent to the endpoint while it is connecting is reported as failed on timeout.
+ * @param[in]   timeout     Timeout in seconds.
+ *
+ * @return  ::CA_STATUS_OK or ::CA_STATUS_INVALID_PARAM.
+ */
+CAResult_t CASetTCPConnectTimeout(int timeout);
+
+/**
+ * Set what is announced in the CSM sent on every new TCP session. Once the CSM of a
+ * peer has arrived, payloads too large for its Max-Message-Size are sent block-wise,
+ * several 1Kbyte blocks per message (BERT) if both ends support it.
+ * @param[in]   maxMessageSize  Largest message accepted from a peer, at least 1152 bytes.
+ * @param[in]   bert            false to send payloads over 1Kbyte in 1Kbyte blocks.
+ *
+ * @return  ::CA_STATUS_OK or ::CA_STATUS_INVALID_PARAM.
+ */
+CAResult_t CASetTCPBlockWiseTransfer(uint32_t maxMessageSize, bool bert);
+#endif
+
 #if defined(TCP_ADAPTER) && defined(WITH_CLOUD)
 /**
  * Initializes the Connection Manager
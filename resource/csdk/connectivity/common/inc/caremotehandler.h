@@ -65,6 +65,23 @@ void CAFreeEndpoint(CAEndpoint_t *rep);
  */
 CAResult_t CACloneInfo(const CAInfo_t *info, CAInfo_t *clone);
 
+/**
+ * Take over the payload producer of an info given to CASendRequest() or CASendResponse().
+ * The producer is shared by every clone of @p shared, so that ::CAInfo_t::payloadRelease
+ * of the caller is called once, when the last of them is destroyed.
+ * @param[in]   info    info given by the caller.
+ * @param[out]  shared  shallow copy of @p info that holds a reference on the producer.
+ *                      Drop it with CADropPayloadProducer().
+ * @return  ::CA_STATUS_OK, or ::CA_MEMORY_ALLOC_FAILED once the release has been called.
+ */
+CAResult_t CAAdoptPayloadProducer(const CAInfo_t *info, CAInfo_t *shared);
+
+/**
+ * Drop the reference of an info on its payload producer, if it holds one.
+ * @param[in]   info    info whose reference is dropped.
+ */
+void CADropPayloadProducer(CAInfo_t *info);
+
 /**
  * Creates a new request information.
  * @param[in]   request           request information that needs to be duplicated.
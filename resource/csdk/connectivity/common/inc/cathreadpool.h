@@ -43,6 +43,20 @@ extern "C"
  */
 typedef void (*ca_thread_func)(void *);
 
+/**
+ * Counters of a thread pool, see ca_thread_pool_get_stats().
+ */
+typedef struct ca_thread_pool_stats_t
+{
+    size_t thread_count;            /**< worker threads started by the pool */
+    size_t idle_count;              /**< worker threads waiting for a task */
+    size_t queue_depth;             /**< tasks waiting for a worker */
+    size_t max_queue_depth;         /**< highest queue_depth seen */
+    uint64_t tasks_started;         /**< tasks taken by a worker */
+    uint64_t total_latency_us;      /**< sum of the time tasks waited for a worker */
+    uint64_t max_latency_us;        /**< longest time a task waited for a worker */
+} ca_thread_pool_stats_t;
+
 struct ca_thread_pool_details_t;
 /**
  * Thread pool type.
@@ -55,7 +69,8 @@ typedef struct ca_thread_pool
 /**
  * This function creates a newly allocated thread pool.
  *
- * @param num_of_threads The number of worker thread used in this pool.
+ * @param num_of_threads The number of worker threads started with the pool. More are started
+ *                       when a task is added while every worker is busy.
  * @param thread_pool_handle Handle to newly create thread pool.
  * @return Error code, CA_STATUS_OK if success, else error number.
  */
@@ -74,6 +89,17 @@ CAResult_t ca_thread_pool_init(int32_t num_of_threads, ca_thread_pool_t *thread_
 CAResult_t ca_thread_pool_add_task(ca_thread_pool_t thread_pool, ca_thread_func method,
                     void *data);
 
+/**
+ * This function reads the counters of a thread pool.
+ *
+ * @param thread_pool The thread pool structure.
+ * @param stats Receives a snapshot of the counters.
+ *
+ * @return CA_STATUS_OK on success.
+ * @return Error on failure.
+ */
+CAResult_t ca_thread_pool_get_stats(ca_thread_pool_t thread_pool, ca_thread_pool_stats_t *stats);
+
 /**
  * This function stops all the worker threads (stop & exit). And frees all the allocated memory.
  * Function will return only after joining all threads executing the currently scheduled tasks.
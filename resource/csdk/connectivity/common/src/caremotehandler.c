@@ -22,6 +22,7 @@
 
 #include "oic_malloc.h"
 #include "oic_string.h"
+#include "ocatomic.h"
 #include "caremotehandler.h"
 #include "experimental/logger.h"
 
@@ -178,6 +179,85 @@ void CAFreeEndpoint(CAEndpoint_t *rep)
     OICFree(rep);
 }
 
+/**
+ * Payload producer of a message, shared by every clone of its info.
+ */
+typedef struct
+{
+    CAPayloadProducer producer;     /**< producer given by the caller. */
+    void *context;                  /**< context given by the caller. */
+    CAPayloadRelease release;       /**< release given by the caller. */
+    volatile int32_t refCount;      /**< number of infos holding the producer. */
+} CASharedPayloadProducer_t;
+
+static bool CAProduceSharedPayload(void *context, size_t offset, uint8_t *buffer,
+                                   size_t length)
+{
+    CASharedPayloadProducer_t *shared = (CASharedPayloadProducer_t *) context;
+    return shared->producer(shared->context, offset, buffer, length);
+}
+
+static void CAReleaseSharedPayload(void *context)
+{
+    CASharedPayloadProducer_t *shared = (CASharedPayloadProducer_t *) context;
+    if (0 == oc_atomic_decrement(&shared->refCount))
+    {
+        shared->release(shared->context);
+        OICFree(shared);
+    }
+}
+
+CAResult_t CAAdoptPayloadProducer(const CAInfo_t *info, CAInfo_t *shared)
+{
+    if (!info || !shared)
+    {
+        OIC_LOG(ERROR, TAG, "input parameter invalid");
+        return CA_STATUS_INVALID_PARAM;
+    }
+
+    *shared = *info;
+    if (!info->payloadRelease)
+    {
+        return CA_STATUS_OK;
+    }
+
+    CASharedPayloadProducer_t *producer =
+        (CASharedPayloadProducer_t *) OICMalloc(sizeof(CASharedPayloadProducer_t));
+    if (!producer)
+    {
+        OIC_LOG(ERROR, TAG, "CAAdoptPayloadProducer Out of memory");
+        shared->payloadRelease = NULL;
+        info->payloadRelease(info->payloadProducerContext);
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+
+    producer->producer = info->payloadProducer;
+    producer->context = info->payloadProducerContext;
+    producer->release = info->payloadRelease;
+    producer->refCount = 1;
+
+    shared->payloadProducer = info->payloadProducer ? CAProduceSharedPayload : NULL;
+    shared->payloadProducerContext = producer;
+    shared->payloadRelease = CAReleaseSharedPayload;
+    return CA_STATUS_OK;
+}
+
+void CADropPayloadProducer(CAInfo_t *info)
+{
+    if (!info)
+    {
+        return;
+    }
+
+    if (info->payloadRelease)
+    {
+        info->payloadRelease(info->payloadProducerContext);
+    }
+    info->payloadProducer = NULL;
+    info->payloadProducerContext = NULL;
+    info->payloadRelease = NULL;
+}
+
 static void CADestroyInfoInternal(CAInfo_t *info)
 {
     // free token field
@@ -198,6 +278,9 @@ static void CADestroyInfoInternal(CAInfo_t *info)
     // free uri
     OICFree(info->resourceUri);
     info->resourceUri = NULL;
+
+    // release the payload producer
+    CADropPayloadProducer(info);
 }
 
 void CADestroyRequestInfoInternal(CARequestInfo_t *rep)
@@ -297,6 +380,21 @@ CAResult_t CACloneInfo(const CAInfo_t *info, CAInfo_t *clone)
         clone->payload = temp;
         clone->payloadSize = info->payloadSize;
     }
+    else if (info->payloadProducer)
+    {
+        // the payload is produced when it is sent, only its size is kept
+        clone->payloadProducer = info->payloadProducer;
+        clone->payloadProducerContext = info->payloadProducerContext;
+        clone->payloadSize = info->payloadSize;
+        if (CAReleaseSharedPayload == info->payloadRelease)
+        {
+            // every clone holds the producer until it is destroyed
+            CASharedPayloadProducer_t *shared =
+                (CASharedPayloadProducer_t *) info->payloadProducerContext;
+            oc_atomic_increment(&shared->refCount);
+            clone->payloadRelease = info->payloadRelease;
+        }
+    }
     clone->payloadFormat = info->payloadFormat;
     clone->acceptFormat = info->acceptFormat;
     clone->payloadVersion = info->payloadVersion;
@@ -37,49 +37,159 @@
 #include "oic_malloc.h"
 #include "uarraylist.h"
 #include "octhread.h"
+#include "oic_time.h"
 #include "platform_features.h"
 
 #define TAG PCF("OIC_CA_UTHREADPOOL")
 
 /**
- * empty struct to represent the details.  This implementation has no data
- * that it needs to keep track of, so it only uses NULL for the internal value.
+ * A task waiting in the queue of a thread pool.
  */
-typedef struct ca_thread_pool_details_t
+typedef struct ca_thread_pool_task_t
 {
-    u_arraylist_t* threads_list;
-    oc_mutex list_lock;
-} ca_thread_pool_details_t;
+    ca_thread_func func;
+    void* data;
+    uint64_t queued_time;                   /**< microseconds */
+    struct ca_thread_pool_task_t* next;
+} ca_thread_pool_task_t;
 
 /**
- * struct to wrap the pthreads callback properly.  The function pointer for
- * pthreads requires a void* return value, however u_thread_func is a void.
+ * Workers of the pool and the queue they take tasks from. Workers are started by
+ * ca_thread_pool_init and whenever a task is added while none of them is idle, since most
+ * tasks of the connectivity layer are loops that only return when their adapter stops.
+ * Workers stay in the pool until it is freed.
  */
-typedef struct ca_thread_pool_callback_info_t
+typedef struct ca_thread_pool_details_t
 {
-    ca_thread_func func;
-    void* data;
-} ca_thread_pool_callback_info_t;
+    u_arraylist_t* threads_list;
+    oc_mutex list_lock;
+    oc_cond task_cond;
+    ca_thread_pool_task_t* queue_head;
+    ca_thread_pool_task_t* queue_tail;
+    size_t idle_count;
+    bool stopping;
+    ca_thread_pool_stats_t stats;
+} ca_thread_pool_details_t;
 
 typedef struct ca_thread_pool_thread_info_t
 {
     oc_thread thread;
 } ca_thread_pool_thread_info_t;
 
-// passthrough function to convert the pthreads call to a u_thread_func call
-void* ca_thread_pool_pthreads_delegate(void* data)
+// worker loop: run queued tasks until the pool is freed and the queue is empty.
+static void* ca_thread_pool_worker(void* data)
 {
-    ca_thread_pool_callback_info_t* info = (ca_thread_pool_callback_info_t*)data;
-    info->func(info->data);
-    OICFree(info);
+    ca_thread_pool_details_t* details = (ca_thread_pool_details_t*)data;
+
+    oc_mutex_lock(details->list_lock);
+    for (;;)
+    {
+        while (!details->queue_head && !details->stopping)
+        {
+            details->idle_count++;
+            oc_cond_wait(details->task_cond, details->list_lock);
+            details->idle_count--;
+        }
+
+        ca_thread_pool_task_t* task = details->queue_head;
+        if (!task)
+        {
+            break;
+        }
+        details->queue_head = task->next;
+        if (!details->queue_head)
+        {
+            details->queue_tail = NULL;
+        }
+        details->stats.queue_depth--;
+
+        uint64_t latency = OICGetCurrentTime(TIME_IN_US) - task->queued_time;
+        details->stats.tasks_started++;
+        details->stats.total_latency_us += latency;
+        if (latency > details->stats.max_latency_us)
+        {
+            details->stats.max_latency_us = latency;
+        }
+        oc_mutex_unlock(details->list_lock);
+
+        task->func(task->data);
+        OICFree(task);
+
+        oc_mutex_lock(details->list_lock);
+    }
+    oc_mutex_unlock(details->list_lock);
     return NULL;
 }
 
-// this implementation doesn't do a thread pool, so this function is essentially
-// a no-op besides creating a valid ca_thread_pool_t object.  It was determined after
-// reading through the existing implementation that the thread-pooling was unnecessary
-// for the posix platforms.  Behavior shouldn't be changed since previously num_of_threads
-// was greater than the number of requested threads.
+// start one more worker. The caller must hold list_lock.
+static CAResult_t ca_thread_pool_start_worker(ca_thread_pool_details_t* details)
+{
+    ca_thread_pool_thread_info_t *threadInfo =
+            (ca_thread_pool_thread_info_t *) OICCalloc(1, sizeof(ca_thread_pool_thread_info_t));
+    if (!threadInfo)
+    {
+        OIC_LOG(ERROR, TAG, "Memory allocation failed");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+
+    if (!u_arraylist_add(details->threads_list, (void*) threadInfo))
+    {
+        OIC_LOG(ERROR, TAG, "Arraylist add failed");
+        OICFree(threadInfo);
+        return CA_STATUS_FAILED;
+    }
+
+    int thrRet = oc_thread_new(&threadInfo->thread, ca_thread_pool_worker, details);
+    if (thrRet != 0)
+    {
+        size_t index = 0;
+        if (u_arraylist_get_index(details->threads_list, threadInfo, &index))
+        {
+            u_arraylist_remove(details->threads_list, index);
+        }
+        OIC_LOG_V(ERROR, TAG, "Thread start failed with error %d", thrRet);
+        OICFree(threadInfo);
+        return CA_STATUS_FAILED;
+    }
+
+    details->stats.thread_count++;
+    return CA_STATUS_OK;
+}
+
+// stop every worker once the queue is empty and release the pool.
+static void ca_thread_pool_stop(ca_thread_pool_t thread_pool)
+{
+    ca_thread_pool_details_t* details = thread_pool->details;
+
+    oc_mutex_lock(details->list_lock);
+    details->stopping = true;
+    oc_cond_broadcast(details->task_cond);
+    oc_mutex_unlock(details->list_lock);
+
+    // workers need list_lock to finish, and no worker is added once stopping is set.
+    for (size_t i = 0; i < u_arraylist_length(details->threads_list); ++i)
+    {
+        ca_thread_pool_thread_info_t *threadInfo = (ca_thread_pool_thread_info_t *)
+                u_arraylist_get(details->threads_list, i);
+        if (threadInfo)
+        {
+            if (threadInfo->thread)
+            {
+                oc_thread_wait(threadInfo->thread);
+                oc_thread_free(threadInfo->thread);
+            }
+            OICFree(threadInfo);
+        }
+    }
+
+    u_arraylist_free(&(details->threads_list));
+    oc_cond_free(details->task_cond);
+    oc_mutex_free(details->list_lock);
+
+    OICFree(details);
+    OICFree(thread_pool);
+}
+
 CAResult_t ca_thread_pool_init(int32_t num_of_threads, ca_thread_pool_t *thread_pool)
 {
     OIC_LOG(DEBUG, TAG, "IN");
@@ -104,7 +214,7 @@ CAResult_t ca_thread_pool_init(int32_t num_of_threads, ca_thread_pool_t *thread_
         return CA_MEMORY_ALLOC_FAILED;
     }
 
-    (*thread_pool)->details = OICMalloc(sizeof(struct ca_thread_pool_details_t));
+    (*thread_pool)->details = OICCalloc(1, sizeof(struct ca_thread_pool_details_t));
     if(!(*thread_pool)->details)
     {
         OIC_LOG(ERROR, TAG, "Failed to allocate for thread-pool details");
@@ -113,34 +223,38 @@ CAResult_t ca_thread_pool_init(int32_t num_of_threads, ca_thread_pool_t *thread_
         return CA_MEMORY_ALLOC_FAILED;
     }
 
-    (*thread_pool)->details->list_lock = oc_mutex_new();
+    ca_thread_pool_details_t* details = (*thread_pool)->details;
+    details->list_lock = oc_mutex_new();
+    details->task_cond = oc_cond_new();
+    details->threads_list = u_arraylist_create();
 
-    if(!(*thread_pool)->details->list_lock)
+    if(!details->list_lock || !details->task_cond || !details->threads_list)
     {
-        OIC_LOG(ERROR, TAG, "Failed to create thread-pool mutex");
-        goto exit;
+        OIC_LOG(ERROR, TAG, "Failed to create thread-pool mutex, condition or list");
+        oc_mutex_free(details->list_lock);
+        oc_cond_free(details->task_cond);
+        u_arraylist_free(&details->threads_list);
+        OICFree(details);
+        OICFree(*thread_pool);
+        *thread_pool = NULL;
+        return CA_STATUS_FAILED;
     }
 
-    (*thread_pool)->details->threads_list = u_arraylist_create();
-
-    if(!(*thread_pool)->details->threads_list)
+    oc_mutex_lock(details->list_lock);
+    for (int32_t i = 0; i < num_of_threads; ++i)
     {
-        OIC_LOG(ERROR, TAG, "Failed to create thread-pool list");
-        if(!oc_mutex_free((*thread_pool)->details->list_lock))
+        if (CA_STATUS_OK != ca_thread_pool_start_worker(details))
         {
-            OIC_LOG(ERROR, TAG, "Failed to free thread-pool mutex");
+            oc_mutex_unlock(details->list_lock);
+            ca_thread_pool_stop(*thread_pool);
+            *thread_pool = NULL;
+            return CA_STATUS_FAILED;
         }
-        goto exit;
     }
+    oc_mutex_unlock(details->list_lock);
 
     OIC_LOG(DEBUG, TAG, "OUT");
     return CA_STATUS_OK;
-
-exit:
-    OICFree((*thread_pool)->details);
-    OICFree(*thread_pool);
-    *thread_pool = NULL;
-    return CA_STATUS_FAILED;
 }
 
 CAResult_t ca_thread_pool_add_task(ca_thread_pool_t thread_pool, ca_thread_func method,
@@ -154,56 +268,75 @@ CAResult_t ca_thread_pool_add_task(ca_thread_pool_t thread_pool, ca_thread_func
         return CA_STATUS_INVALID_PARAM;
     }
 
-    ca_thread_pool_callback_info_t* info = OICMalloc(sizeof(ca_thread_pool_callback_info_t));
-    if(!info)
+    ca_thread_pool_task_t* task = OICCalloc(1, sizeof(ca_thread_pool_task_t));
+    if(!task)
     {
         OIC_LOG(ERROR, TAG, "Failed to allocate for memory wrapper");
         return CA_MEMORY_ALLOC_FAILED;
     }
 
-    info->func = method;
-    info->data = data;
+    task->func = method;
+    task->data = data;
+    task->queued_time = OICGetCurrentTime(TIME_IN_US);
 
-    ca_thread_pool_thread_info_t *threadInfo =
-            (ca_thread_pool_thread_info_t *) OICCalloc(1, sizeof(ca_thread_pool_thread_info_t));
-    if (!threadInfo)
+    ca_thread_pool_details_t* details = thread_pool->details;
+    oc_mutex_lock(details->list_lock);
+    if (details->stopping)
     {
-        OIC_LOG(ERROR, TAG, "Memory allocation failed");
-        OICFree(info);
+        oc_mutex_unlock(details->list_lock);
+        OIC_LOG(ERROR, TAG, "thread pool is being freed");
+        OICFree(task);
         return CA_STATUS_FAILED;
     }
 
-    oc_mutex_lock(thread_pool->details->list_lock);
-    bool addResult = u_arraylist_add(thread_pool->details->threads_list, (void*) threadInfo);
-    if (!addResult)
+    // Every queued task needs an idle worker of its own, a busy worker may never return.
+    if (details->idle_count <= details->stats.queue_depth)
     {
-        // Note that this is considered non-fatal.
-        oc_mutex_unlock(thread_pool->details->list_lock);
-        OIC_LOG(ERROR, TAG, "Arraylist add failed");
-        OICFree(info);
-        OICFree(threadInfo);
-        return CA_STATUS_FAILED;
+        CAResult_t res = ca_thread_pool_start_worker(details);
+        if (CA_STATUS_OK != res)
+        {
+            oc_mutex_unlock(details->list_lock);
+            OICFree(task);
+            return res;
+        }
     }
 
-    int thrRet = oc_thread_new(&threadInfo->thread, ca_thread_pool_pthreads_delegate, info);
-    if (thrRet != 0)
+    if (details->queue_tail)
     {
-        size_t index = 0;
-        if (u_arraylist_get_index(thread_pool->details->threads_list, threadInfo, &index))
-        {
-            u_arraylist_remove(thread_pool->details->threads_list, index);
-        }
-        oc_mutex_unlock(thread_pool->details->list_lock);
-        OIC_LOG_V(ERROR, TAG, "Thread start failed with error %d", thrRet);
-        OICFree(info);
-        return CA_STATUS_FAILED;
+        details->queue_tail->next = task;
     }
-    oc_mutex_unlock(thread_pool->details->list_lock);
+    else
+    {
+        details->queue_head = task;
+    }
+    details->queue_tail = task;
+    details->stats.queue_depth++;
+    if (details->stats.queue_depth > details->stats.max_queue_depth)
+    {
+        details->stats.max_queue_depth = details->stats.queue_depth;
+    }
+    oc_cond_signal(details->task_cond);
+    oc_mutex_unlock(details->list_lock);
 
     OIC_LOG(DEBUG, TAG, "OUT");
     return CA_STATUS_OK;
 }
 
+CAResult_t ca_thread_pool_get_stats(ca_thread_pool_t thread_pool, ca_thread_pool_stats_t *stats)
+{
+    if(NULL == thread_pool || NULL == stats)
+    {
+        OIC_LOG(ERROR, TAG, "thread_pool or stats was NULL");
+        return CA_STATUS_INVALID_PARAM;
+    }
+
+    oc_mutex_lock(thread_pool->details->list_lock);
+    *stats = thread_pool->details->stats;
+    stats->idle_count = thread_pool->details->idle_count;
+    oc_mutex_unlock(thread_pool->details->list_lock);
+    return CA_STATUS_OK;
+}
+
 void ca_thread_pool_free(ca_thread_pool_t thread_pool)
 {
     OIC_LOG(DEBUG, TAG, "IN");
@@ -214,30 +347,7 @@ void ca_thread_pool_free(ca_thread_pool_t thread_pool)
         return;
     }
 
-    oc_mutex_lock(thread_pool->details->list_lock);
-
-    for (size_t i = 0; i < u_arraylist_length(thread_pool->details->threads_list); ++i)
-    {
-        ca_thread_pool_thread_info_t *threadInfo = (ca_thread_pool_thread_info_t *)
-                u_arraylist_get(thread_pool->details->threads_list, i);
-        if (threadInfo)
-        {
-            if (threadInfo->thread)
-            {
-                oc_thread_wait(threadInfo->thread);
-                oc_thread_free(threadInfo->thread);
-            }
-            OICFree(threadInfo);
-        }
-    }
-
-    u_arraylist_free(&(thread_pool->details->threads_list));
-
-    oc_mutex_unlock(thread_pool->details->list_lock);
-    oc_mutex_free(thread_pool->details->list_lock);
-
-    OICFree(thread_pool->details);
-    OICFree(thread_pool);
+    ca_thread_pool_stop(thread_pool);
 
     OIC_LOG(DEBUG, TAG, "OUT");
 }
@@ -212,6 +212,28 @@ bool SetCASecureEndpointAttribute(const CAEndpoint_t* peer, uint32_t newAttribut
  */
 bool GetCASecureEndpointAttributes(const CAEndpoint_t* peer, uint32_t* allAttributes);
 
+/**
+ * Drops the PKIX info parsed for handshakes and the sessions kept for resumption.
+ * The next handshakes get the PKIX info from the callback again and are full handshakes.
+ */
+void CAsslInvalidateCredentials(void);
+
+/**
+ * Handshake counters of the SSL adapter, kept since the adapter was initialized.
+ */
+typedef struct
+{
+    uint64_t full;          /**< Handshakes that negotiated a new session. */
+    uint64_t resumed;       /**< Handshakes that resumed a session by its ID or a ticket. */
+} CASslHandshakeStats_t;
+
+/**
+ * Get the handshake counters of the SSL adapter.
+ *
+ * @param[out] stats    Counters, zero if the adapter is not initialized.
+ */
+void CAsslGetHandshakeStats(CASslHandshakeStats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
@@ -35,6 +35,7 @@
 #include "cacommon.h"
 #include "caprotocolmessage.h"
 #include "camessagehandler.h"
+#include "ochashtable.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -53,6 +54,8 @@ typedef void (*CASendThreadFunc)(CAData_t *data);
  */
 typedef void (*CAReceiveThreadFunc)(CAData_t *data);
 
+typedef struct CABlockData CABlockData_t;
+
 /**
  * context of blockwise transfer.
  */
@@ -64,8 +67,11 @@ typedef struct
     /** callback function for received message. **/
     CAReceiveThreadFunc receivedThreadFunc;
 
-    /** array list on which the thread is operating. **/
-    u_arraylist_t *dataList;
+    /** callback function for blocks delivered as they are received. **/
+    CABlockDataCallback blockDataCallback;
+
+    /** block data keyed by ::CABlockData_t::blockDataId. **/
+    OCHashTable dataTable;
 
     /** data list mutex for synchronization. **/
     oc_mutex blockDataListMutex;
@@ -92,7 +98,7 @@ typedef struct
 /**
  * Block Data Set.
  */
-typedef struct
+struct CABlockData
 {
     coap_block_t block1;                /**< block1 option. */
     coap_block_t block2;                /**< block2 option. */
@@ -102,7 +108,17 @@ typedef struct
     CAPayload_t payload;                /**< payload buffer. */
     size_t payloadLength;               /**< the total payload length to be received. */
     size_t receivedPayloadLen;          /**< currently received payload length. */
-} CABlockData_t;
+    size_t payloadCapacity;             /**< allocated length of the payload buffer. */
+    bool streamed;                      /**< received blocks go to blockDataCallback. */
+    bool delivered;                     /**< received payload went to the upper layer. */
+    uint32_t bertBlocks;                /**< 1Kbyte blocks in a sent BERT message (TCP). */
+    uint8_t *blockMap;                  /**< Q-Block: blocks received, or blocks to send. */
+    uint32_t blockMapSize;              /**< Q-Block: number of blocks blockMap can hold. */
+    uint32_t blockCount;                /**< Q-Block: number of blocks of the body, 0 if unknown. */
+    uint32_t nextSet;                   /**< Q-Block: first block of the next set to send. */
+    uint64_t lastActive;                /**< time of the last block, in milliseconds. */
+    OCHashLink link;                    /**< link into ::CABlockWiseContext_t::dataTable. */
+};
 
 /**
  * state of received block message from remote endpoint.
@@ -158,6 +174,12 @@ CAResult_t CAInitBlockWiseMutexVariables();
  */
 void CATerminateBlockWiseMutexVariables();
 
+/**
+ * Set the callback for blocks delivered as they are received.
+ * @param[in]   blockDataCallback   callback, or NULL to reassemble every transfer.
+ */
+void CASetBlockDataCallback(CABlockDataCallback blockDataCallback);
+
 /**
  * Pass the bulk data. if block-wise transfer process need,
  *          bulk data will be sent to block messages.
@@ -320,6 +342,23 @@ CAResult_t CASetMoreBitFromBlock(size_t payloadLen, coap_block_t *block);
 CAResult_t CAAddBlockOption(coap_pdu_t **pdu, const CAInfo_t *info,
                             const CAEndpoint_t *endpoint, coap_list_t **options);
 
+#ifdef WITH_TCP
+/**
+ * generate a CoAP over TCP pdu with the block options of its block-wise transfer.
+ * The length of such a message is in its header, so the block options and the part of
+ * the payload for the block are put in the pdu when it is generated.
+ * @param[in]   code        code of the pdu packet.
+ * @param[in]   info        information of the request/response.
+ * @param[in]   endpoint    endpoint information.
+ * @param[in]   options     option list, released by the caller.
+ * @param[out]  transport   CoAP over TCP header type of the generated pdu.
+ * @return  generated pdu.
+ */
+coap_pdu_t *CAGenerateBlockPDU(uint32_t code, const CAInfo_t *info,
+                               const CAEndpoint_t *endpoint, coap_list_t **options,
+                               coap_transport_t *transport);
+#endif
+
 /**
  * Write the block option2 in pdu binary data.
  * @param[out]  pdu   pdu object.
@@ -624,6 +663,45 @@ CAResult_t CARemoveAllBlockMulticastDataFromList();
  */
 CAResult_t CARemoveBlockMulticastDataFromListWithSeed(const CAToken_t token, uint8_t tokenLength);
 
+/**
+ * Encode the numbers of the missing blocks that a 4.08 response to Q-Block1 lists, as a
+ * CBOR sequence of unsigned integers.
+ * @param[in]   nums        numbers of the missing blocks.
+ * @param[in]   count       number of missing blocks.
+ * @param[out]  buf         buffer of at least 5 bytes per missing block.
+ * @return length of the encoded list.
+ */
+size_t CAEncodeMissingQBlocks(const uint32_t *nums, size_t count, uint8_t *buf);
+
+/**
+ * Decode the numbers of the missing blocks listed in a 4.08 response to Q-Block1.
+ * @param[in]   buf         payload of the response.
+ * @param[in]   length      length of the payload.
+ * @param[out]  nums        numbers of the missing blocks.
+ * @param[in]   max         number of entries nums can hold.
+ * @return number of missing blocks decoded, the decoding stops at a malformed entry.
+ */
+size_t CADecodeMissingQBlocks(const uint8_t *buf, size_t length, uint32_t *nums, size_t max);
+
+/**
+ * Send the blocks of a Q-Block1 request again that a 4.08 response lists as missing, or
+ * the next set if none is listed.
+ * @param[in]   pdu         received 4.08 response.
+ * @param[in]   blockID     ID set of the block data.
+ * @return ::CASTATUS_OK or ERROR CODES (::CAResult_t error codes in cacommon.h).
+ */
+CAResult_t CAResendMissingQBlocks(coap_pdu_t *pdu, const CABlockDataID_t *blockID);
+
+/**
+ * Send a request again without Q-Block after the remote endpoint answered 4.02 Bad Option.
+ * The endpoint is remembered not to support Q-Block.
+ * @param[in]   blockID     ID set of the block data.
+ * @param[in]   endpoint    remote endpoint that refused Q-Block.
+ * @return ::CASTATUS_OK, ::CA_NOT_SUPPORTED if the request did not use Q-Block or
+ *         ERROR CODES (::CAResult_t error codes in cacommon.h).
+ */
+CAResult_t CAFallBackFromQBlock(const CABlockDataID_t *blockID, const CAEndpoint_t *endpoint);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
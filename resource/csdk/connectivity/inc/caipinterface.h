@@ -150,6 +150,27 @@ void CAIPSendData(CAEndpoint_t *endpoint,
                   size_t dataLength,
                   bool isMulticast);
 
+/**
+ * Send UDP data like CAIPSendData(), but where the platform supports it, only copy the
+ * datagrams into a batch that CAIPFlushSendData() writes with a few system calls.
+ * Must only be called from the adapter's send thread.
+ *
+ * @param[in]  endpoint          complete network address to send to.
+ * @param[in]  data              Data to be send.
+ * @param[in]  dataLength        Length of data in bytes.
+ * @param[in]  isMulticast       Whether data needs to be sent to multicast ip.
+ */
+void CAIPBatchSendData(CAEndpoint_t *endpoint,
+                       const void *data,
+                       size_t dataLength,
+                       bool isMulticast);
+
+/**
+ * Send every datagram batched by CAIPBatchSendData(). Must only be called from the
+ * adapter's send thread.
+ */
+void CAIPFlushSendData();
+
 /**
  * Get IP adapter connection state.
  *
@@ -185,6 +206,27 @@ void CAWakeUpForChange();
  */
 void CAIPSetErrorHandler(CAIPErrorHandleCallback errorHandleCallback);
 
+/**
+ * Receive counters of the IP server, kept since the process started.
+ */
+typedef struct
+{
+    uint64_t datagrams;     /**< Datagrams read from the sockets. */
+    uint64_t batches;       /**< Receive calls that returned at least one datagram. */
+    uint64_t fullBatches;   /**< Batches that filled every receive buffer. */
+    uint64_t maxBatchSize;  /**< Most datagrams returned by one receive call. */
+    uint64_t drops;         /**< Datagrams the kernel dropped because a socket buffer was full.
+                                 Only reported where SO_RXQ_OVFL is available. */
+    uint64_t truncated;     /**< Datagrams cut to the size of the receive buffer. */
+} CAIPReceiveStats_t;
+
+/**
+ * Get the receive counters of the IP server.
+ *
+ * @param[out] stats    Counters.
+ */
+void CAIPGetReceiveStats(CAIPReceiveStats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -91,6 +91,25 @@ void CATerminateMessageHandler();
  */
 void CAHandleRequestResponseCallbacks();
 
+/**
+ * Get the descriptor that becomes readable when CAHandleRequestResponseCallbacks() has work.
+ * @return  file descriptor, or -1 where the platform has none or in single thread model.
+ */
+int CAGetReceiveWakeupFd();
+
+/**
+ * Wake up a caller blocked in CAWaitReceiveWakeup() or polling the wakeup descriptor.
+ */
+void CASignalReceiveWakeup();
+
+/**
+ * Block until CAHandleRequestResponseCallbacks() has work or the timeout passes.
+ * Returns immediately in single thread model, where the adapters are read by the handler.
+ * @param[in] timeoutMs   timeout in milliseconds, UINT32_MAX to wait without limit.
+ * @return  true if woken up, false on timeout.
+ */
+bool CAWaitReceiveWakeup(uint32_t timeoutMs);
+
 /**
  * Setting the Callback funtion for network state change callback.
  * @param[in] nwMonitorHandler    callback for network state change.
@@ -52,8 +52,29 @@ typedef uint32_t code_t;
 
 #ifdef WITH_TCP
 static const uint8_t PAYLOAD_MARKER = 1;
+
+/** Code of the CoAP over TCP signaling message announcing the capabilities of a peer (7.01).*/
+#define CA_SIGNALING_CSM 701
+
+/** CSM option with the largest message the sender can receive.*/
+#define CA_OPTION_MAX_MESSAGE_SIZE 2
+
+/** CSM option telling that the sender supports BERT block-wise transfer.*/
+#define CA_OPTION_BLOCK_WISE_TRANSFER 4
+
+/** Max-Message-Size of a peer that has not announced one (RFC 8323).*/
+#define CA_DEFAULT_MAX_MESSAGE_SIZE 1152
 #endif
 
+/** Q-Block1 option, Block1 for blocks sent without waiting for each other (RFC 9177).*/
+#define CA_OPTION_Q_BLOCK1 19
+
+/** Q-Block2 option, Block2 for blocks sent without waiting for each other (RFC 9177).*/
+#define CA_OPTION_Q_BLOCK2 31
+
+/** Content-Format of the missing block numbers carried by a 4.08 response to Q-Block1.*/
+#define CA_FORMAT_MISSING_BLOCKS 272
+
 /**
  * generates pdu structure from the given information.
  * @param[in]   code                 code of the pdu packet.
@@ -106,6 +127,19 @@ coap_pdu_t *CAGeneratePDUImpl(code_t code, const CAInfo_t *info,
                               const CAEndpoint_t *endpoint, coap_list_t *options,
                               coap_transport_t *transport);
 
+/**
+ * add a part of the payload of the information to the pdu.
+ * The part is taken from the payload or, if the payload is produced when it is sent,
+ * asked for from the payload producer.
+ * @param[in,out]   pdu              pdu to add the part to.
+ * @param[in]       info             information with the payload.
+ * @param[in]       offset           offset of the part in the payload.
+ * @param[in]       length           length of the part.
+ * @return  CA_STATUS_OK or ERROR CODES (CAResult_t error codes in cacommon.h).
+ */
+CAResult_t CAAddPayloadToPDU(coap_pdu_t *pdu, const CAInfo_t *info, size_t offset,
+                             size_t length);
+
 /**
  * parse the URI and creates the options.
  * @param[in]    uriInfo             uri information.
@@ -275,6 +309,37 @@ CAPayloadFormat_t CAConvertFormat(uint16_t format);
  * @return true or false.
  */
 bool CAIsSupportedCoAPOverTCP(CATransportAdapter_t adapter);
+
+/**
+ * check whether CoAP over TCP binary data is a signaling message (code class 7).
+ * @param[in]   pdu                 pdu data.
+ * @param[in]   size                size of pdu data.
+ * @return true or false.
+ */
+bool CAIsSignalingMessage(const void *pdu, size_t size);
+
+/**
+ * generates a Capabilities and Settings Message (CSM).
+ * @param[in]   maxMessageSize      largest message this side can receive.
+ * @param[in]   blockWiseTransfer   whether this side supports BERT block-wise transfer.
+ * @param[out]  transport           CoAP over TCP header type of the generated pdu.
+ * @return  generated pdu.
+ */
+coap_pdu_t *CAGenerateCSMPDU(uint32_t maxMessageSize, bool blockWiseTransfer,
+                             coap_transport_t *transport);
+
+/**
+ * extracts the capabilities of a peer from a received CSM.
+ * Capabilities missing from the message are left as they are.
+ * @param[in]   pdu                 pdu data.
+ * @param[in]   size                size of pdu data.
+ * @param[out]  maxMessageSize      largest message the peer can receive.
+ * @param[out]  blockWiseTransfer   whether the peer supports BERT block-wise transfer.
+ * @return  ::CA_STATUS_OK, ::CA_NOT_SUPPORTED if the message is not a CSM or
+ *          ERROR CODES (CAResult_t error codes in cacommon.h).
+ */
+CAResult_t CAParseCSM(const void *pdu, size_t size, uint32_t *maxMessageSize,
+                      bool *blockWiseTransfer);
 #endif
 
 #ifdef WITH_BWT
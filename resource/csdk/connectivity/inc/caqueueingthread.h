@@ -44,6 +44,9 @@ typedef void (*CAThreadTask)(void *threadData);
 /** Data destroy function. **/
 typedef void (*CADataDestroyFunction)(void *data, uint32_t size);
 
+/** Function to be invoked when the queue runs empty. **/
+typedef void (*CAThreadIdleTask)();
+
 typedef struct
 {
     /** Thread pool of the thread started. **/
@@ -56,6 +59,8 @@ typedef struct
     CAThreadTask threadTask;
     /** Data destroy function. **/
     CADataDestroyFunction destroy;
+    /** Function to be invoked when the queue runs empty, may be NULL. **/
+    CAThreadIdleTask idleTask;
     /** Variable to inform the thread to stop. **/
     bool isStop;
     /** Que on which the thread is operating. **/
@@ -73,6 +78,16 @@ typedef struct
 CAResult_t CAQueueingThreadInitialize(CAQueueingThread_t *thread, ca_thread_pool_t handle,
                                       CAThreadTask task, CADataDestroyFunction destroy);
 
+/**
+ * Set a function the thread calls each time it has emptied the queue, before it waits for
+ * more data, and once more before it stops. This lets the thread task defer work, such as
+ * flushing a batch of sends, until no more data is waiting.
+ * @param[in]   thread       thread data of the thread.
+ * @param[in]   idleTask     function to be called, or NULL.
+ * @return  CA_STATUS_OK or ERROR CODES (CAResult_t error codes in cacommon.h).
+ */
+CAResult_t CAQueueingThreadSetIdleTask(CAQueueingThread_t *thread, CAThreadIdleTask idleTask);
+
 /**
  * Start the queuing thread.
  * @param[in]   thread        thread data that needs to be started.
@@ -32,6 +32,7 @@
 #include "octhread.h"
 #include "uarraylist.h"
 #include "cacommon.h"
+#include "ochashtable.h"
 
 /** IP, EDR, LE. **/
 #define DEFAULT_RETRANSMISSION_TYPE (CA_ADAPTER_IP | \
@@ -44,9 +45,6 @@
 /** default max retransmission trying count is 4(CoAP). **/
 #define DEFAULT_RETRANSMISSION_COUNT      4
 
-/** check period is 1 sec. **/
-#define RETRANSMISSION_CHECK_PERIOD_SEC     1
-
 /** retransmission data send method type. **/
 typedef CAResult_t (*CADataSendMethod_t)(const CAEndpoint_t *endpoint,
                                          const void *pdu,
@@ -58,6 +56,9 @@ typedef void (*CATimeoutCallback_t)(const CAEndpoint_t *endpoint,
                                     const void *pdu,
                                     uint32_t size);
 
+/** CON message waiting for its ACK; defined in caretransmission.c. **/
+typedef struct CARetransmissionData CARetransmissionData_t;
+
 typedef struct
 {
     /** retransmission support transport type. **/
@@ -91,8 +92,17 @@ typedef struct
     /** Variable to inform the thread to stop. **/
     bool isStop;
 
-    /** array list on which the thread is operating. **/
-    u_arraylist_t *dataList;
+    /** number of CON messages waiting for their ACK. **/
+    size_t dataCount;
+
+    /** binary min-heap of the waiting messages, ordered by next retransmission time. **/
+    CARetransmissionData_t **dataHeap;
+
+    /** allocated size of dataHeap. **/
+    size_t dataHeapCapacity;
+
+    /** waiting messages hashed by message id and adapter, for matching ACK and RST. **/
+    OCHashTable dataIndex;
 
 } CARetransmission_t;
 
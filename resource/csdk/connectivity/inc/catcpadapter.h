@@ -29,6 +29,7 @@
 #include "caadapterinterface.h"
 #include "cathreadpool.h"
 #include "cainterface.h"
+#include "ochashtable.h"
 #include <coap/pdu.h>
 
 #ifdef __cplusplus
@@ -54,6 +55,16 @@ typedef enum
     DISCONNECTED
 } CATCPConnectionState_t;
 
+/**
+ * Data given to a session before its connection is established.
+ */
+typedef struct CATCPPendingData_t
+{
+    void *data;                             /**< copy of the data to send */
+    size_t len;                             /**< length of data */
+    struct CATCPPendingData_t *next;        /**< next data queued for the same session */
+} CATCPPendingData_t;
+
 /**
  * TCP Session Information for IPv4/IPv6 TCP transport
  */
@@ -69,7 +80,15 @@ typedef struct CATCPSessionInfo_t
     CAProtocol_t protocol;              /**< application-level protocol */
     CATCPConnectionState_t state;       /**< current tcp session state */
     bool isClient;                      /**< Host Mode of Operation. */
+    CATCPPendingData_t *pendingData;    /**< data to send once the connection is established */
+    uint64_t connectDeadline;           /**< time in ms at which connecting gives up, 0 if not connecting */
+    uint32_t peerMaxMessageSize;        /**< Max-Message-Size from the CSM of the peer */
+    bool peerBlockWiseTransfer;         /**< the peer supports BERT block-wise transfer */
+    bool peerCSMReceived;               /**< the CSM of the peer has been received */
+    bool csmSent;                       /**< our CSM has been sent */
     struct CATCPSessionInfo_t *next;    /**< Linked list; for multiple session list. */
+    OCHashLink endpointLink;            /**< link into the index of sessions by endpoint */
+    OCHashLink fdLink;                  /**< link into the index of sessions by socket */
 } CATCPSessionInfo_t;
 
 /**
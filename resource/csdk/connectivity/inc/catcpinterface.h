@@ -213,6 +213,43 @@ size_t CAGetTotalLengthFromHeader(const unsigned char *recvBuffer);
  */
 CASocketFd_t CAGetSocketFDFromEndpoint(const CAEndpoint_t *endpoint);
 
+/**
+ * Get the capabilities the peer of a session announced in its CSM.
+ *
+ * @param[in]   endpoint            remote endpoint information.
+ * @param[out]  maxMessageSize      largest message the peer can receive.
+ * @param[out]  blockWiseTransfer   whether the peer supports BERT block-wise transfer.
+ * @return  true if the CSM of the peer has been received, false otherwise.
+ */
+bool CAGetTCPPeerCapabilities(const CAEndpoint_t *endpoint, uint32_t *maxMessageSize,
+                              bool *blockWiseTransfer);
+
+/**
+ * Keep the capabilities the peer of a session announced in its CSM.
+ *
+ * @param[in]   endpoint            remote endpoint information.
+ * @param[in]   maxMessageSize      largest message the peer can receive.
+ * @param[in]   blockWiseTransfer   whether the peer supports BERT block-wise transfer.
+ * @return  true if our CSM has been sent on the session already, false otherwise.
+ */
+bool CASetTCPPeerCapabilities(const CAEndpoint_t *endpoint, uint32_t maxMessageSize,
+                              bool blockWiseTransfer);
+
+/**
+ * Check whether our CSM has been sent on the session with endpoint.
+ *
+ * @param[in]   endpoint    remote endpoint information.
+ * @return  true if it has been sent, false if not or if there is no session.
+ */
+bool CAIsTCPSessionCSMSent(const CAEndpoint_t *endpoint);
+
+/**
+ * Mark our CSM as sent on the session with endpoint.
+ *
+ * @param[in]   endpoint    remote endpoint information.
+ */
+void CASetTCPSessionCSMSent(const CAEndpoint_t *endpoint);
+
 /**
  * Find the session with endpoint info and remove it from list.
  *
@@ -33,6 +33,7 @@
 #include "cacommon.h"
 #include "caipinterface.h"
 #include "oic_malloc.h"
+#include "ochashtable.h"
 #include "experimental/ocrandom.h"
 #include "experimental/byte_array.h"
 #include "octhread.h"
@@ -47,6 +48,8 @@
 #include "mbedtls/ssl_internal.h"
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/oid.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
 #ifdef __WITH_DTLS__
 #include "mbedtls/timing.h"
 #include "mbedtls/ssl_cookie.h"
@@ -176,6 +179,30 @@
  */
 #define RETRANSMISSION_TIME 1
 
+/**
+ * @def SSL_PEER_TABLE_SIZE
+ * @brief Initial number of buckets of the peer table. Must be a power of two.
+ */
+#define SSL_PEER_TABLE_SIZE (16)
+
+/**
+ * @def SSL_SESSION_LIFETIME
+ * @brief Seconds for which a session can be resumed, by its ID or by a ticket.
+ */
+#define SSL_SESSION_LIFETIME (3600)
+
+/**
+ * @def SSL_SESSION_CACHE_SIZE
+ * @brief Number of sessions kept for resumption on the server side and on the client side.
+ */
+#define SSL_SESSION_CACHE_SIZE (32)
+
+/**
+ * @def SSL_SESSION_IDENTITIES
+ * @brief Number of peer identities kept for resumed sessions, see SslSessionIdentity_t.
+ */
+#define SSL_SESSION_IDENTITIES (64)
+
 /**@def SSL_CLOSE_NOTIFY(peer, ret)
  *
  * Notifies of existing \a peer about closing TLS connection.
@@ -353,13 +380,37 @@ typedef struct TlsCallBacks
     CAErrorHandleCallback errorCallback;    /**< Callback used to pass error to upper layer. */
 } SslCallbacks_t;
 
+/**
+ * Session kept by the client side to resume it on the next connection to the same server.
+ */
+typedef struct SslSavedSession
+{
+    CAEndpoint_t endpoint;           /**< server address, compared as by GetSslPeer(). */
+    mbedtls_ssl_session session;     /**< session, with the ticket if the server sent one. */
+    uint64_t lastUse;                /**< value of SslContext_t::sessionUse, 0 if unused. */
+    bool valid;
+} SslSavedSession_t;
+
+/**
+ * Identity of the peer of a resumable session. A resumed handshake skips the PSK callback,
+ * so the identity found by the full handshake is kept here, keyed by the master secret
+ * which the session keeps across resumptions. A session whose identity was evicted is
+ * not resumed, the handshake falls back to a full one.
+ */
+typedef struct SslSessionIdentity
+{
+    uint8_t master[MASTER_SECRET_LEN];
+    CARemoteId_t identity;
+    uint64_t lastUse;                /**< value of SslContext_t::sessionUse, 0 if unused. */
+} SslSessionIdentity_t;
+
 /**
  * Data structure for holding the mbedTLS interface related info.
  */
 typedef struct SslContext
 {
-    u_arraylist_t *peerList;         /**< peer list which holds the mapping between
-                                              peer id, it's n/w address and mbedTLS context. */
+    OCHashTable peers;               /**< peer table which holds the mapping between
+                                              peer's n/w address and mbedTLS context. */
     mbedtls_entropy_context entropy;
     mbedtls_ctr_drbg_context rnd;
     mbedtls_x509_crt ca;
@@ -377,6 +428,20 @@ typedef struct SslContext
     bool cipherFlag[2];
     int selectedCipher;
 
+    bool pkixLoaded;                 /**< ca, crt, pkey and crl hold the SRM credentials. */
+    int pkixResult;                  /**< result of InitPKIX() for the loaded credentials. */
+    bool pkixOwnCert;                /**< crt and pkey were parsed. */
+    bool pkixCrl;                    /**< crl was parsed. */
+    bool pkixConfigured[2];          /**< loaded credentials are set on the DTLS [0] and
+                                          TLS [1] configurations. */
+
+    mbedtls_ssl_cache_context sessionCache;  /**< sessions the server resumes by ID. */
+    mbedtls_ssl_ticket_context ticketCtx;    /**< keys of the tickets the server issues. */
+    SslSavedSession_t savedSessions[SSL_SESSION_CACHE_SIZE];
+    SslSessionIdentity_t sessionIdentities[SSL_SESSION_IDENTITIES];
+    uint64_t sessionUse;             /**< counter ordering the uses of the two above. */
+    CASslHandshakeStats_t handshakeStats;
+
 #ifdef __WITH_DTLS__
     mbedtls_ssl_cookie_ctx cookieCtx;
     int timerId;
@@ -413,6 +478,25 @@ static CAgetPkixInfoHandler g_getPkixInfoCallback = NULL;
  */
 static oc_mutex g_sslContextMutex = NULL;
 
+/**
+ * @var g_sslCryptoMutex
+ * @brief Mutex to synchronize access to the random generator and the cookie context.
+ *
+ * These are shared by all peers and are also used by record reads and writes, which run
+ * outside g_sslContextMutex. Nothing else is locked while this mutex is held.
+ */
+static oc_mutex g_sslCryptoMutex = NULL;
+
+/**
+ * @var g_sslPeerHolds
+ * @brief Number of record operations holding a peer, over all peers.
+ *
+ * Guarded by g_sslContextMutex. CAdeinitSslAdapter() waits on g_sslPeersReleased until it
+ * drops to zero, as the holders still use the peers, the configurations and the mutexes.
+ */
+static uint32_t g_sslPeerHolds = 0;
+static oc_cond g_sslPeersReleased = NULL;
+
 /**
  * @var g_sslCallback
  * @brief callback to deliver the TLS handshake result
@@ -438,6 +522,10 @@ typedef struct SslRecBuf
 /**
  * Data structure for holding the data related to endpoint
  * and TLS session.
+ *
+ * Handshakes run under g_sslContextMutex. Once the handshake is over, records are read
+ * and written under recordMutex only, so that different peers are served in parallel.
+ * No lock but g_sslCryptoMutex is taken while recordMutex is held.
  */
 typedef struct SslEndPoint
 {
@@ -450,6 +538,13 @@ typedef struct SslEndPoint
 #ifdef __WITH_DTLS__
     mbedtls_timing_delay_context timer;
 #endif // __WITH_DTLS__
+    oc_mutex recordMutex;            /**< Serializes record reads and writes. */
+    bool resumed;                    /**< The handshake resumed an earlier session. */
+    bool offeredSession;             /**< The client offered a saved session to resume. */
+    uint32_t refCount;               /**< Record operations holding the peer. */
+    bool removed;                    /**< Removed from the peer table, freed by the last holder. */
+    bool closeNotify;                /**< Send close_notify before freeing the removed peer. */
+    OCHashLink link;                 /**< Link into the peer table, see HashSslPeer(). */
 } SslEndPoint_t;
 
 void CAsetPskCredentialsCallback(CAgetPskCredentialsHandler credCallback)
@@ -464,6 +559,7 @@ void CAsetPkixInfoCallback(CAgetPkixInfoHandler infoCallback)
 {
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s", __func__);
     g_getPkixInfoCallback = infoCallback;
+    CAsslInvalidateCredentials();
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
 }
 
@@ -708,11 +804,28 @@ static void DeInitPkixInfo(PkiInfo_t * inf)
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
 }
 
+/**
+ * Removes the own certificates set on a configuration. mbedtls_ssl_conf_own_cert() appends
+ * to them on every call.
+ *
+ * @param[in,out]  conf    client/server config to be updated
+ */
+static void ClearOwnCert(mbedtls_ssl_config * conf)
+{
+    mbedtls_ssl_key_cert * keyCert = conf->key_cert;
+    while (NULL != keyCert)
+    {
+        mbedtls_ssl_key_cert * next = keyCert->next;
+        mbedtls_free(keyCert);
+        keyCert = next;
+    }
+    conf->key_cert = NULL;
+}
+
 //Loads PKIX related information from SRM
-static int InitPKIX(CATransportAdapter_t adapter)
+static int LoadPKIX()
 {
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s", __func__);
-    VERIFY_NON_NULL_RET(g_getPkixInfoCallback, NET_SSL_TAG, "PKIX info callback is NULL", -1);
     // load pk key, cert, trust chain and crl
     PkiInfo_t pkiInfo = {
         BYTE_ARRAY_INITIALIZER,
@@ -726,8 +839,6 @@ static int InitPKIX(CATransportAdapter_t adapter)
         g_getPkixInfoCallback(&pkiInfo);
     }
 
-    VERIFY_NON_NULL_RET(g_caSslContext, NET_SSL_TAG, "SSL Context is NULL", -1);
-
     mbedtls_x509_crt_free(&g_caSslContext->ca);
     mbedtls_x509_crt_free(&g_caSslContext->crt);
     mbedtls_pk_free(&g_caSslContext->pkey);
@@ -738,12 +849,9 @@ static int InitPKIX(CATransportAdapter_t adapter)
     mbedtls_pk_init(&g_caSslContext->pkey);
     mbedtls_x509_crl_init(&g_caSslContext->crl);
 
-    mbedtls_ssl_config * serverConf = (adapter == CA_ADAPTER_IP ||
-                                   adapter == CA_ADAPTER_GATT_BTLE ?
-                                   &g_caSslContext->serverDtlsConf : &g_caSslContext->serverTlsConf);
-    mbedtls_ssl_config * clientConf = (adapter == CA_ADAPTER_IP ||
-                                   adapter == CA_ADAPTER_GATT_BTLE ?
-                                   &g_caSslContext->clientDtlsConf : &g_caSslContext->clientTlsConf);
+    g_caSslContext->pkixOwnCert = false;
+    g_caSslContext->pkixCrl = false;
+
     // optional
     int ret;
     int errNum;
@@ -765,35 +873,7 @@ static int InitPKIX(CATransportAdapter_t adapter)
         OIC_LOG(WARNING, NET_SSL_TAG, "Key parsing error");
         goto required;
     }
-
-    ret = mbedtls_ssl_conf_own_cert(serverConf, &g_caSslContext->crt, &g_caSslContext->pkey);
-    if (0 != ret)
-    {
-        OIC_LOG(WARNING, NET_SSL_TAG, "Own certificate parsing error");
-        goto required;
-    }
-    ret = mbedtls_ssl_conf_own_cert(clientConf, &g_caSslContext->crt, &g_caSslContext->pkey);
-    if(0 != ret)
-    {
-        OIC_LOG(WARNING, NET_SSL_TAG, "Own certificate configuration error");
-        goto required;
-    }
-
-    /* If we get here, certificates could be used, so configure OCF EKUs. */
-    ret = mbedtls_ssl_conf_ekus(serverConf, (const char*)EKU_IDENTITY, sizeof(EKU_IDENTITY),
-        (const char*)EKU_IDENTITY, sizeof(EKU_IDENTITY));
-    if (0 == ret)
-    {
-        ret = mbedtls_ssl_conf_ekus(clientConf, (const char*)EKU_IDENTITY, sizeof(EKU_IDENTITY),
-            (const char*)EKU_IDENTITY, sizeof(EKU_IDENTITY));
-    }
-    if (0 != ret)
-    {
-        /* Cert-based ciphersuites will fail, but if PSK ciphersuites are in
-         * the list they might work, so don't return error.
-         */
-        OIC_LOG(WARNING, NET_SSL_TAG, "EKU configuration error");
-    }
+    g_caSslContext->pkixOwnCert = true;
 
     required:
     count = ParseChain(&g_caSslContext->ca, pkiInfo.ca.data, pkiInfo.ca.len, &errNum);
@@ -813,12 +893,10 @@ static int InitPKIX(CATransportAdapter_t adapter)
     if(0 != ret)
     {
         OIC_LOG(WARNING, NET_SSL_TAG, "CRL parsing error");
-        CONF_SSL(clientConf, serverConf, mbedtls_ssl_conf_ca_chain, &g_caSslContext->ca, NULL);
     }
     else
     {
-        CONF_SSL(clientConf, serverConf, mbedtls_ssl_conf_ca_chain,
-                 &g_caSslContext->ca, &g_caSslContext->crl);
+        g_caSslContext->pkixCrl = true;
     }
 
     DeInitPkixInfo(&pkiInfo);
@@ -827,6 +905,91 @@ static int InitPKIX(CATransportAdapter_t adapter)
     return 0;
 }
 
+//Sets the PKIX information loaded by LoadPKIX() on a pair of client and server configs
+static void ConfigurePKIX(mbedtls_ssl_config * clientConf, mbedtls_ssl_config * serverConf)
+{
+    OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s", __func__);
+    ClearOwnCert(serverConf);
+    ClearOwnCert(clientConf);
+
+    if (g_caSslContext->pkixOwnCert)
+    {
+        int ret = mbedtls_ssl_conf_own_cert(serverConf, &g_caSslContext->crt,
+                                            &g_caSslContext->pkey);
+        if (0 != ret)
+        {
+            OIC_LOG(WARNING, NET_SSL_TAG, "Own certificate parsing error");
+            goto required;
+        }
+        ret = mbedtls_ssl_conf_own_cert(clientConf, &g_caSslContext->crt, &g_caSslContext->pkey);
+        if(0 != ret)
+        {
+            OIC_LOG(WARNING, NET_SSL_TAG, "Own certificate configuration error");
+            goto required;
+        }
+
+        /* If we get here, certificates could be used, so configure OCF EKUs. */
+        ret = mbedtls_ssl_conf_ekus(serverConf, (const char*)EKU_IDENTITY, sizeof(EKU_IDENTITY),
+            (const char*)EKU_IDENTITY, sizeof(EKU_IDENTITY));
+        if (0 == ret)
+        {
+            ret = mbedtls_ssl_conf_ekus(clientConf, (const char*)EKU_IDENTITY, sizeof(EKU_IDENTITY),
+                (const char*)EKU_IDENTITY, sizeof(EKU_IDENTITY));
+        }
+        if (0 != ret)
+        {
+            /* Cert-based ciphersuites will fail, but if PSK ciphersuites are in
+             * the list they might work, so don't return error.
+             */
+            OIC_LOG(WARNING, NET_SSL_TAG, "EKU configuration error");
+        }
+    }
+
+    required:
+    if (0 == g_caSslContext->pkixResult)
+    {
+        CONF_SSL(clientConf, serverConf, mbedtls_ssl_conf_ca_chain, &g_caSslContext->ca,
+                 g_caSslContext->pkixCrl ? &g_caSslContext->crl : NULL);
+    }
+    OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+}
+
+//Loads PKIX related information from SRM, unless it is loaded already, and sets it on the
+//DTLS or TLS configs
+static int InitPKIX(CATransportAdapter_t adapter)
+{
+    OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s", __func__);
+    VERIFY_NON_NULL_RET(g_getPkixInfoCallback, NET_SSL_TAG, "PKIX info callback is NULL", -1);
+    VERIFY_NON_NULL_RET(g_caSslContext, NET_SSL_TAG, "SSL Context is NULL", -1);
+
+    // Parsing the credentials is the costly part of a handshake. They are loaded again
+    // only after CAsslInvalidateCredentials().
+    if (!g_caSslContext->pkixLoaded)
+    {
+        g_caSslContext->pkixResult = LoadPKIX();
+        g_caSslContext->pkixLoaded = true;
+        g_caSslContext->pkixConfigured[0] = false;
+        g_caSslContext->pkixConfigured[1] = false;
+    }
+
+    bool isDtls = (adapter == CA_ADAPTER_IP || adapter == CA_ADAPTER_GATT_BTLE);
+    if (!g_caSslContext->pkixConfigured[isDtls ? 0 : 1])
+    {
+        if (isDtls)
+        {
+            ConfigurePKIX(&g_caSslContext->clientDtlsConf, &g_caSslContext->serverDtlsConf);
+        }
+        else
+        {
+            ConfigurePKIX(&g_caSslContext->clientTlsConf, &g_caSslContext->serverTlsConf);
+        }
+        g_caSslContext->pkixConfigured[isDtls ? 0 : 1] = true;
+    }
+
+    OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+    return g_caSslContext->pkixResult;
+}
+
 /*
  * PSK callback.
  *
@@ -868,6 +1031,58 @@ static int GetPskCredentialsCallback(void * notUsed, mbedtls_ssl_context * ssl,
     OIC_LOG_V(WARNING, NET_SSL_TAG, "Out %s", __func__);
     return -1;
 }
+/**
+ * Hashes the endpoint fields compared by GetSslPeer().
+ * The port is left out for BLE, where GetSslPeer() ignores it.
+ *
+ * @param[in]  peer    remote address
+ *
+ * @return  hash of the endpoint
+ */
+static uint32_t HashSslPeer(const CAEndpoint_t *peer)
+{
+    uint8_t adapter = (uint8_t)peer->adapter;
+    uint32_t hash = OCHashBytes(OC_HASH_INIT, &adapter, sizeof(adapter));
+    hash = OCHashBytes(hash, peer->addr, strnlen(peer->addr, MAX_ADDR_STR_SIZE_CA));
+    if (CA_ADAPTER_GATT_BTLE != peer->adapter)
+    {
+        hash = OCHashBytes(hash, &peer->port, sizeof(peer->port));
+    }
+    return hash;
+}
+
+/**
+ * Adds endpoint session to the peer table.
+ *
+ * @param[in]  tep    endpoint with session info
+ *
+ * @return  true on success, false if out of memory
+ */
+static bool AddPeerToList(SslEndPoint_t * tep)
+{
+    oc_mutex_assert_owner(g_sslContextMutex, true);
+
+    VERIFY_NON_NULL_RET(g_caSslContext, NET_SSL_TAG, "SSL Context is NULL", false);
+
+    return OCHashTableInsert(&g_caSslContext->peers, &tep->link,
+                             HashSslPeer(&tep->sep.endpoint));
+}
+
+/**
+ * Compares the endpoint fields which identify a peer. The port is ignored for BLE.
+ *
+ * @param[in]  peer        remote address
+ * @param[in]  endpoint    address of a session
+ *
+ * @return  true if both address the same peer
+ */
+static bool IsSameSslPeer(const CAEndpoint_t *peer, const CAEndpoint_t *endpoint)
+{
+    return (peer->adapter == endpoint->adapter)
+            && (0 == strncmp(peer->addr, endpoint->addr, MAX_ADDR_STR_SIZE_CA))
+            && (peer->port == endpoint->port || CA_ADAPTER_GATT_BTLE == peer->adapter);
+}
+
 /**
  * Gets session corresponding for endpoint.
  *
@@ -877,8 +1092,6 @@ static int GetPskCredentialsCallback(void * notUsed, mbedtls_ssl_context * ssl,
  */
 static SslEndPoint_t *GetSslPeer(const CAEndpoint_t *peer)
 {
-    size_t listIndex = 0;
-    size_t listLength = 0;
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s", __func__);
 
     oc_mutex_assert_owner(g_sslContextMutex, true);
@@ -886,23 +1099,15 @@ static SslEndPoint_t *GetSslPeer(const CAEndpoint_t *peer)
     VERIFY_NON_NULL_RET(peer, NET_SSL_TAG, "TLS peer is NULL", NULL);
     VERIFY_NON_NULL_RET(g_caSslContext, NET_SSL_TAG, "SSL Context is NULL", NULL);
 
-    SslEndPoint_t *tep = NULL;
-    listLength = u_arraylist_length(g_caSslContext->peerList);
-    for (listIndex = 0; listIndex < listLength; listIndex++)
+    for (OCHashLink *link = OCHashTableFirst(&g_caSslContext->peers, HashSslPeer(peer));
+         NULL != link; link = OCHashTableNext(link))
     {
-        tep = (SslEndPoint_t *) u_arraylist_get(g_caSslContext->peerList, listIndex);
-        if (NULL == tep)
-        {
-            continue;
-        }
-
+        SslEndPoint_t *tep = OC_HASH_ENTRY(link, SslEndPoint_t, link);
         OIC_LOG_V(DEBUG, NET_SSL_TAG, "Compare [%s:%d] and [%s:%d] for %d adapter",
                   peer->addr, peer->port, tep->sep.endpoint.addr, tep->sep.endpoint.port,
                   peer->adapter);
 
-        if((peer->adapter == tep->sep.endpoint.adapter)
-                && (0 == strncmp(peer->addr, tep->sep.endpoint.addr, MAX_ADDR_STR_SIZE_CA))
-                && (peer->port == tep->sep.endpoint.port || CA_ADAPTER_GATT_BTLE == peer->adapter))
+        if (IsSameSslPeer(peer, &tep->sep.endpoint))
         {
             OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
             return tep;
@@ -913,6 +1118,288 @@ static SslEndPoint_t *GetSslPeer(const CAEndpoint_t *peer)
     return NULL;
 }
 
+/**
+ * Gets the session saved for resuming it with a server.
+ *
+ * @param[in]  server    remote address
+ *
+ * @return  saved session or NULL
+ */
+static SslSavedSession_t *GetSavedSession(const CAEndpoint_t *server)
+{
+    oc_mutex_assert_owner(g_sslContextMutex, true);
+
+    for (size_t i = 0; i < SSL_SESSION_CACHE_SIZE; i++)
+    {
+        SslSavedSession_t *saved = &g_caSslContext->savedSessions[i];
+        if (saved->valid && IsSameSslPeer(server, &saved->endpoint))
+        {
+            return saved;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Frees a saved session.
+ *
+ * @param[in]  saved    saved session or NULL
+ */
+static void DropSavedSession(SslSavedSession_t *saved)
+{
+    if (NULL != saved && saved->valid)
+    {
+        mbedtls_ssl_session_free(&saved->session);
+        saved->valid = false;
+        saved->lastUse = 0;
+    }
+}
+
+/**
+ * Saves the session of a client whose handshake is over, in place of the session saved
+ * for the same server or else of the least recently used one.
+ *
+ * @param[in]  tep    endpoint with session info
+ */
+static void SaveSession(SslEndPoint_t *tep)
+{
+    SslSavedSession_t *saved = GetSavedSession(&tep->sep.endpoint);
+    if (NULL == saved)
+    {
+        // Unused sessions have the lowest lastUse, 0.
+        saved = &g_caSslContext->savedSessions[0];
+        for (size_t i = 1; i < SSL_SESSION_CACHE_SIZE; i++)
+        {
+            if (g_caSslContext->savedSessions[i].lastUse < saved->lastUse)
+            {
+                saved = &g_caSslContext->savedSessions[i];
+            }
+        }
+    }
+
+    DropSavedSession(saved);
+    mbedtls_ssl_session_init(&saved->session);
+    if (0 != mbedtls_ssl_get_session(&tep->ssl, &saved->session))
+    {
+        OIC_LOG(WARNING, NET_SSL_TAG, "Session could not be saved");
+        mbedtls_ssl_session_free(&saved->session);
+        return;
+    }
+    saved->endpoint = tep->sep.endpoint;
+    saved->lastUse = ++g_caSslContext->sessionUse;
+    saved->valid = true;
+}
+
+/**
+ * Finds the identity kept for the peer of a session.
+ *
+ * @param[in]  master   master secret of the session
+ *
+ * @return  the identity entry, or NULL if it was never kept or was evicted since
+ */
+static SslSessionIdentity_t *FindSessionIdentity(const unsigned char *master)
+{
+    for (size_t i = 0; i < SSL_SESSION_IDENTITIES; i++)
+    {
+        SslSessionIdentity_t *entry = &g_caSslContext->sessionIdentities[i];
+        if (0 != entry->lastUse && 0 == memcmp(entry->master, master, sizeof(entry->master)))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Offers the session saved for the server to the handshake about to start. A session
+ * whose ciphersuite is not configured any more would fail the handshake, it is dropped.
+ *
+ * @param[in]  tep    client endpoint with session info
+ */
+static void ResumeSavedSession(SslEndPoint_t *tep)
+{
+    SslSavedSession_t *saved = GetSavedSession(&tep->sep.endpoint);
+    if (NULL == saved)
+    {
+        return;
+    }
+    if (NULL == FindSessionIdentity(saved->session.master))
+    {
+        // The resumed handshake could not restore the identity of the server.
+        OIC_LOG(DEBUG, NET_SSL_TAG, "Identity of saved session evicted, session dropped");
+        DropSavedSession(saved);
+        return;
+    }
+
+    const int *ciphersuites = tep->ssl.conf->ciphersuite_list[MBEDTLS_SSL_MINOR_VERSION_3];
+    while (0 != *ciphersuites && saved->session.ciphersuite != *ciphersuites)
+    {
+        ciphersuites++;
+    }
+    if (0 == *ciphersuites || 0 != mbedtls_ssl_set_session(&tep->ssl, &saved->session))
+    {
+        OIC_LOG(DEBUG, NET_SSL_TAG, "Saved session dropped");
+        DropSavedSession(saved);
+        return;
+    }
+    saved->lastUse = ++g_caSslContext->sessionUse;
+    tep->offeredSession = true;
+    OIC_LOG(DEBUG, NET_SSL_TAG, "Resuming saved session");
+}
+
+/**
+ * Keeps the identity of the peer found by a full handshake, in place of the least recently
+ * used identity, for resuming the session.
+ *
+ * @param[in]  tep    endpoint with session info
+ */
+static void SaveSessionIdentity(const SslEndPoint_t *tep)
+{
+    SslSessionIdentity_t *entry = &g_caSslContext->sessionIdentities[0];
+    for (size_t i = 1; i < SSL_SESSION_IDENTITIES; i++)
+    {
+        if (g_caSslContext->sessionIdentities[i].lastUse < entry->lastUse)
+        {
+            entry = &g_caSslContext->sessionIdentities[i];
+        }
+    }
+    memcpy(entry->master, tep->master, sizeof(entry->master));
+    entry->identity = tep->sep.identity;
+    entry->lastUse = ++g_caSslContext->sessionUse;
+}
+
+/**
+ * Sets the identity of the peer of a resumed session to the one found by the full
+ * handshake of the session.
+ *
+ * @param[in,out]  tep    endpoint with session info
+ *
+ * @return  true if the identity was kept, false otherwise
+ */
+static bool RestoreSessionIdentity(SslEndPoint_t *tep)
+{
+    SslSessionIdentity_t *entry = FindSessionIdentity(tep->master);
+    if (NULL == entry)
+    {
+        return false;
+    }
+    tep->sep.identity = entry->identity;
+    entry->lastUse = ++g_caSslContext->sessionUse;
+    return true;
+}
+
+/**
+ * Looks a session up in the server's session cache, for a client resuming it by its ID.
+ * A session whose identity was evicted is not found, so the handshake is a full one.
+ *
+ * @param[in]      data     session cache
+ * @param[in,out]  session  session with the ID to look up, filled in when found
+ *
+ * @return  0 if the session is resumed, 1 otherwise
+ */
+static int GetCachedSession(void *data, mbedtls_ssl_session *session)
+{
+    int ret = mbedtls_ssl_cache_get(data, session);
+    if (0 == ret && NULL == FindSessionIdentity(session->master))
+    {
+        OIC_LOG(DEBUG, NET_SSL_TAG, "Identity of cached session evicted, full handshake");
+        // The full handshake must not see the cached session's secret or certificate.
+        memset(session->master, 0, sizeof(session->master));
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+        if (NULL != session->peer_cert)
+        {
+            mbedtls_x509_crt_free(session->peer_cert);
+            mbedtls_free(session->peer_cert);
+            session->peer_cert = NULL;
+        }
+#endif
+        return 1;
+    }
+    return ret;
+}
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+/**
+ * Parses a session ticket sent by a client resuming its session. A session whose identity
+ * was evicted is refused like an expired ticket, so the handshake is a full one.
+ *
+ * @param[in]   ticketCtx   ticket keys
+ * @param[out]  session     session of the ticket
+ * @param[in]   buf         ticket
+ * @param[in]   len         length of the ticket
+ *
+ * @return  0 if the session is resumed, an mbedTLS error otherwise
+ */
+static int ParseSessionTicket(void *ticketCtx, mbedtls_ssl_session *session,
+                              unsigned char *buf, size_t len)
+{
+    int ret = mbedtls_ssl_ticket_parse(ticketCtx, session, buf, len);
+    if (0 == ret && NULL == FindSessionIdentity(session->master))
+    {
+        OIC_LOG(DEBUG, NET_SSL_TAG, "Identity of ticket session evicted, full handshake");
+        return MBEDTLS_ERR_SSL_SESSION_TICKET_EXPIRED;
+    }
+    return ret;
+}
+#endif
+
+/**
+ * Counts a handshake which is over and keeps what resuming its session needs: the identity
+ * of the peer, and on the client side the session itself. For a resumed session the
+ * identity of the peer is restored.
+ *
+ * @param[in,out]  tep    endpoint with session info
+ *
+ * @return  0 on success, -1 if the identity of the peer of a resumed session is unknown
+ */
+static int FinishHandshake(SslEndPoint_t *tep)
+{
+    oc_mutex_assert_owner(g_sslContextMutex, true);
+
+    bool isClient = (MBEDTLS_SSL_IS_CLIENT == tep->ssl.conf->endpoint);
+    if (tep->resumed)
+    {
+        g_caSslContext->handshakeStats.resumed++;
+        if (!RestoreSessionIdentity(tep))
+        {
+            if (isClient)
+            {
+                DropSavedSession(GetSavedSession(&tep->sep.endpoint));
+            }
+            return -1;
+        }
+    }
+    else
+    {
+        g_caSslContext->handshakeStats.full++;
+        SaveSessionIdentity(tep);
+    }
+
+    // Saved again after a resumption too, the server may have sent a new ticket.
+    if (isClient)
+    {
+        SaveSession(tep);
+    }
+    return 0;
+}
+
+/**
+ * Forgets the sessions and identities kept for resumption. Tickets issued by the server
+ * are not accepted after the ticket keys are freed.
+ */
+static void FreeResumption()
+{
+    mbedtls_ssl_cache_free(&g_caSslContext->sessionCache);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_ticket_free(&g_caSslContext->ticketCtx);
+#endif
+    for (size_t i = 0; i < SSL_SESSION_CACHE_SIZE; i++)
+    {
+        DropSavedSession(&g_caSslContext->savedSessions[i]);
+    }
+    memset(g_caSslContext->sessionIdentities, 0, sizeof(g_caSslContext->sessionIdentities));
+}
+
 /**
  * Gets a copy of CA secure endpoint info corresponding for endpoint.
  *
@@ -1102,36 +1589,118 @@ static void DeleteSslEndPoint(SslEndPoint_t * tep)
 
     mbedtls_ssl_free(&tep->ssl);
     DeleteCacheList(tep->cacheList);
+    if (NULL != tep->recordMutex)
+    {
+        oc_mutex_free(tep->recordMutex);
+    }
     OICFree(tep);
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
 }
 /**
- * Removes endpoint session from list.
+ * Removes endpoint session from the peer table and deletes it. If record operations
+ * still hold the session, the last of them deletes it in ReleaseSslPeer().
  *
- * @param[in]  endpoint    remote address
+ * @param[in]  tep          endpoint with session info
+ * @param[in]  closeNotify  whether to send close_notify before deleting the session
  */
-static void RemovePeerFromList(CAEndpoint_t * endpoint)
+static void RemoveSslPeer(SslEndPoint_t * tep, bool closeNotify)
 {
     oc_mutex_assert_owner(g_sslContextMutex, true);
 
-    VERIFY_NON_NULL_VOID(g_caSslContext, NET_SSL_TAG, "SSL Context is NULL");
-    VERIFY_NON_NULL_VOID(endpoint, NET_SSL_TAG, "endpoint");
+    VERIFY_NON_NULL_VOID(tep, NET_SSL_TAG, "tep");
 
-    size_t listLength = u_arraylist_length(g_caSslContext->peerList);
-    for (size_t listIndex = 0; listIndex < listLength; listIndex++)
+    if (!tep->removed)
     {
-        SslEndPoint_t * tep = (SslEndPoint_t *)u_arraylist_get(g_caSslContext->peerList, listIndex);
-        if (NULL == tep)
+        if (NULL != g_caSslContext)
         {
-            continue;
+            OCHashTableRemove(&g_caSslContext->peers, &tep->link);
+
+            // A saved session that failed to resume is not offered again.
+            if (tep->offeredSession && MBEDTLS_SSL_HANDSHAKE_OVER != tep->ssl.state)
+            {
+                OIC_LOG(DEBUG, NET_SSL_TAG, "Resumption failed, saved session dropped");
+                DropSavedSession(GetSavedSession(&tep->sep.endpoint));
+            }
         }
-        if(0 == strncmp(endpoint->addr, tep->sep.endpoint.addr, MAX_ADDR_STR_SIZE_CA)
-                && (endpoint->port == tep->sep.endpoint.port))
+        tep->removed = true;
+        tep->closeNotify = closeNotify;
+    }
+
+    if (0 == tep->refCount)
+    {
+        if (tep->closeNotify)
         {
-            u_arraylist_remove(g_caSslContext->peerList, listIndex);
-            DeleteSslEndPoint(tep);
-            return;
+            /* No error checking, the connection might be closed already */
+            int ret = 0;
+            SSL_CLOSE_NOTIFY(tep, ret);
+            OC_UNUSED(ret);
         }
+        DeleteSslEndPoint(tep);
+    }
+}
+/**
+ * Takes a hold of a record operation on endpoint session whose handshake is over, so that
+ * the session is not deleted while its records are read or written outside
+ * g_sslContextMutex.
+ *
+ * @param[in]  tep     endpoint with session info
+ */
+static void HoldSslPeer(SslEndPoint_t * tep)
+{
+    oc_mutex_assert_owner(g_sslContextMutex, true);
+
+    tep->refCount++;
+    g_sslPeerHolds++;
+}
+/**
+ * Like ReleaseSslPeer(), for a caller that holds g_sslContextMutex.
+ *
+ * @param[in]  tep     endpoint with session info
+ * @param[in]  remove  whether the record operation failed and the session is to be removed
+ */
+static void DropSslPeer(SslEndPoint_t * tep, bool remove)
+{
+    oc_mutex_assert_owner(g_sslContextMutex, true);
+
+    tep->refCount--;
+    if (remove || tep->removed)
+    {
+        RemoveSslPeer(tep, false);
+    }
+    if (0 == --g_sslPeerHolds && NULL != g_sslPeersReleased)
+    {
+        oc_cond_broadcast(g_sslPeersReleased);
+    }
+}
+/**
+ * Drops the hold of a record operation on endpoint session, taken under g_sslContextMutex
+ * once the handshake was over. Must be called without holding the session's recordMutex.
+ *
+ * @param[in]  tep     endpoint with session info
+ * @param[in]  remove  whether the record operation failed and the session is to be removed
+ */
+static void ReleaseSslPeer(SslEndPoint_t * tep, bool remove)
+{
+    oc_mutex_lock(g_sslContextMutex);
+    DropSslPeer(tep, remove);
+    oc_mutex_unlock(g_sslContextMutex);
+}
+/**
+ * Removes endpoint session from list.
+ *
+ * @param[in]  endpoint    remote address
+ */
+static void RemovePeerFromList(const CAEndpoint_t * endpoint)
+{
+    oc_mutex_assert_owner(g_sslContextMutex, true);
+
+    VERIFY_NON_NULL_VOID(g_caSslContext, NET_SSL_TAG, "SSL Context is NULL");
+    VERIFY_NON_NULL_VOID(endpoint, NET_SSL_TAG, "endpoint");
+
+    SslEndPoint_t * tep = GetSslPeer(endpoint);
+    if (NULL != tep)
+    {
+        RemoveSslPeer(tep, false);
     }
 }
 
@@ -1218,26 +1787,13 @@ static void DeletePeerList()
 
     VERIFY_NON_NULL_VOID(g_caSslContext, NET_SSL_TAG, "SSL Context is NULL");
 
-    size_t listLength = u_arraylist_length(g_caSslContext->peerList);
-    for (size_t listIndex = 0; listIndex < listLength; listIndex++)
+    OCHashLink *link = NULL;
+    while (NULL != (link = OCHashTableFirstEntry(&g_caSslContext->peers)))
     {
-        SslEndPoint_t * tep = (SslEndPoint_t *)u_arraylist_get(g_caSslContext->peerList, listIndex);
-        if (NULL == tep)
-        {
-            continue;
-        }
-        if (MBEDTLS_SSL_HANDSHAKE_OVER == tep->ssl.state)
-        {
-            int ret = 0;
-            do
-            {
-                ret = mbedtls_ssl_close_notify(&tep->ssl);
-            }
-            while (MBEDTLS_ERR_SSL_WANT_WRITE == ret);
-        }
-        DeleteSslEndPoint(tep);
+        SslEndPoint_t *tep = OC_HASH_ENTRY(link, SslEndPoint_t, link);
+        RemoveSslPeer(tep, MBEDTLS_SSL_HANDSHAKE_OVER == tep->ssl.state);
     }
-    u_arraylist_free(&g_caSslContext->peerList);
+    OCHashTableClear(&g_caSslContext->peers);
 }
 
 CAResult_t CAcloseSslConnection(const CAEndpoint_t *endpoint)
@@ -1259,15 +1815,7 @@ CAResult_t CAcloseSslConnection(const CAEndpoint_t *endpoint)
         oc_mutex_unlock(g_sslContextMutex);
         return CA_STATUS_FAILED;
     }
-    /* No error checking, the connection might be closed already */
-    int ret = 0;
-    do
-    {
-        ret = mbedtls_ssl_close_notify(&tep->ssl);
-    }
-    while (MBEDTLS_ERR_SSL_WANT_WRITE == ret);
-
-    RemovePeerFromList(&tep->sep.endpoint);
+    RemoveSslPeer(tep, true);
     oc_mutex_unlock(g_sslContextMutex);
 
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
@@ -1285,16 +1833,14 @@ void CAcloseSslConnectionAll(CATransportAdapter_t transportType)
         return;
     }
 
-    size_t listLength = u_arraylist_length(g_caSslContext->peerList);
-    OIC_LOG_V(DEBUG, NET_SSL_TAG,
-            "Required transport [%d], peer count [%" PRIuPTR "]", transportType, listLength);
-    for (size_t i = listLength; i > 0; i--)
+    OIC_LOG_V(DEBUG, NET_SSL_TAG, "Required transport [%d], peer count [%" PRIuPTR "]",
+              transportType, g_caSslContext->peers.count);
+    OCHashLink *next = NULL;
+    for (OCHashLink *link = OCHashTableFirstEntry(&g_caSslContext->peers); NULL != link;
+         link = next)
     {
-        SslEndPoint_t *tep = (SslEndPoint_t *)u_arraylist_get(g_caSslContext->peerList, i - 1);
-        if (NULL == tep)
-        {
-            continue;
-        }
+        next = OCHashTableNextEntry(&g_caSslContext->peers, link);
+        SslEndPoint_t *tep = OC_HASH_ENTRY(link, SslEndPoint_t, link);
         OIC_LOG_V(DEBUG, NET_SSL_TAG, "SSL Connection [%s:%d], Transport [%d]",
                   tep->sep.endpoint.addr, tep->sep.endpoint.port, tep->sep.endpoint.adapter);
 
@@ -1305,17 +1851,9 @@ void CAcloseSslConnectionAll(CATransportAdapter_t transportType)
             continue;
         }
 
-        // TODO: need to check below code after socket close is ensured.
-        /*int ret = 0;
-        do
-        {
-            ret = mbedtls_ssl_close_notify(&tep->ssl);
-        }
-        while (MBEDTLS_ERR_SSL_WANT_WRITE == ret);*/
-
+        // TODO: need to check close_notify after socket close is ensured.
         // delete from list
-        u_arraylist_remove(g_caSslContext->peerList, i - 1);
-        DeleteSslEndPoint(tep);
+        RemoveSslPeer(tep, false);
     }
     oc_mutex_unlock(g_sslContextMutex);
 
@@ -1383,6 +1921,14 @@ static SslEndPoint_t * NewSslEndPoint(const CAEndpoint_t * endpoint, mbedtls_ssl
         OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
         return NULL;
     }
+    tep->recordMutex = oc_mutex_new();
+    if (NULL == tep->recordMutex)
+    {
+        OIC_LOG(ERROR, NET_SSL_TAG, "recordMutex initialization failed!");
+        DeleteSslEndPoint(tep);
+        OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+        return NULL;
+    }
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "New [%s role] endpoint added [%s:%d]",
             (MBEDTLS_SSL_IS_SERVER==config->endpoint ? "server" : "client"),
             endpoint->addr, endpoint->port);
@@ -1555,14 +2101,14 @@ static SslEndPoint_t * InitiateTlsHandshake(const CAEndpoint_t *endpoint)
     }
 
     oc_mutex_lock(g_sslContextMutex);
-    ret = u_arraylist_add(g_caSslContext->peerList, (void *) tep);
-    if (!ret)
+    if (!AddPeerToList(tep))
     {
         oc_mutex_unlock(g_sslContextMutex);
-        OIC_LOG(ERROR, NET_SSL_TAG, "u_arraylist_add failed!");
+        OIC_LOG(ERROR, NET_SSL_TAG, "AddPeerToList failed!");
         DeleteSslEndPoint(tep);
         return NULL;
     }
+    ResumeSavedSession(tep);
 
     while (MBEDTLS_SSL_HANDSHAKE_OVER > tep->ssl.state)
     {
@@ -1574,10 +2120,11 @@ static SslEndPoint_t * InitiateTlsHandshake(const CAEndpoint_t *endpoint)
         else if (-1 == ret)
         {
             OIC_LOG(ERROR, NET_SSL_TAG, "Handshake failed due to socket error");
-            RemovePeerFromList(&tep->sep.endpoint);
+            RemoveSslPeer(tep, false);
             oc_mutex_unlock(g_sslContextMutex);
             return NULL;
         }
+        // On failure checkSslOperation() has already removed and deleted tep.
         if (!checkSslOperation(tep,
                                ret,
                                "Handshake error",
@@ -1585,7 +2132,6 @@ static SslEndPoint_t * InitiateTlsHandshake(const CAEndpoint_t *endpoint)
         {
             oc_mutex_unlock(g_sslContextMutex);
             OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
-            DeleteSslEndPoint(tep);
             return NULL;
         }
     }
@@ -1619,10 +2165,21 @@ void CAdeinitSslAdapter()
 
     // Clear all lists
     DeletePeerList();
+    FreeResumption();
+
+    // Record operations still running hold their peers, which DeletePeerList() could
+    // not free, and use the configurations and the mutexes freed below.
+    while (0 < g_sslPeerHolds)
+    {
+        OIC_LOG_V(DEBUG, NET_SSL_TAG, "Waiting for %u record operations", g_sslPeerHolds);
+        oc_cond_wait(g_sslPeersReleased, g_sslContextMutex);
+    }
 
     // De-initialize mbedTLS
+    mbedtls_x509_crt_free(&g_caSslContext->ca);
     mbedtls_x509_crt_free(&g_caSslContext->crt);
     mbedtls_pk_free(&g_caSslContext->pkey);
+    mbedtls_x509_crl_free(&g_caSslContext->crl);
 #ifdef __WITH_TLS__
     mbedtls_ssl_config_free(&g_caSslContext->clientTlsConf);
     mbedtls_ssl_config_free(&g_caSslContext->serverTlsConf);
@@ -1645,10 +2202,76 @@ void CAdeinitSslAdapter()
     oc_mutex_unlock(g_sslContextMutex);
     oc_mutex_free(g_sslContextMutex);
     g_sslContextMutex = NULL;
+    oc_mutex_free(g_sslCryptoMutex);
+    g_sslCryptoMutex = NULL;
+    oc_cond_free(g_sslPeersReleased);
+    g_sslPeersReleased = NULL;
 
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s ", __func__);
 }
 
+/**
+ * Random number generator of the SSL configurations. CBC records take their IV from it
+ * while they are written outside g_sslContextMutex.
+ */
+static int SslRandom(void * ctx, unsigned char * output, size_t len)
+{
+    oc_mutex_lock(g_sslCryptoMutex);
+    int ret = mbedtls_ctr_drbg_random(ctx, output, len);
+    oc_mutex_unlock(g_sslCryptoMutex);
+    return ret;
+}
+
+#ifdef __WITH_DTLS__
+/**
+ * Writes a DTLS cookie. mbedTLS also checks cookies of clients reconnecting from the
+ * same port while records are read outside g_sslContextMutex.
+ */
+static int SslCookieWrite(void * ctx, unsigned char ** p, unsigned char * end,
+                          const unsigned char * cliId, size_t cliIdLen)
+{
+    oc_mutex_lock(g_sslCryptoMutex);
+    int ret = mbedtls_ssl_cookie_write(ctx, p, end, cliId, cliIdLen);
+    oc_mutex_unlock(g_sslCryptoMutex);
+    return ret;
+}
+
+/**
+ * Checks a DTLS cookie, see SslCookieWrite().
+ */
+static int SslCookieCheck(void * ctx, const unsigned char * cookie, size_t cookieLen,
+                          const unsigned char * cliId, size_t cliIdLen)
+{
+    oc_mutex_lock(g_sslCryptoMutex);
+    int ret = mbedtls_ssl_cookie_check(ctx, cookie, cookieLen, cliId, cliIdLen);
+    oc_mutex_unlock(g_sslCryptoMutex);
+    return ret;
+}
+#endif // __WITH_DTLS__
+
+/**
+ * Sets up the session cache and the ticket keys of the server side.
+ *
+ * @return  0 on success or -1 on error
+ */
+static int InitResumption()
+{
+    mbedtls_ssl_cache_init(&g_caSslContext->sessionCache);
+    mbedtls_ssl_cache_set_timeout(&g_caSslContext->sessionCache, SSL_SESSION_LIFETIME);
+    mbedtls_ssl_cache_set_max_entries(&g_caSslContext->sessionCache, SSL_SESSION_CACHE_SIZE);
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_ticket_init(&g_caSslContext->ticketCtx);
+    if (0 != mbedtls_ssl_ticket_setup(&g_caSslContext->ticketCtx, SslRandom, &g_caSslContext->rnd,
+                                      MBEDTLS_CIPHER_AES_256_GCM, SSL_SESSION_LIFETIME))
+    {
+        OIC_LOG(ERROR, NET_SSL_TAG, "Ticket key setup failed!");
+        return -1;
+    }
+#endif
+    return 0;
+}
+
 static int InitConfig(mbedtls_ssl_config * conf, int transport, int mode)
 {
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s", __func__);
@@ -1666,7 +2289,7 @@ static int InitConfig(mbedtls_ssl_config * conf, int transport, int mode)
      * time, see extlibs/mbedtls/config-iotivity.h
      */
     mbedtls_ssl_conf_psk_cb(conf, GetPskCredentialsCallback, NULL);
-    mbedtls_ssl_conf_rng(conf, mbedtls_ctr_drbg_random, &g_caSslContext->rnd);
+    mbedtls_ssl_conf_rng(conf, SslRandom, &g_caSslContext->rnd);
     mbedtls_ssl_conf_curves(conf, curve[ADAPTER_CURVE_SECP256R1]);
     mbedtls_ssl_conf_authmode(conf, MBEDTLS_SSL_VERIFY_REQUIRED);
 
@@ -1674,11 +2297,25 @@ static int InitConfig(mbedtls_ssl_config * conf, int transport, int mode)
     if (MBEDTLS_SSL_TRANSPORT_DATAGRAM == transport &&
             MBEDTLS_SSL_IS_SERVER == mode)
     {
-        mbedtls_ssl_conf_dtls_cookies(conf, mbedtls_ssl_cookie_write, mbedtls_ssl_cookie_check,
+        mbedtls_ssl_conf_dtls_cookies(conf, SslCookieWrite, SslCookieCheck,
                                       &g_caSslContext->cookieCtx);
     }
 #endif // __WITH_DTLS__
 
+    /* Let clients resume their sessions, see InitResumption(). Clients resume the
+     * sessions saved by SaveSession().
+     */
+    if (MBEDTLS_SSL_IS_SERVER == mode)
+    {
+        mbedtls_ssl_conf_session_cache(conf, &g_caSslContext->sessionCache,
+                                       GetCachedSession, mbedtls_ssl_cache_set);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+        mbedtls_ssl_conf_session_tickets_cb(conf, mbedtls_ssl_ticket_write,
+                                            ParseSessionTicket,
+                                            &g_caSslContext->ticketCtx);
+#endif
+    }
+
     /* Set TLS 1.2 as the minimum allowed version. */
     mbedtls_ssl_conf_min_version(conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
 
@@ -1697,9 +2334,6 @@ static int InitConfig(mbedtls_ssl_config * conf, int transport, int mode)
  */
 static void StartRetransmit(void *ctx)
 {
-    size_t listIndex = 0;
-    size_t listLength = 0;
-    SslEndPoint_t *tep = NULL;
     OC_UNUSED(ctx);
 
     oc_mutex_lock(g_sslContextMutex);
@@ -1715,12 +2349,13 @@ static void StartRetransmit(void *ctx)
         //clear previous timer
         unregisterTimer(g_caSslContext->timerId);
 
-        listLength = u_arraylist_length(g_caSslContext->peerList);
-        for (listIndex = 0; listIndex < listLength; listIndex++)
+        OCHashLink *next = NULL;
+        for (OCHashLink *link = OCHashTableFirstEntry(&g_caSslContext->peers); NULL != link;
+             link = next)
         {
-            tep = (SslEndPoint_t *) u_arraylist_get(g_caSslContext->peerList, listIndex);
-            if (NULL == tep
-                || (tep->ssl.conf && MBEDTLS_SSL_TRANSPORT_STREAM == tep->ssl.conf->transport)
+            next = OCHashTableNextEntry(&g_caSslContext->peers, link);
+            SslEndPoint_t *tep = OC_HASH_ENTRY(link, SslEndPoint_t, link);
+            if ((tep->ssl.conf && MBEDTLS_SSL_TRANSPORT_STREAM == tep->ssl.conf->transport)
                 || MBEDTLS_SSL_HANDSHAKE_OVER == tep->ssl.state)
             {
                 continue;
@@ -1764,6 +2399,24 @@ CAResult_t CAinitSslAdapter()
         OIC_LOG(INFO, NET_SSL_TAG, "Done already!");
         return CA_STATUS_OK;
     }
+    g_sslCryptoMutex = oc_mutex_new();
+    if (NULL == g_sslCryptoMutex)
+    {
+        OIC_LOG(ERROR, NET_SSL_TAG, "oc_mutex_new failed");
+        oc_mutex_free(g_sslContextMutex);
+        g_sslContextMutex = NULL;
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+    g_sslPeersReleased = oc_cond_new();
+    if (NULL == g_sslPeersReleased)
+    {
+        OIC_LOG(ERROR, NET_SSL_TAG, "oc_cond_new failed");
+        oc_mutex_free(g_sslCryptoMutex);
+        g_sslCryptoMutex = NULL;
+        oc_mutex_free(g_sslContextMutex);
+        g_sslContextMutex = NULL;
+        return CA_MEMORY_ALLOC_FAILED;
+    }
 
     // Lock tlsContext mutex and create tlsContext
     oc_mutex_lock(g_sslContextMutex);
@@ -1775,22 +2428,15 @@ CAResult_t CAinitSslAdapter()
         oc_mutex_unlock(g_sslContextMutex);
         oc_mutex_free(g_sslContextMutex);
         g_sslContextMutex = NULL;
+        oc_mutex_free(g_sslCryptoMutex);
+        g_sslCryptoMutex = NULL;
+        oc_cond_free(g_sslPeersReleased);
+        g_sslPeersReleased = NULL;
         return CA_MEMORY_ALLOC_FAILED;
     }
 
-    // Create peer list
-    g_caSslContext->peerList = u_arraylist_create();
-
-    if(NULL == g_caSslContext->peerList)
-    {
-        OIC_LOG(ERROR, NET_SSL_TAG, "peerList initialization failed!");
-        OICFree(g_caSslContext);
-        g_caSslContext = NULL;
-        oc_mutex_unlock(g_sslContextMutex);
-        oc_mutex_free(g_sslContextMutex);
-        g_sslContextMutex = NULL;
-        return CA_STATUS_FAILED;
-    }
+    // Create peer table
+    OCHashTableInit(&g_caSslContext->peers, SSL_PEER_TABLE_SIZE);
 
     /* Initialize TLS library
      */
@@ -1820,6 +2466,14 @@ CAResult_t CAinitSslAdapter()
     }
     mbedtls_ctr_drbg_set_prediction_resistance(&g_caSslContext->rnd, MBEDTLS_CTR_DRBG_PR_ON);
 
+    if (0 != InitResumption())
+    {
+        oc_mutex_unlock(g_sslContextMutex);
+        CAdeinitSslAdapter();
+        OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+        return CA_STATUS_FAILED;
+    }
+
 #ifdef __WITH_TLS__
     if (0 != InitConfig(&g_caSslContext->clientTlsConf,
                         MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_IS_CLIENT))
@@ -1896,6 +2550,47 @@ CAResult_t CAinitSslAdapter()
     return CA_STATUS_OK;
 }
 
+void CAsslInvalidateCredentials(void)
+{
+    OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s", __func__);
+    if (NULL == g_sslContextMutex)
+    {
+        OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+        return;
+    }
+
+    oc_mutex_lock(g_sslContextMutex);
+    if (NULL != g_caSslContext)
+    {
+        g_caSslContext->pkixLoaded = false;
+        FreeResumption();
+        if (0 != InitResumption())
+        {
+            /* Without ticket keys the server does not issue tickets, handshakes still work. */
+            OIC_LOG(WARNING, NET_SSL_TAG, "Session tickets are disabled");
+        }
+    }
+    oc_mutex_unlock(g_sslContextMutex);
+    OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+}
+
+void CAsslGetHandshakeStats(CASslHandshakeStats_t *stats)
+{
+    VERIFY_NON_NULL_VOID(stats, NET_SSL_TAG, "stats is NULL");
+
+    memset(stats, 0, sizeof(*stats));
+    if (NULL == g_sslContextMutex)
+    {
+        return;
+    }
+    oc_mutex_lock(g_sslContextMutex);
+    if (NULL != g_caSslContext)
+    {
+        *stats = g_caSslContext->handshakeStats;
+    }
+    oc_mutex_unlock(g_sslContextMutex);
+}
+
 SslCacheMessage_t *NewCacheMessage(uint8_t * data, size_t dataLen)
 {
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s", __func__);
@@ -1928,13 +2623,96 @@ SslCacheMessage_t *NewCacheMessage(uint8_t * data, size_t dataLen)
     return message;
 }
 
+/**
+ * Queues data to be sent once the handshake with a peer is over.
+ *
+ * @param[in]  tep      remote address with session info
+ * @param[in]  data     data to be written
+ * @param[in]  dataLen  length of data
+ *
+ * @return  CA_STATUS_OK on success
+ */
+static CAResult_t CacheSslMessage(SslEndPoint_t * tep, const void * data, size_t dataLen)
+{
+    oc_mutex_assert_owner(g_sslContextMutex, true);
+
+    SslCacheMessage_t * msg = NewCacheMessage((uint8_t*) data, dataLen);
+    if (NULL == msg || !u_arraylist_add(tep->cacheList, (void *) msg))
+    {
+        OIC_LOG(ERROR, NET_SSL_TAG, "u_arraylist_add failed!");
+        if (NULL != msg)
+        {
+            DeleteCacheMessage(msg);
+        }
+        return CA_STATUS_FAILED;
+    }
+    return CA_STATUS_OK;
+}
+
+/**
+ * Writes data to a peer whose handshake is over. Only the peer's recordMutex is held
+ * while the records are encrypted, so that writes to different peers run in parallel.
+ *
+ * @param[in]  tep      remote address with session info, held by the caller
+ * @param[in]  data     data to be written
+ * @param[in]  dataLen  length of data
+ *
+ * @return  CA_STATUS_OK on success; the hold on tep is dropped in any case
+ */
+static CAResult_t WriteSslRecords(SslEndPoint_t * tep, const void * data, size_t dataLen)
+{
+    CAResult_t result = CA_STATUS_OK;
+    unsigned char *dataBuf = (unsigned char *)data;
+    size_t written = 0;
+
+    oc_mutex_lock(tep->recordMutex);
+    while (MBEDTLS_SSL_HANDSHAKE_OVER != tep->ssl.state)
+    {
+        // A record read restarted the handshake after the caller checked the state, so
+        // the data waits for the handshake like data sent before it was over.
+        oc_mutex_unlock(tep->recordMutex);
+        oc_mutex_lock(g_sslContextMutex);
+        if (!tep->removed && MBEDTLS_SSL_HANDSHAKE_OVER == tep->ssl.state)
+        {
+            // The handshake finished meanwhile and its cached messages went out already.
+            oc_mutex_unlock(g_sslContextMutex);
+            oc_mutex_lock(tep->recordMutex);
+            continue;
+        }
+        result = tep->removed ? CA_STATUS_FAILED : CacheSslMessage(tep, data, dataLen);
+        DropSslPeer(tep, false);
+        oc_mutex_unlock(g_sslContextMutex);
+        return result;
+    }
+    do
+    {
+        int ret = mbedtls_ssl_write(&tep->ssl, dataBuf, dataLen - written);
+        if (ret < 0)
+        {
+            if (MBEDTLS_ERR_SSL_WANT_WRITE != ret)
+            {
+                OIC_LOG_V(ERROR, NET_SSL_TAG, "mbedTLS write failed! returned 0x%x", -ret);
+                result = CA_STATUS_FAILED;
+                break;
+            }
+            continue;
+        }
+        OIC_LOG_V(DEBUG, NET_SSL_TAG, "mbedTLS write returned with sent bytes[%d]", ret);
+
+        dataBuf += ret;
+        written += ret;
+    } while (dataLen > written);
+    oc_mutex_unlock(tep->recordMutex);
+
+    ReleaseSslPeer(tep, CA_STATUS_OK != result);
+    return result;
+}
+
 /* Send data via TLS connection.
  */
 CAResult_t CAencryptSsl(const CAEndpoint_t *endpoint,
                         const void *data, size_t dataLen)
 {
-    int ret = 0;
-
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s ", __func__);
 
     VERIFY_NON_NULL_RET(endpoint, NET_SSL_TAG,"Remote address is NULL", CA_STATUS_INVALID_PARAM);
@@ -1971,39 +2749,17 @@ CAResult_t CAencryptSsl(const CAEndpoint_t *endpoint,
 
     if (MBEDTLS_SSL_HANDSHAKE_OVER == tep->ssl.state)
     {
-        unsigned char *dataBuf = (unsigned char *)data;
-        size_t written = 0;
-
-        do
-        {
-            ret = mbedtls_ssl_write(&tep->ssl, dataBuf, dataLen - written);
-            if (ret < 0)
-            {
-                if (MBEDTLS_ERR_SSL_WANT_WRITE != ret)
-                {
-                    OIC_LOG_V(ERROR, NET_SSL_TAG, "mbedTLS write failed! returned 0x%x", -ret);
-                    RemovePeerFromList(&tep->sep.endpoint);
-                    oc_mutex_unlock(g_sslContextMutex);
-                    return CA_STATUS_FAILED;
-                }
-                continue;
-            }
-            OIC_LOG_V(DEBUG, NET_SSL_TAG, "mbedTLS write returned with sent bytes[%d]", ret);
-
-            dataBuf += ret;
-            written += ret;
-        } while (dataLen > written);
+        HoldSslPeer(tep);
+        oc_mutex_unlock(g_sslContextMutex);
 
+        CAResult_t result = WriteSslRecords(tep, data, dataLen);
+        OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+        return result;
     }
-    else
+    else if (CA_STATUS_OK != CacheSslMessage(tep, data, dataLen))
     {
-        SslCacheMessage_t * msg = NewCacheMessage((uint8_t*) data, dataLen);
-        if (NULL == msg || !u_arraylist_add(tep->cacheList, (void *) msg))
-        {
-            OIC_LOG(ERROR, NET_SSL_TAG, "u_arraylist_add failed!");
-            oc_mutex_unlock(g_sslContextMutex);
-            return CA_STATUS_FAILED;
-        }
+        oc_mutex_unlock(g_sslContextMutex);
+        return CA_STATUS_FAILED;
     }
 
     oc_mutex_unlock(g_sslContextMutex);
@@ -2094,6 +2850,83 @@ static void SendCacheMessages(SslEndPoint_t * tep, CAResult_t errorCode)
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
 }
 
+/**
+ * Reads a record from a peer whose handshake is over and passes the data to the adapter.
+ * Only the peer's recordMutex is held while the record is decrypted, so that reads from
+ * different peers run in parallel.
+ *
+ * @param[in]  peer        remote address with session info, held by the caller
+ * @param[in]  data        received data
+ * @param[in]  dataLen     length of data
+ * @param[out] handshake   set if another read restarted the handshake after the caller
+ *                         checked the state; the record is then left to the handshake and
+ *                         the caller keeps its hold on peer
+ *
+ * @return  CA_STATUS_OK on success; unless @p handshake is set, the hold on peer is dropped
+ *          in any case
+ */
+static CAResult_t ReadSslRecord(SslEndPoint_t * peer, uint8_t * data, size_t dataLen,
+                                bool * handshake)
+{
+    int ret = 0;
+    uint8_t decryptBuffer[TLS_MSG_BUF_LEN];
+
+    oc_mutex_lock(peer->recordMutex);
+    *handshake = (MBEDTLS_SSL_HANDSHAKE_OVER != peer->ssl.state);
+    if (*handshake)
+    {
+        oc_mutex_unlock(peer->recordMutex);
+        return CA_STATUS_OK;
+    }
+    peer->recBuf.buff = data;
+    peer->recBuf.len = dataLen;
+    peer->recBuf.loaded = 0;
+    do
+    {
+        ret = mbedtls_ssl_read(&peer->ssl, decryptBuffer, TLS_MSG_BUF_LEN);
+    } while (MBEDTLS_ERR_SSL_WANT_READ == ret);
+
+    bool closed = (MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY == ret ||
+                   // TinyDTLS sends fatal close_notify alert
+                   (MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE == ret &&
+                    MBEDTLS_SSL_ALERT_LEVEL_FATAL == peer->ssl.in_msg[0] &&
+                    MBEDTLS_SSL_ALERT_MSG_CLOSE_NOTIFY == peer->ssl.in_msg[1]));
+    oc_mutex_unlock(peer->recordMutex);
+
+    if (closed)
+    {
+        OIC_LOG(INFO, NET_SSL_TAG, "Connection was closed gracefully");
+        ReleaseSslPeer(peer, true);
+        return CA_STATUS_OK;
+    }
+
+    // The callbacks are invoked without recordMutex, as they may write to the same peer.
+    int adapterIndex = GetAdapterIndex(peer->sep.endpoint.adapter);
+    if (adapterIndex >= 0)
+    {
+        if (0 > ret)
+        {
+            OIC_LOG_V(ERROR, NET_SSL_TAG, "mbedtls_ssl_read returned -0x%x", -ret);
+            g_caSslContext->adapterCallbacks[adapterIndex].errorCallback(&peer->sep.endpoint, data, dataLen, CA_STATUS_FAILED);
+            ReleaseSslPeer(peer, true);
+            return CA_STATUS_FAILED;
+        }
+        else if (0 < ret)
+        {
+            g_caSslContext->adapterCallbacks[adapterIndex].recvCallback(&peer->sep, decryptBuffer, ret);
+        }
+    }
+    else
+    {
+        OIC_LOG(ERROR, NET_SSL_TAG, "Unsuported adapter");
+        ReleaseSslPeer(peer, true);
+        return CA_STATUS_FAILED;
+    }
+
+    ReleaseSslPeer(peer, false);
+    return CA_STATUS_OK;
+}
+
 void CAsetSslHandshakeCallback(CAHandshakeErrorCallback tlsHandshakeCallback)
 {
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "In %s(%p)", __func__, tlsHandshakeCallback);
@@ -2144,16 +2977,40 @@ CAResult_t CAdecryptSsl(const CASecureEndpoint_t *sep, uint8_t *data, size_t dat
             return CA_STATUS_FAILED;
         }
 
-        ret = u_arraylist_add(g_caSslContext->peerList, (void *) peer);
-        if (!ret)
+        if (!AddPeerToList(peer))
         {
-            OIC_LOG(ERROR, NET_SSL_TAG, "u_arraylist_add failed!");
+            OIC_LOG(ERROR, NET_SSL_TAG, "AddPeerToList failed!");
             DeleteSslEndPoint(peer);
             oc_mutex_unlock(g_sslContextMutex);
             return CA_STATUS_FAILED;
         }
     }
 
+    if (MBEDTLS_SSL_HANDSHAKE_OVER == peer->ssl.state)
+    {
+        HoldSslPeer(peer);
+        oc_mutex_unlock(g_sslContextMutex);
+
+        bool handshake = false;
+        CAResult_t result = ReadSslRecord(peer, data, dataLen, &handshake);
+        if (!handshake)
+        {
+            OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+            return result;
+        }
+
+        // The record belongs to the handshake restarted since the state was checked above.
+        oc_mutex_lock(g_sslContextMutex);
+        bool removed = peer->removed || NULL == g_caSslContext;
+        DropSslPeer(peer, false);
+        if (removed)
+        {
+            OIC_LOG(ERROR, NET_SSL_TAG, "Session was removed");
+            oc_mutex_unlock(g_sslContextMutex);
+            return CA_STATUS_FAILED;
+        }
+    }
+
     peer->recBuf.buff = data;
     peer->recBuf.len = dataLen;
     peer->recBuf.loaded = 0;
@@ -2199,6 +3056,12 @@ CAResult_t CAdecryptSsl(const CASecureEndpoint_t *sep, uint8_t *data, size_t dat
             return CA_STATUS_FAILED;
         }
 
+        // The handshake parameters are freed when the handshake is over.
+        if (NULL != peer->ssl.handshake && peer->ssl.handshake->resume)
+        {
+            peer->resumed = true;
+        }
+
         if (MBEDTLS_SSL_CERTIFICATE_VERIFY == peer->ssl.state)
         {
             mbedtls_x509_crt *peerCert = peer->ssl.session_negotiate->peer_cert;
@@ -2227,6 +3090,16 @@ CAResult_t CAdecryptSsl(const CASecureEndpoint_t *sep, uint8_t *data, size_t dat
 
         if (MBEDTLS_SSL_HANDSHAKE_OVER == peer->ssl.state)
         {
+            if (!checkSslOperation(peer,
+                                   FinishHandshake(peer),
+                                   "Identity of resumed session not found",
+                                   MBEDTLS_SSL_ALERT_MSG_HANDSHAKE_FAILURE))
+            {
+                oc_mutex_unlock(g_sslContextMutex);
+                OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
+                return CA_STATUS_FAILED;
+            }
+
             CAResult_t result = notifySubscriber(peer, CA_STATUS_OK);
 
             if (MBEDTLS_SSL_IS_CLIENT == peer->ssl.conf->endpoint)
@@ -2365,51 +3238,6 @@ CAResult_t CAdecryptSsl(const CASecureEndpoint_t *sep, uint8_t *data, size_t dat
         }
     }
 
-    if (MBEDTLS_SSL_HANDSHAKE_OVER == peer->ssl.state)
-    {
-        uint8_t decryptBuffer[TLS_MSG_BUF_LEN] = {0};
-        do
-        {
-            ret = mbedtls_ssl_read(&peer->ssl, decryptBuffer, TLS_MSG_BUF_LEN);
-        } while (MBEDTLS_ERR_SSL_WANT_READ == ret);
-
-        if (MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY == ret ||
-            // TinyDTLS sends fatal close_notify alert
-            (MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE == ret &&
-             MBEDTLS_SSL_ALERT_LEVEL_FATAL == peer->ssl.in_msg[0] &&
-             MBEDTLS_SSL_ALERT_MSG_CLOSE_NOTIFY == peer->ssl.in_msg[1]))
-        {
-            OIC_LOG(INFO, NET_SSL_TAG, "Connection was closed gracefully");
-            RemovePeerFromList(&peer->sep.endpoint);
-            oc_mutex_unlock(g_sslContextMutex);
-            return CA_STATUS_OK;
-        }
-
-        int adapterIndex = GetAdapterIndex(peer->sep.endpoint.adapter);
-        if (adapterIndex >= 0)
-        {
-            if (0 > ret)
-            {
-                OIC_LOG_V(ERROR, NET_SSL_TAG, "mbedtls_ssl_read returned -0x%x", -ret);
-                g_caSslContext->adapterCallbacks[adapterIndex].errorCallback(&peer->sep.endpoint, peer->recBuf.buff, peer->recBuf.len, CA_STATUS_FAILED);
-                RemovePeerFromList(&peer->sep.endpoint);
-                oc_mutex_unlock(g_sslContextMutex);
-                return CA_STATUS_FAILED;
-            }
-            else if (0 < ret)
-            {
-                g_caSslContext->adapterCallbacks[adapterIndex].recvCallback(&peer->sep, decryptBuffer, ret);
-            }
-        }
-        else
-        {
-            OIC_LOG(ERROR, NET_SSL_TAG, "Unsuported adapter");
-            RemovePeerFromList(&peer->sep.endpoint);
-            oc_mutex_unlock(g_sslContextMutex);
-            return CA_STATUS_FAILED;
-        }
-    }
-
     oc_mutex_unlock(g_sslContextMutex);
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
     return CA_STATUS_OK;
@@ -2538,6 +3366,13 @@ CAResult_t CAsetTlsCipherSuite(const uint32_t cipher)
     }
     g_caSslContext->cipher = index;
 
+    // Ownership transfer selects the ciphersuites before its handshake, which has to be
+    // full: the owner PSK is derived from its randoms, see CAsslGenerateOwnerPsk().
+    for (size_t i = 0; i < SSL_SESSION_CACHE_SIZE; i++)
+    {
+        DropSavedSession(&g_caSslContext->savedSessions[i]);
+    }
+
     oc_mutex_unlock(g_sslContextMutex);
     OIC_LOG_V(DEBUG, NET_SSL_TAG, "Out %s", __func__);
     return CA_STATUS_OK;
@@ -2699,6 +3534,13 @@ CAResult_t CAsslGenerateOwnerPsk(const CAEndpoint_t *endpoint,
         oc_mutex_unlock(g_sslContextMutex);
         return CA_STATUS_FAILED;
     }
+    // A resumed handshake derives its keys without exposing the randoms.
+    if (tep->resumed)
+    {
+        OIC_LOG(ERROR, NET_SSL_TAG, "Session was resumed, randoms are unknown");
+        oc_mutex_unlock(g_sslContextMutex);
+        return CA_STATUS_FAILED;
+    }
 
     // keyBlockLen set up according to OIC 1.1 Security Specification Section 7.3.2
     int macKeyLen = 0;
@@ -40,8 +40,13 @@
 #include "camessagehandler.h"
 #include "caremotehandler.h"
 #include "cablockwisetransfer.h"
+#include "caprotocolmessage.h"
+#if defined(TCP_ADAPTER) && !defined(SINGLE_THREAD)
+#include "catcpinterface.h"
+#endif
 #include "oic_malloc.h"
 #include "oic_string.h"
+#include "oic_time.h"
 #include "octhread.h"
 #include "experimental/logger.h"
 
@@ -52,21 +57,265 @@
 #define BLOCK_M_BIT_IDX            3
 #define PORT_LENGTH                2
 
-#define BLOCK_SIZE(arg) (1 << ((arg) + 4))
+// a BERT block number counts 1Kbyte blocks like szx 6 does
+#define BLOCK_SIZE(arg) (1 << (((arg) < CA_BLOCK_SIZE_BERT ? (arg) : CA_BLOCK_SIZE_1024_BYTE) + 4))
+
+// size of the units a BERT message carries
+#define BERT_BLOCK_SIZE            1024
+
+// initial number of buckets of the block data table, a power of two
+#define BLOCK_DATA_BUCKETS         16
+
+// Q-Block blocks sent in a row before the receiver is heard from (MAX_PAYLOADS of RFC 9177)
+#define QBLOCK_MAX_PAYLOADS        10
+
+// peers remembered to have refused Q-Block, the oldest one is replaced first
+#define QBLOCK_REFUSED_PEERS       8
 
 // context for block-wise transfer
 static CABlockWiseContext_t g_context = { .sendThreadFunc = NULL,
                                           .receivedThreadFunc = NULL,
-                                          .dataList = NULL,
+                                          .blockDataCallback = NULL,
+                                          .dataTable =
+                                              OC_HASH_TABLE_INITIALIZER(BLOCK_DATA_BUCKETS),
                                           .multicastDataList = NULL };
 
+// next time block data are checked for expiry, guarded by blockDataListMutex
+static uint64_t g_nextExpiryCheck = 0;
+
+// block data without a block for this long are dropped (EXCHANGE_LIFETIME of RFC 7252)
+#define BLOCK_DATA_LIFETIME_MS     (247 * 1000)
+
+// block data are checked for expiry at most this often
+#define BLOCK_DATA_EXPIRY_CHECK_MS (10 * 1000)
+
+// peers that answered a Q-Block transfer with 4.02 Bad Option, guarded by blockDataListMutex
+static CAEndpoint_t g_qBlockRefusedPeers[QBLOCK_REFUSED_PEERS];
+static size_t g_nextQBlockRefusedPeer = 0;
+
+static uint32_t CAHashBlockDataID(const CABlockDataID_t *blockID)
+{
+    return OCHashBytes(OC_HASH_INIT, blockID->id, blockID->idLength);
+}
+
+// blockDataListMutex must be held.
+static CABlockData_t *CAFindBlockData(const CABlockDataID_t *blockID)
+{
+    if (!blockID->id)
+    {
+        return NULL;
+    }
+
+    for (OCHashLink *link = OCHashTableFirst(&g_context.dataTable, CAHashBlockDataID(blockID));
+         link; link = OCHashTableNext(link))
+    {
+        CABlockData_t *currData = OC_HASH_ENTRY(link, CABlockData_t, link);
+        if (CABlockidMatches(currData, blockID))
+        {
+            currData->lastActive = OICGetCurrentTime(TIME_IN_MS);
+            return currData;
+        }
+    }
+    return NULL;
+}
+
+// blockDataListMutex must be held.
+static CABlockData_t *CAUnlinkBlockData(const CABlockDataID_t *blockID)
+{
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData)
+    {
+        OCHashTableRemove(&g_context.dataTable, &currData->link);
+    }
+    return currData;
+}
+
+static void CADestroyBlockData(CABlockData_t *data)
+{
+    if (data->sentData)
+    {
+        CADestroyDataSet(data->sentData);
+    }
+    CADestroyBlockID(data->blockDataId);
+    OICFree(data->payload);
+    OICFree(data->blockMap);
+    OICFree(data);
+}
+
+// Length of the payload to send, including a payload produced when it is sent.
+static size_t CAGetSendPayloadLength(const CAData_t *sendData)
+{
+    const CAInfo_t *info = NULL;
+    if (sendData->requestInfo)
+    {
+        info = &sendData->requestInfo->info;
+    }
+    else if (sendData->responseInfo)
+    {
+        info = &sendData->responseInfo->info;
+    }
+
+    if (info && (info->payload || info->payloadProducer))
+    {
+        return info->payloadSize;
+    }
+    return 0;
+}
+
+// CoAP over TCP keeps the length of its header in the first byte and has no type or
+// message ID. The endpoint tells which header the pdu has.
+static coap_transport_t CAGetPDUTransport(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint)
+{
+#ifdef WITH_TCP
+    if (endpoint && CAIsSupportedCoAPOverTCP(endpoint->adapter))
+    {
+        return coap_get_tcp_header_type_from_initbyte(
+                ((unsigned char *)pdu->transport_hdr)[0] >> 4);
+    }
+#else
+    (void) pdu;
+    (void) endpoint;
+#endif
+    return COAP_UDP;
+}
+
+static uint32_t CAGetPDUCode(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint)
+{
+    return coap_get_code(pdu, CAGetPDUTransport(pdu, endpoint));
+}
+
+static CAMessageType_t CAGetPDUType(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint)
+{
+    if (COAP_UDP != CAGetPDUTransport(pdu, endpoint))
+    {
+        return CA_MSG_NONCONFIRM;
+    }
+    return (CAMessageType_t) pdu->transport_hdr->udp.type;
+}
+
+static uint16_t CAGetPDUMessageId(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint)
+{
+    if (COAP_UDP != CAGetPDUTransport(pdu, endpoint))
+    {
+        return 0;
+    }
+    return pdu->transport_hdr->udp.id;
+}
+
+static uint8_t CAGetPDUToken(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
+                             CAToken_t *token)
+{
+    unsigned char *tokenData = NULL;
+    unsigned int tokenLength = 0;
+    coap_get_token2(pdu->transport_hdr, CAGetPDUTransport(pdu, endpoint),
+                    &tokenData, &tokenLength);
+    *token = (CAToken_t) tokenData;
+    return (uint8_t) tokenLength;
+}
+
+// coap_check_option() for any transport.
+static coap_opt_t *CAFindPDUOption(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
+                                   uint16_t type, coap_opt_iterator_t *oi)
+{
+    coap_opt_filter_t filter;
+    coap_option_filter_clear(filter);
+    coap_option_setb(filter, type);
+
+    if (!coap_option_iterator_init2(pdu, oi, filter, CAGetPDUTransport(pdu, endpoint)))
+    {
+        return NULL;
+    }
+    return coap_option_next(oi);
+}
+
+// coap_get_block() for any transport.
+static int CAGetBlockFromPDU(coap_pdu_t *pdu, const CAEndpoint_t *endpoint, uint16_t type,
+                             coap_block_t *block)
+{
+    memset(block, 0, sizeof(*block));
+
+    coap_opt_iterator_t oi;
+    coap_opt_t *option = CAFindPDUOption(pdu, endpoint, type, &oi);
+    if (!option)
+    {
+        return 0;
+    }
+
+    block->szx = COAP_OPT_BLOCK_SZX(option);
+    if (COAP_OPT_BLOCK_MORE(option))
+    {
+        block->m = 1;
+    }
+    block->num = coap_opt_block_num(option);
+    return 1;
+}
+
+static bool CAIsPayloadLengthInPduWithBlockSizeOptionImpl(coap_pdu_t *pdu,
+                                                          const CAEndpoint_t *endpoint,
+                                                          uint16_t sizeType,
+                                                          size_t *totalPayloadLen);
+
+static bool CAUseQBlock(const CAEndpoint_t *endpoint);
+static CAResult_t CAStartQBlockTransfer(CABlockData_t *currData);
+static void CARemoveExpiredBlockData(void);
+static CAResult_t CAReceiveQBlock(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
+                                  const CAData_t *receivedData, uint16_t blockType,
+                                  coap_block_t block);
+static void CAResetQBlocks(CABlockData_t *data);
+static bool CAIsQBlockTransferPending(CABlockData_t *data);
+static CAResult_t CAAddQBlockOption(coap_pdu_t **pdu, const CAInfo_t *info, size_t dataLength,
+                                    const CABlockDataID_t *blockID, uint16_t blockType,
+                                    coap_list_t **options);
+
+// Largest payload sent to the endpoint in one message, and the number of 1Kbyte blocks
+// a BERT message carries or 0 if BERT is not used.
+static void CAGetBlockLimits(const CAEndpoint_t *endpoint, size_t *maxPayload,
+                             uint32_t *bertBlocks)
+{
+    *maxPayload = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+    *bertBlocks = 0;
+
+#if defined(TCP_ADAPTER) && !defined(SINGLE_THREAD)
+    if (endpoint && (CA_ADAPTER_TCP & endpoint->adapter))
+    {
+        uint32_t maxMessageSize = 0;
+        bool blockWiseTransfer = false;
+        if (!CAGetTCPPeerCapabilities(endpoint, &maxMessageSize, &blockWiseTransfer))
+        {
+            // until the CSM of the peer is received, messages are sent whole as before
+            *maxPayload = SIZE_MAX;
+            return;
+        }
+
+        // leave a block of room for the header and the options
+        *maxPayload = BERT_BLOCK_SIZE;
+        if (maxMessageSize > 2 * BERT_BLOCK_SIZE)
+        {
+            *maxPayload = (maxMessageSize - BERT_BLOCK_SIZE) / BERT_BLOCK_SIZE * BERT_BLOCK_SIZE;
+        }
+
+        if (caglobals.tcp.bertDisabled)
+        {
+            *maxPayload = BERT_BLOCK_SIZE;
+        }
+        else if (blockWiseTransfer)
+        {
+            *bertBlocks = (uint32_t) (*maxPayload / BERT_BLOCK_SIZE);
+        }
+    }
+#else
+    (void) endpoint;
+#endif
+}
+
 static bool CACheckPayloadLength(const CAData_t *sendData)
 {
-    size_t payloadLen = 0;
-    CAGetPayloadInfo(sendData, &payloadLen);
+    size_t payloadLen = CAGetSendPayloadLength(sendData);
 
     // check if message has to be transfered to a block
-    size_t maxBlockSize = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+    size_t maxBlockSize = 0;
+    uint32_t bertBlocks = 0;
+    CAGetBlockLimits(sendData->remoteEndpoint, &maxBlockSize, &bertBlocks);
     OIC_LOG_V(DEBUG, TAG, "payloadLen=%" PRIuPTR ", maxBlockSize=%" PRIuPTR, payloadLen, maxBlockSize);
 
     if (payloadLen <= maxBlockSize)
@@ -93,11 +342,6 @@ CAResult_t CAInitializeBlockWiseTransfer(CASendThreadFunc sendThreadFunc,
         g_context.receivedThreadFunc = receivedThreadFunc;
     }
 
-    if (!g_context.dataList)
-    {
-        g_context.dataList = u_arraylist_create();
-    }
-
     if (!g_context.multicastDataList)
     {
         g_context.multicastDataList = u_arraylist_create();
@@ -106,8 +350,6 @@ CAResult_t CAInitializeBlockWiseTransfer(CASendThreadFunc sendThreadFunc,
     CAResult_t res = CAInitBlockWiseMutexVariables();
     if (CA_STATUS_OK != res)
     {
-        u_arraylist_free(&g_context.dataList);
-        g_context.dataList = NULL;
         u_arraylist_free(&g_context.multicastDataList);
         g_context.multicastDataList = NULL;
         OIC_LOG(ERROR, TAG, "init has failed");
@@ -120,11 +362,16 @@ CAResult_t CATerminateBlockWiseTransfer()
 {
     OIC_LOG(DEBUG, TAG, "CATerminateBlockWiseTransfer");
 
-    if (g_context.dataList)
+    if (g_context.blockDataListMutex)
     {
         CARemoveAllBlockDataFromList();
-        u_arraylist_free(&g_context.dataList);
     }
+    OCHashTableClear(&g_context.dataTable);
+    g_context.sendThreadFunc = NULL;
+    g_context.receivedThreadFunc = NULL;
+    g_context.blockDataCallback = NULL;
+    memset(g_qBlockRefusedPeers, 0, sizeof(g_qBlockRefusedPeers));
+    g_nextQBlockRefusedPeer = 0;
 
     if (g_context.multicastDataList)
     {
@@ -194,10 +441,19 @@ void CATerminateBlockWiseMutexVariables()
     }
 }
 
+void CASetBlockDataCallback(CABlockDataCallback blockDataCallback)
+{
+    oc_mutex_lock(g_context.blockDataListMutex);
+    g_context.blockDataCallback = blockDataCallback;
+    oc_mutex_unlock(g_context.blockDataListMutex);
+}
+
 CAResult_t CASendBlockWiseData(const CAData_t *sendData)
 {
     VERIFY_NON_NULL(sendData, TAG, "sendData");
 
+    CARemoveExpiredBlockData();
+
     // check if message type is CA_MSG_RESET
     if (sendData->requestInfo)
     {
@@ -278,6 +534,13 @@ CAResult_t CASendBlockWiseData(const CAData_t *sendData)
 
     // #3. check request/response block option type and payload length
     res = CACheckBlockOptionType(currData);
+    if (CA_STATUS_OK == res &&
+        (CA_OPTION_Q_BLOCK1 == currData->type || CA_OPTION_Q_BLOCK2 == currData->type))
+    {
+        // #4. send the first set of blocks without waiting for each of them
+        OIC_LOG(DEBUG, TAG, "send first set of Q-Block msgs");
+        return CAStartQBlockTransfer(currData);
+    }
     if (CA_STATUS_OK == res)
     {
         // #4. send block message
@@ -331,13 +594,27 @@ CAResult_t CACheckBlockOptionType(CABlockData_t *currData)
         return CA_NOT_SUPPORTED;
     }
 
-    // set block option (COAP_OPTION_BLOCK2 or COAP_OPTION_BLOCK1)
+    // set block option (COAP_OPTION_BLOCK2 or COAP_OPTION_BLOCK1), or the Q-Block one
+    // when Q-Block is used with the remote endpoint
     if (currData->sentData->requestInfo) // request message
     {
-        currData->type = COAP_OPTION_BLOCK1;
+        currData->type = CAUseQBlock(currData->sentData->remoteEndpoint) ?
+                CA_OPTION_Q_BLOCK1 : COAP_OPTION_BLOCK1;
     }
-    else // response message
+    else if (CA_OPTION_Q_BLOCK1 == currData->type) // response to a Q-Block1 request
     {
+        // the client uses Q-Block, so a large response goes in sets of blocks as well, the
+        // blocks of the request are done with
+        oc_mutex_lock(g_context.blockDataListMutex);
+        currData->type = CA_OPTION_Q_BLOCK2;
+        currData->block2.num = 0;
+        currData->block2.m = 0;
+        CAResetQBlocks(currData);
+        oc_mutex_unlock(g_context.blockDataListMutex);
+    }
+    else if (CA_OPTION_Q_BLOCK2 != currData->type) // response message
+    {
+        // the request asked for Q-Block2 otherwise
         currData->type = COAP_OPTION_BLOCK2;
     }
 
@@ -356,8 +633,10 @@ CAResult_t CAReceiveBlockWiseData(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     VERIFY_TRUE((pdu->transport_hdr->udp.token_length <= UINT8_MAX), TAG,
                 "pdu->transport_hdr->udp.token_length");
 
+    CARemoveExpiredBlockData();
+
     // check if received message type is CA_MSG_RESET
-    if (CA_EMPTY == pdu->transport_hdr->udp.code)
+    if (CA_EMPTY == CAGetPDUCode(pdu, endpoint))
     {
         OIC_LOG(DEBUG, TAG, "code is CA_EMPTY..");
 
@@ -394,7 +673,7 @@ CAResult_t CAReceiveBlockWiseData(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
         // If we didn't send the last block message and received EMPTY message,
         // we have to remain the block data from list.
         CABlockData_t *data = CAGetBlockDataFromBlockDataList(blockDataID);
-        if (data && (data->block1.m || data->block2.m))
+        if (data && (data->block1.m || data->block2.m || CAIsQBlockTransferPending(data)))
         {
             OIC_LOG(DEBUG, TAG, "this is normal EMPTY message for blockwise-transfer.");
             CADestroyBlockID(blockDataID);
@@ -409,8 +688,21 @@ CAResult_t CAReceiveBlockWiseData(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     // check if block option is set and get block data
     coap_block_t block = { 0, 0, 0 };
 
+    // Q-Block is only used over UDP
+    if (COAP_UDP == CAGetPDUTransport(pdu, endpoint))
+    {
+        if (CAGetBlockFromPDU(pdu, endpoint, CA_OPTION_Q_BLOCK1, &block))
+        {
+            return CAReceiveQBlock(pdu, endpoint, receivedData, CA_OPTION_Q_BLOCK1, block);
+        }
+        if (CAGetBlockFromPDU(pdu, endpoint, CA_OPTION_Q_BLOCK2, &block))
+        {
+            return CAReceiveQBlock(pdu, endpoint, receivedData, CA_OPTION_Q_BLOCK2, block);
+        }
+    }
+
     // get block1 option
-    int isBlock1 = coap_get_block(pdu, COAP_OPTION_BLOCK1, &block);
+    int isBlock1 = CAGetBlockFromPDU(pdu, endpoint, COAP_OPTION_BLOCK1, &block);
     if (isBlock1)
     {
         CAResult_t res = CASetNextBlockOption1(pdu, endpoint, receivedData, block, dataLen);
@@ -422,7 +714,7 @@ CAResult_t CAReceiveBlockWiseData(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     }
 
     // get block2 option
-    int isBlock2 = coap_get_block(pdu, COAP_OPTION_BLOCK2, &block);
+    int isBlock2 = CAGetBlockFromPDU(pdu, endpoint, COAP_OPTION_BLOCK2, &block);
     if (isBlock2)
     {
         CAResult_t res = CASetNextBlockOption2(pdu, endpoint, receivedData, block, dataLen);
@@ -436,13 +728,14 @@ CAResult_t CAReceiveBlockWiseData(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     // if there is no block option in pdu, check if there is error code.
     if (!isBlock1 && !isBlock2)
     {
-        uint32_t code = CA_RESPONSE_CODE(pdu->transport_hdr->udp.code);
+        CAToken_t token = NULL;
+        uint8_t tokenLength = CAGetPDUToken(pdu, endpoint, &token);
+        uint32_t code = CA_RESPONSE_CODE(CAGetPDUCode(pdu, endpoint));
         if (CA_REQUEST_ENTITY_INCOMPLETE == code)
         {
-            CABlockDataID_t* blockDataID = CACreateBlockDatablockId(
-                                                        (CAToken_t)pdu->transport_hdr->udp.token,
-                                                        (uint8_t)pdu->transport_hdr->udp.token_length,
-                                                        endpoint->addr, endpoint->port);
+            CABlockDataID_t* blockDataID = CACreateBlockDatablockId(token, tokenLength,
+                                                                    endpoint->addr,
+                                                                    endpoint->port);
             if (NULL == blockDataID || blockDataID->idLength < 1)
             {
                 OIC_LOG(ERROR, TAG, "blockId is null");
@@ -458,6 +751,14 @@ CAResult_t CAReceiveBlockWiseData(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
                 return CA_STATUS_FAILED;
             }
 
+            // a Q-Block1 receiver lists the blocks it is missing
+            if (CA_OPTION_Q_BLOCK1 == data->type)
+            {
+                CAResult_t res = CAResendMissingQBlocks(pdu, blockDataID);
+                CADestroyBlockID(blockDataID);
+                return res;
+            }
+
             coap_block_t *tempBlock = CAGetBlockOption(blockDataID, data->type);
             if (!tempBlock)
             {
@@ -498,8 +799,22 @@ CAResult_t CAReceiveBlockWiseData(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
             // and sent data remain in block data list, remove block data
             if (receivedData->responseInfo)
             {
-                CARemoveBlockDataFromListWithSeed((CAToken_t)pdu->transport_hdr->udp.token,
-                                                  (uint8_t)pdu->transport_hdr->udp.token_length,
+                // unless the request is sent again without Q-Block
+                if (CA_BAD_OPT == code && CAUseQBlock(endpoint))
+                {
+                    CABlockDataID_t* blockDataID = CACreateBlockDatablockId(token, tokenLength,
+                                                                            endpoint->addr,
+                                                                            endpoint->port);
+                    CAResult_t res = blockDataID ? CAFallBackFromQBlock(blockDataID, endpoint)
+                                                 : CA_STATUS_FAILED;
+                    CADestroyBlockID(blockDataID);
+                    if (CA_STATUS_OK == res)
+                    {
+                        return CA_STATUS_OK;
+                    }
+                }
+
+                CARemoveBlockDataFromListWithSeed(token, tokenLength,
                                                   endpoint->addr, endpoint->port);
             }
             return CA_NOT_SUPPORTED;
@@ -542,9 +857,10 @@ CAResult_t CAProcessNextStep(const coap_pdu_t *pdu, const CAData_t *receivedData
             if (data->responseInfo)
             {
                 data->responseInfo->info.type =
-                        (pdu->transport_hdr->udp.type == CA_MSG_CONFIRM) ?
+                        (CAGetPDUType(pdu, data->remoteEndpoint) == CA_MSG_CONFIRM) ?
                                 CA_MSG_ACKNOWLEDGE : CA_MSG_NONCONFIRM;
-                data->responseInfo->info.messageId = pdu->transport_hdr->udp.id;
+                data->responseInfo->info.messageId = CAGetPDUMessageId(pdu,
+                                                                       data->remoteEndpoint);
 
                 res = CAAddSendThreadQueue(data, blockID);
                 if (CA_STATUS_OK != res)
@@ -558,7 +874,8 @@ CAResult_t CAProcessNextStep(const coap_pdu_t *pdu, const CAData_t *receivedData
         case CA_OPTION1_RESPONSE:
         case CA_OPTION2_RESPONSE:
         case CA_OPTION1_REQUEST_BLOCK:
-            res = CASendBlockMessage(pdu, pdu->transport_hdr->udp.type, blockID);
+            res = CASendBlockMessage(pdu, CAGetPDUType(pdu, receivedData->remoteEndpoint),
+                                     blockID);
             if (CA_STATUS_OK != res)
             {
                 OIC_LOG(ERROR, TAG, "send has failed");
@@ -617,7 +934,8 @@ CAResult_t CAProcessNextStep(const coap_pdu_t *pdu, const CAData_t *receivedData
             }
             else if (receivedData->responseInfo)
             {
-                res = CASendBlockMessage(pdu, pdu->transport_hdr->udp.type, blockID);
+                res = CASendBlockMessage(pdu, CAGetPDUType(pdu, receivedData->remoteEndpoint),
+                                         blockID);
                 if (CA_STATUS_OK != res)
                 {
                     OIC_LOG(ERROR, TAG, "send has failed");
@@ -675,13 +993,13 @@ CAResult_t CASendBlockMessage(const coap_pdu_t *pdu, CAMessageType_t msgType,
             break;
     }
 
-    uint32_t code = pdu->transport_hdr->udp.code;
+    uint32_t code = CAGetPDUCode(pdu, data->remoteEndpoint);
     if (CA_GET == code || CA_POST == code || CA_PUT == code || CA_DELETE == code)
     {
         if (data->responseInfo)
         {
             OIC_LOG(DEBUG, TAG, "set response info");
-            data->responseInfo->info.messageId = pdu->transport_hdr->udp.id;
+            data->responseInfo->info.messageId = CAGetPDUMessageId(pdu, data->remoteEndpoint);
             data->responseInfo->info.type = sentMsgType;
             data->responseInfo->result = CA_CONTINUE;
         }
@@ -705,7 +1023,7 @@ CAResult_t CASendBlockMessage(const coap_pdu_t *pdu, CAMessageType_t msgType,
         }
         else if (data->responseInfo)
         {
-            data->responseInfo->info.messageId = pdu->transport_hdr->udp.id;
+            data->responseInfo->info.messageId = CAGetPDUMessageId(pdu, data->remoteEndpoint);
             data->responseInfo->info.type = sentMsgType;
         }
     }
@@ -750,8 +1068,9 @@ CAResult_t CASendErrorMessage(const coap_pdu_t *pdu, uint8_t status,
         return CA_MEMORY_ALLOC_FAILED;
     }
 
+    const CAEndpoint_t *endpoint = data->sentData->remoteEndpoint;
     CAMessageType_t sentMsgType = CA_MSG_NONCONFIRM;
-    switch (pdu->transport_hdr->udp.type)
+    switch (CAGetPDUType(pdu, endpoint))
     {
         case CA_MSG_CONFIRM:
             sentMsgType = CA_MSG_ACKNOWLEDGE;
@@ -765,13 +1084,14 @@ CAResult_t CASendErrorMessage(const coap_pdu_t *pdu, uint8_t status,
 
     if (cloneData->responseInfo)
     {
-        cloneData->responseInfo->info.messageId = pdu->transport_hdr->udp.id;
+        cloneData->responseInfo->info.messageId = CAGetPDUMessageId(pdu, endpoint);
         cloneData->responseInfo->info.type = sentMsgType;
         cloneData->responseInfo->result = responseResult;
     }
     else
     {
-        CAInfo_t responseData = { .tokenLength = (uint8_t)pdu->transport_hdr->udp.token_length };
+        CAToken_t token = NULL;
+        CAInfo_t responseData = { .tokenLength = CAGetPDUToken(pdu, endpoint, &token) };
         responseData.token = (CAToken_t) OICMalloc(responseData.tokenLength);
         if (!responseData.token)
         {
@@ -779,7 +1099,7 @@ CAResult_t CASendErrorMessage(const coap_pdu_t *pdu, uint8_t status,
             CADestroyDataSet(cloneData);
             return CA_MEMORY_ALLOC_FAILED;
         }
-        memcpy(responseData.token, pdu->transport_hdr->udp.token, responseData.tokenLength);
+        memcpy(responseData.token, token, responseData.tokenLength);
 
         cloneData->responseInfo = (CAResponseInfo_t*) OICCalloc(1, sizeof(CAResponseInfo_t));
         if (!cloneData->responseInfo)
@@ -821,8 +1141,11 @@ CAResult_t CASendErrorMessage(const coap_pdu_t *pdu, uint8_t status,
     {
         OICFree(data->payload);
         data->payload = NULL;
+        data->payloadCapacity = 0;
         data->payloadLength = 0;
         data->receivedPayloadLen = 0;
+        data->streamed = false;
+        data->delivered = false;
         data->block1.num = 0;
         data->block2.num = 0;
     }
@@ -830,6 +1153,37 @@ CAResult_t CASendErrorMessage(const coap_pdu_t *pdu, uint8_t status,
     return CA_STATUS_OK;
 }
 
+// Take the received payload of a transfer out of its block data to deliver it.
+// Returns false if the transfer has been delivered already.
+static bool CATakeReceivedPayload(const CABlockDataID_t *blockID, CAPayload_t *payload,
+                                  size_t *payloadLen, bool *streamed)
+{
+    bool take = true;
+    oc_mutex_lock(g_context.blockDataListMutex);
+
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData)
+    {
+        if (currData->delivered)
+        {
+            take = false;
+        }
+        else
+        {
+            // the received length is kept to go on telling retransmitted blocks apart
+            *payload = currData->payload;
+            *payloadLen = currData->receivedPayloadLen;
+            *streamed = currData->streamed;
+            currData->payload = NULL;
+            currData->payloadCapacity = 0;
+            currData->delivered = (0 < currData->receivedPayloadLen);
+        }
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    return take;
+}
+
 CAResult_t CAReceiveLastBlock(const CABlockDataID_t *blockID, const CAData_t *receivedData)
 {
     VERIFY_NON_NULL(blockID, TAG, "blockID");
@@ -843,18 +1197,33 @@ CAResult_t CAReceiveLastBlock(const CABlockDataID_t *blockID, const CAData_t *re
         return CA_MEMORY_ALLOC_FAILED;
     }
 
-    // update payload
+    // hand the reassembled payload over instead of copying it
     size_t fullPayloadLen = 0;
-    CAPayload_t fullPayload = CAGetPayloadFromBlockDataList(blockID, &fullPayloadLen);
-    if (fullPayload)
+    CAPayload_t fullPayload = NULL;
+    bool streamed = false;
+    if (!CATakeReceivedPayload(blockID, &fullPayload, &fullPayloadLen, &streamed))
     {
-        CAResult_t res = CAUpdatePayloadToCAData(cloneData, fullPayload, fullPayloadLen);
-        if (CA_STATUS_OK != res)
+        OIC_LOG(DEBUG, TAG, "last block is received again, it was delivered already");
+        CADestroyDataSet(cloneData);
+        return CA_STATUS_OK;
+    }
+
+    if (fullPayload || streamed)
+    {
+        CAInfo_t *info = cloneData->requestInfo ? &cloneData->requestInfo->info :
+                cloneData->responseInfo ? &cloneData->responseInfo->info : NULL;
+        if (!info)
         {
-            OIC_LOG(ERROR, TAG, "update has failed");
+            OIC_LOG(ERROR, TAG, "info is null");
+            OICFree(fullPayload);
             CADestroyDataSet(cloneData);
-            return res;
+            return CA_STATUS_FAILED;
         }
+
+        // a streamed payload has been given to the block data callback already
+        OICFree(info->payload);
+        info->payload = fullPayload;
+        info->payloadSize = fullPayload ? fullPayloadLen : 0;
     }
 
     if (g_context.receivedThreadFunc)
@@ -940,10 +1309,10 @@ CAResult_t CASetNextBlockOption1(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
 
     OIC_LOG_V(INFO, TAG, "num:%d, M:%d, sze:%d", block.num, block.m, block.szx);
 
-    CABlockDataID_t* blockDataID = CACreateBlockDatablockId(
-            (CAToken_t)pdu->transport_hdr->udp.token,
-            (uint8_t)pdu->transport_hdr->udp.token_length,
-            endpoint->addr, endpoint->port);
+    CAToken_t token = NULL;
+    uint8_t tokenLength = CAGetPDUToken(pdu, endpoint, &token);
+    CABlockDataID_t* blockDataID = CACreateBlockDatablockId(token, tokenLength,
+                                                            endpoint->addr, endpoint->port);
     if ((NULL == blockDataID) || (blockDataID->idLength < 1) ||
         (blockDataID->idLength > UINT8_MAX))
     {
@@ -963,15 +1332,15 @@ CAResult_t CASetNextBlockOption1(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     }
 
     uint8_t blockWiseStatus = CA_BLOCK_UNKNOWN;
-    uint32_t code = pdu->transport_hdr->udp.code;
+    uint32_t code = CAGetPDUCode(pdu, endpoint);
     if (CA_GET == code || CA_POST == code || CA_PUT == code || CA_DELETE == code)
     {
         // received message type is request
         OIC_LOG_V(INFO, TAG, "num:%d, M:%d", block.num, block.m);
 
         // check the size option
-        bool isSizeOption = CAIsPayloadLengthInPduWithBlockSizeOption(pdu, COAP_OPTION_SIZE1,
-                                                                      &(data->payloadLength));
+        bool isSizeOption = CAIsPayloadLengthInPduWithBlockSizeOptionImpl(
+                pdu, endpoint, COAP_OPTION_SIZE1, &(data->payloadLength));
 
         blockWiseStatus = CACheckBlockErrorType(data, &block, receivedData,
                                                 COAP_OPTION_BLOCK1, dataLen);
@@ -1016,11 +1385,11 @@ CAResult_t CASetNextBlockOption1(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     else
     {
         // received message type is response
-        uint32_t responseCode = CA_RESPONSE_CODE(pdu->transport_hdr->udp.code);
+        uint32_t responseCode = CA_RESPONSE_CODE(code);
         if (0 == block.m && (CA_REQUEST_ENTITY_INCOMPLETE != responseCode
                 && CA_REQUEST_ENTITY_TOO_LARGE != responseCode))
         {
-            int isBlock2 = coap_get_block(pdu, COAP_OPTION_BLOCK2, &block);
+            int isBlock2 = CAGetBlockFromPDU(pdu, endpoint, COAP_OPTION_BLOCK2, &block);
             if (isBlock2)
             {
                 OIC_LOG(INFO, TAG, "received data is combining block1 and block2");
@@ -1086,10 +1455,10 @@ CAResult_t CASetNextBlockOption2(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     VERIFY_TRUE((pdu->transport_hdr->udp.token_length <= UINT8_MAX), TAG,
                 "pdu->transport_hdr->udp.token_length");
 
-    CABlockDataID_t* blockDataID = CACreateBlockDatablockId(
-            (CAToken_t)pdu->transport_hdr->udp.token,
-            (uint8_t)pdu->transport_hdr->udp.token_length,
-            endpoint->addr, endpoint->port);
+    CAToken_t token = NULL;
+    uint8_t tokenLength = CAGetPDUToken(pdu, endpoint, &token);
+    CABlockDataID_t* blockDataID = CACreateBlockDatablockId(token, tokenLength,
+                                                            endpoint->addr, endpoint->port);
     if ((NULL == blockDataID) || (blockDataID->idLength < 1) ||
         (blockDataID->idLength > UINT8_MAX))
     {
@@ -1109,7 +1478,8 @@ CAResult_t CASetNextBlockOption2(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     }
 
     uint8_t blockWiseStatus = CA_BLOCK_UNKNOWN;
-    if (0 == block.num && CA_GET == pdu->transport_hdr->udp.code && 0 == block.m)
+    uint32_t code = CAGetPDUCode(pdu, endpoint);
+    if (0 == block.num && CA_GET == code && 0 == block.m)
     {
         OIC_LOG(INFO, TAG, "first block number");
 
@@ -1131,7 +1501,6 @@ CAResult_t CASetNextBlockOption2(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
     }
     else
     {
-        uint32_t code = pdu->transport_hdr->udp.code;
         if (CA_GET == code || CA_POST == code || CA_PUT == code || CA_DELETE == code)
         {
             // received message type is request
@@ -1159,11 +1528,10 @@ CAResult_t CASetNextBlockOption2(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
             OIC_LOG(DEBUG, TAG, "received response message with block option2");
 
             // check the size option
-            bool isSizeOption = CAIsPayloadLengthInPduWithBlockSizeOption(pdu,
-                                                                          COAP_OPTION_SIZE2,
-                                                                          &(data->payloadLength));
+            bool isSizeOption = CAIsPayloadLengthInPduWithBlockSizeOptionImpl(
+                    pdu, endpoint, COAP_OPTION_SIZE2, &(data->payloadLength));
 
-            uint32_t responseCode = CA_RESPONSE_CODE(pdu->transport_hdr->udp.code);
+            uint32_t responseCode = CA_RESPONSE_CODE(code);
             if (CA_REQUEST_ENTITY_INCOMPLETE != responseCode && CA_REQUEST_ENTITY_TOO_LARGE != responseCode)
             {
                 // check if received payload is exact
@@ -1231,6 +1599,20 @@ exit:
     return res;
 }
 
+// Number of blocks a received message carried, several 1Kbyte blocks for BERT.
+static uint32_t CAGetBlockCount(const coap_pdu_t *pdu, const coap_block_t *block)
+{
+    if (CA_BLOCK_SIZE_BERT != block->szx)
+    {
+        return 1;
+    }
+
+    size_t length = 0;
+    unsigned char *data = NULL;
+    coap_get_data(pdu, &length, &data);
+    return (length > BERT_BLOCK_SIZE) ? (uint32_t) (length / BERT_BLOCK_SIZE) : 1;
+}
+
 CAResult_t CAUpdateBlockOptionItems(CABlockData_t *currData, const coap_pdu_t *pdu,
                                     coap_block_t *block, uint16_t blockType,
                                     uint32_t status)
@@ -1242,7 +1624,8 @@ CAResult_t CAUpdateBlockOptionItems(CABlockData_t *currData, const coap_pdu_t *p
 
     // update block data
     CAResult_t res = CA_STATUS_OK;
-    uint32_t code = CA_RESPONSE_CODE(pdu->transport_hdr->udp.code);
+    const CAEndpoint_t *endpoint = currData->sentData ? currData->sentData->remoteEndpoint : NULL;
+    uint32_t code = CA_RESPONSE_CODE(CAGetPDUCode(pdu, endpoint));
 
     if (CA_REQUEST_ENTITY_INCOMPLETE == code || CA_REQUEST_ENTITY_TOO_LARGE == code)
     {
@@ -1265,7 +1648,9 @@ CAResult_t CAUpdateBlockOptionItems(CABlockData_t *currData, const coap_pdu_t *p
                     OIC_LOG(ERROR, TAG, "received incorrect block num");
                     return CA_STATUS_FAILED;
                 }
-                block->num++;
+                // the next block follows the 1Kbyte blocks of the BERT message
+                block->num += (CA_BLOCK_SIZE_BERT == currData->block1.szx && currData->bertBlocks)
+                        ? currData->bertBlocks : 1;
                 break;
             case CA_OPTION2_REQUEST:
                 block->m = 0;
@@ -1276,7 +1661,7 @@ CAResult_t CAUpdateBlockOptionItems(CABlockData_t *currData, const coap_pdu_t *p
                     OIC_LOG(ERROR, TAG, "received incorrect block num");
                     return CA_STATUS_FAILED;
                 }
-                block->num++;
+                block->num += CAGetBlockCount(pdu, block);
                 block->m = 0;
                 break;
             case CA_BLOCK_TOO_LARGE:
@@ -1340,7 +1725,8 @@ CAResult_t CANegotiateBlockSize(CABlockData_t *currData, coap_block_t *block,
     VERIFY_NON_NULL(pdu->transport_hdr, TAG, "pdu->transport_hdr");
 
     bool isReqMsg = false;
-    uint32_t code = pdu->transport_hdr->udp.code;
+    const CAEndpoint_t *endpoint = currData->sentData ? currData->sentData->remoteEndpoint : NULL;
+    uint32_t code = CAGetPDUCode(pdu, endpoint);
     if (CA_GET == code || CA_POST == code || CA_PUT == code || CA_DELETE == code)
     {
         isReqMsg = true;
@@ -1413,8 +1799,13 @@ CAResult_t CAUpdateBlockData(CABlockData_t *currData, coap_block_t block,
 {
     VERIFY_NON_NULL(currData, TAG, "currData");
 
-    // check if block size is bigger than CABlockSize_t
-    if (block.szx > CA_BLOCK_SIZE_1024_BYTE)
+    // check if block size is bigger than CABlockSize_t, BERT is only used over TCP
+    bool isTCP = false;
+#ifdef WITH_TCP
+    isTCP = currData->sentData && currData->sentData->remoteEndpoint &&
+            CAIsSupportedCoAPOverTCP(currData->sentData->remoteEndpoint->adapter);
+#endif
+    if (block.szx > (isTCP ? CA_BLOCK_SIZE_BERT : CA_BLOCK_SIZE_1024_BYTE))
     {
         OIC_LOG(DEBUG, TAG, "invalid block szx");
         return CA_STATUS_FAILED;
@@ -1456,6 +1847,26 @@ CAResult_t CAUpdateMessageId(coap_pdu_t *pdu, const CABlockDataID_t *blockID)
     return CA_STATUS_OK;
 }
 
+// Add the part of the payload for the block to the pdu. A payload producer is only asked
+// for that part, so the payload is never held as a whole.
+static CAResult_t CAAddBlockPayload(coap_pdu_t *pdu, const CAInfo_t *info, size_t dataLength,
+                                    const coap_block_t *block)
+{
+    size_t start = (size_t) block->num * BLOCK_SIZE(block->szx);
+    if (dataLength <= start)
+    {
+        OIC_LOG(ERROR, TAG, "Data length is smaller than the start index");
+        return CA_STATUS_FAILED;
+    }
+
+    size_t length = dataLength - start;
+    if (length > (size_t) BLOCK_SIZE(block->szx))
+    {
+        length = BLOCK_SIZE(block->szx);
+    }
+    return CAAddPayloadToPDU(pdu, info, start, length);
+}
+
 CAResult_t CAAddBlockOption(coap_pdu_t **pdu, const CAInfo_t *info,
                             const CAEndpoint_t *endpoint, coap_list_t **options)
 {
@@ -1472,7 +1883,7 @@ CAResult_t CAAddBlockOption(coap_pdu_t **pdu, const CAInfo_t *info,
 
     CAResult_t res = CA_STATUS_OK;
     unsigned int dataLength = 0;
-    if (info->payload)
+    if (info->payload || info->payloadProducer)
     {
         dataLength = (unsigned int)info->payloadSize;
         OIC_LOG_V(DEBUG, TAG, "dataLength - %u", dataLength);
@@ -1489,16 +1900,25 @@ CAResult_t CAAddBlockOption(coap_pdu_t **pdu, const CAInfo_t *info,
         goto exit;
     }
 
+    uint16_t blockType = CAGetBlockOptionType(blockDataID);
     uint32_t repCode = CA_RESPONSE_CODE((*pdu)->transport_hdr->udp.code);
-    if (CA_REQUEST_ENTITY_INCOMPLETE == repCode)
+    if (CA_REQUEST_ENTITY_INCOMPLETE == repCode && CA_OPTION_Q_BLOCK1 != blockType)
     {
         OIC_LOG(INFO, TAG, "don't use option");
         res = CA_STATUS_OK;
         goto exit;
     }
 
-    uint16_t blockType = CAGetBlockOptionType(blockDataID);
-    if (COAP_OPTION_BLOCK2 == blockType)
+    if (CA_OPTION_Q_BLOCK1 == blockType || CA_OPTION_Q_BLOCK2 == blockType)
+    {
+        res = CAAddQBlockOption(pdu, info, dataLength, blockDataID, blockType, options);
+        if (CA_STATUS_OK != res)
+        {
+            OIC_LOG(ERROR, TAG, "add has failed");
+            goto exit;
+        }
+    }
+    else if (COAP_OPTION_BLOCK2 == blockType)
     {
         res = CAAddBlockOption2(pdu, info, dataLength, blockDataID, options);
         if (CA_STATUS_OK != res)
@@ -1520,6 +1940,20 @@ CAResult_t CAAddBlockOption(coap_pdu_t **pdu, const CAInfo_t *info,
     {
         OIC_LOG(DEBUG, TAG, "no BLOCK option");
 
+        // offer Q-Block2 so that a large response comes in sets of blocks, multicast
+        // requests have no block data
+        if (CA_GET == (*pdu)->transport_hdr->udp.code && CAUseQBlock(endpoint) &&
+            CAGetBlockDataFromBlockDataList(blockDataID))
+        {
+            coap_block_t block = { 0, 0, CA_DEFAULT_BLOCK_SIZE };
+            res = CAAddBlockOptionImpl(&block, CA_OPTION_Q_BLOCK2, options);
+            if (CA_STATUS_OK != res)
+            {
+                OIC_LOG(ERROR, TAG, "add has failed");
+                goto exit;
+            }
+        }
+
         // in case it is not large data, add option list to pdu.
         if (*options)
         {
@@ -1542,7 +1976,7 @@ CAResult_t CAAddBlockOption(coap_pdu_t **pdu, const CAInfo_t *info,
         OIC_LOG_V(DEBUG, TAG, "[%d] pdu length after option", (*pdu)->length);
 
         // if response data is so large. it have to send as block transfer
-        if (!coap_add_data(*pdu, dataLength, (const unsigned char*)info->payload))
+        if (CA_STATUS_OK != CAAddPayloadToPDU(*pdu, info, 0, dataLength))
         {
             OIC_LOG(INFO, TAG, "it has to use block");
             res = CA_STATUS_FAILED;
@@ -1642,12 +2076,9 @@ CAResult_t CAAddBlockOption2(coap_pdu_t **pdu, const CAInfo_t *info, size_t data
             goto exit;
         }
 
-        assert(block2->szx <= UINT8_MAX);
-        if (!coap_add_block(*pdu, (unsigned int)dataLength,
-                            (const unsigned char *) info->payload,
-                            block2->num, (unsigned char)block2->szx))
+        if (CA_STATUS_OK != CAAddBlockPayload(*pdu, info, dataLength, block2))
         {
-            OIC_LOG(ERROR, TAG, "Data length is smaller than the start index");
+            OIC_LOG(ERROR, TAG, "failed to add payload");
             return CA_STATUS_FAILED;
         }
 
@@ -1740,12 +2171,9 @@ CAResult_t CAAddBlockOption1(coap_pdu_t **pdu, const CAInfo_t *info, size_t data
         }
 
         // add the payload data as the block size.
-        assert(block1->szx <= UINT8_MAX);
-        if (!coap_add_block(*pdu, (unsigned int)dataLength,
-                            (const unsigned char *) info->payload, block1->num,
-                            (unsigned char)block1->szx))
+        if (CA_STATUS_OK != CAAddBlockPayload(*pdu, info, dataLength, block1))
         {
-            OIC_LOG(ERROR, TAG, "Data length is smaller than the start index");
+            OIC_LOG(ERROR, TAG, "failed to add payload");
             return CA_STATUS_FAILED;
         }
     }
@@ -1770,8 +2198,7 @@ CAResult_t CAAddBlockOption1(coap_pdu_t **pdu, const CAInfo_t *info, size_t data
         }
 
         // add the payload data as the block size.
-        if (!coap_add_data(*pdu, (unsigned int)dataLength,
-                           (const unsigned char*)info->payload))
+        if (CA_STATUS_OK != CAAddPayloadToPDU(*pdu, info, 0, dataLength))
         {
             OIC_LOG(ERROR, TAG, "failed to add payload");
             return CA_STATUS_FAILED;
@@ -1860,20 +2287,9 @@ CAResult_t CAAddOptionToPDU(coap_pdu_t *pdu, coap_list_t **options)
     return CA_STATUS_OK;
 }
 
-CAResult_t CAAddBlockSizeOption(coap_pdu_t *pdu, uint16_t sizeType, size_t dataLength,
-                                coap_list_t **options)
+static CAResult_t CAInsertBlockSizeOption(uint16_t sizeType, size_t dataLength,
+                                          coap_list_t **options)
 {
-    OIC_LOG(DEBUG, TAG, "IN-CAAddBlockSizeOption");
-    VERIFY_NON_NULL(pdu, TAG, "pdu");
-    VERIFY_NON_NULL(options, TAG, "options");
-    VERIFY_TRUE((dataLength <= UINT_MAX), TAG, "dataLength");
-
-    if (sizeType != COAP_OPTION_SIZE1 && sizeType != COAP_OPTION_SIZE2)
-    {
-        OIC_LOG(ERROR, TAG, "unknown option type");
-        return CA_STATUS_FAILED;
-    }
-
     unsigned char value[BLOCKWISE_OPTION_BUFFER] = { 0 };
     unsigned int optionLength = coap_encode_var_bytes(value,
                                                       (unsigned int)dataLength);
@@ -1885,20 +2301,16 @@ CAResult_t CAAddBlockSizeOption(coap_pdu_t *pdu, uint16_t sizeType, size_t dataL
     {
         return CA_STATUS_INVALID_PARAM;
     }
-
-    OIC_LOG(DEBUG, TAG, "OUT-CAAddBlockSizeOption");
-
     return CA_STATUS_OK;
 }
 
-// TODO make pdu const after libcoap is updated to support that.
-bool CAIsPayloadLengthInPduWithBlockSizeOption(coap_pdu_t *pdu,
-                                               uint16_t sizeType,
-                                               size_t *totalPayloadLen)
+CAResult_t CAAddBlockSizeOption(coap_pdu_t *pdu, uint16_t sizeType, size_t dataLength,
+                                coap_list_t **options)
 {
-    OIC_LOG(DEBUG, TAG, "IN-CAIsPayloadLengthInPduWithBlockSizeOption");
+    OIC_LOG(DEBUG, TAG, "IN-CAAddBlockSizeOption");
     VERIFY_NON_NULL(pdu, TAG, "pdu");
-    VERIFY_NON_NULL(totalPayloadLen, TAG, "totalPayloadLen");
+    VERIFY_NON_NULL(options, TAG, "options");
+    VERIFY_TRUE((dataLength <= UINT_MAX), TAG, "dataLength");
 
     if (sizeType != COAP_OPTION_SIZE1 && sizeType != COAP_OPTION_SIZE2)
     {
@@ -1906,31 +2318,1174 @@ bool CAIsPayloadLengthInPduWithBlockSizeOption(coap_pdu_t *pdu,
         return CA_STATUS_FAILED;
     }
 
-    coap_opt_iterator_t opt_iter;
-    coap_opt_t *option = coap_check_option(pdu, sizeType, &opt_iter);
-    if (option)
+    CAResult_t res = CAInsertBlockSizeOption(sizeType, dataLength, options);
+    if (CA_STATUS_OK != res)
     {
-        OIC_LOG(DEBUG, TAG, "get size option from pdu");
-        *totalPayloadLen = coap_decode_var_bytes(COAP_OPT_VALUE(option),
-                                                 COAP_OPT_LENGTH(option));
-
-        OIC_LOG_V(DEBUG, TAG, "the total payload length to be received is [%" PRIuPTR "]bytes",
-                  *totalPayloadLen);
-
-        return true;
+        return res;
     }
 
-    OIC_LOG(DEBUG, TAG, "OUT-CAIsPayloadLengthInPduWithBlockSizeOption");
+    OIC_LOG(DEBUG, TAG, "OUT-CAAddBlockSizeOption");
 
-    return false;
+    return CA_STATUS_OK;
 }
 
-uint8_t CACheckBlockErrorType(CABlockData_t *currData, coap_block_t *receivedBlock,
-                              const CAData_t *receivedData, uint16_t blockType,
-                              size_t dataLen)
+#ifdef WITH_TCP
+static uint32_t CAGetBertBlocks(const CABlockDataID_t *blockID)
 {
-    OIC_LOG(DEBUG, TAG, "IN-CheckBlockError");
-
+    oc_mutex_lock(g_context.blockDataListMutex);
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    uint32_t bertBlocks = currData ? currData->bertBlocks : 0;
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    return bertBlocks;
+}
+
+// Find the part of the payload a block message carries and set its M bit. A BERT message
+// carries up to bertBlocks 1Kbyte blocks.
+static CAResult_t CAGetBlockPayloadPart(coap_block_t *block, uint32_t bertBlocks,
+                                        size_t dataLength, size_t *start, size_t *length)
+{
+    *start = (size_t) block->num * BLOCK_SIZE(block->szx);
+    if (dataLength <= *start)
+    {
+        OIC_LOG(ERROR, TAG, "Data length is smaller than the start index");
+        return CA_STATUS_FAILED;
+    }
+
+    size_t blockLength = BLOCK_SIZE(block->szx);
+    if (CA_BLOCK_SIZE_BERT == block->szx && bertBlocks)
+    {
+        blockLength *= bertBlocks;
+    }
+
+    *length = dataLength - *start;
+    if (*length > blockLength)
+    {
+        *length = blockLength;
+    }
+    block->m = (*start + *length < dataLength) ? 1 : 0;
+    return CA_STATUS_OK;
+}
+
+coap_pdu_t *CAGenerateBlockPDU(uint32_t code, const CAInfo_t *info,
+                               const CAEndpoint_t *endpoint, coap_list_t **options,
+                               coap_transport_t *transport)
+{
+    OIC_LOG(DEBUG, TAG, "IN-GenerateBlockPDU");
+    VERIFY_NON_NULL_RET(info, TAG, "info", NULL);
+    VERIFY_NON_NULL_RET(endpoint, TAG, "endpoint", NULL);
+    VERIFY_NON_NULL_RET(options, TAG, "options", NULL);
+    VERIFY_TRUE_RET((info->payloadSize <= UINT_MAX), TAG, "info->payloadSize", NULL);
+
+    size_t dataLength = 0;
+    if (info->payload || info->payloadProducer)
+    {
+        dataLength = info->payloadSize;
+    }
+
+    CABlockDataID_t* blockDataID = CACreateBlockDatablockId(info->token, info->tokenLength,
+                                                            endpoint->addr, endpoint->port);
+    if (NULL == blockDataID || blockDataID->idLength < 1)
+    {
+        OIC_LOG(ERROR, TAG, "blockId is null");
+        CADestroyBlockID(blockDataID);
+        return NULL;
+    }
+
+    uint16_t blockType = CAGetBlockOptionType(blockDataID);
+    coap_block_t *block = CAGetBlockOption(blockDataID, blockType);
+    if (CA_REQUEST_ENTITY_INCOMPLETE == code || !block)
+    {
+        OIC_LOG(DEBUG, TAG, "no BLOCK option");
+        CADestroyBlockID(blockDataID);
+        return CAGeneratePDU(code, info, endpoint, options, transport);
+    }
+
+    bool isRequest = (CA_GET == code || CA_POST == code || CA_PUT == code || CA_DELETE == code);
+    uint32_t bertBlocks = CAGetBertBlocks(blockDataID);
+    size_t start = 0;
+    size_t length = 0;
+    bool isLastBlock = false;
+    CAResult_t res = CA_STATUS_OK;
+
+    if (COAP_OPTION_BLOCK2 == blockType && isRequest)
+    {
+        // ask for the next block of the response, without payload
+        res = CAAddBlockOptionImpl(block, COAP_OPTION_BLOCK2, options);
+    }
+    else if (COAP_OPTION_BLOCK1 == blockType && !isRequest)
+    {
+        // acknowledge the received block with the whole response
+        length = dataLength;
+        isLastBlock = (0 == block->m);
+        res = CAAddBlockOptionImpl(block, COAP_OPTION_BLOCK1, options);
+    }
+    else
+    {
+        res = CAGetBlockPayloadPart(block, bertBlocks, dataLength, &start, &length);
+        if (CA_STATUS_OK == res && 0 == block->num)
+        {
+            res = CAInsertBlockSizeOption(isRequest ? COAP_OPTION_SIZE1 : COAP_OPTION_SIZE2,
+                                          dataLength, options);
+        }
+        if (CA_STATUS_OK == res)
+        {
+            res = CAAddBlockOptionImpl(block, blockType, options);
+        }
+
+        coap_block_t *block1 = CAGetBlockOption(blockDataID, COAP_OPTION_BLOCK1);
+        if (CA_STATUS_OK == res && COAP_OPTION_BLOCK2 == blockType && block1 && block1->num)
+        {
+            OIC_LOG(DEBUG, TAG, "combining block1 and block2");
+            res = CAAddBlockOptionImpl(block1, COAP_OPTION_BLOCK1, options);
+            // initialize block number
+            block1->num = 0;
+        }
+        isLastBlock = (COAP_OPTION_BLOCK2 == blockType && !block->m);
+    }
+
+    coap_pdu_t *pdu = NULL;
+    if (CA_STATUS_OK == res)
+    {
+        // the pdu is generated for the length of the part, which is added afterwards
+        CAInfo_t partInfo = *info;
+        partInfo.payload = NULL;
+        partInfo.payloadProducer = NULL;
+        partInfo.payloadSize = length;
+
+        pdu = CAGeneratePDU(code, &partInfo, endpoint, options, transport);
+        if (pdu && CA_STATUS_OK != CAAddPayloadToPDU(pdu, info, start, length))
+        {
+            OIC_LOG(ERROR, TAG, "failed to add payload");
+            coap_delete_pdu(pdu);
+            pdu = NULL;
+        }
+    }
+
+    if (pdu)
+    {
+        CALogBlockInfo(block);
+    }
+    if (!pdu || isLastBlock)
+    {
+        // the transfer is over, or can't go on
+        CARemoveBlockDataFromList(blockDataID);
+    }
+
+    CADestroyBlockID(blockDataID);
+    OIC_LOG(DEBUG, TAG, "OUT-GenerateBlockPDU");
+    return pdu;
+}
+#endif
+
+static CAResult_t CAReservePayload(CABlockData_t *currData, bool isSizeOption, size_t totalLen);
+
+// Q-Block transfers (RFC 9177) send a set of blocks without waiting for a response to each
+// of them. The block data keeps a bit per block: the blocks still to be sent on the side
+// sending the body, the blocks received on the other side. The last block of a set is
+// confirmable, so the receiver answers once per set and a lost last block is sent again by
+// the retransmission of confirmable messages.
+
+// blockDataListMutex must be held.
+static bool CAIsQBlockMarked(const CABlockData_t *data, uint32_t num)
+{
+    return num < data->blockMapSize && (data->blockMap[num / 8] & (1 << (num % 8)));
+}
+
+// blockDataListMutex must be held.
+static CAResult_t CAMarkQBlock(CABlockData_t *data, uint32_t num)
+{
+    if (num >= data->blockMapSize)
+    {
+        uint32_t size = data->blockMapSize ? data->blockMapSize : 64;
+        while (size <= num)
+        {
+            size *= 2;
+        }
+
+        uint8_t *map = (uint8_t *) OICRealloc(data->blockMap, size / 8);
+        if (!map)
+        {
+            OIC_LOG(ERROR, TAG, "out of memory");
+            return CA_MEMORY_ALLOC_FAILED;
+        }
+        memset(map + data->blockMapSize / 8, 0, (size - data->blockMapSize) / 8);
+        data->blockMap = map;
+        data->blockMapSize = size;
+    }
+
+    data->blockMap[num / 8] |= (uint8_t) (1 << (num % 8));
+    return CA_STATUS_OK;
+}
+
+// Take the lowest block still to be sent. blockDataListMutex must be held.
+static bool CATakeMarkedQBlock(CABlockData_t *data, uint32_t *num)
+{
+    for (uint32_t i = 0; i < data->blockMapSize / 8; i++)
+    {
+        if (data->blockMap[i])
+        {
+            uint32_t bit = 0;
+            while (!(data->blockMap[i] & (1 << bit)))
+            {
+                bit++;
+            }
+            data->blockMap[i] &= (uint8_t) ~(1 << bit);
+            *num = i * 8 + bit;
+            return true;
+        }
+    }
+    return false;
+}
+
+// blockDataListMutex must be held.
+static bool CAGetHighestQBlock(const CABlockData_t *data, uint32_t *num)
+{
+    for (uint32_t i = data->blockMapSize / 8; i > 0; i--)
+    {
+        uint8_t bits = data->blockMap[i - 1];
+        if (bits)
+        {
+            uint32_t bit = 7;
+            while (!(bits & (1 << bit)))
+            {
+                bit--;
+            }
+            *num = (i - 1) * 8 + bit;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Blocks missing below the highest one received. blockDataListMutex must be held.
+static size_t CAGetMissingQBlocks(const CABlockData_t *data, uint32_t *nums, size_t max)
+{
+    size_t count = 0;
+    uint32_t highest = 0;
+    if (CAGetHighestQBlock(data, &highest))
+    {
+        for (uint32_t num = 0; num < highest && count < max; num++)
+        {
+            if (!CAIsQBlockMarked(data, num))
+            {
+                nums[count++] = num;
+            }
+        }
+    }
+    return count;
+}
+
+// blockDataListMutex must be held.
+static bool CAIsQBlockBodyComplete(const CABlockData_t *data)
+{
+    if (!data->blockCount || data->blockCount > data->blockMapSize)
+    {
+        return false;
+    }
+
+    uint32_t num = 0;
+    for (; num + 8 <= data->blockCount; num += 8)
+    {
+        if (0xFF != data->blockMap[num / 8])
+        {
+            return false;
+        }
+    }
+    for (; num < data->blockCount; num++)
+    {
+        if (!CAIsQBlockMarked(data, num))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Mark the next set of blocks to be sent and return how many were marked.
+// blockDataListMutex must be held.
+static uint32_t CAMarkNextQBlockSet(CABlockData_t *data)
+{
+    uint32_t count = 0;
+    for (; data->nextSet < data->blockCount && count < QBLOCK_MAX_PAYLOADS; data->nextSet++)
+    {
+        if (!CAIsQBlockMarked(data, data->nextSet))
+        {
+            if (CA_STATUS_OK != CAMarkQBlock(data, data->nextSet))
+            {
+                break;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+// Mark the blocks sent already that the receiver is missing and return how many were
+// marked. blockDataListMutex must be held.
+static uint32_t CAMarkMissingQBlocks(CABlockData_t *data, const uint32_t *nums, size_t count)
+{
+    uint32_t marked = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (nums[i] < data->nextSet && !CAIsQBlockMarked(data, nums[i]) &&
+            CA_STATUS_OK == CAMarkQBlock(data, nums[i]))
+        {
+            marked++;
+        }
+    }
+    return marked;
+}
+
+// Forget the blocks of the body sent or received so far, so that the block data can carry
+// another body. blockDataListMutex must be held.
+static void CAResetQBlocks(CABlockData_t *data)
+{
+    OICFree(data->blockMap);
+    data->blockMap = NULL;
+    data->blockMapSize = 0;
+    data->blockCount = 0;
+    data->nextSet = 0;
+}
+
+// A 4.08 response to Q-Block1 lists the missing blocks as a CBOR sequence of unsigned
+// integers, up to 5 bytes each.
+size_t CAEncodeMissingQBlocks(const uint32_t *nums, size_t count, uint8_t *buf)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t num = nums[i];
+        if (num < 24)
+        {
+            buf[length++] = (uint8_t) num;
+            continue;
+        }
+
+        size_t bytes = 4;
+        uint8_t initial = 0x1a;
+        if (num <= UINT8_MAX)
+        {
+            bytes = 1;
+            initial = 0x18;
+        }
+        else if (num <= UINT16_MAX)
+        {
+            bytes = 2;
+            initial = 0x19;
+        }
+
+        buf[length++] = initial;
+        for (size_t byte = bytes; byte > 0; byte--)
+        {
+            buf[length++] = (uint8_t) (num >> (8 * (byte - 1)));
+        }
+    }
+    return length;
+}
+
+size_t CADecodeMissingQBlocks(const uint8_t *buf, size_t length, uint32_t *nums, size_t max)
+{
+    size_t count = 0;
+    size_t i = 0;
+    while (i < length && count < max)
+    {
+        uint8_t initial = buf[i++];
+        uint32_t num = 0;
+        size_t bytes = 0;
+        if (initial < 24)
+        {
+            num = initial;
+        }
+        else if (0x18 <= initial && initial <= 0x1a)
+        {
+            bytes = (size_t) 1 << (initial - 0x18);
+        }
+        else
+        {
+            OIC_LOG(ERROR, TAG, "missing blocks are not unsigned integers");
+            break;
+        }
+
+        if (length - i < bytes)
+        {
+            OIC_LOG(ERROR, TAG, "missing blocks are cut short");
+            break;
+        }
+        for (; bytes > 0; bytes--)
+        {
+            num = (num << 8) | buf[i++];
+        }
+        nums[count++] = num;
+    }
+    return count;
+}
+
+static bool CAUseQBlock(const CAEndpoint_t *endpoint)
+{
+    if (!caglobals.ca.qBlockEnabled || !endpoint || !(CA_ADAPTER_IP & endpoint->adapter))
+    {
+        return false;
+    }
+
+    bool refused = false;
+    oc_mutex_lock(g_context.blockDataListMutex);
+    for (size_t i = 0; i < QBLOCK_REFUSED_PEERS && !refused; i++)
+    {
+        refused = (g_qBlockRefusedPeers[i].port == endpoint->port &&
+                   0 == strcmp(g_qBlockRefusedPeers[i].addr, endpoint->addr));
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    return !refused;
+}
+
+static void CARefuseQBlock(const CAEndpoint_t *endpoint)
+{
+    OIC_LOG_V(INFO, TAG, "%s:%u doesn't support Q-Block", endpoint->addr, endpoint->port);
+
+    oc_mutex_lock(g_context.blockDataListMutex);
+    g_qBlockRefusedPeers[g_nextQBlockRefusedPeer] = *endpoint;
+    g_nextQBlockRefusedPeer = (g_nextQBlockRefusedPeer + 1) % QBLOCK_REFUSED_PEERS;
+    oc_mutex_unlock(g_context.blockDataListMutex);
+}
+
+static void CAAddQBlockToSendThread(CAData_t *cloneData)
+{
+    if (g_context.sendThreadFunc)
+    {
+        oc_mutex_lock(g_context.blockDataSenderMutex);
+        g_context.sendThreadFunc(cloneData);
+        oc_mutex_unlock(g_context.blockDataSenderMutex);
+    }
+    else
+    {
+        CADestroyDataSet(cloneData);
+    }
+}
+
+// Queue a message for each block marked to be sent. Which block a message carries is
+// decided when it is sent, the last message is confirmable.
+static CAResult_t CAQueueQBlockMessages(const CABlockDataID_t *blockID, uint32_t count)
+{
+    OIC_LOG_V(DEBUG, TAG, "send %u Q-Block msgs", count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        bool piggybacked = false;
+
+        oc_mutex_lock(g_context.blockDataListMutex);
+        CABlockData_t *currData = CAFindBlockData(blockID);
+        CAData_t *cloneData = NULL;
+        if (currData && currData->sentData)
+        {
+            cloneData = CACloneCAData(currData->sentData);
+
+            // the first block of a response may go in the acknowledgement of the request,
+            // the blocks after it are sent on their own
+            CAResponseInfo_t *responseInfo = currData->sentData->responseInfo;
+            if (cloneData && responseInfo && CA_MSG_ACKNOWLEDGE == responseInfo->info.type)
+            {
+                responseInfo->info.type = CA_MSG_NONCONFIRM;
+                piggybacked = true;
+            }
+        }
+        oc_mutex_unlock(g_context.blockDataListMutex);
+
+        if (!cloneData)
+        {
+            OIC_LOG(ERROR, TAG, "clone has failed");
+            return CA_STATUS_FAILED;
+        }
+
+        if (!piggybacked)
+        {
+            CAInfo_t *info = cloneData->requestInfo ? &cloneData->requestInfo->info
+                                                    : &cloneData->responseInfo->info;
+            info->type = (i + 1 < count) ? CA_MSG_NONCONFIRM : CA_MSG_CONFIRM;
+            info->messageId = 0;
+        }
+        CAAddQBlockToSendThread(cloneData);
+    }
+    return CA_STATUS_OK;
+}
+
+static CAResult_t CAStartQBlockTransfer(CABlockData_t *currData)
+{
+    oc_mutex_lock(g_context.blockDataListMutex);
+    const coap_block_t *block = (CA_OPTION_Q_BLOCK1 == currData->type) ? &currData->block1
+                                                                        : &currData->block2;
+    size_t blockSize = BLOCK_SIZE(block->szx);
+    size_t dataLength = CAGetSendPayloadLength(currData->sentData);
+    currData->blockCount = (uint32_t) ((dataLength + blockSize - 1) / blockSize);
+    currData->nextSet = 0;
+    uint32_t count = CAMarkNextQBlockSet(currData);
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    return CAQueueQBlockMessages(currData->blockDataId, count);
+}
+
+// Ask for the blocks missing below the highest one received or for the next set. The
+// request is confirmable, so the transfer goes on if it is lost.
+static CAResult_t CAQueueQBlockRequest(const CABlockDataID_t *blockID)
+{
+    oc_mutex_lock(g_context.blockDataListMutex);
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    CAData_t *cloneData = (currData && currData->sentData) ?
+            CACloneCAData(currData->sentData) : NULL;
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    if (!cloneData || !cloneData->requestInfo)
+    {
+        OIC_LOG(ERROR, TAG, "clone has failed");
+        CADestroyDataSet(cloneData);
+        return CA_STATUS_FAILED;
+    }
+
+    cloneData->requestInfo->info.type = CA_MSG_CONFIRM;
+    cloneData->requestInfo->info.messageId = 0;
+    CAAddQBlockToSendThread(cloneData);
+    return CA_STATUS_OK;
+}
+
+// Store a received block at its place in the body, blocks may come in any order. Q-Block
+// transfers are always reassembled, they don't go to the block data callback.
+static CAResult_t CAStoreQBlock(CABlockData_t *currData, coap_pdu_t *pdu,
+                                const CAEndpoint_t *endpoint, const CAData_t *receivedData,
+                                const coap_block_t *block, uint16_t sizeType, bool *complete)
+{
+    if (block->szx >= CA_BLOCK_SIZE_BERT)
+    {
+        OIC_LOG(ERROR, TAG, "invalid block szx");
+        return CA_STATUS_FAILED;
+    }
+
+    size_t blockSize = BLOCK_SIZE(block->szx);
+    size_t length = 0;
+    CAPayload_t payload = CAGetPayloadInfo(receivedData, &length);
+    if (length > blockSize || (block->m && length != blockSize))
+    {
+        OIC_LOG(ERROR, TAG, "block has a wrong length");
+        return CA_STATUS_FAILED;
+    }
+
+    size_t totalLength = 0;
+    bool isSizeOption = CAIsPayloadLengthInPduWithBlockSizeOptionImpl(pdu, endpoint, sizeType,
+                                                                      &totalLength);
+    size_t offset = (size_t) block->num * blockSize;
+
+    CAResult_t res = CA_STATUS_OK;
+    oc_mutex_lock(g_context.blockDataListMutex);
+
+    if (isSizeOption && !currData->payloadLength)
+    {
+        currData->payloadLength = totalLength;
+    }
+
+    // without the size of the body a block can't be further than the next set
+    uint32_t highest = 0;
+    uint32_t limit = CAGetHighestQBlock(currData, &highest) ? highest + 1 : 0;
+    limit += QBLOCK_MAX_PAYLOADS;
+    if ((currData->blockCount && block->num >= currData->blockCount) ||
+        (currData->payloadLength ? offset + length > currData->payloadLength
+                                 : block->num >= limit))
+    {
+        OIC_LOG_V(ERROR, TAG, "block %u is out of the body", block->num);
+        res = CA_STATUS_FAILED;
+    }
+    else if (!CAIsQBlockMarked(currData, block->num))
+    {
+        res = CAReservePayload(currData, 0 < currData->payloadLength, offset + length);
+        if (CA_STATUS_OK == res)
+        {
+            res = CAMarkQBlock(currData, block->num);
+        }
+        if (CA_STATUS_OK == res)
+        {
+            if (length)
+            {
+                memcpy(currData->payload + offset, payload, length);
+            }
+            currData->receivedPayloadLen += length;
+        }
+    }
+    else
+    {
+        OIC_LOG_V(DEBUG, TAG, "block %u is received again", block->num);
+    }
+
+    if (CA_STATUS_OK == res)
+    {
+        if (!block->m)
+        {
+            currData->blockCount = block->num + 1;
+        }
+        else if (!currData->blockCount && currData->payloadLength)
+        {
+            currData->blockCount = (uint32_t) ((currData->payloadLength + blockSize - 1)
+                                               / blockSize);
+        }
+        *complete = CAIsQBlockBodyComplete(currData);
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    return res;
+}
+
+static CAResult_t CAReceiveQBlock1Request(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
+                                          const CAData_t *receivedData, coap_block_t block,
+                                          const CABlockDataID_t *blockID)
+{
+    CAMessageType_t type = CAGetPDUType(pdu, endpoint);
+    if (!caglobals.ca.qBlockEnabled)
+    {
+        // 4.02 Bad Option makes the client send the request again with Block1
+        OIC_LOG(INFO, TAG, "Q-Block1 is refused");
+        if (CA_MSG_CONFIRM == type && CACheckTheExistOfBlockData(blockID, pdu, endpoint, 0))
+        {
+            CASendErrorMessage(pdu, CA_BLOCK_UNKNOWN, CA_BAD_OPT, blockID);
+            CARemoveBlockDataFromList(blockID);
+        }
+        return CA_STATUS_OK;
+    }
+
+    CABlockData_t *data = CACheckTheExistOfBlockData(blockID, pdu, endpoint,
+                                                     CA_OPTION_Q_BLOCK1);
+    if (!data)
+    {
+        OIC_LOG(ERROR, TAG, "getting has failed");
+        return CA_STATUS_FAILED;
+    }
+
+    bool complete = false;
+    CAResult_t res = CAStoreQBlock(data, pdu, endpoint, receivedData, &block,
+                                   COAP_OPTION_SIZE1, &complete);
+    if (CA_STATUS_OK != res)
+    {
+        return res;
+    }
+
+    if (complete)
+    {
+        // the request goes up once, its response is sent by the upper layer
+        bool delivered = data->delivered;
+        res = CAReceiveLastBlock(blockID, receivedData);
+        if (delivered && CA_MSG_CONFIRM == type)
+        {
+            CASendDirectEmptyResponse(endpoint, CAGetPDUMessageId(pdu, endpoint));
+        }
+        return res;
+    }
+
+    if (CA_MSG_CONFIRM == type)
+    {
+        // the last block of a set: 2.31 if no block is missing up to it, 4.08 otherwise
+        uint32_t missing = 0;
+        oc_mutex_lock(g_context.blockDataListMutex);
+        size_t missingCount = CAGetMissingQBlocks(data, &missing, 1);
+        oc_mutex_unlock(g_context.blockDataListMutex);
+
+        if (missingCount)
+        {
+            return CASendErrorMessage(pdu, CA_BLOCK_UNKNOWN, CA_REQUEST_ENTITY_INCOMPLETE,
+                                      blockID);
+        }
+        return CASendBlockMessage(pdu, type, blockID);
+    }
+    return CA_STATUS_OK;
+}
+
+static CAResult_t CAReceiveQBlock1Response(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
+                                           const CAData_t *receivedData,
+                                           const CABlockDataID_t *blockID)
+{
+    if (CA_OPTION_Q_BLOCK1 != CAGetBlockOptionType(blockID))
+    {
+        OIC_LOG(DEBUG, TAG, "Q-Block1 transfer is over");
+        return CA_STATUS_OK;
+    }
+
+    if (CA_CONTINUE == CA_RESPONSE_CODE(CAGetPDUCode(pdu, endpoint)))
+    {
+        oc_mutex_lock(g_context.blockDataListMutex);
+        CABlockData_t *currData = CAFindBlockData(blockID);
+        uint32_t count = currData ? CAMarkNextQBlockSet(currData) : 0;
+        oc_mutex_unlock(g_context.blockDataListMutex);
+
+        return CAQueueQBlockMessages(blockID, count);
+    }
+
+    // the response to the whole request
+    CAResult_t res = CAReceiveLastBlock(blockID, receivedData);
+    CARemoveBlockDataFromList(blockID);
+    return res;
+}
+
+static CAResult_t CAReceiveQBlock2Request(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
+                                          const CABlockDataID_t *blockID)
+{
+    if (!caglobals.ca.qBlockEnabled)
+    {
+        // a large response is sent with Block2
+        OIC_LOG(INFO, TAG, "Q-Block2 is ignored");
+        return CA_NOT_SUPPORTED;
+    }
+
+    CABlockData_t *data = CAGetBlockDataFromBlockDataList(blockID);
+    if (!data || CA_OPTION_Q_BLOCK2 != data->type || !data->blockCount)
+    {
+        // a new request, its response is sent in sets of blocks if it is large
+        if (!CACheckTheExistOfBlockData(blockID, pdu, endpoint, CA_OPTION_Q_BLOCK2))
+        {
+            OIC_LOG(ERROR, TAG, "getting has failed");
+            return CA_STATUS_FAILED;
+        }
+        return CA_NOT_SUPPORTED;
+    }
+
+    // the client asks for the blocks it is missing, or with the M bit for the next set
+    uint32_t missing[QBLOCK_MAX_PAYLOADS];
+    size_t missingCount = 0;
+    bool nextSet = false;
+    uint32_t first = 0;
+
+    coap_opt_iterator_t oi;
+    coap_opt_t *option = CAFindPDUOption(pdu, endpoint, CA_OPTION_Q_BLOCK2, &oi);
+    for (; option && missingCount < QBLOCK_MAX_PAYLOADS; option = coap_option_next(&oi))
+    {
+        if (COAP_OPT_BLOCK_MORE(option))
+        {
+            nextSet = true;
+            first = coap_opt_block_num(option);
+        }
+        else
+        {
+            missing[missingCount++] = coap_opt_block_num(option);
+        }
+    }
+
+    oc_mutex_lock(g_context.blockDataListMutex);
+    uint32_t count = 0;
+    data = CAFindBlockData(blockID);
+    if (data)
+    {
+        count = CAMarkMissingQBlocks(data, missing, missingCount);
+        if (nextSet && first <= data->nextSet)
+        {
+            data->nextSet = first;
+            count += CAMarkNextQBlockSet(data);
+        }
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    if (CA_MSG_CONFIRM == CAGetPDUType(pdu, endpoint))
+    {
+        CASendDirectEmptyResponse(endpoint, CAGetPDUMessageId(pdu, endpoint));
+    }
+    return CAQueueQBlockMessages(blockID, count);
+}
+
+static CAResult_t CAReceiveQBlock2Response(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
+                                           const CAData_t *receivedData, coap_block_t block,
+                                           const CABlockDataID_t *blockID)
+{
+    CAMessageType_t type = CAGetPDUType(pdu, endpoint);
+    uint16_t messageId = CAGetPDUMessageId(pdu, endpoint);
+
+    CABlockData_t *data = CAGetBlockDataFromBlockDataList(blockID);
+    if (!data || !data->sentData || !data->sentData->requestInfo)
+    {
+        // a block of a transfer that is over
+        OIC_LOG(DEBUG, TAG, "Q-Block2 transfer is over");
+        if (CA_MSG_CONFIRM == type)
+        {
+            CASendDirectEmptyResponse(endpoint, messageId);
+        }
+        return CA_STATUS_OK;
+    }
+
+    oc_mutex_lock(g_context.blockDataListMutex);
+    if (CA_OPTION_Q_BLOCK1 == data->type)
+    {
+        // a large response to a Q-Block1 request, the blocks of the request are done with
+        CAResetQBlocks(data);
+        data->type = CA_OPTION_Q_BLOCK2;
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+    CAUpdateBlockOptionType(blockID, CA_OPTION_Q_BLOCK2);
+
+    bool complete = false;
+    CAResult_t res = CAStoreQBlock(data, pdu, endpoint, receivedData, &block,
+                                   COAP_OPTION_SIZE2, &complete);
+    if (CA_STATUS_OK != res)
+    {
+        return res;
+    }
+
+    if (complete)
+    {
+        // the upper layer acknowledges the response it gets
+        res = CAReceiveLastBlock(blockID, receivedData);
+        CARemoveBlockDataFromList(blockID);
+        return res;
+    }
+
+    if (CA_MSG_CONFIRM == type)
+    {
+        // the request goes first, so the server still has the transfer when the
+        // acknowledgement of its last block comes
+        res = CAQueueQBlockRequest(blockID);
+        CASendDirectEmptyResponse(endpoint, messageId);
+    }
+    return res;
+}
+
+static CAResult_t CAReceiveQBlock(coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
+                                  const CAData_t *receivedData, uint16_t blockType,
+                                  coap_block_t block)
+{
+    OIC_LOG_V(INFO, TAG, "CAReceiveQBlock %u", blockType);
+
+    CAToken_t token = NULL;
+    uint8_t tokenLength = CAGetPDUToken(pdu, endpoint, &token);
+    CABlockDataID_t* blockDataID = CACreateBlockDatablockId(token, tokenLength,
+                                                            endpoint->addr, endpoint->port);
+    if (NULL == blockDataID || blockDataID->idLength < 1)
+    {
+        OIC_LOG(ERROR, TAG, "blockId is null");
+        CADestroyBlockID(blockDataID);
+        return CA_STATUS_FAILED;
+    }
+
+    CAResult_t res = CA_STATUS_OK;
+    if (CA_OPTION_Q_BLOCK1 == blockType)
+    {
+        res = receivedData->requestInfo ?
+                CAReceiveQBlock1Request(pdu, endpoint, receivedData, block, blockDataID) :
+                CAReceiveQBlock1Response(pdu, endpoint, receivedData, blockDataID);
+    }
+    else
+    {
+        res = receivedData->requestInfo ?
+                CAReceiveQBlock2Request(pdu, endpoint, blockDataID) :
+                CAReceiveQBlock2Response(pdu, endpoint, receivedData, block, blockDataID);
+    }
+
+    CADestroyBlockID(blockDataID);
+    return res;
+}
+
+CAResult_t CAResendMissingQBlocks(coap_pdu_t *pdu, const CABlockDataID_t *blockID)
+{
+    size_t length = 0;
+    unsigned char *payload = NULL;
+    uint32_t missing[QBLOCK_MAX_PAYLOADS];
+    size_t missingCount = 0;
+    if (coap_get_data(pdu, &length, &payload))
+    {
+        missingCount = CADecodeMissingQBlocks(payload, length, missing, QBLOCK_MAX_PAYLOADS);
+    }
+
+    oc_mutex_lock(g_context.blockDataListMutex);
+    uint32_t count = 0;
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData)
+    {
+        count = CAMarkMissingQBlocks(currData, missing, missingCount);
+        if (!count)
+        {
+            count = CAMarkNextQBlockSet(currData);
+        }
+        if (!count && currData->blockCount &&
+            CA_STATUS_OK == CAMarkQBlock(currData, currData->blockCount - 1))
+        {
+            // everything has been sent, the last block asks for an answer again
+            count = 1;
+        }
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    return CAQueueQBlockMessages(blockID, count);
+}
+
+CAResult_t CAFallBackFromQBlock(const CABlockDataID_t *blockID, const CAEndpoint_t *endpoint)
+{
+    bool restart = false;
+    CAData_t *cloneData = NULL;
+
+    oc_mutex_lock(g_context.blockDataListMutex);
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData && currData->sentData && currData->sentData->requestInfo)
+    {
+        CARequestInfo_t *requestInfo = currData->sentData->requestInfo;
+        if (CA_OPTION_Q_BLOCK1 == currData->type)
+        {
+            // the body is sent again from the first block with Block1
+            currData->type = COAP_OPTION_BLOCK1;
+            currData->block1.num = 0;
+            currData->block1.m = 0;
+            CAResetQBlocks(currData);
+            restart = true;
+        }
+        else if (0 == currData->type && CA_GET == requestInfo->method)
+        {
+            // the request offered Q-Block2
+            restart = true;
+        }
+
+        if (restart)
+        {
+            requestInfo->info.messageId = 0;
+            cloneData = CACloneCAData(currData->sentData);
+        }
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    if (!restart)
+    {
+        return CA_NOT_SUPPORTED;
+    }
+
+    CARefuseQBlock(endpoint);
+    if (!cloneData)
+    {
+        OIC_LOG(ERROR, TAG, "clone has failed");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+
+    OIC_LOG(INFO, TAG, "request is sent again without Q-Block");
+    CAAddQBlockToSendThread(cloneData);
+    return CA_STATUS_OK;
+}
+
+// A Q-Block request is over when its response comes, a Q-Block2 response when every block
+// has been sent.
+static bool CAIsQBlockTransferPending(CABlockData_t *data)
+{
+    bool pending = false;
+
+    oc_mutex_lock(g_context.blockDataListMutex);
+    if (CA_OPTION_Q_BLOCK1 == data->type || CA_OPTION_Q_BLOCK2 == data->type)
+    {
+        uint32_t num = 0;
+        pending = (data->sentData && data->sentData->requestInfo) ||
+                  data->nextSet < data->blockCount || CAGetHighestQBlock(data, &num);
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    return pending;
+}
+
+static CAResult_t CAAddQBlockOption(coap_pdu_t **pdu, const CAInfo_t *info, size_t dataLength,
+                                    const CABlockDataID_t *blockID, uint16_t blockType,
+                                    coap_list_t **options)
+{
+    OIC_LOG(DEBUG, TAG, "IN-AddQBlockOption");
+
+    uint32_t code = (*pdu)->transport_hdr->udp.code;
+    bool isRequest = (CA_GET == code || CA_POST == code || CA_PUT == code || CA_DELETE == code);
+    uint32_t repCode = CA_RESPONSE_CODE(code);
+
+    // the side sending the body puts the next marked block in the message
+    bool hasBlock = ((CA_OPTION_Q_BLOCK1 == blockType) == isRequest);
+    bool listsMissing = (!hasBlock && CA_REQUEST_ENTITY_INCOMPLETE == repCode);
+
+    coap_block_t block = { 0, 0, CA_DEFAULT_BLOCK_SIZE };
+    uint32_t missing[QBLOCK_MAX_PAYLOADS];
+    size_t missingCount = 0;
+    bool started = true;
+    bool last = false;
+
+    oc_mutex_lock(g_context.blockDataListMutex);
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (!currData)
+    {
+        oc_mutex_unlock(g_context.blockDataListMutex);
+        OIC_LOG(ERROR, TAG, "getting has failed");
+        return CA_STATUS_FAILED;
+    }
+
+    block.szx = (CA_OPTION_Q_BLOCK1 == blockType) ? currData->block1.szx : currData->block2.szx;
+    uint32_t num = 0;
+    if (hasBlock)
+    {
+        started = (0 < currData->blockCount);
+        if (started && !CATakeMarkedQBlock(currData, &num))
+        {
+            oc_mutex_unlock(g_context.blockDataListMutex);
+            OIC_LOG(ERROR, TAG, "no block to send");
+            return CA_STATUS_FAILED;
+        }
+        block.num = num;
+        block.m = (num + 1 < currData->blockCount);
+    }
+    else if (isRequest || listsMissing)
+    {
+        missingCount = CAGetMissingQBlocks(currData, missing, QBLOCK_MAX_PAYLOADS);
+        if (isRequest && !missingCount)
+        {
+            // nothing is missing, the next set is asked for
+            block.num = CAGetHighestQBlock(currData, &num) ? num + 1 : 0;
+            block.m = 1;
+        }
+    }
+    else
+    {
+        // 2.31 for a set received whole, or the response to the whole request
+        CAGetHighestQBlock(currData, &num);
+        block.num = num;
+        block.m = (CA_CONTINUE == repCode);
+        last = !block.m;
+        if (last && dataLength > (size_t) BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE))
+        {
+            // a large response is sent in Q-Block2 sets, see CACheckBlockOptionType()
+            oc_mutex_unlock(g_context.blockDataListMutex);
+            OIC_LOG(ERROR, TAG, "response doesn't fit in one message");
+            CARemoveBlockDataFromList(blockID);
+            return CA_STATUS_FAILED;
+        }
+    }
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    CAResult_t res = CA_STATUS_OK;
+    if (!started)
+    {
+        // the response to a request offering Q-Block2 fits in one message
+        res = CAAddOptionToPDU(*pdu, options);
+        if (CA_STATUS_OK == res)
+        {
+            res = CAAddPayloadToPDU(*pdu, info, 0, dataLength);
+        }
+        CARemoveBlockDataFromList(blockID);
+        return res;
+    }
+
+    if (hasBlock)
+    {
+        // every block carries the size of the body as the blocks may come in any order
+        res = CAAddBlockSizeOption(*pdu, (CA_OPTION_Q_BLOCK1 == blockType) ?
+                                   COAP_OPTION_SIZE1 : COAP_OPTION_SIZE2, dataLength, options);
+        if (CA_STATUS_OK == res)
+        {
+            res = CAAddBlockOptionImpl(&block, (uint8_t) blockType, options);
+        }
+    }
+    else if (listsMissing)
+    {
+        // the missing blocks are listed in the payload
+        unsigned char format[BLOCKWISE_OPTION_BUFFER] = { 0 };
+        unsigned int optionLength = coap_encode_var_bytes(format, CA_FORMAT_MISSING_BLOCKS);
+        if (0 >= coap_insert(options, CACreateNewOptionNode(COAP_OPTION_CONTENT_FORMAT,
+                                                            optionLength, (char *) format),
+                             CAOrderOpts))
+        {
+            res = CA_STATUS_INVALID_PARAM;
+        }
+    }
+    else if (missingCount)
+    {
+        for (size_t i = 0; i < missingCount && CA_STATUS_OK == res; i++)
+        {
+            coap_block_t missingBlock = { missing[i], 0, block.szx };
+            res = CAAddBlockOptionImpl(&missingBlock, (uint8_t) blockType, options);
+        }
+    }
+    else
+    {
+        res = CAAddBlockOptionImpl(&block, (uint8_t) blockType, options);
+    }
+
+    if (CA_STATUS_OK == res)
+    {
+        res = CAAddOptionToPDU(*pdu, options);
+    }
+
+    if (CA_STATUS_OK == res)
+    {
+        if (hasBlock)
+        {
+            res = CAAddBlockPayload(*pdu, info, dataLength, &block);
+            CALogBlockInfo(&block);
+        }
+        else if (listsMissing)
+        {
+            uint8_t buf[QBLOCK_MAX_PAYLOADS * 5];
+            size_t length = CAEncodeMissingQBlocks(missing, missingCount, buf);
+            if (length && !coap_add_data(*pdu, (unsigned int) length, buf))
+            {
+                res = CA_STATUS_FAILED;
+            }
+        }
+        else if (!isRequest)
+        {
+            // the response to the whole request, it fits in one message
+            res = CAAddPayloadToPDU(*pdu, info, 0, dataLength);
+        }
+    }
+
+    if (CA_STATUS_OK != res)
+    {
+        OIC_LOG(ERROR, TAG, "add has failed");
+        CARemoveBlockDataFromList(blockID);
+    }
+    else if (last)
+    {
+        // the response to the whole request ends the transfer
+        CARemoveBlockDataFromList(blockID);
+    }
+
+    OIC_LOG(DEBUG, TAG, "OUT-AddQBlockOption");
+    return res;
+}
+
+// TODO make pdu const after libcoap is updated to support that.
+bool CAIsPayloadLengthInPduWithBlockSizeOption(coap_pdu_t *pdu,
+                                               uint16_t sizeType,
+                                               size_t *totalPayloadLen)
+{
+    return CAIsPayloadLengthInPduWithBlockSizeOptionImpl(pdu, NULL, sizeType, totalPayloadLen);
+}
+
+static bool CAIsPayloadLengthInPduWithBlockSizeOptionImpl(coap_pdu_t *pdu,
+                                                          const CAEndpoint_t *endpoint,
+                                                          uint16_t sizeType,
+                                                          size_t *totalPayloadLen)
+{
+    OIC_LOG(DEBUG, TAG, "IN-CAIsPayloadLengthInPduWithBlockSizeOption");
+    VERIFY_NON_NULL(pdu, TAG, "pdu");
+    VERIFY_NON_NULL(totalPayloadLen, TAG, "totalPayloadLen");
+
+    if (sizeType != COAP_OPTION_SIZE1 && sizeType != COAP_OPTION_SIZE2)
+    {
+        OIC_LOG(ERROR, TAG, "unknown option type");
+        return CA_STATUS_FAILED;
+    }
+
+    coap_opt_iterator_t opt_iter;
+    coap_opt_t *option = CAFindPDUOption(pdu, endpoint, sizeType, &opt_iter);
+    if (option)
+    {
+        OIC_LOG(DEBUG, TAG, "get size option from pdu");
+        *totalPayloadLen = coap_decode_var_bytes(COAP_OPT_VALUE(option),
+                                                 COAP_OPT_LENGTH(option));
+
+        OIC_LOG_V(DEBUG, TAG, "the total payload length to be received is [%" PRIuPTR "]bytes",
+                  *totalPayloadLen);
+
+        return true;
+    }
+
+    OIC_LOG(DEBUG, TAG, "OUT-CAIsPayloadLengthInPduWithBlockSizeOption");
+
+    return false;
+}
+
+uint8_t CACheckBlockErrorType(CABlockData_t *currData, coap_block_t *receivedBlock,
+                              const CAData_t *receivedData, uint16_t blockType,
+                              size_t dataLen)
+{
+    OIC_LOG(DEBUG, TAG, "IN-CheckBlockError");
+
     VERIFY_NON_NULL(currData, TAG, "currData is NULL");
     VERIFY_NON_NULL(receivedBlock, TAG, "receivedBlock is NULL");
     VERIFY_NON_NULL(receivedData, TAG, "receivedData is NULL");
@@ -1943,9 +3498,13 @@ uint8_t CACheckBlockErrorType(CABlockData_t *currData, coap_block_t *receivedBlo
     if (COAP_OPTION_BLOCK1 == blockType)
     {
         size_t prePayloadLen = currData->receivedPayloadLen;
-        if (prePayloadLen != (size_t) BLOCK_SIZE(receivedBlock->szx) * receivedBlock->num)
+        size_t blockStart = (size_t) BLOCK_SIZE(receivedBlock->szx) * receivedBlock->num;
+        if (prePayloadLen != blockStart)
         {
-            if (receivedBlock->num > currData->block1.num + 1)
+            // a BERT message moves the block number on by the blocks it carried
+            bool isLost = (CA_BLOCK_SIZE_BERT == receivedBlock->szx) ?
+                    blockStart > prePayloadLen : receivedBlock->num > currData->block1.num + 1;
+            if (isLost)
             {
                 // 408 Error handling of block loss
                 OIC_LOG(ERROR, TAG, "option1: error 4.08");
@@ -1976,7 +3535,16 @@ uint8_t CACheckBlockErrorType(CABlockData_t *currData, coap_block_t *receivedBlo
 
     // #3. check if error check logic is required
     size_t optionLen = dataLen - blockPayloadLen;
-    if (receivedBlock->m && blockPayloadLen != (size_t) BLOCK_SIZE(receivedBlock->szx))
+    bool isBERT = (CA_BLOCK_SIZE_BERT == receivedBlock->szx);
+    if (isBERT && receivedBlock->m && (0 == blockPayloadLen || blockPayloadLen % BERT_BLOCK_SIZE))
+    {
+        // a BERT message which is not the last one carries whole 1Kbyte blocks
+        OIC_LOG(ERROR, TAG, "error type 4.08");
+        OIC_LOG(ERROR, TAG, "payload len is not a multiple of 1Kbyte");
+        return CA_BLOCK_INCOMPLETE;
+    }
+    else if (!isBERT && receivedBlock->m &&
+             blockPayloadLen != (size_t) BLOCK_SIZE(receivedBlock->szx))
     {
         // 413 Error handling of too large entity
         if (COAP_MAX_PDU_SIZE < ((size_t)BLOCK_SIZE(receivedBlock->szx)) + optionLen)
@@ -2031,6 +3599,101 @@ uint8_t CACheckBlockErrorType(CABlockData_t *currData, coap_block_t *receivedBlo
     return CA_BLOCK_UNKNOWN;
 }
 
+// Make room for totalLen bytes of received payload. The buffer is allocated once when the
+// remote endpoint gave the total length with a size option and grows geometrically
+// otherwise, so the received payload is not copied again for every block.
+static CAResult_t CAReservePayload(CABlockData_t *currData, bool isSizeOption, size_t totalLen)
+{
+    if (totalLen <= currData->payloadCapacity)
+    {
+        return CA_STATUS_OK;
+    }
+
+    size_t capacity = 0;
+    if (isSizeOption && totalLen <= currData->payloadLength)
+    {
+        OIC_LOG(DEBUG, TAG, "allocate memory for the total payload");
+        capacity = currData->payloadLength;
+    }
+    else
+    {
+        OIC_LOG(DEBUG, TAG, "allocate memory for the received block payload");
+        capacity = currData->payloadCapacity ? currData->payloadCapacity
+                                             : (size_t) BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+        while (capacity < totalLen)
+        {
+            if (capacity > SIZE_MAX / 2)
+            {
+                capacity = totalLen;
+                break;
+            }
+            capacity *= 2;
+        }
+    }
+
+    CAPayload_t newPayload = OICRealloc(currData->payload, capacity);
+    if (NULL == newPayload)
+    {
+        OIC_LOG(ERROR, TAG, "out of memory");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+    currData->payload = newPayload;
+    currData->payloadCapacity = capacity;
+    return CA_STATUS_OK;
+}
+
+static void CAGetBlockDataCallbackArgs(const CAData_t *receivedData,
+                                       const CARequestInfo_t **requestInfo,
+                                       const CAResponseInfo_t **responseInfo)
+{
+    *requestInfo = receivedData->requestInfo;
+    *responseInfo = receivedData->requestInfo ? NULL : receivedData->responseInfo;
+}
+
+// Offer the first block of a transfer to the block data callback.
+static bool CAOfferBlockData(const CAData_t *receivedData, size_t totalLength,
+                             const uint8_t *data, size_t length)
+{
+    oc_mutex_lock(g_context.blockDataListMutex);
+    CABlockDataCallback callback = g_context.blockDataCallback;
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    if (!callback)
+    {
+        return false;
+    }
+
+    const CARequestInfo_t *requestInfo = NULL;
+    const CAResponseInfo_t *responseInfo = NULL;
+    CAGetBlockDataCallbackArgs(receivedData, &requestInfo, &responseInfo);
+
+    bool taken = callback(receivedData->remoteEndpoint, requestInfo, responseInfo, 0,
+                          data, length, totalLength);
+    OIC_LOG_V(DEBUG, TAG, "transfer is %s", taken ? "streamed" : "reassembled");
+    return taken;
+}
+
+static void CADeliverBlockData(const CAData_t *receivedData, size_t offset,
+                               size_t totalLength, const uint8_t *data, size_t length)
+{
+    oc_mutex_lock(g_context.blockDataListMutex);
+    CABlockDataCallback callback = g_context.blockDataCallback;
+    oc_mutex_unlock(g_context.blockDataListMutex);
+
+    if (!callback)
+    {
+        OIC_LOG(WARNING, TAG, "block data callback is gone, block is dropped");
+        return;
+    }
+
+    const CARequestInfo_t *requestInfo = NULL;
+    const CAResponseInfo_t *responseInfo = NULL;
+    CAGetBlockDataCallbackArgs(receivedData, &requestInfo, &responseInfo);
+
+    callback(receivedData->remoteEndpoint, requestInfo, responseInfo, offset,
+             data, length, totalLength);
+}
+
 CAResult_t CAUpdatePayloadData(CABlockData_t *currData, const CAData_t *receivedData,
                                uint8_t status, bool isSizeOption, uint16_t blockType)
 {
@@ -2055,47 +3718,31 @@ CAResult_t CAUpdatePayloadData(CABlockData_t *currData, const CAData_t *received
                 BLOCK_SIZE(currData->block2.szx) : BLOCK_SIZE(currData->block1.szx);
     }
 
-    // memory allocation for the received block payload
     size_t prePayloadLen = currData->receivedPayloadLen;
     if (blockPayload)
     {
-        if (currData->payloadLength)
+        // the first block decides if the transfer is delivered block by block
+        if (0 == prePayloadLen)
         {
-            // in case the block message has the size option
-            // allocate the memory for the total payload
-            if (isSizeOption)
-            {
-                CAPayload_t prePayload = currData->payload;
-
-                OIC_LOG(DEBUG, TAG, "allocate memory for the total payload");
-                currData->payload = (CAPayload_t) OICCalloc(1, currData->payloadLength);
-                if (NULL == currData->payload)
-                {
-                    OIC_LOG(ERROR, TAG, "out of memory");
-                    return CA_MEMORY_ALLOC_FAILED;
-                }
-                memcpy(currData->payload, prePayload, prePayloadLen);
-                OICFree(prePayload);
-            }
-
-            // update the total payload
-            memcpy(currData->payload + prePayloadLen, blockPayload, blockPayloadLen);
+            currData->streamed = CAOfferBlockData(receivedData, currData->payloadLength,
+                                                  blockPayload, blockPayloadLen);
         }
-        else
+        else if (currData->streamed)
         {
-            OIC_LOG(DEBUG, TAG, "allocate memory for the received block payload");
+            CADeliverBlockData(receivedData, prePayloadLen, currData->payloadLength,
+                               blockPayload, blockPayloadLen);
+        }
 
-            size_t totalPayloadLen = prePayloadLen + blockPayloadLen;
-            CAPayload_t newPayload = OICRealloc(currData->payload, totalPayloadLen);
-            if (NULL == newPayload)
+        if (!currData->streamed)
+        {
+            CAResult_t res = CAReservePayload(currData, isSizeOption,
+                                              prePayloadLen + blockPayloadLen);
+            if (CA_STATUS_OK != res)
             {
-                OIC_LOG(ERROR, TAG, "out of memory");
-                return CA_MEMORY_ALLOC_FAILED;
+                return res;
             }
 
             // update the total payload
-            memset(newPayload + prePayloadLen, 0, blockPayloadLen);
-            currData->payload = newPayload;
             memcpy(currData->payload + prePayloadLen, blockPayload, blockPayloadLen);
         }
 
@@ -2121,17 +3768,19 @@ CAData_t* CACreateNewDataSet(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint
     CARequestInfo_t* requestInfo = NULL;
     CAResponseInfo_t* responseInfo = NULL;
 
-    uint32_t code = pdu->transport_hdr->udp.code;
+    CAToken_t token = NULL;
+    uint8_t tokenLength = CAGetPDUToken(pdu, endpoint, &token);
+    uint32_t code = CAGetPDUCode(pdu, endpoint);
     if (CA_GET == code || CA_POST == code || CA_PUT == code || CA_DELETE == code)
     {
-        CAInfo_t responseData = { .tokenLength = (uint8_t)pdu->transport_hdr->udp.token_length };
+        CAInfo_t responseData = { .tokenLength = tokenLength };
         responseData.token = (CAToken_t) OICMalloc(responseData.tokenLength);
         if (!responseData.token)
         {
             OIC_LOG(ERROR, TAG, "out of memory");
             return NULL;
         }
-        memcpy(responseData.token, pdu->transport_hdr->udp.token, responseData.tokenLength);
+        memcpy(responseData.token, token, responseData.tokenLength);
 
         responseInfo = (CAResponseInfo_t*) OICCalloc(1, sizeof(CAResponseInfo_t));
         if (!responseInfo)
@@ -2144,14 +3793,14 @@ CAData_t* CACreateNewDataSet(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint
     }
     else
     {
-        CAInfo_t requestData = { .tokenLength = (uint8_t)pdu->transport_hdr->udp.token_length };
+        CAInfo_t requestData = { .tokenLength = tokenLength };
         requestData.token = (CAToken_t) OICMalloc(requestData.tokenLength);
         if (!requestData.token)
         {
             OIC_LOG(ERROR, TAG, "out of memory");
             return NULL;
         }
-        memcpy(requestData.token, pdu->transport_hdr->udp.token, requestData.tokenLength);
+        memcpy(requestData.token, token, requestData.tokenLength);
 
         requestInfo = (CARequestInfo_t*) OICCalloc(1, sizeof(CARequestInfo_t));
         if (!requestInfo)
@@ -2175,8 +3824,11 @@ CAData_t* CACreateNewDataSet(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint
 
         CAGetResponseInfoFromPDU(pdu, resInfo, endpoint);
         requestInfo->method = CA_GET;
-        requestInfo->info.messageId = CAGetMessageIdFromPduBinaryData(pdu->transport_hdr,
-                                                                      pdu->length);
+        if (COAP_UDP == CAGetPDUTransport(pdu, endpoint))
+        {
+            requestInfo->info.messageId = CAGetMessageIdFromPduBinaryData(pdu->transport_hdr,
+                                                                          pdu->length);
+        }
         requestInfo->info.resourceUri = OICStrdup(resInfo->info.resourceUri);
 
         // after copying the resource uri, destroy response info.
@@ -2356,17 +4008,13 @@ CAResult_t CAUpdateBlockOptionType(const CABlockDataID_t *blockID, uint16_t bloc
 
     oc_mutex_lock(g_context.blockDataListMutex);
 
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData)
     {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (CABlockidMatches(currData, blockID))
-        {
-            currData->type = blockType;
-            oc_mutex_unlock(g_context.blockDataListMutex);
-            OIC_LOG(DEBUG, TAG, "OUT-UpdateBlockOptionType");
-            return CA_STATUS_OK;
-        }
+        currData->type = blockType;
+        oc_mutex_unlock(g_context.blockDataListMutex);
+        OIC_LOG(DEBUG, TAG, "OUT-UpdateBlockOptionType");
+        return CA_STATUS_OK;
     }
     oc_mutex_unlock(g_context.blockDataListMutex);
 
@@ -2381,16 +4029,13 @@ uint16_t CAGetBlockOptionType(const CABlockDataID_t *blockID)
 
     oc_mutex_lock(g_context.blockDataListMutex);
 
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData)
     {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (CABlockidMatches(currData, blockID))
-        {
-            oc_mutex_unlock(g_context.blockDataListMutex);
-            OIC_LOG(DEBUG, TAG, "OUT-GetBlockOptionType");
-            return currData->type;
-        }
+        uint16_t type = currData->type;
+        oc_mutex_unlock(g_context.blockDataListMutex);
+        OIC_LOG(DEBUG, TAG, "OUT-GetBlockOptionType");
+        return type;
     }
     oc_mutex_unlock(g_context.blockDataListMutex);
 
@@ -2403,20 +4048,11 @@ CAData_t *CAGetDataSetFromBlockDataList(const CABlockDataID_t *blockID)
     VERIFY_NON_NULL_RET(blockID, TAG, "blockID", NULL);
 
     oc_mutex_lock(g_context.blockDataListMutex);
-
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
-    {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (CABlockidMatches(currData, blockID))
-        {
-            oc_mutex_unlock(g_context.blockDataListMutex);
-            return currData->sentData;
-        }
-    }
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    CAData_t *sentData = currData ? currData->sentData : NULL;
     oc_mutex_unlock(g_context.blockDataListMutex);
 
-    return NULL;
+    return sentData;
 }
 
 CABlockData_t *CAUpdateDataSetFromBlockDataList(const CABlockDataID_t *blockID,
@@ -2427,21 +4063,15 @@ CABlockData_t *CAUpdateDataSetFromBlockDataList(const CABlockDataID_t *blockID,
 
     oc_mutex_lock(g_context.blockDataListMutex);
 
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData)
     {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (CABlockidMatches(currData, blockID))
-        {
-            CADestroyDataSet(currData->sentData);
-            currData->sentData = CACloneCAData(sendData);
-            oc_mutex_unlock(g_context.blockDataListMutex);
-            return currData;
-        }
+        CADestroyDataSet(currData->sentData);
+        currData->sentData = CACloneCAData(sendData);
     }
     oc_mutex_unlock(g_context.blockDataListMutex);
 
-    return NULL;
+    return currData;
 }
 
 CAResult_t CAGetTokenFromBlockDataList(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
@@ -2454,18 +4084,15 @@ CAResult_t CAGetTokenFromBlockDataList(const coap_pdu_t *pdu, const CAEndpoint_t
 
     oc_mutex_lock(g_context.blockDataListMutex);
 
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
+    // the block data are keyed by token, so all of them are looked at for the message id
+    for (OCHashLink *link = OCHashTableFirstEntry(&g_context.dataTable); link;
+         link = OCHashTableNextEntry(&g_context.dataTable, link))
     {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (NULL == currData)
-        {
-            continue;
-        }
-
+        CABlockData_t *currData = OC_HASH_ENTRY(link, CABlockData_t, link);
         if (NULL != currData->sentData && NULL != currData->sentData->requestInfo)
         {
-            if (pdu->transport_hdr->udp.id == currData->sentData->requestInfo->info.messageId &&
+            if (pdu->transport_hdr->udp.id ==
+                    currData->sentData->requestInfo->info.messageId &&
                     endpoint->adapter == currData->sentData->remoteEndpoint->adapter)
             {
                 if (NULL != currData->sentData->requestInfo->info.token)
@@ -2479,7 +4106,8 @@ CAResult_t CAGetTokenFromBlockDataList(const coap_pdu_t *pdu, const CAEndpoint_t
                         oc_mutex_unlock(g_context.blockDataListMutex);
                         return CA_MEMORY_ALLOC_FAILED;
                     }
-                    memcpy(responseInfo->info.token, currData->sentData->requestInfo->info.token,
+                    memcpy(responseInfo->info.token,
+                           currData->sentData->requestInfo->info.token,
                            responseInfo->info.tokenLength);
 
                     oc_mutex_unlock(g_context.blockDataListMutex);
@@ -2533,20 +4161,10 @@ CABlockData_t *CAGetBlockDataFromBlockDataList(const CABlockDataID_t *blockID)
     VERIFY_NON_NULL_RET(blockID, TAG, "blockID", NULL);
 
     oc_mutex_lock(g_context.blockDataListMutex);
-
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
-    {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (CABlockidMatches(currData, blockID))
-        {
-            oc_mutex_unlock(g_context.blockDataListMutex);
-            return currData;
-        }
-    }
+    CABlockData_t *currData = CAFindBlockData(blockID);
     oc_mutex_unlock(g_context.blockDataListMutex);
 
-    return NULL;
+    return currData;
 }
 
 coap_block_t *CAGetBlockOption(const CABlockDataID_t *blockID, uint16_t blockType)
@@ -2556,23 +4174,20 @@ coap_block_t *CAGetBlockOption(const CABlockDataID_t *blockID, uint16_t blockTyp
 
     oc_mutex_lock(g_context.blockDataListMutex);
 
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData)
     {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (CABlockidMatches(currData, blockID))
+        oc_mutex_unlock(g_context.blockDataListMutex);
+        OIC_LOG(DEBUG, TAG, "OUT-GetBlockOption");
+        if (COAP_OPTION_BLOCK2 == blockType)
         {
-            oc_mutex_unlock(g_context.blockDataListMutex);
-            OIC_LOG(DEBUG, TAG, "OUT-GetBlockOption");
-            if (COAP_OPTION_BLOCK2 == blockType)
-            {
-                return &currData->block2;
-            }
-            else if (COAP_OPTION_BLOCK1 == blockType)
-            {
-                return &currData->block1;
-            }
+            return &currData->block2;
+        }
+        else if (COAP_OPTION_BLOCK1 == blockType)
+        {
+            return &currData->block1;
         }
+        return NULL;
     }
     oc_mutex_unlock(g_context.blockDataListMutex);
 
@@ -2589,17 +4204,14 @@ CAPayload_t CAGetPayloadFromBlockDataList(const CABlockDataID_t *blockID,
 
     oc_mutex_lock(g_context.blockDataListMutex);
 
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
+    CABlockData_t *currData = CAFindBlockData(blockID);
+    if (currData)
     {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (CABlockidMatches(currData, blockID))
-        {
-            oc_mutex_unlock(g_context.blockDataListMutex);
-            *fullPayloadLen = currData->receivedPayloadLen;
-            OIC_LOG(DEBUG, TAG, "OUT-GetFullPayload");
-            return currData->payload;
-        }
+        *fullPayloadLen = currData->receivedPayloadLen;
+        CAPayload_t payload = currData->payload;
+        oc_mutex_unlock(g_context.blockDataListMutex);
+        OIC_LOG(DEBUG, TAG, "OUT-GetFullPayload");
+        return payload;
     }
     oc_mutex_unlock(g_context.blockDataListMutex);
 
@@ -2630,6 +4242,15 @@ CABlockData_t *CACreateNewBlockData(const CAData_t *sendData)
         return NULL;
     }
 
+    // several 1Kbyte blocks go in one message when the peer supports BERT
+    size_t maxPayload = 0;
+    CAGetBlockLimits(data->sentData->remoteEndpoint, &maxPayload, &data->bertBlocks);
+    if (data->bertBlocks)
+    {
+        data->block1.szx = CA_BLOCK_SIZE_BERT;
+        data->block2.szx = CA_BLOCK_SIZE_BERT;
+    }
+
     CAToken_t token = NULL;
     uint8_t tokenLength = 0;
     if (data->sentData->requestInfo)
@@ -2664,16 +4285,15 @@ CABlockData_t *CACreateNewBlockData(const CAData_t *sendData)
         return NULL;
     }
     data->blockDataId = blockDataID;
+    data->lastActive = OICGetCurrentTime(TIME_IN_MS);
 
     oc_mutex_lock(g_context.blockDataListMutex);
 
-    bool res = u_arraylist_add(g_context.dataList, (void *) data);
-    if (!res)
+    if (!OCHashTableInsert(&g_context.dataTable, &data->link,
+                           CAHashBlockDataID(blockDataID)))
     {
         OIC_LOG(ERROR, TAG, "add has failed");
-        CADestroyBlockID(data->blockDataId);
-        CADestroyDataSet(data->sentData);
-        OICFree(data);
+        CADestroyBlockData(data);
         oc_mutex_unlock(g_context.blockDataListMutex);
         return NULL;
     }
@@ -2689,33 +4309,54 @@ CAResult_t CARemoveBlockDataFromList(const CABlockDataID_t *blockID)
     VERIFY_NON_NULL(blockID, TAG, "blockID");
 
     oc_mutex_lock(g_context.blockDataListMutex);
+    CABlockData_t *removedData = CAUnlinkBlockData(blockID);
+    oc_mutex_unlock(g_context.blockDataListMutex);
 
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = 0; i < len; i++)
+    if (removedData)
     {
-        CABlockData_t *currData = (CABlockData_t *) u_arraylist_get(g_context.dataList, i);
-        if (CABlockidMatches(currData, blockID))
+        // destroy memory, a payload producer may be released with the sent data
+        CADestroyBlockData(removedData);
+    }
+
+    return CA_STATUS_OK;
+}
+
+// Drop the block data of transfers the peer has given up on. Without this, the sent
+// data of a response whose remaining blocks are never asked for would be kept forever.
+static void CARemoveExpiredBlockData(void)
+{
+    uint64_t now = OICGetCurrentTime(TIME_IN_MS);
+    CABlockData_t *expired = NULL;
+
+    oc_mutex_lock(g_context.blockDataListMutex);
+    if (now >= g_nextExpiryCheck)
+    {
+        g_nextExpiryCheck = now + BLOCK_DATA_EXPIRY_CHECK_MS;
+
+        OCHashLink *next = NULL;
+        for (OCHashLink *link = OCHashTableFirstEntry(&g_context.dataTable); link; link = next)
         {
-            CABlockData_t *removedData = u_arraylist_remove(g_context.dataList, i);
-            if (!removedData)
+            next = OCHashTableNextEntry(&g_context.dataTable, link);
+            CABlockData_t *currData = OC_HASH_ENTRY(link, CABlockData_t, link);
+            if (now - currData->lastActive > BLOCK_DATA_LIFETIME_MS)
             {
-                OIC_LOG(ERROR, TAG, "data is NULL");
-                oc_mutex_unlock(g_context.blockDataListMutex);
-                return CA_STATUS_FAILED;
+                OCHashTableRemove(&g_context.dataTable, link);
+                // the link is free again, chain the expired data through it
+                link->next = expired ? &expired->link : NULL;
+                expired = currData;
             }
-
-            // destroy memory
-            CADestroyDataSet(removedData->sentData);
-            CADestroyBlockID(removedData->blockDataId);
-            OICFree(removedData->payload);
-            OICFree(removedData);
-            oc_mutex_unlock(g_context.blockDataListMutex);
-            return CA_STATUS_OK;
         }
     }
     oc_mutex_unlock(g_context.blockDataListMutex);
 
-    return CA_STATUS_OK;
+    while (expired)
+    {
+        CABlockData_t *currData = expired;
+        expired = currData->link.next ? OC_HASH_ENTRY(currData->link.next, CABlockData_t, link)
+                                      : NULL;
+        OIC_LOG(INFO, TAG, "block-wise transfer timed out");
+        CADestroyBlockData(currData);
+    }
 }
 
 CAResult_t CARemoveAllBlockDataFromList()
@@ -2724,21 +4365,11 @@ CAResult_t CARemoveAllBlockDataFromList()
 
     oc_mutex_lock(g_context.blockDataListMutex);
 
-    size_t len = u_arraylist_length(g_context.dataList);
-    for (size_t i = len; i > 0; i--)
+    OCHashLink *link = NULL;
+    while (NULL != (link = OCHashTablePop(&g_context.dataTable)))
     {
-        CABlockData_t *removedData = u_arraylist_remove(g_context.dataList, i - 1);
-        if (removedData)
-        {
-            // destroy memory
-            if (removedData->sentData)
-            {
-                CADestroyDataSet(removedData->sentData);
-            }
-            CADestroyBlockID(removedData->blockDataId);
-            OICFree(removedData->payload);
-            OICFree(removedData);
-        }
+        // destroy memory
+        CADestroyBlockData(OC_HASH_ENTRY(link, CABlockData_t, link));
     }
     oc_mutex_unlock(g_context.blockDataListMutex);
 
@@ -40,6 +40,10 @@
 #include "catcpadapter.h"
 #endif
 
+#ifdef WITH_BWT
+#include "cablockwisetransfer.h"
+#endif
+
 CAGlobals_t caglobals = { .clientFlags = 0,
                           .serverFlags = 0, };
 
@@ -137,6 +141,24 @@ void CARegisterHandler(CARequestCallback ReqHandler, CAResponseCallback RespHand
     CASetInterfaceCallbacks(ReqHandler, RespHandler, ErrorHandler);
 }
 
+CAResult_t CARegisterBlockDataHandler(CABlockDataCallback BlockHandler)
+{
+    OIC_LOG(DEBUG, TAG, "CARegisterBlockDataHandler");
+
+    if (!g_isInitialized)
+    {
+        return CA_STATUS_NOT_INITIALIZED;
+    }
+
+#ifdef WITH_BWT
+    CASetBlockDataCallback(BlockHandler);
+    return CA_STATUS_OK;
+#else
+    (void)(BlockHandler); // prevent unused-parameter warning
+    return CA_NOT_SUPPORTED;
+#endif
+}
+
 #if defined(__WITH_DTLS__) || defined(__WITH_TLS__)
 
 CAResult_t CAGetSecureEndpointData(const CAEndpoint_t *peer, CASecureEndpoint_t *sep)
@@ -228,6 +250,19 @@ CAResult_t CAregisterPkixInfoHandler(CAgetPkixInfoHandler getPkixInfoHandler)
     return CA_STATUS_OK;
 }
 
+CAResult_t CAinvalidateSslCredentials(void)
+{
+    OIC_LOG_V(DEBUG, TAG, "In %s", __func__);
+
+    if (!g_isInitialized)
+    {
+        return CA_STATUS_NOT_INITIALIZED;
+    }
+    CAsslInvalidateCredentials();
+    OIC_LOG_V(DEBUG, TAG, "Out %s", __func__);
+    return CA_STATUS_OK;
+}
+
 CAResult_t CAregisterGetCredentialTypesHandler(CAgetCredentialTypesHandler getCredTypesHandler)
 {
     OIC_LOG_V(DEBUG, TAG, "In %s", __func__);
@@ -341,10 +376,9 @@ static CAResult_t CASendMessageMultiAdapter(const CAEndpoint_t *object, const vo
     return ret;
 }
 
-CAResult_t CASendRequest(const CAEndpoint_t *object, const CARequestInfo_t *requestInfo)
+static CAResult_t CASendRequestInternal(const CAEndpoint_t *object,
+                                        const CARequestInfo_t *requestInfo)
 {
-    OIC_LOG(DEBUG, TAG, "CASendRequest");
-
     if (!g_isInitialized)
     {
         return CA_STATUS_NOT_INITIALIZED;
@@ -361,10 +395,29 @@ CAResult_t CASendRequest(const CAEndpoint_t *object, const CARequestInfo_t *requ
     }
 }
 
-CAResult_t CASendResponse(const CAEndpoint_t *object, const CAResponseInfo_t *responseInfo)
+CAResult_t CASendRequest(const CAEndpoint_t *object, const CARequestInfo_t *requestInfo)
 {
-    OIC_LOG(DEBUG, TAG, "CASendResponse");
+    OIC_LOG(DEBUG, TAG, "CASendRequest");
+
+    if (!requestInfo || !requestInfo->info.payloadRelease)
+    {
+        return CASendRequestInternal(object, requestInfo);
+    }
+
+    // the queued clones share the producer, it is released when the last one is gone
+    CARequestInfo_t shared = *requestInfo;
+    CAResult_t res = CAAdoptPayloadProducer(&requestInfo->info, &shared.info);
+    if (CA_STATUS_OK == res)
+    {
+        res = CASendRequestInternal(object, &shared);
+        CADropPayloadProducer(&shared.info);
+    }
+    return res;
+}
 
+static CAResult_t CASendResponseInternal(const CAEndpoint_t *object,
+                                         const CAResponseInfo_t *responseInfo)
+{
     if (!g_isInitialized)
     {
         return CA_STATUS_NOT_INITIALIZED;
@@ -386,6 +439,26 @@ CAResult_t CASendResponse(const CAEndpoint_t *object, const CAResponseInfo_t *re
     }
 }
 
+CAResult_t CASendResponse(const CAEndpoint_t *object, const CAResponseInfo_t *responseInfo)
+{
+    OIC_LOG(DEBUG, TAG, "CASendResponse");
+
+    if (!responseInfo || !responseInfo->info.payloadRelease)
+    {
+        return CASendResponseInternal(object, responseInfo);
+    }
+
+    // the queued clones share the producer, it is released when the last one is gone
+    CAResponseInfo_t shared = *responseInfo;
+    CAResult_t res = CAAdoptPayloadProducer(&responseInfo->info, &shared.info);
+    if (CA_STATUS_OK == res)
+    {
+        res = CASendResponseInternal(object, &shared);
+        CADropPayloadProducer(&shared.info);
+    }
+    return res;
+}
+
 CAResult_t CASelectNetwork(CATransportAdapter_t interestedNetwork)
 {
     if (!g_isInitialized)
@@ -505,6 +578,39 @@ CAResult_t CAHandleRequestResponse()
     return CA_STATUS_OK;
 }
 
+int CAGetWakeupFd()
+{
+    if (!g_isInitialized)
+    {
+        return -1;
+    }
+
+    return CAGetReceiveWakeupFd();
+}
+
+CAResult_t CAWakeup()
+{
+    if (!g_isInitialized)
+    {
+        return CA_STATUS_NOT_INITIALIZED;
+    }
+
+    CASignalReceiveWakeup();
+
+    return CA_STATUS_OK;
+}
+
+CAResult_t CAWaitForWakeup(uint32_t timeoutMs)
+{
+    if (!g_isInitialized)
+    {
+        OIC_LOG(ERROR, TAG, "not initialized");
+        return CA_STATUS_NOT_INITIALIZED;
+    }
+
+    return CAWaitReceiveWakeup(timeoutMs) ? CA_STATUS_OK : CA_STATUS_FAILED;
+}
+
 CAResult_t CASelectCipherSuite(const uint16_t cipher, CATransportAdapter_t adapter)
 {
     (void)(adapter); // prevent unused-parameter warning when building release variant
@@ -18,10 +18,12 @@
  *
  ******************************************************************/
 
+#include "iotivity_config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <limits.h>
 
 #include "cainterface.h"
 #include "camessagehandler.h"
@@ -38,6 +40,7 @@
 #include "cainterfacecontroller.h"
 #include "caretransmission.h"
 #include "oic_string.h"
+#include "ochashtable.h"
 
 #ifdef WITH_BWT
 #include "cablockwisetransfer.h"
@@ -48,6 +51,21 @@
 #include "cathreadpool.h" /* for thread pool */
 #include "caqueueingthread.h"
 
+#if defined(HAVE_SYS_POLL_H) && defined(HAVE_UNISTD_H) && \
+    (defined(HAVE_SYS_EVENTFD_H) || defined(HAVE_FCNTL_H))
+#define CA_WAKEUP_FD
+#include <errno.h>
+#include <unistd.h>
+#include <sys/poll.h>
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#else
+#include <fcntl.h>
+#endif
+#else
+#include "ocevent.h"
+#endif
+
 #if defined(TCP_ADAPTER) && defined(WITH_CLOUD)
 #include "caconnectionmanager.h"
 #endif
@@ -61,6 +79,24 @@ static ca_thread_pool_t g_threadPoolHandle = NULL;
 static CAQueueingThread_t g_sendThread;
 static CAQueueingThread_t g_receiveThread;
 
+/**
+ * Queues that hand requests to entity handlers on their own threads, or NULL when requests
+ * are dispatched from CAHandleRequestResponse() like responses are.
+ */
+static CAQueueingThread_t *g_dispatchShards = NULL;
+static size_t g_dispatchShardCount = 0;
+
+/**
+ * Signalled whenever CAHandleRequestResponse() has work queued, so that the stack can block
+ * instead of polling. With eventfd both ends are the same descriptor; otherwise it is a pipe.
+ */
+#ifdef CA_WAKEUP_FD
+static int g_wakeupReadFd = -1;
+static int g_wakeupWriteFd = -1;
+#else
+static oc_event g_wakeupEvent = NULL;
+#endif
+
 #else
 #define CA_MAX_RT_ARRAY_SIZE    3
 #endif  // SINGLE_THREAD
@@ -101,6 +137,222 @@ static bool CADropSecondMessage(CAHistory_t *history, const CAEndpoint_t *endpoi
  */
 static void CALogPDUInfo(const CAData_t *data, const coap_pdu_t *pdu);
 
+#ifndef SINGLE_THREAD
+/**
+ * Call the handler registered for the request, response or error in data.
+ */
+static void CADispatchReceivedData(const CAData_t *data)
+{
+    if (data->requestInfo && g_requestHandler)
+    {
+        OIC_LOG_V(DEBUG, TAG, "request callback : %d", data->requestInfo->info.numOptions);
+        g_requestHandler(data->remoteEndpoint, data->requestInfo);
+    }
+    else if (data->responseInfo && g_responseHandler)
+    {
+        OIC_LOG_V(DEBUG, TAG, "response callback : %d", data->responseInfo->info.numOptions);
+        g_responseHandler(data->remoteEndpoint, data->responseInfo);
+    }
+    else if (data->errorInfo && g_errorHandler)
+    {
+        OIC_LOG_V(DEBUG, TAG, "error callback error: %d", data->errorInfo->result);
+        g_errorHandler(data->remoteEndpoint, data->errorInfo);
+    }
+}
+
+static void CADispatchThreadProcess(void *threadData)
+{
+    CAData_t *data = (CAData_t *) threadData;
+    OIC_TRACE_BEGIN(%s:CADispatchReceivedData, TAG);
+    CADispatchReceivedData(data);
+    OIC_TRACE_END();
+}
+
+/**
+ * Pick the dispatch shard of a request from the path of its resource, so that requests
+ * to one resource are handled in the order they arrived. Requests to the security
+ * resources share one shard because those resources depend on each other.
+ */
+static size_t CAGetDispatchShard(const CARequestInfo_t *requestInfo)
+{
+    static const char securityPrefix[] = "/oic/sec/";
+
+    const char *uri = requestInfo->info.resourceUri ? requestInfo->info.resourceUri : "";
+    size_t length = strcspn(uri, "?");
+    if (length >= sizeof(securityPrefix) - 1 &&
+        0 == strncmp(uri, securityPrefix, sizeof(securityPrefix) - 1))
+    {
+        length = sizeof(securityPrefix) - 1;
+    }
+
+    return OCHashBytes(OC_HASH_INIT, uri, length) % g_dispatchShardCount;
+}
+
+/**
+ * Queue received data for its handler. Requests go to their dispatch shard when sharded
+ * dispatch is enabled; everything else waits for CAHandleRequestResponse().
+ */
+static void CAAddReceiveData(CAData_t *data)
+{
+    if (g_dispatchShards && data->requestInfo)
+    {
+        size_t shard = CAGetDispatchShard(data->requestInfo);
+        CAQueueingThreadAddData(&g_dispatchShards[shard], data, sizeof(CAData_t));
+        return;
+    }
+    CAQueueingThreadAddData(&g_receiveThread, data, sizeof(CAData_t));
+    CASignalReceiveWakeup();
+}
+
+static CAResult_t CACreateReceiveWakeup()
+{
+#ifdef CA_WAKEUP_FD
+#ifdef HAVE_SYS_EVENTFD_H
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (-1 == fd)
+    {
+        OIC_LOG_V(ERROR, TAG, "eventfd failed: %s", strerror(errno));
+        return CA_STATUS_FAILED;
+    }
+    g_wakeupReadFd = fd;
+    g_wakeupWriteFd = fd;
+#else
+    int fds[2];
+    if (-1 == pipe(fds))
+    {
+        OIC_LOG_V(ERROR, TAG, "pipe failed: %s", strerror(errno));
+        return CA_STATUS_FAILED;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    g_wakeupReadFd = fds[0];
+    g_wakeupWriteFd = fds[1];
+#endif
+#else
+    g_wakeupEvent = oc_event_new();
+    if (NULL == g_wakeupEvent)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to create wakeup event");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+#endif
+    return CA_STATUS_OK;
+}
+
+static void CADestroyReceiveWakeup()
+{
+#ifdef CA_WAKEUP_FD
+    if (-1 != g_wakeupReadFd)
+    {
+        close(g_wakeupReadFd);
+    }
+    if (g_wakeupWriteFd != g_wakeupReadFd && -1 != g_wakeupWriteFd)
+    {
+        close(g_wakeupWriteFd);
+    }
+    g_wakeupReadFd = -1;
+    g_wakeupWriteFd = -1;
+#else
+    oc_event_free(g_wakeupEvent);
+    g_wakeupEvent = NULL;
+#endif
+}
+
+/**
+ * Clear a pending wakeup. Called before the receive queue is looked at, so that a signal
+ * for data queued after the look is never lost.
+ */
+static void CADrainReceiveWakeup()
+{
+#ifdef CA_WAKEUP_FD
+    if (-1 == g_wakeupReadFd)
+    {
+        return;
+    }
+#ifdef HAVE_SYS_EVENTFD_H
+    uint64_t count = 0;
+    ssize_t len = read(g_wakeupReadFd, &count, sizeof(count));
+    (void)len;
+#else
+    char buf[64];
+    while (0 < read(g_wakeupReadFd, buf, sizeof(buf)))
+    {
+    }
+#endif
+#endif
+}
+#endif // SINGLE_THREAD
+
+int CAGetReceiveWakeupFd()
+{
+#ifdef CA_WAKEUP_FD
+    return g_wakeupReadFd;
+#else
+    return -1;
+#endif
+}
+
+void CASignalReceiveWakeup()
+{
+#ifdef CA_WAKEUP_FD
+    if (-1 == g_wakeupWriteFd)
+    {
+        return;
+    }
+#ifdef HAVE_SYS_EVENTFD_H
+    uint64_t one = 1;
+    ssize_t len = write(g_wakeupWriteFd, &one, sizeof(one));
+#else
+    // A full pipe is already readable, so EAGAIN loses nothing.
+    char one = 1;
+    ssize_t len = write(g_wakeupWriteFd, &one, sizeof(one));
+#endif
+    (void)len;
+#elif !defined(SINGLE_THREAD)
+    if (g_wakeupEvent)
+    {
+        oc_event_signal(g_wakeupEvent);
+    }
+#endif
+}
+
+bool CAWaitReceiveWakeup(uint32_t timeoutMs)
+{
+#ifdef CA_WAKEUP_FD
+    if (-1 == g_wakeupReadFd)
+    {
+        return false;
+    }
+    struct pollfd pfd = { .fd = g_wakeupReadFd, .events = POLLIN, .revents = 0 };
+    int timeout = (UINT32_MAX == timeoutMs) ? -1 :
+                  (timeoutMs > INT_MAX) ? INT_MAX : (int)timeoutMs;
+    int ret;
+    do
+    {
+        ret = poll(&pfd, 1, timeout);
+    } while (-1 == ret && EINTR == errno);
+    return 0 < ret;
+#elif !defined(SINGLE_THREAD)
+    if (NULL == g_wakeupEvent)
+    {
+        return false;
+    }
+    if (UINT32_MAX == timeoutMs)
+    {
+        oc_event_wait(g_wakeupEvent);
+        return true;
+    }
+    return OC_WAIT_SUCCESS == oc_event_wait_for(g_wakeupEvent, timeoutMs);
+#else
+    // Single threaded builds read the adapters from CAHandleRequestResponse() itself.
+    (void)timeoutMs;
+    return true;
+#endif
+}
+
 #ifdef WITH_BWT
 void CAAddDataToSendThread(CAData_t *data)
 {
@@ -115,7 +367,7 @@ void CAAddDataToReceiveThread(CAData_t *data)
     VERIFY_NON_NULL_VOID(data, TAG, "data");
 
     // add thread
-    CAQueueingThreadAddData(&g_receiveThread, data, sizeof(CAData_t));
+    CAAddReceiveData(data);
 }
 #endif
 
@@ -333,7 +585,7 @@ static void CATimeoutCallback(const CAEndpoint_t *endpoint, const void *pdu, uin
 #ifdef SINGLE_THREAD
     CAProcessReceivedData(cadata);
 #else
-    CAQueueingThreadAddData(&g_receiveThread, cadata, sizeof(CAData_t));
+    CAAddReceiveData(cadata);
 #endif
 }
 
@@ -472,7 +724,12 @@ static CAResult_t CAProcessMulticastData(const CAData_t *data)
     }
 
 #ifdef WITH_BWT
-    if (CAIsSupportedBlockwiseTransfer(data->remoteEndpoint->adapter))
+    // a CoAP over TCP pdu has its options already
+    if (CAIsSupportedBlockwiseTransfer(data->remoteEndpoint->adapter)
+#ifdef WITH_TCP
+        && !CAIsSupportedCoAPOverTCP(data->remoteEndpoint->adapter)
+#endif
+        )
     {
         // Blockwise transfer
         res = CAAddBlockOption(&pdu, info, data->remoteEndpoint, &options);
@@ -504,6 +761,22 @@ exit:
     return res;
 }
 
+// CoAP over TCP carries its length in the header, so the block options and the part of
+// the payload for the block are put in the pdu when it is generated.
+static coap_pdu_t *CAGenerateUnicastPDU(uint32_t code, const CAInfo_t *info,
+                                        const CAEndpoint_t *endpoint, coap_list_t **options,
+                                        coap_transport_t *transport)
+{
+#if defined(WITH_BWT) && defined(WITH_TCP)
+    if (CAIsSupportedBlockwiseTransfer(endpoint->adapter) &&
+        CAIsSupportedCoAPOverTCP(endpoint->adapter))
+    {
+        return CAGenerateBlockPDU(code, info, endpoint, options, transport);
+    }
+#endif
+    return CAGeneratePDU(code, info, endpoint, options, transport);
+}
+
 static CAResult_t CAProcessSendData(const CAData_t *data)
 {
     VERIFY_NON_NULL(data, TAG, "data");
@@ -538,8 +811,8 @@ static CAResult_t CAProcessSendData(const CAData_t *data)
 #ifdef ROUTING_GATEWAY
             skipRetransmission = data->requestInfo->info.skipRetransmission;
 #endif
-            pdu = CAGeneratePDU(data->requestInfo->method, info, data->remoteEndpoint,
-                                &options, &transport);
+            pdu = CAGenerateUnicastPDU(data->requestInfo->method, info, data->remoteEndpoint,
+                                       &options, &transport);
         }
         else if (NULL != data->responseInfo)
         {
@@ -549,8 +822,8 @@ static CAResult_t CAProcessSendData(const CAData_t *data)
 #ifdef ROUTING_GATEWAY
             skipRetransmission = data->responseInfo->info.skipRetransmission;
 #endif
-            pdu = CAGeneratePDU(data->responseInfo->result, info, data->remoteEndpoint,
-                                &options, &transport);
+            pdu = CAGenerateUnicastPDU(data->responseInfo->result, info, data->remoteEndpoint,
+                                       &options, &transport);
         }
         else
         {
@@ -562,7 +835,11 @@ static CAResult_t CAProcessSendData(const CAData_t *data)
         if (NULL != pdu)
         {
 #ifdef WITH_BWT
-            if (CAIsSupportedBlockwiseTransfer(data->remoteEndpoint->adapter))
+            if (CAIsSupportedBlockwiseTransfer(data->remoteEndpoint->adapter)
+#ifdef WITH_TCP
+                && !CAIsSupportedCoAPOverTCP(data->remoteEndpoint->adapter)
+#endif
+                )
             {
                 // Blockwise transfer
                 if (NULL != info)
@@ -827,7 +1104,7 @@ static void CAReceivedPacketCallback(const CASecureEndpoint_t *sep,
         if (CA_NOT_SUPPORTED == res || CA_REQUEST_TIMEOUT == res)
         {
             OIC_LOG(DEBUG, TAG, "this message does not have block option");
-            CAQueueingThreadAddData(&g_receiveThread, cadata, sizeof(CAData_t));
+            CAAddReceiveData(cadata);
         }
         else
         {
@@ -837,7 +1114,7 @@ static void CAReceivedPacketCallback(const CASecureEndpoint_t *sep,
     else
 #endif
     {
-        CAQueueingThreadAddData(&g_receiveThread, cadata, sizeof(CAData_t));
+        CAAddReceiveData(cadata);
     }
 #endif // SINGLE_THREAD
 
@@ -861,36 +1138,28 @@ void CAHandleRequestResponseCallbacks()
     // #1 parse the data
     // #2 get endpoint
 
+    CADrainReceiveWakeup();
+
     oc_mutex_lock(g_receiveThread.threadMutex);
 
     u_queue_message_t *item = u_queue_get_element(g_receiveThread.dataQueue);
+    bool more = (0 < u_queue_get_size(g_receiveThread.dataQueue));
 
     oc_mutex_unlock(g_receiveThread.threadMutex);
 
-    if (NULL == item || NULL == item->msg)
+    // Only one item is handled per call; keep the wakeup pending for the rest.
+    if (more)
     {
-        return;
+        CASignalReceiveWakeup();
     }
 
-    // get endpoint
-    CAData_t *td = (CAData_t *) item->msg;
-
-    if (td->requestInfo && g_requestHandler)
-    {
-        OIC_LOG_V(DEBUG, TAG, "request callback : %d", td->requestInfo->info.numOptions);
-        g_requestHandler(td->remoteEndpoint, td->requestInfo);
-    }
-    else if (td->responseInfo && g_responseHandler)
-    {
-        OIC_LOG_V(DEBUG, TAG, "response callback : %d", td->responseInfo->info.numOptions);
-        g_responseHandler(td->remoteEndpoint, td->responseInfo);
-    }
-    else if (td->errorInfo && g_errorHandler)
+    if (NULL == item || NULL == item->msg)
     {
-        OIC_LOG_V(DEBUG, TAG, "error callback error: %d", td->errorInfo->result);
-        g_errorHandler(td->remoteEndpoint, td->errorInfo);
+        return;
     }
 
+    CADispatchReceivedData((CAData_t *) item->msg);
+
     CADestroyData(item->msg, sizeof(CAData_t));
     OICFree(item);
 
@@ -984,7 +1253,7 @@ CAResult_t CADetachSendMessage(const CAEndpoint_t *endpoint, const void *sendMsg
 
 #ifdef ARDUINO
     // If max retransmission queue is reached, then don't handle new request
-    if (CA_MAX_RT_ARRAY_SIZE == u_arraylist_length(g_retransmissionContext.dataList))
+    if (CA_MAX_RT_ARRAY_SIZE == g_retransmissionContext.dataCount)
     {
         OIC_LOG(ERROR, TAG, "max RT queue size reached!");
         return CA_SEND_FAILED;
@@ -1024,7 +1293,7 @@ CAResult_t CADetachSendMessage(const CAEndpoint_t *endpoint, const void *sendMsg
     {
         OIC_LOG(DEBUG, TAG,
                 "This is a loopback message. Transfer it to the receive queue directly");
-        CAQueueingThreadAddData(&g_receiveThread, data, sizeof(CAData_t));
+        CAAddReceiveData(data);
         return CA_STATUS_OK;
     }
 #ifdef WITH_BWT
@@ -1067,6 +1336,71 @@ void CASetNetworkMonitorCallback(CANetworkMonitorCallback nwMonitorHandler)
     g_nwMonitorHandler = nwMonitorHandler;
 }
 
+#ifndef SINGLE_THREAD
+static CAResult_t CAStartDispatchShards()
+{
+    if (0 >= caglobals.dispatchShardCount)
+    {
+        return CA_STATUS_OK;
+    }
+
+    size_t count = (size_t)caglobals.dispatchShardCount;
+    CAQueueingThread_t *shards = (CAQueueingThread_t *)OICCalloc(count, sizeof(*shards));
+    if (!shards)
+    {
+        OIC_LOG(ERROR, TAG, "Memory allocation failed! (dispatch shards)");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        CAResult_t res = CAQueueingThreadInitialize(&shards[i], g_threadPoolHandle,
+                                                    CADispatchThreadProcess, CADestroyData);
+        if (CA_STATUS_OK == res)
+        {
+            res = CAQueueingThreadStart(&shards[i]);
+        }
+        if (CA_STATUS_OK != res)
+        {
+            for (size_t j = 0; j <= i; j++)
+            {
+                if (shards[j].threadMutex)
+                {
+                    CAQueueingThreadStop(&shards[j]);
+                    CAQueueingThreadDestroy(&shards[j]);
+                }
+            }
+            OICFree(shards);
+            return res;
+        }
+    }
+
+    OIC_LOG_V(INFO, TAG, "Dispatching requests on %d threads", caglobals.dispatchShardCount);
+    g_dispatchShardCount = count;
+    g_dispatchShards = shards;
+    return CA_STATUS_OK;
+}
+
+static void CAStopDispatchShards()
+{
+    for (size_t i = 0; g_dispatchShards && i < g_dispatchShardCount; i++)
+    {
+        CAQueueingThreadStop(&g_dispatchShards[i]);
+    }
+}
+
+static void CADestroyDispatchShards()
+{
+    for (size_t i = 0; g_dispatchShards && i < g_dispatchShardCount; i++)
+    {
+        CAQueueingThreadDestroy(&g_dispatchShards[i]);
+    }
+    OICFree(g_dispatchShards);
+    g_dispatchShards = NULL;
+    g_dispatchShardCount = 0;
+}
+#endif // SINGLE_THREAD
+
 CAResult_t CAInitializeMessageHandler(CATransportAdapter_t transportType)
 {
     CASetPacketReceivedCallback(CAReceivedPacketCallback);
@@ -1074,13 +1408,22 @@ CAResult_t CAInitializeMessageHandler(CATransportAdapter_t transportType)
 
 #ifndef SINGLE_THREAD
     // create thread pool
-    CAResult_t res = ca_thread_pool_init(MAX_THREAD_POOL_SIZE, &g_threadPoolHandle);
+    int32_t threadPoolSize = (0 < caglobals.threadPoolSize) ? caglobals.threadPoolSize
+                                                             : MAX_THREAD_POOL_SIZE;
+    CAResult_t res = ca_thread_pool_init(threadPoolSize, &g_threadPoolHandle);
     if (CA_STATUS_OK != res)
     {
         OIC_LOG(ERROR, TAG, "thread pool initialize error.");
         return res;
     }
 
+    res = CACreateReceiveWakeup();
+    if (CA_STATUS_OK != res)
+    {
+        OIC_LOG(ERROR, TAG, "wakeup initialize error.");
+        return res;
+    }
+
     // send thread initialize
     res = CAQueueingThreadInitialize(&g_sendThread, g_threadPoolHandle,
                                      CASendThreadProcess, CADestroyData);
@@ -1117,6 +1460,13 @@ CAResult_t CAInitializeMessageHandler(CATransportAdapter_t transportType)
     }
 #endif // SINGLE_HANDLE
 
+    res = CAStartDispatchShards();
+    if (CA_STATUS_OK != res)
+    {
+        OIC_LOG(ERROR, TAG, "thread start error(dispatch shards).");
+        return res;
+    }
+
     // retransmission initialize
     res = CARetransmissionInitialize(&g_retransmissionContext, g_threadPoolHandle,
                                      CASendUnicastData, CATimeoutCallback, NULL);
@@ -1195,6 +1545,8 @@ void CATerminateMessageHandler()
 #endif
     }
 
+    CAStopDispatchShards();
+
     // destroy thread pool
     if (NULL != g_threadPoolHandle)
     {
@@ -1208,6 +1560,8 @@ void CATerminateMessageHandler()
     CARetransmissionDestroy(&g_retransmissionContext);
     CAQueueingThreadDestroy(&g_sendThread);
     CAQueueingThreadDestroy(&g_receiveThread);
+    CADestroyDispatchShards();
+    CADestroyReceiveWakeup();
 
     // terminate interface adapters by controller
     CATerminateAdapters();
@@ -1324,7 +1678,7 @@ void CAErrorHandler(const CAEndpoint_t *endpoint,
 
     cadata->errorInfo->result = result;
 
-    CAQueueingThreadAddData(&g_receiveThread, cadata, sizeof(CAData_t));
+    CAAddReceiveData(cadata);
     coap_delete_pdu(pdu);
 #else
     (void)result;
@@ -1377,7 +1731,7 @@ static void CASendErrorInfo(const CAEndpoint_t *endpoint, const CAInfo_t *info,
     cadata->errorInfo = errorInfo;
     cadata->dataType = CA_ERROR_DATA;
 
-    CAQueueingThreadAddData(&g_receiveThread, cadata, sizeof(CAData_t));
+    CAAddReceiveData(cadata);
 #endif
     OIC_LOG(DEBUG, TAG, "CASendErrorInfo OUT");
 }
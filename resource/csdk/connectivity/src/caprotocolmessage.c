@@ -406,10 +406,73 @@ coap_pdu_t *CAGeneratePDUImpl(code_t code, const CAInfo_t *info,
         coap_add_data(pdu, (unsigned int)info->payloadSize,
                       (const unsigned char*)info->payload);
     }
+    else if ((NULL != info->payloadProducer) && (0 < info->payloadSize))
+    {
+        OIC_LOG(DEBUG, TAG, "produced payload is added");
+        if (CA_STATUS_OK != CAAddPayloadToPDU(pdu, info, 0, info->payloadSize))
+        {
+            coap_delete_pdu(pdu);
+            return NULL;
+        }
+    }
 
     return pdu;
 }
 
+CAResult_t CAAddPayloadToPDU(coap_pdu_t *pdu, const CAInfo_t *info, size_t offset,
+                             size_t length)
+{
+    VERIFY_NON_NULL(pdu, TAG, "pdu");
+    VERIFY_NON_NULL(info, TAG, "info");
+    VERIFY_TRUE((length <= UINT_MAX), TAG, "length");
+
+    if (0 == length)
+    {
+        return CA_STATUS_OK;
+    }
+
+    if (offset > info->payloadSize || length > info->payloadSize - offset)
+    {
+        OIC_LOG(ERROR, TAG, "part is out of the payload");
+        return CA_STATUS_INVALID_PARAM;
+    }
+
+    if (info->payload)
+    {
+        if (!coap_add_data(pdu, (unsigned int)length,
+                           (const unsigned char *)info->payload + offset))
+        {
+            OIC_LOG(ERROR, TAG, "coap_add_data has failed");
+            return CA_STATUS_FAILED;
+        }
+        return CA_STATUS_OK;
+    }
+
+    VERIFY_NON_NULL(info->payloadProducer, TAG, "info->payloadProducer");
+
+    uint8_t *part = (uint8_t *) OICMalloc(length);
+    if (!part)
+    {
+        OIC_LOG(ERROR, TAG, "out of memory");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+
+    CAResult_t res = CA_STATUS_OK;
+    if (!info->payloadProducer(info->payloadProducerContext, offset, part, length))
+    {
+        OIC_LOG_V(ERROR, TAG, "payload producer has failed at %" PRIuPTR, offset);
+        res = CA_STATUS_FAILED;
+    }
+    else if (!coap_add_data(pdu, (unsigned int)length, part))
+    {
+        OIC_LOG(ERROR, TAG, "coap_add_data has failed");
+        res = CA_STATUS_FAILED;
+    }
+
+    OICFree(part);
+    return res;
+}
+
 CAResult_t CAParseURI(const char *uriInfo, coap_list_t **optlist)
 {
     VERIFY_NON_NULL(uriInfo, TAG, "uriInfo");
@@ -718,6 +781,7 @@ CAResult_t CAGetOptionCount(coap_opt_iterator_t opt_iter, uint8_t *optionCount)
     {
         if (COAP_OPTION_URI_PATH != opt_iter.type && COAP_OPTION_URI_QUERY != opt_iter.type
             && COAP_OPTION_BLOCK1 != opt_iter.type && COAP_OPTION_BLOCK2 != opt_iter.type
+            && CA_OPTION_Q_BLOCK1 != opt_iter.type && CA_OPTION_Q_BLOCK2 != opt_iter.type
             && COAP_OPTION_SIZE1 != opt_iter.type && COAP_OPTION_SIZE2 != opt_iter.type
             && COAP_OPTION_URI_HOST != opt_iter.type && COAP_OPTION_URI_PORT != opt_iter.type
             && COAP_OPTION_ETAG != opt_iter.type && COAP_OPTION_MAXAGE != opt_iter.type
@@ -919,6 +983,7 @@ CAResult_t CAGetInfoFromPDU(const coap_pdu_t *pdu, const CAEndpoint_t *endpoint,
                 }
             }
             else if (COAP_OPTION_BLOCK1 == opt_iter.type || COAP_OPTION_BLOCK2 == opt_iter.type
+                    || CA_OPTION_Q_BLOCK1 == opt_iter.type || CA_OPTION_Q_BLOCK2 == opt_iter.type
                     || COAP_OPTION_SIZE1 == opt_iter.type || COAP_OPTION_SIZE2 == opt_iter.type)
             {
                 OIC_LOG_V(DEBUG, TAG, "option[%d] will be filtering", opt_iter.type);
@@ -1304,6 +1369,9 @@ CAPayloadFormat_t CAConvertFormat(uint16_t format)
 bool CAIsSupportedBlockwiseTransfer(CATransportAdapter_t adapter)
 {
     if (CA_ADAPTER_IP & adapter || CA_ADAPTER_NFC & adapter
+#ifdef WITH_TCP
+            || CA_ADAPTER_TCP & adapter
+#endif
             || CA_DEFAULT_ADAPTER == adapter)
     {
         return true;
@@ -1324,4 +1392,126 @@ bool CAIsSupportedCoAPOverTCP(CATransportAdapter_t adapter)
     OIC_LOG_V(INFO, TAG, "adapter value of CoAP/TCP is %d", adapter);
     return false;
 }
+
+bool CAIsSignalingMessage(const void *pdu, size_t size)
+{
+    if (NULL == pdu || 0 == size)
+    {
+        return false;
+    }
+
+    // The code is the last byte of every CoAP over TCP header.
+    coap_transport_t transport =
+        coap_get_tcp_header_type_from_initbyte(((const unsigned char *)pdu)[0] >> 4);
+    size_t headerLength = coap_get_tcp_header_length_for_transport(transport);
+    if (headerLength > size)
+    {
+        return false;
+    }
+    return CA_RESPONSE_CLASS(COAP_RESPONSE_CODE(CA_SIGNALING_CSM)) ==
+           CA_RESPONSE_CLASS(((const unsigned char *)pdu)[headerLength - 1]);
+}
+
+coap_pdu_t *CAGenerateCSMPDU(uint32_t maxMessageSize, bool blockWiseTransfer,
+                             coap_transport_t *transport)
+{
+    VERIFY_NON_NULL_RET(transport, TAG, "transport", NULL);
+
+    unsigned char maxSize[sizeof(uint32_t)];
+    unsigned int maxSizeLength = coap_encode_var_bytes(maxSize, maxMessageSize);
+
+    size_t msgLength = coap_get_opt_header_length(CA_OPTION_MAX_MESSAGE_SIZE, maxSizeLength);
+    if (blockWiseTransfer)
+    {
+        msgLength += coap_get_opt_header_length(
+                CA_OPTION_BLOCK_WISE_TRANSFER - CA_OPTION_MAX_MESSAGE_SIZE, 0);
+    }
+
+    *transport = coap_get_tcp_header_type_from_size((unsigned int)msgLength);
+    size_t length = msgLength + coap_get_tcp_header_length_for_transport(*transport);
+
+    coap_pdu_t *pdu = coap_pdu_init2(0, 0, ntohs((unsigned short)COAP_INVALID_TID),
+                                     length, *transport);
+    if (NULL == pdu)
+    {
+        OIC_LOG(ERROR, TAG, "malloc failed");
+        return NULL;
+    }
+
+    coap_add_length(pdu, *transport, (unsigned int)msgLength);
+    coap_add_code(pdu, *transport, CA_SIGNALING_CSM);
+
+    if (0 == coap_add_option2(pdu, CA_OPTION_MAX_MESSAGE_SIZE, maxSizeLength, maxSize,
+                              *transport)
+        || (blockWiseTransfer
+            && 0 == coap_add_option2(pdu, CA_OPTION_BLOCK_WISE_TRANSFER, 0, maxSize,
+                                     *transport)))
+    {
+        OIC_LOG(ERROR, TAG, "coap_add_option2 has failed");
+        coap_delete_pdu(pdu);
+        return NULL;
+    }
+
+    OIC_LOG_V(DEBUG, TAG, "CSM: Max-Message-Size[%u], Block-Wise-Transfer[%d]",
+              maxMessageSize, blockWiseTransfer);
+    return pdu;
+}
+
+CAResult_t CAParseCSM(const void *pdu, size_t size, uint32_t *maxMessageSize,
+                      bool *blockWiseTransfer)
+{
+    VERIFY_NON_NULL(pdu, TAG, "pdu");
+    VERIFY_NON_NULL(maxMessageSize, TAG, "maxMessageSize");
+    VERIFY_NON_NULL(blockWiseTransfer, TAG, "blockWiseTransfer");
+    VERIFY_TRUE((size <= UINT_MAX), TAG, "size");
+
+    if (!CAIsSignalingMessage(pdu, size))
+    {
+        return CA_NOT_SUPPORTED;
+    }
+
+    coap_transport_t transport =
+        coap_get_tcp_header_type_from_initbyte(((const unsigned char *)pdu)[0] >> 4);
+    coap_pdu_t *outpdu = coap_pdu_init2(0, 0, ntohs((unsigned short)COAP_INVALID_TID),
+                                        size, transport);
+    if (NULL == outpdu)
+    {
+        OIC_LOG(ERROR, TAG, "outpdu is null");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+
+    CAResult_t res = CA_STATUS_OK;
+    if (0 >= coap_pdu_parse2((unsigned char *)pdu, size, outpdu, transport))
+    {
+        OIC_LOG(ERROR, TAG, "pdu parse failed");
+        res = CA_STATUS_FAILED;
+    }
+    else if (CA_SIGNALING_CSM != CA_RESPONSE_CODE(coap_get_code(outpdu, transport)))
+    {
+        // Ping, Pong, Release and Abort are not used.
+        res = CA_NOT_SUPPORTED;
+    }
+    else
+    {
+        coap_opt_iterator_t opt_iter;
+        coap_option_iterator_init2(outpdu, &opt_iter, COAP_OPT_ALL, transport);
+
+        coap_opt_t *option = NULL;
+        while ((option = coap_option_next(&opt_iter)))
+        {
+            if (CA_OPTION_MAX_MESSAGE_SIZE == opt_iter.type)
+            {
+                *maxMessageSize = coap_decode_var_bytes(coap_opt_value(option),
+                                                        coap_opt_length(option));
+            }
+            else if (CA_OPTION_BLOCK_WISE_TRANSFER == opt_iter.type)
+            {
+                *blockWiseTransfer = true;
+            }
+        }
+    }
+
+    coap_delete_pdu(outpdu);
+    return res;
+}
 #endif
@@ -52,6 +52,14 @@ static void CAQueueingThreadBaseRoutine(void *threadValue)
         // mutex lock
         oc_mutex_lock(thread->threadMutex);
 
+        if (thread->idleTask && !thread->isStop && u_queue_get_size(thread->dataQueue) <= 0)
+        {
+            // Data added meanwhile is seen by the check below, so no wake-up is lost.
+            oc_mutex_unlock(thread->threadMutex);
+            thread->idleTask();
+            oc_mutex_lock(thread->threadMutex);
+        }
+
         // if queue is empty, thread will wait
         if (!thread->isStop && u_queue_get_size(thread->dataQueue) <= 0)
         {
@@ -96,6 +104,11 @@ static void CAQueueingThreadBaseRoutine(void *threadValue)
         OICFree(message);
     }
 
+    if (thread->idleTask)
+    {
+        thread->idleTask();
+    }
+
     oc_mutex_lock(thread->threadMutex);
     oc_cond_signal(thread->threadCond);
     oc_mutex_unlock(thread->threadMutex);
@@ -128,6 +141,7 @@ CAResult_t CAQueueingThreadInitialize(CAQueueingThread_t *thread, ca_thread_pool
     thread->isStop = true;
     thread->threadTask = task;
     thread->destroy = destroy;
+    thread->idleTask = NULL;
     if (NULL == thread->dataQueue || NULL == thread->threadMutex || NULL == thread->threadCond)
     {
         goto ERROR_MEM_FAILURE;
@@ -154,6 +168,21 @@ ERROR_MEM_FAILURE:
     return CA_MEMORY_ALLOC_FAILED;
 }
 
+CAResult_t CAQueueingThreadSetIdleTask(CAQueueingThread_t *thread, CAThreadIdleTask idleTask)
+{
+    if (NULL == thread || NULL == thread->threadMutex)
+    {
+        OIC_LOG(ERROR, TAG, "thread instance is empty..");
+        return CA_STATUS_INVALID_PARAM;
+    }
+
+    oc_mutex_lock(thread->threadMutex);
+    thread->idleTask = idleTask;
+    oc_mutex_unlock(thread->threadMutex);
+
+    return CA_STATUS_OK;
+}
+
 CAResult_t CAQueueingThreadStart(CAQueueingThread_t *thread)
 {
     if (NULL == thread)
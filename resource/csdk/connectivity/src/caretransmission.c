@@ -75,24 +75,30 @@
 
 #define TAG "OIC_CA_RETRANS"
 
-typedef struct
+struct CARetransmissionData
 {
     uint64_t timeStamp;                 /**< last sent time. microseconds */
 #ifndef SINGLE_THREAD
     uint64_t timeout;                   /**< timeout value. microseconds */
 #endif
+    uint64_t retransmissionTime;        /**< next retransmission time. microseconds */
     uint8_t triedCount;                 /**< retransmission count */
     uint16_t messageId;                 /**< coap PDU message id */
     CADataType_t dataType;              /**< data Type (Request/Response) */
     CAEndpoint_t *endpoint;             /**< remote endpoint */
     void *pdu;                          /**< coap PDU */
     uint32_t size;                      /**< coap PDU size */
-} CARetransmissionData_t;
+    size_t heapIndex;                   /**< position in CARetransmission_t::dataHeap */
+    OCHashLink link;                    /**< link into CARetransmission_t::dataIndex */
+};
 
 static const uint64_t USECS_PER_SEC = 1000000;
 static const uint64_t USECS_PER_MSEC = 1000;
 static const uint64_t MSECS_PER_SEC = 1000;
 
+/** Number of heap slots and hash buckets allocated with the first message; a power of two. **/
+#define RETRANSMISSION_INITIAL_BUCKETS 32
+
 #ifndef SINGLE_THREAD
 /**
  * @brief   timeout value is
@@ -141,36 +147,154 @@ CAResult_t CARetransmissionStart(CARetransmission_t *context)
 #endif
 
 /**
- * @brief   check timeout routine
- * @param   currentTime     [IN]microseconds
+ * @brief   calculate when the data is retransmitted next
  * @param   retData         [IN]retransmission data
- * @return  true if the timeout period has elapsed, false otherwise
+ * @return  microseconds
  */
-static bool CACheckTimeout(uint64_t currentTime, CARetransmissionData_t *retData)
+static uint64_t CAGetRetransmissionTime(const CARetransmissionData_t *retData)
 {
 #ifndef SINGLE_THREAD
-    // #1. calculate timeout
     uint64_t milliTimeoutValue = retData->timeout / USECS_PER_MSEC;
-    uint64_t timeout = (milliTimeoutValue << retData->triedCount) * USECS_PER_MSEC;
+    return retData->timeStamp + (milliTimeoutValue << retData->triedCount) * USECS_PER_MSEC;
+#else
+    return retData->timeStamp + (2 << retData->triedCount) * (uint64_t) USECS_PER_SEC;
+#endif
+}
 
-    if (currentTime >= retData->timeStamp + timeout)
+static uint32_t CAHashMessageId(uint16_t messageId, CATransportAdapter_t adapter)
+{
+    uint32_t hash = OCHashBytes(OC_HASH_INIT, &messageId, sizeof(messageId));
+    return OCHashBytes(hash, &adapter, sizeof(adapter));
+}
+
+/**
+ * Find the waiting message that an ACK or RST with this message id answers.
+ */
+static CARetransmissionData_t *CAFindRetransmissionData(CARetransmission_t *context,
+                                                        uint16_t messageId,
+                                                        CATransportAdapter_t adapter)
+{
+    for (OCHashLink *link = OCHashTableFirst(&context->dataIndex,
+                                             CAHashMessageId(messageId, adapter));
+         link; link = OCHashTableNext(link))
     {
-        OIC_LOG_V(DEBUG, TAG, "%" PRIu64 " microseconds time out!!, tried count(%d)",
-                  timeout, retData->triedCount);
-        return true;
+        CARetransmissionData_t *retData = OC_HASH_ENTRY(link, CARetransmissionData_t, link);
+        if (retData->messageId == messageId && retData->endpoint->adapter == adapter)
+        {
+            return retData;
+        }
     }
-#else
-    // #1. calculate timeout
-    uint64_t timeOut = (2 << retData->triedCount) * (uint64_t) USECS_PER_SEC;
+    return NULL;
+}
 
-    if (currentTime >= retData->timeStamp + timeOut)
+static void CAHeapSwap(CARetransmission_t *context, size_t a, size_t b)
+{
+    CARetransmissionData_t *tmp = context->dataHeap[a];
+    context->dataHeap[a] = context->dataHeap[b];
+    context->dataHeap[b] = tmp;
+    context->dataHeap[a]->heapIndex = a;
+    context->dataHeap[b]->heapIndex = b;
+}
+
+static void CAHeapSiftUp(CARetransmission_t *context, size_t index)
+{
+    while (index > 0)
     {
-        OIC_LOG_V(DEBUG, TAG, "timeout=%d, tried cnt=%d",
-                  (2 << retData->triedCount), retData->triedCount);
-        return true;
+        size_t parent = (index - 1) / 2;
+        if (context->dataHeap[parent]->retransmissionTime <=
+            context->dataHeap[index]->retransmissionTime)
+        {
+            break;
+        }
+        CAHeapSwap(context, parent, index);
+        index = parent;
     }
-#endif
-    return false;
+}
+
+static void CAHeapSiftDown(CARetransmission_t *context, size_t index)
+{
+    for (;;)
+    {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < context->dataCount &&
+            context->dataHeap[left]->retransmissionTime <
+            context->dataHeap[smallest]->retransmissionTime)
+        {
+            smallest = left;
+        }
+        if (right < context->dataCount &&
+            context->dataHeap[right]->retransmissionTime <
+            context->dataHeap[smallest]->retransmissionTime)
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            break;
+        }
+        CAHeapSwap(context, index, smallest);
+        index = smallest;
+    }
+}
+
+/**
+ * Add a message to the heap and the hash index.
+ */
+static CAResult_t CAAddRetransmissionData(CARetransmission_t *context,
+                                          CARetransmissionData_t *retData)
+{
+    if (context->dataCount == context->dataHeapCapacity)
+    {
+        size_t capacity = context->dataHeapCapacity ? context->dataHeapCapacity * 2
+                                                    : RETRANSMISSION_INITIAL_BUCKETS;
+        CARetransmissionData_t **heap = (CARetransmissionData_t **) OICRealloc(
+                context->dataHeap, capacity * sizeof(CARetransmissionData_t *));
+        if (NULL == heap)
+        {
+            return CA_MEMORY_ALLOC_FAILED;
+        }
+        context->dataHeap = heap;
+        context->dataHeapCapacity = capacity;
+    }
+
+    if (!OCHashTableInsert(&context->dataIndex, &retData->link,
+                           CAHashMessageId(retData->messageId, retData->endpoint->adapter)))
+    {
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+
+    retData->heapIndex = context->dataCount;
+    context->dataHeap[context->dataCount++] = retData;
+    CAHeapSiftUp(context, retData->heapIndex);
+    return CA_STATUS_OK;
+}
+
+/**
+ * Remove a message from the heap and the hash index. The data itself is not freed.
+ */
+static void CARemoveRetransmissionData(CARetransmission_t *context,
+                                       CARetransmissionData_t *retData)
+{
+    OCHashTableRemove(&context->dataIndex, &retData->link);
+
+    size_t index = retData->heapIndex;
+    context->dataCount--;
+    if (index != context->dataCount)
+    {
+        context->dataHeap[index] = context->dataHeap[context->dataCount];
+        context->dataHeap[index]->heapIndex = index;
+        CAHeapSiftDown(context, index);
+        CAHeapSiftUp(context, index);
+    }
+}
+
+static void CAFreeRetransmissionData(CARetransmissionData_t *retData)
+{
+    CAFreeEndpoint(retData->endpoint);
+    OICFree(retData->pdu);
+    OICFree(retData);
 }
 
 static void CACheckRetransmissionList(CARetransmission_t *context)
@@ -184,65 +308,51 @@ static void CACheckRetransmissionList(CARetransmission_t *context)
     // mutex lock
     oc_mutex_lock(context->threadMutex);
 
-    size_t len = u_arraylist_length(context->dataList);
+    uint64_t currentTime = OICGetCurrentTime(TIME_IN_US);
 
-    for (size_t i = 0; i < len; i++)
+    // Only the messages that are due are visited, earliest first.
+    while (context->dataCount > 0 &&
+           context->dataHeap[0]->retransmissionTime <= currentTime)
     {
-        CARetransmissionData_t *retData = u_arraylist_get(context->dataList, i);
-
-        if (NULL == retData)
-        {
-            continue;
-        }
+        CARetransmissionData_t *retData = context->dataHeap[0];
 
-        uint64_t currentTime = OICGetCurrentTime(TIME_IN_US);
+        OIC_LOG_V(DEBUG, TAG, "%" PRIu64 " microseconds time out!!, tried count(%d)",
+                  retData->retransmissionTime - retData->timeStamp, retData->triedCount);
 
-        if (CACheckTimeout(currentTime, retData))
+        // #1. if time's up, send the data.
+        if (NULL != context->dataSendMethod)
         {
-            // #2. if time's up, send the data.
-            if (NULL != context->dataSendMethod)
-            {
-                OIC_LOG_V(DEBUG, TAG, "retransmission CON data!!, msgid=%d",
-                          retData->messageId);
-                context->dataSendMethod(retData->endpoint, retData->pdu,
-                                        retData->size, retData->dataType);
-            }
-
-            // #3. increase the retransmission count and update timestamp.
-            retData->timeStamp = currentTime;
-            retData->triedCount++;
+            OIC_LOG_V(DEBUG, TAG, "retransmission CON data!!, msgid=%d",
+                      retData->messageId);
+            context->dataSendMethod(retData->endpoint, retData->pdu,
+                                    retData->size, retData->dataType);
         }
 
-        // #4. if tried count is max, remove the retransmission data from list.
+        // #2. increase the retransmission count and update timestamp.
+        retData->timeStamp = currentTime;
+        retData->triedCount++;
+
+        // #3. if tried count is max, remove the retransmission data.
         if (retData->triedCount >= context->config.tryingCount)
         {
-            CARetransmissionData_t *removedData = u_arraylist_remove(context->dataList, i);
-            if (NULL == removedData)
-            {
-                OIC_LOG(ERROR, TAG, "Removed data is NULL");
-                // mutex unlock
-                oc_mutex_unlock(context->threadMutex);
-                return;
-            }
+            CARemoveRetransmissionData(context, retData);
             OIC_LOG_V(DEBUG, TAG, "max trying count, remove RTCON data,"
-                      "msgid=%d", removedData->messageId);
+                      "msgid=%d", retData->messageId);
 
             // callback for retransmit timeout
             if (NULL != context->timeoutCallback)
             {
-                context->timeoutCallback(removedData->endpoint, removedData->pdu,
-                                         removedData->size);
+                context->timeoutCallback(retData->endpoint, retData->pdu,
+                                         retData->size);
             }
 
-            CAFreeEndpoint(removedData->endpoint);
-            OICFree(removedData->pdu);
-
-            OICFree(removedData);
-
-            // modify loop value.
-            len = u_arraylist_length(context->dataList);
-            --i;
+            CAFreeRetransmissionData(retData);
+            continue;
         }
+
+        // #4. otherwise schedule the next retransmission.
+        retData->retransmissionTime = CAGetRetransmissionTime(retData);
+        CAHeapSiftDown(context, 0);
     }
 
     // mutex unlock
@@ -276,7 +386,7 @@ void CARetransmissionBaseRoutine(void *threadValue)
         // mutex lock
         oc_mutex_lock(context->threadMutex);
 
-        if (!context->isStop && u_arraylist_length(context->dataList) <= 0)
+        if (!context->isStop && context->dataCount <= 0)
         {
             // if list is empty, thread will wait
             OIC_LOG(DEBUG, TAG, "wait..there is no retransmission data.");
@@ -288,13 +398,18 @@ void CARetransmissionBaseRoutine(void *threadValue)
         }
         else if (!context->isStop)
         {
-            // check each RETRANSMISSION_CHECK_PERIOD_SEC time.
-            OIC_LOG_V(DEBUG, TAG, "wait..(%" PRIu64 ")microseconds",
-                      RETRANSMISSION_CHECK_PERIOD_SEC * (uint64_t) USECS_PER_SEC);
+            // sleep until the earliest retransmission is due, or new data arrives.
+            uint64_t currentTime = OICGetCurrentTime(TIME_IN_US);
+            uint64_t nextTime = context->dataHeap[0]->retransmissionTime;
+            if (nextTime > currentTime)
+            {
+                OIC_LOG_V(DEBUG, TAG, "wait..(%" PRIu64 ")microseconds",
+                          nextTime - currentTime);
 
-            // wait
-            uint64_t absTime = RETRANSMISSION_CHECK_PERIOD_SEC * (uint64_t) USECS_PER_SEC;
-            oc_cond_wait_for(context->threadCond, context->threadMutex, absTime );
+                // wait
+                oc_cond_wait_for(context->threadCond, context->threadMutex,
+                                 nextTime - currentTime);
+            }
         }
         else
         {
@@ -343,6 +458,7 @@ CAResult_t CARetransmissionInitialize(CARetransmission_t *context,
     OIC_LOG(DEBUG, TAG, "thread initialize");
 
     memset(context, 0, sizeof(CARetransmission_t));
+    OCHashTableInit(&context->dataIndex, RETRANSMISSION_INITIAL_BUCKETS);
 
     CARetransmissionConfig_t cfg = { .supportType = DEFAULT_RETRANSMISSION_TYPE,
                                      .tryingCount = DEFAULT_RETRANSMISSION_COUNT };
@@ -360,7 +476,6 @@ CAResult_t CARetransmissionInitialize(CARetransmission_t *context,
     context->timeoutCallback = timeoutCallback;
     context->config = cfg;
     context->isStop = false;
-    context->dataList = u_arraylist_create();
 
     return CA_STATUS_OK;
 }
@@ -431,6 +546,7 @@ CAResult_t CARetransmissionSentData(CARetransmission_t *context,
     retData->timeout = CAGetTimeoutValue();
 #endif
     retData->triedCount = 0;
+    retData->retransmissionTime = CAGetRetransmissionTime(retData);
     retData->messageId = messageId;
     retData->endpoint = remoteEndpoint;
     retData->pdu = pduData;
@@ -440,44 +556,44 @@ CAResult_t CARetransmissionSentData(CARetransmission_t *context,
     // mutex lock
     oc_mutex_lock(context->threadMutex);
 
-    size_t len = u_arraylist_length(context->dataList);
-
     // #3. add data into list
-    for (size_t i = 0; i < len; i++)
+    if (NULL != CAFindRetransmissionData(context, messageId, endpoint->adapter))
     {
-        CARetransmissionData_t *currData = u_arraylist_get(context->dataList, i);
+        OIC_LOG(ERROR, TAG, "Duplicate message ID");
 
-        if (NULL == currData)
-        {
-            continue;
-        }
+        // mutex unlock
+        oc_mutex_unlock(context->threadMutex);
 
-        // found index
-        if (NULL != currData->endpoint && currData->messageId == messageId
-            && (currData->endpoint->adapter == endpoint->adapter))
-        {
-            OIC_LOG(ERROR, TAG, "Duplicate message ID");
+        CAFreeRetransmissionData(retData);
+        return CA_STATUS_FAILED;
+    }
 
-            // mutex unlock
-            oc_mutex_unlock(context->threadMutex);
+    CAResult_t res = CAAddRetransmissionData(context, retData);
+    if (CA_STATUS_OK != res)
+    {
+        OIC_LOG(ERROR, TAG, "memory error");
 
-            OICFree(retData);
-            OICFree(pduData);
-            OICFree(remoteEndpoint);
-            return CA_STATUS_FAILED;
-        }
-    }
+        // mutex unlock
+        oc_mutex_unlock(context->threadMutex);
 
-    u_arraylist_add(context->dataList, (void *) retData);
+        CAFreeRetransmissionData(retData);
+        return res;
+    }
 
-    // notify the thread
+    // notify the thread, the new data may be due before the one it waits for.
     oc_cond_signal(context->threadCond);
 
     // mutex unlock
     oc_mutex_unlock(context->threadMutex);
 
 #else
-    u_arraylist_add(context->dataList, (void *) retData);
+    CAResult_t res = CAAddRetransmissionData(context, retData);
+    if (CA_STATUS_OK != res)
+    {
+        OIC_LOG(ERROR, TAG, "memory error");
+        CAFreeRetransmissionData(retData);
+        return res;
+    }
 
     CACheckRetransmissionList(context);
 #endif
@@ -519,73 +635,46 @@ CAResult_t CARetransmissionReceivedData(CARetransmission_t *context,
 
     // mutex lock
     oc_mutex_lock(context->threadMutex);
-    size_t len = u_arraylist_length(context->dataList);
 
-    for (size_t i = 0; i < len; i++)
+    CARetransmissionData_t *retData = CAFindRetransmissionData(context, messageId,
+                                                               endpoint->adapter);
+    if (NULL != retData)
     {
-        CARetransmissionData_t *retData = (CARetransmissionData_t *) u_arraylist_get(
-                context->dataList, i);
-
-        if (NULL == retData)
+        // get pdu data for getting token when CA_EMPTY(RST/ACK) is received from remote device
+        // if retransmission was finish..token will be unavailable.
+        if (CA_EMPTY == code)
         {
-            continue;
-        }
+            OIC_LOG(DEBUG, TAG, "code is CA_EMPTY");
 
-        // found index
-        if (NULL != retData->endpoint && retData->messageId == messageId
-            && (retData->endpoint->adapter == endpoint->adapter))
-        {
-            // get pdu data for getting token when CA_EMPTY(RST/ACK) is received from remote device
-            // if retransmission was finish..token will be unavailable.
-            if (CA_EMPTY == CAGetCodeFromPduBinaryData(pdu, size))
+            if (NULL == retData->pdu)
             {
-                OIC_LOG(DEBUG, TAG, "code is CA_EMPTY");
-
-                if (NULL == retData->pdu)
-                {
-                    OIC_LOG(ERROR, TAG, "retData->pdu is null");
-                    OICFree(retData);
-                    // mutex unlock
-                    oc_mutex_unlock(context->threadMutex);
-
-                    return CA_STATUS_FAILED;
-                }
-
-                // copy PDU data
-                (*retransmissionPdu) = (void *) OICCalloc(1, retData->size);
-                if ((*retransmissionPdu) == NULL)
-                {
-                    OICFree(retData);
-                    OIC_LOG(ERROR, TAG, "memory error");
-
-                    // mutex unlock
-                    oc_mutex_unlock(context->threadMutex);
-
-                    return CA_MEMORY_ALLOC_FAILED;
-                }
-                memcpy((*retransmissionPdu), retData->pdu, retData->size);
+                OIC_LOG(ERROR, TAG, "retData->pdu is null");
+                // mutex unlock
+                oc_mutex_unlock(context->threadMutex);
+
+                return CA_STATUS_FAILED;
             }
 
-            // #2. remove data from list
-            CARetransmissionData_t *removedData = u_arraylist_remove(context->dataList, i);
-            if (NULL == removedData)
+            // copy PDU data
+            (*retransmissionPdu) = (void *) OICCalloc(1, retData->size);
+            if ((*retransmissionPdu) == NULL)
             {
-                OIC_LOG(ERROR, TAG, "Removed data is NULL");
+                OIC_LOG(ERROR, TAG, "memory error");
 
                 // mutex unlock
                 oc_mutex_unlock(context->threadMutex);
 
-                return CA_STATUS_FAILED;
+                return CA_MEMORY_ALLOC_FAILED;
             }
+            memcpy((*retransmissionPdu), retData->pdu, retData->size);
+        }
 
-            OIC_LOG_V(DEBUG, TAG, "remove RTCON data!!, msgid=%d", messageId);
+        // #2. remove data from list
+        CARemoveRetransmissionData(context, retData);
 
-            CAFreeEndpoint(removedData->endpoint);
-            OICFree(removedData->pdu);
-            OICFree(removedData);
+        OIC_LOG_V(DEBUG, TAG, "remove RTCON data!!, msgid=%d", messageId);
 
-            break;
-        }
+        CAFreeRetransmissionData(retData);
     }
 
     // mutex unlock
@@ -633,24 +722,20 @@ CAResult_t CARetransmissionDestroy(CARetransmission_t *context)
     OIC_LOG(DEBUG, TAG, "retransmission context destroy..");
 
     oc_mutex_lock(context->threadMutex);
-    size_t len = u_arraylist_length(context->dataList);
-    for (size_t i = 0; i < len; i++)
+    for (size_t i = 0; i < context->dataCount; i++)
     {
-        CARetransmissionData_t *data = u_arraylist_get(context->dataList, i);
-        if (NULL == data)
-        {
-            continue;
-        }
-        CAFreeEndpoint(data->endpoint);
-        OICFree(data->pdu);
-        OICFree(data);
+        CAFreeRetransmissionData(context->dataHeap[i]);
     }
+    OICFree(context->dataHeap);
+    OCHashTableClear(&context->dataIndex);
+    context->dataHeap = NULL;
+    context->dataCount = 0;
+    context->dataHeapCapacity = 0;
     oc_mutex_unlock(context->threadMutex);
 
     oc_mutex_free(context->threadMutex);
     context->threadMutex = NULL;
     oc_cond_free(context->threadCond);
-    u_arraylist_free(&context->dataList);
 
     return CA_STATUS_OK;
 }
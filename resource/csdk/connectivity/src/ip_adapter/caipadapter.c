@@ -145,6 +145,9 @@ CAResult_t CAIPInitializeQueueHandles()
         return CA_STATUS_FAILED;
     }
 
+    // Datagrams batched while the queue is busy go out once it is empty.
+    CAQueueingThreadSetIdleTask(g_sendQueueHandle, CAIPFlushSendData);
+
     return CA_STATUS_OK;
 }
 
@@ -570,7 +573,7 @@ void CAIPSendDataThread(void *threadData)
     {
         //Processing for sending multicast
         OIC_LOG(DEBUG, TAG, "Send Multicast Data is called");
-        CAIPSendData(ipData->remoteEndpoint, ipData->data, ipData->dataLen, true);
+        CAIPBatchSendData(ipData->remoteEndpoint, ipData->data, ipData->dataLen, true);
     }
     else
     {
@@ -589,10 +592,10 @@ void CAIPSendDataThread(void *threadData)
         else
         {
             OIC_LOG(DEBUG, TAG, "Send Unicast Data is called");
-            CAIPSendData(ipData->remoteEndpoint, ipData->data, ipData->dataLen, false);
+            CAIPBatchSendData(ipData->remoteEndpoint, ipData->data, ipData->dataLen, false);
         }
 #else
-        CAIPSendData(ipData->remoteEndpoint, ipData->data, ipData->dataLen, false);
+        CAIPBatchSendData(ipData->remoteEndpoint, ipData->data, ipData->dataLen, false);
 #endif
     }
 }
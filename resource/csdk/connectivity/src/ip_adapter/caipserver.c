@@ -114,6 +114,49 @@ static struct in6_addr IPv6MulticastAddressGlb;
  */
 #define RECV_MSG_BUF_LEN 16384
 
+#if defined(__linux__)
+/*
+ * Read ready sockets with recvmmsg(), several datagrams per system call.
+ */
+#define CA_IP_RECV_BATCH
+
+/*
+ * Datagrams read by one recvmmsg() call
+ */
+#define RECV_BATCH_SIZE 16
+#endif
+
+#if defined(__linux__)
+/*
+ * Let the send thread collect datagrams and write them with sendmmsg().
+ */
+#define CA_IP_SEND_BATCH
+
+/*
+ * Datagrams collected before the batch is written
+ */
+#define SEND_BATCH_SIZE 32
+
+/*
+ * Bytes of datagram data collected before the batch is written
+ */
+#define SEND_BATCH_BYTES 65536
+
+/*
+ * Largest payload one UDP_SEGMENT send may carry
+ */
+#define SEND_GSO_MAX_BYTES 60000
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
+/*
+ * Number of sockets the IP server reads from, see CAGetSocketIndex()
+ */
+#define IP_SOCKET_COUNT 8
+
 static char *ipv6mcnames[IPv6_DOMAINS] = {
     NULL,
     IPv6_MULTICAST_INT,
@@ -153,6 +196,60 @@ static CAIPErrorHandleCallback g_ipErrorHandler = NULL;
 
 static CAIPPacketReceivedCallback g_packetReceivedCallback = NULL;
 
+static CAIPReceiveStats_t g_receiveStats = { 0 };
+
+#if defined(__GNUC__)
+#define RECV_STATS_ADD(FIELD, VALUE) \
+    __atomic_fetch_add(&g_receiveStats.FIELD, (VALUE), __ATOMIC_RELAXED)
+#define RECV_STATS_GET(FIELD) __atomic_load_n(&g_receiveStats.FIELD, __ATOMIC_RELAXED)
+#define RECV_STATS_SET(FIELD, VALUE) \
+    __atomic_store_n(&g_receiveStats.FIELD, (VALUE), __ATOMIC_RELAXED)
+#else
+#define RECV_STATS_ADD(FIELD, VALUE) (g_receiveStats.FIELD += (VALUE))
+#define RECV_STATS_GET(FIELD) (g_receiveStats.FIELD)
+#define RECV_STATS_SET(FIELD, VALUE) (g_receiveStats.FIELD = (VALUE))
+#endif
+
+#if !defined(WSA_CMSG_DATA)
+/*
+ * Ancillary data of one datagram: its packet info and, where the socket reports it, the
+ * number of datagrams the kernel has dropped so far.
+ */
+typedef union
+{
+    struct cmsghdr cmsg;
+    unsigned char data[CMSG_SPACE(sizeof (struct in6_pktinfo))
+#ifdef SO_RXQ_OVFL
+                       + CMSG_SPACE(sizeof (uint32_t))
+#endif
+                      ];
+} CAReceiveControl_t;
+
+#ifdef SO_RXQ_OVFL
+/*
+ * Last drop count each socket reported; only touched by the receive thread.
+ */
+static uint32_t g_socketDrops[IP_SOCKET_COUNT];
+#endif
+#endif
+
+#ifdef CA_IP_RECV_BATCH
+/*
+ * Buffers recvmmsg() fills, allocated once when the server starts. The packet callback
+ * parses every datagram straight out of its slot before the next call reuses it.
+ */
+typedef struct
+{
+    struct mmsghdr msgs[RECV_BATCH_SIZE];
+    struct iovec iov[RECV_BATCH_SIZE];
+    struct sockaddr_storage srcAddr[RECV_BATCH_SIZE];
+    CAReceiveControl_t control[RECV_BATCH_SIZE];
+    char buffers[RECV_BATCH_SIZE][RECV_MSG_BUF_LEN];
+} CAReceiveRing_t;
+
+static CAReceiveRing_t *g_receiveRing = NULL;
+#endif
+
 static void CAFindReadyMessage();
 #if !defined(WSA_WAIT_EVENT_0)
 static void CASelectReturned(fd_set *readFds, int ret);
@@ -161,6 +258,9 @@ static void CAEventReturned(CASocketFd_t socket);
 #endif
 
 static CAResult_t CAReceiveMessage(CASocketFd_t fd, CATransportFlags_t flags);
+#ifdef CA_IP_SEND_BATCH
+static void CAFreeSendBatch();
+#endif
 
 static void CACloseFDs()
 {
@@ -172,6 +272,10 @@ static void CACloseFDs()
     }
 #endif
     CADeInitializeIPGlobals();
+#ifdef CA_IP_RECV_BATCH
+    OICFree(g_receiveRing);
+    g_receiveRing = NULL;
+#endif
 }
 
 static void CAReceiveHandler(void *data)
@@ -559,108 +663,82 @@ void CADeInitializeIPGlobals()
     CAUnregisterForAddressChanges();
 }
 
-static CAResult_t CAReceiveMessage(CASocketFd_t fd, CATransportFlags_t flags)
+static void CACountBatch(size_t count, size_t capacity)
 {
-    char recvBuffer[RECV_MSG_BUF_LEN] = {0};
-    int level = 0;
-    int type = 0;
-    int namelen = 0;
-    struct sockaddr_storage srcAddr = { .ss_family = 0 };
-    unsigned char *pktinfo = NULL;
-#if !defined(WSA_CMSG_DATA)
-    size_t len = 0;
-    struct cmsghdr *cmp = NULL;
-    struct iovec iov = { .iov_base = recvBuffer, .iov_len = sizeof (recvBuffer) };
-    union control
+    RECV_STATS_ADD(datagrams, count);
+    RECV_STATS_ADD(batches, 1);
+    if (count == capacity)
     {
-        struct cmsghdr cmsg;
-        unsigned char data[CMSG_SPACE(sizeof (struct in6_pktinfo))];
-    } cmsg;
-
-    if (flags & CA_IPV6)
-    {
-        namelen = sizeof (struct sockaddr_in6);
-        level = IPPROTO_IPV6;
-        type = IPV6_PKTINFO;
-        len = sizeof (struct in6_pktinfo);
+        RECV_STATS_ADD(fullBatches, 1);
     }
-    else
+    // Only the receive thread writes the counters.
+    if (count > RECV_STATS_GET(maxBatchSize))
     {
-        namelen = sizeof (struct sockaddr_in);
-        level = IPPROTO_IP;
-        type = IP_PKTINFO;
-        len = sizeof (struct in6_pktinfo);
+        RECV_STATS_SET(maxBatchSize, count);
     }
+}
 
-    struct msghdr msg = { .msg_name = &srcAddr,
-                          .msg_namelen = namelen,
-                          .msg_iov = &iov,
-                          .msg_iovlen = 1,
-                          .msg_control = &cmsg,
-                          .msg_controllen = CMSG_SPACE(len) };
+void CAIPGetReceiveStats(CAIPReceiveStats_t *stats)
+{
+    VERIFY_NON_NULL_VOID(stats, TAG, "stats is NULL");
+
+    stats->datagrams = RECV_STATS_GET(datagrams);
+    stats->batches = RECV_STATS_GET(batches);
+    stats->fullBatches = RECV_STATS_GET(fullBatches);
+    stats->maxBatchSize = RECV_STATS_GET(maxBatchSize);
+    stats->drops = RECV_STATS_GET(drops);
+    stats->truncated = RECV_STATS_GET(truncated);
+}
 
-    ssize_t recvLen = recvmsg(fd, &msg, flags);
-    if (OC_SOCKET_ERROR == recvLen)
+#if !defined(WSA_CMSG_DATA)
+#ifdef SO_RXQ_OVFL
+static size_t CAGetSocketIndex(CATransportFlags_t flags)
+{
+    return ((flags & CA_IPV6) ? 4 : 0) |
+           ((flags & CA_MULTICAST) ? 2 : 0) |
+           ((flags & CA_SECURE) ? 1 : 0);
+}
+#endif
+
+static unsigned char *CAGetPacketInfo(struct msghdr *msg, CATransportFlags_t flags)
+{
+    int level = (flags & CA_IPV6) ? IPPROTO_IPV6 : IPPROTO_IP;
+    int type = (flags & CA_IPV6) ? IPV6_PKTINFO : IP_PKTINFO;
+    unsigned char *pktinfo = NULL;
+
+    if (msg->msg_flags & MSG_TRUNC)
     {
-        OIC_LOG_V(ERROR, TAG, "Recvfrom failed %s", strerror(errno));
-        return CA_STATUS_FAILED;
+        RECV_STATS_ADD(truncated, 1);
     }
 
-    for (cmp = CMSG_FIRSTHDR(&msg); cmp != NULL; cmp = CMSG_NXTHDR(&msg, cmp))
+    for (struct cmsghdr *cmp = CMSG_FIRSTHDR(msg); cmp != NULL; cmp = CMSG_NXTHDR(msg, cmp))
     {
         if (cmp->cmsg_level == level && cmp->cmsg_type == type)
         {
             pktinfo = CMSG_DATA(cmp);
         }
-    }
-#else // if defined(WSA_CMSG_DATA)
-    union control
-    {
-        WSACMSGHDR cmsg;
-        uint8_t data[WSA_CMSG_SPACE(sizeof (IN6_PKTINFO))];
-    } cmsg;
-    memset(&cmsg, 0, sizeof(cmsg));
-
-    if (flags & CA_IPV6)
-    {
-        namelen  = sizeof (struct sockaddr_in6);
-        level = IPPROTO_IPV6;
-        type = IPV6_PKTINFO;
-    }
-    else
-    {
-        namelen = sizeof (struct sockaddr_in);
-        level = IPPROTO_IP;
-        type = IP_PKTINFO;
-    }
-
-    WSABUF iov = {.len = sizeof (recvBuffer), .buf = recvBuffer};
-    WSAMSG msg = {.name = (PSOCKADDR)&srcAddr,
-                  .namelen = namelen,
-                  .lpBuffers = &iov,
-                  .dwBufferCount = 1,
-                  .Control = {.buf = (char*)cmsg.data, .len = sizeof (cmsg)}
-                 };
-
-    uint32_t recvLen = 0;
-    uint32_t ret = caglobals.ip.wsaRecvMsg(fd, &msg, (LPDWORD)&recvLen, 0,0);
-    if (OC_SOCKET_ERROR == ret)
-    {
-        OIC_LOG_V(ERROR, TAG, "WSARecvMsg failed %i", WSAGetLastError());
-        return CA_STATUS_FAILED;
-    }
-
-    OIC_LOG_V(DEBUG, TAG, "WSARecvMsg recvd %u bytes", recvLen);
-
-    for (WSACMSGHDR *cmp = WSA_CMSG_FIRSTHDR(&msg); cmp != NULL;
-         cmp = WSA_CMSG_NXTHDR(&msg, cmp))
-    {
-        if (cmp->cmsg_level == level && cmp->cmsg_type == type)
+#ifdef SO_RXQ_OVFL
+        else if (cmp->cmsg_level == SOL_SOCKET && cmp->cmsg_type == SO_RXQ_OVFL)
         {
-            pktinfo = WSA_CMSG_DATA(cmp);
+            uint32_t dropped = 0;
+            memcpy(&dropped, CMSG_DATA(cmp), sizeof (dropped));
+            size_t index = CAGetSocketIndex(flags);
+            if (dropped != g_socketDrops[index])
+            {
+                RECV_STATS_ADD(drops, (uint32_t)(dropped - g_socketDrops[index]));
+                g_socketDrops[index] = dropped;
+            }
         }
+#endif
     }
-#endif // !defined(WSA_CMSG_DATA)
+    return pktinfo;
+}
+#endif
+
+static CAResult_t CAHandleDatagram(CATransportFlags_t flags, char *recvBuffer, size_t recvLen,
+                                   struct sockaddr_storage *srcAddr, int namelen,
+                                   unsigned char *pktinfo)
+{
     if (!pktinfo)
     {
         OIC_LOG(ERROR, TAG, "pktinfo is null");
@@ -699,7 +777,7 @@ static CAResult_t CAReceiveMessage(CASocketFd_t fd, CATransportFlags_t flags)
         }
     }
 
-    CAConvertAddrToName(&srcAddr, namelen, sep.endpoint.addr, &sep.endpoint.port);
+    CAConvertAddrToName(srcAddr, namelen, sep.endpoint.addr, &sep.endpoint.port);
 
     if (flags & CA_SECURE)
     {
@@ -710,6 +788,8 @@ static CAResult_t CAReceiveMessage(CASocketFd_t fd, CATransportFlags_t flags)
         CAdecryptSsl(&sep, (uint8_t *)recvBuffer, recvLen);
         OIC_LOG_V(DEBUG, TAG, "CAdecryptSsl returns [%d]", decryptResult);
 #else
+        (void)recvBuffer;
+        (void)recvLen;
         OIC_LOG(ERROR, TAG, "Encrypted message but no DTLS");
 #endif // __WITH_DTLS__
     }
@@ -724,6 +804,141 @@ static CAResult_t CAReceiveMessage(CASocketFd_t fd, CATransportFlags_t flags)
     return CA_STATUS_OK;
 }
 
+#ifdef CA_IP_RECV_BATCH
+static CAResult_t CAReceiveBatch(CASocketFd_t fd, CATransportFlags_t flags)
+{
+    CAReceiveRing_t *ring = g_receiveRing;
+    int namelen = (flags & CA_IPV6) ? sizeof (struct sockaddr_in6) : sizeof (struct sockaddr_in);
+
+    for (size_t i = 0; i < RECV_BATCH_SIZE; i++)
+    {
+        ring->iov[i].iov_base = ring->buffers[i];
+        ring->iov[i].iov_len = RECV_MSG_BUF_LEN;
+        ring->msgs[i].msg_hdr = (struct msghdr) { .msg_name = &ring->srcAddr[i],
+                                                  .msg_namelen = namelen,
+                                                  .msg_iov = &ring->iov[i],
+                                                  .msg_iovlen = 1,
+                                                  .msg_control = &ring->control[i],
+                                                  .msg_controllen = sizeof (ring->control[i]) };
+        ring->msgs[i].msg_len = 0;
+    }
+
+    // select() reported the socket readable, so only the first datagram may block;
+    // MSG_WAITFORONE takes whatever else is already queued without waiting for more.
+    int count = recvmmsg(fd, ring->msgs, RECV_BATCH_SIZE, MSG_WAITFORONE, NULL);
+    if (count <= 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "recvmmsg failed %s", strerror(errno));
+        return CA_STATUS_FAILED;
+    }
+    CACountBatch((size_t)count, RECV_BATCH_SIZE);
+
+    for (int i = 0; i < count && !caglobals.ip.terminate; i++)
+    {
+        unsigned char *pktinfo = CAGetPacketInfo(&ring->msgs[i].msg_hdr, flags);
+        (void)CAHandleDatagram(flags, ring->buffers[i], ring->msgs[i].msg_len,
+                               &ring->srcAddr[i], namelen, pktinfo);
+    }
+    return CA_STATUS_OK;
+}
+#endif
+
+static CAResult_t CAReceiveMessage(CASocketFd_t fd, CATransportFlags_t flags)
+{
+#ifdef CA_IP_RECV_BATCH
+    if (g_receiveRing)
+    {
+        return CAReceiveBatch(fd, flags);
+    }
+#endif
+
+    char recvBuffer[RECV_MSG_BUF_LEN];
+    int namelen = 0;
+    struct sockaddr_storage srcAddr = { .ss_family = 0 };
+    unsigned char *pktinfo = NULL;
+#if !defined(WSA_CMSG_DATA)
+    struct iovec iov = { .iov_base = recvBuffer, .iov_len = sizeof (recvBuffer) };
+    CAReceiveControl_t cmsg;
+
+    if (flags & CA_IPV6)
+    {
+        namelen = sizeof (struct sockaddr_in6);
+    }
+    else
+    {
+        namelen = sizeof (struct sockaddr_in);
+    }
+
+    struct msghdr msg = { .msg_name = &srcAddr,
+                          .msg_namelen = namelen,
+                          .msg_iov = &iov,
+                          .msg_iovlen = 1,
+                          .msg_control = &cmsg,
+                          .msg_controllen = sizeof (cmsg) };
+
+    ssize_t recvLen = recvmsg(fd, &msg, 0);
+    if (OC_SOCKET_ERROR == recvLen)
+    {
+        OIC_LOG_V(ERROR, TAG, "Recvfrom failed %s", strerror(errno));
+        return CA_STATUS_FAILED;
+    }
+
+    pktinfo = CAGetPacketInfo(&msg, flags);
+#else // if defined(WSA_CMSG_DATA)
+    int level = 0;
+    int type = 0;
+    union control
+    {
+        WSACMSGHDR cmsg;
+        uint8_t data[WSA_CMSG_SPACE(sizeof (IN6_PKTINFO))];
+    } cmsg;
+    memset(&cmsg, 0, sizeof(cmsg));
+
+    if (flags & CA_IPV6)
+    {
+        namelen  = sizeof (struct sockaddr_in6);
+        level = IPPROTO_IPV6;
+        type = IPV6_PKTINFO;
+    }
+    else
+    {
+        namelen = sizeof (struct sockaddr_in);
+        level = IPPROTO_IP;
+        type = IP_PKTINFO;
+    }
+
+    WSABUF iov = {.len = sizeof (recvBuffer), .buf = recvBuffer};
+    WSAMSG msg = {.name = (PSOCKADDR)&srcAddr,
+                  .namelen = namelen,
+                  .lpBuffers = &iov,
+                  .dwBufferCount = 1,
+                  .Control = {.buf = (char*)cmsg.data, .len = sizeof (cmsg)}
+                 };
+
+    uint32_t recvLen = 0;
+    uint32_t ret = caglobals.ip.wsaRecvMsg(fd, &msg, (LPDWORD)&recvLen, 0,0);
+    if (OC_SOCKET_ERROR == ret)
+    {
+        OIC_LOG_V(ERROR, TAG, "WSARecvMsg failed %i", WSAGetLastError());
+        return CA_STATUS_FAILED;
+    }
+
+    OIC_LOG_V(DEBUG, TAG, "WSARecvMsg recvd %u bytes", recvLen);
+
+    for (WSACMSGHDR *cmp = WSA_CMSG_FIRSTHDR(&msg); cmp != NULL;
+         cmp = WSA_CMSG_NXTHDR(&msg, cmp))
+    {
+        if (cmp->cmsg_level == level && cmp->cmsg_type == type)
+        {
+            pktinfo = WSA_CMSG_DATA(cmp);
+        }
+    }
+#endif // !defined(WSA_CMSG_DATA)
+    CACountBatch(1, 1);
+
+    return CAHandleDatagram(flags, recvBuffer, (size_t)recvLen, &srcAddr, namelen, pktinfo);
+}
+
 void CAIPPullData()
 {
     OIC_LOG_V(DEBUG, TAG, "IN %s", __func__);
@@ -799,6 +1014,17 @@ static CASocketFd_t CACreateSocket(int family, uint16_t *port, bool isMulticast)
         }
     }
 
+#ifdef SO_RXQ_OVFL
+    {
+        // Have every datagram carry the socket's drop count, for CAIPGetReceiveStats().
+        int on = 1;
+        if (OC_SOCKET_ERROR == setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof (on)))
+        {
+            OIC_LOG_V(DEBUG, TAG, "SO_RXQ_OVFL failed: %s", CAIPS_GET_ERROR);
+        }
+    }
+#endif
+
     if (OC_SOCKET_ERROR == bind(fd, (struct sockaddr *)&sa, socklen))
     {
         OIC_LOG_V(ERROR, TAG, "bind socket failed: %s", CAIPS_GET_ERROR);
@@ -1000,6 +1226,19 @@ CAResult_t CAIPStartServer(const ca_thread_pool_t threadPool)
         OIC_LOG_V(ERROR, TAG, "WSAIoctl failed %i", WSAGetLastError());
         return CA_STATUS_FAILED;
     }
+#endif
+#ifdef CA_IP_RECV_BATCH
+    if (!g_receiveRing)
+    {
+        g_receiveRing = (CAReceiveRing_t *)OICCalloc(1, sizeof (CAReceiveRing_t));
+        if (!g_receiveRing)
+        {
+            OIC_LOG(WARNING, TAG, "No memory for the receive ring, reading one datagram at a time");
+        }
+    }
+#endif
+#ifdef SO_RXQ_OVFL
+    memset(g_socketDrops, 0, sizeof (g_socketDrops));
 #endif
     // set up appropriate FD mechanism for fast shutdown
     CAInitializeFastShutdownMechanism();
@@ -1057,6 +1296,11 @@ void CAIPStopServer()
         CACloseFDs();
     }
     caglobals.ip.started = false;
+
+#ifdef CA_IP_SEND_BATCH
+    // The send thread has stopped by now, flushing its batch on the way out.
+    CAFreeSendBatch();
+#endif
 }
 
 void CAWakeUpForChange()
@@ -1402,9 +1646,368 @@ static void sendData(CASocketFd_t fd, const CAEndpoint_t *endpoint,
 #endif
 }
 
+#ifdef CA_IP_SEND_BATCH
+/*
+ * One datagram waiting in the send batch. Its data lives in CASendBatch_t.buffer.
+ */
+typedef struct
+{
+    CASocketFd_t fd;
+    CAEndpoint_t endpoint;          // for error reports and send state logging
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    int ifindex;                    // outgoing interface of a multicast datagram, or 0
+    size_t offset;
+    size_t len;
+    bool taken;                     // already placed in a message of the current flush
+} CASendEntry_t;
+
+/*
+ * Ancillary data of one sent message: the outgoing interface and the GSO segment size.
+ */
+typedef union
+{
+    struct cmsghdr cmsg;
+    unsigned char data[CMSG_SPACE(sizeof (struct in6_pktinfo)) + CMSG_SPACE(sizeof (uint16_t))];
+} CASendControl_t;
+
+/*
+ * Datagrams the send thread collected since its queue was last empty, and the message
+ * headers they are flushed with. Only the send thread touches it.
+ */
+typedef struct
+{
+    CASendEntry_t entries[SEND_BATCH_SIZE];
+    size_t count;
+    size_t used;
+    char buffer[SEND_BATCH_BYTES];
+
+    struct mmsghdr msgs[SEND_BATCH_SIZE];
+    struct iovec iov[SEND_BATCH_SIZE];
+    CASendControl_t control[SEND_BATCH_SIZE];
+    size_t first[SEND_BATCH_SIZE];      // entries of each message, in entry order
+    size_t segments[SEND_BATCH_SIZE];
+} CASendBatch_t;
+
+static CASendBatch_t *g_sendBatch = NULL;
+
+/*
+ * Cleared when the kernel does not support UDP_SEGMENT at all, after which datagrams are
+ * never merged.
+ */
+static bool g_sendGso = true;
+
+static void CAReportSent(const CASendEntry_t *entry, const char *data, bool isSuccess, int err)
+{
+    if (isSuccess)
+    {
+        CALogSendStateInfo(entry->endpoint.adapter, entry->endpoint.addr, entry->endpoint.port,
+                           (ssize_t)entry->len, true, NULL);
+        return;
+    }
+
+    if (g_ipErrorHandler)
+    {
+        g_ipErrorHandler(&entry->endpoint, data, entry->len, CA_SEND_FAILED);
+    }
+    OIC_LOG_V(ERROR, TAG, "sendmmsg to %s:%u failed: %s",
+              entry->endpoint.addr, entry->endpoint.port, strerror(err));
+    CALogSendStateInfo(entry->endpoint.adapter, entry->endpoint.addr, entry->endpoint.port,
+                       -1, false, strerror(err));
+}
+
+/*
+ * Whether entry may ride in the same UDP_SEGMENT message as the run that starts at head
+ * and ends at tail, the entry just before it. Every segment but the last must have the
+ * size of the first.
+ */
+static bool CACanMergeSegment(const CASendEntry_t *head, const CASendEntry_t *tail,
+                              size_t total, const CASendEntry_t *entry)
+{
+    return g_sendGso &&
+           entry->fd == head->fd &&
+           entry->ifindex == head->ifindex &&
+           entry->addrlen == head->addrlen &&
+           0 == memcmp(&entry->addr, &head->addr, entry->addrlen) &&
+           tail->len == head->len &&
+           entry->len <= head->len &&
+           total + entry->len <= SEND_GSO_MAX_BYTES;
+}
+
+static void CAFillSendControl(CASendBatch_t *batch, size_t index, const CASendEntry_t *head)
+{
+    struct msghdr *msg = &batch->msgs[index].msg_hdr;
+    memset(&batch->control[index], 0, sizeof (batch->control[index]));
+    msg->msg_control = &batch->control[index];
+    msg->msg_controllen = sizeof (batch->control[index]);
+
+    size_t controllen = 0;
+    struct cmsghdr *cmp = CMSG_FIRSTHDR(msg);
+    if (head->ifindex)
+    {
+        if (AF_INET6 == head->addr.ss_family)
+        {
+            struct in6_pktinfo info = { .ipi6_ifindex = head->ifindex };
+            cmp->cmsg_level = IPPROTO_IPV6;
+            cmp->cmsg_type = IPV6_PKTINFO;
+            cmp->cmsg_len = CMSG_LEN(sizeof (info));
+            memcpy(CMSG_DATA(cmp), &info, sizeof (info));
+            controllen += CMSG_SPACE(sizeof (info));
+        }
+        else
+        {
+            struct in_pktinfo info = { .ipi_ifindex = head->ifindex };
+            cmp->cmsg_level = IPPROTO_IP;
+            cmp->cmsg_type = IP_PKTINFO;
+            cmp->cmsg_len = CMSG_LEN(sizeof (info));
+            memcpy(CMSG_DATA(cmp), &info, sizeof (info));
+            controllen += CMSG_SPACE(sizeof (info));
+        }
+        cmp = CMSG_NXTHDR(msg, cmp);
+    }
+    if (batch->segments[index] > 1)
+    {
+        uint16_t segmentSize = (uint16_t)head->len;
+        cmp->cmsg_level = IPPROTO_UDP;
+        cmp->cmsg_type = UDP_SEGMENT;
+        cmp->cmsg_len = CMSG_LEN(sizeof (segmentSize));
+        memcpy(CMSG_DATA(cmp), &segmentSize, sizeof (segmentSize));
+        controllen += CMSG_SPACE(sizeof (segmentSize));
+    }
+
+    msg->msg_controllen = controllen;
+    if (!controllen)
+    {
+        msg->msg_control = NULL;
+    }
+}
+
+/*
+ * Build the messages of every entry that goes out through the socket of entry start,
+ * merging runs of equal-sized datagrams to one peer into UDP_SEGMENT messages.
+ */
+static size_t CABuildSocketMessages(CASendBatch_t *batch, size_t start)
+{
+    CASocketFd_t fd = batch->entries[start].fd;
+    size_t count = 0;
+
+    for (size_t i = start; i < batch->count; i++)
+    {
+        CASendEntry_t *head = &batch->entries[i];
+        if (head->taken || head->fd != fd)
+        {
+            continue;
+        }
+        head->taken = true;
+
+        // Merged datagrams are consecutive entries, so their data is contiguous.
+        size_t segments = 1;
+        size_t total = head->len;
+        while (i + segments < batch->count &&
+               CACanMergeSegment(head, &batch->entries[i + segments - 1], total,
+                                 &batch->entries[i + segments]))
+        {
+            batch->entries[i + segments].taken = true;
+            total += batch->entries[i + segments].len;
+            segments++;
+        }
+
+        batch->iov[count].iov_base = batch->buffer + head->offset;
+        batch->iov[count].iov_len = total;
+        batch->msgs[count].msg_hdr = (struct msghdr) { .msg_name = &head->addr,
+                                                       .msg_namelen = head->addrlen,
+                                                       .msg_iov = &batch->iov[count],
+                                                       .msg_iovlen = 1 };
+        batch->msgs[count].msg_len = 0;
+        batch->first[count] = i;
+        batch->segments[count] = segments;
+        CAFillSendControl(batch, count, head);
+        count++;
+    }
+    return count;
+}
+
+static void CAReportMessage(CASendBatch_t *batch, size_t index, bool isSuccess, int err)
+{
+    for (size_t i = 0; i < batch->segments[index]; i++)
+    {
+        const CASendEntry_t *entry = &batch->entries[batch->first[index] + i];
+        CAReportSent(entry, batch->buffer + entry->offset, isSuccess, err);
+    }
+}
+
+/*
+ * Whether the kernel refused a merged message for a reason that may only hold for this
+ * message, such as a segment larger than the path MTU or a device without checksum
+ * offload. The datagrams of the message are then sent singly.
+ */
+static bool CAIsSegmentError(int err)
+{
+    return EINVAL == err || EIO == err || EMSGSIZE == err;
+}
+
+/*
+ * Whether the kernel refused a merged message because it has no UDP_SEGMENT support.
+ */
+static bool CAIsGsoUnsupported(int err)
+{
+    return EOPNOTSUPP == err || ENOPROTOOPT == err;
+}
+
+/*
+ * Send the datagrams of a merged message one by one, after the kernel refused UDP_SEGMENT.
+ */
+static void CASendSegments(CASendBatch_t *batch, size_t index)
+{
+    struct msghdr msg = batch->msgs[index].msg_hdr;
+    const CASendEntry_t *head = &batch->entries[batch->first[index]];
+
+    // Keep the packet info, drop the segment size that follows it.
+    msg.msg_controllen = 0;
+    if (head->ifindex)
+    {
+        msg.msg_controllen = (AF_INET6 == head->addr.ss_family) ?
+                             CMSG_SPACE(sizeof (struct in6_pktinfo)) :
+                             CMSG_SPACE(sizeof (struct in_pktinfo));
+    }
+    else
+    {
+        msg.msg_control = NULL;
+    }
+
+    for (size_t i = 0; i < batch->segments[index]; i++)
+    {
+        const CASendEntry_t *entry = &batch->entries[batch->first[index] + i];
+        struct iovec iov = { .iov_base = batch->buffer + entry->offset, .iov_len = entry->len };
+        msg.msg_iov = &iov;
+
+        ssize_t len = sendmsg(entry->fd, &msg, 0);
+        CAReportSent(entry, iov.iov_base, OC_SOCKET_ERROR != len, errno);
+    }
+}
+
+static void CAFlushSocket(CASendBatch_t *batch, size_t start)
+{
+    CASocketFd_t fd = batch->entries[start].fd;
+    size_t count = CABuildSocketMessages(batch, start);
+
+    size_t sent = 0;
+    while (sent < count)
+    {
+        int ret = sendmmsg(fd, batch->msgs + sent, (unsigned int)(count - sent), 0);
+        if (ret > 0)
+        {
+            for (size_t i = sent; i < sent + (size_t)ret; i++)
+            {
+                CAReportMessage(batch, i, true, 0);
+            }
+            sent += (size_t)ret;
+            continue;
+        }
+
+        int err = errno;
+        if (EINTR == err)
+        {
+            continue;
+        }
+        if (batch->segments[sent] > 1 && CAIsGsoUnsupported(err))
+        {
+            OIC_LOG_V(INFO, TAG, "UDP_SEGMENT not supported (%s), no longer merging datagrams",
+                      strerror(err));
+            g_sendGso = false;
+            CASendSegments(batch, sent);
+        }
+        else if (batch->segments[sent] > 1 && CAIsSegmentError(err))
+        {
+            OIC_LOG_V(DEBUG, TAG, "UDP_SEGMENT message refused (%s), sending it singly",
+                      strerror(err));
+            CASendSegments(batch, sent);
+        }
+        else
+        {
+            CAReportMessage(batch, sent, false, err);
+        }
+        sent++;
+    }
+}
+
+void CAIPFlushSendData()
+{
+    CASendBatch_t *batch = g_sendBatch;
+    if (!batch || !batch->count)
+    {
+        return;
+    }
+
+    OIC_LOG_V(DEBUG, TAG, "flushing %" PRIuPTR " datagrams, %" PRIuPTR " bytes",
+              batch->count, batch->used);
+
+    for (size_t i = 0; i < batch->count; i++)
+    {
+        if (!batch->entries[i].taken)
+        {
+            CAFlushSocket(batch, i);
+        }
+    }
+
+    batch->count = 0;
+    batch->used = 0;
+}
+
+static void CAFreeSendBatch()
+{
+    OICFree(g_sendBatch);
+    g_sendBatch = NULL;
+}
+
+/*
+ * Copy a datagram into the send batch, writing the batch out first if it is full.
+ * Falls back to an immediate send when the datagram cannot be batched.
+ */
+static void CABatchData(CASocketFd_t fd, const CAEndpoint_t *endpoint, int ifindex,
+                        const void *data, size_t dlen, const char *cast, const char *fam)
+{
+    if (!g_sendBatch && dlen <= SEND_BATCH_BYTES)
+    {
+        g_sendBatch = (CASendBatch_t *)OICCalloc(1, sizeof (CASendBatch_t));
+        if (!g_sendBatch)
+        {
+            OIC_LOG(WARNING, TAG, "No memory for the send batch, sending one datagram at a time");
+        }
+    }
+    if (!g_sendBatch || dlen > SEND_BATCH_BYTES || OC_INVALID_SOCKET == fd)
+    {
+        sendData(fd, endpoint, data, dlen, cast, fam);
+        return;
+    }
+
+    CASendBatch_t *batch = g_sendBatch;
+    if (SEND_BATCH_SIZE == batch->count || batch->used + dlen > SEND_BATCH_BYTES)
+    {
+        CAIPFlushSendData();
+    }
+
+    CASendEntry_t *entry = &batch->entries[batch->count];
+    entry->fd = fd;
+    entry->endpoint = *endpoint;
+    memset(&entry->addr, 0, sizeof (entry->addr));
+    CAConvertNameToAddr(endpoint->addr, endpoint->port, &entry->addr);
+    entry->addrlen = (AF_INET6 == entry->addr.ss_family) ?
+                     sizeof (struct sockaddr_in6) : sizeof (struct sockaddr_in);
+    entry->ifindex = ifindex;
+    entry->offset = batch->used;
+    entry->len = dlen;
+    entry->taken = false;
+
+    memcpy(batch->buffer + batch->used, data, dlen);
+    batch->used += dlen;
+    batch->count++;
+}
+#endif // CA_IP_SEND_BATCH
+
 static void sendMulticastData6(const u_arraylist_t *iflist,
                                CAEndpoint_t *endpoint,
-                               const void *data, size_t datalen)
+                               const void *data, size_t datalen, bool batch)
 {
     if (!endpoint)
     {
@@ -1440,6 +2043,16 @@ static void sendMulticastData6(const u_arraylist_t *iflist,
         }
 
         int index = ifitem->index;
+#ifdef CA_IP_SEND_BATCH
+        if (batch)
+        {
+            // The interface travels as packet info, so one sendmmsg() covers all of them.
+            CABatchData(fd, endpoint, index, data, datalen, "multicast", "ipv6");
+            continue;
+        }
+#else
+        (void)batch;
+#endif
         if (setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_IF, OPTVAL_T(&index), sizeof (index)))
         {
             OIC_LOG_V(ERROR, TAG, "setsockopt6 failed: %s", CAIPS_GET_ERROR);
@@ -1451,7 +2064,7 @@ static void sendMulticastData6(const u_arraylist_t *iflist,
 
 static void sendMulticastData4(const u_arraylist_t *iflist,
                                CAEndpoint_t *endpoint,
-                               const void *data, size_t datalen)
+                               const void *data, size_t datalen, bool batch)
 {
     VERIFY_NON_NULL_VOID(endpoint, TAG, "endpoint is NULL");
 
@@ -1483,6 +2096,15 @@ static void sendMulticastData4(const u_arraylist_t *iflist,
         {
             continue;
         }
+#ifdef CA_IP_SEND_BATCH
+        if (batch)
+        {
+            CABatchData(fd, endpoint, ifitem->index, data, datalen, "multicast", "ipv4");
+            continue;
+        }
+#else
+        (void)batch;
+#endif
 #if defined(USE_IP_MREQN)
         mreq.imr_ifindex = ifitem->index;
 #else
@@ -1497,8 +2119,23 @@ static void sendMulticastData4(const u_arraylist_t *iflist,
     }
 }
 
-void CAIPSendData(CAEndpoint_t *endpoint, const void *data, size_t datalen,
-                  bool isMulticast)
+static void sendUnicastData(CASocketFd_t fd, const CAEndpoint_t *endpoint,
+                            const void *data, size_t datalen, const char *fam, bool batch)
+{
+#ifdef CA_IP_SEND_BATCH
+    if (batch)
+    {
+        CABatchData(fd, endpoint, 0, data, datalen, "unicast", fam);
+        return;
+    }
+#else
+    (void)batch;
+#endif
+    sendData(fd, endpoint, data, datalen, "unicast", fam);
+}
+
+static void CAIPSendDataInternal(CAEndpoint_t *endpoint, const void *data, size_t datalen,
+                                 bool isMulticast, bool batch)
 {
     VERIFY_NON_NULL_VOID(endpoint, TAG, "endpoint is NULL");
     VERIFY_NON_NULL_VOID(data, TAG, "data is NULL");
@@ -1518,11 +2155,11 @@ void CAIPSendData(CAEndpoint_t *endpoint, const void *data, size_t datalen,
 
         if ((endpoint->flags & CA_IPV6) && caglobals.ip.ipv6enabled)
         {
-            sendMulticastData6(iflist, endpoint, data, datalen);
+            sendMulticastData6(iflist, endpoint, data, datalen, batch);
         }
         if ((endpoint->flags & CA_IPV4) && caglobals.ip.ipv4enabled)
         {
-            sendMulticastData4(iflist, endpoint, data, datalen);
+            sendMulticastData4(iflist, endpoint, data, datalen, batch);
         }
 
         u_arraylist_destroy(iflist);
@@ -1541,7 +2178,7 @@ void CAIPSendData(CAEndpoint_t *endpoint, const void *data, size_t datalen,
 #ifndef __WITH_DTLS__
             fd = caglobals.ip.u6.fd;
 #endif
-            sendData(fd, endpoint, data, datalen, "unicast", "ipv6");
+            sendUnicastData(fd, endpoint, data, datalen, "ipv6", batch);
         }
         if (caglobals.ip.ipv4enabled && (endpoint->flags & CA_IPV4))
         {
@@ -1549,11 +2186,29 @@ void CAIPSendData(CAEndpoint_t *endpoint, const void *data, size_t datalen,
 #ifndef __WITH_DTLS__
             fd = caglobals.ip.u4.fd;
 #endif
-            sendData(fd, endpoint, data, datalen, "unicast", "ipv4");
+            sendUnicastData(fd, endpoint, data, datalen, "ipv4", batch);
         }
     }
 }
 
+void CAIPSendData(CAEndpoint_t *endpoint, const void *data, size_t datalen,
+                  bool isMulticast)
+{
+    CAIPSendDataInternal(endpoint, data, datalen, isMulticast, false);
+}
+
+void CAIPBatchSendData(CAEndpoint_t *endpoint, const void *data, size_t datalen,
+                       bool isMulticast)
+{
+    CAIPSendDataInternal(endpoint, data, datalen, isMulticast, true);
+}
+
+#ifndef CA_IP_SEND_BATCH
+void CAIPFlushSendData()
+{
+}
+#endif
+
 CAResult_t CAGetIPInterfaceInformation(CAEndpoint_t **info, size_t *size)
 {
     VERIFY_NON_NULL(info, TAG, "info is NULL");
@@ -38,6 +38,7 @@
 #include "octhread.h"
 #include "uarraylist.h"
 #include "caremotehandler.h"
+#include "caprotocolmessage.h"
 #include "experimental/logger.h"
 #include "oic_malloc.h"
 #ifdef __WITH_TLS__
@@ -60,12 +61,21 @@ typedef struct
     size_t dataLen;
     bool isMulticast;
     bool encryptedData;
+    bool isSignaling;   /**< send our CSM instead of data */
 } CATCPData;
 
 #define CA_TCP_LISTEN_BACKLOG  3
 
 #define CA_TCP_SELECT_TIMEOUT 10
 
+#define CA_TCP_CONNECT_TIMEOUT 10
+
+/**
+ * Max-Message-Size announced in our CSM: 64 BERT blocks and room for the header and
+ * the options of the message that carries them.
+ */
+#define CA_TCP_MAX_MESSAGE_SIZE (65 * 1024)
+
 /**
  * Queue handle for Send Data.
  */
@@ -161,6 +171,79 @@ void CATCPConnectionStateCB(const char *ipAddress, CANetworkStatus_t status)
     (void)status;
 }
 
+#ifndef SINGLE_THREAD
+/**
+ * Keep the capabilities a peer announced in its CSM and answer with ours if it has
+ * not been sent on the session yet.
+ */
+static void CATCPReceiveCSM(const CAEndpoint_t *endpoint, const void *data, size_t dataLength)
+{
+    uint32_t maxMessageSize = CA_DEFAULT_MAX_MESSAGE_SIZE;
+    bool blockWiseTransfer = false;
+    if (CA_STATUS_OK != CAParseCSM(data, dataLength, &maxMessageSize, &blockWiseTransfer))
+    {
+        OIC_LOG(DEBUG, TAG, "signaling message is ignored");
+        return;
+    }
+
+    OIC_LOG_V(DEBUG, TAG, "CSM received: Max-Message-Size %" PRIu32 ", BERT %d",
+              maxMessageSize, blockWiseTransfer);
+    if (!CASetTCPPeerCapabilities(endpoint, maxMessageSize, blockWiseTransfer))
+    {
+        // Sent from the send thread so that it keeps its place among the queued messages.
+        uint8_t placeholder = 0;
+        CATCPData *tcpData = CACreateTCPData(endpoint, &placeholder, sizeof(placeholder),
+                                             false, false);
+        if (tcpData)
+        {
+            tcpData->isSignaling = true;
+            CAQueueingThreadAddData(g_sendQueueHandle, tcpData, sizeof(CATCPData));
+        }
+    }
+}
+
+/**
+ * Send our CSM on the session with endpoint unless it has been sent already.
+ */
+static void CATCPSendCSM(CAEndpoint_t *endpoint)
+{
+    if (CAIsTCPSessionCSMSent(endpoint))
+    {
+        return;
+    }
+
+    coap_transport_t transport = COAP_TCP;
+    coap_pdu_t *pdu = CAGenerateCSMPDU(caglobals.tcp.maxMessageSize, true, &transport);
+    if (!pdu)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to generate CSM");
+        return;
+    }
+
+    bool sent = false;
+#ifdef __WITH_TLS__
+    if (endpoint->flags & CA_SECURE)
+    {
+        sent = (CA_STATUS_OK == CAencryptSsl(endpoint, pdu->transport_hdr, pdu->length));
+    }
+    else
+#endif
+    {
+        sent = (-1 != CATCPSendData(endpoint, pdu->transport_hdr, pdu->length));
+    }
+    coap_delete_pdu(pdu);
+
+    if (sent)
+    {
+        CASetTCPSessionCSMSent(endpoint);
+    }
+    else
+    {
+        OIC_LOG(ERROR, TAG, "Failed to send CSM");
+    }
+}
+#endif
+
 void CATCPPacketReceivedCB(const CASecureEndpoint_t *sep, const void *data,
                            size_t dataLength)
 {
@@ -204,7 +287,11 @@ void CATCPPacketReceivedCB(const CASecureEndpoint_t *sep, const void *data,
         //when successfully read all required data - pass them to upper layer.
         if (svritem->len == svritem->totalLen)
         {
-            if (g_networkPacketCallback)
+            if (CAIsSignalingMessage(svritem->data, svritem->totalLen))
+            {
+                CATCPReceiveCSM(&sep->endpoint, svritem->data, svritem->totalLen);
+            }
+            else if (g_networkPacketCallback)
             {
                 g_networkPacketCallback(sep, svritem->data, svritem->totalLen);
             }
@@ -313,6 +400,18 @@ static void CAInitializeTCPGlobals()
     caglobals.tcp.selectTimeout = CA_TCP_SELECT_TIMEOUT;
     caglobals.tcp.listenBacklog = CA_TCP_LISTEN_BACKLOG;
 
+    // Keep a timeout set by CASetTCPConnectTimeout before the adapter was initialized.
+    if (0 >= caglobals.tcp.connectTimeout)
+    {
+        caglobals.tcp.connectTimeout = CA_TCP_CONNECT_TIMEOUT;
+    }
+
+    // Likewise for a size set by CASetTCPBlockWiseTransfer.
+    if (0 == caglobals.tcp.maxMessageSize)
+    {
+        caglobals.tcp.maxMessageSize = CA_TCP_MAX_MESSAGE_SIZE;
+    }
+
     CATransportFlags_t flags = 0;
     if (caglobals.client)
     {
@@ -595,8 +694,21 @@ void CATCPSendDataThread(void *threadData)
     }
     else
     {
+#ifndef SINGLE_THREAD
+        if (tcpData->isSignaling)
+        {
+            CATCPSendCSM(tcpData->remoteEndpoint);
+            return;
+        }
+#endif
+
         if (!tcpData->encryptedData)
         {
+#ifndef SINGLE_THREAD
+            // The peer learns our Max-Message-Size before the first message.
+            CATCPSendCSM(tcpData->remoteEndpoint);
+#endif
+
             // Check payload length from CoAP over TCP format header.
             size_t payloadLen = CACheckPayloadLengthFromHeader(tcpData->data, tcpData->dataLen);
             if (!payloadLen)
@@ -36,6 +36,9 @@
 #ifdef HAVE_SYS_POLL_H
 #include <sys/poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 #include <stdio.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -63,6 +66,7 @@
 #include "octhread.h"
 #include "oic_malloc.h"
 #include "oic_string.h"
+#include "oic_time.h"
 
 #include <coap/pdu.h>
 #include <coap/utlist.h>
@@ -88,6 +92,42 @@
  */
 #define TLS_HEADER_SIZE 5
 
+/**
+ * Where epoll is available the receive thread waits on an edge-triggered epoll set instead
+ * of select(). Sessions are registered once when they connect, and the number of sessions
+ * is not limited by FD_SETSIZE.
+ */
+#if defined(HAVE_SYS_EPOLL_H) && !defined(WSA_WAIT_EVENT_0)
+#define CA_TCP_USE_EPOLL
+#endif
+
+#ifdef CA_TCP_USE_EPOLL
+/**
+ * Maximum number of ready sockets taken from the epoll set per wakeup.
+ */
+#define CA_TCP_MAX_EPOLL_EVENTS 64
+#endif
+
+/**
+ * Outgoing connections are started with a non-blocking connect() and completed by the
+ * receive thread once the socket becomes writable. Data sent meanwhile is queued on the
+ * session and flushed when the connection is established.
+ */
+#if !defined(WSA_WAIT_EVENT_0)
+#define CA_TCP_ASYNC_CONNECT
+
+/**
+ * Longest time in ms the receive thread waits while a connection is in progress, so that
+ * connect timeouts are noticed without another event.
+ */
+#define CA_TCP_CONNECT_CHECK_INTERVAL_MS 1000
+#endif
+
+/**
+ * Number of buckets the session indexes start with; always a power of two.
+ */
+#define CA_TCP_SESSION_INDEX_INITIAL_BUCKETS 64
+
 /**
  * Mutex to synchronize device object list.
  */
@@ -118,21 +158,53 @@ static CATCPConnectionHandleCallback g_connectionCallback = NULL;
  */
 static CATCPSessionInfo_t *g_sessionList = NULL;
 
+/**
+ * Sessions keyed by remote address and port, and sessions keyed by socket.
+ * A session is in the socket index whenever its fd is valid.
+ * Both are protected by g_mutexObjectList, like g_sessionList itself.
+ */
+static OCHashTable g_sessionsByEndpoint =
+        OC_HASH_TABLE_INITIALIZER(CA_TCP_SESSION_INDEX_INITIAL_BUCKETS);
+static OCHashTable g_sessionsByFd =
+        OC_HASH_TABLE_INITIALIZER(CA_TCP_SESSION_INDEX_INITIAL_BUCKETS);
+
+#ifdef CA_TCP_USE_EPOLL
+/**
+ * epoll instance watching the accept sockets, the shutdown pipe and every connected session.
+ */
+static int g_epollFd = -1;
+#endif
+
+#ifdef CA_TCP_ASYNC_CONNECT
+/**
+ * Number of sessions with a connect in progress. Protected by g_mutexObjectList.
+ */
+static size_t g_connectingCount = 0;
+#endif
+
 static CAResult_t CATCPCreateMutex();
 static void CATCPDestroyMutex();
 static CAResult_t CATCPCreateCond();
 static void CATCPDestroyCond();
 static CASocketFd_t CACreateAcceptSocket(int family, CASocket_t *sock);
-static void CAAcceptConnection(CATransportFlags_t flag, CASocket_t *sock);
+static bool CAAcceptConnection(CATransportFlags_t flag, CASocket_t *sock);
 static void CAFindReadyMessage();
-#if !defined(WSA_WAIT_EVENT_0)
+#if defined(CA_TCP_USE_EPOLL)
+static void CAEpollReturned(int fd);
+static CAResult_t CARegisterSession(CATCPSessionInfo_t *svritem);
+#elif !defined(WSA_WAIT_EVENT_0)
+static void CAConnectReturned(fd_set *writeFds);
 static void CASelectReturned(fd_set *readFds);
 #else
 static void CASocketEventReturned(CASocketFd_t socket, long networkEvents);
 #endif
-static CAResult_t CAReceiveMessage(CATCPSessionInfo_t *svritem);
+static CAResult_t CAReceiveMessage(CATCPSessionInfo_t *svritem, bool *wouldBlock);
 static void CAReceiveHandler(void *data);
 static CAResult_t CATCPCreateSocket(int family, CATCPSessionInfo_t *svritem);
+#ifdef CA_TCP_ASYNC_CONNECT
+static void CAFinishConnect(CATCPSessionInfo_t *svritem);
+static void CACheckConnectTimeouts();
+#endif
 
 #if defined(WSA_WAIT_EVENT_0)
 #define CHECKFD(FD)
@@ -207,6 +279,136 @@ static CAResult_t CATCPCreateCond()
     return CA_STATUS_OK;
 }
 
+static uint32_t CAHashEndpoint(const char *addr, uint16_t port)
+{
+    // Hash the textual address, which is what sessions are matched on.
+    uint32_t hash = OCHashBytes(OC_HASH_INIT, addr, strnlen(addr, MAX_ADDR_STR_SIZE_CA));
+    return OCHashBytes(hash, &port, sizeof(port));
+}
+
+static uint32_t CAHashFd(CASocketFd_t fd)
+{
+    return OCHashBytes(OC_HASH_INIT, &fd, sizeof(fd));
+}
+
+static void CARemoveByFd(CATCPSessionInfo_t *svritem)
+{
+    if (OC_INVALID_SOCKET != svritem->fd)
+    {
+        OCHashTableRemove(&g_sessionsByFd, &svritem->fdLink);
+    }
+}
+
+/**
+ * Append a session to g_sessionList and to the session indexes.
+ * The endpoint of the session must be set; its fd may be OC_INVALID_SOCKET.
+ *
+ * @param[in] svritem  session to add
+ * @return CA_STATUS_OK or CA_MEMORY_ALLOC_FAILED, in which case the session is not added
+ */
+static CAResult_t CAAddSession(CATCPSessionInfo_t *svritem)
+{
+    oc_mutex_lock(g_mutexObjectList);
+    if (!OCHashTableInsert(&g_sessionsByEndpoint, &svritem->endpointLink,
+                           CAHashEndpoint(svritem->sep.endpoint.addr,
+                                          svritem->sep.endpoint.port)))
+    {
+        oc_mutex_unlock(g_mutexObjectList);
+        OIC_LOG(ERROR, TAG, "Out of memory");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+    if (OC_INVALID_SOCKET != svritem->fd
+        && !OCHashTableInsert(&g_sessionsByFd, &svritem->fdLink, CAHashFd(svritem->fd)))
+    {
+        OCHashTableRemove(&g_sessionsByEndpoint, &svritem->endpointLink);
+        oc_mutex_unlock(g_mutexObjectList);
+        OIC_LOG(ERROR, TAG, "Out of memory");
+        return CA_MEMORY_ALLOC_FAILED;
+    }
+    LL_APPEND(g_sessionList, svritem);
+    oc_mutex_unlock(g_mutexObjectList);
+    return CA_STATUS_OK;
+}
+
+/**
+ * Remove a session from g_sessionList and from the session indexes.
+ * The caller must hold g_mutexObjectList.
+ */
+static void CARemoveSession(CATCPSessionInfo_t *svritem)
+{
+    LL_DELETE(g_sessionList, svritem);
+#ifdef CA_TCP_ASYNC_CONNECT
+    if (svritem->connectDeadline)
+    {
+        svritem->connectDeadline = 0;
+        g_connectingCount--;
+    }
+#endif
+    OCHashTableRemove(&g_sessionsByEndpoint, &svritem->endpointLink);
+    CARemoveByFd(svritem);
+}
+
+/**
+ * Set the socket of a session that is in g_sessionList, keeping the socket index in sync.
+ */
+static void CASetSessionFd(CATCPSessionInfo_t *svritem, CASocketFd_t fd)
+{
+    oc_mutex_lock(g_mutexObjectList);
+    CARemoveByFd(svritem);
+    svritem->fd = fd;
+    if (OC_INVALID_SOCKET != fd
+        && !OCHashTableInsert(&g_sessionsByFd, &svritem->fdLink, CAHashFd(fd)))
+    {
+        OIC_LOG(ERROR, TAG, "Failed to index session socket");
+    }
+    oc_mutex_unlock(g_mutexObjectList);
+}
+
+/**
+ * Find the session using a socket. The caller must hold g_mutexObjectList.
+ */
+static CATCPSessionInfo_t *CAGetSessionFromFd(CASocketFd_t fd)
+{
+    for (OCHashLink *link = OCHashTableFirst(&g_sessionsByFd, CAHashFd(fd)); link;
+         link = OCHashTableNext(link))
+    {
+        CATCPSessionInfo_t *session = OC_HASH_ENTRY(link, CATCPSessionInfo_t, fdLink);
+        if (session->fd == fd)
+        {
+            return session;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Find the oldest session to the endpoint's address and port that shares a transport flag
+ * with it. The caller must hold g_mutexObjectList.
+ */
+static CATCPSessionInfo_t *CAGetSessionFromEndpoint(const CAEndpoint_t *endpoint)
+{
+    for (OCHashLink *link = OCHashTableFirst(&g_sessionsByEndpoint,
+                                             CAHashEndpoint(endpoint->addr, endpoint->port));
+         link; link = OCHashTableNext(link))
+    {
+        CATCPSessionInfo_t *session = OC_HASH_ENTRY(link, CATCPSessionInfo_t, endpointLink);
+        if (!strncmp(session->sep.endpoint.addr, endpoint->addr,
+                     sizeof(session->sep.endpoint.addr))
+                && (session->sep.endpoint.port == endpoint->port)
+                && (session->sep.endpoint.flags & endpoint->flags))
+        {
+            return session;
+        }
+    }
+    return NULL;
+}
+
+static void CAClearSessionIndexes()
+{
+    OCHashTableClear(&g_sessionsByEndpoint);
+    OCHashTableClear(&g_sessionsByFd);
+}
+
 static void CAReceiveHandler(void *data)
 {
     (void)data;
@@ -225,13 +427,216 @@ static void CAReceiveHandler(void *data)
 }
 
 #if !defined(WSA_WAIT_EVENT_0)
+static bool CASetNonBlocking(CASocketFd_t fd, bool nonBlocking)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (-1 != flags)
+    {
+        flags = nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    }
+    if (-1 == flags || -1 == fcntl(fd, F_SETFL, flags))
+    {
+        OIC_LOG_V(ERROR, TAG, "set O_NONBLOCK failed: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+#endif
+
+#if defined(CA_TCP_USE_EPOLL)
+
+static bool CAEpollAdd(int fd, uint32_t events)
+{
+    struct epoll_event event = { .events = events, .data.fd = fd };
+    if (-1 == epoll_ctl(g_epollFd, EPOLL_CTL_ADD, fd, &event))
+    {
+        OIC_LOG_V(ERROR, TAG, "epoll_ctl add failed: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+#define CA_EPOLL_ADD_ACCEPT_SOCKET(TYPE) \
+    if (caglobals.tcp.TYPE.fd != OC_INVALID_SOCKET && \
+        (!CASetNonBlocking(caglobals.tcp.TYPE.fd, true) || \
+         !CAEpollAdd(caglobals.tcp.TYPE.fd, EPOLLIN | EPOLLET))) \
+    { \
+        return CA_SOCKET_OPERATION_FAILED; \
+    }
+
+/**
+ * Create the epoll set and add the accept sockets and the shutdown pipe to it.
+ * Sessions are added by CARegisterSession once they are connected.
+ */
+static CAResult_t CAInitializeEpoll()
+{
+    g_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (-1 == g_epollFd)
+    {
+        OIC_LOG_V(ERROR, TAG, "epoll_create1 failed: %s", strerror(errno));
+        return CA_SOCKET_OPERATION_FAILED;
+    }
+
+    CA_EPOLL_ADD_ACCEPT_SOCKET(ipv4);
+    CA_EPOLL_ADD_ACCEPT_SOCKET(ipv4s);
+    CA_EPOLL_ADD_ACCEPT_SOCKET(ipv6);
+    CA_EPOLL_ADD_ACCEPT_SOCKET(ipv6s);
+
+    // Level-triggered: once the write end is closed the receive thread must keep waking up.
+    if (OC_INVALID_SOCKET != caglobals.tcp.shutdownFds[0] &&
+        !CAEpollAdd(caglobals.tcp.shutdownFds[0], EPOLLIN))
+    {
+        return CA_SOCKET_OPERATION_FAILED;
+    }
+    return CA_STATUS_OK;
+}
+
+static void CATerminateEpoll()
+{
+    if (-1 != g_epollFd)
+    {
+        close(g_epollFd);
+        g_epollFd = -1;
+    }
+}
+
+/**
+ * Make a connected session visible to the receive thread. The socket is switched to
+ * non-blocking mode, since an edge-triggered socket has to be read until it would block.
+ */
+static CAResult_t CARegisterSession(CATCPSessionInfo_t *svritem)
+{
+    VERIFY_NON_NULL(svritem, TAG, "svritem is NULL");
+
+    if (-1 == g_epollFd)
+    {
+        OIC_LOG(ERROR, TAG, "receive thread is not running");
+        return CA_SOCKET_OPERATION_FAILED;
+    }
+    if (!CASetNonBlocking(svritem->fd, true))
+    {
+        return CA_SOCKET_OPERATION_FAILED;
+    }
+
+    if (!CAEpollAdd(svritem->fd, EPOLLIN | EPOLLET))
+    {
+        return CA_SOCKET_OPERATION_FAILED;
+    }
+    return CA_STATUS_OK;
+}
+
+static void CAFindReadyMessage()
+{
+    struct epoll_event events[CA_TCP_MAX_EPOLL_EVENTS];
+    int timeout = caglobals.tcp.selectTimeout * 1000;
+    if (g_connectingCount && timeout > CA_TCP_CONNECT_CHECK_INTERVAL_MS)
+    {
+        timeout = CA_TCP_CONNECT_CHECK_INTERVAL_MS;
+    }
+    int count = epoll_wait(g_epollFd, events, CA_TCP_MAX_EPOLL_EVENTS, timeout);
+
+    if (caglobals.tcp.terminate)
+    {
+        OIC_LOG_V(DEBUG, TAG, "Packet receiver Stop request received.");
+        return;
+    }
+
+    if (0 > count)
+    {
+        if (EINTR != errno)
+        {
+            OIC_LOG_V(FATAL, TAG, "epoll_wait error %s", strerror(errno));
+        }
+        return;
+    }
+
+    // Unlike select, every socket that became ready is handled before waiting again.
+    for (int i = 0; i < count; i++)
+    {
+        CAEpollReturned(events[i].data.fd);
+    }
+
+    CACheckConnectTimeouts();
+}
+
+static void CAEpollReturned(int fd)
+{
+    if (fd == caglobals.tcp.ipv4.fd)
+    {
+        while (CAAcceptConnection(CA_IPV4, &caglobals.tcp.ipv4));
+        return;
+    }
+    if (fd == caglobals.tcp.ipv4s.fd)
+    {
+        while (CAAcceptConnection(CA_IPV4 | CA_SECURE, &caglobals.tcp.ipv4s));
+        return;
+    }
+    if (fd == caglobals.tcp.ipv6.fd)
+    {
+        while (CAAcceptConnection(CA_IPV6, &caglobals.tcp.ipv6));
+        return;
+    }
+    if (fd == caglobals.tcp.ipv6s.fd)
+    {
+        while (CAAcceptConnection(CA_IPV6 | CA_SECURE, &caglobals.tcp.ipv6s));
+        return;
+    }
+    if (fd == caglobals.tcp.shutdownFds[0])
+    {
+        // CAReceiveHandler checks the terminate flag.
+        return;
+    }
+
+    oc_mutex_lock(g_mutexObjectList);
+    CATCPSessionInfo_t *session = CAGetSessionFromFd(fd);
+    if (session && CONNECTING == session->state)
+    {
+        // Writable or failed; data may already have arrived with the same event.
+        CAFinishConnect(session);
+        session = CAGetSessionFromFd(fd);
+    }
+    if (session && CONNECTED == session->state)
+    {
+        // Edge-triggered: read until the socket has nothing left, or no further event comes.
+        bool wouldBlock = false;
+        CAResult_t res = CA_STATUS_OK;
+        while (CA_STATUS_OK == res && !wouldBlock)
+        {
+            res = CAReceiveMessage(session, &wouldBlock);
+        }
+
+        //disconnect session and clean-up data if any error occurs.
+        //CAReceiveMessage may already have deleted the session itself.
+        if (res != CA_STATUS_OK && CAGetSessionFromFd(fd) == session)
+        {
+#ifdef __WITH_TLS__
+            if (CA_STATUS_OK != CAcloseSslConnection(&session->sep.endpoint))
+            {
+                OIC_LOG(ERROR, TAG, "Failed to close TLS session");
+            }
+#endif
+            CARemoveSession(session);
+            CADisconnectTCPSession(session);
+        }
+    }
+    oc_mutex_unlock(g_mutexObjectList);
+}
+
+#elif !defined(WSA_WAIT_EVENT_0)
 
 static void CAFindReadyMessage()
 {
     fd_set readFds;
+    fd_set writeFds;
     struct timeval timeout = { .tv_sec = caglobals.tcp.selectTimeout };
+    if (g_connectingCount &&
+        caglobals.tcp.selectTimeout * 1000 > CA_TCP_CONNECT_CHECK_INTERVAL_MS)
+    {
+        timeout.tv_sec = CA_TCP_CONNECT_CHECK_INTERVAL_MS / 1000;
+    }
 
     FD_ZERO(&readFds);
+    FD_ZERO(&writeFds);
     CA_FD_SET(ipv4, &readFds);
     CA_FD_SET(ipv4s, &readFds);
     CA_FD_SET(ipv6, &readFds);
@@ -253,9 +658,13 @@ static void CAFindReadyMessage()
         {
             FD_SET(session->fd, &readFds);
         }
+        else if (session && session->fd != OC_INVALID_SOCKET && session->connectDeadline)
+        {
+            FD_SET(session->fd, &writeFds);
+        }
     }
 
-    int ret = select(caglobals.tcp.maxfd + 1, &readFds, NULL, NULL, &timeout);
+    int ret = select(caglobals.tcp.maxfd + 1, &readFds, &writeFds, NULL, &timeout);
 
     if (caglobals.tcp.terminate)
     {
@@ -263,19 +672,36 @@ static void CAFindReadyMessage()
         return;
     }
 
-    if (0 == ret)
-    {
-        return;
-    }
-    else if (0 < ret)
+    if (0 < ret)
     {
+        CAConnectReturned(&writeFds);
         CASelectReturned(&readFds);
     }
-    else // if (0 > ret)
+    else if (0 > ret)
     {
         OIC_LOG_V(FATAL, TAG, "select error %s", strerror(errno));
         return;
     }
+
+    CACheckConnectTimeouts();
+}
+
+static void CAConnectReturned(fd_set *writeFds)
+{
+    oc_mutex_lock(g_mutexObjectList);
+    CATCPSessionInfo_t *session = NULL;
+    LL_FOREACH(g_sessionList, session)
+    {
+        if (session->fd != OC_INVALID_SOCKET && session->connectDeadline &&
+            FD_ISSET(session->fd, writeFds))
+        {
+            // CAFinishConnect drops the lock and runs callbacks, so the list may change;
+            // handle one per wakeup. select returns again at once for the others.
+            CAFinishConnect(session);
+            break;
+        }
+    }
+    oc_mutex_unlock(g_mutexObjectList);
 }
 
 static void CASelectReturned(fd_set *readFds)
@@ -327,7 +753,7 @@ static void CASelectReturned(fd_set *readFds)
             {
                 if (FD_ISSET(session->fd, readFds))
                 {
-                    CAResult_t res = CAReceiveMessage(session);
+                    CAResult_t res = CAReceiveMessage(session, NULL);
                     //disconnect session and clean-up data if any error occurs
                     if (res != CA_STATUS_OK)
                     {
@@ -337,7 +763,7 @@ static void CASelectReturned(fd_set *readFds)
                             OIC_LOG(ERROR, TAG, "Failed to close TLS session");
                         }
 #endif
-                        LL_DELETE(g_sessionList, session);
+                        CARemoveSession(session);
                         CADisconnectTCPSession(session);
                         oc_mutex_unlock(g_mutexObjectList);
                         return;
@@ -535,27 +961,21 @@ static void CASocketEventReturned(CASocketFd_t s, long networkEvents)
     if (FD_READ & networkEvents)
     {
         oc_mutex_lock(g_mutexObjectList);
-        CATCPSessionInfo_t *session = NULL;
-        CATCPSessionInfo_t *tmp = NULL;
-        LL_FOREACH_SAFE(g_sessionList, session, tmp)
+        CATCPSessionInfo_t *session = CAGetSessionFromFd(s);
+        if (session)
         {
-            if (session && (session->fd == s))
+            CAResult_t res = CAReceiveMessage(session, NULL);
+            //disconnect session and clean-up data if any error occurs
+            if (res != CA_STATUS_OK)
             {
-                CAResult_t res = CAReceiveMessage(session);
-                //disconnect session and clean-up data if any error occurs
-                if (res != CA_STATUS_OK)
-                {
 #ifdef __WITH_TLS__
-                    if (CA_STATUS_OK != CAcloseSslConnection(&session->sep.endpoint))
-                    {
-                        OIC_LOG(ERROR, TAG, "Failed to close TLS session");
-                    }
-#endif
-                    LL_DELETE(g_sessionList, session);
-                    CADisconnectTCPSession(session);
-                    oc_mutex_unlock(g_mutexObjectList);
-                    return;
+                if (CA_STATUS_OK != CAcloseSslConnection(&session->sep.endpoint))
+                {
+                    OIC_LOG(ERROR, TAG, "Failed to close TLS session");
                 }
+#endif
+                CARemoveSession(session);
+                CADisconnectTCPSession(session);
             }
         }
         oc_mutex_unlock(g_mutexObjectList);
@@ -564,9 +984,16 @@ static void CASocketEventReturned(CASocketFd_t s, long networkEvents)
 
 #endif // WSA_WAIT_EVENT_0
 
-static void CAAcceptConnection(CATransportFlags_t flag, CASocket_t *sock)
+/**
+ * Accept one pending connection on an accept socket.
+ *
+ * @param[in] flag  transport flags of the accept socket
+ * @param[in] sock  accept socket
+ * @return true if a connection was taken from the accept queue, false if it was empty
+ */
+static bool CAAcceptConnection(CATransportFlags_t flag, CASocket_t *sock)
 {
-    VERIFY_NON_NULL_VOID(sock, TAG, "sock is NULL");
+    VERIFY_NON_NULL_RET(sock, TAG, "sock is NULL", false);
 
     struct sockaddr_storage clientaddr;
     socklen_t clientlen = sizeof (struct sockaddr_in);
@@ -584,7 +1011,7 @@ static void CAAcceptConnection(CATransportFlags_t flag, CASocket_t *sock)
         {
             OIC_LOG(ERROR, TAG, "Out of memory");
             OC_CLOSE_SOCKET(sockfd);
-            return;
+            return true;
         }
 
         svritem->fd = sockfd;
@@ -595,9 +1022,24 @@ static void CAAcceptConnection(CATransportFlags_t flag, CASocket_t *sock)
         CAConvertAddrToName((struct sockaddr_storage *)&clientaddr, clientlen,
                             svritem->sep.endpoint.addr, &svritem->sep.endpoint.port);
 
-        oc_mutex_lock(g_mutexObjectList);
-        LL_APPEND(g_sessionList, svritem);
-        oc_mutex_unlock(g_mutexObjectList);
+        if (CA_STATUS_OK != CAAddSession(svritem))
+        {
+            OC_CLOSE_SOCKET(sockfd);
+            OICFree(svritem);
+            return true;
+        }
+
+#ifdef CA_TCP_USE_EPOLL
+        if (CA_STATUS_OK != CARegisterSession(svritem))
+        {
+            oc_mutex_lock(g_mutexObjectList);
+            CARemoveSession(svritem);
+            oc_mutex_unlock(g_mutexObjectList);
+            OC_CLOSE_SOCKET(sockfd);
+            OICFree(svritem);
+            return true;
+        }
+#endif
 
         CHECKFD(sockfd);
 
@@ -606,7 +1048,9 @@ static void CAAcceptConnection(CATransportFlags_t flag, CASocket_t *sock)
         {
             g_connectionCallback(&(svritem->sep.endpoint), true, svritem->isClient);
         }
+        return true;
     }
+    return false;
 }
 
 /**
@@ -743,7 +1187,15 @@ CAResult_t CAConstructCoAP(CATCPSessionInfo_t *svritem, unsigned char **data,
     return CA_STATUS_OK;
 }
 
-static CAResult_t CAReceiveMessage(CATCPSessionInfo_t *svritem)
+/**
+ * Read the next chunk of data from a session and pass complete messages on.
+ *
+ * @param[in] svritem     session to read from
+ * @param[out] wouldBlock if not NULL, set to true when the socket had no data left. The
+ *                        socket must then be non-blocking; without it that is an error.
+ * @return CA_STATUS_OK or appropriate error code
+ */
+static CAResult_t CAReceiveMessage(CATCPSessionInfo_t *svritem, bool *wouldBlock)
 {
     VERIFY_NON_NULL(svritem, TAG, "svritem is NULL");
 
@@ -783,7 +1235,11 @@ static CAResult_t CAReceiveMessage(CATCPSessionInfo_t *svritem)
         }
 
         len = recv(svritem->fd, (char*)svritem->tlsdata + svritem->tlsLen, (int)nbRead, 0);
-        if (len < 0)
+        if (len < 0 && wouldBlock && (EAGAIN == errno || EWOULDBLOCK == errno))
+        {
+            *wouldBlock = true;
+        }
+        else if (len < 0)
         {
             OIC_LOG_V(ERROR, TAG, "recv failed %s", strerror(errno));
             res = CA_RECEIVE_FAILED;
@@ -809,65 +1265,370 @@ static CAResult_t CAReceiveMessage(CATCPSessionInfo_t *svritem)
 #endif
 
     }
-    else
+    else
+    {
+        svritem->protocol = COAP;
+
+        // svritem->tlsdata can also be used as receiving buffer in case of raw tcp
+        len = recv(svritem->fd, (char*)svritem->tlsdata, sizeof(svritem->tlsdata), 0);
+        if (len < 0 && wouldBlock && (EAGAIN == errno || EWOULDBLOCK == errno))
+        {
+            *wouldBlock = true;
+        }
+        else if (len < 0)
+        {
+            OIC_LOG_V(ERROR, TAG, "recv failed %s", strerror(errno));
+            res = CA_RECEIVE_FAILED;
+        }
+        else if (0 == len)
+        {
+            OIC_LOG(INFO, TAG, "Received disconnect from peer. Close connection");
+            res = CA_DESTINATION_DISCONNECTED;
+        }
+        else
+        {
+            OIC_LOG_V(DEBUG, TAG, "recv() : %d bytes", len);
+            //when successfully read data - pass them to callback.
+            if (g_packetReceivedCallback)
+            {
+                g_packetReceivedCallback(&svritem->sep, svritem->tlsdata, len);
+            }
+        }
+    }
+
+    return res;
+}
+
+#if defined(CA_TCP_USE_EPOLL)
+// Sessions are added to the epoll set directly; the receive thread needs no wakeup.
+#elif !defined(WSA_WAIT_EVENT_0)
+static ssize_t CAWakeUpForReadFdsUpdate(const char *host)
+{
+    if (caglobals.tcp.connectionFds[1] != -1)
+    {
+        ssize_t len = 0;
+        do
+        {
+            len = write(caglobals.tcp.connectionFds[1], host, strlen(host));
+        } while ((len == -1) && (errno == EINTR));
+
+        if ((len == -1) && (errno != EINTR) && (errno != EPIPE))
+        {
+            OIC_LOG_V(DEBUG, TAG, "write failed: %s", strerror(errno));
+        }
+        return len;
+    }
+    return -1;
+}
+#else
+static void CAWakeUpForReadFdsUpdate()
+{
+    if (WSA_INVALID_EVENT != caglobals.tcp.updateEvent)
+    {
+        if (!WSASetEvent(caglobals.tcp.updateEvent))
+        {
+            OIC_LOG_V(DEBUG, TAG, "CAWakeUpForReadFdsUpdate: set shutdown event failed: %u", GetLastError());
+        }
+    }
+}
+#endif
+
+/**
+ * Send the whole buffer on a connected socket.
+ *
+ * @return dlen on success, -1 if the socket failed or had no room for too long.
+ */
+static ssize_t CASendAll(CASocketFd_t sockFd, const CAEndpoint_t *endpoint,
+                         const void *data, size_t dlen)
+{
+    ssize_t remainLen = dlen;
+    do
+    {
+        int dataToSend = (remainLen > INT_MAX) ? INT_MAX : (int)remainLen;
+        ssize_t len = send(sockFd, data, dataToSend, 0);
+        if (-1 == len)
+        {
+            if (EWOULDBLOCK != errno)
+            {
+                OIC_LOG_V(ERROR, TAG, "unicast ipv4tcp sendTo failed: %s", strerror(errno));
+                CALogSendStateInfo(endpoint->adapter, endpoint->addr, endpoint->port,
+                                   len, false, strerror(errno));
+                return len;
+            }
+#if !defined(WSA_WAIT_EVENT_0)
+            // The socket is non-blocking; wait for room instead of spinning.
+            struct pollfd writeFd = { .fd = sockFd, .events = POLLOUT };
+            if (0 >= poll(&writeFd, 1, caglobals.tcp.selectTimeout * 1000))
+            {
+                OIC_LOG(ERROR, TAG, "unicast tcp sendTo timed out");
+                CALogSendStateInfo(endpoint->adapter, endpoint->addr, endpoint->port,
+                                   -1, false, "send timed out");
+                return -1;
+            }
+#endif
+            continue;
+        }
+        data = ((char*)data) + len;
+        remainLen -= len;
+    } while (remainLen > 0);
+
+    return dlen;
+}
+
+#ifdef CA_TCP_ASYNC_CONNECT
+/**
+ * Keep a copy of data sent to a session that is still connecting.
+ * The caller must hold g_mutexObjectList.
+ */
+static ssize_t CAQueuePendingData(CATCPSessionInfo_t *svritem, const void *data, size_t dlen)
+{
+    CATCPPendingData_t *pending = (CATCPPendingData_t *)OICCalloc(1, sizeof(*pending));
+    void *copy = OICMalloc(dlen);
+    if (!pending || !copy)
+    {
+        OIC_LOG(ERROR, TAG, "Out of memory");
+        OICFree(pending);
+        OICFree(copy);
+        return -1;
+    }
+    memcpy(copy, data, dlen);
+    pending->data = copy;
+    pending->len = dlen;
+    LL_APPEND(svritem->pendingData, pending);
+
+    OIC_LOG_V(DEBUG, TAG, "%" PRIuPTR " bytes queued until [%s:%u] is connected",
+              dlen, svritem->sep.endpoint.addr, svritem->sep.endpoint.port);
+    return dlen;
+}
+
+/**
+ * Free a list of queued data, reporting each entry to the error handler if
+ * @p reportError is set.
+ */
+static void CAFreePendingData(const CAEndpoint_t *endpoint, CATCPPendingData_t *list,
+                              bool reportError)
+{
+    CATCPPendingData_t *pending = NULL;
+    CATCPPendingData_t *tmp = NULL;
+    LL_FOREACH_SAFE(list, pending, tmp)
+    {
+        LL_DELETE(list, pending);
+        if (reportError && g_tcpErrorHandler)
+        {
+            g_tcpErrorHandler(endpoint, pending->data, pending->len, CA_SEND_FAILED);
+        }
+        OICFree(pending->data);
+        OICFree(pending);
+    }
+}
+
+/**
+ * Drop the data queued on a session, reporting each entry to the error handler if
+ * @p reportError is set. The caller must hold g_mutexObjectList.
+ */
+static void CADropPendingData(CATCPSessionInfo_t *svritem, bool reportError)
+{
+    CATCPPendingData_t *list = svritem->pendingData;
+    svritem->pendingData = NULL;
+    CAFreePendingData(&svritem->sep.endpoint, list, reportError);
+}
+
+/**
+ * Send a list of queued data in order, freeing each entry once it is sent.
+ * Must be called without g_mutexObjectList, as the sends may block.
+ *
+ * @return the entries that could not be sent, or NULL if all were sent.
+ */
+static CATCPPendingData_t *CASendPendingData(CASocketFd_t fd, const CAEndpoint_t *endpoint,
+                                             CATCPPendingData_t *list)
+{
+    while (list)
+    {
+        CATCPPendingData_t *pending = list;
+        if (-1 == CASendAll(fd, endpoint, pending->data, pending->len))
+        {
+            return list;
+        }
+        CALogSendStateInfo(endpoint->adapter, endpoint->addr, endpoint->port,
+                           pending->len, true, NULL);
+        LL_DELETE(list, pending);
+        OICFree(pending->data);
+        OICFree(pending);
+    }
+    return NULL;
+}
+
+/**
+ * Give up on a session whose connection could not be established.
+ * The caller must hold g_mutexObjectList.
+ */
+static void CAFailConnect(CATCPSessionInfo_t *svritem, const char *reason)
+{
+    OIC_LOG_V(ERROR, TAG, "failed to connect socket, %s", reason);
+    CALogSendStateInfo(svritem->sep.endpoint.adapter, svritem->sep.endpoint.addr,
+                       svritem->sep.endpoint.port, 0, false, reason);
+
+    CADropPendingData(svritem, true);
+#ifdef __WITH_TLS__
+    if ((svritem->sep.endpoint.flags & CA_SECURE) &&
+        CA_STATUS_OK != CAcloseSslConnection(&svritem->sep.endpoint))
+    {
+        OIC_LOG(ERROR, TAG, "Failed to close TLS session");
+    }
+#endif
+    CARemoveSession(svritem);
+    CADisconnectTCPSession(svritem);
+}
+
+/**
+ * Hand a session whose connect() is in progress over to the receive thread.
+ * If this fails the receive thread never sees the session, and the caller still owns it.
+ */
+static CAResult_t CAWatchConnectingSession(CATCPSessionInfo_t *svritem)
+{
+    CAResult_t res = CA_STATUS_OK;
+
+    oc_mutex_lock(g_mutexObjectList);
+#if defined(CA_TCP_USE_EPOLL)
+    if (-1 == g_epollFd)
+    {
+        OIC_LOG(ERROR, TAG, "receive thread is not running");
+        res = CA_SOCKET_OPERATION_FAILED;
+    }
+    else if (!CAEpollAdd(svritem->fd, EPOLLIN | EPOLLOUT | EPOLLET))
     {
-        svritem->protocol = COAP;
-
-        // svritem->tlsdata can also be used as receiving buffer in case of raw tcp
-        len = recv(svritem->fd, (char*)svritem->tlsdata, sizeof(svritem->tlsdata), 0);
-        if (len < 0)
-        {
-            OIC_LOG_V(ERROR, TAG, "recv failed %s", strerror(errno));
-            res = CA_RECEIVE_FAILED;
-        }
-        else if (0 == len)
-        {
-            OIC_LOG(INFO, TAG, "Received disconnect from peer. Close connection");
-            res = CA_DESTINATION_DISCONNECTED;
-        }
-        else
-        {
-            OIC_LOG_V(DEBUG, TAG, "recv() : %d bytes", len);
-            //when successfully read data - pass them to callback.
-            if (g_packetReceivedCallback)
-            {
-                g_packetReceivedCallback(&svritem->sep, svritem->tlsdata, len);
-            }
-        }
+        res = CA_SOCKET_OPERATION_FAILED;
     }
-
+#else
+    ssize_t len = CAWakeUpForReadFdsUpdate(svritem->sep.endpoint.addr);
+    if (-1 == len)
+    {
+        OIC_LOG(ERROR, TAG, "wakeup receive thread failed");
+        res = CA_SOCKET_OPERATION_FAILED;
+    }
+#endif
+    if (CA_STATUS_OK == res)
+    {
+        svritem->connectDeadline = OICGetCurrentTime(TIME_IN_MS) +
+                                   (uint64_t)caglobals.tcp.connectTimeout * 1000;
+        g_connectingCount++;
+    }
+    oc_mutex_unlock(g_mutexObjectList);
     return res;
 }
 
-#if !defined(WSA_WAIT_EVENT_0)
-static ssize_t CAWakeUpForReadFdsUpdate(const char *host)
+/**
+ * Complete the connection of a session whose socket became writable: check the result of
+ * connect(), send the queued data and report the new connection.
+ * The caller must hold g_mutexObjectList. It is released while the queued data is sent,
+ * so the session may be gone on return; callers look it up again by its socket.
+ */
+static void CAFinishConnect(CATCPSessionInfo_t *svritem)
 {
-    if (caglobals.tcp.connectionFds[1] != -1)
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (0 != getsockopt(svritem->fd, SOL_SOCKET, SO_ERROR, &error, &len))
     {
-        ssize_t len = 0;
-        do
-        {
-            len = write(caglobals.tcp.connectionFds[1], host, strlen(host));
-        } while ((len == -1) && (errno == EINTR));
+        error = errno;
+    }
+    if (0 != error)
+    {
+        CAFailConnect(svritem, strerror(error));
+        return;
+    }
 
-        if ((len == -1) && (errno != EINTR) && (errno != EPIPE))
+#if defined(CA_TCP_USE_EPOLL)
+    struct epoll_event event = { .events = EPOLLIN | EPOLLET, .data.fd = svritem->fd };
+    if (-1 == epoll_ctl(g_epollFd, EPOLL_CTL_MOD, svritem->fd, &event))
+    {
+        CAFailConnect(svritem, strerror(errno));
+        return;
+    }
+#else
+    // The select loop reads only sockets that are ready, as blocking sockets.
+    if (!CASetNonBlocking(svritem->fd, false))
+    {
+        CAFailConnect(svritem, strerror(errno));
+        return;
+    }
+#endif
+
+    OIC_LOG(DEBUG, TAG, "connect socket success");
+
+    // The queue is sent without the lock, like sendData() does. The state is still
+    // CONNECTING, so senders keep queueing behind the flushed data.
+    CASocketFd_t fd = svritem->fd;
+    CAEndpoint_t endpoint = svritem->sep.endpoint;
+    while (svritem->pendingData)
+    {
+        CATCPPendingData_t *queue = svritem->pendingData;
+        svritem->pendingData = NULL;
+
+        oc_mutex_unlock(g_mutexObjectList);
+        CATCPPendingData_t *unsent = CASendPendingData(fd, &endpoint, queue);
+        oc_mutex_lock(g_mutexObjectList);
+
+        if (CAGetSessionFromFd(fd) != svritem)
         {
-            OIC_LOG_V(DEBUG, TAG, "write failed: %s", strerror(errno));
+            OIC_LOG(DEBUG, TAG, "session closed while its queued data was sent");
+            CAFreePendingData(&endpoint, unsent, true);
+            return;
+        }
+        if (unsent)
+        {
+            CAFreePendingData(&endpoint, unsent, true);
+            CAFailConnect(svritem, "sending queued data failed");
+            return;
         }
-        return len;
     }
-    return -1;
+
+    svritem->state = CONNECTED;
+    svritem->connectDeadline = 0;
+    g_connectingCount--;
+
+    // pass the connection information to CA Common Layer.
+    if (g_connectionCallback)
+    {
+        g_connectionCallback(&(svritem->sep.endpoint), true, svritem->isClient);
+    }
 }
-#else
-static void CAWakeUpForReadFdsUpdate()
+
+/**
+ * Fail the sessions whose connect() did not complete in time.
+ */
+static void CACheckConnectTimeouts()
 {
-    if (WSA_INVALID_EVENT != caglobals.tcp.updateEvent)
+    static uint64_t lastCheck = 0;
+
+    if (!g_connectingCount)
     {
-        if (!WSASetEvent(caglobals.tcp.updateEvent))
+        return;
+    }
+    uint64_t now = OICGetCurrentTime(TIME_IN_MS);
+    if (now - lastCheck < CA_TCP_CONNECT_CHECK_INTERVAL_MS)
+    {
+        return;
+    }
+    lastCheck = now;
+
+    oc_mutex_lock(g_mutexObjectList);
+    bool expired = true;
+    while (expired && g_connectingCount)
+    {
+        // Error callbacks may change the list, so look again after every failed session.
+        expired = false;
+        CATCPSessionInfo_t *session = NULL;
+        LL_FOREACH(g_sessionList, session)
         {
-            OIC_LOG_V(DEBUG, TAG, "CAWakeUpForReadFdsUpdate: set shutdown event failed: %u", GetLastError());
+            if (session->connectDeadline && now >= session->connectDeadline)
+            {
+                expired = true;
+                CAFailConnect(session, "connect timed out");
+                break;
+            }
         }
     }
+    oc_mutex_unlock(g_mutexObjectList);
 }
 #endif
 
@@ -885,7 +1646,7 @@ static CAResult_t CATCPCreateSocket(int family, CATCPSessionInfo_t *svritem)
         OIC_LOG_V(ERROR, TAG, "create socket failed: %s", strerror(errno));
         return CA_SOCKET_OPERATION_FAILED;
     }
-    svritem->fd = fd;
+    CASetSessionFd(svritem, fd);
 
     // #2. convert address from string to binary.
     struct sockaddr_storage sa = { .ss_family = (short)family };
@@ -908,8 +1669,13 @@ static CAResult_t CATCPCreateSocket(int family, CATCPSessionInfo_t *svritem)
         socklen = sizeof(struct sockaddr_in);
     }
 
-    // #4. connect to remote server device.
-    if (connect(fd, (struct sockaddr *)&sa, socklen) < 0)
+#ifdef CA_TCP_ASYNC_CONNECT
+    // #4. start connecting to remote server device; the receive thread completes it.
+    if (!CASetNonBlocking(fd, true))
+    {
+        return CA_SOCKET_OPERATION_FAILED;
+    }
+    if (connect(fd, (struct sockaddr *)&sa, socklen) < 0 && EINPROGRESS != errno)
     {
         OIC_LOG_V(ERROR, TAG, "failed to connect socket, %s", strerror(errno));
         CALogSendStateInfo(svritem->sep.endpoint.adapter, svritem->sep.endpoint.addr,
@@ -917,20 +1683,24 @@ static CAResult_t CATCPCreateSocket(int family, CATCPSessionInfo_t *svritem)
         return CA_SOCKET_OPERATION_FAILED;
     }
 
-    OIC_LOG(DEBUG, TAG, "connect socket success");
-    svritem->state = CONNECTED;
+    OIC_LOG(DEBUG, TAG, "connect socket in progress");
     CHECKFD(svritem->fd);
-#if !defined(WSA_WAIT_EVENT_0)
-    ssize_t len = CAWakeUpForReadFdsUpdate(svritem->sep.endpoint.addr);
-    if (-1 == len)
+    return CA_STATUS_OK;
+#else
+    // #4. connect to remote server device.
+    if (connect(fd, (struct sockaddr *)&sa, socklen) < 0)
     {
-        OIC_LOG(ERROR, TAG, "wakeup receive thread failed");
+        OIC_LOG_V(ERROR, TAG, "failed to connect socket, %s", strerror(errno));
+        CALogSendStateInfo(svritem->sep.endpoint.adapter, svritem->sep.endpoint.addr,
+                           svritem->sep.endpoint.port, 0, false, strerror(errno));
         return CA_SOCKET_OPERATION_FAILED;
     }
-#else
+
+    OIC_LOG(DEBUG, TAG, "connect socket success");
+    svritem->state = CONNECTED;
     CAWakeUpForReadFdsUpdate();
-#endif
     return CA_STATUS_OK;
+#endif
 }
 
 static CASocketFd_t CACreateAcceptSocket(int family, CASocket_t *sock)
@@ -1122,6 +1892,16 @@ CAResult_t CATCPStartServer(const ca_thread_pool_t threadPool)
     CHECKFD(caglobals.tcp.connectionFds[1]);
 #endif
 
+#ifdef CA_TCP_USE_EPOLL
+    res = CAInitializeEpoll();
+    if (CA_STATUS_OK != res)
+    {
+        OIC_LOG(ERROR, TAG, "failed to create epoll set");
+        CATerminateEpoll();
+        return res;
+    }
+#endif
+
     caglobals.tcp.terminate = false;
     res = ca_thread_pool_add_task(threadPool, CAReceiveHandler, NULL);
     if (CA_STATUS_OK != res)
@@ -1190,6 +1970,9 @@ void CATCPStopServer()
     close(caglobals.tcp.shutdownFds[0]);
     caglobals.tcp.shutdownFds[0] = OC_INVALID_SOCKET;
 #endif
+#ifdef CA_TCP_USE_EPOLL
+    CATerminateEpoll();
+#endif
 
     // mutex unlock
     oc_mutex_unlock(g_mutexObjectList);
@@ -1268,26 +2051,24 @@ static ssize_t sendData(const CAEndpoint_t *endpoint, const void *data,
         }
     }
 
-    // #2. send data to remote device.
-    ssize_t remainLen = dlen;
-    do
+#ifdef CA_TCP_ASYNC_CONNECT
+    // #2. keep the data until the connection is established.
+    oc_mutex_lock(g_mutexObjectList);
+    CATCPSessionInfo_t *session = CAGetSessionFromFd(sockFd);
+    if (session && CONNECTING == session->state)
     {
-        int dataToSend = (remainLen > INT_MAX) ? INT_MAX : (int)remainLen;
-        ssize_t len = send(sockFd, data, dataToSend, 0);
-        if (-1 == len)
-        {
-            if (EWOULDBLOCK != errno)
-            {
-                OIC_LOG_V(ERROR, TAG, "unicast ipv4tcp sendTo failed: %s", strerror(errno));
-                CALogSendStateInfo(endpoint->adapter, endpoint->addr, endpoint->port,
-                                   len, false, strerror(errno));
-                return len;
-            }
-            continue;
-        }
-        data = ((char*)data) + len;
-        remainLen -= len;
-    } while (remainLen > 0);
+        ssize_t queued = CAQueuePendingData(session, data, dlen);
+        oc_mutex_unlock(g_mutexObjectList);
+        return queued;
+    }
+    oc_mutex_unlock(g_mutexObjectList);
+#endif
+
+    // #3. send data to remote device.
+    if (-1 == CASendAll(sockFd, endpoint, data, dlen))
+    {
+        return -1;
+    }
 
 #ifndef TB_LOG
     (void)fam;
@@ -1441,21 +2222,40 @@ CASocketFd_t CAConnectTCPSession(const CAEndpoint_t *endpoint)
         return OC_INVALID_SOCKET;
     }
     svritem->sep.endpoint = *endpoint;
+    svritem->fd = OC_INVALID_SOCKET;
     svritem->state = CONNECTING;
     svritem->isClient = true;
 
     // #2. add TCP connection info to list
-    oc_mutex_lock(g_mutexObjectList);
-    LL_APPEND(g_sessionList, svritem);
-    oc_mutex_unlock(g_mutexObjectList);
+    if (CA_STATUS_OK != CAAddSession(svritem))
+    {
+        OICFree(svritem);
+        return OC_INVALID_SOCKET;
+    }
 
     // #3. create the socket and connect to TCP server
     int family = (svritem->sep.endpoint.flags & CA_IPV6) ? AF_INET6 : AF_INET;
-    if (CA_STATUS_OK != CATCPCreateSocket(family, svritem))
+    CAResult_t res = CATCPCreateSocket(family, svritem);
+#ifdef CA_TCP_ASYNC_CONNECT
+    // #4. the receive thread completes the connection; svritem is its own from here on.
+    CASocketFd_t fd = svritem->fd;
+    if (CA_STATUS_OK == res)
+    {
+        res = CAWatchConnectingSession(svritem);
+    }
+#endif
+    if (CA_STATUS_OK != res)
     {
+        oc_mutex_lock(g_mutexObjectList);
+        CARemoveSession(svritem);
+        CADisconnectTCPSession(svritem);
+        oc_mutex_unlock(g_mutexObjectList);
         return OC_INVALID_SOCKET;
     }
 
+#ifdef CA_TCP_ASYNC_CONNECT
+    return fd;
+#else
     // #4. pass the connection information to CA Common Layer.
     if (g_connectionCallback)
     {
@@ -1463,6 +2263,7 @@ CASocketFd_t CAConnectTCPSession(const CAEndpoint_t *endpoint)
     }
 
     return svritem->fd;
+#endif
 }
 
 CAResult_t CADisconnectTCPSession(CATCPSessionInfo_t *removedData)
@@ -1489,6 +2290,9 @@ CAResult_t CADisconnectTCPSession(CATCPSessionInfo_t *removedData)
     }
     OICFree(removedData->data);
     removedData->data = NULL;
+#ifdef CA_TCP_ASYNC_CONNECT
+    CADropPendingData(removedData, false);
+#endif
 
     OICFree(removedData);
 
@@ -1505,13 +2309,14 @@ void CATCPDisconnectAll()
     {
         if (session)
         {
-            LL_DELETE(g_sessionList, session);
+            CARemoveSession(session);
             // disconnect session from remote device.
             CADisconnectTCPSession(session);
         }
     }
 
     g_sessionList = NULL;
+    CAClearSessionIndexes();
     oc_mutex_unlock(g_mutexObjectList);
 
 #ifdef __WITH_TLS__
@@ -1527,17 +2332,11 @@ CATCPSessionInfo_t *CAGetTCPSessionInfoFromEndpoint(const CAEndpoint_t *endpoint
     OIC_LOG_V(DEBUG, TAG, "Looking for [%s:%d]", endpoint->addr, endpoint->port);
 
     // get connection info from list
-    CATCPSessionInfo_t *session = NULL;
-    LL_FOREACH(g_sessionList, session)
+    CATCPSessionInfo_t *session = CAGetSessionFromEndpoint(endpoint);
+    if (session)
     {
-        if (!strncmp(session->sep.endpoint.addr, endpoint->addr,
-                     sizeof(session->sep.endpoint.addr))
-                && (session->sep.endpoint.port == endpoint->port)
-                && (session->sep.endpoint.flags & endpoint->flags))
-        {
-            OIC_LOG(DEBUG, TAG, "Found in session list");
-            return session;
-        }
+        OIC_LOG(DEBUG, TAG, "Found in session list");
+        return session;
     }
 
     OIC_LOG(DEBUG, TAG, "Session not found");
@@ -1552,18 +2351,13 @@ CASocketFd_t CAGetSocketFDFromEndpoint(const CAEndpoint_t *endpoint)
 
     // get connection info from list.
     oc_mutex_lock(g_mutexObjectList);
-    CATCPSessionInfo_t *session = NULL;
-    LL_FOREACH(g_sessionList, session)
+    CATCPSessionInfo_t *session = CAGetSessionFromEndpoint(endpoint);
+    if (session)
     {
-        if (!strncmp(session->sep.endpoint.addr, endpoint->addr,
-                     sizeof(session->sep.endpoint.addr))
-                && (session->sep.endpoint.port == endpoint->port)
-                && (session->sep.endpoint.flags & endpoint->flags))
-        {
-            oc_mutex_unlock(g_mutexObjectList);
-            OIC_LOG(DEBUG, TAG, "Found in session list");
-            return session->fd;
-        }
+        CASocketFd_t fd = session->fd;
+        oc_mutex_unlock(g_mutexObjectList);
+        OIC_LOG(DEBUG, TAG, "Found in session list");
+        return fd;
     }
 
     oc_mutex_unlock(g_mutexObjectList);
@@ -1571,6 +2365,69 @@ CASocketFd_t CAGetSocketFDFromEndpoint(const CAEndpoint_t *endpoint)
     return OC_INVALID_SOCKET;
 }
 
+bool CAGetTCPPeerCapabilities(const CAEndpoint_t *endpoint, uint32_t *maxMessageSize,
+                              bool *blockWiseTransfer)
+{
+    VERIFY_NON_NULL_RET(endpoint, TAG, "endpoint is NULL", false);
+    VERIFY_NON_NULL_RET(maxMessageSize, TAG, "maxMessageSize is NULL", false);
+    VERIFY_NON_NULL_RET(blockWiseTransfer, TAG, "blockWiseTransfer is NULL", false);
+
+    bool received = false;
+    oc_mutex_lock(g_mutexObjectList);
+    CATCPSessionInfo_t *session = CAGetSessionFromEndpoint(endpoint);
+    if (session && session->peerCSMReceived)
+    {
+        *maxMessageSize = session->peerMaxMessageSize;
+        *blockWiseTransfer = session->peerBlockWiseTransfer;
+        received = true;
+    }
+    oc_mutex_unlock(g_mutexObjectList);
+    return received;
+}
+
+bool CASetTCPPeerCapabilities(const CAEndpoint_t *endpoint, uint32_t maxMessageSize,
+                              bool blockWiseTransfer)
+{
+    VERIFY_NON_NULL_RET(endpoint, TAG, "endpoint is NULL", false);
+
+    bool csmSent = false;
+    oc_mutex_lock(g_mutexObjectList);
+    CATCPSessionInfo_t *session = CAGetSessionFromEndpoint(endpoint);
+    if (session)
+    {
+        session->peerMaxMessageSize = maxMessageSize;
+        session->peerBlockWiseTransfer = blockWiseTransfer;
+        session->peerCSMReceived = true;
+        csmSent = session->csmSent;
+    }
+    oc_mutex_unlock(g_mutexObjectList);
+    return csmSent;
+}
+
+bool CAIsTCPSessionCSMSent(const CAEndpoint_t *endpoint)
+{
+    VERIFY_NON_NULL_RET(endpoint, TAG, "endpoint is NULL", false);
+
+    oc_mutex_lock(g_mutexObjectList);
+    CATCPSessionInfo_t *session = CAGetSessionFromEndpoint(endpoint);
+    bool csmSent = session && session->csmSent;
+    oc_mutex_unlock(g_mutexObjectList);
+    return csmSent;
+}
+
+void CASetTCPSessionCSMSent(const CAEndpoint_t *endpoint)
+{
+    VERIFY_NON_NULL_VOID(endpoint, TAG, "endpoint is NULL");
+
+    oc_mutex_lock(g_mutexObjectList);
+    CATCPSessionInfo_t *session = CAGetSessionFromEndpoint(endpoint);
+    if (session)
+    {
+        session->csmSent = true;
+    }
+    oc_mutex_unlock(g_mutexObjectList);
+}
+
 CAResult_t CASearchAndDeleteTCPSession(const CAEndpoint_t *endpoint)
 {
     VERIFY_NON_NULL(endpoint, TAG, "endpoint is NULL");
@@ -1578,23 +2435,15 @@ CAResult_t CASearchAndDeleteTCPSession(const CAEndpoint_t *endpoint)
     OIC_LOG_V(DEBUG, TAG, "Looking for [%s:%d]", endpoint->addr, endpoint->port);
 
     // get connection info from list
-    CATCPSessionInfo_t *session = NULL;
-    CATCPSessionInfo_t *tmp = NULL;
-
     oc_mutex_lock(g_mutexObjectList);
-    LL_FOREACH_SAFE(g_sessionList, session, tmp)
+    CATCPSessionInfo_t *session = CAGetSessionFromEndpoint(endpoint);
+    if (session)
     {
-        if (!strncmp(session->sep.endpoint.addr, endpoint->addr,
-                     sizeof(session->sep.endpoint.addr))
-                && (session->sep.endpoint.port == endpoint->port)
-                && (session->sep.endpoint.flags & endpoint->flags))
-        {
-            OIC_LOG(DEBUG, TAG, "Found in session list");
-            LL_DELETE(g_sessionList, session);
-            CADisconnectTCPSession(session);
-            oc_mutex_unlock(g_mutexObjectList);
-            return CA_STATUS_OK;
-        }
+        OIC_LOG(DEBUG, TAG, "Found in session list");
+        CARemoveSession(session);
+        CADisconnectTCPSession(session);
+        oc_mutex_unlock(g_mutexObjectList);
+        return CA_STATUS_OK;
     }
     oc_mutex_unlock(g_mutexObjectList);
 
@@ -711,6 +711,15 @@ TEST(CAGetPortNumberTest, CAGetPortNumberToAssign)
 #endif
 }
 
+#ifdef TCP_ADAPTER
+TEST(CASetTCPConnectTimeoutTest, CASetTCPConnectTimeout)
+{
+    EXPECT_EQ(CA_STATUS_OK, CASetTCPConnectTimeout(5));
+    EXPECT_EQ(CA_STATUS_INVALID_PARAM, CASetTCPConnectTimeout(0));
+    EXPECT_EQ(CA_STATUS_INVALID_PARAM, CASetTCPConnectTimeout(-1));
+}
+#endif
+
 TEST(CAfragmentationTest, FragmentTest)
 {
 #if defined(LE_ADAPTER)
@@ -24,12 +24,16 @@
 #endif
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
 #include "cainterface.h"
 #include "cautilinterface.h"
 #include "cacommon.h"
 #include "cablockwisetransfer.h"
+#include "caremotehandler.h"
 
 #define LARGE_PAYLOAD_LENGTH    1024
+#define BLOCK_SIZE(arg) (1 << ((arg) + 4))
 
 class CABlockTransferTests : public testing::Test {
     protected:
@@ -40,6 +44,7 @@ class CABlockTransferTests : public testing::Test {
 
     virtual void TearDown()
     {
+        CASetQBlockTransfer(false);
         CATerminate();
     }
 };
@@ -764,3 +769,740 @@ TEST_F(CABlockTransferTests, CAUpdatePayloadToCADataWithResponse)
     CADestroyToken(tempToken);
     CADestroyEndpoint(tempRep);
 }
+
+TEST_F(CABlockTransferTests, CAGetBlockDataFromBlockDataListWithManyTransfers)
+{
+    const size_t transferCount = 200;
+
+    CAEndpoint_t* tempRep = NULL;
+    CACreateEndpoint(CA_DEFAULT_FLAGS, CA_ADAPTER_IP, "127.0.0.1", 5683, &tempRep);
+
+    CARequestInfo_t requestInfo;
+    memset(&requestInfo, 0, sizeof(CARequestInfo_t));
+    requestInfo.method = CA_GET;
+    requestInfo.info.type = CA_MSG_NONCONFIRM;
+
+    CAData_t cadata;
+    memset(&cadata, 0, sizeof(CAData_t));
+    cadata.type = SEND_TYPE_UNICAST;
+    cadata.remoteEndpoint = tempRep;
+    cadata.requestInfo = &requestInfo;
+    cadata.dataType = CA_REQUEST_DATA;
+
+    std::vector<CABlockData_t *> blockData;
+    for (size_t i = 0; i < transferCount; i++)
+    {
+        char token[sizeof(size_t)];
+        memcpy(token, &i, sizeof(token));
+        requestInfo.info.token = token;
+        requestInfo.info.tokenLength = sizeof(token);
+
+        CABlockData_t *currData = CACreateNewBlockData(&cadata);
+        ASSERT_TRUE(currData != NULL);
+        blockData.push_back(currData);
+    }
+
+    for (size_t i = 0; i < transferCount; i++)
+    {
+        EXPECT_EQ(blockData[i], CAGetBlockDataFromBlockDataList(blockData[i]->blockDataId));
+    }
+
+    // remove every other transfer, the rest has to be found still
+    for (size_t i = 0; i < transferCount; i += 2)
+    {
+        EXPECT_EQ(CA_STATUS_OK, CARemoveBlockDataFromList(blockData[i]->blockDataId));
+    }
+    for (size_t i = 1; i < transferCount; i += 2)
+    {
+        EXPECT_EQ(blockData[i], CAGetBlockDataFromBlockDataList(blockData[i]->blockDataId));
+        EXPECT_EQ(CA_STATUS_OK, CARemoveBlockDataFromList(blockData[i]->blockDataId));
+    }
+
+    CADestroyEndpoint(tempRep);
+}
+
+static std::vector<size_t> g_blockOffsets;
+static std::vector<uint8_t> g_blockPayload;
+static bool g_takeBlockData = false;
+
+static bool blockDataHandler(const CAEndpoint_t *, const CARequestInfo_t *requestInfo,
+                             const CAResponseInfo_t *responseInfo, size_t offset,
+                             const uint8_t *data, size_t length, size_t)
+{
+    EXPECT_TRUE(requestInfo != NULL);
+    EXPECT_TRUE(responseInfo == NULL);
+    g_blockOffsets.push_back(offset);
+    g_blockPayload.insert(g_blockPayload.end(), data, data + length);
+    return g_takeBlockData;
+}
+
+static void receiveBlocks(bool take, CABlockData_t **received)
+{
+    const size_t blockCount = 3;
+    size_t blockSize = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+
+    g_blockOffsets.clear();
+    g_blockPayload.clear();
+    g_takeBlockData = take;
+    ASSERT_EQ(CA_STATUS_OK, CARegisterBlockDataHandler(blockDataHandler));
+
+    CAEndpoint_t* tempRep = NULL;
+    CACreateEndpoint(CA_DEFAULT_FLAGS, CA_ADAPTER_IP, "127.0.0.1", 5683, &tempRep);
+
+    CAToken_t tempToken = NULL;
+    CAGenerateToken(&tempToken, CA_MAX_TOKEN_LEN);
+
+    std::vector<uint8_t> block(blockSize);
+
+    CARequestInfo_t requestInfo;
+    memset(&requestInfo, 0, sizeof(CARequestInfo_t));
+    requestInfo.method = CA_PUT;
+    requestInfo.info.type = CA_MSG_NONCONFIRM;
+    requestInfo.info.token = tempToken;
+    requestInfo.info.tokenLength = CA_MAX_TOKEN_LEN;
+    requestInfo.info.payload = block.data();
+    requestInfo.info.payloadSize = block.size();
+
+    CAData_t cadata;
+    memset(&cadata, 0, sizeof(CAData_t));
+    cadata.type = SEND_TYPE_UNICAST;
+    cadata.remoteEndpoint = tempRep;
+    cadata.requestInfo = &requestInfo;
+    cadata.dataType = CA_REQUEST_DATA;
+
+    CABlockData_t *currData = CACreateNewBlockData(&cadata);
+    ASSERT_TRUE(currData != NULL);
+
+    for (size_t i = 0; i < blockCount; i++)
+    {
+        memset(block.data(), (int)('a' + i), block.size());
+        EXPECT_EQ(CA_STATUS_OK, CAUpdatePayloadData(currData, &cadata, CA_BLOCK_UNKNOWN,
+                                                    false, COAP_OPTION_BLOCK1));
+    }
+    EXPECT_EQ(blockCount * blockSize, currData->receivedPayloadLen);
+    *received = currData;
+
+    CARegisterBlockDataHandler(NULL);
+    CADestroyToken(tempToken);
+    CADestroyEndpoint(tempRep);
+}
+
+TEST_F(CABlockTransferTests, CAUpdatePayloadDataStreamed)
+{
+    CABlockData_t *currData = NULL;
+    receiveBlocks(true, &currData);
+    ASSERT_TRUE(currData != NULL);
+
+    size_t blockSize = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+    ASSERT_EQ(3u, g_blockOffsets.size());
+    for (size_t i = 0; i < g_blockOffsets.size(); i++)
+    {
+        EXPECT_EQ(i * blockSize, g_blockOffsets[i]);
+        EXPECT_EQ('a' + i, g_blockPayload[i * blockSize]);
+    }
+
+    // streamed blocks are not reassembled
+    EXPECT_TRUE(currData->payload == NULL);
+
+    EXPECT_EQ(CA_STATUS_OK, CARemoveBlockDataFromList(currData->blockDataId));
+}
+
+TEST_F(CABlockTransferTests, CAUpdatePayloadDataReassembled)
+{
+    CABlockData_t *currData = NULL;
+    receiveBlocks(false, &currData);
+    ASSERT_TRUE(currData != NULL);
+
+    // the handler only sees the first block when it declines the transfer
+    size_t blockSize = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+    ASSERT_EQ(1u, g_blockOffsets.size());
+    EXPECT_EQ(0u, g_blockOffsets[0]);
+
+    ASSERT_TRUE(currData->payload != NULL);
+    EXPECT_LE(currData->receivedPayloadLen, currData->payloadCapacity);
+    for (size_t i = 0; i < 3; i++)
+    {
+        EXPECT_EQ('a' + i, currData->payload[i * blockSize]);
+        EXPECT_EQ('a' + i, currData->payload[(i + 1) * blockSize - 1]);
+    }
+
+    EXPECT_EQ(CA_STATUS_OK, CARemoveBlockDataFromList(currData->blockDataId));
+}
+
+static std::vector<size_t> g_producedOffsets;
+
+static bool producePayload(void *context, size_t offset, uint8_t *buffer, size_t length)
+{
+    EXPECT_EQ(&g_producedOffsets, context);
+    g_producedOffsets.push_back(offset);
+    for (size_t i = 0; i < length; i++)
+    {
+        buffer[i] = (uint8_t)((offset + i) % 251);
+    }
+    return true;
+}
+
+TEST_F(CABlockTransferTests, CAAddBlockOption1WithPayloadProducer)
+{
+    g_producedOffsets.clear();
+
+    CAEndpoint_t* tempRep = NULL;
+    CACreateEndpoint(CA_DEFAULT_FLAGS, CA_ADAPTER_IP, "127.0.0.1", 5683, &tempRep);
+
+    coap_pdu_t *pdu = NULL;
+    coap_list_t *options = NULL;
+    coap_transport_t transport = COAP_UDP;
+
+    CAToken_t tempToken = NULL;
+    CAGenerateToken(&tempToken, CA_MAX_TOKEN_LEN);
+
+    CAInfo_t requestData;
+    memset(&requestData, 0, sizeof(CAInfo_t));
+    requestData.token = tempToken;
+    requestData.tokenLength = CA_MAX_TOKEN_LEN;
+    requestData.type = CA_MSG_NONCONFIRM;
+    requestData.payloadProducer = producePayload;
+    requestData.payloadProducerContext = &g_producedOffsets;
+    requestData.payloadSize = 3 * LARGE_PAYLOAD_LENGTH;
+
+    pdu = CAGeneratePDU(CA_PUT, &requestData, tempRep, &options, &transport);
+    ASSERT_TRUE(pdu != NULL);
+
+    CAData_t *cadata = CACreateNewDataSet(pdu, tempRep);
+    EXPECT_TRUE(cadata != NULL);
+
+    CABlockData_t *currData = CACreateNewBlockData(cadata);
+    EXPECT_TRUE(currData != NULL);
+
+    if (currData)
+    {
+        EXPECT_EQ(CA_STATUS_OK, CAUpdateBlockOptionType(currData->blockDataId,
+                                                        COAP_OPTION_BLOCK1));
+
+        coap_block_t *block1 = CAGetBlockOption(currData->blockDataId, COAP_OPTION_BLOCK1);
+        ASSERT_TRUE(block1 != NULL);
+        block1->num = 1;
+
+        EXPECT_EQ(CA_STATUS_OK, CAAddBlockOption1(&pdu, &requestData,
+                                                  requestData.payloadSize,
+                                                  currData->blockDataId, &options));
+
+        // only the second block is produced
+        size_t blockSize = BLOCK_SIZE(block1->szx);
+        ASSERT_EQ(1u, g_producedOffsets.size());
+        EXPECT_EQ(blockSize, g_producedOffsets[0]);
+
+        size_t length = 0;
+        unsigned char *data = NULL;
+        EXPECT_EQ(1, coap_get_data(pdu, &length, &data));
+        EXPECT_EQ(blockSize, length);
+        EXPECT_EQ(blockSize % 251, data[0]);
+
+        CARemoveBlockDataFromList(currData->blockDataId);
+    }
+
+    CADestroyDataSet(cadata);
+    coap_delete_list(options);
+    coap_delete_pdu(pdu);
+
+    CADestroyToken(tempToken);
+    CADestroyEndpoint(tempRep);
+}
+
+static int g_releaseCount = 0;
+
+static void releasePayload(void *context)
+{
+    EXPECT_EQ(&g_producedOffsets, context);
+    g_releaseCount++;
+}
+
+TEST_F(CABlockTransferTests, CAPayloadProducerReleasedOnceByClones)
+{
+    g_releaseCount = 0;
+
+    CAResponseInfo_t responseInfo;
+    memset(&responseInfo, 0, sizeof(CAResponseInfo_t));
+    responseInfo.result = CA_CONTENT;
+    responseInfo.info.type = CA_MSG_NONCONFIRM;
+    responseInfo.info.payloadProducer = producePayload;
+    responseInfo.info.payloadProducerContext = &g_producedOffsets;
+    responseInfo.info.payloadRelease = releasePayload;
+    responseInfo.info.payloadSize = 3 * LARGE_PAYLOAD_LENGTH;
+
+    CAResponseInfo_t shared = responseInfo;
+    ASSERT_EQ(CA_STATUS_OK, CAAdoptPayloadProducer(&responseInfo.info, &shared.info));
+
+    // the clones queued for sending share the producer
+    CAResponseInfo_t *clone = CACloneResponseInfo(&shared);
+    ASSERT_TRUE(clone != NULL);
+    CADropPayloadProducer(&shared.info);
+    EXPECT_EQ(0, g_releaseCount);
+
+    uint8_t buffer[16];
+    g_producedOffsets.clear();
+    EXPECT_TRUE(clone->info.payloadProducer(clone->info.payloadProducerContext, 16,
+                                            buffer, sizeof(buffer)));
+    ASSERT_EQ(1u, g_producedOffsets.size());
+    EXPECT_EQ(16u, g_producedOffsets[0]);
+
+    CADestroyResponseInfoInternal(clone);
+    EXPECT_EQ(1, g_releaseCount);
+}
+
+static coap_pdu_t *generateQBlock1(const CAInfo_t *info, const CAEndpoint_t *endpoint,
+                                   uint32_t num, bool more, size_t bodyLength,
+                                   const uint8_t *data, size_t length)
+{
+    coap_list_t *options = NULL;
+    coap_transport_t transport = COAP_UDP;
+    coap_pdu_t *pdu = CAGeneratePDU(CA_POST, info, endpoint, &options, &transport);
+    coap_delete_list(options);
+    if (!pdu)
+    {
+        return NULL;
+    }
+
+    unsigned char buf[4] = { 0 };
+    unsigned int value = (num << 4) | ((more ? 1 : 0) << 3) | CA_DEFAULT_BLOCK_SIZE;
+    coap_add_option(pdu, CA_OPTION_Q_BLOCK1, coap_encode_var_bytes(buf, value), buf);
+    coap_add_option(pdu, COAP_OPTION_SIZE1,
+                    coap_encode_var_bytes(buf, (unsigned int)bodyLength), buf);
+    coap_add_data(pdu, (unsigned int)length, data);
+    return pdu;
+}
+
+TEST_F(CABlockTransferTests, CAReceiveQBlock1OutOfOrder)
+{
+    ASSERT_EQ(CA_STATUS_OK, CASetQBlockTransfer(true));
+
+    size_t blockSize = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+    std::vector<uint8_t> body(2 * blockSize + blockSize / 2);
+    for (size_t i = 0; i < body.size(); i++)
+    {
+        body[i] = (uint8_t)(i % 251);
+    }
+
+    CAEndpoint_t* tempRep = NULL;
+    CACreateEndpoint(CA_DEFAULT_FLAGS, CA_ADAPTER_IP, "127.0.0.1", 5683, &tempRep);
+
+    CAToken_t tempToken = NULL;
+    CAGenerateToken(&tempToken, CA_MAX_TOKEN_LEN);
+
+    CAInfo_t requestData;
+    memset(&requestData, 0, sizeof(CAInfo_t));
+    requestData.token = tempToken;
+    requestData.tokenLength = CA_MAX_TOKEN_LEN;
+    requestData.type = CA_MSG_NONCONFIRM;
+
+    CABlockDataID_t *blockDataID = CACreateBlockDatablockId(tempToken, CA_MAX_TOKEN_LEN,
+                                                            tempRep->addr, tempRep->port);
+    ASSERT_TRUE(blockDataID != NULL);
+
+    // the blocks of one set arrive in any order
+    const uint32_t order[] = { 2, 0, 1 };
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++)
+    {
+        uint32_t num = order[i];
+        size_t offset = num * blockSize;
+        size_t length = std::min(blockSize, body.size() - offset);
+        bool more = offset + length < body.size();
+
+        coap_pdu_t *pdu = generateQBlock1(&requestData, tempRep, num, more, body.size(),
+                                          &body[offset], length);
+        ASSERT_TRUE(pdu != NULL);
+
+        CARequestInfo_t requestInfo;
+        memset(&requestInfo, 0, sizeof(CARequestInfo_t));
+        requestInfo.method = CA_POST;
+        requestInfo.info = requestData;
+        requestInfo.info.payload = &body[offset];
+        requestInfo.info.payloadSize = length;
+
+        CAData_t cadata;
+        memset(&cadata, 0, sizeof(CAData_t));
+        cadata.type = SEND_TYPE_UNICAST;
+        cadata.remoteEndpoint = tempRep;
+        cadata.requestInfo = &requestInfo;
+        cadata.dataType = CA_REQUEST_DATA;
+
+        EXPECT_EQ(CA_STATUS_OK, CAReceiveBlockWiseData(pdu, tempRep, &cadata, length));
+        coap_delete_pdu(pdu);
+
+        CABlockData_t *currData = CAGetBlockDataFromBlockDataList(blockDataID);
+        ASSERT_TRUE(currData != NULL);
+        EXPECT_EQ(CA_OPTION_Q_BLOCK1, currData->type);
+        EXPECT_EQ(3u, currData->blockCount);
+
+        if (1 == i)
+        {
+            // the last block and the first one are in place, the middle one is missing
+            EXPECT_EQ(blockSize + blockSize / 2, currData->receivedPayloadLen);
+            EXPECT_FALSE(currData->delivered);
+            ASSERT_TRUE(currData->payload != NULL);
+            EXPECT_EQ(0, memcmp(currData->payload, body.data(), blockSize));
+            EXPECT_EQ(0, memcmp(currData->payload + 2 * blockSize, &body[2 * blockSize],
+                                blockSize / 2));
+        }
+    }
+
+    // the whole request went up once the middle block has filled the gap
+    CABlockData_t *currData = CAGetBlockDataFromBlockDataList(blockDataID);
+    ASSERT_TRUE(currData != NULL);
+    EXPECT_TRUE(currData->delivered);
+    EXPECT_EQ(body.size(), currData->receivedPayloadLen);
+
+    CARemoveBlockDataFromList(blockDataID);
+    CADestroyBlockID(blockDataID);
+    CADestroyToken(tempToken);
+    CADestroyEndpoint(tempRep);
+}
+
+TEST_F(CABlockTransferTests, CAMissingQBlocksRoundTrip)
+{
+    const uint32_t nums[] = { 0, 23, 24, 255, 256, 65535, 65536, UINT32_MAX };
+    const size_t count = sizeof(nums) / sizeof(nums[0]);
+
+    uint8_t buf[count * 5];
+    size_t length = CAEncodeMissingQBlocks(nums, count, buf);
+    EXPECT_EQ(22u, length);
+
+    uint32_t decoded[count];
+    ASSERT_EQ(count, CADecodeMissingQBlocks(buf, length, decoded, count));
+    for (size_t i = 0; i < count; i++)
+    {
+        EXPECT_EQ(nums[i], decoded[i]);
+    }
+
+    // no more numbers than asked for
+    EXPECT_EQ(3u, CADecodeMissingQBlocks(buf, length, decoded, 3));
+
+    // decoding stops at a number cut short and at anything but an unsigned integer
+    EXPECT_EQ(count - 1, CADecodeMissingQBlocks(buf, length - 1, decoded, count));
+    const uint8_t text[] = { 5, 0x61, 0x30, 7 };
+    ASSERT_EQ(1u, CADecodeMissingQBlocks(text, sizeof(text), decoded, count));
+    EXPECT_EQ(5u, decoded[0]);
+}
+
+static std::vector<CAData_t *> g_sentData;
+
+static void captureSentData(CAData_t *data)
+{
+    g_sentData.push_back(data);
+}
+
+static void destroyReceivedData(CAData_t *data)
+{
+    CADestroyDataSet(data);
+}
+
+class CAQBlockTransferTests : public CABlockTransferTests {
+    protected:
+    virtual void SetUp()
+    {
+        CABlockTransferTests::SetUp();
+
+        // keep the messages queued for sending, so that their blocks can be looked at
+        CATerminateBlockWiseTransfer();
+        CAInitializeBlockWiseTransfer(captureSentData, destroyReceivedData);
+        CASetQBlockTransfer(true);
+
+        CACreateEndpoint(CA_DEFAULT_FLAGS, CA_ADAPTER_IP, "127.0.0.1", 5683, &m_endpoint);
+        CAGenerateToken(&m_token, CA_MAX_TOKEN_LEN);
+        m_blockID = CACreateBlockDatablockId(m_token, CA_MAX_TOKEN_LEN,
+                                             m_endpoint->addr, m_endpoint->port);
+    }
+
+    virtual void TearDown()
+    {
+        clearSentData();
+        CARemoveBlockDataFromList(m_blockID);
+        CADestroyBlockID(m_blockID);
+        CADestroyToken(m_token);
+        CADestroyEndpoint(m_endpoint);
+        CABlockTransferTests::TearDown();
+    }
+
+    static void clearSentData()
+    {
+        for (size_t i = 0; i < g_sentData.size(); i++)
+        {
+            CADestroyDataSet(g_sentData[i]);
+        }
+        g_sentData.clear();
+    }
+
+    // Generate the PDUs of the queued messages in order, like the send thread does, and
+    // return the block number each of them carries.
+    static std::vector<uint32_t> sentBlocks(uint16_t blockType, uint32_t blockCount)
+    {
+        std::vector<uint32_t> nums;
+        for (size_t i = 0; i < g_sentData.size(); i++)
+        {
+            CAData_t *data = g_sentData[i];
+            CAInfo_t *info = data->requestInfo ? &data->requestInfo->info
+                                               : &data->responseInfo->info;
+            uint32_t code = data->requestInfo ? (uint32_t) data->requestInfo->method
+                                              : (uint32_t) data->responseInfo->result;
+            bool last = (i + 1 == g_sentData.size());
+            EXPECT_EQ(last ? CA_MSG_CONFIRM : CA_MSG_NONCONFIRM, info->type);
+
+            coap_list_t *options = NULL;
+            coap_transport_t transport = COAP_UDP;
+            coap_pdu_t *pdu = CAGeneratePDU(code, info, data->remoteEndpoint, &options,
+                                            &transport);
+            EXPECT_TRUE(pdu != NULL);
+            if (!pdu)
+            {
+                coap_delete_list(options);
+                break;
+            }
+            EXPECT_EQ(CA_STATUS_OK, CAAddBlockOption(&pdu, info, data->remoteEndpoint,
+                                                     &options));
+
+            coap_opt_iterator_t oi;
+            coap_opt_t *option = coap_check_option(pdu, (unsigned char) blockType, &oi);
+            if (option)
+            {
+                uint32_t num = coap_opt_block_num(option);
+                nums.push_back(num);
+                EXPECT_EQ(num + 1 < blockCount, 0 != COAP_OPT_BLOCK_MORE(option));
+            }
+            coap_delete_list(options);
+            coap_delete_pdu(pdu);
+        }
+        clearSentData();
+        return nums;
+    }
+
+    CAEndpoint_t *m_endpoint = NULL;
+    CAToken_t m_token = NULL;
+    CABlockDataID_t *m_blockID = NULL;
+};
+
+TEST_F(CAQBlockTransferTests, CAResendMissingQBlocksOf408)
+{
+    size_t blockSize = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+    std::vector<uint8_t> body(11 * blockSize + blockSize / 2, '1');
+
+    CARequestInfo_t requestInfo;
+    memset(&requestInfo, 0, sizeof(CARequestInfo_t));
+    requestInfo.method = CA_POST;
+    requestInfo.info.token = m_token;
+    requestInfo.info.tokenLength = CA_MAX_TOKEN_LEN;
+    requestInfo.info.type = CA_MSG_CONFIRM;
+    requestInfo.info.payload = body.data();
+    requestInfo.info.payloadSize = body.size();
+
+    CAData_t cadata;
+    memset(&cadata, 0, sizeof(CAData_t));
+    cadata.type = SEND_TYPE_UNICAST;
+    cadata.remoteEndpoint = m_endpoint;
+    cadata.requestInfo = &requestInfo;
+    cadata.dataType = CA_REQUEST_DATA;
+
+    // the first set goes without waiting for any answer
+    ASSERT_EQ(CA_STATUS_OK, CASendBlockWiseData(&cadata));
+    EXPECT_EQ(CA_OPTION_Q_BLOCK1, CAGetBlockOptionType(m_blockID));
+    std::vector<uint32_t> nums = sentBlocks(CA_OPTION_Q_BLOCK1, 12);
+    ASSERT_EQ(10u, nums.size());
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        EXPECT_EQ(i, nums[i]);
+    }
+
+    CAInfo_t responseData;
+    memset(&responseData, 0, sizeof(CAInfo_t));
+    responseData.token = m_token;
+    responseData.tokenLength = CA_MAX_TOKEN_LEN;
+    responseData.type = CA_MSG_ACKNOWLEDGE;
+
+    // 4.08 lists the blocks of the set that were lost
+    coap_list_t *options = NULL;
+    coap_transport_t transport = COAP_UDP;
+    coap_pdu_t *pdu = CAGeneratePDU(CA_REQUEST_ENTITY_INCOMPLETE, &responseData, m_endpoint,
+                                    &options, &transport);
+    coap_delete_list(options);
+    ASSERT_TRUE(pdu != NULL);
+
+    const uint32_t missing[] = { 3, 7 };
+    uint8_t buf[sizeof(missing) / sizeof(missing[0]) * 5];
+    size_t length = CAEncodeMissingQBlocks(missing, 2, buf);
+    coap_add_data(pdu, (unsigned int) length, buf);
+    EXPECT_EQ(CA_STATUS_OK, CAResendMissingQBlocks(pdu, m_blockID));
+    coap_delete_pdu(pdu);
+
+    nums = sentBlocks(CA_OPTION_Q_BLOCK1, 12);
+    ASSERT_EQ(2u, nums.size());
+    EXPECT_EQ(3u, nums[0]);
+    EXPECT_EQ(7u, nums[1]);
+
+    // nothing listed, the next set is sent
+    options = NULL;
+    pdu = CAGeneratePDU(CA_REQUEST_ENTITY_INCOMPLETE, &responseData, m_endpoint, &options,
+                        &transport);
+    coap_delete_list(options);
+    ASSERT_TRUE(pdu != NULL);
+    EXPECT_EQ(CA_STATUS_OK, CAResendMissingQBlocks(pdu, m_blockID));
+    coap_delete_pdu(pdu);
+
+    nums = sentBlocks(CA_OPTION_Q_BLOCK1, 12);
+    ASSERT_EQ(2u, nums.size());
+    EXPECT_EQ(10u, nums[0]);
+    EXPECT_EQ(11u, nums[1]);
+}
+
+TEST_F(CAQBlockTransferTests, CAFallBackFromQBlockOn402)
+{
+    size_t blockSize = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+    std::vector<uint8_t> body(3 * blockSize, '1');
+
+    CARequestInfo_t requestInfo;
+    memset(&requestInfo, 0, sizeof(CARequestInfo_t));
+    requestInfo.method = CA_PUT;
+    requestInfo.info.token = m_token;
+    requestInfo.info.tokenLength = CA_MAX_TOKEN_LEN;
+    requestInfo.info.type = CA_MSG_CONFIRM;
+    requestInfo.info.payload = body.data();
+    requestInfo.info.payloadSize = body.size();
+
+    CAData_t cadata;
+    memset(&cadata, 0, sizeof(CAData_t));
+    cadata.type = SEND_TYPE_UNICAST;
+    cadata.remoteEndpoint = m_endpoint;
+    cadata.requestInfo = &requestInfo;
+    cadata.dataType = CA_REQUEST_DATA;
+
+    ASSERT_EQ(CA_STATUS_OK, CASendBlockWiseData(&cadata));
+    EXPECT_EQ(3u, sentBlocks(CA_OPTION_Q_BLOCK1, 3).size());
+
+    // 4.02 makes the request start over with Block1
+    EXPECT_EQ(CA_STATUS_OK, CAFallBackFromQBlock(m_blockID, m_endpoint));
+    EXPECT_EQ(COAP_OPTION_BLOCK1, CAGetBlockOptionType(m_blockID));
+    ASSERT_EQ(1u, g_sentData.size());
+
+    CAInfo_t *info = &g_sentData[0]->requestInfo->info;
+    coap_list_t *options = NULL;
+    coap_transport_t transport = COAP_UDP;
+    coap_pdu_t *pdu = CAGeneratePDU(CA_PUT, info, m_endpoint, &options, &transport);
+    ASSERT_TRUE(pdu != NULL);
+    EXPECT_EQ(CA_STATUS_OK, CAAddBlockOption(&pdu, info, m_endpoint, &options));
+
+    coap_opt_iterator_t oi;
+    coap_opt_t *option = coap_check_option(pdu, COAP_OPTION_BLOCK1, &oi);
+    ASSERT_TRUE(option != NULL);
+    EXPECT_EQ(0u, coap_opt_block_num(option));
+    EXPECT_TRUE(0 != COAP_OPT_BLOCK_MORE(option));
+    EXPECT_TRUE(NULL == coap_check_option(pdu, CA_OPTION_Q_BLOCK1, &oi));
+    coap_delete_list(options);
+    coap_delete_pdu(pdu);
+    clearSentData();
+    CARemoveBlockDataFromList(m_blockID);
+
+    // the endpoint is not offered Q-Block any more
+    ASSERT_EQ(CA_STATUS_OK, CASendBlockWiseData(&cadata));
+    EXPECT_EQ(COAP_OPTION_BLOCK1, CAGetBlockOptionType(m_blockID));
+    EXPECT_EQ(1u, g_sentData.size());
+    clearSentData();
+
+    // a transfer without Q-Block has nothing to fall back from
+    EXPECT_EQ(CA_NOT_SUPPORTED, CAFallBackFromQBlock(m_blockID, m_endpoint));
+}
+
+TEST_F(CAQBlockTransferTests, CASendResponseToQBlock1InQBlock2Sets)
+{
+    size_t blockSize = BLOCK_SIZE(CA_DEFAULT_BLOCK_SIZE);
+    std::vector<uint8_t> body(blockSize + blockSize / 2, '1');
+
+    CAInfo_t requestData;
+    memset(&requestData, 0, sizeof(CAInfo_t));
+    requestData.token = m_token;
+    requestData.tokenLength = CA_MAX_TOKEN_LEN;
+    requestData.type = CA_MSG_NONCONFIRM;
+
+    // the server gets a request in a set of two Q-Block1 blocks
+    for (uint32_t num = 0; num < 2; num++)
+    {
+        size_t offset = num * blockSize;
+        size_t length = std::min(blockSize, body.size() - offset);
+        coap_pdu_t *pdu = generateQBlock1(&requestData, m_endpoint, num, 0 == num,
+                                          body.size(), &body[offset], length);
+        ASSERT_TRUE(pdu != NULL);
+
+        CARequestInfo_t requestInfo;
+        memset(&requestInfo, 0, sizeof(CARequestInfo_t));
+        requestInfo.method = CA_POST;
+        requestInfo.info = requestData;
+        requestInfo.info.payload = &body[offset];
+        requestInfo.info.payloadSize = length;
+
+        CAData_t cadata;
+        memset(&cadata, 0, sizeof(CAData_t));
+        cadata.type = SEND_TYPE_UNICAST;
+        cadata.remoteEndpoint = m_endpoint;
+        cadata.requestInfo = &requestInfo;
+        cadata.dataType = CA_REQUEST_DATA;
+
+        EXPECT_EQ(CA_STATUS_OK, CAReceiveBlockWiseData(pdu, m_endpoint, &cadata, length));
+        coap_delete_pdu(pdu);
+    }
+    EXPECT_EQ(CA_OPTION_Q_BLOCK1, CAGetBlockOptionType(m_blockID));
+
+    // its large response goes in sets of Q-Block2 blocks
+    std::vector<uint8_t> response(11 * blockSize + 1, '2');
+    CAResponseInfo_t responseInfo;
+    memset(&responseInfo, 0, sizeof(CAResponseInfo_t));
+    responseInfo.result = CA_CHANGED;
+    responseInfo.info.token = m_token;
+    responseInfo.info.tokenLength = CA_MAX_TOKEN_LEN;
+    responseInfo.info.type = CA_MSG_NONCONFIRM;
+    responseInfo.info.payload = response.data();
+    responseInfo.info.payloadSize = response.size();
+
+    CAData_t cadata;
+    memset(&cadata, 0, sizeof(CAData_t));
+    cadata.type = SEND_TYPE_UNICAST;
+    cadata.remoteEndpoint = m_endpoint;
+    cadata.responseInfo = &responseInfo;
+    cadata.dataType = CA_RESPONSE_DATA;
+
+    ASSERT_EQ(CA_STATUS_OK, CASendBlockWiseData(&cadata));
+    EXPECT_EQ(CA_OPTION_Q_BLOCK2, CAGetBlockOptionType(m_blockID));
+    std::vector<uint32_t> nums = sentBlocks(CA_OPTION_Q_BLOCK2, 12);
+    ASSERT_EQ(10u, nums.size());
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        EXPECT_EQ(i, nums[i]);
+    }
+
+    // the client asks for the next set
+    requestData.type = CA_MSG_NONCONFIRM;
+    coap_list_t *options = NULL;
+    coap_transport_t transport = COAP_UDP;
+    coap_pdu_t *pdu = CAGeneratePDU(CA_GET, &requestData, m_endpoint, &options, &transport);
+    coap_delete_list(options);
+    ASSERT_TRUE(pdu != NULL);
+
+    unsigned char buf[4] = { 0 };
+    unsigned int value = (10 << 4) | (1 << 3) | CA_DEFAULT_BLOCK_SIZE;
+    coap_add_option(pdu, CA_OPTION_Q_BLOCK2, coap_encode_var_bytes(buf, value), buf);
+
+    CARequestInfo_t requestInfo;
+    memset(&requestInfo, 0, sizeof(CARequestInfo_t));
+    requestInfo.method = CA_GET;
+    requestInfo.info = requestData;
+
+    memset(&cadata, 0, sizeof(CAData_t));
+    cadata.type = SEND_TYPE_UNICAST;
+    cadata.remoteEndpoint = m_endpoint;
+    cadata.requestInfo = &requestInfo;
+    cadata.dataType = CA_REQUEST_DATA;
+
+    EXPECT_EQ(CA_STATUS_OK, CAReceiveBlockWiseData(pdu, m_endpoint, &cadata, 0));
+    coap_delete_pdu(pdu);
+
+    nums = sentBlocks(CA_OPTION_Q_BLOCK2, 12);
+    ASSERT_EQ(2u, nums.size());
+    EXPECT_EQ(10u, nums[0]);
+    EXPECT_EQ(11u, nums[1]);
+}
@@ -0,0 +1,161 @@
+/* *****************************************************************
+ *
+ * Copyright 2017 IoTivity Project All Rights Reserved.
+ *
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+#include "iotivity_config.h"
+#include <gtest/gtest.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "caipinterface.h"
+#include "caipnwmonitor.h"
+#include "cathreadpool.h"
+#include "oic_string.h"
+
+namespace
+{
+    const size_t BURST_SIZE = 64;
+
+    // Empty CoAP confirmable GET with message ID 1.
+    const unsigned char MESSAGE[] = { 0x40, 0x01, 0x00, 0x01 };
+
+    std::atomic<size_t> g_receivedCount(0);
+
+    void onPacket(const CASecureEndpoint_t *sep, const void *data, size_t dataLength)
+    {
+        if (sep && data && sizeof(MESSAGE) == dataLength &&
+            0 == memcmp(data, MESSAGE, dataLength))
+        {
+            ++g_receivedCount;
+        }
+    }
+
+    void onAdapterStateChanged(CATransportAdapter_t, CANetworkStatus_t)
+    {
+    }
+
+    class CAIPServerTest : public ::testing::Test
+    {
+    protected:
+        virtual void SetUp()
+        {
+            ASSERT_EQ(CA_STATUS_OK, ca_thread_pool_init(2, &m_threadPool));
+
+            caglobals.ip.u6.fd = OC_INVALID_SOCKET;
+            caglobals.ip.u6s.fd = OC_INVALID_SOCKET;
+            caglobals.ip.u4.fd = OC_INVALID_SOCKET;
+            caglobals.ip.u4s.fd = OC_INVALID_SOCKET;
+            caglobals.ip.m6.fd = OC_INVALID_SOCKET;
+            caglobals.ip.m6s.fd = OC_INVALID_SOCKET;
+            caglobals.ip.m4.fd = OC_INVALID_SOCKET;
+            caglobals.ip.m4s.fd = OC_INVALID_SOCKET;
+            caglobals.ip.u4.port = 0;
+            caglobals.ip.u4s.port = 0;
+            caglobals.ip.m4.port = CA_COAP;
+            caglobals.ip.m4s.port = CA_SECURE_COAP;
+            caglobals.ip.ipv4enabled = true;
+            caglobals.ip.ipv6enabled = false;
+            caglobals.ip.selectTimeout = 1;
+
+            g_receivedCount = 0;
+            ASSERT_EQ(CA_STATUS_OK, CAIPStartNetworkMonitor(onAdapterStateChanged, CA_ADAPTER_IP));
+            CAIPSetPacketReceiveCallback(onPacket);
+            ASSERT_EQ(CA_STATUS_OK, CAIPStartServer(m_threadPool));
+            ASSERT_NE(0, caglobals.ip.u4.port);
+        }
+
+        virtual void TearDown()
+        {
+            CAIPStopServer();
+            CAIPStopNetworkMonitor(CA_ADAPTER_IP);
+            ca_thread_pool_free(m_threadPool);
+            CAIPSetPacketReceiveCallback(NULL);
+        }
+
+        ca_thread_pool_t m_threadPool = NULL;
+    };
+}
+
+TEST_F(CAIPServerTest, ReceiveStatsCountBurst)
+{
+    CAIPReceiveStats_t before;
+    CAIPGetReceiveStats(&before);
+
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ASSERT_LE(0, fd);
+    struct sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(caglobals.ip.u4.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (size_t i = 0; i < BURST_SIZE; ++i)
+    {
+        ASSERT_EQ((ssize_t)sizeof(MESSAGE), sendto(fd, MESSAGE, sizeof(MESSAGE), 0,
+                                                   (struct sockaddr *)&addr, sizeof(addr)));
+    }
+    close(fd);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (g_receivedCount < BURST_SIZE && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(BURST_SIZE, g_receivedCount);
+
+    CAIPReceiveStats_t after;
+    CAIPGetReceiveStats(&after);
+    uint64_t datagrams = after.datagrams - before.datagrams;
+    uint64_t batches = after.batches - before.batches;
+    EXPECT_LE((uint64_t)BURST_SIZE, datagrams);
+    EXPECT_LT(0u, batches);
+    EXPECT_GE(datagrams, batches);
+    EXPECT_LE(1u, after.maxBatchSize);
+    EXPECT_EQ(before.truncated, after.truncated);
+}
+
+TEST_F(CAIPServerTest, BatchedSendDeliversEveryDatagram)
+{
+    CAEndpoint_t endpoint = CAEndpoint_t();
+    endpoint.adapter = CA_ADAPTER_IP;
+    endpoint.flags = CA_IPV4;
+    endpoint.port = caglobals.ip.u4.port;
+    OICStrcpy(endpoint.addr, sizeof(endpoint.addr), "127.0.0.1");
+
+    // More than one batch, so the batch is written both when full and when flushed.
+    for (size_t i = 0; i < BURST_SIZE; ++i)
+    {
+        CAIPBatchSendData(&endpoint, MESSAGE, sizeof(MESSAGE), false);
+    }
+    CAIPFlushSendData();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (g_receivedCount < BURST_SIZE && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(BURST_SIZE, g_receivedCount);
+}
@@ -261,3 +261,62 @@ TEST(CAProtocolMessage, CAGetInfoFromPDU)
     coap_delete_list(options);
     coap_delete_pdu(pdu);
 }
+
+#ifdef WITH_TCP
+TEST(CAProtocolMessage, CAParseCSM)
+{
+    coap_transport_t transport = COAP_UDP;
+    coap_pdu_t *pdu = CAGenerateCSMPDU(65 * 1024, true, &transport);
+    ASSERT_TRUE(NULL != pdu);
+    EXPECT_TRUE(CAIsSignalingMessage(pdu->transport_hdr, pdu->length));
+
+    uint32_t maxMessageSize = CA_DEFAULT_MAX_MESSAGE_SIZE;
+    bool blockWiseTransfer = false;
+    EXPECT_EQ(CA_STATUS_OK, CAParseCSM(pdu->transport_hdr, pdu->length,
+                                       &maxMessageSize, &blockWiseTransfer));
+    EXPECT_EQ(65u * 1024, maxMessageSize);
+    EXPECT_TRUE(blockWiseTransfer);
+    coap_delete_pdu(pdu);
+
+    // Without the Block-Wise-Transfer option the peer does not support BERT.
+    pdu = CAGenerateCSMPDU(CA_DEFAULT_MAX_MESSAGE_SIZE, false, &transport);
+    ASSERT_TRUE(NULL != pdu);
+    blockWiseTransfer = false;
+    EXPECT_EQ(CA_STATUS_OK, CAParseCSM(pdu->transport_hdr, pdu->length,
+                                       &maxMessageSize, &blockWiseTransfer));
+    EXPECT_EQ(static_cast<uint32_t>(CA_DEFAULT_MAX_MESSAGE_SIZE), maxMessageSize);
+    EXPECT_FALSE(blockWiseTransfer);
+    coap_delete_pdu(pdu);
+}
+
+TEST(CAProtocolMessage, CAParseCSMOfRequest)
+{
+    CAEndpoint_t tempRep;
+    memset(&tempRep, 0, sizeof(CAEndpoint_t));
+    tempRep.flags = CA_DEFAULT_FLAGS;
+    tempRep.adapter = CA_ADAPTER_TCP;
+    tempRep.port = 5683;
+
+    coap_list_t *options = NULL;
+    coap_transport_t transport = COAP_UDP;
+
+    CAInfo_t inData;
+    memset(&inData, 0, sizeof(CAInfo_t));
+    inData.token = (CAToken_t)"token";
+    inData.tokenLength = (uint8_t)strlen(inData.token);
+    inData.type = CA_MSG_NONCONFIRM;
+
+    coap_pdu_t *pdu = CAGeneratePDU(CA_GET, &inData, &tempRep, &options, &transport);
+    ASSERT_TRUE(NULL != pdu);
+    EXPECT_FALSE(CAIsSignalingMessage(pdu->transport_hdr, pdu->length));
+
+    uint32_t maxMessageSize = CA_DEFAULT_MAX_MESSAGE_SIZE;
+    bool blockWiseTransfer = false;
+    EXPECT_EQ(CA_NOT_SUPPORTED, CAParseCSM(pdu->transport_hdr, pdu->length,
+                                           &maxMessageSize, &blockWiseTransfer));
+    EXPECT_EQ(static_cast<uint32_t>(CA_DEFAULT_MAX_MESSAGE_SIZE), maxMessageSize);
+
+    coap_delete_list(options);
+    coap_delete_pdu(pdu);
+}
+#endif
@@ -0,0 +1,160 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "oic_malloc.h"
+#include "cathreadpool.h"
+#include "caretransmission.h"
+
+namespace
+{
+    std::atomic<int> g_sentCount(0);
+    std::atomic<int> g_timeoutCount(0);
+
+    CAResult_t sendMethod(const CAEndpoint_t *, const void *, uint32_t, CADataType_t)
+    {
+        ++g_sentCount;
+        return CA_STATUS_OK;
+    }
+
+    void timeoutCallback(const CAEndpoint_t *, const void *, uint32_t)
+    {
+        ++g_timeoutCount;
+    }
+
+    // Minimal CoAP over UDP header: version 1, no token, code and message id.
+    void makePdu(unsigned char *pdu, CAMessageType_t type, unsigned char code, uint16_t messageId)
+    {
+        pdu[0] = (unsigned char)(0x40 | (type << 4));
+        pdu[1] = code;
+        pdu[2] = (unsigned char)(messageId >> 8);
+        pdu[3] = (unsigned char)(messageId & 0xFF);
+    }
+
+    CAEndpoint_t makeEndpoint()
+    {
+        CAEndpoint_t endpoint = CAEndpoint_t();
+        endpoint.adapter = CA_ADAPTER_IP;
+        endpoint.flags = CA_IPV4;
+        endpoint.port = 5683;
+        return endpoint;
+    }
+}
+
+class CARetransmissionTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        g_sentCount = 0;
+        g_timeoutCount = 0;
+        ASSERT_EQ(CA_STATUS_OK, ca_thread_pool_init(1, &m_threadPool));
+    }
+
+    virtual void TearDown()
+    {
+        ca_thread_pool_free(m_threadPool);
+    }
+
+    ca_thread_pool_t m_threadPool = NULL;
+    CARetransmission_t m_context;
+};
+
+TEST_F(CARetransmissionTest, AckRemovesMatchingMessage)
+{
+    ASSERT_EQ(CA_STATUS_OK, CARetransmissionInitialize(&m_context, m_threadPool, sendMethod,
+                                                       timeoutCallback, NULL));
+    CAEndpoint_t endpoint = makeEndpoint();
+
+    unsigned char pdu[4];
+    for (uint16_t id = 1; id <= 100; ++id)
+    {
+        makePdu(pdu, CA_MSG_CONFIRM, 0x01, id);
+        EXPECT_EQ(CA_STATUS_OK,
+                  CARetransmissionSentData(&m_context, &endpoint, CA_REQUEST_DATA, pdu, sizeof(pdu)));
+    }
+    EXPECT_EQ(100u, m_context.dataCount);
+
+    makePdu(pdu, CA_MSG_CONFIRM, 0x01, 50);
+    EXPECT_EQ(CA_STATUS_FAILED,
+              CARetransmissionSentData(&m_context, &endpoint, CA_REQUEST_DATA, pdu, sizeof(pdu)));
+
+    // A piggybacked response only removes the message.
+    void *retransmissionPdu = NULL;
+    makePdu(pdu, CA_MSG_ACKNOWLEDGE, 0x45, 50);
+    EXPECT_EQ(CA_STATUS_OK, CARetransmissionReceivedData(&m_context, &endpoint, pdu, sizeof(pdu),
+                                                         &retransmissionPdu));
+    EXPECT_EQ(NULL, retransmissionPdu);
+    EXPECT_EQ(99u, m_context.dataCount);
+
+    // An empty ACK returns the acknowledged message.
+    makePdu(pdu, CA_MSG_ACKNOWLEDGE, 0x00, 7);
+    EXPECT_EQ(CA_STATUS_OK, CARetransmissionReceivedData(&m_context, &endpoint, pdu, sizeof(pdu),
+                                                         &retransmissionPdu));
+    ASSERT_TRUE(NULL != retransmissionPdu);
+    EXPECT_EQ(7, ((unsigned char *)retransmissionPdu)[3]);
+    OICFree(retransmissionPdu);
+    EXPECT_EQ(98u, m_context.dataCount);
+
+    // Unknown message ids are ignored.
+    retransmissionPdu = NULL;
+    makePdu(pdu, CA_MSG_ACKNOWLEDGE, 0x00, 50);
+    EXPECT_EQ(CA_STATUS_OK, CARetransmissionReceivedData(&m_context, &endpoint, pdu, sizeof(pdu),
+                                                         &retransmissionPdu));
+    EXPECT_EQ(NULL, retransmissionPdu);
+    EXPECT_EQ(98u, m_context.dataCount);
+
+    EXPECT_EQ(0, g_sentCount);
+    EXPECT_EQ(CA_STATUS_OK, CARetransmissionDestroy(&m_context));
+}
+
+TEST_F(CARetransmissionTest, UnacknowledgedMessageTimesOut)
+{
+    CARetransmissionConfig_t config = { CA_ADAPTER_IP, 1 };
+    ASSERT_EQ(CA_STATUS_OK, CARetransmissionInitialize(&m_context, m_threadPool, sendMethod,
+                                                       timeoutCallback, &config));
+    ASSERT_EQ(CA_STATUS_OK, CARetransmissionStart(&m_context));
+    CAEndpoint_t endpoint = makeEndpoint();
+
+    unsigned char pdu[4];
+    makePdu(pdu, CA_MSG_CONFIRM, 0x01, 1);
+    ASSERT_EQ(CA_STATUS_OK,
+              CARetransmissionSentData(&m_context, &endpoint, CA_REQUEST_DATA, pdu, sizeof(pdu)));
+    makePdu(pdu, CA_MSG_CONFIRM, 0x01, 2);
+    ASSERT_EQ(CA_STATUS_OK,
+              CARetransmissionSentData(&m_context, &endpoint, CA_REQUEST_DATA, pdu, sizeof(pdu)));
+
+    // The first retransmission is due between 2 and 3 seconds after sending.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (g_timeoutCount < 2 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    EXPECT_EQ(2, g_sentCount);
+    EXPECT_EQ(2, g_timeoutCount);
+
+    EXPECT_EQ(CA_STATUS_OK, CARetransmissionStop(&m_context));
+    EXPECT_EQ(CA_STATUS_OK, CARetransmissionDestroy(&m_context));
+}
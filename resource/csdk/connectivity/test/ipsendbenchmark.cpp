@@ -0,0 +1,205 @@
+/* *****************************************************************
+ *
+ * Copyright 2017 IoTivity Project All Rights Reserved.
+ *
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+// Loopback benchmark of the UDP send path. A burst of notifications is sent to a set of
+// observer sockets, once with one sendto() per datagram and once through the send batch,
+// and the sending thread's packet rate and CPU time per packet are reported for both.
+// A single observer receiving equal-sized datagrams shows the effect of UDP_SEGMENT.
+
+#include "iotivity_config.h"
+#include <gtest/gtest.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "caipinterface.h"
+#include "caipnwmonitor.h"
+#include "cathreadpool.h"
+#include "oic_string.h"
+
+namespace
+{
+    const size_t NOTIFICATIONS = 200000;
+    const size_t PAYLOAD_SIZE = 64;
+    const int SINK_BUFFER = 8 * 1024 * 1024;
+
+    double threadCpuSeconds()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+
+    void onAdapterStateChanged(CATransportAdapter_t, CANetworkStatus_t)
+    {
+    }
+
+    // Observer sockets, drained by one thread that only counts datagrams.
+    class Sinks
+    {
+    public:
+        explicit Sinks(size_t count) : m_received(0), m_stop(false)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+                setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &SINK_BUFFER, sizeof(SINK_BUFFER));
+                struct timeval timeout = { 0, 10000 };
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                struct sockaddr_in addr = sockaddr_in();
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+                socklen_t len = sizeof(addr);
+                getsockname(fd, (struct sockaddr *)&addr, &len);
+
+                CAEndpoint_t endpoint = CAEndpoint_t();
+                endpoint.adapter = CA_ADAPTER_IP;
+                endpoint.flags = CA_IPV4;
+                endpoint.port = ntohs(addr.sin_port);
+                OICStrcpy(endpoint.addr, sizeof(endpoint.addr), "127.0.0.1");
+
+                m_fds.push_back(fd);
+                m_endpoints.push_back(endpoint);
+            }
+            m_thread = std::thread([this]() { drain(); });
+        }
+
+        ~Sinks()
+        {
+            m_stop = true;
+            m_thread.join();
+            for (int fd : m_fds)
+            {
+                close(fd);
+            }
+        }
+
+        CAEndpoint_t &endpoint(size_t i)
+        {
+            return m_endpoints[i % m_endpoints.size()];
+        }
+
+        size_t received() const
+        {
+            return m_received;
+        }
+
+    private:
+        void drain()
+        {
+            char buffer[2048];
+            while (!m_stop)
+            {
+                for (int fd : m_fds)
+                {
+                    while (recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+                    {
+                        ++m_received;
+                    }
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        std::vector<int> m_fds;
+        std::vector<CAEndpoint_t> m_endpoints;
+        std::atomic<size_t> m_received;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+    };
+
+    void measure(const char *name, size_t observers, bool batch)
+    {
+        Sinks sinks(observers);
+        std::vector<unsigned char> payload(PAYLOAD_SIZE, 0x42);
+
+        auto start = std::chrono::steady_clock::now();
+        double cpuStart = threadCpuSeconds();
+        for (size_t i = 0; i < NOTIFICATIONS; ++i)
+        {
+            if (batch)
+            {
+                CAIPBatchSendData(&sinks.endpoint(i), payload.data(), payload.size(), false);
+            }
+            else
+            {
+                CAIPSendData(&sinks.endpoint(i), payload.data(), payload.size(), false);
+            }
+        }
+        CAIPFlushSendData();
+        double cpu = threadCpuSeconds() - cpuStart;
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        // Let the sinks catch up before reporting what arrived.
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        std::cout << name << ": observers=" << observers
+                  << " packets/s=" << NOTIFICATIONS / seconds
+                  << " cpu/packet=" << cpu * 1e9 / NOTIFICATIONS << "ns"
+                  << " received=" << sinks.received() << "/" << NOTIFICATIONS << std::endl;
+    }
+}
+
+TEST(IPSendBenchmark, NotificationBurstSingleVersusBatched)
+{
+    ca_thread_pool_t threadPool = NULL;
+    ASSERT_EQ(CA_STATUS_OK, ca_thread_pool_init(2, &threadPool));
+
+    caglobals.ip.u6.fd = OC_INVALID_SOCKET;
+    caglobals.ip.u6s.fd = OC_INVALID_SOCKET;
+    caglobals.ip.u4.fd = OC_INVALID_SOCKET;
+    caglobals.ip.u4s.fd = OC_INVALID_SOCKET;
+    caglobals.ip.m6.fd = OC_INVALID_SOCKET;
+    caglobals.ip.m6s.fd = OC_INVALID_SOCKET;
+    caglobals.ip.m4.fd = OC_INVALID_SOCKET;
+    caglobals.ip.m4s.fd = OC_INVALID_SOCKET;
+    caglobals.ip.u4.port = 0;
+    caglobals.ip.u4s.port = 0;
+    caglobals.ip.m4.port = CA_COAP;
+    caglobals.ip.m4s.port = CA_SECURE_COAP;
+    caglobals.ip.ipv4enabled = true;
+    caglobals.ip.ipv6enabled = false;
+    caglobals.ip.selectTimeout = 1;
+
+    ASSERT_EQ(CA_STATUS_OK, CAIPStartNetworkMonitor(onAdapterStateChanged, CA_ADAPTER_IP));
+    ASSERT_EQ(CA_STATUS_OK, CAIPStartServer(threadPool));
+
+    // The benchmark thread stands in for the adapter's send thread.
+    measure("sendto", 100, false);
+    measure("sendmmsg", 100, true);
+    measure("sendto", 1, false);
+    measure("sendmmsg+gso", 1, true);
+
+    CAIPStopServer();
+    CAIPStopNetworkMonitor(CA_ADAPTER_IP);
+    ca_thread_pool_free(threadPool);
+}
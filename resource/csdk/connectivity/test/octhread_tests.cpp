@@ -542,3 +542,97 @@ TEST(ConditionTests, TC_07_WAITDURATION)
 
     oc_cond_free(sharedCond);
 }
+
+typedef struct _tagPoolTaskData
+{
+    oc_mutex mutex;
+    oc_cond cond;
+    int started;
+    int finished;
+    bool release;
+} PoolTaskData;
+
+void poolTaskFunc(void *context)
+{
+    PoolTaskData *pData = (PoolTaskData *) context;
+
+    oc_mutex_lock(pData->mutex);
+    pData->started++;
+    oc_cond_broadcast(pData->cond);
+    while (!pData->release)
+    {
+        oc_cond_wait(pData->cond, pData->mutex);
+    }
+    pData->finished++;
+    oc_cond_broadcast(pData->cond);
+    oc_mutex_unlock(pData->mutex);
+}
+
+TEST(ThreadPoolTests, TC_01_REUSE_WORKERS)
+{
+    ca_thread_pool_t mythreadpool;
+
+    EXPECT_EQ(CA_STATUS_OK, ca_thread_pool_init(2, &mythreadpool));
+
+    PoolTaskData pData = { oc_mutex_new(), oc_cond_new(), 0, 0, true };
+
+    // One task at a time is always taken by a worker that is already running.
+    for (int i = 1; i <= 50; i++)
+    {
+        EXPECT_EQ(CA_STATUS_OK, ca_thread_pool_add_task(mythreadpool, poolTaskFunc, &pData));
+
+        oc_mutex_lock(pData.mutex);
+        while (pData.finished < i)
+        {
+            oc_cond_wait(pData.cond, pData.mutex);
+        }
+        oc_mutex_unlock(pData.mutex);
+    }
+
+    ca_thread_pool_stats_t stats;
+    EXPECT_EQ(CA_STATUS_OK, ca_thread_pool_get_stats(mythreadpool, &stats));
+    EXPECT_EQ(2u, stats.thread_count);
+    EXPECT_EQ(50u, stats.tasks_started);
+    EXPECT_EQ(0u, stats.queue_depth);
+    EXPECT_GE(stats.total_latency_us, stats.max_latency_us);
+
+    ca_thread_pool_free(mythreadpool);
+
+    oc_cond_free(pData.cond);
+    oc_mutex_free(pData.mutex);
+}
+
+TEST(ThreadPoolTests, TC_02_LONG_RUNNING_TASKS)
+{
+    ca_thread_pool_t mythreadpool;
+
+    EXPECT_EQ(CA_STATUS_OK, ca_thread_pool_init(1, &mythreadpool));
+
+    PoolTaskData pData = { oc_mutex_new(), oc_cond_new(), 0, 0, false };
+
+    // Tasks that only return when told to must all run, even beyond the initial workers.
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(CA_STATUS_OK, ca_thread_pool_add_task(mythreadpool, poolTaskFunc, &pData));
+    }
+
+    oc_mutex_lock(pData.mutex);
+    while (pData.started < 4)
+    {
+        oc_cond_wait(pData.cond, pData.mutex);
+    }
+    pData.release = true;
+    oc_cond_broadcast(pData.cond);
+    oc_mutex_unlock(pData.mutex);
+
+    ca_thread_pool_stats_t stats;
+    EXPECT_EQ(CA_STATUS_OK, ca_thread_pool_get_stats(mythreadpool, &stats));
+    EXPECT_EQ(4u, stats.thread_count);
+
+    // Returns only once every task has finished.
+    ca_thread_pool_free(mythreadpool);
+    EXPECT_EQ(4, pData.finished);
+
+    oc_cond_free(pData.cond);
+    oc_mutex_free(pData.mutex);
+}
@@ -0,0 +1,401 @@
+/* *****************************************************************
+ *
+ * Copyright 2017 IoTivity Project All Rights Reserved.
+ *
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+// Benchmark of block-wise transfer over UDP on a link with a round-trip time. The whole
+// CA stack runs in one process and talks to itself through a proxy that holds every
+// datagram for half the round-trip time and may drop some of them. The proxy has two
+// sockets: what the stack sends to the first one comes out of the second one, and the
+// other way round, so the stack is the client on one side and the server on the other.
+// Large POST requests and GET requests with a large response are timed until the whole
+// payload arrives, once with Block1 and Block2 and once with Q-Block1 and Q-Block2.
+
+#include "iotivity_config.h"
+#include <gtest/gtest.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "cainterface.h"
+#include "cautilinterface.h"
+#include "oic_string.h"
+
+namespace
+{
+    const size_t PAYLOAD_SIZE = 128 * 1024;
+    const size_t TRANSFERS = 3;
+    const std::chrono::milliseconds ONE_WAY_DELAY(25);
+    const std::chrono::seconds WAIT_LIMIT(120);
+    const char URI[] = "/a/qblock";
+
+    std::atomic<size_t> g_requestBytes(0);
+    std::atomic<size_t> g_requests(0);
+    std::atomic<size_t> g_responseBytes(0);
+    std::atomic<size_t> g_responses(0);
+    std::atomic<bool> g_stop(false);
+    std::vector<uint8_t> g_responsePayload(PAYLOAD_SIZE, 0x42);
+
+    // Datagram held by the proxy until it is due.
+    struct Datagram
+    {
+        std::chrono::steady_clock::time_point due;
+        int out;
+        std::vector<uint8_t> data;
+    };
+
+    class DelayProxy
+    {
+    public:
+        DelayProxy(uint16_t stackPort, double lossRate)
+            : m_stackPort(stackPort), m_lossRate(lossRate), m_random(4711), m_dropped(0)
+        {
+            m_sockets[0] = openSocket();
+            m_sockets[1] = openSocket();
+            m_receiver = std::thread(&DelayProxy::receive, this);
+            m_sender = std::thread(&DelayProxy::send, this);
+        }
+
+        ~DelayProxy()
+        {
+            m_stop = true;
+            m_condition.notify_all();
+            m_receiver.join();
+            m_sender.join();
+            close(m_sockets[0]);
+            close(m_sockets[1]);
+        }
+
+        // Port the stack sends its requests to.
+        uint16_t port() const
+        {
+            return socketPort(m_sockets[0]);
+        }
+
+        size_t dropped() const
+        {
+            return m_dropped;
+        }
+
+    private:
+        static int openSocket()
+        {
+            int fd = socket(AF_INET, SOCK_DGRAM, 0);
+            struct sockaddr_in addr = sockaddr_in();
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+            return fd;
+        }
+
+        static uint16_t socketPort(int fd)
+        {
+            struct sockaddr_in addr = sockaddr_in();
+            socklen_t length = sizeof(addr);
+            getsockname(fd, (struct sockaddr *)&addr, &length);
+            return ntohs(addr.sin_port);
+        }
+
+        // A datagram coming in on one socket goes out of the other one.
+        void receive()
+        {
+            struct pollfd fds[2] = { { m_sockets[0], POLLIN, 0 }, { m_sockets[1], POLLIN, 0 } };
+            std::vector<uint8_t> buffer(65536);
+            while (!m_stop)
+            {
+                if (0 >= poll(fds, 2, 10))
+                {
+                    continue;
+                }
+                for (int i = 0; i < 2; ++i)
+                {
+                    if (!(fds[i].revents & POLLIN))
+                    {
+                        continue;
+                    }
+                    ssize_t length = recv(m_sockets[i], buffer.data(), buffer.size(), 0);
+                    if (0 >= length)
+                    {
+                        continue;
+                    }
+                    if (std::uniform_real_distribution<double>(0, 1)(m_random) < m_lossRate)
+                    {
+                        ++m_dropped;
+                        continue;
+                    }
+
+                    Datagram datagram;
+                    datagram.due = std::chrono::steady_clock::now() + ONE_WAY_DELAY;
+                    datagram.out = m_sockets[1 - i];
+                    datagram.data.assign(buffer.begin(), buffer.begin() + length);
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_queue.push_back(datagram);
+                    m_condition.notify_one();
+                }
+            }
+        }
+
+        void send()
+        {
+            struct sockaddr_in stack = sockaddr_in();
+            stack.sin_family = AF_INET;
+            stack.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            stack.sin_port = htons(m_stackPort);
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_stop)
+            {
+                if (m_queue.empty())
+                {
+                    m_condition.wait_for(lock, std::chrono::milliseconds(10));
+                    continue;
+                }
+                // every datagram has the same delay, so they are due in order
+                if (std::chrono::steady_clock::now() < m_queue.front().due)
+                {
+                    m_condition.wait_until(lock, m_queue.front().due);
+                    continue;
+                }
+                Datagram datagram = m_queue.front();
+                m_queue.pop_front();
+                lock.unlock();
+                sendto(datagram.out, datagram.data.data(), datagram.data.size(), 0,
+                       (struct sockaddr *)&stack, sizeof(stack));
+                lock.lock();
+            }
+        }
+
+        uint16_t m_stackPort;
+        double m_lossRate;
+        std::mt19937 m_random;
+        std::atomic<size_t> m_dropped;
+        std::atomic<bool> m_stop{false};
+        int m_sockets[2];
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::deque<Datagram> m_queue;
+        std::thread m_receiver;
+        std::thread m_sender;
+    };
+
+    void onRequest(const CAEndpoint_t *endpoint, const CARequestInfo_t *requestInfo)
+    {
+        CAResponseInfo_t responseInfo = CAResponseInfo_t();
+        responseInfo.info = requestInfo->info;
+        responseInfo.info.type = (CA_MSG_CONFIRM == requestInfo->info.type) ?
+                CA_MSG_ACKNOWLEDGE : CA_MSG_NONCONFIRM;
+        responseInfo.info.options = NULL;
+        responseInfo.info.numOptions = 0;
+        responseInfo.info.resourceUri = NULL;
+        responseInfo.isMulticast = false;
+
+        if (CA_GET == requestInfo->method)
+        {
+            responseInfo.result = CA_CONTENT;
+            responseInfo.info.payload = g_responsePayload.data();
+            responseInfo.info.payloadSize = g_responsePayload.size();
+            responseInfo.info.payloadFormat = CA_FORMAT_APPLICATION_CBOR;
+        }
+        else
+        {
+            g_requestBytes += requestInfo->info.payloadSize;
+            ++g_requests;
+            responseInfo.result = CA_CHANGED;
+            responseInfo.info.payload = NULL;
+            responseInfo.info.payloadSize = 0;
+        }
+        CASendResponse(endpoint, &responseInfo);
+    }
+
+    void onResponse(const CAEndpoint_t *endpoint, const CAResponseInfo_t *responseInfo)
+    {
+        // acknowledged as the resource layer does
+        if (CA_MSG_CONFIRM == responseInfo->info.type)
+        {
+            CAResponseInfo_t ack = CAResponseInfo_t();
+            ack.result = CA_EMPTY;
+            ack.info.type = CA_MSG_ACKNOWLEDGE;
+            ack.info.messageId = responseInfo->info.messageId;
+            ack.info.dataType = CA_RESPONSE_DATA;
+            CASendResponse(endpoint, &ack);
+        }
+
+        if (CA_CONTENT == responseInfo->result)
+        {
+            g_responseBytes += responseInfo->info.payloadSize;
+            ++g_responses;
+        }
+    }
+
+    void onError(const CAEndpoint_t *, const CAErrorInfo_t *)
+    {
+    }
+
+    template <typename Predicate>
+    bool waitFor(Predicate done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + WAIT_LIMIT;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    bool sendRequest(const CAEndpoint_t &server, CAMethod_t method,
+                     std::vector<uint8_t> *payload)
+    {
+        CAToken_t token = NULL;
+        if (CA_STATUS_OK != CAGenerateToken(&token, CA_MAX_TOKEN_LEN))
+        {
+            return false;
+        }
+
+        CARequestInfo_t requestInfo = CARequestInfo_t();
+        requestInfo.method = method;
+        requestInfo.info.type = CA_MSG_CONFIRM;
+        requestInfo.info.token = token;
+        requestInfo.info.tokenLength = CA_MAX_TOKEN_LEN;
+        if (payload)
+        {
+            requestInfo.info.payload = payload->data();
+            requestInfo.info.payloadSize = payload->size();
+            requestInfo.info.payloadFormat = CA_FORMAT_APPLICATION_CBOR;
+        }
+        requestInfo.info.resourceUri = (CAURI_t)URI;
+
+        CAResult_t result = CASendRequest(&server, &requestInfo);
+        CADestroyToken(token);
+        return CA_STATUS_OK == result;
+    }
+
+    void measure(const char *name, bool qBlock, double lossRate)
+    {
+        ASSERT_EQ(CA_STATUS_OK, CASetQBlockTransfer(qBlock));
+
+        caglobals.client = true;
+        caglobals.server = true;
+        caglobals.clientFlags = CA_IPV4;
+        caglobals.serverFlags = CA_IPV4;
+        caglobals.ports.udp.u4 = 0;
+
+        ASSERT_EQ(CA_STATUS_OK, CAInitialize(CA_ADAPTER_IP));
+        CARegisterHandler(onRequest, onResponse, onError);
+        ASSERT_EQ(CA_STATUS_OK, CASelectNetwork(CA_ADAPTER_IP));
+        ASSERT_EQ(CA_STATUS_OK, CAStartListeningServer());
+
+        g_stop = false;
+        std::thread handler([]() {
+            while (!g_stop)
+            {
+                CAWaitForWakeup(10);
+                CAHandleRequestResponse();
+            }
+        });
+
+        {
+            DelayProxy proxy(caglobals.ip.u4.port, lossRate);
+
+            CAEndpoint_t server = CAEndpoint_t();
+            server.adapter = CA_ADAPTER_IP;
+            server.flags = CA_IPV4;
+            server.port = proxy.port();
+            OICStrcpy(server.addr, sizeof(server.addr), "127.0.0.1");
+
+            std::vector<uint8_t> payload(PAYLOAD_SIZE, 0x42);
+            g_requests = 0;
+            g_requestBytes = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < TRANSFERS; ++i)
+            {
+                size_t expected = i + 1;
+                EXPECT_TRUE(sendRequest(server, CA_POST, &payload));
+                EXPECT_TRUE(waitFor([expected]() { return g_requests >= expected; }))
+                    << "request " << i << " did not arrive";
+            }
+            double postSeconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+
+            g_responses = 0;
+            g_responseBytes = 0;
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < TRANSFERS; ++i)
+            {
+                size_t expected = i + 1;
+                EXPECT_TRUE(sendRequest(server, CA_GET, NULL));
+                EXPECT_TRUE(waitFor([expected]() { return g_responses >= expected; }))
+                    << "response " << i << " did not arrive";
+            }
+            double getSeconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+
+            std::cout << name << ": payload=" << PAYLOAD_SIZE
+                      << " rtt_ms=" << 2 * ONE_WAY_DELAY.count()
+                      << " loss=" << lossRate
+                      << " POST ms/transfer=" << postSeconds * 1000 / TRANSFERS
+                      << " GET ms/transfer=" << getSeconds * 1000 / TRANSFERS
+                      << " received=" << g_requestBytes + g_responseBytes << "/"
+                      << 2 * PAYLOAD_SIZE * TRANSFERS
+                      << " dropped=" << proxy.dropped() << std::endl;
+        }
+
+        g_stop = true;
+        handler.join();
+        CATerminate();
+        CASetQBlockTransfer(false);
+    }
+}
+
+TEST(QBlockBenchmark, Block)
+{
+    measure("Block1/Block2", false, 0);
+}
+
+TEST(QBlockBenchmark, QBlock)
+{
+    measure("Q-Block1/Q-Block2", true, 0);
+}
+
+TEST(QBlockBenchmark, BlockWithLoss)
+{
+    measure("Block1/Block2", false, 0.01);
+}
+
+TEST(QBlockBenchmark, QBlockWithLoss)
+{
+    measure("Q-Block1/Q-Block2", true, 0.01);
+}
@@ -49,6 +49,8 @@
 #define SetCASecureEndpointAttribute SetCASecureEndpointAttributeTest
 #define GetCASecureEndpointAttributes GetCASecureEndpointAttributesTest
 #define CAsetPeerCNVerifyCallback CAsetPeerCNVerifyCallbackTest
+#define CAsslInvalidateCredentials CAsslInvalidateCredentialsTest
+#define CAsslGetHandshakeStats CAsslGetHandshakeStatsTest
 
 #include "../src/adapter_util/ca_adapter_net_ssl.c"
 
@@ -1858,14 +1860,14 @@ TEST(TLSAdapter, Test_2)
  * *************************/
 
 unsigned char predictedClientHello[] = {
-    0x16, 0x03, 0x03, 0x00, 0x71, 0x01, 0x00, 0x00, 0x6d, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x34,
+    0x16, 0x03, 0x03, 0x00, 0x75, 0x01, 0x00, 0x00, 0x71, 0x03, 0x03, 0x00, 0x00, 0x00, 0x00, 0x34,
     0x1c, 0x45, 0xfa, 0xbf, 0x39, 0xe5, 0xbf, 0x52, 0x20, 0x4f, 0x8f, 0xf5, 0x6b, 0x89, 0xb0, 0xbb,
     0x3a, 0x5e, 0x13, 0xb4, 0x94, 0x73, 0xee, 0xf4, 0x98, 0x48, 0x4a, 0x00, 0x00, 0x14, 0xc0, 0xac,
     0x00, 0x3d, 0x00, 0x9c, 0xc0, 0x2b, 0xc0, 0xae, 0xc0, 0x23, 0xc0, 0x24, 0xc0, 0x2c, 0xc0, 0x27,
-    0x00, 0xff, 0x01, 0x00, 0x00, 0x30, 0x00, 0x0d, 0x00, 0x16, 0x00, 0x14, 0x06, 0x03, 0x06, 0x01,
+    0x00, 0xff, 0x01, 0x00, 0x00, 0x34, 0x00, 0x0d, 0x00, 0x16, 0x00, 0x14, 0x06, 0x03, 0x06, 0x01,
     0x05, 0x03, 0x05, 0x01, 0x04, 0x03, 0x04, 0x01, 0x03, 0x03, 0x03, 0x01, 0x02, 0x03, 0x02, 0x01,
     0x00, 0x0a, 0x00, 0x04, 0x00, 0x02, 0x00, 0x17, 0x00, 0x0b, 0x00, 0x02, 0x01, 0x00, 0x00, 0x16,
-    0x00, 0x00, 0x00, 0x17, 0x00, 0x00
+    0x00, 0x00, 0x00, 0x17, 0x00, 0x00, 0x00, 0x23, 0x00, 0x00
 };
 static unsigned char controlBuf[sizeof(predictedClientHello)];
 static size_t controlBufLen = 0;
@@ -1897,9 +1899,10 @@ static void * test0CAinitiateSslHandshake(void * arg)
     serverAddr.ifindex = 0;
 
     g_sslContextMutex = oc_mutex_new_recursive();
+    g_sslCryptoMutex = oc_mutex_new();
     oc_mutex_lock(g_sslContextMutex);
     g_caSslContext = (SslContext_t *)OICCalloc(1, sizeof(SslContext_t));
-    g_caSslContext->peerList = u_arraylist_create();
+    InitPeerTable();
     mbedtls_entropy_init(&g_caSslContext->entropy);
     mbedtls_ctr_drbg_init(&g_caSslContext->rnd);
     mbedtls_ctr_drbg_seed(&g_caSslContext->rnd, mbedtls_entropy_func_clutch,
@@ -1977,6 +1980,8 @@ static void * test0CAinitiateSslHandshake(void * arg)
     oc_mutex_unlock(g_sslContextMutex);
     oc_mutex_free(g_sslContextMutex);
     g_sslContextMutex = NULL;
+    oc_mutex_free(g_sslCryptoMutex);
+    g_sslCryptoMutex = NULL;
 
     socketClose();
 
@@ -2963,9 +2968,10 @@ TEST(TLSAdapter, Test_11)
     ASSERT_FALSE(socket_error) << "Server: socket error";
 
     g_sslContextMutex = oc_mutex_new_recursive();
+    g_sslCryptoMutex = oc_mutex_new();
     oc_mutex_lock(g_sslContextMutex);
     g_caSslContext = (SslContext_t *)OICCalloc(1, sizeof(SslContext_t));
-    g_caSslContext->peerList = u_arraylist_create();
+    InitPeerTable();
     mbedtls_entropy_init(&g_caSslContext->entropy);
     mbedtls_ctr_drbg_init(&g_caSslContext->rnd);
     mbedtls_ctr_drbg_seed(&g_caSslContext->rnd, mbedtls_entropy_func_clutch,
@@ -3055,3 +3061,154 @@ TEST(TLSAdapter, TestCertsValid)
     EXPECT_EQ(0, ret) << "Failed to parse CA cert";
     mbedtls_x509_crt_free(&cert);
 }
+
+static CAEndpoint_t ResumptionServer()
+{
+    CAEndpoint_t server;
+    memset(&server, 0, sizeof(server));
+    server.adapter = CA_ADAPTER_TCP;
+    server.flags = CA_SECURE;
+    server.port = 4433;
+    memcpy(server.addr, "127.0.0.1", sizeof("127.0.0.1"));
+    return server;
+}
+
+static void KeepSessionIdentity(const uint8_t *master, uint8_t idByte)
+{
+    SslEndPoint_t tep;
+    memset(&tep, 0, sizeof(tep));
+    memcpy(tep.master, master, sizeof(tep.master));
+    tep.sep.identity.id_length = 1;
+    tep.sep.identity.id[0] = idByte;
+    SaveSessionIdentity(&tep);
+}
+
+static void EvictSessionIdentities()
+{
+    uint8_t master[MASTER_SECRET_LEN] = { 0 };
+    for (size_t i = 0; i < SSL_SESSION_IDENTITIES; i++)
+    {
+        memcpy(master, &i, sizeof(i));
+        KeepSessionIdentity(master, 0);
+    }
+}
+
+static int LookUpCachedSession(const mbedtls_ssl_session *cached)
+{
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    session.ciphersuite = cached->ciphersuite;
+    session.compression = cached->compression;
+    session.id_len = cached->id_len;
+    memcpy(session.id, cached->id, cached->id_len);
+
+    int ret = GetCachedSession(&g_caSslContext->sessionCache, &session);
+    mbedtls_ssl_session_free(&session);
+    return ret;
+}
+
+TEST(TLSAdapter, ResumedSessionRestoresIdentity)
+{
+    ASSERT_EQ(CA_STATUS_OK, CAinitSslAdapter());
+    oc_mutex_lock(g_sslContextMutex);
+
+    uint8_t master[MASTER_SECRET_LEN];
+    memset(master, 0x11, sizeof(master));
+    KeepSessionIdentity(master, 0x42);
+
+    SslEndPoint_t tep;
+    memset(&tep, 0, sizeof(tep));
+    memcpy(tep.master, master, sizeof(tep.master));
+    EXPECT_TRUE(RestoreSessionIdentity(&tep));
+    EXPECT_EQ(1u, tep.sep.identity.id_length);
+    EXPECT_EQ(0x42, tep.sep.identity.id[0]);
+
+    oc_mutex_unlock(g_sslContextMutex);
+    CAdeinitSslAdapter();
+}
+
+TEST(TLSAdapter, CachedSessionWithEvictedIdentityIsNotResumed)
+{
+    ASSERT_EQ(CA_STATUS_OK, CAinitSslAdapter());
+    oc_mutex_lock(g_sslContextMutex);
+
+    mbedtls_ssl_session cached;
+    mbedtls_ssl_session_init(&cached);
+    cached.ciphersuite = MBEDTLS_TLS_ECDHE_PSK_WITH_AES_128_CBC_SHA256;
+    cached.id_len = 32;
+    memset(cached.id, 0x5a, cached.id_len);
+    memset(cached.master, 0x22, sizeof(cached.master));
+    ASSERT_EQ(0, mbedtls_ssl_cache_set(&g_caSslContext->sessionCache, &cached));
+
+    KeepSessionIdentity(cached.master, 0x42);
+    EXPECT_EQ(0, LookUpCachedSession(&cached));
+
+    // Full handshakes with other peers evict the identity, the session is still cached.
+    EvictSessionIdentities();
+    EXPECT_EQ(NULL, FindSessionIdentity(cached.master));
+    EXPECT_NE(0, LookUpCachedSession(&cached));
+
+    mbedtls_ssl_session_free(&cached);
+    oc_mutex_unlock(g_sslContextMutex);
+    CAdeinitSslAdapter();
+}
+
+TEST(TLSAdapter, SavedSessionWithEvictedIdentityIsNotOffered)
+{
+    ASSERT_EQ(CA_STATUS_OK, CAinitSslAdapter());
+    oc_mutex_lock(g_sslContextMutex);
+
+    CAEndpoint_t server = ResumptionServer();
+    SslEndPoint_t *tep = NewSslEndPoint(&server, &g_caSslContext->clientTlsConf);
+    ASSERT_TRUE(NULL != tep);
+
+    SslSavedSession_t *saved = &g_caSslContext->savedSessions[0];
+    mbedtls_ssl_session_init(&saved->session);
+    saved->session.ciphersuite = tep->ssl.conf->ciphersuite_list[MBEDTLS_SSL_MINOR_VERSION_3][0];
+    memset(saved->session.master, 0x33, sizeof(saved->session.master));
+    saved->endpoint = server;
+    saved->lastUse = ++g_caSslContext->sessionUse;
+    saved->valid = true;
+
+    KeepSessionIdentity(saved->session.master, 0x42);
+    EvictSessionIdentities();
+
+    ResumeSavedSession(tep);
+    EXPECT_FALSE(tep->offeredSession);
+    EXPECT_EQ(NULL, GetSavedSession(&server));
+
+    DeleteSslEndPoint(tep);
+    oc_mutex_unlock(g_sslContextMutex);
+    CAdeinitSslAdapter();
+}
+
+TEST(TLSAdapter, FailedResumptionDropsSavedSession)
+{
+    ASSERT_EQ(CA_STATUS_OK, CAinitSslAdapter());
+    oc_mutex_lock(g_sslContextMutex);
+
+    CAEndpoint_t server = ResumptionServer();
+    SslEndPoint_t *tep = NewSslEndPoint(&server, &g_caSslContext->clientTlsConf);
+    ASSERT_TRUE(NULL != tep);
+    ASSERT_TRUE(AddPeerToList(tep));
+
+    SslSavedSession_t *saved = &g_caSslContext->savedSessions[0];
+    mbedtls_ssl_session_init(&saved->session);
+    saved->session.ciphersuite = tep->ssl.conf->ciphersuite_list[MBEDTLS_SSL_MINOR_VERSION_3][0];
+    memset(saved->session.master, 0x44, sizeof(saved->session.master));
+    saved->endpoint = server;
+    saved->lastUse = ++g_caSslContext->sessionUse;
+    saved->valid = true;
+    KeepSessionIdentity(saved->session.master, 0x42);
+
+    ResumeSavedSession(tep);
+    EXPECT_TRUE(tep->offeredSession);
+    EXPECT_EQ(saved, GetSavedSession(&server));
+
+    // The handshake fails before it is over.
+    RemoveSslPeer(tep, false);
+    EXPECT_EQ(NULL, GetSavedSession(&server));
+
+    oc_mutex_unlock(g_sslContextMutex);
+    CAdeinitSslAdapter();
+}
@@ -0,0 +1,303 @@
+/* *****************************************************************
+ *
+ * Copyright 2017 IoTivity Project All Rights Reserved.
+ *
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+// Loopback benchmark of DTLS record encryption and decryption with many peers. The SSL
+// adapter holds both ends of every session: the client end is keyed by the server's
+// endpoint and the server end by the client's, and the send callback hands each datagram
+// to the other end. After the PSK handshakes, worker threads each own a share of the
+// sessions and send records through them. The record rate is reported for a growing
+// number of workers, once with every record serialized on one lock, as all of them
+// were behind the adapter's context mutex, and once with only the per-peer locks.
+// The reconnect benchmark closes every session and connects again, once with the saved
+// sessions and credentials dropped and once resuming the sessions.
+
+#include "iotivity_config.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ca_adapter_net_ssl.h"
+#include "oic_string.h"
+
+extern "C" void CAsetPskCredentialsCallback(CAgetPskCredentialsHandler credCallback);
+
+namespace
+{
+    const size_t PEERS = 64;
+    const size_t RECORDS = 100000;
+    const size_t PAYLOAD_SIZE = 256;
+    const uint16_t CLIENT_PORT_BASE = 20000;
+    const uint16_t SERVER_PORT_BASE = 30000;
+    const unsigned char IDENTITY[] = "6767676767676767";
+    const unsigned char PSK[] = "AAAAAAAAAAAAAAAA";
+
+    struct Datagram
+    {
+        CASecureEndpoint_t from;
+        std::vector<uint8_t> data;
+    };
+
+    // Datagrams in flight between the two ends of one session.
+    struct Link
+    {
+        std::mutex mutex;
+        std::deque<Datagram> datagrams;
+    };
+
+    Link g_links[PEERS];
+    std::atomic<size_t> g_received(0);
+
+    CAEndpoint_t makeEndpoint(uint16_t port)
+    {
+        CAEndpoint_t endpoint = CAEndpoint_t();
+        endpoint.adapter = CA_ADAPTER_IP;
+        endpoint.flags = (CATransportFlags_t)(CA_IPV4 | CA_SECURE);
+        endpoint.port = port;
+        OICStrcpy(endpoint.addr, sizeof(endpoint.addr), "127.0.0.1");
+        return endpoint;
+    }
+
+    int32_t getPskCredentials(CADtlsPskCredType_t type, const uint8_t *, size_t,
+                              uint8_t *result, size_t resultLength)
+    {
+        const unsigned char *credential = (CA_DTLS_PSK_IDENTITY == type) ? IDENTITY : PSK;
+        size_t length = sizeof(IDENTITY) - 1;
+        if (NULL == result || resultLength < length)
+        {
+            return -1;
+        }
+        memcpy(result, credential, length);
+        return (int32_t)length;
+    }
+
+    void getCredentialTypes(bool *list, const char *)
+    {
+        list[0] = true;
+    }
+
+    // A datagram sent to a server endpoint comes from the matching client and the other
+    // way round, so it is queued for the end keyed by the sender.
+    ssize_t onSend(CAEndpoint_t *endpoint, const void *data, size_t dataLength)
+    {
+        Datagram datagram;
+        datagram.from = CASecureEndpoint_t();
+        size_t peer = 0;
+        if (endpoint->port >= SERVER_PORT_BASE)
+        {
+            peer = endpoint->port - SERVER_PORT_BASE;
+            datagram.from.endpoint = makeEndpoint((uint16_t)(CLIENT_PORT_BASE + peer));
+        }
+        else
+        {
+            peer = endpoint->port - CLIENT_PORT_BASE;
+            datagram.from.endpoint = makeEndpoint((uint16_t)(SERVER_PORT_BASE + peer));
+        }
+        datagram.data.assign((const uint8_t *)data, (const uint8_t *)data + dataLength);
+
+        std::lock_guard<std::mutex> lock(g_links[peer].mutex);
+        g_links[peer].datagrams.push_back(datagram);
+        return (ssize_t)dataLength;
+    }
+
+    void onReceive(const CASecureEndpoint_t *, const void *, size_t)
+    {
+        ++g_received;
+    }
+
+    void onError(const CAEndpoint_t *, const void *, size_t, CAResult_t)
+    {
+    }
+
+    // Decrypts the datagrams queued for a session, outside the adapter's callbacks.
+    void deliver(size_t peer)
+    {
+        for (;;)
+        {
+            Datagram datagram;
+            {
+                std::lock_guard<std::mutex> lock(g_links[peer].mutex);
+                if (g_links[peer].datagrams.empty())
+                {
+                    return;
+                }
+                datagram = g_links[peer].datagrams.front();
+                g_links[peer].datagrams.pop_front();
+            }
+            CAdecryptSsl(&datagram.from, datagram.data.data(), datagram.data.size());
+        }
+    }
+
+    bool handshake()
+    {
+        // The first record of every client waits in the adapter for the handshake.
+        g_received = 0;
+        uint8_t hello[] = "hello";
+        for (size_t peer = 0; peer < PEERS; ++peer)
+        {
+            CAEndpoint_t server = makeEndpoint((uint16_t)(SERVER_PORT_BASE + peer));
+            if (CA_STATUS_OK != CAencryptSsl(&server, hello, sizeof(hello)))
+            {
+                return false;
+            }
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (g_received < PEERS && std::chrono::steady_clock::now() < deadline)
+        {
+            for (size_t peer = 0; peer < PEERS; ++peer)
+            {
+                deliver(peer);
+            }
+        }
+        return g_received == PEERS;
+    }
+
+    void dropDatagrams()
+    {
+        for (size_t peer = 0; peer < PEERS; ++peer)
+        {
+            std::lock_guard<std::mutex> lock(g_links[peer].mutex);
+            g_links[peer].datagrams.clear();
+        }
+    }
+
+    // Closes both ends of every session and drops the close_notify alerts in flight.
+    void closeAll()
+    {
+        for (size_t peer = 0; peer < PEERS; ++peer)
+        {
+            CAEndpoint_t server = makeEndpoint((uint16_t)(SERVER_PORT_BASE + peer));
+            CAEndpoint_t client = makeEndpoint((uint16_t)(CLIENT_PORT_BASE + peer));
+            CAcloseSslConnection(&server);
+            CAcloseSslConnection(&client);
+        }
+        dropDatagrams();
+    }
+
+    void reconnect(const char *name, bool invalidate)
+    {
+        closeAll();
+        if (invalidate)
+        {
+            CAsslInvalidateCredentials();
+        }
+
+        CASslHandshakeStats_t before;
+        CASslHandshakeStats_t after;
+        CAsslGetHandshakeStats(&before);
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_TRUE(handshake()) << "DTLS handshakes did not complete";
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        CAsslGetHandshakeStats(&after);
+
+        std::cout << name << ": peers=" << PEERS
+                  << " connections/s=" << PEERS / seconds
+                  << " full=" << after.full - before.full
+                  << " resumed=" << after.resumed - before.resumed << std::endl;
+    }
+
+    void measure(const char *name, size_t workers, std::mutex *serialize)
+    {
+        std::vector<uint8_t> payload(PAYLOAD_SIZE, 0x42);
+        std::vector<std::thread> threads;
+        size_t recordsPerWorker = RECORDS / workers;
+        g_received = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t worker = 0; worker < workers; ++worker)
+        {
+            threads.push_back(std::thread([&, worker]() {
+                for (size_t record = 0; record < recordsPerWorker; ++record)
+                {
+                    size_t peer = (worker + record * workers) % PEERS;
+                    CAEndpoint_t server = makeEndpoint((uint16_t)(SERVER_PORT_BASE + peer));
+                    std::unique_lock<std::mutex> lock;
+                    if (serialize)
+                    {
+                        lock = std::unique_lock<std::mutex>(*serialize);
+                    }
+                    CAencryptSsl(&server, payload.data(), payload.size());
+                    deliver(peer);
+                }
+            }));
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        std::cout << name << ": peers=" << PEERS << " workers=" << workers
+                  << " records/s=" << (recordsPerWorker * workers) / seconds
+                  << " received=" << g_received << "/" << recordsPerWorker * workers
+                  << std::endl;
+    }
+}
+
+TEST(SslPeerBenchmark, RecordsForManyPeers)
+{
+    ASSERT_EQ(CA_STATUS_OK, CAinitSslAdapter());
+    CAsetSslAdapterCallbacks(onReceive, onSend, onError, CA_ADAPTER_IP);
+    CAsetPskCredentialsCallback(getPskCredentials);
+    CAsetCredentialTypesCallback(getCredentialTypes);
+
+    ASSERT_TRUE(handshake()) << "DTLS handshakes did not complete";
+
+    // Workers own disjoint sessions: peer index modulo the number of workers.
+    std::mutex contextLock;
+    for (size_t workers = 1; workers <= 8; workers *= 2)
+    {
+        measure("single lock", workers, &contextLock);
+        measure("per-peer locks", workers, NULL);
+    }
+
+    CAdeinitSslAdapter();
+}
+
+TEST(SslPeerBenchmark, Reconnects)
+{
+    ASSERT_EQ(CA_STATUS_OK, CAinitSslAdapter());
+    CAsetSslAdapterCallbacks(onReceive, onSend, onError, CA_ADAPTER_IP);
+    CAsetPskCredentialsCallback(getPskCredentials);
+    CAsetCredentialTypesCallback(getCredentialTypes);
+    dropDatagrams();
+
+    ASSERT_TRUE(handshake()) << "DTLS handshakes did not complete";
+
+    // Both ends of a connection are counted.
+    reconnect("full handshakes", true);
+    reconnect("resumed handshakes", false);
+
+    CASslHandshakeStats_t stats;
+    CAsslGetHandshakeStats(&stats);
+    EXPECT_EQ(4 * PEERS, stats.full);
+    EXPECT_EQ(2 * PEERS, stats.resumed);
+
+    CAdeinitSslAdapter();
+}
@@ -0,0 +1,192 @@
+/* *****************************************************************
+ *
+ * Copyright 2017 IoTivity Project All Rights Reserved.
+ *
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+// Loopback benchmark of block-wise transfer over CoAP over TCP. The whole CA stack runs
+// in one process and sends POST requests with a large payload to its own TCP port. A
+// small request first lets both sides exchange their CSMs, then every large request is
+// timed until the request handler gets the reassembled payload. The transfer rate is
+// reported once with 1 Kbyte blocks and once with BERT blocks filling the peer's
+// Max-Message-Size.
+
+#include "iotivity_config.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "cainterface.h"
+#include "cautilinterface.h"
+#include "oic_string.h"
+
+namespace
+{
+    const size_t PAYLOAD_SIZE = 1024 * 1024;
+    const size_t REQUESTS = 20;
+    const uint32_t MAX_MESSAGE_SIZE = 65 * 1024;
+    const std::chrono::seconds WAIT_LIMIT(60);
+    const char URI[] = "/a/bert";
+
+    std::atomic<size_t> g_requests(0);
+    std::atomic<size_t> g_receivedBytes(0);
+    std::atomic<size_t> g_responses(0);
+    std::atomic<bool> g_stop(false);
+
+    void onRequest(const CAEndpoint_t *endpoint, const CARequestInfo_t *requestInfo)
+    {
+        g_receivedBytes += requestInfo->info.payloadSize;
+        ++g_requests;
+
+        CAResponseInfo_t responseInfo = CAResponseInfo_t();
+        responseInfo.result = CA_CHANGED;
+        responseInfo.info = requestInfo->info;
+        responseInfo.info.type = CA_MSG_NONCONFIRM;
+        responseInfo.info.payload = NULL;
+        responseInfo.info.payloadSize = 0;
+        responseInfo.info.options = NULL;
+        responseInfo.info.numOptions = 0;
+        responseInfo.info.resourceUri = NULL;
+        responseInfo.isMulticast = false;
+        CASendResponse(endpoint, &responseInfo);
+    }
+
+    void onResponse(const CAEndpoint_t *, const CAResponseInfo_t *)
+    {
+        ++g_responses;
+    }
+
+    void onError(const CAEndpoint_t *, const CAErrorInfo_t *)
+    {
+    }
+
+    template <typename Predicate>
+    bool waitFor(Predicate done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + WAIT_LIMIT;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    bool post(const CAEndpoint_t &server, std::vector<uint8_t> &payload)
+    {
+        CAToken_t token = NULL;
+        if (CA_STATUS_OK != CAGenerateToken(&token, CA_MAX_TOKEN_LEN))
+        {
+            return false;
+        }
+
+        CARequestInfo_t requestInfo = CARequestInfo_t();
+        requestInfo.method = CA_POST;
+        requestInfo.info.type = CA_MSG_NONCONFIRM;
+        requestInfo.info.token = token;
+        requestInfo.info.tokenLength = CA_MAX_TOKEN_LEN;
+        requestInfo.info.payload = payload.data();
+        requestInfo.info.payloadSize = payload.size();
+        requestInfo.info.payloadFormat = CA_FORMAT_APPLICATION_CBOR;
+        requestInfo.info.resourceUri = (CAURI_t)URI;
+
+        CAResult_t result = CASendRequest(&server, &requestInfo);
+        CADestroyToken(token);
+        return CA_STATUS_OK == result;
+    }
+
+    void measure(const char *name, bool bert)
+    {
+        ASSERT_EQ(CA_STATUS_OK, CASetTCPBlockWiseTransfer(MAX_MESSAGE_SIZE, bert));
+
+        caglobals.client = true;
+        caglobals.server = true;
+        caglobals.clientFlags = CA_IPV4;
+        caglobals.serverFlags = CA_IPV4;
+        caglobals.ports.tcp.u4 = 0;
+
+        ASSERT_EQ(CA_STATUS_OK, CAInitialize(CA_ADAPTER_TCP));
+        CARegisterHandler(onRequest, onResponse, onError);
+        ASSERT_EQ(CA_STATUS_OK, CASelectNetwork(CA_ADAPTER_TCP));
+        ASSERT_EQ(CA_STATUS_OK, CAStartListeningServer());
+
+        g_stop = false;
+        std::thread handler([]() {
+            while (!g_stop)
+            {
+                CAWaitForWakeup(10);
+                CAHandleRequestResponse();
+            }
+        });
+
+        CAEndpoint_t server = CAEndpoint_t();
+        server.adapter = CA_ADAPTER_TCP;
+        server.flags = CA_IPV4;
+        server.port = caglobals.tcp.ipv4.port;
+        OICStrcpy(server.addr, sizeof(server.addr), "127.0.0.1");
+
+        // The first exchange carries the CSMs, so the peer's capabilities are known after it.
+        g_requests = 0;
+        g_responses = 0;
+        std::vector<uint8_t> warmUp(16, 0x42);
+        EXPECT_TRUE(post(server, warmUp));
+        EXPECT_TRUE(waitFor([]() { return g_responses >= 1; }))
+            << "warm-up request was not answered";
+
+        std::vector<uint8_t> payload(PAYLOAD_SIZE, 0x42);
+        g_requests = 0;
+        g_receivedBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < REQUESTS; ++i)
+        {
+            size_t expected = i + 1;
+            EXPECT_TRUE(post(server, payload));
+            EXPECT_TRUE(waitFor([expected]() { return g_requests >= expected; }))
+                << "request " << i << " did not arrive";
+        }
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        std::cout << name << ": payload=" << PAYLOAD_SIZE << " requests=" << REQUESTS
+                  << " MB/s=" << (g_receivedBytes / (1024.0 * 1024.0)) / seconds
+                  << " ms/request=" << seconds * 1000 / REQUESTS
+                  << " received=" << g_receivedBytes << "/" << PAYLOAD_SIZE * REQUESTS
+                  << std::endl;
+
+        g_stop = true;
+        handler.join();
+        CATerminate();
+    }
+}
+
+TEST(TCPBertBenchmark, OneKbyteBlocks)
+{
+    measure("1 Kbyte blocks", false);
+}
+
+TEST(TCPBertBenchmark, BertBlocks)
+{
+    measure("BERT blocks", true);
+}
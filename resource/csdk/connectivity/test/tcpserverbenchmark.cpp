@@ -0,0 +1,216 @@
+/* *****************************************************************
+ *
+ * Copyright 2017 IoTivity Project All Rights Reserved.
+ *
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************/
+
+// Connection-scaling benchmark of the TCP server receive loop. N loopback sessions are
+// opened against the adapter's accept socket, then every session sends a burst of small
+// messages (throughput) and a sample of sessions sends one message at a time (latency).
+
+#include "iotivity_config.h"
+#include <gtest/gtest.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "catcpinterface.h"
+#include "cathreadpool.h"
+
+namespace
+{
+    const size_t SESSION_COUNTS[] = { 100, 1000, 5000, 20000 };
+    const size_t MESSAGES_PER_SESSION = 20;
+    const size_t LATENCY_SAMPLES = 200;
+    const std::chrono::seconds WAIT_LIMIT(60);
+
+    // Empty CoAP over TCP GET: length nibble 0, token length 0, code 0.01.
+    const unsigned char MESSAGE[] = { 0x00, 0x01 };
+
+    std::atomic<size_t> g_receivedBytes(0);
+    std::atomic<size_t> g_connected(0);
+    std::atomic<size_t> g_disconnected(0);
+
+    void onPacket(const CASecureEndpoint_t *, const void *, size_t dataLength)
+    {
+        g_receivedBytes += dataLength;
+    }
+
+    void onConnection(const CAEndpoint_t *, bool isConnected, bool)
+    {
+        if (isConnected)
+        {
+            ++g_connected;
+        }
+        else
+        {
+            ++g_disconnected;
+        }
+    }
+
+    template <typename Predicate>
+    bool waitFor(Predicate done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + WAIT_LIMIT;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    int connectLoopback(uint16_t port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        struct sockaddr_in addr = sockaddr_in();
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    bool sendMessage(int fd)
+    {
+        return sizeof(MESSAGE) == send(fd, MESSAGE, sizeof(MESSAGE), 0);
+    }
+
+    size_t sessionLimit()
+    {
+        // Both ends of every session live in this process.
+        struct rlimit limit;
+        if (0 != getrlimit(RLIMIT_NOFILE, &limit))
+        {
+            return 0;
+        }
+        if (limit.rlim_cur < limit.rlim_max)
+        {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+            getrlimit(RLIMIT_NOFILE, &limit);
+        }
+        return (limit.rlim_cur > 64) ? (size_t)(limit.rlim_cur - 64) / 2 : 0;
+    }
+}
+
+TEST(TCPServerBenchmark, ThroughputAndLatencyVersusSessionCount)
+{
+    ca_thread_pool_t threadPool = NULL;
+    ASSERT_EQ(CA_STATUS_OK, ca_thread_pool_init(2, &threadPool));
+
+    caglobals.tcp.ipv4.fd = OC_INVALID_SOCKET;
+    caglobals.tcp.ipv4s.fd = OC_INVALID_SOCKET;
+    caglobals.tcp.ipv6.fd = OC_INVALID_SOCKET;
+    caglobals.tcp.ipv6s.fd = OC_INVALID_SOCKET;
+    caglobals.tcp.ipv4.port = 0;
+    caglobals.tcp.ipv4s.port = 0;
+    caglobals.tcp.ipv6.port = 0;
+    caglobals.tcp.ipv6s.port = 0;
+    caglobals.tcp.selectTimeout = 1;
+    caglobals.tcp.listenBacklog = SOMAXCONN;
+
+    CATCPSetPacketReceiveCallback(onPacket);
+    CATCPSetConnectionChangedCallback(onConnection);
+    ASSERT_EQ(CA_STATUS_OK, CATCPStartServer(threadPool));
+    uint16_t port = caglobals.tcp.ipv4.port;
+    ASSERT_NE(0, port);
+
+    size_t limit = sessionLimit();
+    for (size_t sessionCount : SESSION_COUNTS)
+    {
+        if (sessionCount > limit)
+        {
+            std::cout << "sessions=" << sessionCount << " skipped, open file limit allows "
+                      << limit << std::endl;
+            continue;
+        }
+
+        g_connected = 0;
+        g_disconnected = 0;
+        g_receivedBytes = 0;
+
+        std::vector<int> clients;
+        for (size_t i = 0; i < sessionCount; ++i)
+        {
+            int fd = connectLoopback(port);
+            ASSERT_LE(0, fd);
+            clients.push_back(fd);
+        }
+        ASSERT_TRUE(waitFor([&] { return g_connected == sessionCount; }));
+
+        size_t expected = sessionCount * MESSAGES_PER_SESSION * sizeof(MESSAGE);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < MESSAGES_PER_SESSION; ++round)
+        {
+            for (int fd : clients)
+            {
+                ASSERT_TRUE(sendMessage(fd));
+            }
+        }
+        ASSERT_TRUE(waitFor([&] { return g_receivedBytes == expected; }));
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        size_t samples = std::min(sessionCount, LATENCY_SAMPLES);
+        size_t stride = sessionCount / samples;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < samples; ++i)
+        {
+            ASSERT_TRUE(sendMessage(clients[i * stride]));
+            expected += sizeof(MESSAGE);
+            ASSERT_TRUE(waitFor([&] { return g_receivedBytes == expected; }));
+        }
+        double latency = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count() / samples;
+
+        std::cout << "sessions=" << sessionCount
+                  << " messages/s=" << (sessionCount * MESSAGES_PER_SESSION) / seconds
+                  << " latency=" << latency << "us" << std::endl;
+
+        for (int fd : clients)
+        {
+            close(fd);
+        }
+        ASSERT_TRUE(waitFor([&] { return g_disconnected == sessionCount; }));
+    }
+
+    CATCPStopServer();
+    ca_thread_pool_free(threadPool);
+}
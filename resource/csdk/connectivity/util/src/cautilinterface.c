@@ -24,6 +24,9 @@
 #include "cautilinterface.h"
 #include "cainterfacecontroller.h"
 #include "cacommon.h"
+#ifdef TCP_ADAPTER
+#include "caprotocolmessage.h"
+#endif
 #include "experimental/logger.h"
 
 #if defined(TCP_ADAPTER) && defined(WITH_CLOUD)
@@ -197,6 +200,69 @@ uint16_t CAGetAssignedPortNumber(CATransportAdapter_t adapter, CATransportFlags_
     return 0;
 }
 
+CAResult_t CASetThreadPoolSize(int32_t size)
+{
+    OIC_LOG_V(DEBUG, TAG, "CASetThreadPoolSize %d", size);
+
+    if (0 >= size)
+    {
+        return CA_STATUS_INVALID_PARAM;
+    }
+
+    caglobals.threadPoolSize = size;
+    return CA_STATUS_OK;
+}
+
+CAResult_t CASetDispatchShardCount(int32_t count)
+{
+    OIC_LOG_V(DEBUG, TAG, "CASetDispatchShardCount %d", count);
+
+    if (0 > count)
+    {
+        return CA_STATUS_INVALID_PARAM;
+    }
+
+    caglobals.dispatchShardCount = count;
+    return CA_STATUS_OK;
+}
+
+CAResult_t CASetQBlockTransfer(bool enable)
+{
+    OIC_LOG_V(DEBUG, TAG, "CASetQBlockTransfer %d", enable);
+
+    caglobals.ca.qBlockEnabled = enable;
+    return CA_STATUS_OK;
+}
+
+#ifdef TCP_ADAPTER
+CAResult_t CASetTCPConnectTimeout(int timeout)
+{
+    OIC_LOG_V(DEBUG, TAG, "CASetTCPConnectTimeout %d", timeout);
+
+    if (0 >= timeout)
+    {
+        return CA_STATUS_INVALID_PARAM;
+    }
+
+    caglobals.tcp.connectTimeout = timeout;
+    return CA_STATUS_OK;
+}
+
+CAResult_t CASetTCPBlockWiseTransfer(uint32_t maxMessageSize, bool bert)
+{
+    OIC_LOG_V(DEBUG, TAG, "CASetTCPBlockWiseTransfer %" PRIu32 " %d", maxMessageSize, bert);
+
+    if (CA_DEFAULT_MAX_MESSAGE_SIZE > maxMessageSize)
+    {
+        return CA_STATUS_INVALID_PARAM;
+    }
+
+    caglobals.tcp.maxMessageSize = maxMessageSize;
+    caglobals.tcp.bertDisabled = !bert;
+    return CA_STATUS_OK;
+}
+#endif
+
 #if defined(TCP_ADAPTER) && defined(WITH_CLOUD)
 CAResult_t CAUtilCMInitailize()
 {
@@ -1160,9 +1160,10 @@ typedef void * OCRequestHandle;
  * Unique identifier for each observation request. Used when observations are
  * registered or de-registered. Used by entity handler to signal specific
  * observers to be notified of resource changes.
- * There can be maximum of 256 observations per server.
+ * While a server has fewer than 128 observations, new IDs are below 256 so that
+ * bindings that still carry 8 bit IDs keep working.
  */
-typedef uint8_t OCObservationId;
+typedef uint32_t OCObservationId;
 
 /**
  * Sequence number is a 24 bit field,
@@ -1441,7 +1442,9 @@ typedef enum
     /** The payload is an OCDiagnosticPayload */
     PAYLOAD_TYPE_DIAGNOSTIC,
     /** The payload is an OCIntrospectionPayload */
-    PAYLOAD_TYPE_INTROSPECTION
+    PAYLOAD_TYPE_INTROSPECTION,
+    /** The payload is an OCEncodedPayload */
+    PAYLOAD_TYPE_ENCODED
 } OCPayloadType;
 
 /**
@@ -1613,6 +1616,26 @@ typedef struct
     OCByteString cborPayload;
 } OCIntrospectionPayload;
 
+/**
+ * A representation payload that is carried in its CBOR encoding.  The stack sends and
+ * receives the bytes as they are, so that a caller with its own codec (like the C++
+ * OCRepresentation) does not have to go through an intermediate OCRepPayload.
+ */
+typedef bool (*OCPayloadProducer)(void *context, size_t offset, uint8_t *buffer, size_t length);
+typedef void (*OCPayloadRelease)(void *context);
+
+typedef struct
+{
+    OCPayload base;
+    OCByteString cborPayload;
+    /** If set, cborPayload.bytes is NULL and the cborPayload.len bytes are produced part by
+     *  part when the payload is sent, see OCEncodedPayloadCreateProduced. */
+    OCPayloadProducer producer;
+    void *producerContext;
+    /** Called with producerContext once no part is produced any more. */
+    OCPayloadRelease release;
+} OCEncodedPayload;
+
 /**
  * Incoming requests handled by the server. Requests are passed in as a parameter to the
  * OCEntityHandler callback API.
@@ -1818,6 +1841,43 @@ typedef struct OCCallbackData
 #endif // __cplusplus
 } OCCallbackData;
 
+/**
+ * A block of a request or response payload, delivered to an ::OCBlockDataHandler as it is
+ * received.
+ */
+typedef struct
+{
+    /** Handle of the request for a response, NULL for a request. */
+    OCDoHandle handle;
+
+    /** Resource the request is for, NULL for a response. */
+    OCResourceHandle resource;
+
+    /** Address of the remote endpoint. */
+    OCDevAddr devAddr;
+
+    /** Offset of the block in the payload. */
+    size_t offset;
+
+    /** Payload of the block. */
+    const uint8_t *data;
+
+    /** Length of the block. */
+    size_t length;
+
+    /** Length of the whole payload if the remote endpoint gave it, 0 otherwise. */
+    size_t totalLength;
+} OCBlockData;
+
+/**
+ * Applications implement this callback to get the payload of a block-wise transfer block by
+ * block instead of reassembled.  It is called from the receive thread, first with offset 0.
+ * If it returns true, it gets the following blocks and the response or entity handler then
+ * gets the message without a payload.  If it returns false, the payload is reassembled as
+ * usual.  A transfer that is restarted is offered again from offset 0.
+ */
+typedef bool (*OCBlockDataHandler)(const OCBlockData *block, void *context);
+
 /**
  * Application server implementations must implement this callback to consume requests OTA.
  * Entity handler callback needs to fill the resPayload of the entityHandlerRequest.
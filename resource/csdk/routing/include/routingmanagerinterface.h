@@ -77,7 +77,7 @@ OCStackResult RMSendResponse(const OCServerRequest *request, const OCRepPayload
  * @param[in]   payload   Payload containing Gateway Entries.
  * @return  ::OC_STACK_OK or Appropriate error code.
  */
-OCStackResult RMSendNotificationForListofObservers(OCObservationId *obsId, uint8_t obsLen,
+OCStackResult RMSendNotificationForListofObservers(OCObservationId *obsId, size_t obsLen,
                                                    const OCRepPayload *payload);
 
 /**
@@ -202,7 +202,7 @@ OCStackResult RMSendResponse(const OCServerRequest *request, const OCRepPayload
     return OCDoResponse(&response);
 }
 
-OCStackResult RMSendNotificationForListofObservers(OCObservationId *obsId, uint8_t obsLen,
+OCStackResult RMSendNotificationForListofObservers(OCObservationId *obsId, size_t obsLen,
                                                    const OCRepPayload *payload)
 {
     OIC_LOG(DEBUG, TAG, "RMSendNotificationForListofObservers IN");
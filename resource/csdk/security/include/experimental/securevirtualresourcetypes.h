@@ -176,6 +176,8 @@ typedef struct OicSecRsrc OicSecRsrc_t;
 
 typedef struct OicSecValidity OicSecValidity_t;
 
+typedef struct OicSecValidityCache OicSecValidityCache_t;
+
 typedef struct OicSecAce OicSecAce_t;
 
 typedef struct OicSecAcl OicSecAcl_t;
@@ -513,6 +515,7 @@ struct OicSecAce
     OicSecRsrc_t *resources;            // 1:R:M:Y:Resource
     uint16_t permission;                // 2:R:S:Y:UINT16
     OicSecValidity_t *validities;       // 3:R:M:N:Time-interval
+    OicSecValidityCache_t *validityCache; // validities compiled by the policy engine
     uint16_t aceid;                     // mandatory in ACE2
 #ifdef MULTIPLE_OWNER
     OicUuid_t* eownerID;                //4:R:S:N:oic.uuid
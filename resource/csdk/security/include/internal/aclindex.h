@@ -0,0 +1,135 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#ifndef IOTVT_SRM_ACL_INDEX_H
+#define IOTVT_SRM_ACL_INDEX_H
+
+#include "ocstack.h"
+#include "experimental/securevirtualresourcetypes.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Lookup structure over the ACEs of an ACL. ACEs are grouped by subject (UUID, role or
+ * conntype), and within a subject by the hrefs and wildcards of their resources, so the
+ * ACEs that can apply to a request are found without walking the ACL.
+ *
+ * The index points into the ACL it was built from and has to be rebuilt whenever the ACL
+ * changes.
+ */
+typedef struct OicSecACLIndex OicSecACLIndex_t;
+
+/**
+ * The ACEs of one subject in an @ref OicSecACLIndex_t.
+ */
+typedef struct OicSecACLIndexSubject OicSecACLIndexSubject_t;
+
+/**
+ * Iterates over the ACEs of one subject that name one resource.
+ * Initialize with @ref InitACECursor.
+ */
+typedef struct OicSecACECursor
+{
+    const OicSecAce_t * const *aces[3];  // ACEs naming the href, then matching wildcards
+    size_t counts[3];
+    size_t list;
+    size_t pos;
+} OicSecACECursor_t;
+
+/**
+ * Build the index of an ACL.
+ *
+ * @param acl ACL to index. It must outlive the index and not change while the index is used.
+ *
+ * @return the index, or NULL on allocation failure.
+ */
+OicSecACLIndex_t *CreateACLIndex(const OicSecAcl_t *acl);
+
+/**
+ * Free an index created by @ref CreateACLIndex.
+ *
+ * @param index Index to free; may be NULL.
+ */
+void DeleteACLIndex(OicSecACLIndex_t *index);
+
+/**
+ * Find the ACEs whose subject is a UUID.
+ *
+ * @return the subject, or NULL if no ACE has it.
+ */
+const OicSecACLIndexSubject_t *FindACLIndexSubjectByUuid(const OicSecACLIndex_t *index,
+                                                         const OicUuid_t *uuid);
+
+/**
+ * Find the ACEs whose subject is a role.
+ *
+ * @return the subject, or NULL if no ACE has it.
+ */
+const OicSecACLIndexSubject_t *FindACLIndexSubjectByRole(const OicSecACLIndex_t *index,
+                                                         const OicSecRole_t *role);
+
+/**
+ * Find the ACEs whose subject is a conntype.
+ *
+ * @return the subject, or NULL if no ACE has it.
+ */
+const OicSecACLIndexSubject_t *FindACLIndexSubjectByConntype(const OicSecACLIndex_t *index,
+                                                             OicSecConntype_t conntype);
+
+/**
+ * Get the ACE of a subject that comes last in the ACL.
+ *
+ * @param[in] subject Subject found in the index.
+ * @param[out] order Position of the ACE in the ACL, to compare ACEs of different subjects.
+ *
+ * @return the ACE.
+ */
+const OicSecAce_t *GetACLIndexSubjectLastACE(const OicSecACLIndexSubject_t *subject,
+                                             size_t *order);
+
+/**
+ * Start iterating over the ACEs of a subject that name a resource, by href or by a wildcard
+ * matching the resource's discoverability. An ACE may be returned more than once.
+ *
+ * @param[out] cursor Cursor to initialize.
+ * @param[in] index Index the subject was found in.
+ * @param[in] subject Subject whose ACEs to return.
+ * @param[in] href URI of the resource.
+ * @param[in] discoverable Discoverability of the resource.
+ */
+void InitACECursor(OicSecACECursor_t *cursor, const OicSecACLIndex_t *index,
+                   const OicSecACLIndexSubject_t *subject, const char *href,
+                   OicSecDiscoverable_t discoverable);
+
+/**
+ * Get the next ACE of a cursor.
+ *
+ * @return the ACE, or NULL when there are no more.
+ */
+const OicSecAce_t *GetNextACE(OicSecACECursor_t *cursor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOTVT_SRM_ACL_INDEX_H
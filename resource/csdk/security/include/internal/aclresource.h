@@ -21,6 +21,8 @@
 #ifndef IOTVT_SRM_ACLR_H
 #define IOTVT_SRM_ACLR_H
 
+#include "aclindex.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -78,6 +80,16 @@ const OicSecAce_t* GetACLResourceDataByRoles(const OicSecRole_t *roles, size_t r
  */
 const OicSecAce_t* GetACLResourceDataByConntype(const OicSecConntype_t conntype, OicSecAce_t **savePtr);
 
+/**
+ * This method is used by PolicyEngine to look up the ACEs that apply to a request without
+ * walking the ACL. The index is rebuilt on the first call after the ACL changed.
+ *
+ * @note The index is only valid until the ACL changes.
+ *
+ * @return reference to @ref OicSecACLIndex_t, or NULL if there is no ACL or no memory.
+ */
+const OicSecACLIndex_t* GetACLIndex();
+
 /**
  * This function converts ACL data into CBOR format.
  *
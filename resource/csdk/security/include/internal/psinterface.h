@@ -21,6 +21,10 @@
 #ifndef IOTVT_SRM_PSI_H
 #define IOTVT_SRM_PSI_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Reads the database from PS
  *
@@ -103,4 +107,35 @@ OCStackResult ResetSecureResourceInPS(void);
  */
 OCStackResult CreateResetProfile(void);
 
+/**
+ * Turns journaling of database updates on or off.
+ *
+ * @param enabled     if true, updates are appended to a journal next to each database
+ *                    instead of rewriting the database.
+ * @param coalesceMs  is the time updates are held back in memory before they are appended,
+ *                    so that updates in quick succession are written together. 0 appends
+ *                    every update as it is made.
+ *
+ * @return ::OC_STACK_OK for Success, otherwise some error value
+ */
+OCStackResult SetPSJournal(bool enabled, uint32_t coalesceMs);
+
+/**
+ * Appends the updates held back in the coalescing window to the journals.
+ *
+ * @param force  if false, updates are only appended once the window has passed.
+ */
+void FlushPendingPSUpdates(bool force);
+
+/**
+ * Gets the time until the updates held back in the coalescing window are due.
+ *
+ * @return the time in milliseconds, or UINT32_MAX if no update is held back.
+ */
+uint32_t GetPSFlushTimeout(void);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif //IOTVT_SRM_PSI_H
@@ -42,6 +42,7 @@ extern "C"
 
 typedef struct IotvtICalRecur IotvtICalRecur_t;
 typedef struct IotvtICalPeriod IotvtICalPeriod_t;
+typedef struct IotvtICalRule IotvtICalRule_t;
 
 /**
  *  date-time  = date "T" time.
@@ -136,6 +137,17 @@ struct IotvtICalRecur
     IotvtICalWeekdayBM_t    byDay;
 };
 
+/**
+ * A period and its optional recurrence rule, parsed once so that they can be checked
+ * against the current time without parsing the strings again.
+ */
+struct IotvtICalRule
+{
+    IotvtICalPeriod_t       period;
+    IotvtICalRecur_t        recur;
+    bool                    hasRecur;
+};
+
 /**
  * This API is used by policy engine to checks if the
  * request to access resource is within valid time.
@@ -160,6 +172,45 @@ struct IotvtICalRecur
  */
 IotvtICalResult_t IsRequestWithinValidTime(const char *period, const char *recur);
 
+/**
+ * Parses a period and an optional recurrence rule into a @ref IotvtICalRule_t.
+ *
+ * @param period string representing period.
+ * @param recur string representing recurrence rule, or NULL.
+ * @param rule IotvtICalRule_t struct to be populated.
+ *
+ * @return ::IOTVTICAL_SUCCESS, if no error while parsing.
+ * ::IOTVTICAL_INVALID_PARAMETER, if parameter are invalid
+ * ::IOTVTICAL_INVALID_PERIOD, if period string has invalid format
+ * ::IOTVTICAL_INVALID_RRULE, if rrule string has invalid format.
+ */
+IotvtICalResult_t CompileValidTime(const char *period, const char *recur, IotvtICalRule_t *rule);
+
+/**
+ * Checks a rule compiled by @ref CompileValidTime against a local time.
+ *
+ * @param rule compiled period and recurrence rule.
+ * @param currentTime local time to check.
+ *
+ * @return ::IOTVTICAL_VALID_ACCESS, if currentTime is within valid time period
+ * ::IOTVTICAL_INVALID_ACCESS, if currentTime is not within valid time period
+ * ::IOTVTICAL_INVALID_PARAMETER, if parameter are invalid
+ */
+IotvtICalResult_t IsTimeWithinValidRule(const IotvtICalRule_t *rule,
+                                        const IotvtICalDateTime_t *currentTime);
+
+/**
+ * Computes how long the result of @ref IsTimeWithinValidRule stays the same.
+ *
+ * @param rule compiled period and recurrence rule.
+ * @param now current time.
+ * @param currentTime now as local time.
+ *
+ * @return the earliest time after now at which the result for rule may change.
+ */
+time_t GetValidRuleNextBoundary(const IotvtICalRule_t *rule, time_t now,
+                                const IotvtICalDateTime_t *currentTime);
+
 /**
  * Parses periodStr and populate struct IotvtICalPeriod_t.
  *
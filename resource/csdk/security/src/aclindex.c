@@ -0,0 +1,471 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <string.h>
+#include <stdint.h>
+
+#include "utlist.h"
+#include "oic_malloc.h"
+#include "ochashtable.h"
+#include "experimental/logger.h"
+#include "aclindex.h"
+#include "srmresourcestrings.h"
+
+#define TAG "OIC_SRM_ACL_INDEX"
+
+/** Fewest buckets a table of the index gets; always a power of two. */
+#define ACL_INDEX_MIN_BUCKETS (8)
+
+/** A growable array of ACE pointers, in ACL order. */
+typedef struct AceList
+{
+    const OicSecAce_t **aces;
+    size_t count;
+    size_t capacity;
+} AceList_t;
+
+struct OicSecACLIndexSubject
+{
+    OCHashLink link;                    // carries the hash of the subject
+    const OicSecAce_t *key;             // first ACE with this subject
+    const OicSecAce_t *lastAce;
+    size_t lastOrder;
+    AceList_t wildcards[ALL_RESOURCES + 1];  // indexed by OicSecAceResourceWildcard_t
+};
+
+/** The ACEs of one subject that name one href. */
+typedef struct ACLIndexHref
+{
+    OCHashLink link;
+    const OicSecACLIndexSubject_t *subject;
+    const char *href;                   // owned by the ACL
+    AceList_t aces;
+} ACLIndexHref_t;
+
+struct OicSecACLIndex
+{
+    OCHashTable subjects;
+    OCHashTable hrefs;
+};
+
+static uint32_t HashString(uint32_t hash, const char *str)
+{
+    // Include the terminator so that "ab" + "c" and "a" + "bc" differ.
+    return OCHashBytes(OCHashString(hash, str), "", 1);
+}
+
+static uint32_t HashUuidSubject(const OicUuid_t *uuid)
+{
+    uint8_t type = OicSecAceUuidSubject;
+    return OCHashBytes(OCHashBytes(OC_HASH_INIT, &type, 1), uuid->id, sizeof(uuid->id));
+}
+
+static uint32_t HashRoleSubject(const OicSecRole_t *role)
+{
+    uint8_t type = OicSecAceRoleSubject;
+    uint32_t hash = OCHashBytes(OC_HASH_INIT, &type, 1);
+    hash = HashString(hash, role->id);
+    return HashString(hash, role->authority);
+}
+
+static uint32_t HashConntypeSubject(OicSecConntype_t conntype)
+{
+    uint8_t type = OicSecAceConntypeSubject;
+    uint8_t conn = (uint8_t)conntype;
+    return OCHashBytes(OCHashBytes(OC_HASH_INIT, &type, 1), &conn, 1);
+}
+
+static uint32_t HashSubject(const OicSecAce_t *ace)
+{
+    switch (ace->subjectType)
+    {
+        case OicSecAceRoleSubject:
+            return HashRoleSubject(&ace->subjectRole);
+        case OicSecAceConntypeSubject:
+            return HashConntypeSubject(ace->subjectConn);
+        case OicSecAceUuidSubject:
+        default:
+            return HashUuidSubject(&ace->subjectuuid);
+    }
+}
+
+static uint32_t HashHref(const OicSecACLIndexSubject_t *subject, const char *href)
+{
+    return HashString(subject->link.hash, href);
+}
+
+/** Same subject comparison as the GetACLResourceData* walks. */
+static bool IsSameSubject(const OicSecAce_t *a, const OicSecAce_t *b)
+{
+    if (a->subjectType != b->subjectType)
+    {
+        return false;
+    }
+    switch (a->subjectType)
+    {
+        case OicSecAceRoleSubject:
+            return (0 == strcmp(a->subjectRole.id, b->subjectRole.id)) &&
+                   (0 == strcmp(a->subjectRole.authority, b->subjectRole.authority));
+        case OicSecAceConntypeSubject:
+            return a->subjectConn == b->subjectConn;
+        case OicSecAceUuidSubject:
+        default:
+            return 0 == memcmp(&a->subjectuuid, &b->subjectuuid, sizeof(OicUuid_t));
+    }
+}
+
+static size_t BucketCountFor(size_t count)
+{
+    size_t buckets = ACL_INDEX_MIN_BUCKETS;
+    while (buckets < count)
+    {
+        buckets <<= 1;
+    }
+    return buckets;
+}
+
+static bool AppendAce(AceList_t *list, const OicSecAce_t *ace)
+{
+    // An ACE naming a resource twice only needs to be listed once.
+    if (list->count && list->aces[list->count - 1] == ace)
+    {
+        return true;
+    }
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 2;
+        const OicSecAce_t **aces = (const OicSecAce_t **)OICRealloc((void *)list->aces,
+                                                                   capacity * sizeof(*aces));
+        if (NULL == aces)
+        {
+            return false;
+        }
+        list->aces = aces;
+        list->capacity = capacity;
+    }
+    list->aces[list->count++] = ace;
+    return true;
+}
+
+static OicSecACLIndexSubject_t *FindSubjectWithHash(const OicSecACLIndex_t *index,
+                                                    uint32_t hash, const OicSecAce_t *key)
+{
+    for (OCHashLink *link = OCHashTableFirst(&index->subjects, hash); link;
+         link = OCHashTableNext(link))
+    {
+        OicSecACLIndexSubject_t *subject = OC_HASH_ENTRY(link, OicSecACLIndexSubject_t, link);
+        if (IsSameSubject(subject->key, key))
+        {
+            return subject;
+        }
+    }
+    return NULL;
+}
+
+static OicSecACLIndexSubject_t *AddSubject(OicSecACLIndex_t *index, const OicSecAce_t *ace)
+{
+    uint32_t hash = HashSubject(ace);
+    OicSecACLIndexSubject_t *subject = FindSubjectWithHash(index, hash, ace);
+    if (subject)
+    {
+        return subject;
+    }
+
+    subject = (OicSecACLIndexSubject_t *)OICCalloc(1, sizeof(OicSecACLIndexSubject_t));
+    if (NULL == subject)
+    {
+        return NULL;
+    }
+    subject->key = ace;
+    if (!OCHashTableInsert(&index->subjects, &subject->link, hash))
+    {
+        OICFree(subject);
+        return NULL;
+    }
+    return subject;
+}
+
+static const ACLIndexHref_t *FindHref(const OicSecACLIndex_t *index,
+                                      const OicSecACLIndexSubject_t *subject, const char *href)
+{
+    for (OCHashLink *link = OCHashTableFirst(&index->hrefs, HashHref(subject, href)); link;
+         link = OCHashTableNext(link))
+    {
+        const ACLIndexHref_t *entry = OC_HASH_ENTRY(link, ACLIndexHref_t, link);
+        if (entry->subject == subject && 0 == strcmp(entry->href, href))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static ACLIndexHref_t *AddHref(OicSecACLIndex_t *index, const OicSecACLIndexSubject_t *subject,
+                               const char *href)
+{
+    ACLIndexHref_t *entry = (ACLIndexHref_t *)FindHref(index, subject, href);
+    if (entry)
+    {
+        return entry;
+    }
+
+    entry = (ACLIndexHref_t *)OICCalloc(1, sizeof(ACLIndexHref_t));
+    if (NULL == entry)
+    {
+        return NULL;
+    }
+    entry->subject = subject;
+    entry->href = href;
+    if (!OCHashTableInsert(&index->hrefs, &entry->link, HashHref(subject, href)))
+    {
+        OICFree(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/** Same resource matching as IsResourceInAce() in the policy engine. */
+static bool IndexResource(OicSecACLIndex_t *index, OicSecACLIndexSubject_t *subject,
+                          const OicSecAce_t *ace, const OicSecRsrc_t *rsrc)
+{
+    if (NULL == rsrc->href)
+    {
+        if (NO_WILDCARD == rsrc->wildcard)
+        {
+            return true;
+        }
+        return AppendAce(&subject->wildcards[rsrc->wildcard], ace);
+    }
+    if (0 == strcmp(WILDCARD_RESOURCE_URI, rsrc->href))
+    {
+        return AppendAce(&subject->wildcards[ALL_RESOURCES], ace);
+    }
+
+    ACLIndexHref_t *entry = AddHref(index, subject, rsrc->href);
+    return entry && AppendAce(&entry->aces, ace);
+}
+
+OicSecACLIndex_t *CreateACLIndex(const OicSecAcl_t *acl)
+{
+    if (NULL == acl)
+    {
+        return NULL;
+    }
+
+    size_t aceCount = 0;
+    size_t rsrcCount = 0;
+    const OicSecAce_t *ace = NULL;
+    LL_FOREACH(acl->aces, ace)
+    {
+        const OicSecRsrc_t *rsrc = NULL;
+        LL_FOREACH(ace->resources, rsrc)
+        {
+            rsrcCount++;
+        }
+        aceCount++;
+    }
+
+    OicSecACLIndex_t *index = (OicSecACLIndex_t *)OICCalloc(1, sizeof(OicSecACLIndex_t));
+    if (NULL == index)
+    {
+        goto error;
+    }
+    // Sized for the whole ACL up front, so the tables never grow while it is indexed.
+    OCHashTableInit(&index->subjects, BucketCountFor(aceCount));
+    OCHashTableInit(&index->hrefs, BucketCountFor(rsrcCount));
+
+    size_t order = 0;
+    LL_FOREACH(acl->aces, ace)
+    {
+        OicSecACLIndexSubject_t *subject = AddSubject(index, ace);
+        if (NULL == subject)
+        {
+            goto error;
+        }
+        subject->lastAce = ace;
+        subject->lastOrder = order++;
+
+        const OicSecRsrc_t *rsrc = NULL;
+        LL_FOREACH(ace->resources, rsrc)
+        {
+            if (!IndexResource(index, subject, ace, rsrc))
+            {
+                goto error;
+            }
+        }
+    }
+
+    OIC_LOG_V(DEBUG, TAG, "%s: indexed %zu ACEs", __func__, aceCount);
+    return index;
+
+error:
+    OIC_LOG(ERROR, TAG, "Failed to allocate ACL index");
+    DeleteACLIndex(index);
+    return NULL;
+}
+
+void DeleteACLIndex(OicSecACLIndex_t *index)
+{
+    if (NULL == index)
+    {
+        return;
+    }
+
+    OCHashLink *link = NULL;
+    while (NULL != (link = OCHashTablePop(&index->subjects)))
+    {
+        OicSecACLIndexSubject_t *subject = OC_HASH_ENTRY(link, OicSecACLIndexSubject_t, link);
+        for (size_t w = 0; w <= ALL_RESOURCES; w++)
+        {
+            OICFree((void *)subject->wildcards[w].aces);
+        }
+        OICFree(subject);
+    }
+    while (NULL != (link = OCHashTablePop(&index->hrefs)))
+    {
+        ACLIndexHref_t *entry = OC_HASH_ENTRY(link, ACLIndexHref_t, link);
+        OICFree((void *)entry->aces.aces);
+        OICFree(entry);
+    }
+    OCHashTableClear(&index->subjects);
+    OCHashTableClear(&index->hrefs);
+    OICFree(index);
+}
+
+static const OicSecACLIndexSubject_t *FindSubject(const OicSecACLIndex_t *index,
+                                                  const OicSecAce_t *key)
+{
+    if (NULL == index)
+    {
+        return NULL;
+    }
+
+    return FindSubjectWithHash(index, HashSubject(key), key);
+}
+
+const OicSecACLIndexSubject_t *FindACLIndexSubjectByUuid(const OicSecACLIndex_t *index,
+                                                         const OicUuid_t *uuid)
+{
+    if (NULL == uuid)
+    {
+        return NULL;
+    }
+
+    OicSecAce_t key;
+    memset(&key, 0, sizeof(key));
+    key.subjectType = OicSecAceUuidSubject;
+    memcpy(&key.subjectuuid, uuid, sizeof(OicUuid_t));
+    return FindSubject(index, &key);
+}
+
+const OicSecACLIndexSubject_t *FindACLIndexSubjectByRole(const OicSecACLIndex_t *index,
+                                                         const OicSecRole_t *role)
+{
+    if (NULL == role)
+    {
+        return NULL;
+    }
+
+    OicSecAce_t key;
+    memset(&key, 0, sizeof(key));
+    key.subjectType = OicSecAceRoleSubject;
+    memcpy(&key.subjectRole, role, sizeof(OicSecRole_t));
+    return FindSubject(index, &key);
+}
+
+const OicSecACLIndexSubject_t *FindACLIndexSubjectByConntype(const OicSecACLIndex_t *index,
+                                                             OicSecConntype_t conntype)
+{
+    OicSecAce_t key;
+    memset(&key, 0, sizeof(key));
+    key.subjectType = OicSecAceConntypeSubject;
+    key.subjectConn = conntype;
+    return FindSubject(index, &key);
+}
+
+const OicSecAce_t *GetACLIndexSubjectLastACE(const OicSecACLIndexSubject_t *subject,
+                                             size_t *order)
+{
+    if (NULL == subject)
+    {
+        return NULL;
+    }
+    if (order)
+    {
+        *order = subject->lastOrder;
+    }
+    return subject->lastAce;
+}
+
+void InitACECursor(OicSecACECursor_t *cursor, const OicSecACLIndex_t *index,
+                   const OicSecACLIndexSubject_t *subject, const char *href,
+                   OicSecDiscoverable_t discoverable)
+{
+    if (NULL == cursor)
+    {
+        return;
+    }
+    memset(cursor, 0, sizeof(*cursor));
+    if (NULL == index || NULL == subject)
+    {
+        return;
+    }
+
+    const ACLIndexHref_t *entry = href ? FindHref(index, subject, href) : NULL;
+    if (entry)
+    {
+        cursor->aces[0] = entry->aces.aces;
+        cursor->counts[0] = entry->aces.count;
+    }
+
+    cursor->aces[1] = subject->wildcards[ALL_RESOURCES].aces;
+    cursor->counts[1] = subject->wildcards[ALL_RESOURCES].count;
+
+    if (DISCOVERABLE_TRUE == discoverable)
+    {
+        cursor->aces[2] = subject->wildcards[ALL_DISCOVERABLE].aces;
+        cursor->counts[2] = subject->wildcards[ALL_DISCOVERABLE].count;
+    }
+    else if (DISCOVERABLE_FALSE == discoverable)
+    {
+        cursor->aces[2] = subject->wildcards[ALL_NON_DISCOVERABLE].aces;
+        cursor->counts[2] = subject->wildcards[ALL_NON_DISCOVERABLE].count;
+    }
+}
+
+const OicSecAce_t *GetNextACE(OicSecACECursor_t *cursor)
+{
+    if (NULL == cursor)
+    {
+        return NULL;
+    }
+
+    const size_t listCount = sizeof(cursor->aces) / sizeof(cursor->aces[0]);
+    while (cursor->list < listCount)
+    {
+        if (cursor->pos < cursor->counts[cursor->list])
+        {
+            return cursor->aces[cursor->list][cursor->pos++];
+        }
+        cursor->list++;
+        cursor->pos = 0;
+    }
+    return NULL;
+}
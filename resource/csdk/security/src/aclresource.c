@@ -39,6 +39,7 @@
 #include "experimental/payload_logging.h"
 #include "srmresourcestrings.h"
 #include "aclresource.h"
+#include "aclindex.h"
 #include "experimental/doxmresource.h"
 #include "rolesresource.h"
 #include "resourcemanager.h"
@@ -71,6 +72,17 @@ static OicSecAcl_t *gAcl = NULL;
 static OCResourceHandle gAclHandle = NULL;
 static OCResourceHandle gAcl2Handle = NULL;
 
+/**
+ * Index of gAcl for the policy engine, built on first use after every change to gAcl.
+ */
+static OicSecACLIndex_t *g_aclIndex = NULL;
+
+static void InvalidateACLIndex()
+{
+    DeleteACLIndex(g_aclIndex);
+    g_aclIndex = NULL;
+}
+
 /**
  * List of known ace ids
  */
@@ -146,6 +158,7 @@ static void FreeACE(OicSecAce_t *ace)
     }
 
     //Clean Validities
+    OICFree(ace->validityCache);
     OicSecValidity_t *validity = NULL;
     OicSecValidity_t *tmpValidity = NULL;
     LL_FOREACH_SAFE(ace->validities, validity, tmpValidity)
@@ -2208,6 +2221,7 @@ OCStackResult RemoveACE(const OicUuid_t *subject, const char *resource)
             }
         }
     }
+    InvalidateACLIndex();
 
     if (deleteFlag)
     {
@@ -2270,6 +2284,7 @@ static OCStackResult RemoveAceByAceIds(AceIdList_t *aceIdList)
             }
         }
     }
+    InvalidateACLIndex();
 
     if (deleteFlag)
     {
@@ -2704,6 +2719,7 @@ static OCStackResult RemoveAllAce(const char *resource)
                 FreeACE(aceItem);
             }
         }
+        InvalidateACLIndex();
 
         //Generate empty ACL payload
         ret = AclToCBORPayload(gAcl, OIC_SEC_ACL_V2, &payload, &size);
@@ -2730,6 +2746,7 @@ static OCStackResult RemoveAllAce(const char *resource)
                 {
                     DeleteACLList(gAcl);
                     gAcl = originAcl;
+                    InvalidateACLIndex();
                 }
                 else
                 {
@@ -2937,6 +2954,7 @@ static OCEntityHandlerResult HandleACLPostRequest(const OCEntityHandlerRequest *
                     }
                 }
             }
+            InvalidateACLIndex();
             memcpy(&(gAcl->rownerID), &(newAcl->rownerID), sizeof(OicUuid_t));
 
             DeleteACLList(newAcl);
@@ -3070,6 +3088,7 @@ static OCEntityHandlerResult HandleACL2PostRequest(const OCEntityHandlerRequest
                     ehRet = OC_EH_ERROR;
                 }
             }
+            InvalidateACLIndex();
             memcpy(&(gAcl->rownerID), &(newAcl->rownerID), sizeof(OicUuid_t));
 
             DeleteACLList(newAcl);
@@ -3269,6 +3288,7 @@ static OCStackResult CreateACLResource()
 OCStackResult SetDefaultACL(OicSecAcl_t *acl)
 {
     gAcl = acl;
+    InvalidateACLIndex();
     return OC_STACK_OK;
 }
 
@@ -3489,6 +3509,7 @@ OCStackResult InitACLResource()
         // TODO Needs to update persistent storage
     }
     VERIFY_NOT_NULL(TAG, gAcl, FATAL);
+    InvalidateACLIndex();
 
     // Instantiate 'oic.sec.acl'
     ret = CreateACLResource();
@@ -3513,6 +3534,7 @@ OCStackResult DeInitACLResource()
         DeleteACLList(gAcl);
         gAcl = NULL;
     }
+    InvalidateACLIndex();
 
     oc_mutex_free(g_AceIdCounterMutex);
     g_AceIdCounterMutex = NULL;
@@ -3543,18 +3565,8 @@ const OicSecAce_t* GetACLResourceData(const OicUuid_t* subjectId, OicSecAce_t **
     }
     else
     {
-        /*
-         * If this is a 'successive' call, search for location pointed by
-         * savePtr and assign 'begin' to the next ACL after it in the linked
-         * list and start searching from there.
-         */
-        LL_FOREACH(gAcl->aces, ace)
-        {
-            if (ace == *savePtr)
-            {
-                begin = ace->next;
-            }
-        }
+        // If this is a 'successive' call, continue after the ACE returned last.
+        begin = (*savePtr)->next;
     }
 
     // Find the next ACL corresponding to the 'subjectID' and return it.
@@ -3602,18 +3614,8 @@ const OicSecAce_t* GetACLResourceDataByRoles(const OicSecRole_t *roles, size_t r
     }
     else
     {
-        /*
-         * If this is a 'successive' call, search for location pointed by
-         * savePtr and assign 'begin' to the next ACL after it in the linked
-         * list and start searching from there.
-         */
-        LL_FOREACH(gAcl->aces, ace)
-        {
-            if (ace == *savePtr)
-            {
-                begin = ace->next;
-            }
-        }
+        // If this is a 'successive' call, continue after the ACE returned last.
+        begin = (*savePtr)->next;
     }
 
     // Find the next ACL corresponding to the 'roleID' and return it.
@@ -3658,16 +3660,8 @@ const OicSecAce_t* GetACLResourceDataByConntype(const OicSecConntype_t conntype,
     }
     else
     {
-        // If this is a 'successive' call, search for location pointed by
-        // savePtr and assign 'begin' to the next ACE after it in the linked
-        // list and start searching from there.
-        LL_FOREACH(gAcl->aces, ace)
-        {
-            if (ace == *savePtr)
-            {
-                begin = ace->next;
-            }
-        }
+        // If this is a 'successive' call, continue after the ACE returned last.
+        begin = (*savePtr)->next;
     }
 
     // Find the next ACE corresponding to the conntype, and return it.
@@ -3691,6 +3685,15 @@ const OicSecAce_t* GetACLResourceDataByConntype(const OicSecConntype_t conntype,
     return NULL;
 }
 
+const OicSecACLIndex_t* GetACLIndex()
+{
+    if (NULL == g_aclIndex && NULL != gAcl)
+    {
+        g_aclIndex = CreateACLIndex(gAcl);
+    }
+    return g_aclIndex;
+}
+
 OCStackResult AppendACLObject(const OicSecAcl_t* acl)
 {
     OCStackResult ret = OC_STACK_ERROR;
@@ -3715,6 +3718,7 @@ OCStackResult AppendACLObject(const OicSecAcl_t* acl)
     {
         gAcl->aces = acl->aces;
     }
+    InvalidateACLIndex();
 
     OIC_LOG_ACL(INFO, gAcl);
 
@@ -3963,6 +3967,7 @@ OCStackResult UpdateDefaultSecProvACE()
                 }
             }
         }
+        InvalidateACLIndex();
 
         if(isRemoved)
         {
@@ -3976,6 +3981,7 @@ OCStackResult UpdateDefaultSecProvACE()
             if (secDefaultAce)
             {
                 LL_APPEND(gAcl->aces, secDefaultAce);
+                InvalidateACLIndex();
 
                 size_t size = 0;
                 uint8_t *payload = NULL;
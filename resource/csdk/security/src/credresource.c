@@ -1468,6 +1468,11 @@ static bool UpdatePersistentStorage(const OicSecCred_t *cred)
     bool ret = false;
     OIC_LOG(DEBUG, TAG, "IN Cred UpdatePersistentStorage");
 
+#if defined(__WITH_DTLS__) || defined(__WITH_TLS__)
+    // The (D)TLS adapter caches the parsed certificates and the sessions of these credentials.
+    CAinvalidateSslCredentials();
+#endif
+
     // Convert Cred data into JSON for update to persistent storage
     if (cred)
     {
@@ -33,6 +33,7 @@
 #include "crlresource.h"
 #include "ocpayloadcbor.h"
 #include "base64.h"
+#include "cainterface.h"
 #include <time.h>
 
 #define TAG  "OIC_SRM_CRL"
@@ -437,6 +438,10 @@ OCStackResult UpdateCRLResource(OicSecCrl_t *crl)
         return OC_STACK_ERROR;
     }
 
+#if defined(__WITH_DTLS__) || defined(__WITH_TLS__)
+    CAinvalidateSslCredentials();
+#endif
+
     char currentTime[32] = {0};
     getCurrentUTCTime(currentTime, sizeof(currentTime));
 
@@ -35,6 +35,7 @@
 #include "ocpayloadcbor.h"
 #include "cainterface.h"
 #include "ocserverrequest.h"
+#include "ocdiscoverycache.h"
 #include "resourcemanager.h"
 #include "experimental/doxmresource.h"
 #include "pstatresource.h"
@@ -997,7 +998,12 @@ OCStackResult DoxmUpdateWriteableProperty(const OicSecDoxm_t* src, OicSecDoxm_t*
 #endif
 
         // Update deviceuuid
-        memcpy(&(dst->deviceID), &(src->deviceID), sizeof(OicUuid_t));
+        if (0 != memcmp(&(dst->deviceID), &(src->deviceID), sizeof(OicUuid_t)))
+        {
+            memcpy(&(dst->deviceID), &(src->deviceID), sizeof(OicUuid_t));
+            // The device ID is part of the cached discovery responses.
+            OCDiscoveryCacheInvalidate();
+        }
 #ifndef NDEBUG // if debug build, log the new uuid
         convertedUUID = OCConvertUuidToString(dst->deviceID.id, uuidString);
         if (convertedUUID)
@@ -2164,6 +2170,7 @@ OCStackResult SetDoxmDeviceID(const OicUuid_t *deviceuuid)
         OIC_LOG(ERROR, TAG, "Failed to update persistent storage");
         return OC_STACK_ERROR;
     }
+    OCDiscoveryCacheInvalidate();
     return OC_STACK_OK;
 }
 
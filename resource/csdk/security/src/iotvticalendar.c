@@ -283,7 +283,7 @@ IotvtICalResult_t ParseRecur(const char *recurStr, IotvtICalRecur_t *recur)
  *
  * @return  number of days between date1 & date2.
  */
-static int DiffDays(IotvtICalDateTime_t *date1, IotvtICalDateTime_t *date2)
+static int DiffDays(const IotvtICalDateTime_t *date1, const IotvtICalDateTime_t *date2)
 {
     int days;
     int leapDays=0;
@@ -314,7 +314,7 @@ static int DiffDays(IotvtICalDateTime_t *date1, IotvtICalDateTime_t *date2)
  *
  * @return  number of seconds between time1 and time2.
  */
-static int DiffSecs(IotvtICalDateTime_t *time1, IotvtICalDateTime_t *time2)
+static int DiffSecs(const IotvtICalDateTime_t *time1, const IotvtICalDateTime_t *time2)
 {
     return (3600 * time2->tm_hour + 60 * time2->tm_min + time2->tm_sec) -
            (3600 * time1->tm_hour + 60 * time1->tm_min + time1->tm_sec);
@@ -330,7 +330,8 @@ static int DiffSecs(IotvtICalDateTime_t *time1, IotvtICalDateTime_t *time2)
  * ::IOTVTICAL_INVALID_ACCESS, if the request is not within valid time period.
  * ::IOTVTICAL_INVALID_PARAMETER, if parameter are invalid.
  */
-static IotvtICalResult_t ValidatePeriod(IotvtICalPeriod_t *period, IotvtICalDateTime_t *currentTime)
+static IotvtICalResult_t ValidatePeriod(const IotvtICalPeriod_t *period,
+                                        const IotvtICalDateTime_t *currentTime)
 {
     if (NULL == period || NULL == currentTime)
     {
@@ -374,33 +375,49 @@ static IotvtICalResult_t ValidatePeriod(IotvtICalPeriod_t *period, IotvtICalDate
     }
 }
 
-IotvtICalResult_t IsRequestWithinValidTime(const char *periodStr, const char *recurStr)
+IotvtICalResult_t CompileValidTime(const char *periodStr, const char *recurStr,
+                                   IotvtICalRule_t *rule)
 {
     //NULL recur rule means no recurring patter exist.
     //Period can't be null. Period is used with or without
     //recur rule to compute allowable access time.
-    if (NULL == periodStr)
+    if ((NULL == periodStr) || (NULL == rule))
     {
         return IOTVTICAL_INVALID_PARAMETER;
     }
 
-    IotvtICalPeriod_t period = {.startDateTime={.tm_sec=0}};
-    IotvtICalRecur_t recur = {.freq=0};
-    IotvtICalResult_t ret = IOTVTICAL_INVALID_ACCESS;
+    memset(rule, 0, sizeof(*rule));
 
-    time_t rawTime = time(0);
-    IotvtICalDateTime_t *currentTime = localtime(&rawTime);
-
-    ret  = ParsePeriod(periodStr, &period);
+    IotvtICalResult_t ret = ParsePeriod(periodStr, &rule->period);
     if (ret != IOTVTICAL_SUCCESS)
     {
         return ret;
     }
 
+    if (NULL != recurStr)
+    {
+        ret = ParseRecur(recurStr, &rule->recur);
+        if (ret != IOTVTICAL_SUCCESS)
+        {
+            return ret;
+        }
+        rule->hasRecur = true;
+    }
+    return IOTVTICAL_SUCCESS;
+}
+
+IotvtICalResult_t IsTimeWithinValidRule(const IotvtICalRule_t *rule,
+                                        const IotvtICalDateTime_t *currentTime)
+{
+    if ((NULL == rule) || (NULL == currentTime))
+    {
+        return IOTVTICAL_INVALID_PARAMETER;
+    }
+
     //If recur is NULL then the access time is between period's startDateTime and endDateTime
-    if (NULL == recurStr)
+    if (!rule->hasRecur)
     {
-        ret = ValidatePeriod(&period, currentTime);
+        return ValidatePeriod(&rule->period, currentTime);
     }
 
     //If recur is not NULL then the access time is between period's startTime and
@@ -408,46 +425,98 @@ IotvtICalResult_t IsRequestWithinValidTime(const char *periodStr, const char *re
     //is computed from period's startDate and the last instance is computed from
     //"UNTIL". If "UNTIL" is not specified then the recurrence goes for forever.
     //Eg, RRULE: FREQ=DAILY; UNTIL=20150703; BYDAY=MO, WE, FR
-    if (NULL != recurStr)
+    IotvtICalResult_t ret = IOTVTICAL_INVALID_ACCESS;
+    if ((0 <= DiffSecs(&rule->period.startDateTime, currentTime))&&
+       (0 <= DiffSecs(currentTime, &rule->period.endDateTime)) &&
+       (0 <= DiffDays(&rule->period.startDateTime, currentTime)))
     {
-        ret = ParseRecur(recurStr, &recur);
-        if (ret != IOTVTICAL_SUCCESS)
+        IotvtICalDateTime_t emptyDT = {.tm_sec=0};
+        ret = IOTVTICAL_VALID_ACCESS;
+
+        //"UNTIL" is an optional parameter of RRULE, checking if until present in recur
+        if (0 != memcmp(&rule->recur.until, &emptyDT, sizeof(IotvtICalDateTime_t)))
         {
-            return ret;
+            if(0 > DiffDays(currentTime, &rule->recur.until))
+            {
+                ret = IOTVTICAL_INVALID_ACCESS;
+            }
         }
 
-        if ((0 <= DiffSecs(&period.startDateTime, currentTime))&&
-           (0 <= DiffSecs(currentTime, &period.endDateTime)) &&
-           (0 <= DiffDays(&period.startDateTime, currentTime)))
+        //"BYDAY" is an optional parameter of RRULE, checking if byday present in recur
+        if (NO_WEEKDAY != rule->recur.byDay)
         {
-            IotvtICalDateTime_t emptyDT = {.tm_sec=0};
-            ret = IOTVTICAL_VALID_ACCESS;
 
-            //"UNTIL" is an optional parameter of RRULE, checking if until present in recur
-            if (0 != memcmp(&recur.until, &emptyDT, sizeof(IotvtICalDateTime_t)))
+            int isValidWD = (0x1 << currentTime->tm_wday) & rule->recur.byDay; //Valid weekdays
+            if (!isValidWD)
             {
-                if(0 > DiffDays(currentTime, &recur.until))
-                {
-                    ret = IOTVTICAL_INVALID_ACCESS;
-                }
+                ret = IOTVTICAL_INVALID_ACCESS;
             }
+         }
+    }
+    return ret;
+}
 
-            //"BYDAY" is an optional parameter of RRULE, checking if byday present in recur
-            if (NO_WEEKDAY != recur.byDay)
-            {
+/**
+ * Computes the time of a second of a day relative to currentTime.
+ *
+ * @param currentTime local time the day is relative to.
+ * @param dayOffset number of days after the day of currentTime.
+ * @param secs seconds since the start of the day.
+ *
+ * @return the time, or -1 if it cannot be represented.
+ */
+static time_t TimeOfDay(const IotvtICalDateTime_t *currentTime, int dayOffset, int secs)
+{
+    IotvtICalDateTime_t dateTime = *currentTime;
+    dateTime.tm_mday += dayOffset;
+    dateTime.tm_hour = 0;
+    dateTime.tm_min = 0;
+    dateTime.tm_sec = secs;
+    dateTime.tm_isdst = -1;
+    return mktime(&dateTime);
+}
 
-                int isValidWD = (0x1 << currentTime->tm_wday) & recur.byDay; //Valid weekdays
-                if (!isValidWD)
-                {
-                    ret = IOTVTICAL_INVALID_ACCESS;
-                }
-             }
-        }
-        else
+time_t GetValidRuleNextBoundary(const IotvtICalRule_t *rule, time_t now,
+                                const IotvtICalDateTime_t *currentTime)
+{
+    if ((NULL == rule) || (NULL == currentTime))
+    {
+        return now;
+    }
+
+    //The rule compares the date and the time of day of currentTime with fixed values,
+    //so its result can only change at midnight and when the time of day passes the
+    //period's start or end time. Stopping at the next full hour as well keeps the
+    //boundary right when daylight saving time moves the clock.
+    time_t boundary = TimeOfDay(currentTime, 0, 3600 * (currentTime->tm_hour + 1));
+    int secs[] = {
+        3600 * rule->period.startDateTime.tm_hour + 60 * rule->period.startDateTime.tm_min +
+            rule->period.startDateTime.tm_sec,
+        3600 * rule->period.endDateTime.tm_hour + 60 * rule->period.endDateTime.tm_min +
+            rule->period.endDateTime.tm_sec + 1
+    };
+    for (size_t i = 0; i < sizeof(secs) / sizeof(secs[0]); i++)
+    {
+        time_t change = TimeOfDay(currentTime, 0, secs[i]);
+        if ((change > now) && (change < boundary))
         {
-            ret = IOTVTICAL_INVALID_ACCESS;
+            boundary = change;
         }
     }
-    return ret;
+    return (boundary > now) ? boundary : now;
+}
+
+IotvtICalResult_t IsRequestWithinValidTime(const char *periodStr, const char *recurStr)
+{
+    IotvtICalRule_t rule;
+    IotvtICalResult_t ret = CompileValidTime(periodStr, recurStr, &rule);
+    if (ret != IOTVTICAL_SUCCESS)
+    {
+        return ret;
+    }
+
+    time_t rawTime = time(0);
+    IotvtICalDateTime_t *currentTime = localtime(&rawTime);
+    return IsTimeWithinValidRule(&rule, currentTime);
 }
 #endif
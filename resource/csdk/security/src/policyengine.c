@@ -349,9 +349,75 @@ INLINE_API bool IsWildCardSubject(OicUuid_t *subject)
     }
 }
 
+#ifndef WITH_ARDUINO
+/**
+ * Validities of an ACE parsed into rules, with the result of the last time check and
+ * the time span it holds for.
+ */
+struct OicSecValidityCache
+{
+    time_t from;
+    time_t until;
+    bool withinValidTime;
+    size_t ruleCount;
+    IotvtICalRule_t rules[];
+};
+
+/**
+ * Parse the period and recurrence strings of an ACE's validities.
+ *
+ * @param ace is the ACE with validities.
+ *
+ * @return the compiled validities, or NULL on allocation failure.
+ */
+static OicSecValidityCache_t *CompileValidities(const OicSecAce_t *ace)
+{
+    OicSecValidity_t* validity = NULL;
+    size_t ruleCount = 0;
+
+    //periods & recurrences rules are paired, so without recurrences no time is valid.
+    if (NULL != ace->validities->recurrences)
+    {
+        LL_FOREACH(ace->validities, validity)
+        {
+            ruleCount += validity->recurrenceLen;
+        }
+    }
+
+    OicSecValidityCache_t *cache = (OicSecValidityCache_t *)OICCalloc(1,
+        sizeof(OicSecValidityCache_t) + ruleCount * sizeof(IotvtICalRule_t));
+    if (NULL == cache || 0 == ruleCount)
+    {
+        return cache;
+    }
+
+    LL_FOREACH(ace->validities, validity)
+    {
+        for (size_t i = 0; i < validity->recurrenceLen; i++)
+        {
+            IotvtICalResult_t res = CompileValidTime(validity->period, validity->recurrences[i],
+                                                     &cache->rules[cache->ruleCount]);
+            if (IOTVTICAL_SUCCESS == res)
+            {
+                cache->ruleCount++;
+            }
+            else
+            {
+                OIC_LOG_V(WARNING, TAG, "%s: ignoring validity that failed to parse: %d",
+                    __func__, res);
+            }
+        }
+    }
+    return cache;
+}
+#endif
+
 /**
  * Check whether 'resource' is getting accessed within the valid time period.
  *
+ * The validities are parsed on the first check of an ACE, and the result of a check is
+ * reused until the time of day passes a boundary of one of them.
+ *
  * @param acl is the ACL to check.
  *
  * @return true if access is within valid time period or if the period or recurrence is not present.
@@ -366,25 +432,58 @@ static bool IsAccessWithinValidTime(const OicSecAce_t *ace)
         return true;
     }
 
-    //periods & recurrences rules are paired.
-    if (NULL == ace->validities->recurrences)
+    // Checks are serialized by the policy lock, so the cache on the ACE can be filled in here.
+    OicSecValidityCache_t *cache = ace->validityCache;
+    if (NULL == cache)
     {
+        cache = CompileValidities(ace);
+        if (NULL == cache)
+        {
+            OIC_LOG(ERROR, TAG, "Failed to allocate validity cache");
+            return false;
+        }
+        ((OicSecAce_t *)ace)->validityCache = cache;
+    }
+
+    if (0 == cache->ruleCount)
+    {
+        OIC_LOG(ERROR, TAG, "Access request is in invalid time period");
         return false;
     }
 
-    OicSecValidity_t* validity =  NULL;
-    LL_FOREACH(ace->validities, validity)
+    time_t now = time(0);
+    if ((now < cache->from) || (now >= cache->until))
     {
-        for(size_t i = 0; i < validity->recurrenceLen; i++)
+        const IotvtICalDateTime_t *localTime = localtime(&now);
+        if (NULL == localTime)
         {
-            if (IOTVTICAL_VALID_ACCESS == IsRequestWithinValidTime(validity->period,
-                validity->recurrences[i]))
+            OIC_LOG(ERROR, TAG, "Failed to get local time");
+            return false;
+        }
+        IotvtICalDateTime_t currentTime = *localTime;
+
+        cache->withinValidTime = false;
+        cache->from = now;
+        cache->until = GetValidRuleNextBoundary(&cache->rules[0], now, &currentTime);
+        for (size_t i = 0; i < cache->ruleCount; i++)
+        {
+            if (IOTVTICAL_VALID_ACCESS == IsTimeWithinValidRule(&cache->rules[i], &currentTime))
             {
-                OIC_LOG(INFO, TAG, "Access request is in allowed time period");
-                return true;
+                cache->withinValidTime = true;
+            }
+            time_t boundary = GetValidRuleNextBoundary(&cache->rules[i], now, &currentTime);
+            if (boundary < cache->until)
+            {
+                cache->until = boundary;
             }
         }
     }
+
+    if (cache->withinValidTime)
+    {
+        OIC_LOG(INFO, TAG, "Access request is in allowed time period");
+        return true;
+    }
     OIC_LOG(ERROR, TAG, "Access request is in invalid time period");
     return false;
 
@@ -465,6 +564,55 @@ static void ProcessMatchingACE(SRMRequestContext_t *context, const OicSecAce_t *
     }
 }
 
+/**
+ * Check the ACEs of a group of subjects against the request, in the order the index lists
+ * them, until one grants access.
+ *
+ * If none does, the ACE of these subjects that comes last in the ACL decides the reason for
+ * the denial, as when each ACE of the subjects is checked in ACL order.
+ *
+ * @return true if any of the subjects has an ACE, otherwise false.
+ */
+static bool ProcessMatchingSubjects(SRMRequestContext_t *context, const OicSecACLIndex_t *index,
+                                    const OicSecACLIndexSubject_t **subjects, size_t subjectCount)
+{
+    const OicSecAce_t *lastAce = NULL;
+    size_t lastOrder = 0;
+
+    for (size_t i = 0; i < subjectCount; i++)
+    {
+        if (NULL == subjects[i])
+        {
+            continue;
+        }
+
+        size_t order = 0;
+        const OicSecAce_t *ace = GetACLIndexSubjectLastACE(subjects[i], &order);
+        if (NULL == lastAce || order > lastOrder)
+        {
+            lastAce = ace;
+            lastOrder = order;
+        }
+
+        OicSecACECursor_t cursor;
+        InitACECursor(&cursor, index, subjects[i], context->resourceUri, context->discoverable);
+        while (NULL != (ace = GetNextACE(&cursor)))
+        {
+            ProcessMatchingACE(context, ace);
+            if (IsAccessGranted(context->responseVal))
+            {
+                return true;
+            }
+        }
+    }
+
+    if (NULL != lastAce)
+    {
+        ProcessMatchingACE(context, lastAce);
+    }
+    return (NULL != lastAce);
+}
+
 /**
  * Search for an ACE that matches the Resource URI, by conntype, subjectuuid, or roles.
  * For each matching ACE, check whether it grants permission.
@@ -480,12 +628,19 @@ static void ProcessAccessRequest(SRMRequestContext_t *context)
 
     OIC_LOG_V(DEBUG, TAG, "Entering %s(%s)", __func__, context->resourceUri);
 
-    const OicSecAce_t *currentAce = NULL;
-    OicSecAce_t *aceSavePtr = NULL;
+    const OicSecACLIndexSubject_t *subject = NULL;
 
     // Start out assuming subject not found.
     context->responseVal = ACCESS_DENIED_SUBJECT_NOT_FOUND;
 
+    const OicSecACLIndex_t *index = GetACLIndex();
+    if (NULL == index)
+    {
+        OIC_LOG_V(INFO, TAG, "%s: no ACL to search for resource %s",
+            __func__, context->resourceUri);
+        return;
+    }
+
     // First, check for a conntype ACE that matches.
     OicSecConntype_t conntype;
     if (context->secureChannel)
@@ -496,50 +651,34 @@ static void ProcessAccessRequest(SRMRequestContext_t *context)
     {
         conntype = ANON_CLEAR;
     }
-    do
+    subject = FindACLIndexSubjectByConntype(index, conntype);
+    if (NULL != subject)
     {
-        currentAce = GetACLResourceDataByConntype(conntype, &aceSavePtr);
-
-        if (NULL != currentAce)
-        {
-            OIC_LOG_V(DEBUG, TAG, "%s: found conntype %s match; processing for access.",
-                __func__, (AUTH_CRYPT == conntype?"auth-crypt":"anon-clear"));
-            ProcessMatchingACE(context, currentAce);
-        }
-        else
-        {
-            OIC_LOG_V(INFO, TAG, "%s:no ACL found matching conntype %s for resource %s",
-                __func__, (AUTH_CRYPT == conntype?"auth-crypt":"anon-clear"), context->resourceUri);
-        }
-    } while ((NULL != currentAce) && !IsAccessGranted(context->responseVal));
+        OIC_LOG_V(DEBUG, TAG, "%s: found conntype %s match; processing for access.",
+            __func__, (AUTH_CRYPT == conntype?"auth-crypt":"anon-clear"));
+        ProcessMatchingSubjects(context, index, &subject, 1);
+    }
+    else
+    {
+        OIC_LOG_V(INFO, TAG, "%s:no ACL found matching conntype %s for resource %s",
+            __func__, (AUTH_CRYPT == conntype?"auth-crypt":"anon-clear"), context->resourceUri);
+    }
 
     // If not granted via conntype, try Subject-based match.
     if (!IsAccessGranted(context->responseVal))
     {
-        currentAce = NULL;
-        aceSavePtr = NULL;
-        do
+        subject = FindACLIndexSubjectByUuid(index, &context->subjectUuid);
+        if (!ProcessMatchingSubjects(context, index, &subject, 1))
         {
-            currentAce = GetACLResourceData(&context->subjectUuid, &aceSavePtr);
-
-            if (NULL != currentAce)
-            {
-                ProcessMatchingACE(context, currentAce);
-            }
-            else
-            {
-                OIC_LOG_V(INFO, TAG, "%s:no ACL found matching subject for resource %s",
-                    __func__, context->resourceUri);
-            }
-        } while ((NULL != currentAce) && !IsAccessGranted(context->responseVal));
+            OIC_LOG_V(INFO, TAG, "%s:no ACL found matching subject for resource %s",
+                __func__, context->resourceUri);
+        }
     }
 
 #if defined(__WITH_DTLS__) || defined(__WITH_TLS__)
     // If no subject ACE granted access, try role ACEs.
     if (!IsAccessGranted(context->responseVal))
     {
-        currentAce = NULL;
-        aceSavePtr = NULL;
         OicSecRole_t *roles = NULL;
         size_t roleCount = 0;
         OCStackResult res = GetEndpointRoles(context->endPoint, &roles, &roleCount);
@@ -550,20 +689,28 @@ static void ProcessAccessRequest(SRMRequestContext_t *context)
         else
         {
             OIC_LOG_V(DEBUG, TAG, "Found %u asserted roles for endpoint", (unsigned int) roleCount);
-            do
+            const OicSecACLIndexSubject_t **subjects = NULL;
+            if (0 < roleCount)
             {
-                currentAce = GetACLResourceDataByRoles(roles, roleCount, &aceSavePtr);
-                if (NULL != currentAce)
-                {
-                    ProcessMatchingACE(context, currentAce);
-                }
-                else
+                subjects = (const OicSecACLIndexSubject_t **)OICCalloc(roleCount,
+                                                                       sizeof(*subjects));
+                if (NULL == subjects)
                 {
-                    OIC_LOG_V(INFO, TAG, "%s:no ACL found matching roles for resource %s",
-                        __func__, context->resourceUri);
+                    OIC_LOG(ERROR, TAG, "Failed to allocate role subjects");
                 }
-            } while ((NULL != currentAce) && !IsAccessGranted(context->responseVal));
+            }
+            for (size_t i = 0; NULL != subjects && i < roleCount; i++)
+            {
+                subjects[i] = FindACLIndexSubjectByRole(index, &roles[i]);
+            }
+            if ((NULL == subjects) ||
+                !ProcessMatchingSubjects(context, index, subjects, roleCount))
+            {
+                OIC_LOG_V(INFO, TAG, "%s:no ACL found matching roles for resource %s",
+                    __func__, context->resourceUri);
+            }
 
+            OICFree((void *)subjects);
             OICFree(roles);
         }
     }
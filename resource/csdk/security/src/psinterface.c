@@ -32,11 +32,17 @@
 #include "ocpayloadcbor.h"
 #include "ocstack.h"
 #include "oic_malloc.h"
+#include "ochashtable.h"
+#include "oic_string.h"
+#include "oic_time.h"
+#include "octhread.h"
+#include "utlist.h"
 #include "experimental/payload_logging.h"
 #include "resourcemanager.h"
 #include "secureresourcemanager.h"
 #include "srmresourcestrings.h"
 #include "srmutility.h"
+#include "psinterface.h"
 #include "pstatresource.h"
 #include "experimental/doxmresource.h"
 #include "ocresourcehandler.h"
@@ -64,6 +70,64 @@ typedef enum _PSDatabase
     PS_DATABASE_DEVICEPROPERTIES
 } PSDatabase;
 
+/**
+ * Suffix of the journal that is kept next to a database.
+ */
+static const char PS_JOURNAL_SUFFIX[] = ".jnl";
+
+/**
+ * Start of every journal record.
+ */
+static const uint8_t PS_JOURNAL_MAGIC[4] = { 'O', 'C', 'J', '1' };
+
+/**
+ * A journal record is the magic, the name length (2 bytes), the payload length (4 bytes),
+ * the name, the payload and a checksum (4 bytes). A payload length of 0 removes the resource.
+ */
+#define PS_JOURNAL_HEADER_SIZE (sizeof(PS_JOURNAL_MAGIC) + 2 + 4)
+#define PS_JOURNAL_CHECKSUM_SIZE (4)
+
+/**
+ * The journal is folded into the database once it is larger than this and than the database.
+ */
+#define PS_JOURNAL_MIN_COMPACT_SIZE (64 * 1024)
+
+/**
+ * CBOR overhead of one resource in the database map, on top of its name and payload.
+ */
+#define PS_ENTRY_ENCODING_SIZE (18)
+
+/**
+ * A resource of a database, or an update to it.
+ */
+typedef struct PSEntry
+{
+    char *name;
+    uint8_t *payload;           /**< NULL if the resource is removed. */
+    size_t size;
+    struct PSEntry *next;
+} PSEntry_t;
+
+/**
+ * Journal state of one database.
+ */
+typedef struct PSJournal
+{
+    char *databaseName;
+    char *journalName;
+    bool checked;               /**< Journal read and its torn tail removed in this process. */
+    size_t journalSize;         /**< Size of the records in the journal. */
+    size_t databaseSize;        /**< Size of the database when it was last written. */
+    PSEntry_t *pending;         /**< Updates held back in the coalescing window. */
+    struct PSJournal *next;
+} PSJournal_t;
+
+static bool g_psJournalEnabled = false;
+static uint32_t g_psCoalesceMs = 0;
+static uint64_t g_psFlushDeadline = 0;      // in ms, 0 if no update is pending
+static PSJournal_t *g_psJournals = NULL;
+static oc_mutex g_psJournalMutex = NULL;
+
 /**
  * Writes CBOR payload to the specified database in persistent storage.
  *
@@ -142,6 +206,717 @@ static size_t GetDatabaseSize(const OCPersistentStorage *ps, const char *databas
     return size;
 }
 
+/**
+ * Reads a whole file from PS.
+ *
+ * @note Caller of this method MUST use OICFree() method to release the returned memory.
+ *
+ * @param ps    is a pointer to OCPersistentStorage for the Virtual Resource(s).
+ * @param name  is the name of the file to read.
+ * @param size  is the size of the file contents read.
+ *
+ * @return the file contents, or NULL if the file is missing, empty or could not be read.
+ */
+static uint8_t *ReadFileFromPS(const OCPersistentStorage *ps, const char *name, size_t *size)
+{
+    *size = GetDatabaseSize(ps, name);
+    if (0 == *size)
+    {
+        return NULL;
+    }
+
+    uint8_t *data = (uint8_t *)OICMalloc(*size);
+    if (NULL == data)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to allocate file buffer");
+        *size = 0;
+        return NULL;
+    }
+
+    FILE *fp = ps->open(name, "rb");
+    if (NULL == fp || ps->read(data, 1, *size, fp) != *size)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed reading %s", name);
+        if (fp)
+        {
+            ps->close(fp);
+        }
+        OICFree(data);
+        *size = 0;
+        return NULL;
+    }
+    ps->close(fp);
+    return data;
+}
+
+static char *GetJournalName(const char *databaseName)
+{
+    size_t size = strlen(databaseName) + sizeof(PS_JOURNAL_SUFFIX);
+    char *journalName = (char *)OICMalloc(size);
+    if (journalName)
+    {
+        OICStrcpy(journalName, size, databaseName);
+        OICStrcat(journalName, size, PS_JOURNAL_SUFFIX);
+    }
+    return journalName;
+}
+
+static void FreeEntries(PSEntry_t *entries)
+{
+    PSEntry_t *entry = NULL;
+    PSEntry_t *tmp = NULL;
+    LL_FOREACH_SAFE(entries, entry, tmp)
+    {
+        LL_DELETE(entries, entry);
+        OICFree(entry->name);
+        OICFree(entry->payload);
+        OICFree(entry);
+    }
+}
+
+static PSEntry_t *FindEntry(PSEntry_t *entries, const char *name, size_t nameLen)
+{
+    PSEntry_t *entry = NULL;
+    LL_FOREACH(entries, entry)
+    {
+        if ((strlen(entry->name) == nameLen) && (0 == memcmp(entry->name, name, nameLen)))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Sets the payload of a resource in a list of entries, adding the resource if needed.
+ * A NULL payload marks the resource as removed.
+ */
+static OCStackResult SetEntry(PSEntry_t **entries, const char *name, size_t nameLen,
+                              const uint8_t *payload, size_t size)
+{
+    uint8_t *copy = NULL;
+    if (payload && size)
+    {
+        copy = (uint8_t *)OICMalloc(size);
+        if (NULL == copy)
+        {
+            return OC_STACK_NO_MEMORY;
+        }
+        memcpy(copy, payload, size);
+    }
+    else
+    {
+        size = 0;
+    }
+
+    PSEntry_t *entry = FindEntry(*entries, name, nameLen);
+    if (NULL == entry)
+    {
+        entry = (PSEntry_t *)OICCalloc(1, sizeof(PSEntry_t));
+        if (entry)
+        {
+            entry->name = (char *)OICCalloc(1, nameLen + 1);
+        }
+        if (NULL == entry || NULL == entry->name)
+        {
+            OICFree(entry);
+            OICFree(copy);
+            return OC_STACK_NO_MEMORY;
+        }
+        memcpy(entry->name, name, nameLen);
+        LL_APPEND(*entries, entry);
+    }
+
+    OICFree(entry->payload);
+    entry->payload = copy;
+    entry->size = size;
+    return OC_STACK_OK;
+}
+
+/**
+ * Decodes the map of resource names to payloads that a database holds.
+ */
+static OCStackResult ParseDatabase(const uint8_t *data, size_t size, PSEntry_t **entries)
+{
+    OCStackResult ret = OC_STACK_ERROR;
+    char *name = NULL;
+    uint8_t *payload = NULL;
+    size_t nameLen = 0;
+    size_t payloadLen = 0;
+
+    CborParser parser;  // will be initialized in |cbor_parser_init|
+    CborValue cbor;     // will be initialized in |cbor_parser_init|
+    CborValue map;      // will be initialized in |cbor_value_enter_container|
+    CborError cborFindResult = cbor_parser_init(data, size, 0, &parser, &cbor);
+    VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborFindResult, "Failed Parsing Database.");
+    VERIFY_SUCCESS(TAG, cbor_value_is_map(&cbor), ERROR);
+    cborFindResult = cbor_value_enter_container(&cbor, &map);
+    VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborFindResult, "Failed Entering Database Map.");
+
+    while (!cbor_value_at_end(&map))
+    {
+        VERIFY_SUCCESS(TAG, cbor_value_is_text_string(&map), ERROR);
+        cborFindResult = cbor_value_dup_text_string(&map, &name, &nameLen, &map);
+        VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborFindResult, "Failed Finding Resource Name.");
+        if (cbor_value_is_byte_string(&map))
+        {
+            cborFindResult = cbor_value_dup_byte_string(&map, &payload, &payloadLen, &map);
+            VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborFindResult, "Failed Finding Resource Value.");
+            VERIFY_SUCCESS(TAG, OC_STACK_OK == SetEntry(entries, name, nameLen, payload, payloadLen),
+                           ERROR);
+            OICFree(payload);
+            payload = NULL;
+        }
+        else
+        {
+            cborFindResult = cbor_value_advance(&map);
+            VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborFindResult, "Failed Advancing Database Map.");
+        }
+        OICFree(name);
+        name = NULL;
+    }
+    ret = OC_STACK_OK;
+
+exit:
+    OICFree(name);
+    OICFree(payload);
+    return ret;
+}
+
+/**
+ * Applies the records of a journal to a list of entries. Reading stops at the first record
+ * that is incomplete or fails its checksum, which is where a write was cut short.
+ *
+ * @return the size of the records that were applied.
+ */
+static size_t ReplayJournal(const uint8_t *data, size_t size, PSEntry_t **entries)
+{
+    size_t pos = 0;
+    while (size - pos >= PS_JOURNAL_HEADER_SIZE + PS_JOURNAL_CHECKSUM_SIZE)
+    {
+        const uint8_t *record = data + pos;
+        if (0 != memcmp(record, PS_JOURNAL_MAGIC, sizeof(PS_JOURNAL_MAGIC)))
+        {
+            break;
+        }
+        const uint8_t *lengths = record + sizeof(PS_JOURNAL_MAGIC);
+        size_t nameLen = ((size_t)lengths[0] << 8) | lengths[1];
+        size_t payloadLen = ((size_t)lengths[2] << 24) | ((size_t)lengths[3] << 16) |
+                            ((size_t)lengths[4] << 8) | lengths[5];
+        size_t bodyLen = nameLen + payloadLen;
+        if ((0 == nameLen) || (bodyLen < payloadLen) ||
+            (size - pos - PS_JOURNAL_HEADER_SIZE - PS_JOURNAL_CHECKSUM_SIZE < bodyLen))
+        {
+            break;
+        }
+
+        const uint8_t *checksum = record + PS_JOURNAL_HEADER_SIZE + bodyLen;
+        uint32_t expected = ((uint32_t)checksum[0] << 24) | ((uint32_t)checksum[1] << 16) |
+                            ((uint32_t)checksum[2] << 8) | checksum[3];
+        if (expected != OCHashBytes(OC_HASH_INIT, lengths,
+                                    PS_JOURNAL_HEADER_SIZE - sizeof(PS_JOURNAL_MAGIC) +
+                                    bodyLen))
+        {
+            break;
+        }
+
+        const char *name = (const char *)record + PS_JOURNAL_HEADER_SIZE;
+        if (entries && (OC_STACK_OK != SetEntry(entries, name, nameLen,
+                                                (const uint8_t *)name + nameLen, payloadLen)))
+        {
+            break;
+        }
+        pos += PS_JOURNAL_HEADER_SIZE + bodyLen + PS_JOURNAL_CHECKSUM_SIZE;
+    }
+    return pos;
+}
+
+/**
+ * Encodes journal records for a list of updates.
+ *
+ * @note Caller of this method MUST use OICFree() method to release memory
+ *       referenced by the data argument.
+ */
+static OCStackResult EncodeJournalRecords(const PSEntry_t *updates, uint8_t **data, size_t *size)
+{
+    size_t total = 0;
+    const PSEntry_t *update = NULL;
+    LL_FOREACH(updates, update)
+    {
+        size_t nameLen = strlen(update->name);
+        if ((0 == nameLen) || (nameLen > UINT16_MAX) || (update->size > UINT32_MAX))
+        {
+            return OC_STACK_INVALID_PARAM;
+        }
+        total += PS_JOURNAL_HEADER_SIZE + nameLen + update->size + PS_JOURNAL_CHECKSUM_SIZE;
+    }
+
+    uint8_t *records = (uint8_t *)OICMalloc(total);
+    if (NULL == records)
+    {
+        return OC_STACK_NO_MEMORY;
+    }
+
+    uint8_t *record = records;
+    LL_FOREACH(updates, update)
+    {
+        size_t nameLen = strlen(update->name);
+        uint8_t *lengths = record + sizeof(PS_JOURNAL_MAGIC);
+        memcpy(record, PS_JOURNAL_MAGIC, sizeof(PS_JOURNAL_MAGIC));
+        lengths[0] = (uint8_t)(nameLen >> 8);
+        lengths[1] = (uint8_t)nameLen;
+        lengths[2] = (uint8_t)(update->size >> 24);
+        lengths[3] = (uint8_t)(update->size >> 16);
+        lengths[4] = (uint8_t)(update->size >> 8);
+        lengths[5] = (uint8_t)update->size;
+        memcpy(record + PS_JOURNAL_HEADER_SIZE, update->name, nameLen);
+        if (update->size)
+        {
+            memcpy(record + PS_JOURNAL_HEADER_SIZE + nameLen, update->payload, update->size);
+        }
+
+        size_t bodyLen = nameLen + update->size;
+        uint32_t checksum = OCHashBytes(OC_HASH_INIT, lengths,
+                                        PS_JOURNAL_HEADER_SIZE - sizeof(PS_JOURNAL_MAGIC) +
+                                        bodyLen);
+        uint8_t *end = record + PS_JOURNAL_HEADER_SIZE + bodyLen;
+        end[0] = (uint8_t)(checksum >> 24);
+        end[1] = (uint8_t)(checksum >> 16);
+        end[2] = (uint8_t)(checksum >> 8);
+        end[3] = (uint8_t)checksum;
+        record = end + PS_JOURNAL_CHECKSUM_SIZE;
+    }
+
+    *data = records;
+    *size = total;
+    return OC_STACK_OK;
+}
+
+/**
+ * Encodes a list of entries as the map of resource names to payloads that a database holds.
+ *
+ * @note Caller of this method MUST use OICFree() method to release memory
+ *       referenced by the data argument.
+ */
+static OCStackResult EncodeDatabase(const PSEntry_t *entries, uint8_t **data, size_t *size)
+{
+    OCStackResult ret = OC_STACK_ERROR;
+    int64_t cborEncoderResult = CborNoError;
+    size_t allocSize = CBOR_ENCODING_SIZE_ADDITION;
+    const PSEntry_t *entry = NULL;
+    LL_FOREACH(entries, entry)
+    {
+        allocSize += strlen(entry->name) + entry->size + PS_ENTRY_ENCODING_SIZE;
+    }
+
+    uint8_t *outPayload = (uint8_t *)OICCalloc(1, allocSize);
+    VERIFY_NOT_NULL(TAG, outPayload, ERROR);
+    CborEncoder encoder;  // will be initialized in |cbor_parser_init|
+    cbor_encoder_init(&encoder, outPayload, allocSize, 0);
+    CborEncoder resource;  // will be initialized in |cbor_encoder_create_map|
+    cborEncoderResult |= cbor_encoder_create_map(&encoder, &resource, CborIndefiniteLength);
+    VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborEncoderResult, "Failed Adding PS Map.");
+
+    LL_FOREACH(entries, entry)
+    {
+        if (NULL == entry->payload)
+        {
+            continue;
+        }
+        cborEncoderResult |= cbor_encode_text_string(&resource, entry->name, strlen(entry->name));
+        VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborEncoderResult, "Failed Adding Value Tag");
+        cborEncoderResult |= cbor_encode_byte_string(&resource, entry->payload, entry->size);
+        VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborEncoderResult, "Failed Adding Value.");
+    }
+
+    cborEncoderResult |= cbor_encoder_close_container(&encoder, &resource);
+    VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, cborEncoderResult, "Failed Closing Array.");
+    *size = cbor_encoder_get_buffer_size(&encoder, outPayload);
+    *data = outPayload;
+    outPayload = NULL;
+    ret = OC_STACK_OK;
+
+exit:
+    OICFree(outPayload);
+    return ret;
+}
+
+/**
+ * Reads a database and applies its journal.
+ *
+ * @param ps           is a pointer to OCPersistentStorage for the Virtual Resource(s).
+ * @param databaseName is the name of the database to read.
+ * @param journalName  is the name of the journal of the database.
+ * @param entries      is the list the resources are added to.
+ * @param journalSize  is the size of the journal file, including a torn record at its end.
+ * @param recordsSize  is the size of the records that were applied.
+ *
+ * @return ::OC_STACK_OK for Success, otherwise some error value
+ */
+static OCStackResult LoadJournaledDatabase(const OCPersistentStorage *ps,
+                                           const char *databaseName, const char *journalName,
+                                           PSEntry_t **entries, size_t *journalSize,
+                                           size_t *recordsSize)
+{
+    size_t dbSize = 0;
+    uint8_t *dbData = ReadFileFromPS(ps, databaseName, &dbSize);
+    uint8_t *journalData = ReadFileFromPS(ps, journalName, journalSize);
+    OCStackResult ret = OC_STACK_OK;
+
+    if (dbData)
+    {
+        ret = ParseDatabase(dbData, dbSize, entries);
+    }
+    if (OC_STACK_OK == ret)
+    {
+        *recordsSize = journalData ? ReplayJournal(journalData, *journalSize, entries) : 0;
+    }
+
+    OICFree(dbData);
+    OICFree(journalData);
+    return ret;
+}
+
+/**
+ * Removes the journal of a database once the database holds all of its records.
+ */
+static void RemoveJournal(const OCPersistentStorage *ps, PSJournal_t *journal)
+{
+    if (0 != ps->unlink(journal->journalName))
+    {
+        OIC_LOG_V(WARNING, TAG, "Failed to remove %s", journal->journalName);
+    }
+    journal->journalSize = 0;
+}
+
+/**
+ * Folds the journal of a database into the database.
+ * The database is written before the journal is removed, so after a crash in between the
+ * journal is replayed over the new database, which gives the same result.
+ */
+static OCStackResult CompactJournal(const OCPersistentStorage *ps, PSJournal_t *journal)
+{
+    PSEntry_t *entries = NULL;
+    uint8_t *data = NULL;
+    size_t size = 0;
+    size_t journalSize = 0;
+    size_t recordsSize = 0;
+
+    OCStackResult ret = LoadJournaledDatabase(ps, journal->databaseName, journal->journalName,
+                                              &entries, &journalSize, &recordsSize);
+    if (OC_STACK_OK == ret)
+    {
+        ret = EncodeDatabase(entries, &data, &size);
+    }
+    if (OC_STACK_OK == ret)
+    {
+        ret = WritePayloadToPS(journal->databaseName, data, size);
+    }
+    if (OC_STACK_OK == ret)
+    {
+        OIC_LOG_V(DEBUG, TAG, "Compacted %" PRIuPTR " bytes of journal into %s",
+                  journalSize, journal->databaseName);
+        RemoveJournal(ps, journal);
+        journal->databaseSize = size;
+    }
+    else
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to compact journal of %s", journal->databaseName);
+    }
+
+    FreeEntries(entries);
+    OICFree(data);
+    return ret;
+}
+
+/**
+ * Gets the journal state of a database, creating it if needed.
+ * Must be called with g_psJournalMutex held.
+ */
+static PSJournal_t *GetJournal(const char *databaseName)
+{
+    PSJournal_t *journal = NULL;
+    LL_FOREACH(g_psJournals, journal)
+    {
+        if (0 == strcmp(journal->databaseName, databaseName))
+        {
+            return journal;
+        }
+    }
+
+    journal = (PSJournal_t *)OICCalloc(1, sizeof(PSJournal_t));
+    if (journal)
+    {
+        journal->databaseName = OICStrdup(databaseName);
+        journal->journalName = GetJournalName(databaseName);
+    }
+    if (NULL == journal || NULL == journal->databaseName || NULL == journal->journalName)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to allocate journal state");
+        if (journal)
+        {
+            OICFree(journal->databaseName);
+            OICFree(journal->journalName);
+            OICFree(journal);
+        }
+        return NULL;
+    }
+    LL_APPEND(g_psJournals, journal);
+    return journal;
+}
+
+/**
+ * Appends updates to the journal of a database, and compacts the journal when it has grown
+ * larger than the database. Must be called with g_psJournalMutex held.
+ */
+static OCStackResult AppendJournal(const OCPersistentStorage *ps, PSJournal_t *journal,
+                                   const PSEntry_t *updates)
+{
+    OCStackResult ret = OC_STACK_OK;
+
+    // Appending after a record that was cut short would hide the new records on replay,
+    // so a torn journal left by an earlier process is compacted first.
+    if (!journal->checked)
+    {
+        PSEntry_t *entries = NULL;
+        size_t journalSize = 0;
+        size_t recordsSize = 0;
+        ret = LoadJournaledDatabase(ps, journal->databaseName, journal->journalName,
+                                    &entries, &journalSize, &recordsSize);
+        FreeEntries(entries);
+        if (OC_STACK_OK != ret)
+        {
+            return ret;
+        }
+        journal->journalSize = recordsSize;
+        journal->databaseSize = GetDatabaseSize(ps, journal->databaseName);
+        if (recordsSize != journalSize)
+        {
+            OIC_LOG_V(WARNING, TAG, "Dropping %" PRIuPTR " bytes of torn journal records",
+                      journalSize - recordsSize);
+            ret = CompactJournal(ps, journal);
+            if (OC_STACK_OK != ret)
+            {
+                return ret;
+            }
+        }
+        journal->checked = true;
+    }
+
+    uint8_t *records = NULL;
+    size_t size = 0;
+    ret = EncodeJournalRecords(updates, &records, &size);
+    if (OC_STACK_OK != ret)
+    {
+        return ret;
+    }
+
+    ret = OC_STACK_ERROR;
+    FILE *fp = ps->open(journal->journalName, "ab");
+    if (fp)
+    {
+        size_t written = ps->write(records, 1, size, fp);
+        if (0 == ps->close(fp) && size == written)
+        {
+            journal->journalSize += size;
+            ret = OC_STACK_OK;
+        }
+    }
+    OICFree(records);
+
+    if (OC_STACK_OK != ret)
+    {
+        // Part of the records may have been written, so the journal is checked again
+        // before the next append.
+        OIC_LOG_V(ERROR, TAG, "Failed appending to %s", journal->journalName);
+        journal->checked = false;
+        return ret;
+    }
+
+    size_t threshold = (journal->databaseSize > PS_JOURNAL_MIN_COMPACT_SIZE) ?
+                       journal->databaseSize : PS_JOURNAL_MIN_COMPACT_SIZE;
+    if (journal->journalSize > threshold)
+    {
+        ret = CompactJournal(ps, journal);
+    }
+    return ret;
+}
+
+/**
+ * Appends the updates of a database held back in the coalescing window to its journal.
+ * Must be called with g_psJournalMutex held.
+ */
+static OCStackResult FlushJournal(const OCPersistentStorage *ps, PSJournal_t *journal)
+{
+    if (NULL == journal->pending)
+    {
+        return OC_STACK_OK;
+    }
+
+    OCStackResult ret = ps ? AppendJournal(ps, journal, journal->pending) : OC_STACK_ERROR;
+    FreeEntries(journal->pending);
+    journal->pending = NULL;
+    return ret;
+}
+
+/**
+ * Writes a whole database, replacing its journal and any updates held back for it.
+ */
+static OCStackResult WriteDatabaseToPS(const char *databaseName, uint8_t *payload, size_t size)
+{
+    OCStackResult ret = WritePayloadToPS(databaseName, payload, size);
+    if (OC_STACK_OK != ret)
+    {
+        return ret;
+    }
+
+    OCPersistentStorage *ps = OCGetPersistentStorageHandler();
+    char *journalName = GetJournalName(databaseName);
+    if (NULL == ps || NULL == journalName)
+    {
+        OICFree(journalName);
+        return OC_STACK_ERROR;
+    }
+
+    if (g_psJournalEnabled)
+    {
+        oc_mutex_lock(g_psJournalMutex);
+        PSJournal_t *journal = GetJournal(databaseName);
+        if (journal)
+        {
+            FreeEntries(journal->pending);
+            journal->pending = NULL;
+            journal->checked = true;
+            journal->journalSize = 0;
+            journal->databaseSize = size;
+        }
+        oc_mutex_unlock(g_psJournalMutex);
+    }
+
+    // Only a file that holds journal records is removed, in case the application maps
+    // every name to the same file.
+    size_t journalSize = 0;
+    uint8_t *journalData = ReadFileFromPS(ps, journalName, &journalSize);
+    if (journalData && (0 < ReplayJournal(journalData, journalSize, NULL)))
+    {
+        if (0 != ps->unlink(journalName))
+        {
+            OIC_LOG_V(ERROR, TAG, "Failed to remove %s", journalName);
+            ret = OC_STACK_ERROR;
+        }
+    }
+    OICFree(journalData);
+    OICFree(journalName);
+    return ret;
+}
+
+/**
+ * Records an update of a resource in the journal of a database, or holds it back for the
+ * coalescing window.
+ */
+static OCStackResult UpdateResourceInJournal(const char *databaseName, const char *resourceName,
+                                             const uint8_t *payload, size_t size)
+{
+    OCPersistentStorage *ps = OCGetPersistentStorageHandler();
+    if (NULL == ps)
+    {
+        return OC_STACK_ERROR;
+    }
+
+    OCStackResult ret = OC_STACK_NO_MEMORY;
+    bool wakeup = false;
+    oc_mutex_lock(g_psJournalMutex);
+    PSJournal_t *journal = GetJournal(databaseName);
+    if (journal)
+    {
+        ret = SetEntry(&journal->pending, resourceName, strlen(resourceName), payload, size);
+    }
+    if ((OC_STACK_OK == ret) && (0 < g_psCoalesceMs))
+    {
+        if (0 == g_psFlushDeadline)
+        {
+            g_psFlushDeadline = OICGetCurrentTime(TIME_IN_MS) + g_psCoalesceMs;
+            wakeup = true;
+        }
+    }
+    else if (journal)
+    {
+        OCStackResult flushResult = FlushJournal(ps, journal);
+        ret = (OC_STACK_OK == ret) ? flushResult : ret;
+    }
+    oc_mutex_unlock(g_psJournalMutex);
+
+    // Let a blocked OCProcess() loop pick up the flush deadline.
+    if (wakeup)
+    {
+        CAWakeup();
+    }
+    return ret;
+}
+
+/**
+ * Reads a database with its journal applied.
+ *
+ * @param ps           is a pointer to OCPersistentStorage for the Virtual Resource(s).
+ * @param databaseName is the name of the database to access through persistent storage.
+ * @param resourceName is the name of the field for which file content are read.
+ *                     if the value is NULL it will send the content of the whole database.
+ * @param data         is the pointer to the file contents read from the database.
+ * @param size         is the size of the file contents read.
+ * @param journaled    is set to false if the database has no journal records, in which case
+ *                     nothing is read.
+ *
+ * @return ::OC_STACK_OK for Success, otherwise some error value
+ */
+static OCStackResult ReadJournaledDatabase(const OCPersistentStorage *ps,
+                                           const char *databaseName, const char *resourceName,
+                                           uint8_t **data, size_t *size, bool *journaled)
+{
+    *journaled = false;
+    char *journalName = GetJournalName(databaseName);
+    if (NULL == journalName)
+    {
+        return OC_STACK_NO_MEMORY;
+    }
+    if (0 == GetDatabaseSize(ps, journalName))
+    {
+        OICFree(journalName);
+        return OC_STACK_OK;
+    }
+
+    PSEntry_t *entries = NULL;
+    size_t journalSize = 0;
+    size_t recordsSize = 0;
+    OCStackResult ret = LoadJournaledDatabase(ps, databaseName, journalName, &entries,
+                                              &journalSize, &recordsSize);
+    OICFree(journalName);
+    if ((OC_STACK_OK == ret) && (0 < recordsSize))
+    {
+        *journaled = true;
+        if (resourceName)
+        {
+            PSEntry_t *entry = FindEntry(entries, resourceName, strlen(resourceName));
+            if (entry && entry->payload)
+            {
+                // Hand over the payload instead of copying it.
+                *data = entry->payload;
+                *size = entry->size;
+                entry->payload = NULL;
+            }
+            else
+            {
+                ret = OC_STACK_ERROR;
+            }
+        }
+        else
+        {
+            ret = EncodeDatabase(entries, data, size);
+        }
+    }
+    FreeEntries(entries);
+    return ret;
+}
+
 /**
  * Reads the database from PS
  * 
@@ -173,6 +948,32 @@ OCStackResult ReadDatabaseFromPS(const char *databaseName, const char *resourceN
     OCPersistentStorage *ps = OCGetPersistentStorageHandler();
     VERIFY_NOT_NULL(TAG, ps, ERROR);
 
+    // Updates of the database may be in its journal, or still held back in memory.
+    {
+        bool journaled = false;
+        if (g_psJournalEnabled)
+        {
+            oc_mutex_lock(g_psJournalMutex);
+            PSJournal_t *journal = GetJournal(databaseName);
+            if (journal)
+            {
+                FlushJournal(ps, journal);
+            }
+            ret = ReadJournaledDatabase(ps, databaseName, resourceName, data, size, &journaled);
+            oc_mutex_unlock(g_psJournalMutex);
+        }
+        else
+        {
+            ret = ReadJournaledDatabase(ps, databaseName, resourceName, data, size, &journaled);
+        }
+        if (journaled || (OC_STACK_OK != ret))
+        {
+            OIC_LOG(DEBUG, TAG, "ReadDatabaseFromPS OUT");
+            return ret;
+        }
+        ret = OC_STACK_ERROR;
+    }
+
     fileSize = GetDatabaseSize(ps, databaseName);
     OIC_LOG_V(DEBUG, TAG, "File Read Size: %" PRIuPTR, fileSize);
     if (fileSize)
@@ -239,6 +1040,13 @@ OCStackResult UpdateResourceInPS(const char *databaseName, const char *resourceN
         return OC_STACK_INVALID_PARAM;
     }
 
+    if (g_psJournalEnabled)
+    {
+        OCStackResult ret = UpdateResourceInJournal(databaseName, resourceName, payload, size);
+        OIC_LOG(DEBUG, TAG, "UpdateResourceInPS OUT");
+        return ret;
+    }
+
     size_t dbSize = 0;
     size_t outSize = 0;
     uint8_t *dbData = NULL;
@@ -477,7 +1285,7 @@ OCStackResult UpdateResourceInPS(const char *databaseName, const char *resourceN
         outSize = cbor_encoder_get_buffer_size(&encoder, outPayload);
     }
 
-    ret = WritePayloadToPS(databaseName, outPayload, outSize);
+    ret = WriteDatabaseToPS(databaseName, outPayload, outSize);
     VERIFY_SUCCESS(TAG, (OC_STACK_OK == ret), ERROR);
 
     OIC_LOG(DEBUG, TAG, "UpdateResourceInPS OUT");
@@ -651,7 +1459,7 @@ OCStackResult ResetSecureResourceInPS(void)
             outSize = cbor_encoder_get_buffer_size(&encoder, outPayload);
         }
 
-        ret = WritePayloadToPS(SVR_DB_DAT_FILE_NAME, outPayload, outSize);
+        ret = WriteDatabaseToPS(SVR_DB_DAT_FILE_NAME, outPayload, outSize);
         VERIFY_SUCCESS(TAG, (OC_STACK_OK == ret), ERROR);
     }
 
@@ -794,3 +1602,118 @@ exit:
     OICFree(resetPfCbor);
     return ret;
 }
+
+/**
+ * Turns journaling of database updates on or off.
+ *
+ * @param enabled     if true, updates are appended to a journal next to each database
+ *                    instead of rewriting the database.
+ * @param coalesceMs  is the time updates are held back in memory before they are appended,
+ *                    so that updates in quick succession are written together. 0 appends
+ *                    every update as it is made.
+ *
+ * @return ::OC_STACK_OK for Success, otherwise some error value
+ */
+OCStackResult SetPSJournal(bool enabled, uint32_t coalesceMs)
+{
+    if (enabled)
+    {
+        if (NULL == g_psJournalMutex)
+        {
+            g_psJournalMutex = oc_mutex_new();
+            if (NULL == g_psJournalMutex)
+            {
+                OIC_LOG(ERROR, TAG, "Failed to create journal mutex");
+                return OC_STACK_ERROR;
+            }
+        }
+        oc_mutex_lock(g_psJournalMutex);
+        g_psCoalesceMs = coalesceMs;
+        g_psJournalEnabled = true;
+        oc_mutex_unlock(g_psJournalMutex);
+        if (0 == coalesceMs)
+        {
+            FlushPendingPSUpdates(true);
+        }
+        return OC_STACK_OK;
+    }
+
+    if (NULL == g_psJournalMutex)
+    {
+        return OC_STACK_OK;
+    }
+
+    // Journals left behind are still applied by ReadDatabaseFromPS(), and folded into
+    // the database by its next update.
+    FlushPendingPSUpdates(true);
+    oc_mutex_lock(g_psJournalMutex);
+    g_psJournalEnabled = false;
+    g_psCoalesceMs = 0;
+    PSJournal_t *journal = NULL;
+    PSJournal_t *tmp = NULL;
+    LL_FOREACH_SAFE(g_psJournals, journal, tmp)
+    {
+        LL_DELETE(g_psJournals, journal);
+        FreeEntries(journal->pending);
+        OICFree(journal->databaseName);
+        OICFree(journal->journalName);
+        OICFree(journal);
+    }
+    oc_mutex_unlock(g_psJournalMutex);
+    oc_mutex_free(g_psJournalMutex);
+    g_psJournalMutex = NULL;
+    return OC_STACK_OK;
+}
+
+/**
+ * Appends the updates held back in the coalescing window to the journals.
+ *
+ * @param force  if false, updates are only appended once the window has passed.
+ */
+void FlushPendingPSUpdates(bool force)
+{
+    if (!g_psJournalEnabled)
+    {
+        return;
+    }
+
+    oc_mutex_lock(g_psJournalMutex);
+    if (g_psFlushDeadline &&
+        (force || (OICGetCurrentTime(TIME_IN_MS) >= g_psFlushDeadline)))
+    {
+        OCPersistentStorage *ps = OCGetPersistentStorageHandler();
+        PSJournal_t *journal = NULL;
+        LL_FOREACH(g_psJournals, journal)
+        {
+            if (OC_STACK_OK != FlushJournal(ps, journal))
+            {
+                OIC_LOG_V(ERROR, TAG, "Failed to flush updates of %s", journal->databaseName);
+            }
+        }
+        g_psFlushDeadline = 0;
+    }
+    oc_mutex_unlock(g_psJournalMutex);
+}
+
+/**
+ * Gets the time until the updates held back in the coalescing window are due.
+ *
+ * @return the time in milliseconds, or UINT32_MAX if no update is held back.
+ */
+uint32_t GetPSFlushTimeout(void)
+{
+    if (!g_psJournalEnabled)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t timeout = UINT32_MAX;
+    oc_mutex_lock(g_psJournalMutex);
+    if (g_psFlushDeadline)
+    {
+        uint64_t now = OICGetCurrentTime(TIME_IN_MS);
+        timeout = (now >= g_psFlushDeadline) ? 0 : (uint32_t)(g_psFlushDeadline - now);
+    }
+    oc_mutex_unlock(g_psJournalMutex);
+    return timeout;
+}
@@ -38,6 +38,7 @@
 #include "crlresource.h"
 #include "csrresource.h"
 #include "rolesresource.h"
+#include "ocdiscoverycache.h"
 #endif // __WITH_DTLS__ || __WITH_TLS__
 
 OCStackResult SendSRMResponse(const OCEntityHandlerRequest *ehRequest,
@@ -154,6 +155,9 @@ OCStackResult ResetSecureResources()
         ret = ResetSecureResourceInPS();
     }
 
+    // Reloading /doxm may have given the device another ID.
+    OCDiscoveryCacheInvalidate();
+
     if (OC_STACK_OK != ret)
     {
         OIC_LOG_V(ERROR, TAG, "%s: resetting device to mfr defaults failed!",
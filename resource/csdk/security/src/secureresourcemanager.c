@@ -32,6 +32,7 @@
 #include "srmresourcestrings.h"
 #include "ocresourcehandler.h"
 #include "experimental/ocrandom.h"
+#include "octhread.h"
 
 #if defined( __WITH_TLS__) || defined(__WITH_DTLS__)
 #include "pkix_interface.h"
@@ -46,10 +47,11 @@ static CAResponseCallback gResponseHandler = NULL;
 static CAErrorCallback gErrorHandler = NULL;
 
 /**
- * A single global Request context will suffice as long
- * as SRM is single-threaded.
+ * Serializes permission checks with requests to the security virtual resources, which update
+ * the policy the checks read, when requests are dispatched on several threads. It is kept for
+ * the lifetime of the process since dispatch threads outlive SRMDeInitSecureResources().
  */
-SRMRequestContext_t g_requestContext;
+static oc_mutex g_policyLock = NULL;
 
 void SetRequestedResourceType(SRMRequestContext_t *context)
 {
@@ -274,7 +276,9 @@ void SRMRequestHandler(const CAEndpoint_t *endPoint, const CARequestInfo_t *requ
 {
     OIC_LOG(DEBUG, TAG, "Received request from remote device");
 
-    SRMRequestContext_t *ctx = &g_requestContext; // Always use our single ctx for now.
+    // Requests may be dispatched on several threads, so each one gets its own context.
+    SRMRequestContext_t context;
+    SRMRequestContext_t *ctx = &context;
 
     ClearRequestContext(ctx);
 
@@ -337,15 +341,30 @@ void SRMRequestHandler(const CAEndpoint_t *endPoint, const CARequestInfo_t *requ
     OIC_LOG_V(DEBUG, TAG, "Processing request with uri, %s for method %d",
         ctx->requestInfo->info.resourceUri, ctx->requestInfo->method);
 
+    // Requests to other resources only hold the lock for the check, so their entity
+    // handlers still run concurrently.
+    bool isSvrRequest = (NOT_A_SVR_RESOURCE != ctx->resourceType);
+    oc_mutex_lock(g_policyLock);
+
     CheckPermission(ctx);
 
     OIC_LOG_V(DEBUG, TAG, "Request for permission %d received responseVal %d.",
         ctx->requestedPermission, ctx->responseVal);
 
+    if (!isSvrRequest)
+    {
+        oc_mutex_unlock(g_policyLock);
+    }
+
     // Now that we have determined the correct response and set responseVal,
     // we generate and send the response to the requester.
     SRMGenerateResponse(ctx);
 
+    if (isSvrRequest)
+    {
+        oc_mutex_unlock(g_policyLock);
+    }
+
     if (false == ctx->responseSent)
     {
         OIC_LOG(ERROR, TAG, "Exiting SRM without responding to requester!");
@@ -399,6 +418,16 @@ OCStackResult SRMRegisterHandler(CARequestCallback reqHandler,
     gResponseHandler = respHandler;
     gErrorHandler = errHandler;
 
+    if (NULL == g_policyLock)
+    {
+        g_policyLock = oc_mutex_new_recursive();
+        if (NULL == g_policyLock)
+        {
+            OIC_LOG(ERROR, TAG, "Failed to create policy lock");
+            return OC_STACK_NO_MEMORY;
+        }
+    }
+
 
 #if defined(__WITH_DTLS__) || defined(__WITH_TLS__)
     CARegisterHandler(SRMRequestHandler, SRMResponseHandler, SRMErrorHandler);
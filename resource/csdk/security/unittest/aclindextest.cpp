@@ -0,0 +1,199 @@
+//******************************************************************
+//
+// Copyright 2015 Intel Mobile Communications GmbH All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <gtest/gtest.h>
+#include <coap/utlist.h>
+#include <vector>
+#include "ocstack.h"
+#include "oic_malloc.h"
+#include "oic_string.h"
+#include "srmresourcestrings.h"
+#include "aclresource.h"
+#include "aclindex.h"
+#include "security_internals.h"
+
+namespace
+{
+    OicSecAce_t *AddAce(OicSecAcl_t *acl, OicSecAceSubjectType subjectType)
+    {
+        OicSecAce_t *ace = (OicSecAce_t *)OICCalloc(1, sizeof(OicSecAce_t));
+        ace->subjectType = subjectType;
+        ace->permission = PERMISSION_READ;
+        LL_APPEND(acl->aces, ace);
+        return ace;
+    }
+
+    OicSecAce_t *AddUuidAce(OicSecAcl_t *acl, const char *uuid)
+    {
+        OicSecAce_t *ace = AddAce(acl, OicSecAceUuidSubject);
+        OICStrcpy((char *)ace->subjectuuid.id, sizeof(ace->subjectuuid.id), uuid);
+        return ace;
+    }
+
+    void AddResource(OicSecAce_t *ace, const char *href,
+                     OicSecAceResourceWildcard_t wildcard = NO_WILDCARD)
+    {
+        OicSecRsrc_t *rsrc = (OicSecRsrc_t *)OICCalloc(1, sizeof(OicSecRsrc_t));
+        rsrc->href = href ? OICStrdup(href) : NULL;
+        rsrc->wildcard = wildcard;
+        LL_APPEND(ace->resources, rsrc);
+    }
+
+    std::vector<const OicSecAce_t *> Lookup(const OicSecACLIndex_t *index,
+                                            const OicSecACLIndexSubject_t *subject,
+                                            const char *href,
+                                            OicSecDiscoverable_t discoverable)
+    {
+        std::vector<const OicSecAce_t *> aces;
+        OicSecACECursor_t cursor;
+        InitACECursor(&cursor, index, subject, href, discoverable);
+        for (const OicSecAce_t *ace = GetNextACE(&cursor); ace; ace = GetNextACE(&cursor))
+        {
+            aces.push_back(ace);
+        }
+        return aces;
+    }
+
+    OicUuid_t MakeUuid(const char *id)
+    {
+        OicUuid_t uuid = OicUuid_t();
+        OICStrcpy((char *)uuid.id, sizeof(uuid.id), id);
+        return uuid;
+    }
+}
+
+TEST(ACLIndexTest, NullACL)
+{
+    EXPECT_EQ(NULL, CreateACLIndex(NULL));
+    DeleteACLIndex(NULL);
+}
+
+TEST(ACLIndexTest, HrefAndWildcardsOfSubject)
+{
+    OicSecAcl_t *acl = (OicSecAcl_t *)OICCalloc(1, sizeof(OicSecAcl_t));
+    OicSecAce_t *byHref = AddUuidAce(acl, "SubjectA");
+    AddResource(byHref, "/a");
+    AddResource(byHref, "/b");
+    OicSecAce_t *discoverable = AddUuidAce(acl, "SubjectA");
+    AddResource(discoverable, NULL, ALL_DISCOVERABLE);
+    OicSecAce_t *all = AddUuidAce(acl, "SubjectA");
+    AddResource(all, WILDCARD_RESOURCE_URI);
+    OicSecAce_t *other = AddUuidAce(acl, "SubjectB");
+    AddResource(other, "/a");
+
+    OicSecACLIndex_t *index = CreateACLIndex(acl);
+    ASSERT_TRUE(NULL != index);
+
+    OicUuid_t uuidA = MakeUuid("SubjectA");
+    const OicSecACLIndexSubject_t *subjectA = FindACLIndexSubjectByUuid(index, &uuidA);
+    ASSERT_TRUE(NULL != subjectA);
+
+    std::vector<const OicSecAce_t *> aces = Lookup(index, subjectA, "/a", DISCOVERABLE_TRUE);
+    ASSERT_EQ(3u, aces.size());
+    EXPECT_EQ(byHref, aces[0]);
+    EXPECT_EQ(all, aces[1]);
+    EXPECT_EQ(discoverable, aces[2]);
+
+    aces = Lookup(index, subjectA, "/b", DISCOVERABLE_FALSE);
+    ASSERT_EQ(2u, aces.size());
+    EXPECT_EQ(byHref, aces[0]);
+    EXPECT_EQ(all, aces[1]);
+
+    aces = Lookup(index, subjectA, "/c", DISCOVERABLE_NOT_KNOWN);
+    ASSERT_EQ(1u, aces.size());
+    EXPECT_EQ(all, aces[0]);
+
+    OicUuid_t uuidB = MakeUuid("SubjectB");
+    const OicSecACLIndexSubject_t *subjectB = FindACLIndexSubjectByUuid(index, &uuidB);
+    ASSERT_TRUE(NULL != subjectB);
+    EXPECT_EQ(1u, Lookup(index, subjectB, "/a", DISCOVERABLE_TRUE).size());
+    EXPECT_TRUE(Lookup(index, subjectB, "/b", DISCOVERABLE_TRUE).empty());
+
+    size_t orderA = 0;
+    size_t orderB = 0;
+    EXPECT_EQ(all, GetACLIndexSubjectLastACE(subjectA, &orderA));
+    EXPECT_EQ(other, GetACLIndexSubjectLastACE(subjectB, &orderB));
+    EXPECT_LT(orderA, orderB);
+
+    OicUuid_t uuidC = MakeUuid("SubjectC");
+    EXPECT_EQ(NULL, FindACLIndexSubjectByUuid(index, &uuidC));
+
+    DeleteACLIndex(index);
+    DeleteACLList(acl);
+}
+
+TEST(ACLIndexTest, RoleAndConntypeSubjects)
+{
+    OicSecAcl_t *acl = (OicSecAcl_t *)OICCalloc(1, sizeof(OicSecAcl_t));
+    OicSecAce_t *anon = AddAce(acl, OicSecAceConntypeSubject);
+    anon->subjectConn = ANON_CLEAR;
+    AddResource(anon, "/oic/res");
+    OicSecAce_t *role = AddAce(acl, OicSecAceRoleSubject);
+    OICStrcpy(role->subjectRole.id, sizeof(role->subjectRole.id), "admin");
+    OICStrcpy(role->subjectRole.authority, sizeof(role->subjectRole.authority), "local");
+    AddResource(role, "/light");
+
+    OicSecACLIndex_t *index = CreateACLIndex(acl);
+    ASSERT_TRUE(NULL != index);
+
+    const OicSecACLIndexSubject_t *subject = FindACLIndexSubjectByConntype(index, ANON_CLEAR);
+    ASSERT_TRUE(NULL != subject);
+    EXPECT_EQ(1u, Lookup(index, subject, "/oic/res", DISCOVERABLE_TRUE).size());
+    EXPECT_EQ(NULL, FindACLIndexSubjectByConntype(index, AUTH_CRYPT));
+
+    OicSecRole_t asserted = OicSecRole_t();
+    OICStrcpy(asserted.id, sizeof(asserted.id), "admin");
+    OICStrcpy(asserted.authority, sizeof(asserted.authority), "local");
+    subject = FindACLIndexSubjectByRole(index, &asserted);
+    ASSERT_TRUE(NULL != subject);
+    std::vector<const OicSecAce_t *> aces = Lookup(index, subject, "/light", DISCOVERABLE_TRUE);
+    ASSERT_EQ(1u, aces.size());
+    EXPECT_EQ(role, aces[0]);
+
+    OICStrcpy(asserted.authority, sizeof(asserted.authority), "other");
+    EXPECT_EQ(NULL, FindACLIndexSubjectByRole(index, &asserted));
+
+    DeleteACLIndex(index);
+    DeleteACLList(acl);
+}
+
+TEST(ACLIndexTest, RebuiltWhenACLChanges)
+{
+    OicSecAcl_t *acl = (OicSecAcl_t *)OICCalloc(1, sizeof(OicSecAcl_t));
+    AddResource(AddUuidAce(acl, "SubjectA"), "/a");
+
+    EXPECT_EQ(OC_STACK_OK, SetDefaultACL(acl));
+    const OicSecACLIndex_t *index = GetACLIndex();
+    ASSERT_TRUE(NULL != index);
+    OicUuid_t uuid = MakeUuid("SubjectA");
+    EXPECT_TRUE(NULL != FindACLIndexSubjectByUuid(index, &uuid));
+
+    OicSecAcl_t *other = (OicSecAcl_t *)OICCalloc(1, sizeof(OicSecAcl_t));
+    AddResource(AddUuidAce(other, "SubjectB"), "/a");
+    EXPECT_EQ(OC_STACK_OK, SetDefaultACL(other));
+    index = GetACLIndex();
+    ASSERT_TRUE(NULL != index);
+    EXPECT_EQ(NULL, FindACLIndexSubjectByUuid(index, &uuid));
+
+    EXPECT_EQ(OC_STACK_OK, SetDefaultACL(NULL));
+    EXPECT_EQ(NULL, GetACLIndex());
+    DeleteACLList(acl);
+    DeleteACLList(other);
+}
@@ -345,4 +345,83 @@ TEST(IsRequestWithinValidTimeTest, IsRequestWithinValidTimeInValidPeriodAndValid
     EXPECT_EQ(IOTVTICAL_INVALID_ACCESS, IsRequestWithinValidTime(periodStr, recurStr));
 }
 
+//CompileValidTime Tests
+static time_t localTime(int year, int mon, int mday, int hour, int min, int sec,
+                        IotvtICalDateTime_t *dateTime)
+{
+    memset(dateTime, 0, sizeof(*dateTime));
+    dateTime->tm_year = year - TM_YEAR_OFFSET;
+    dateTime->tm_mon = mon - 1;
+    dateTime->tm_mday = mday;
+    dateTime->tm_hour = hour;
+    dateTime->tm_min = min;
+    dateTime->tm_sec = sec;
+    dateTime->tm_isdst = -1;
+    return mktime(dateTime);
+}
+
+TEST(CompileValidTimeTest, CompileValidTimeInvalidInput)
+{
+    IotvtICalRule_t rule;
+    EXPECT_EQ(IOTVTICAL_INVALID_PARAMETER, CompileValidTime(NULL, NULL, &rule));
+    EXPECT_EQ(IOTVTICAL_INVALID_PARAMETER, CompileValidTime("20150630/20150730", NULL, NULL));
+    EXPECT_EQ(IOTVTICAL_INVALID_PERIOD, CompileValidTime("20150730/20150630", NULL, &rule));
+    EXPECT_EQ(IOTVTICAL_INVALID_RRULE,
+              CompileValidTime("20150630/20150730", "BYDAY=MO, WE, FR", &rule));
+}
+
+TEST(CompileValidTimeTest, IsTimeWithinValidRule)
+{
+    //Daily forever on days MO, WE & Fr from 6:00:00am to 8:00:00pm
+    IotvtICalRule_t rule;
+    ASSERT_EQ(IOTVTICAL_SUCCESS, CompileValidTime("20150630T060000/20150630T200000",
+                                                  "FREQ=DAILY; BYDAY=MO, WE, FR", &rule));
+
+    IotvtICalDateTime_t currentTime;
+    localTime(2015, 7, 1, 10, 0, 0, &currentTime);  //Wednesday
+    EXPECT_EQ(IOTVTICAL_VALID_ACCESS, IsTimeWithinValidRule(&rule, &currentTime));
+    localTime(2015, 7, 1, 20, 0, 1, &currentTime);
+    EXPECT_EQ(IOTVTICAL_INVALID_ACCESS, IsTimeWithinValidRule(&rule, &currentTime));
+    localTime(2015, 7, 2, 10, 0, 0, &currentTime);  //Thursday
+    EXPECT_EQ(IOTVTICAL_INVALID_ACCESS, IsTimeWithinValidRule(&rule, &currentTime));
+
+    //Same period without recurrence
+    ASSERT_EQ(IOTVTICAL_SUCCESS, CompileValidTime("20150630T060000/20150630T200000",
+                                                  NULL, &rule));
+    localTime(2015, 6, 30, 10, 0, 0, &currentTime);
+    EXPECT_EQ(IOTVTICAL_VALID_ACCESS, IsTimeWithinValidRule(&rule, &currentTime));
+    localTime(2015, 7, 1, 10, 0, 0, &currentTime);
+    EXPECT_EQ(IOTVTICAL_INVALID_ACCESS, IsTimeWithinValidRule(&rule, &currentTime));
+}
+
+TEST(CompileValidTimeTest, GetValidRuleNextBoundary)
+{
+    IotvtICalRule_t rule;
+    ASSERT_EQ(IOTVTICAL_SUCCESS, CompileValidTime("20150630T063000/20150630T200000",
+                                                  "FREQ=DAILY", &rule));
+
+    IotvtICalDateTime_t currentTime;
+    IotvtICalDateTime_t expected;
+
+    //Period start
+    time_t now = localTime(2015, 7, 1, 6, 10, 0, &currentTime);
+    EXPECT_EQ(localTime(2015, 7, 1, 6, 30, 0, &expected),
+              GetValidRuleNextBoundary(&rule, now, &currentTime));
+
+    //Period end is inclusive, so the result changes a second later
+    now = localTime(2015, 7, 1, 20, 0, 0, &currentTime);
+    EXPECT_EQ(localTime(2015, 7, 1, 20, 0, 1, &expected),
+              GetValidRuleNextBoundary(&rule, now, &currentTime));
+
+    //No boundary of the period within the hour
+    now = localTime(2015, 7, 1, 12, 15, 0, &currentTime);
+    EXPECT_EQ(localTime(2015, 7, 1, 13, 0, 0, &expected),
+              GetValidRuleNextBoundary(&rule, now, &currentTime));
+
+    //Midnight
+    now = localTime(2015, 7, 1, 23, 59, 59, &currentTime);
+    EXPECT_EQ(localTime(2015, 7, 2, 0, 0, 0, &expected),
+              GetValidRuleNextBoundary(&rule, now, &currentTime));
+}
+
 #endif
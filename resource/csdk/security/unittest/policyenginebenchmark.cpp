@@ -0,0 +1,160 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Benchmark of the ACE lookup behind CheckPermission(). ACLs of generated ACEs are searched
+// for the ACEs of one subject that name one resource, once by walking the ACL as
+// GetACLResourceData() does and once through the ACL index, and the cost per lookup is
+// reported for each ACL size.
+
+#include <gtest/gtest.h>
+#include <coap/utlist.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "ocstack.h"
+#include "oic_malloc.h"
+#include "oic_string.h"
+#include "aclresource.h"
+#include "aclindex.h"
+#include "security_internals.h"
+
+namespace
+{
+    const size_t ACE_COUNTS[] = { 100, 1000, 10000 };
+    const size_t ACES_PER_SUBJECT = 10;
+    const size_t HREFS_PER_ACE = 2;
+    const size_t WALK_LOOKUPS = 2000;
+    const size_t INDEX_LOOKUPS = 200000;
+
+    OicUuid_t SubjectUuid(size_t subject)
+    {
+        OicUuid_t uuid = OicUuid_t();
+        snprintf((char *)uuid.id, sizeof(uuid.id), "bench%010zu", subject);
+        return uuid;
+    }
+
+    void Href(char *href, size_t size, size_t ace, size_t rsrc)
+    {
+        snprintf(href, size, "/bench/%zu/%zu", ace, rsrc);
+    }
+
+    OicSecAcl_t *GenerateACL(size_t aceCount)
+    {
+        OicSecAcl_t *acl = (OicSecAcl_t *)OICCalloc(1, sizeof(OicSecAcl_t));
+        for (size_t i = 0; i < aceCount; i++)
+        {
+            OicSecAce_t *ace = (OicSecAce_t *)OICCalloc(1, sizeof(OicSecAce_t));
+            ace->subjectType = OicSecAceUuidSubject;
+            ace->subjectuuid = SubjectUuid(i % (aceCount / ACES_PER_SUBJECT));
+            ace->permission = PERMISSION_READ;
+            for (size_t r = 0; r < HREFS_PER_ACE; r++)
+            {
+                char href[MAX_URI_LENGTH];
+                Href(href, sizeof(href), i, r);
+                OicSecRsrc_t *rsrc = (OicSecRsrc_t *)OICCalloc(1, sizeof(OicSecRsrc_t));
+                rsrc->href = OICStrdup(href);
+                LL_APPEND(ace->resources, rsrc);
+            }
+            LL_APPEND(acl->aces, ace);
+        }
+        return acl;
+    }
+
+    // The search CheckPermission() did before the index: every ACE of the subject, in ACL
+    // order, checked for the href.
+    size_t WalkLookup(const OicUuid_t *subject, const char *href)
+    {
+        size_t found = 0;
+        OicSecAce_t *savePtr = NULL;
+        const OicSecAce_t *ace = NULL;
+        while (NULL != (ace = GetACLResourceData(subject, &savePtr)))
+        {
+            const OicSecRsrc_t *rsrc = NULL;
+            LL_FOREACH(ace->resources, rsrc)
+            {
+                if (rsrc->href && 0 == strcmp(rsrc->href, href))
+                {
+                    found++;
+                    break;
+                }
+            }
+        }
+        return found;
+    }
+
+    size_t IndexLookup(const OicUuid_t *subject, const char *href)
+    {
+        const OicSecACLIndex_t *index = GetACLIndex();
+        OicSecACECursor_t cursor;
+        InitACECursor(&cursor, index, FindACLIndexSubjectByUuid(index, subject), href,
+                      DISCOVERABLE_TRUE);
+        size_t found = 0;
+        while (NULL != GetNextACE(&cursor))
+        {
+            found++;
+        }
+        return found;
+    }
+
+    double Measure(size_t aceCount, size_t lookups, size_t (*lookup)(const OicUuid_t *,
+                                                                      const char *))
+    {
+        size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups; i++)
+        {
+            // Spread the lookups over the ACL; the subject of ACE n is n % subjectCount.
+            size_t ace = (i * 7919) % aceCount;
+            OicUuid_t subject = SubjectUuid(ace % (aceCount / ACES_PER_SUBJECT));
+            char href[MAX_URI_LENGTH];
+            Href(href, sizeof(href), ace, i % HREFS_PER_ACE);
+            found += lookup(&subject, href);
+        }
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        EXPECT_EQ(lookups, found);
+        return seconds * 1e9 / lookups;
+    }
+}
+
+TEST(PolicyEngineBenchmark, ACLWalkVersusIndex)
+{
+    for (size_t aceCount : ACE_COUNTS)
+    {
+        OicSecAcl_t *acl = GenerateACL(aceCount);
+        ASSERT_EQ(OC_STACK_OK, SetDefaultACL(acl));
+
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_TRUE(NULL != GetACLIndex());
+        double buildMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+
+        double walkNs = Measure(aceCount, WALK_LOOKUPS, WalkLookup);
+        double indexNs = Measure(aceCount, INDEX_LOOKUPS, IndexLookup);
+        std::cout << "aces=" << aceCount
+                  << " walk=" << walkNs << "ns/lookup"
+                  << " index=" << indexNs << "ns/lookup"
+                  << " index build=" << buildMs << "ms" << std::endl;
+
+        ASSERT_EQ(OC_STACK_OK, SetDefaultACL(NULL));
+        DeleteACLList(acl);
+    }
+}
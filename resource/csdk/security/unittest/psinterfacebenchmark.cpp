@@ -0,0 +1,139 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Benchmark of secure resource persistence while a device is provisioned. Every step adds
+// an ACE and a credential, and the ACL and credential resources are written with their
+// grown payloads, as the provisioning handlers do. The provisioned device then goes
+// through updates of its small resources, pstat and doxm. The time and the bytes written
+// to storage are reported with the database rewritten on every update, with the journal,
+// and with the journal coalescing the updates of a burst of steps.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include "ocstack.h"
+#include "oic_malloc.h"
+#include "psinterface.h"
+#include "srmresourcestrings.h"
+
+namespace
+{
+    const char DB_NAME[] = "psinterfacebenchmark.dat";
+    const char JOURNAL_NAME[] = "psinterfacebenchmark.dat.jnl";
+    const size_t PROVISIONING_STEPS = 500;
+    const size_t ACE_SIZE = 120;
+    const size_t CRED_SIZE = 150;
+    const size_t STEPS_PER_BURST = 10;
+    const size_t SMALL_UPDATES = 1000;
+    const size_t SMALL_RESOURCE_SIZE = 100;
+
+    size_t g_bytesWritten = 0;
+
+    size_t CountingWrite(const void *ptr, size_t size, size_t count, FILE *stream)
+    {
+        size_t written = fwrite(ptr, size, count, stream);
+        g_bytesWritten += written * size;
+        return written;
+    }
+
+    OCPersistentStorage g_ps = { fopen, fread, CountingWrite, fclose, remove };
+
+    void Report(const char *phase, bool journal, uint32_t coalesceMs, size_t updates,
+                std::chrono::steady_clock::time_point start)
+    {
+        double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+        std::cout << phase << " "
+                  << (journal ? (coalesceMs ? "journal+coalesce" : "journal") : "rewrite")
+                  << " updates=" << updates
+                  << " time=" << ms << "ms"
+                  << " written=" << g_bytesWritten / 1024 << "KiB" << std::endl;
+        g_bytesWritten = 0;
+    }
+
+    void Provision(bool journal, uint32_t coalesceMs)
+    {
+        remove(DB_NAME);
+        remove(JOURNAL_NAME);
+        ASSERT_EQ(OC_STACK_OK, SetPSJournal(journal, coalesceMs));
+        g_bytesWritten = 0;
+
+        std::vector<uint8_t> acl;
+        std::vector<uint8_t> cred;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t step = 1; step <= PROVISIONING_STEPS; step++)
+        {
+            acl.resize(step * ACE_SIZE, (uint8_t)step);
+            cred.resize(step * CRED_SIZE, (uint8_t)step);
+            ASSERT_EQ(OC_STACK_OK, UpdateResourceInPS(DB_NAME, OIC_JSON_ACL_NAME,
+                                                      acl.data(), acl.size()));
+            ASSERT_EQ(OC_STACK_OK, UpdateResourceInPS(DB_NAME, OIC_JSON_CRED_NAME,
+                                                      cred.data(), cred.size()));
+            // Stands in for OCProcess() passing the end of the coalescing window.
+            if (coalesceMs && (0 == step % STEPS_PER_BURST))
+            {
+                FlushPendingPSUpdates(true);
+            }
+        }
+        FlushPendingPSUpdates(true);
+        Report("provision", journal, coalesceMs, 2 * PROVISIONING_STEPS, start);
+
+        std::vector<uint8_t> small(SMALL_RESOURCE_SIZE);
+        start = std::chrono::steady_clock::now();
+        for (size_t update = 1; update <= SMALL_UPDATES; update++)
+        {
+            small.assign(SMALL_RESOURCE_SIZE, (uint8_t)update);
+            ASSERT_EQ(OC_STACK_OK, UpdateResourceInPS(DB_NAME, (update % 2) ?
+                                                      OIC_JSON_PSTAT_NAME : OIC_JSON_DOXM_NAME,
+                                                      small.data(), small.size()));
+            if (coalesceMs && (0 == update % STEPS_PER_BURST))
+            {
+                FlushPendingPSUpdates(true);
+            }
+        }
+        FlushPendingPSUpdates(true);
+        Report("small", journal, coalesceMs, SMALL_UPDATES, start);
+
+        uint8_t *data = NULL;
+        size_t size = 0;
+        ASSERT_EQ(OC_STACK_OK, ReadDatabaseFromPS(DB_NAME, OIC_JSON_CRED_NAME, &data, &size));
+        EXPECT_EQ(cred.size(), size);
+        OICFree(data);
+        data = NULL;
+        ASSERT_EQ(OC_STACK_OK, ReadDatabaseFromPS(DB_NAME, OIC_JSON_DOXM_NAME, &data, &size));
+        EXPECT_EQ(small, std::vector<uint8_t>(data, data + size));
+        OICFree(data);
+
+        ASSERT_EQ(OC_STACK_OK, SetPSJournal(false, 0));
+        remove(DB_NAME);
+        remove(JOURNAL_NAME);
+    }
+}
+
+TEST(PSInterfaceBenchmark, ProvisionManyAcesAndCreds)
+{
+    ASSERT_EQ(OC_STACK_OK, OCRegisterPersistentStorageHandler(&g_ps));
+    Provision(false, 0);
+    Provision(true, 0);
+    Provision(true, 1000);
+    EXPECT_EQ(OC_STACK_OK, OCRegisterPersistentStorageHandler(NULL));
+}
@@ -0,0 +1,219 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "ocstack.h"
+#include "oic_malloc.h"
+#include "psinterface.h"
+#include "srmresourcestrings.h"
+#include "srmtestcommon.h"
+
+namespace
+{
+    const char DB_NAME[] = "psinterfacetest.dat";
+    const char JOURNAL_NAME[] = "psinterfacetest.dat.jnl";
+
+    size_t FileSize(const char *name)
+    {
+        FILE *fp = fopen(name, "rb");
+        if (NULL == fp)
+        {
+            return 0;
+        }
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fclose(fp);
+        return (size > 0) ? (size_t)size : 0;
+    }
+
+    std::vector<uint8_t> Payload(char fill, size_t size)
+    {
+        return std::vector<uint8_t>(size, (uint8_t)fill);
+    }
+
+    OCStackResult Update(const char *resourceName, const std::vector<uint8_t> &payload)
+    {
+        return UpdateResourceInPS(DB_NAME, resourceName, payload.data(), payload.size());
+    }
+
+    std::vector<uint8_t> Read(const char *resourceName)
+    {
+        uint8_t *data = NULL;
+        size_t size = 0;
+        std::vector<uint8_t> payload;
+        if (OC_STACK_OK == ReadDatabaseFromPS(DB_NAME, resourceName, &data, &size))
+        {
+            payload.assign(data, data + size);
+        }
+        OICFree(data);
+        return payload;
+    }
+}
+
+class PSInterfaceTest : public ::testing::Test
+{
+protected:
+    void SetUp()
+    {
+        remove(DB_NAME);
+        remove(JOURNAL_NAME);
+        SetPersistentHandler(&m_ps, true);
+    }
+
+    void TearDown()
+    {
+        EXPECT_EQ(OC_STACK_OK, SetPSJournal(false, 0));
+        SetPersistentHandler(&m_ps, false);
+        remove(DB_NAME);
+        remove(JOURNAL_NAME);
+    }
+
+    OCPersistentStorage m_ps;
+};
+
+TEST_F(PSInterfaceTest, JournaledUpdatesAreReadBack)
+{
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 0));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('a', 100)));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_CRED_NAME, Payload('c', 200)));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('b', 150)));
+
+    EXPECT_EQ(0u, FileSize(DB_NAME));
+    EXPECT_LT(0u, FileSize(JOURNAL_NAME));
+    EXPECT_EQ(Payload('b', 150), Read(OIC_JSON_ACL_NAME));
+    EXPECT_EQ(Payload('c', 200), Read(OIC_JSON_CRED_NAME));
+    EXPECT_TRUE(Read(OIC_JSON_DOXM_NAME).empty());
+
+    uint8_t *data = NULL;
+    size_t size = 0;
+    ASSERT_EQ(OC_STACK_OK, ReadDatabaseFromPS(DB_NAME, NULL, &data, &size));
+    EXPECT_LT(350u, size);
+    OICFree(data);
+}
+
+TEST_F(PSInterfaceTest, RemovedResourceIsNotReadBack)
+{
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 0));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('a', 100)));
+    ASSERT_EQ(OC_STACK_OK, UpdateResourceInPS(DB_NAME, OIC_JSON_ACL_NAME, NULL, 0));
+    EXPECT_TRUE(Read(OIC_JSON_ACL_NAME).empty());
+}
+
+TEST_F(PSInterfaceTest, JournalIsReplayedAfterRestart)
+{
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 0));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('a', 100)));
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(false, 0));
+
+    // Read without the journal enabled, then with it.
+    EXPECT_EQ(Payload('a', 100), Read(OIC_JSON_ACL_NAME));
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 0));
+    EXPECT_EQ(Payload('a', 100), Read(OIC_JSON_ACL_NAME));
+}
+
+TEST_F(PSInterfaceTest, TornRecordIsIgnored)
+{
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 0));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('a', 100)));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('b', 100)));
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(false, 0));
+
+    // Cut the last record short, as a crash in the middle of the append would.
+    size_t journalSize = FileSize(JOURNAL_NAME);
+    std::vector<uint8_t> journal(journalSize);
+    FILE *fp = fopen(JOURNAL_NAME, "rb");
+    ASSERT_TRUE(NULL != fp);
+    ASSERT_EQ(journalSize, fread(journal.data(), 1, journalSize, fp));
+    fclose(fp);
+    fp = fopen(JOURNAL_NAME, "wb");
+    ASSERT_TRUE(NULL != fp);
+    ASSERT_EQ(journalSize - 10, fwrite(journal.data(), 1, journalSize - 10, fp));
+    fclose(fp);
+
+    EXPECT_EQ(Payload('a', 100), Read(OIC_JSON_ACL_NAME));
+
+    // The torn record must not hide the records appended after it.
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 0));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_CRED_NAME, Payload('c', 100)));
+    EXPECT_EQ(Payload('a', 100), Read(OIC_JSON_ACL_NAME));
+    EXPECT_EQ(Payload('c', 100), Read(OIC_JSON_CRED_NAME));
+}
+
+TEST_F(PSInterfaceTest, JournalIsCompacted)
+{
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 0));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_CRED_NAME, Payload('c', 100)));
+    for (char fill = 'a'; fill <= 'z'; fill++)
+    {
+        ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload(fill, 8 * 1024)));
+    }
+
+    // 26 records of 8 KiB pass the 64 KiB threshold once.
+    EXPECT_LT(0u, FileSize(DB_NAME));
+    EXPECT_GT(64u * 1024, FileSize(JOURNAL_NAME));
+    EXPECT_EQ(Payload('z', 8 * 1024), Read(OIC_JSON_ACL_NAME));
+    EXPECT_EQ(Payload('c', 100), Read(OIC_JSON_CRED_NAME));
+}
+
+TEST_F(PSInterfaceTest, UpdateWithoutJournalFoldsJournal)
+{
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 0));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('a', 100)));
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(false, 0));
+
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_CRED_NAME, Payload('c', 100)));
+    EXPECT_EQ(0u, FileSize(JOURNAL_NAME));
+    EXPECT_EQ(Payload('a', 100), Read(OIC_JSON_ACL_NAME));
+    EXPECT_EQ(Payload('c', 100), Read(OIC_JSON_CRED_NAME));
+}
+
+TEST_F(PSInterfaceTest, CoalescedUpdatesAreWrittenTogether)
+{
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 60000));
+    EXPECT_EQ(UINT32_MAX, GetPSFlushTimeout());
+
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('a', 100)));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('b', 100)));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_CRED_NAME, Payload('c', 100)));
+    EXPECT_EQ(0u, FileSize(JOURNAL_NAME));
+    EXPECT_GE(60000u, GetPSFlushTimeout());
+
+    FlushPendingPSUpdates(false);
+    EXPECT_EQ(0u, FileSize(JOURNAL_NAME));
+
+    FlushPendingPSUpdates(true);
+    EXPECT_EQ(UINT32_MAX, GetPSFlushTimeout());
+    size_t journalSize = FileSize(JOURNAL_NAME);
+    EXPECT_LT(0u, journalSize);
+    EXPECT_GT(300u, journalSize);
+    EXPECT_EQ(Payload('b', 100), Read(OIC_JSON_ACL_NAME));
+    EXPECT_EQ(Payload('c', 100), Read(OIC_JSON_CRED_NAME));
+}
+
+TEST_F(PSInterfaceTest, ReadFlushesCoalescedUpdates)
+{
+    ASSERT_EQ(OC_STACK_OK, SetPSJournal(true, 60000));
+    ASSERT_EQ(OC_STACK_OK, Update(OIC_JSON_ACL_NAME, Payload('a', 100)));
+    EXPECT_EQ(Payload('a', 100), Read(OIC_JSON_ACL_NAME));
+}
@@ -319,6 +319,12 @@ INLINE_API void OCPayloadLogSecurity(LogLevel level, OCSecurityPayload* payload)
     }
 }
 
+INLINE_API void OCPayloadLogEncoded(LogLevel level, OCEncodedPayload* payload)
+{
+    OIC_LOG(level, PL_TAG, "Payload Type: Encoded");
+    OIC_LOG_BUFFER(level, PL_TAG, payload->cborPayload.bytes, payload->cborPayload.len);
+}
+
 INLINE_API void OCPayloadLog(LogLevel level, OCPayload* payload)
 {
     if(!payload)
@@ -340,6 +346,9 @@ INLINE_API void OCPayloadLog(LogLevel level, OCPayload* payload)
         case PAYLOAD_TYPE_SECURITY:
             OCPayloadLogSecurity(level, (OCSecurityPayload*)payload);
             break;
+        case PAYLOAD_TYPE_ENCODED:
+            OCPayloadLogEncoded(level, (OCEncodedPayload*)payload);
+            break;
         default:
             OIC_LOG_V(level, PL_TAG, "Unknown Payload Type: %d", payload->type);
             break;
@@ -31,6 +31,7 @@
 #include "ocstack.h"
 #include "ocresource.h"
 #include "cacommon.h"
+#include "ochashtable.h"
 
 
 #ifdef __cplusplus
@@ -130,8 +131,22 @@ typedef struct ClientCB {
 
     /** next node in this list.*/
     struct ClientCB    *next;
+
+    /** link into the token index.*/
+    OCHashLink tokenLink;
+
+    /** link into the handle index.*/
+    OCHashLink handleLink;
+
+    /** Position in the timeout heap, or CLIENTCB_NOT_IN_HEAP when the TTL is 0.*/
+    size_t heapIndex;
 } ClientCB;
 
+/**
+ * Value of ClientCB::heapIndex for callbacks that never time out.
+ */
+#define CLIENTCB_NOT_IN_HEAP ((size_t)-1)
+
 //TODO: Now ocstack is directly accessing the clientCB list to process presence.
 //      It should be avoided after we make a presence feature separately.
 /**
@@ -194,6 +209,29 @@ void DeleteClientCB(ClientCB *cbNode);
  */
 void DeleteClientCBList();
 
+/**
+ * Change the time to live of a callback node and reschedule its timeout.
+ *
+ * @param[in]  cbNode               Address to client callback node.
+ * @param[in]  ttl                  New time to live in coap_ticks, 0 to never time out.
+ */
+void SetClientCBTimeout(ClientCB *cbNode, uint32_t ttl);
+
+/**
+ * Delete every callback node whose time to live has passed. Runs in time proportional to
+ * the number of expired nodes, so it is cheap to call on every OCProcess iteration.
+ */
+void DeleteTimedOutClientCBs();
+
+/**
+ * Get the time to live of the callback node that times out first.
+ *
+ * @param[out] ttl                  Time to live in coap_ticks.
+ *
+ * @return true if a callback node has a time to live, otherwise false
+ */
+bool GetEarliestClientCBTTL(uint32_t *ttl);
+
 /**
  * This method is used to search and retrieve a cb node in cbList using token.
  *
@@ -0,0 +1,128 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+/**
+ * @file
+ *
+ * This file contains the cache of encoded discovery responses. A response to /oic/res
+ * only depends on the resources hosted by the stack, the query filters, the accepted
+ * format and the network the request came in on, so the encoded bytes are kept and sent
+ * again to the next request with the same key until a resource or the network changes.
+ */
+
+#ifndef OC_DISCOVERY_CACHE_H_
+#define OC_DISCOVERY_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "octypes.h"
+#include "ocresourcehandler.h"
+#include "ocserverrequest.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * What a discovery response depends on besides the resources themselves.
+ */
+typedef struct
+{
+    /** Virtual resource the request was sent to.*/
+    OCVirtualResources uri;
+
+    /** Interface filter of the request, after the default has been applied.*/
+    const char *interfaceQuery;
+
+    /** Resource type filter of the request, or NULL.*/
+    const char *resourceTypeQuery;
+} OCDiscoveryCacheKey;
+
+/**
+ * Create the lock of the discovery cache.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult InitializeDiscoveryCache(void);
+
+/**
+ * Release every cached response and the lock of the discovery cache.
+ */
+void TerminateDiscoveryCache(void);
+
+/**
+ * Get the current generation of the discovery cache. Read it before the discovery
+ * payload is built and pass it to OCDiscoveryCacheSendAndStore().
+ *
+ * @return current generation.
+ */
+int32_t OCDiscoveryCacheGetGeneration(void);
+
+/**
+ * Mark every cached response as stale. Call it after anything that shows in a discovery
+ * response has changed. Does not take any lock.
+ */
+void OCDiscoveryCacheInvalidate(void);
+
+/**
+ * Copy the cached response for a request, if there is one that is still current. The
+ * lock of the cache is only held while the bytes are copied.
+ *
+ * @param[in]  request      Discovery request the response is for.
+ * @param[in]  key          Filters of the request.
+ * @param[out] copy         Copy of the response. Release it with ClearNotificationCache().
+ *
+ * @return true if there was a current response to copy.
+ */
+bool OCDiscoveryCacheCopy(const OCServerRequest *request, const OCDiscoveryCacheKey *key,
+                          OCNotificationCache *copy);
+
+/**
+ * Send the cached response for a request, if there is one. The response is sent after
+ * the lock of the cache has been released.
+ *
+ * @param[in]  request      Discovery request to respond to.
+ * @param[in]  key          Filters of the request.
+ *
+ * @return true if the cached response was sent, false if the payload has to be built.
+ */
+bool OCDiscoveryCacheSend(OCServerRequest *request, const OCDiscoveryCacheKey *key);
+
+/**
+ * Send a discovery payload and keep its encoding for the next requests with the same key.
+ * The cache is only locked to store the encoding once the response has been sent.
+ *
+ * @param[in]  request      Discovery request to respond to.
+ * @param[in]  key          Filters of the request.
+ * @param[in]  generation   Generation read before the payload was built.
+ * @param[in]  payload      Discovery payload to send.
+ *
+ * @return result of sending the response.
+ */
+OCStackResult OCDiscoveryCacheSendAndStore(OCServerRequest *request,
+                                           const OCDiscoveryCacheKey *key,
+                                           int32_t generation, OCPayload *payload);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif // OC_DISCOVERY_CACHE_H_
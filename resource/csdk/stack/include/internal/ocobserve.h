@@ -30,6 +30,7 @@
 #define OC_OBSERVE_H
 
 #include "cacommon.h"
+#include "ochashtable.h"
 
 /** Maximum number of observers to reach */
 
@@ -100,12 +101,21 @@ typedef struct ResourceObserver
     /** next node in this list.*/
     struct ResourceObserver *next;
 
+    /** link into the observation ID index of the resource.*/
+    OCHashLink idLink;
+
     /** requested payload encoding format. */
     OCPayloadFormat acceptFormat;
 
     /** requested payload content version. */
     uint16_t acceptVersion;
 
+    /** Number of notifications being sent to the observer without the observer lock.*/
+    uint32_t refCount;
+
+    /** Set when the observer was deleted while notifications to it were being sent.*/
+    bool deletePending;
+
 } ResourceObserver;
 
 #ifdef WITH_PRESENCE
@@ -143,14 +153,15 @@ OCStackResult SendAllObserverNotification (OCMethod method, OCResource *resPtr,
  * @param resource                  Observed resource.
  * @param obsIdList                 List of observation ids that need to be notified.
  * @param numberOfIds               Number of observation ids included in obsIdList.
- * @param payload                   JSON encoded payload to send in notification.
+ * @param payload                   Representation to send in notification.  It is encoded
+ *                                  once per accept format and version of the observers.
  * @param maxAge                    Time To Live (in seconds) of observation.
  * @param qos                       Desired quality of service of the observation notifications.
  *
  * @return ::OC_STACK_OK on success, some other value upon failure.
  */
 OCStackResult SendListObserverNotification (OCResource * resource,
-        OCObservationId  *obsIdList, uint8_t numberOfIds,
+        const OCObservationId *obsIdList, size_t numberOfIds,
         const OCRepPayload *payload, uint32_t maxAge,
         OCQualityOfService qos);
 
@@ -161,6 +172,37 @@ OCStackResult SendListObserverNotification (OCResource * resource,
  */
 void DeleteObserverList(OCResource *resource);
 
+/**
+ * Create the lock that guards the observer lists of all resources.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult InitializeObserverLists();
+
+/**
+ * Free the lock created by InitializeObserverLists().
+ */
+void TerminateObserverLists();
+
+/**
+ * Lock the observer lists of all resources. The lock is recursive and must be taken before
+ * the resource list lock when both are needed. Observers and resources are only freed with
+ * it held, so those found while holding it stay valid until it is released. It is never held
+ * while an entity handler runs: observers are retained and notified without it.
+ */
+void LockObserverLists();
+
+/**
+ * Unlock the observer lists locked by LockObserverLists().
+ */
+void UnlockObserverLists();
+
+/**
+ * Send the confirmable notifications of the observers whose TTL ran out while they were
+ * looked up. Called by OCProcess(), without the observer lock.
+ */
+void SendTimedOutObserverNotifications();
+
 /**
  * Create a unique observation ID.
  *
@@ -212,6 +254,7 @@ OCStackResult DeleteObserverUsingToken (OCResource *resource,
 
 /**
  * Search the list of observers for the specified token.
+ * The caller must hold LockObserverLists() for as long as it uses the observer.
  *
  * @param resource         Resource pointer that has a list of observers.
  * @param token            Token to search for.
@@ -223,7 +266,9 @@ ResourceObserver* GetObserverUsingToken (OCResource *resource,
                                          const CAToken_t token, uint8_t tokenLength);
 
 /**
- * Search the list of observers for the specified observe ID.
+ * Look up the observer with the specified observe ID in the observation ID table of
+ * the resource.
+ * The caller must hold LockObserverLists() for as long as it uses the observer.
  *
  * @param resource         Resource pointer that has a list of observers.
  * @param observeId        Observer ID to search for.
@@ -231,6 +231,9 @@ typedef struct OCResource {
     /** Observer(s); linked list.*/
     ResourceObserver *observersHead;
 
+    /** Observers of observersHead keyed by observation ID.*/
+    OCHashTable observersById;
+
     /** Sequence number for observable resources. Per the CoAP standard it is a 24 bit value.*/
     uint32_t sequenceNum;
 
@@ -250,8 +253,42 @@ typedef struct OCResource {
 
     /** Resource endpoint type(s). */
     OCTpsSchemeFlags endpointType;
+
+    /** Number of requests being dispatched to the resource, see RetainResource().*/
+    uint32_t dispatchRefCount;
+
+    /** Set when the resource was deleted while requests to it were being dispatched.*/
+    bool deletePending;
 } OCResource;
 
+/**
+ * Lock the resource list and the resource index. The lock is recursive. It is never held
+ * while entity handlers or observer notifications run, and it is taken after the observer
+ * list lock when both are needed.
+ */
+void LockResourceList();
+
+/**
+ * Unlock the resource list locked by LockResourceList().
+ */
+void UnlockResourceList();
+
+/**
+ * Keep a resource from being freed while a request to it is dispatched. A resource deleted
+ * meanwhile is unlinked at once and freed by the last ReleaseResource().
+ * The caller must hold LockResourceList() since it found the resource in the list.
+ *
+ * @param[in] resource      Resource to retain, or NULL.
+ */
+void RetainResource(OCResource *resource);
+
+/**
+ * Release a resource retained by RetainResource().
+ *
+ * @param[in] resource      Resource to release, or NULL.
+ */
+void ReleaseResource(OCResource *resource);
+
 /**
  * Checks if an observation Id already exists among the resources.
  *
@@ -263,6 +300,8 @@ bool IsObservationIdExisting(const OCObservationId observationId);
 
 /**
  * Search the list of resource for an observer that has the specified token.
+ * The caller must hold LockObserverLists() for as long as it uses the observer or the
+ * resource.
  *
  * @param[out] outResource          Resource pointer that the observer belong to.
  * @param[out] outObserver          Observer pointer that is associated with the token.
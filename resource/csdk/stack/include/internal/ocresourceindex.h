@@ -0,0 +1,128 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+/**
+ * @file
+ *
+ * This file contains the hash indexes kept next to the global resource list, so that
+ * resources can be looked up by handle, URI, resource type and interface without walking
+ * the whole list.
+ */
+
+#ifndef OC_RESOURCE_INDEX_H_
+#define OC_RESOURCE_INDEX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "octypes.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+struct OCResource;
+
+/**
+ * Add a resource to the handle and URI indexes. The URI of the resource must be set.
+ *
+ * @param[in]  resource     Resource that was inserted into the resource list.
+ *
+ * @return ::OC_STACK_OK on success, ::OC_STACK_NO_MEMORY if the index could not grow.
+ */
+OCStackResult OCResourceIndexAdd(struct OCResource *resource);
+
+/**
+ * Remove a resource and every type and interface bound to it from all indexes.
+ *
+ * @param[in]  resource     Resource that is about to be removed from the resource list.
+ */
+void OCResourceIndexRemove(struct OCResource *resource);
+
+/**
+ * Record that a resource type was bound to a resource.
+ *
+ * @param[in]  resource     Resource the type was bound to.
+ * @param[in]  typeName     Name of the resource type.
+ */
+void OCResourceIndexAddType(struct OCResource *resource, const char *typeName);
+
+/**
+ * Record that an interface was bound to a resource.
+ *
+ * @param[in]  resource     Resource the interface was bound to.
+ * @param[in]  interfaceName Name of the interface.
+ */
+void OCResourceIndexAddInterface(struct OCResource *resource, const char *interfaceName);
+
+/**
+ * Check whether a handle refers to a resource that is currently in the resource list.
+ *
+ * @param[in]  resource     Handle to check. It is never dereferenced.
+ *
+ * @return true if the resource is indexed, false otherwise.
+ */
+bool OCResourceIndexContains(const struct OCResource *resource);
+
+/**
+ * Find the resource with the given URI.
+ *
+ * @param[in]  uri          URI to search for.
+ *
+ * @return the resource if found, NULL otherwise.
+ */
+struct OCResource *OCResourceIndexFindByUri(const char *uri);
+
+/**
+ * Get the resources a resource type is bound to, in binding order.
+ *
+ * @param[in]  typeName     Name of the resource type.
+ * @param[out] resources    Resources the type is bound to. Valid until the indexes change.
+ * @param[out] count        Number of entries in @p resources.
+ *
+ * @return true if the index can answer the query, false if the caller has to fall back to
+ *         walking the resource list.
+ */
+bool OCResourceIndexFindByType(const char *typeName, struct OCResource * const **resources,
+                               size_t *count);
+
+/**
+ * Get the resources an interface is bound to, in binding order.
+ *
+ * @param[in]  interfaceName Name of the interface.
+ * @param[out] resources    Resources the interface is bound to. Valid until the indexes change.
+ * @param[out] count        Number of entries in @p resources.
+ *
+ * @return true if the index can answer the query, false if the caller has to fall back to
+ *         walking the resource list.
+ */
+bool OCResourceIndexFindByInterface(const char *interfaceName,
+                                    struct OCResource * const **resources, size_t *count);
+
+/**
+ * Release every index. Used when the resource list is reset.
+ */
+void OCResourceIndexClear(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif // OC_RESOURCE_INDEX_H_
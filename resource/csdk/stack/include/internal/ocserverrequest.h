@@ -46,6 +46,29 @@ extern "C"
  */
 typedef OCStackResult (* OCEHResponseHandler)(OCEntityHandlerResponse * ehResponse);
 
+/**
+ * Response encoded once on behalf of a group of observers that share the same accept format
+ * and version. While a notification is fanned out, the first response of a group is encoded
+ * into the cache and every other observer of the group is sent the cached bytes.
+ */
+typedef struct OCNotificationCache
+{
+    /** Set once a response has been stored in the cache.*/
+    bool valid;
+    /** Entity handler result of the cached response.*/
+    OCEntityHandlerResult ehResult;
+    /** Type of the payload that was encoded.*/
+    OCPayloadType payloadType;
+    /** Number of vendor specific header options of the cached response.*/
+    uint8_t numSendVendorSpecificHeaderOptions;
+    /** Vendor specific header options of the cached response.*/
+    OCHeaderOption sendVendorSpecificHeaderOptions[MAX_HEADER_OPTIONS];
+    /** Encoded payload, owned by the cache.*/
+    uint8_t *payload;
+    /** Size of the encoded payload.*/
+    size_t payloadSize;
+} OCNotificationCache;
+
 /**
  * following structure will be created in occoap and passed up the stack on the server side.
  */
@@ -118,6 +141,9 @@ typedef struct OCServerRequest
     /** Flag indicating notification.*/
     uint8_t notificationFlag;
 
+    /** Encoded response shared with other observers of a notification fan-out, or NULL.*/
+    OCNotificationCache *notificationCache;
+
     /** Payload format retrieved from the received request PDU. */
     OCPayloadFormat payloadFormat;
 
@@ -151,6 +177,18 @@ typedef struct OCServerResponse
     OCRequestHandle requestHandle;
 } OCServerResponse;
 
+/**
+ * Create the lock that guards the server request and response lists.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult InitializeServerRequestList();
+
+/**
+ * Free the lock created by InitializeServerRequestList().
+ */
+void TerminateServerRequestList();
+
 /**
  * Add a server request to the server request list
  *
@@ -217,6 +255,21 @@ OCServerRequest * GetServerRequestUsingToken (const CAToken_t token, uint8_t tok
  */
 void DeleteServerRequest(OCServerRequest * serverRequest);
 
+/**
+ * Clear every reference that pending server requests hold to a notification cache, so the
+ * cache can be released while slow entity handlers still have requests outstanding.
+ *
+ * @param[in]  cache            notification cache that is about to be released.
+ */
+void DetachNotificationCache(const OCNotificationCache *cache);
+
+/**
+ * Release the encoded payload held by a notification cache and mark it invalid.
+ *
+ * @param[in]  cache            notification cache to clear.
+ */
+void ClearNotificationCache(OCNotificationCache *cache);
+
 /**
  * Handler function for sending a response from a single resource
  *
@@ -259,6 +259,31 @@ OCStackResult CAResultToOCResult(CAResult_t caResult);
  */
 bool OCResultToSuccess(OCStackResult ocResult);
 
+/**
+ * Check whether a client response handler was registered with
+ * OCRegisterEncodedResponseHandler.
+ *
+ * @param responseHandler Response handler to look up.
+ * @return true if the handler takes representations as ::OCEncodedPayload.
+ */
+bool OCIsEncodedResponseHandler(OCClientResponseHandler responseHandler);
+
+/**
+ * Check whether an entity handler was registered with OCRegisterEncodedEntityHandler.
+ *
+ * @param entityHandler Entity handler to look up.
+ * @return true if the handler takes representations as ::OCEncodedPayload.
+ */
+bool OCIsEncodedEntityHandler(OCEntityHandler entityHandler);
+
+/**
+ * Stop offering the blocks of responses to a request to its block data handler.
+ * Called when the client callback of the request is deleted.
+ *
+ * @param handle Handle of the request.
+ */
+void OCRemoveBlockStream(OCDoHandle handle);
+
 /**
  * Map OCQualityOfService to CAMessageType.
  *
@@ -71,6 +71,12 @@ OCStackResult TerminateKeepAlive(OCMode mode);
  */
 void ProcessKeepAlive();
 
+/**
+ * Get the time until ProcessKeepAlive() next has a ping to send or a connection to drop.
+ * @return  timeout in milliseconds, or UINT32_MAX when the table is empty.
+ */
+uint32_t GetKeepAliveTimeout();
+
 /**
  * This API will be called from RI layer whenever there is a request for KeepAlive.
  * Virtual Resource.
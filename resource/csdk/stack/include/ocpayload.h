@@ -254,6 +254,36 @@ OCIntrospectionPayload* OC_CALL OCIntrospectionPayloadCreateFromCbor(const uint8
                                                              size_t size);
 void OC_CALL OCIntrospectionPayloadDestroy(OCIntrospectionPayload* payload);
 
+OCEncodedPayload* OC_CALL OCEncodedPayloadCreate(const uint8_t* cborData, size_t size);
+OCEncodedPayload* OC_CALL OCEncodedPayloadCreateAsOwner(uint8_t* cborData, size_t size);
+
+/**
+ * Create an encoded payload whose CBOR is produced part by part when it is sent, so that a
+ * large response does not have to be held in memory as a whole.
+ *
+ * @param size      Size of the CBOR in bytes.
+ * @param producer  Writes the part of the CBOR at an offset, parts may be asked for again.
+ * @param context   Passed to producer and release.
+ * @param release   Called with context once no part is produced any more, may be NULL.
+ *                  It is also called if the payload can not be created.
+ *
+ * @return the payload, or NULL on failure.
+ */
+OCEncodedPayload* OC_CALL OCEncodedPayloadCreateProduced(size_t size, OCPayloadProducer producer,
+                                                         void* context, OCPayloadRelease release);
+void OC_CALL OCEncodedPayloadDestroy(OCEncodedPayload* payload);
+
+/**
+ * Parse the CBOR held by an encoded payload into an ::OCRepPayload.
+ *
+ * @param payload     Encoded representation.
+ * @param outPayload  Parsed representation, owned by the caller on success.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCEncodedPayloadParse(const OCEncodedPayload* payload,
+                                            OCRepPayload** outPayload);
+
 #ifndef TCP_ADAPTER
 void OC_CALL OCDiscoveryPayloadAddResource(OCDiscoveryPayload* payload, const OCResource* res,
                                    uint16_t securePort);
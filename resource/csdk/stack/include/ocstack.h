@@ -130,6 +130,56 @@ OCStackResult OC_CALL OCStopMulticastServer();
  */
 OCStackResult OC_CALL OCProcess();
 
+/**
+ * Wait until OCProcess() has work, then call it. The wait ends when a message arrives, a
+ * retransmission gives up, a callback, presence or keepalive timer is due, OCWakeProcess() is
+ * called or @p maxWaitMs passes, whichever comes first. Replaces calling OCProcess() from a
+ * loop with a sleep.
+ *
+ * @param maxWaitMs         Longest time to wait in milliseconds, UINT32_MAX for no limit.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCProcessWait(uint32_t maxWaitMs);
+
+/**
+ * Get the time until OCProcess() next has timed work to do, for applications that wait with
+ * OCWaitForProcess() or in their own event loop on OCGetProcessFd().
+ *
+ * @return Timeout in milliseconds, 0 if OCProcess() should be called now, or UINT32_MAX if
+ *         nothing is scheduled.
+ */
+uint32_t OC_CALL OCGetProcessTimeout();
+
+/**
+ * Block until OCProcess() has received work, OCWakeProcess() is called or the timeout
+ * passes. Unlike OCProcess() this may be called without serializing with other stack calls.
+ *
+ * @param timeoutMs         Timeout in milliseconds, UINT32_MAX for no limit. Usually the
+ *                          result of OCGetProcessTimeout().
+ *
+ * @return ::OC_STACK_OK when woken up, ::OC_STACK_TIMEOUT on timeout, some other value upon
+ *         failure.
+ */
+OCStackResult OC_CALL OCWaitForProcess(uint32_t timeoutMs);
+
+/**
+ * Get a descriptor that becomes readable when OCProcess() has received work. It can be added
+ * to an application's own poll, select or epoll loop, with OCGetProcessTimeout() as the
+ * timeout; OCProcess() clears it. The descriptor is owned by the stack and is valid between
+ * OCInit() and OCStop().
+ *
+ * @return File descriptor, or -1 if the stack is not initialized or the platform has none.
+ */
+int OC_CALL OCGetProcessFd();
+
+/**
+ * Wake up a thread blocked in OCProcessWait() or OCWaitForProcess(), e.g. to stop it.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCWakeProcess();
+
 /**
  * This function discovers or Perform requests on a specified resource
  * (specified by that Resource's respective URI).
@@ -248,6 +298,28 @@ OCStackResult OC_CALL OCCancel(OCDoHandle handle,
  */
 OCStackResult OC_CALL OCRegisterPersistentStorageHandler(OCPersistentStorage* persistentStorageHandler);
 
+/**
+ * Journal updates of the secure resources instead of rewriting the whole database.
+ *
+ * Each update is appended to a journal next to its database, "<database>.jnl", which is
+ * opened, written and removed through the persistent storage handler. The journal is folded
+ * back into the database once it has grown larger than the database. The open handler must
+ * therefore pass journal names through instead of mapping every name to the same file.
+ *
+ * Must be called before OCInit().
+ *
+ * @param enabled     true to journal updates, false to rewrite the database on every update.
+ * @param coalesceMs  Time in milliseconds updates are held back so that updates in quick
+ *                    succession are written together, or 0 to write every update right away.
+ *                    Held back updates are written by OCProcess() and OCStop(), and are lost
+ *                    if the process ends before then.
+ *
+ * @return
+ *     OC_STACK_OK                    No errors; Success.
+ *     OC_STACK_ERROR                 The stack is already initialized.
+ */
+OCStackResult OC_CALL OCSetPersistentStorageJournal(bool enabled, uint32_t coalesceMs);
+
 #ifdef WITH_PRESENCE
 /**
  * When operating in  OCServer or  OCClientServer mode,
@@ -296,6 +368,86 @@ OCStackResult OC_CALL OCStopPresence();
 OCStackResult OC_CALL OCSetDefaultDeviceEntityHandler(OCDeviceEntityHandler entityHandler,
                                               void* callbackParameter);
 
+/**
+ * This function registers a response handler that decodes representations itself.
+ *
+ * Representation responses for requests made with this handler are delivered as an
+ * ::OCEncodedPayload holding the CBOR received from the peer, instead of a parsed
+ * ::OCRepPayload.  Responses to batch interface queries are always parsed.  It may be called
+ * before ::OCInit, ::OCStop removes the registration.
+ *
+ * @param responseHandler    Client response handler that accepts ::PAYLOAD_TYPE_ENCODED.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCRegisterEncodedResponseHandler(OCClientResponseHandler responseHandler);
+
+/**
+ * This function removes the registration of a response handler that decodes representations
+ * itself.  Responses that arrive afterwards are delivered parsed.
+ *
+ * @param responseHandler    Client response handler given to ::OCRegisterEncodedResponseHandler.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCUnregisterEncodedResponseHandler(OCClientResponseHandler responseHandler);
+
+/**
+ * This function registers an entity handler that decodes representations itself.
+ *
+ * Representation request payloads for resources created with this handler are delivered as
+ * an ::OCEncodedPayload holding the CBOR received from the peer, instead of a parsed
+ * ::OCRepPayload.  Such a handler may also respond with an ::OCEncodedPayload.  It may be
+ * called before ::OCInit, ::OCStop removes the registration.
+ *
+ * @param entityHandler      Entity handler that accepts ::PAYLOAD_TYPE_ENCODED.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCRegisterEncodedEntityHandler(OCEntityHandler entityHandler);
+
+/**
+ * This function removes the registration of an entity handler that decodes representations
+ * itself.  Requests that arrive afterwards are delivered parsed.
+ *
+ * @param entityHandler      Entity handler given to ::OCRegisterEncodedEntityHandler.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCUnregisterEncodedEntityHandler(OCEntityHandler entityHandler);
+
+/**
+ * This function registers a block data handler for a client response handler.
+ *
+ * The blocks of block-wise responses to requests made with the response handler are
+ * offered to the block data handler as they are received, with the context of the request.
+ * It may be called before ::OCInit, ::OCStop removes the registration.
+ *
+ * @param responseHandler    Client response handler.
+ * @param blockHandler       Block data handler, or NULL to remove the registration.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCRegisterBlockResponseHandler(OCClientResponseHandler responseHandler,
+                                                     OCBlockDataHandler blockHandler);
+
+/**
+ * This function registers a block data handler for an entity handler.
+ *
+ * The blocks of block-wise requests to resources created with the entity handler are
+ * offered to the block data handler as they are received, with the callback parameter of
+ * the resource.  It may be called before ::OCInit, ::OCStop removes the registration.  In
+ * builds with security, requests are still reassembled, so that access is checked before the
+ * payload is handed out.
+ *
+ * @param entityHandler      Entity handler.
+ * @param blockHandler       Block data handler, or NULL to remove the registration.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCRegisterBlockEntityHandler(OCEntityHandler entityHandler,
+                                                   OCBlockDataHandler blockHandler);
+
 /**
  * This function sets device information.
  *
@@ -617,7 +769,8 @@ OCStackResult OC_CALL OCNotifyAllObservers(OCResourceHandle handle, OCQualityOfS
  * @param handle                    Handle of resource.
  * @param obsIdList                 List of observation IDs that need to be notified.
  * @param numberOfIds               Number of observation IDs included in obsIdList.
- * @param payload                   Object representing the notification
+ * @param payload                   Object representing the notification.  It is encoded
+ *                                  once per accept format and version of the observers.
  * @param qos                       Desired quality of service of the observation notifications.
  *
  * @note: The memory for obsIdList and payload is managed by the entity invoking the API.
@@ -628,7 +781,7 @@ OCStackResult OC_CALL OCNotifyAllObservers(OCResourceHandle handle, OCQualityOfS
  */
 OCStackResult OC_CALL OCNotifyListOfObservers (OCResourceHandle handle,
                                        OCObservationId  *obsIdList,
-                                       uint8_t          numberOfIds,
+                                       size_t           numberOfIds,
                                        const OCRepPayload *payload,
                                        OCQualityOfService qos);
 
@@ -650,6 +803,19 @@ OCStackResult OC_CALL OCDoResponse(OCEntityHandlerResponse *response);
  */
 OCStackResult OC_CALL OCSetProxyURI(const char *uri);
 
+/**
+ * Set the number of threads that incoming requests are dispatched on. Requests are assigned
+ * to a thread by resource, so requests to one resource are handled in the order they arrived
+ * while entity handlers of different resources run concurrently. Responses are still handled
+ * in OCProcess(). With 0, the default, requests are handled in OCProcess() as well.
+ * Has to be called before OCInit() to take effect.
+ *
+ * @param count          Number of dispatch threads, or 0.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+OCStackResult OC_CALL OCSetDispatchShardCount(uint8_t count);
+
 #if defined(RD_CLIENT) || defined(RD_SERVER)
 /**
  * This function binds an resource unique id to the resource.
@@ -20,6 +20,7 @@
 
 #include "iotivity_config.h"
 #include "occlientcb.h"
+#include "ocstackinternal.h"
 #include <coap/coap.h>
 #include "experimental/logger.h"
 #include "trace.h"
@@ -46,9 +47,142 @@
 //      This should be static variable after we make a presence feature separately.
 struct ClientCB *g_cbList = NULL;
 
+/** Number of buckets the token and handle indexes start with; always a power of two.*/
+#define CB_INDEX_INITIAL_BUCKETS (32)
+
+/** Callback nodes keyed by token.*/
+static OCHashTable g_cbTokenIndex = OC_HASH_TABLE_INITIALIZER(CB_INDEX_INITIAL_BUCKETS);
+
+/** Callback nodes keyed by invocation handle.*/
+static OCHashTable g_cbHandleIndex = OC_HASH_TABLE_INITIALIZER(CB_INDEX_INITIAL_BUCKETS);
+
+/** Binary min-heap of the callback nodes that have a TTL, ordered by TTL.*/
+static ClientCB **g_cbTimeoutHeap = NULL;
+static size_t g_cbTimeoutHeapSize = 0;
+static size_t g_cbTimeoutHeapCapacity = 0;
+
 //-------------------------------------------------------------------------------------------------
 // Local functions
 //-------------------------------------------------------------------------------------------------
+static uint32_t HashToken(const uint8_t *token, uint8_t tokenLength)
+{
+    return OCHashBytes(OC_HASH_INIT, token, tokenLength);
+}
+
+/*
+ * Add a node that was just appended to g_cbList to both indexes.
+ */
+static bool IndexClientCB(ClientCB *cbNode)
+{
+    if (!OCHashTableInsert(&g_cbTokenIndex, &cbNode->tokenLink,
+                           HashToken((const uint8_t *)cbNode->token, cbNode->tokenLength)))
+    {
+        return false;
+    }
+    if (!OCHashTableInsert(&g_cbHandleIndex, &cbNode->handleLink,
+                           OCHashPointer(cbNode->handle)))
+    {
+        OCHashTableRemove(&g_cbTokenIndex, &cbNode->tokenLink);
+        return false;
+    }
+    return true;
+}
+
+static void UnindexClientCB(ClientCB *cbNode)
+{
+    OCHashTableRemove(&g_cbTokenIndex, &cbNode->tokenLink);
+    OCHashTableRemove(&g_cbHandleIndex, &cbNode->handleLink);
+}
+
+static void HeapSwap(size_t a, size_t b)
+{
+    ClientCB *tmp = g_cbTimeoutHeap[a];
+    g_cbTimeoutHeap[a] = g_cbTimeoutHeap[b];
+    g_cbTimeoutHeap[b] = tmp;
+    g_cbTimeoutHeap[a]->heapIndex = a;
+    g_cbTimeoutHeap[b]->heapIndex = b;
+}
+
+static void HeapSiftUp(size_t index)
+{
+    while (index > 0)
+    {
+        size_t parent = (index - 1) / 2;
+        if (g_cbTimeoutHeap[parent]->TTL <= g_cbTimeoutHeap[index]->TTL)
+        {
+            break;
+        }
+        HeapSwap(parent, index);
+        index = parent;
+    }
+}
+
+static void HeapSiftDown(size_t index)
+{
+    for (;;)
+    {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < g_cbTimeoutHeapSize &&
+            g_cbTimeoutHeap[left]->TTL < g_cbTimeoutHeap[smallest]->TTL)
+        {
+            smallest = left;
+        }
+        if (right < g_cbTimeoutHeapSize &&
+            g_cbTimeoutHeap[right]->TTL < g_cbTimeoutHeap[smallest]->TTL)
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            break;
+        }
+        HeapSwap(index, smallest);
+        index = smallest;
+    }
+}
+
+static bool HeapPush(ClientCB *cbNode)
+{
+    if (g_cbTimeoutHeapSize == g_cbTimeoutHeapCapacity)
+    {
+        size_t capacity = g_cbTimeoutHeapCapacity ? g_cbTimeoutHeapCapacity * 2
+                                                   : CB_INDEX_INITIAL_BUCKETS;
+        ClientCB **heap = (ClientCB **) OICRealloc(g_cbTimeoutHeap,
+                                                   capacity * sizeof(ClientCB *));
+        if (!heap)
+        {
+            return false;
+        }
+        g_cbTimeoutHeap = heap;
+        g_cbTimeoutHeapCapacity = capacity;
+    }
+    cbNode->heapIndex = g_cbTimeoutHeapSize;
+    g_cbTimeoutHeap[g_cbTimeoutHeapSize++] = cbNode;
+    HeapSiftUp(cbNode->heapIndex);
+    return true;
+}
+
+static void HeapRemove(ClientCB *cbNode)
+{
+    size_t index = cbNode->heapIndex;
+    if (CLIENTCB_NOT_IN_HEAP == index)
+    {
+        return;
+    }
+
+    cbNode->heapIndex = CLIENTCB_NOT_IN_HEAP;
+    g_cbTimeoutHeapSize--;
+    if (index != g_cbTimeoutHeapSize)
+    {
+        g_cbTimeoutHeap[index] = g_cbTimeoutHeap[g_cbTimeoutHeapSize];
+        g_cbTimeoutHeap[index]->heapIndex = index;
+        HeapSiftDown(index);
+        HeapSiftUp(index);
+    }
+}
+
 static void DeleteClientCBInternal(ClientCB * cbNode)
 {
     assert(cbNode);
@@ -59,6 +193,10 @@ static void DeleteClientCBInternal(ClientCB * cbNode)
     OIC_TRACE_BUFFER("OIC_RI_CLIENTCB:DeleteClientCB:token:",
                      (const uint8_t *)cbNode->token, cbNode->tokenLength);
 
+    // No more blocks reach the context once the stream is gone.
+    OCRemoveBlockStream(cbNode->handle);
+    UnindexClientCB(cbNode);
+    HeapRemove(cbNode);
     LL_DELETE(g_cbList, cbNode);
     CADestroyToken(cbNode->token);
     OICFree(cbNode->devAddr);
@@ -108,31 +246,6 @@ static void DeleteClientCBInternal(ClientCB * cbNode)
     OIC_TRACE_END();
 }
 
-/*
- * This function checks if the node is past its time to live and
- * deletes it if timed-out. Calling this function with a  presence or observe
- * callback with ttl set to 0 will not delete anything as presence nodes have
- * their own mechanisms for timeouts. A null argument will cause the function to
- * silently return.
- */
-static void CheckAndDeleteTimedOutCB(ClientCB * cbNode)
-{
-    assert(cbNode);
-
-    if (cbNode->TTL == 0)
-    {
-        return;
-    }
-    coap_tick_t now;
-    coap_ticks(&now);
-
-    if (cbNode->TTL < now)
-    {
-        OIC_LOG(INFO, TAG, "Deleting timed-out callback");
-        DeleteClientCBInternal(cbNode);
-    }
-}
-
 #ifdef WITH_PRESENCE
 /**
  * Inserts a new resource type filter into this cb node.
@@ -271,12 +384,34 @@ OCStackResult AddClientCB(ClientCB** clientCB, OCCallbackData* cbData,
         {
             cbNode->TTL = ttl;
         }
+        cbNode->tokenLink.next = NULL;
+        cbNode->handleLink.next = NULL;
+        cbNode->heapIndex = CLIENTCB_NOT_IN_HEAP;
+
+        LL_APPEND(g_cbList, cbNode);
+        if (!IndexClientCB(cbNode) || (cbNode->TTL && !HeapPush(cbNode)))
+        {
+            OIC_LOG(ERROR, TAG, "Out of memory");
+            UnindexClientCB(cbNode);
+            LL_DELETE(g_cbList, cbNode);
+            OICFree(cbNode->options);
+            OICFree(cbNode->payload);
+            OICFree(cbNode);
+            *clientCB = NULL;
+            goto exit;
+        }
+
         cbNode->requestUri = requestUri;    // I own it now
         cbNode->devAddr = devAddr;          // I own it now
         OIC_LOG_V(INFO, TAG, "Added Callback for uri : %s", requestUri);
         OIC_TRACE_MARK(%s:AddClientCB:uri:%s, TAG, requestUri);
-        LL_APPEND(g_cbList, cbNode);
         *clientCB = cbNode;
+
+        // The new timeout may come before the one OCProcess is currently waiting for.
+        if (cbNode->TTL)
+        {
+            CAWakeup();
+        }
     }
 #ifdef WITH_PRESENCE
     else
@@ -322,18 +457,10 @@ exit:
 
 void DeleteClientCB(ClientCB * cbNode)
 {
-    if (cbNode)
+    // Only delete nodes that are still registered; the handle index tells in constant time.
+    if (cbNode && cbNode == GetClientCBUsingHandle(cbNode->handle))
     {
-        ClientCB* out = NULL;
-        ClientCB* tmp = NULL;
-        LL_FOREACH_SAFE(g_cbList, out, tmp)
-        {
-            if (cbNode == out)
-            {
-                DeleteClientCBInternal(out);
-                break;
-            }
-        }
+        DeleteClientCBInternal(cbNode);
     }
 }
 
@@ -346,6 +473,68 @@ void DeleteClientCBList()
         DeleteClientCBInternal(out);
     }
     g_cbList = NULL;
+
+    OCHashTableClear(&g_cbTokenIndex);
+    OCHashTableClear(&g_cbHandleIndex);
+    OICFree(g_cbTimeoutHeap);
+    g_cbTimeoutHeap = NULL;
+    g_cbTimeoutHeapSize = 0;
+    g_cbTimeoutHeapCapacity = 0;
+}
+
+void SetClientCBTimeout(ClientCB *cbNode, uint32_t ttl)
+{
+    if (!cbNode)
+    {
+        return;
+    }
+
+    cbNode->TTL = ttl;
+    if (0 == ttl)
+    {
+        HeapRemove(cbNode);
+    }
+    else if (CLIENTCB_NOT_IN_HEAP == cbNode->heapIndex)
+    {
+        if (!HeapPush(cbNode))
+        {
+            // Without a heap slot the node can only go away when it is deleted explicitly.
+            OIC_LOG(ERROR, TAG, "Failed to schedule callback timeout");
+        }
+    }
+    else
+    {
+        HeapSiftDown(cbNode->heapIndex);
+        HeapSiftUp(cbNode->heapIndex);
+    }
+}
+
+void DeleteTimedOutClientCBs()
+{
+    if (0 == g_cbTimeoutHeapSize)
+    {
+        return;
+    }
+
+    coap_tick_t now;
+    coap_ticks(&now);
+
+    while (g_cbTimeoutHeapSize && g_cbTimeoutHeap[0]->TTL < now)
+    {
+        OIC_LOG(INFO, TAG, "Deleting timed-out callback");
+        DeleteClientCBInternal(g_cbTimeoutHeap[0]);
+    }
+}
+
+bool GetEarliestClientCBTTL(uint32_t *ttl)
+{
+    if (!ttl || 0 == g_cbTimeoutHeapSize)
+    {
+        return false;
+    }
+
+    *ttl = g_cbTimeoutHeap[0]->TTL;
+    return true;
 }
 
 ClientCB* GetClientCBUsingToken(const CAToken_t token,
@@ -360,18 +549,16 @@ ClientCB* GetClientCBUsingToken(const CAToken_t token,
     OIC_LOG (INFO, TAG, "Looking for token");
     OIC_LOG_BUFFER(INFO, TAG, (const uint8_t *)token, tokenLength);
 
-    ClientCB* out = NULL;
-    ClientCB* tmp = NULL;
-    LL_FOREACH_SAFE(g_cbList, out, tmp)
+    for (OCHashLink *link = OCHashTableFirst(&g_cbTokenIndex,
+                                             HashToken((const uint8_t *)token, tokenLength));
+         link; link = OCHashTableNext(link))
     {
-        /* de-annotate below line if want to see all token in g_cbList */
-        //OIC_LOG_BUFFER(INFO, TAG, (const uint8_t *)out->token, tokenLength);
-        if (memcmp(out->token, token, tokenLength) == 0)
+        ClientCB *out = OC_HASH_ENTRY(link, ClientCB, tokenLink);
+        if (out->tokenLength == tokenLength && memcmp(out->token, token, tokenLength) == 0)
         {
             OIC_LOG(INFO, TAG, "Found in callback list");
             return out;
         }
-        CheckAndDeleteTimedOutCB(out);
     }
 
     OIC_LOG(INFO, TAG, "Callback Not found!");
@@ -388,16 +575,15 @@ ClientCB* GetClientCBUsingHandle(const OCDoHandle handle)
 
     OIC_LOG(INFO, TAG,  "Looking for handle");
 
-    ClientCB* out = NULL;
-    ClientCB* tmp = NULL;
-    LL_FOREACH_SAFE(g_cbList, out, tmp)
+    for (OCHashLink *link = OCHashTableFirst(&g_cbHandleIndex, OCHashPointer(handle)); link;
+         link = OCHashTableNext(link))
     {
+        ClientCB *out = OC_HASH_ENTRY(link, ClientCB, handleLink);
         if (out->handle == handle)
         {
             OIC_LOG(INFO, TAG, "Found in callback list");
             return out;
         }
-        CheckAndDeleteTimedOutCB(out);
     }
 
     OIC_LOG(INFO, TAG, "Callback Not found!");
@@ -426,7 +612,6 @@ ClientCB* GetClientCBUsingUri(const char *requestUri)
             OIC_LOG(INFO, TAG, "Found in callback list");
             return out;
         }
-        CheckAndDeleteTimedOutCB(out);
     }
 
     OIC_LOG(INFO, TAG, "Callback Not found!");
@@ -0,0 +1,325 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <assert.h>
+#include <string.h>
+#include "ocstack.h"
+#include "ocdiscoverycache.h"
+#include "ocatomic.h"
+#include "octhread.h"
+#include "oic_malloc.h"
+#include "oic_string.h"
+#include "experimental/logger.h"
+
+#define TAG "OIC_RI_DISCOVERYCACHE"
+
+/** Number of responses kept. Entries are reused in turn once all are taken.*/
+#define DISCOVERY_CACHE_SIZE (8)
+
+/** Transport flags the endpoints and the anchor of a discovery response depend on.*/
+#define DISCOVERY_CACHE_FLAGS (OC_FLAG_SECURE | OC_MASK_FAMS)
+
+/**
+ * One encoded discovery response with the key it was built for.
+ */
+typedef struct
+{
+    /** Virtual resource the request was sent to.*/
+    OCVirtualResources uri;
+
+    /** Accept format of the request.*/
+    OCPayloadFormat format;
+
+    /** Owned copy of the interface filter, or NULL.*/
+    char *interfaceQuery;
+
+    /** Owned copy of the resource type filter, or NULL.*/
+    char *resourceTypeQuery;
+
+    /** Adapter the request came in on.*/
+    OCTransportAdapter adapter;
+
+    /** Security and IP family flags of the request.*/
+    OCTransportFlags flags;
+
+    /** Network interface the request came in on.*/
+    uint32_t ifindex;
+
+    /** Generation of the cache when the payload was built.*/
+    int32_t generation;
+
+    /** Encoded response.*/
+    OCNotificationCache cache;
+} DiscoveryCacheEntry;
+
+static DiscoveryCacheEntry g_entries[DISCOVERY_CACHE_SIZE];
+static size_t g_nextEntry = 0;
+static oc_mutex g_discoveryCacheLock = NULL;
+
+/**
+ * Incremented on every change that shows in a discovery response. Entries built in an
+ * older generation are never sent.
+ */
+static volatile int32_t g_generation = 0;
+
+static bool SameQuery(const char *cached, const char *query)
+{
+    if (!cached || !query)
+    {
+        return cached == query;
+    }
+    return 0 == strcmp(cached, query);
+}
+
+static bool IsCacheable(const OCServerRequest *request)
+{
+    // Notifications are encoded once per fan-out by the observer lists already.
+    if (request->notificationCache || request->notificationFlag)
+    {
+        return false;
+    }
+    switch (request->acceptFormat)
+    {
+        case OC_FORMAT_UNDEFINED:
+        case OC_FORMAT_CBOR:
+        case OC_FORMAT_VND_OCF_CBOR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Fill the key fields of @p probe from a request. The query strings are borrowed.
+ */
+static void SetKey(DiscoveryCacheEntry *probe, const OCServerRequest *request,
+                   const OCDiscoveryCacheKey *key)
+{
+    probe->uri = key->uri;
+    probe->format = request->acceptFormat;
+    probe->adapter = request->devAddr.adapter;
+    probe->flags = (OCTransportFlags)(request->devAddr.flags & DISCOVERY_CACHE_FLAGS);
+    probe->ifindex = request->devAddr.ifindex;
+    probe->interfaceQuery = (char *)key->interfaceQuery;
+    probe->resourceTypeQuery = (char *)key->resourceTypeQuery;
+}
+
+static bool Matches(const DiscoveryCacheEntry *entry, const DiscoveryCacheEntry *probe)
+{
+    return entry->uri == probe->uri &&
+           entry->format == probe->format &&
+           entry->adapter == probe->adapter &&
+           entry->flags == probe->flags &&
+           entry->ifindex == probe->ifindex &&
+           SameQuery(entry->interfaceQuery, probe->interfaceQuery) &&
+           SameQuery(entry->resourceTypeQuery, probe->resourceTypeQuery);
+}
+
+static DiscoveryCacheEntry *FindEntry(const DiscoveryCacheEntry *probe)
+{
+    for (size_t i = 0; i < DISCOVERY_CACHE_SIZE; i++)
+    {
+        if (g_entries[i].cache.valid && Matches(&g_entries[i], probe))
+        {
+            return &g_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void ClearEntry(DiscoveryCacheEntry *entry)
+{
+    // Requests are only ever given copies of the entries, so none points at the cache.
+    ClearNotificationCache(&entry->cache);
+    OICFree(entry->interfaceQuery);
+    entry->interfaceQuery = NULL;
+    OICFree(entry->resourceTypeQuery);
+    entry->resourceTypeQuery = NULL;
+}
+
+OCStackResult InitializeDiscoveryCache(void)
+{
+    assert(g_discoveryCacheLock == NULL);
+
+    g_discoveryCacheLock = oc_mutex_new();
+    if (g_discoveryCacheLock == NULL)
+    {
+        return OC_STACK_ERROR;
+    }
+    return OC_STACK_OK;
+}
+
+void TerminateDiscoveryCache(void)
+{
+    if (g_discoveryCacheLock != NULL)
+    {
+        for (size_t i = 0; i < DISCOVERY_CACHE_SIZE; i++)
+        {
+            ClearEntry(&g_entries[i]);
+        }
+        g_nextEntry = 0;
+        oc_mutex_free(g_discoveryCacheLock);
+        g_discoveryCacheLock = NULL;
+    }
+}
+
+int32_t OCDiscoveryCacheGetGeneration(void)
+{
+    return oc_atomic_add(&g_generation, 0);
+}
+
+void OCDiscoveryCacheInvalidate(void)
+{
+    oc_atomic_increment(&g_generation);
+}
+
+bool OCDiscoveryCacheCopy(const OCServerRequest *request, const OCDiscoveryCacheKey *key,
+                          OCNotificationCache *copy)
+{
+    if (!request || !key || !copy || !g_discoveryCacheLock || !IsCacheable(request))
+    {
+        return false;
+    }
+
+    int32_t generation = OCDiscoveryCacheGetGeneration();
+    DiscoveryCacheEntry probe;
+    SetKey(&probe, request, key);
+    memset(copy, 0, sizeof(*copy));
+
+    oc_mutex_lock(g_discoveryCacheLock);
+    DiscoveryCacheEntry *entry = FindEntry(&probe);
+    if (entry && entry->generation == generation)
+    {
+        *copy = entry->cache;
+        copy->payload = NULL;
+        if (entry->cache.payloadSize > 0)
+        {
+            copy->payload = (uint8_t *)OICMalloc(entry->cache.payloadSize);
+            if (copy->payload)
+            {
+                memcpy(copy->payload, entry->cache.payload, entry->cache.payloadSize);
+            }
+            else
+            {
+                copy->valid = false;
+            }
+        }
+    }
+    oc_mutex_unlock(g_discoveryCacheLock);
+
+    if (!copy->valid)
+    {
+        ClearNotificationCache(copy);
+    }
+    return copy->valid;
+}
+
+bool OCDiscoveryCacheSend(OCServerRequest *request, const OCDiscoveryCacheKey *key)
+{
+    // The bytes are copied so that the response is sent without holding the lock.
+    OCNotificationCache copy;
+    if (!OCDiscoveryCacheCopy(request, key, &copy))
+    {
+        return false;
+    }
+
+    request->notificationCache = &copy;
+
+    // HandleSingleResponse only looks at the payload type when the bytes come from the cache.
+    OCPayload payloadStub = { .type = copy.payloadType };
+    OCEntityHandlerResponse ehResponse = {0};
+    ehResponse.ehResult = copy.ehResult;
+    ehResponse.payload = &payloadStub;
+    ehResponse.persistentBufferFlag = 0;
+    ehResponse.requestHandle = (OCRequestHandle) request;
+    ehResponse.numSendVendorSpecificHeaderOptions = copy.numSendVendorSpecificHeaderOptions;
+    memcpy(ehResponse.sendVendorSpecificHeaderOptions, copy.sendVendorSpecificHeaderOptions,
+           sizeof(ehResponse.sendVendorSpecificHeaderOptions));
+
+    OIC_LOG(DEBUG, TAG, "Sending cached discovery response");
+    OCDoResponse(&ehResponse);
+
+    // The request is normally gone by now, but do not leave it pointing at the local copy.
+    DetachNotificationCache(&copy);
+    ClearNotificationCache(&copy);
+    return true;
+}
+
+OCStackResult OCDiscoveryCacheSendAndStore(OCServerRequest *request,
+                                           const OCDiscoveryCacheKey *key,
+                                           int32_t generation, OCPayload *payload)
+{
+    OCEntityHandlerResponse ehResponse = {0};
+    ehResponse.ehResult = OC_EH_OK;
+    ehResponse.payload = payload;
+    ehResponse.persistentBufferFlag = 0;
+    ehResponse.requestHandle = (OCRequestHandle) request;
+
+    if (!request || !key || !payload || !g_discoveryCacheLock || !IsCacheable(request))
+    {
+        return OCDoResponse(&ehResponse);
+    }
+
+    // The request is deleted once the response is sent, so keep its key first.
+    DiscoveryCacheEntry probe;
+    SetKey(&probe, request, key);
+
+    // HandleSingleResponse fills the local cache while it encodes the payload. The entry
+    // is only updated afterwards, so the lock is never held while the response is sent.
+    OCNotificationCache encoded = { .valid = false };
+    request->notificationCache = &encoded;
+    OCStackResult result = OCDoResponse(&ehResponse);
+    DetachNotificationCache(&encoded);
+
+    if (!encoded.valid)
+    {
+        ClearNotificationCache(&encoded);
+        return result;
+    }
+
+    char *interfaceQuery = NULL;
+    char *resourceTypeQuery = NULL;
+    if ((key->interfaceQuery && !(interfaceQuery = OICStrdup(key->interfaceQuery))) ||
+        (key->resourceTypeQuery && !(resourceTypeQuery = OICStrdup(key->resourceTypeQuery))))
+    {
+        OIC_LOG(WARNING, TAG, "Discovery response is sent without being cached");
+        OICFree(interfaceQuery);
+        ClearNotificationCache(&encoded);
+        return result;
+    }
+
+    oc_mutex_lock(g_discoveryCacheLock);
+    DiscoveryCacheEntry *entry = FindEntry(&probe);
+    if (!entry)
+    {
+        entry = &g_entries[g_nextEntry];
+        g_nextEntry = (g_nextEntry + 1) % DISCOVERY_CACHE_SIZE;
+    }
+    ClearEntry(entry);
+
+    *entry = probe;
+    entry->interfaceQuery = interfaceQuery;
+    entry->resourceTypeQuery = resourceTypeQuery;
+    entry->generation = generation;
+    entry->cache = encoded;
+    oc_mutex_unlock(g_discoveryCacheLock);
+
+    return result;
+}
@@ -18,6 +18,7 @@
 //
 //-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
+#include <assert.h>
 #include <string.h>
 #include "ocstack.h"
 #include "ocstackconfig.h"
@@ -30,6 +31,7 @@
 #include "ocpayload.h"
 #include "ocserverrequest.h"
 #include "experimental/logger.h"
+#include "octhread.h"
 
 #include <coap/utlist.h>
 #include <coap/pdu.h>
@@ -42,6 +44,37 @@
 
 #define VERIFY_NON_NULL(arg) { if (!arg) {OIC_LOG(FATAL, TAG, #arg " is NULL"); goto exit;} }
 
+/**
+ * Guards the observer lists of all resources. It is taken before the resource list lock and
+ * never held while an entity handler runs; notifications go to retained observers instead.
+ */
+static oc_mutex g_observerLock = NULL;
+
+/** Observation IDs that fit the 8 bit IDs of older bindings, see GenerateObserverId().*/
+#define OBSERVER_SHORT_ID_RANGE (256)
+
+/** Number of observers of all resources, guarded by g_observerLock.*/
+static size_t g_observerCount = 0;
+
+/**
+ * Observer whose TTL ran out while it was looked up, waiting for its confirmable
+ * notification to be sent by SendTimedOutObserverNotifications().
+ */
+typedef struct TimedOutObserver
+{
+    /** Retained observer.*/
+    ResourceObserver *observer;
+
+    /** Observe sequence number of the resource when the TTL ran out.*/
+    uint32_t sequenceNum;
+
+    /** next node in this list.*/
+    struct TimedOutObserver *next;
+} TimedOutObserver;
+
+/** Observers waiting for their confirmable notification, guarded by g_observerLock.*/
+static TimedOutObserver *g_timedOutObservers = NULL;
+
 /**
  * Determine observe QOS based on the QOS of the request.
  * The qos passed as a parameter overrides what the client requested.
@@ -95,17 +128,187 @@ static OCQualityOfService DetermineObserverQoS(OCMethod method,
     return decidedQoS;
 }
 
+/**
+ * Observers of a single notification fan-out that are sent identical bytes.
+ */
+typedef struct NotificationGroup
+{
+    /** Accept format shared by the observers of the group.*/
+    OCPayloadFormat acceptFormat;
+
+    /** Accept version shared by the observers of the group.*/
+    uint16_t acceptVersion;
+
+    /** Query shared by the observers of the group, or NULL if the query is not part of the key.*/
+    char *query;
+
+    /** Response encoded for the first observer of the group.*/
+    OCNotificationCache cache;
+
+    /** next node in this list.*/
+    struct NotificationGroup *next;
+} NotificationGroup;
+
+/**
+ * Find the notification group of an observer, creating it if this is the first observer
+ * seen with that key.
+ *
+ * @param groups Groups created so far during the fan-out.
+ * @param observer Observer that is about to be notified.
+ * @param matchQuery true if observers with different queries have to be kept apart, which
+ *                   is the case whenever the entity handler builds the representation.
+ * @return The group of the observer, or NULL if it could not be allocated.
+ */
+static NotificationGroup *GetNotificationGroup(NotificationGroup **groups,
+        const ResourceObserver *observer, bool matchQuery)
+{
+    NotificationGroup *group = NULL;
+    LL_FOREACH(*groups, group)
+    {
+        if (group->acceptFormat == observer->acceptFormat &&
+                group->acceptVersion == observer->acceptVersion)
+        {
+            if (!matchQuery || (!group->query && !observer->query) ||
+                    (group->query && observer->query &&
+                     0 == strcmp(group->query, observer->query)))
+            {
+                return group;
+            }
+        }
+    }
+
+    group = (NotificationGroup *) OICCalloc(1, sizeof(NotificationGroup));
+    if (!group)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to allocate notification group");
+        return NULL;
+    }
+    group->acceptFormat = observer->acceptFormat;
+    group->acceptVersion = observer->acceptVersion;
+    if (matchQuery && observer->query)
+    {
+        group->query = OICStrdup(observer->query);
+        if (!group->query)
+        {
+            OIC_LOG(ERROR, TAG, "Failed to copy notification group query");
+            OICFree(group);
+            return NULL;
+        }
+    }
+    LL_PREPEND(*groups, group);
+    return group;
+}
+
+/**
+ * Release the groups created during a fan-out together with their encoded payloads.
+ *
+ * @param groups Groups created during the fan-out.
+ */
+static void DeleteNotificationGroups(NotificationGroup *groups)
+{
+    NotificationGroup *group = NULL;
+    NotificationGroup *tmp = NULL;
+    LL_FOREACH_SAFE(groups, group, tmp)
+    {
+        LL_DELETE(groups, group);
+        // Slow entity handlers may still hold the request that points at this cache.
+        DetachNotificationCache(&group->cache);
+        ClearNotificationCache(&group->cache);
+        OICFree(group->query);
+        OICFree(group);
+    }
+}
+
+/**
+ * Free an observer that is no longer linked into the lists of its resource.
+ *
+ * @param observer Observer to free.
+ */
+static void FreeObserver(ResourceObserver *observer)
+{
+    OICFree(observer->resUri);
+    OICFree(observer->query);
+    OICFree(observer->token);
+    OICFree(observer);
+}
+
+/**
+ * Keep an observer alive while it is notified without the observer lock.
+ * Called with g_observerLock held.
+ *
+ * @param observer Observer to retain.
+ */
+static void RetainObserver(ResourceObserver *observer)
+{
+    observer->refCount++;
+}
+
+/**
+ * Release an observer retained by RetainObserver(). An observer deleted meanwhile is
+ * freed by the last release.
+ *
+ * @param observer Observer to release.
+ */
+static void ReleaseObserver(ResourceObserver *observer)
+{
+    oc_mutex_lock(g_observerLock);
+    assert(observer->refCount > 0);
+    observer->refCount--;
+    if ((0 == observer->refCount) && observer->deletePending)
+    {
+        FreeObserver(observer);
+    }
+    oc_mutex_unlock(g_observerLock);
+}
+
+/**
+ * Check whether a retained observer is still registered, and decide the QoS of its
+ * notification if it is.
+ *
+ * @param method RESTful method.
+ * @param observer Retained observer.
+ * @param qos Quality of service of the notification, updated for the observer.
+ * @return true if the observer was not deleted meanwhile.
+ */
+static bool PrepareObserverNotification(OCMethod method, ResourceObserver *observer,
+                                        OCQualityOfService *qos)
+{
+    oc_mutex_lock(g_observerLock);
+    bool registered = !observer->deletePending;
+    if (registered)
+    {
+        *qos = DetermineObserverQoS(method, observer, *qos);
+    }
+    oc_mutex_unlock(g_observerLock);
+    return registered;
+}
+
+/**
+ * Reset the TTL of an observer that was just notified.
+ *
+ * @param observer Retained observer.
+ */
+static void ResetObserverTTL(ResourceObserver *observer)
+{
+    oc_mutex_lock(g_observerLock);
+    observer->TTL = GetTicks(MAX_OBSERVER_TTL_SECONDS * MILLISECONDS_PER_SECOND);
+    oc_mutex_unlock(g_observerLock);
+}
+
 /**
  * Create a get request and pass to entityhandler to notify specific observer.
+ * Must be called without g_observerLock, with the observer retained.
  *
  * @param observer Observer that need to be notified.
  * @param qos Quality of service of resource.
+ * @param cache Notification cache filled with the encoded response, or NULL.
  *
  * @return ::OC_STACK_OK on success, some other value upon failure.
  */
 static OCStackResult SendObserveNotification(ResourceObserver *observer,
                                              uint32_t sequenceNum,
-                                             OCQualityOfService qos)
+                                             OCQualityOfService qos,
+                                             OCNotificationCache *cache)
 {
     OCStackResult result = OC_STACK_ERROR;
     OCServerRequest * request = NULL;
@@ -120,16 +323,24 @@ static OCStackResult SendObserveNotification(ResourceObserver *observer,
     if (request)
     {
         request->observeResult = OC_STACK_OK;
+        request->notificationCache = cache;
         if (result == OC_STACK_OK)
         {
             ResourceHandling resHandling = OC_RESOURCE_VIRTUAL;
             OCResource *resource = NULL;
+            // The resource is retained while its entity handler runs, like for a request.
+            LockResourceList();
             result = DetermineResourceHandling (request, &resHandling, &resource);
             if (result == OC_STACK_OK)
+            {
+                RetainResource(resource);
+            }
+            UnlockResourceList();
+            if (result == OC_STACK_OK)
             {
                 result = ProcessRequest(resHandling, resource, request);
-                // Reset Observer TTL.
-                observer->TTL = GetTicks(MAX_OBSERVER_TTL_SECONDS * MILLISECONDS_PER_SECOND);
+                ReleaseResource(resource);
+                ResetObserverTTL(observer);
             }
         }
     }
@@ -137,6 +348,116 @@ static OCStackResult SendObserveNotification(ResourceObserver *observer,
     return result;
 }
 
+/**
+ * Notify an observer with a response that was already encoded for another observer of the
+ * same group. Only the token, the destination and the observe sequence number differ, so the
+ * entity handler is not invoked again.
+ *
+ * @param observer Observer that need to be notified.
+ * @param sequenceNum Observe sequence number of the notification.
+ * @param qos Quality of service of the notification.
+ * @param cache Valid notification cache of the observer's group.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+static OCStackResult SendCachedNotification(ResourceObserver *observer,
+                                            uint32_t sequenceNum,
+                                            OCQualityOfService qos,
+                                            OCNotificationCache *cache)
+{
+    OCServerRequest * request = NULL;
+    OCStackResult result = AddServerRequest(&request, 0, 0, 1, OC_REST_GET,
+                                            0, sequenceNum, qos,
+                                            observer->query, NULL, OC_FORMAT_UNDEFINED, NULL,
+                                            observer->token, observer->tokenLength,
+                                            observer->resUri, 0, observer->acceptFormat,
+                                            observer->acceptVersion, &observer->devAddr);
+    if (result != OC_STACK_OK)
+    {
+        return result;
+    }
+    request->observeResult = OC_STACK_OK;
+    request->notificationCache = cache;
+
+    // HandleSingleResponse only looks at the payload type when the bytes come from the cache.
+    OCPayload payloadStub = { .type = cache->payloadType };
+    OCEntityHandlerResponse ehResponse = {0};
+    ehResponse.ehResult = cache->ehResult;
+    ehResponse.payload = &payloadStub;
+    ehResponse.persistentBufferFlag = 0;
+    ehResponse.requestHandle = (OCRequestHandle) request;
+    ehResponse.numSendVendorSpecificHeaderOptions = cache->numSendVendorSpecificHeaderOptions;
+    memcpy(ehResponse.sendVendorSpecificHeaderOptions, cache->sendVendorSpecificHeaderOptions,
+           sizeof(ehResponse.sendVendorSpecificHeaderOptions));
+
+    result = HandleSingleResponse(&ehResponse);
+
+    ResetObserverTTL(observer);
+    return result;
+}
+
+/**
+ * Retain all observers of a resource, together with the resource, so they can be
+ * notified without the observer lock. Called with g_observerLock held.
+ *
+ * @param resource Observed resource.
+ * @param count Number of observers retained.
+ * @return Array of the retained observers, or NULL if it could not be allocated.
+ */
+static ResourceObserver **RetainObservers(OCResource *resource, size_t *count)
+{
+    size_t observerCount = 0;
+    ResourceObserver *observer = NULL;
+    LL_FOREACH(resource->observersHead, observer)
+    {
+        observerCount++;
+    }
+
+    ResourceObserver **observers =
+        (ResourceObserver **) OICMalloc(observerCount * sizeof(ResourceObserver *));
+    if (!observers)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to allocate observers to notify");
+        return NULL;
+    }
+
+    size_t i = 0;
+    LL_FOREACH(resource->observersHead, observer)
+    {
+        RetainObserver(observer);
+        observers[i++] = observer;
+    }
+
+    LockResourceList();
+    RetainResource(resource);
+    UnlockResourceList();
+
+    *count = observerCount;
+    return observers;
+}
+
+/**
+ * Release the observers retained by RetainObservers() or collected by
+ * SendListObserverNotification(), together with their resource.
+ * Must be called without g_observerLock.
+ *
+ * @param resource Observed resource.
+ * @param observers Retained observers, entries may be NULL.
+ * @param count Number of entries in observers.
+ */
+static void ReleaseObservers(OCResource *resource, ResourceObserver **observers, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (observers[i])
+        {
+            ReleaseObserver(observers[i]);
+        }
+    }
+    OICFree(observers);
+    ReleaseResource(resource);
+}
+
 #ifdef WITH_PRESENCE
 OCStackResult SendAllObserverNotification (OCMethod method, OCResource *resPtr, uint32_t maxAge,
         OCPresenceTrigger trigger, OCResourceType *resourceType, OCQualityOfService qos)
@@ -150,36 +471,91 @@ OCStackResult SendAllObserverNotification (OCMethod method, OCResource *resPtr,
     {
         return OC_STACK_INVALID_PARAM;
     }
+    oc_mutex_lock(g_observerLock);
     if (!resPtr->observersHead)
     {
+        oc_mutex_unlock(g_observerLock);
         OIC_LOG(INFO, TAG, "Resource has no observers");
         return OC_STACK_NO_OBSERVERS;
     }
 
+    // Entity handlers may take application locks and notify again, so they run on a
+    // snapshot of the observers instead of under the observer lock.
+    size_t observerCount = 0;
+    ResourceObserver **observers = RetainObservers(resPtr, &observerCount);
+    uint32_t sequenceNum = resPtr->sequenceNum;
+    oc_mutex_unlock(g_observerLock);
+    if (!observers)
+    {
+        return OC_STACK_NO_MEMORY;
+    }
+
     OCStackResult result = OC_STACK_ERROR;
-    ResourceObserver * resourceObserver = resPtr->observersHead;
-    OCServerRequest * request = NULL;
+    NotificationGroup *groups = NULL;
     bool observeErrorFlag = false;
+#ifdef WITH_PRESENCE
+    OCServerRequest * request = NULL;
+    OCPresencePayload *presenceResBuf = NULL;
+
+    if (method == OC_REST_PRESENCE)
+    {
+        presenceResBuf = OCPresencePayloadCreate(sequenceNum, maxAge, trigger,
+                resourceType ? resourceType->resourcetypename : NULL);
+        if (!presenceResBuf)
+        {
+            ReleaseObservers(resPtr, observers, observerCount);
+            return OC_STACK_NO_MEMORY;
+        }
+    }
+#else
+    (void)maxAge;
+#endif
 
     // Find clients that are observing this resource
-    while (resourceObserver)
+    for (size_t i = 0; i < observerCount; i++)
     {
+        ResourceObserver *resourceObserver = observers[i];
+        OCQualityOfService observerQoS = qos;
 #ifdef WITH_PRESENCE
         if (method != OC_REST_PRESENCE)
         {
 #endif
-            qos = DetermineObserverQoS(method, resourceObserver, qos);
-            result = SendObserveNotification(resourceObserver, resPtr->sequenceNum, qos);
+            if (!PrepareObserverNotification(method, resourceObserver, &observerQoS))
+            {
+                continue;
+            }
+
+            // The entity handler builds the representation from the query, so it only runs
+            // once per (query, accept format, accept version) group.
+            NotificationGroup *group = GetNotificationGroup(&groups, resourceObserver, true);
+            if (group && group->cache.valid)
+            {
+                result = SendCachedNotification(resourceObserver, sequenceNum, observerQoS,
+                                                &group->cache);
+            }
+            else
+            {
+                result = SendObserveNotification(resourceObserver, sequenceNum, observerQoS,
+                                                 group ? &group->cache : NULL);
+            }
 #ifdef WITH_PRESENCE
         }
         else
         {
+            oc_mutex_lock(g_observerLock);
+            bool registered = !resourceObserver->deletePending;
+            oc_mutex_unlock(g_observerLock);
+            if (!registered)
+            {
+                continue;
+            }
+
             OCEntityHandlerResponse ehResponse = {0};
 
             //This is effectively the implementation for the presence entity handler.
             OIC_LOG(DEBUG, TAG, "This notification is for Presence");
             result = AddServerRequest(&request, 0, 0, 1, OC_REST_GET,
-                    0, resPtr->sequenceNum, qos, resourceObserver->query,
+                    0, sequenceNum, observerQoS, resourceObserver->query,
                     NULL, OC_FORMAT_UNDEFINED, NULL,
                     resourceObserver->token, resourceObserver->tokenLength,
                     resourceObserver->resUri, 0, resourceObserver->acceptFormat,
@@ -187,27 +563,16 @@ OCStackResult SendAllObserverNotification (OCMethod method, OCResource *resPtr,
 
             if (result == OC_STACK_OK)
             {
-                OCPresencePayload* presenceResBuf = OCPresencePayloadCreate(
-                        resPtr->sequenceNum, maxAge, trigger,
-                        resourceType ? resourceType->resourcetypename : NULL);
-
-                if (!presenceResBuf)
-                {
-                    return OC_STACK_NO_MEMORY;
-                }
-
-                if (result == OC_STACK_OK)
-                {
-                    ehResponse.ehResult = OC_EH_OK;
-                    ehResponse.payload = (OCPayload*)presenceResBuf;
-                    ehResponse.persistentBufferFlag = 0;
-                    ehResponse.requestHandle = (OCRequestHandle) request;
-                    OICStrcpy(ehResponse.resourceUri, sizeof(ehResponse.resourceUri),
-                            resourceObserver->resUri);
-                    result = OCDoResponse(&ehResponse);
-                }
-
-                OCPresencePayloadDestroy(presenceResBuf);
+                NotificationGroup *group = GetNotificationGroup(&groups, resourceObserver, false);
+                request->notificationCache = group ? &group->cache : NULL;
+
+                ehResponse.ehResult = OC_EH_OK;
+                ehResponse.payload = (OCPayload*)presenceResBuf;
+                ehResponse.persistentBufferFlag = 0;
+                ehResponse.requestHandle = (OCRequestHandle) request;
+                OICStrcpy(ehResponse.resourceUri, sizeof(ehResponse.resourceUri),
+                        resourceObserver->resUri);
+                result = OCDoResponse(&ehResponse);
             }
         }
 #endif
@@ -217,10 +582,14 @@ OCStackResult SendAllObserverNotification (OCMethod method, OCResource *resPtr,
         {
             observeErrorFlag = true;
         }
-
-        resourceObserver = resourceObserver->next;
     }
 
+    DeleteNotificationGroups(groups);
+#ifdef WITH_PRESENCE
+    OCPresencePayloadDestroy(presenceResBuf);
+#endif
+    ReleaseObservers(resPtr, observers, observerCount);
+
     if (observeErrorFlag)
     {
         OIC_LOG(ERROR, TAG, "Observer notification error");
@@ -230,7 +599,7 @@ OCStackResult SendAllObserverNotification (OCMethod method, OCResource *resPtr,
 }
 
 OCStackResult SendListObserverNotification (OCResource * resource,
-        OCObservationId  *obsIdList, uint8_t numberOfIds,
+        const OCObservationId *obsIdList, size_t numberOfIds,
         const OCRepPayload *payload,
         uint32_t maxAge,
         OCQualityOfService qos)
@@ -246,23 +615,56 @@ OCStackResult SendListObserverNotification (OCResource * resource,
         return OC_STACK_NO_OBSERVERS;
     }
 
-    uint8_t numIds = numberOfIds;
     ResourceObserver *observer = NULL;
-    uint8_t numSentNotification = 0;
+    size_t numSentNotification = 0;
     OCServerRequest * request = NULL;
     OCStackResult result = OC_STACK_ERROR;
     bool observeErrorFlag = false;
+    NotificationGroup *groups = NULL;
 
     OIC_LOG(INFO, TAG, "Entering SendListObserverNotification");
-    while(numIds)
+
+    // The same representation goes to every observer, so it is encoded once per
+    // (accept format, accept version) group and every other observer reuses the bytes.
+    OCRepPayload *notificationPayload = OCRepPayloadCreate();
+    if (!notificationPayload)
+    {
+        return OC_STACK_NO_MEMORY;
+    }
+    memcpy(notificationPayload, payload, sizeof(*payload));
+
+    ResourceObserver **observers =
+        (ResourceObserver **) OICCalloc(numberOfIds, sizeof(ResourceObserver *));
+    if (!observers)
+    {
+        OICFree(notificationPayload);
+        return OC_STACK_NO_MEMORY;
+    }
+
+    // The observers are looked up under the lock and notified without it.
+    oc_mutex_lock(g_observerLock);
+    for (size_t i = 0; i < numberOfIds; i++)
     {
-        observer = GetObserverUsingId (resource, *obsIdList);
-        if (observer)
+        observers[i] = GetObserverUsingId (resource, obsIdList[i]);
+        if (observers[i])
         {
-            qos = DetermineObserverQoS(OC_REST_GET, observer, qos);
+            RetainObserver(observers[i]);
+        }
+    }
+    uint32_t sequenceNum = resource->sequenceNum;
+    LockResourceList();
+    RetainResource(resource);
+    UnlockResourceList();
+    oc_mutex_unlock(g_observerLock);
 
+    for (size_t i = 0; i < numberOfIds; i++)
+    {
+        observer = observers[i];
+        OCQualityOfService observerQoS = qos;
+        if (observer && PrepareObserverNotification(OC_REST_GET, observer, &observerQoS))
+        {
             result = AddServerRequest(&request, 0, 0, 1, OC_REST_GET,
-                    0, resource->sequenceNum, qos, observer->query,
+                    0, sequenceNum, observerQoS, observer->query,
                     NULL, OC_FORMAT_UNDEFINED, NULL, observer->token, observer->tokenLength,
                     observer->resUri, 0, observer->acceptFormat,
                     observer->acceptVersion, &observer->devAddr);
@@ -272,34 +674,27 @@ OCStackResult SendListObserverNotification (OCResource * resource,
                 request->observeResult = OC_STACK_OK;
                 if (result == OC_STACK_OK)
                 {
+                    NotificationGroup *group = GetNotificationGroup(&groups, observer, false);
+                    request->notificationCache = group ? &group->cache : NULL;
+
                     OCEntityHandlerResponse ehResponse = {0};
                     ehResponse.ehResult = OC_EH_OK;
-                    ehResponse.payload = (OCPayload*)OCRepPayloadCreate();
-                    if (!ehResponse.payload)
-                    {
-                        DeleteServerRequest(request);
-                        continue;
-                    }
-                    memcpy(ehResponse.payload, payload, sizeof(*payload));
+                    ehResponse.payload = (OCPayload*)notificationPayload;
                     ehResponse.persistentBufferFlag = 0;
                     ehResponse.requestHandle = (OCRequestHandle) request;
                     result = OCDoResponse(&ehResponse);
                     if (result == OC_STACK_OK)
                     {
-                        OIC_LOG_V(INFO, TAG, "Observer id %d notified.", *obsIdList);
+                        OIC_LOG_V(INFO, TAG, "Observer id %u notified.", obsIdList[i]);
 
                         // Increment only if OCDoResponse is successful
                         numSentNotification++;
-
-                        OICFree(ehResponse.payload);
                     }
                     else
                     {
-                        OIC_LOG_V(INFO, TAG, "Error notifying observer id %d.", *obsIdList);
+                        OIC_LOG_V(INFO, TAG, "Error notifying observer id %u.", obsIdList[i]);
                     }
-                    // Reset Observer TTL.
-                    observer->TTL =
-                            GetTicks(MAX_OBSERVER_TTL_SECONDS * MILLISECONDS_PER_SECOND);
+                    ResetObserverTTL(observer);
                 }
                 else
                 {
@@ -313,10 +708,13 @@ OCStackResult SendListObserverNotification (OCResource * resource,
                 observeErrorFlag = true;
             }
         }
-        obsIdList++;
-        numIds--;
     }
 
+    DeleteNotificationGroups(groups);
+    ReleaseObservers(resource, observers, numberOfIds);
+    // Shallow copy of the caller's payload; the values still belong to the caller.
+    OICFree(notificationPayload);
+
     if (numSentNotification == numberOfIds && !observeErrorFlag)
     {
         return OC_STACK_OK;
@@ -333,15 +731,28 @@ OCStackResult GenerateObserverId (OCObservationId *observationId)
     OIC_LOG(INFO, TAG, "Entering GenerateObserverId");
     VERIFY_NON_NULL (observationId);
 
+    oc_mutex_lock(g_observerLock);
+    // Bindings that carry 8 bit IDs keep working while at most half of that range is taken.
+    bool shortId = (g_observerCount < OBSERVER_SHORT_ID_RANGE / 2);
     do
     {
-        if (!OCGetRandomBytes((uint8_t*)observationId, sizeof(OCObservationId)))
+        uint8_t shortValue = 0;
+        bool generated = shortId ?
+            OCGetRandomBytes(&shortValue, sizeof(shortValue)) :
+            OCGetRandomBytes((uint8_t*)observationId, sizeof(OCObservationId));
+        if (!generated)
         {
+            oc_mutex_unlock(g_observerLock);
             OIC_LOG(ERROR, TAG, "Failed to generate random observationId");
             goto exit;
         }
+        if (shortId)
+        {
+            *observationId = shortValue;
+        }
     // Check if observation Id already exists.
     } while (IsObservationIdExisting(*observationId));
+    oc_mutex_unlock(g_observerLock);
 
     OIC_LOG_V(INFO, TAG, "GeneratedObservation ID is %u", *observationId);
 
@@ -350,6 +761,11 @@ exit:
     return OC_STACK_ERROR;
 }
 
+static uint32_t HashObserveId(OCObservationId observeId)
+{
+    return OCHashBytes(OC_HASH_INIT, &observeId, sizeof(observeId));
+}
+
 OCStackResult AddObserver (const char         *resUri,
                            const char         *query,
                            OCObservationId    obsId,
@@ -413,7 +829,17 @@ OCStackResult AddObserver (const char         *resUri,
             obsNode->TTL = GetTicks(MAX_OBSERVER_TTL_SECONDS * MILLISECONDS_PER_SECOND);
         }
 
+        oc_mutex_lock(g_observerLock);
+        if (!OCHashTableInsert(&resHandle->observersById, &obsNode->idLink,
+                               HashObserveId(obsId)))
+        {
+            oc_mutex_unlock(g_observerLock);
+            OIC_LOG(ERROR, TAG, "Failed to index observer");
+            goto exit;
+        }
         LL_APPEND (resHandle->observersHead, obsNode);
+        g_observerCount++;
+        oc_mutex_unlock(g_observerLock);
 
         return OC_STACK_OK;
     }
@@ -421,19 +847,18 @@ OCStackResult AddObserver (const char         *resUri,
 exit:
     if (obsNode)
     {
-        OICFree(obsNode->resUri);
-        OICFree(obsNode->query);
-        OICFree(obsNode);
+        FreeObserver(obsNode);
     }
     return OC_STACK_NO_MEMORY;
 }
 
 /*
  * This function checks if the node is past its time to live and
- * deletes it if timed-out. Calling this function with a  presence callback
- * with ttl set to 0 will not delete anything as presence nodes have
+ * queues a confirmable notification if timed-out. Calling this function with a  presence
+ * callback with ttl set to 0 will not queue anything as presence nodes have
  * their own mechanisms for timeouts. A null argument will cause the function to
- * silently return.
+ * silently return. It is called with g_observerLock held, so the notification is sent
+ * later by SendTimedOutObserverNotifications().
  */
 static void CheckTimedOutObserver(ResourceObserver* observer, OCResource *resource)
 {
@@ -447,30 +872,64 @@ static void CheckTimedOutObserver(ResourceObserver* observer, OCResource *resour
 
     if (observer->TTL < now)
     {
-        // Send confirmable notification message to observer.
-        OIC_LOG(INFO, TAG, "Sending High-QoS notification to observer");
-        SendObserveNotification(observer, resource->sequenceNum, OC_HIGH_QOS);
+        TimedOutObserver *entry = (TimedOutObserver *) OICCalloc(1, sizeof(TimedOutObserver));
+        if (!entry)
+        {
+            OIC_LOG(ERROR, TAG, "Failed to queue High-QoS notification to observer");
+            return;
+        }
+        OIC_LOG(INFO, TAG, "Queueing High-QoS notification to observer");
+        RetainObserver(observer);
+        entry->observer = observer;
+        entry->sequenceNum = resource->sequenceNum;
+        // Not queued again while the notification is pending.
+        observer->TTL = GetTicks(MAX_OBSERVER_TTL_SECONDS * MILLISECONDS_PER_SECOND);
+        LL_APPEND(g_timedOutObservers, entry);
+        OCWakeProcess();
+    }
+}
+
+void SendTimedOutObserverNotifications()
+{
+    oc_mutex_lock(g_observerLock);
+    TimedOutObserver *entries = g_timedOutObservers;
+    g_timedOutObservers = NULL;
+    oc_mutex_unlock(g_observerLock);
+
+    TimedOutObserver *entry = NULL;
+    TimedOutObserver *tmp = NULL;
+    LL_FOREACH_SAFE(entries, entry, tmp)
+    {
+        LL_DELETE(entries, entry);
+        oc_mutex_lock(g_observerLock);
+        bool registered = !entry->observer->deletePending;
+        oc_mutex_unlock(g_observerLock);
+        if (registered)
+        {
+            // Send confirmable notification message to observer.
+            OIC_LOG(INFO, TAG, "Sending High-QoS notification to observer");
+            SendObserveNotification(entry->observer, entry->sequenceNum, OC_HIGH_QOS, NULL);
+        }
+        ReleaseObserver(entry->observer);
+        OICFree(entry);
     }
 }
 
 ResourceObserver* GetObserverUsingId(OCResource *resource,
                                      const OCObservationId observeId)
 {
-    ResourceObserver *out = NULL;
-
-    LL_FOREACH (resource->observersHead, out)
+    for (OCHashLink *link = OCHashTableFirst(&resource->observersById,
+                                             HashObserveId(observeId));
+         link; link = OCHashTableNext(link))
     {
+        ResourceObserver *out = OC_HASH_ENTRY(link, ResourceObserver, idLink);
         if (out->observeId == observeId)
         {
             return out;
         }
-        CheckTimedOutObserver(out, resource);
     }
 
-    if (!out)
-    {
-        OIC_LOG(INFO, TAG, "Observer node not found!!");
-    }
+    OIC_LOG(INFO, TAG, "Observer node not found!!");
     return NULL;
 }
 
@@ -512,18 +971,24 @@ OCStackResult DeleteObserverUsingToken (OCResource *resource,
         return OC_STACK_INVALID_PARAM;
     }
 
+    oc_mutex_lock(g_observerLock);
     ResourceObserver *obsNode = GetObserverUsingToken (resource, token, tokenLength);
     if (obsNode)
     {
         OIC_LOG_V(INFO, TAG, "deleting observer id  %u with token", obsNode->observeId);
         OIC_LOG_BUFFER(INFO, TAG, (const uint8_t *)obsNode->token, tokenLength);
         LL_DELETE (resource->observersHead, obsNode);
-        OICFree(obsNode->resUri);
-        OICFree(obsNode->query);
-        OICFree(obsNode->token);
-        OICFree(obsNode);
+        OCHashTableRemove(&resource->observersById, &obsNode->idLink);
+        g_observerCount--;
+        // A notification still being sent to the observer frees it when it is done.
+        obsNode->deletePending = (obsNode->refCount > 0);
+        if (!obsNode->deletePending)
+        {
+            FreeObserver(obsNode);
+        }
         obsNode = NULL;
     }
+    oc_mutex_unlock(g_observerLock);
     // it is ok if we did not find the observer...
     return OC_STACK_OK;
 }
@@ -532,11 +997,53 @@ void DeleteObserverList(OCResource *resource)
 {
     ResourceObserver *out = NULL;
     ResourceObserver *tmp = NULL;
+    oc_mutex_lock(g_observerLock);
     LL_FOREACH_SAFE(resource->observersHead, out, tmp)
     {
         DeleteObserverUsingToken(resource, out->token, out->tokenLength);
     }
     resource->observersHead = NULL;
+    OCHashTableClear(&resource->observersById);
+    oc_mutex_unlock(g_observerLock);
+}
+
+OCStackResult InitializeObserverLists()
+{
+    assert(g_observerLock == NULL);
+
+    g_observerLock = oc_mutex_new_recursive();
+    if (g_observerLock == NULL)
+    {
+        return OC_STACK_ERROR;
+    }
+    return OC_STACK_OK;
+}
+
+void TerminateObserverLists()
+{
+    if (g_observerLock != NULL)
+    {
+        TimedOutObserver *entry = NULL;
+        TimedOutObserver *tmp = NULL;
+        LL_FOREACH_SAFE(g_timedOutObservers, entry, tmp)
+        {
+            LL_DELETE(g_timedOutObservers, entry);
+            ReleaseObserver(entry->observer);
+            OICFree(entry);
+        }
+        oc_mutex_free(g_observerLock);
+        g_observerLock = NULL;
+    }
+}
+
+void LockObserverLists()
+{
+    oc_mutex_lock(g_observerLock);
+}
+
+void UnlockObserverLists()
+{
+    oc_mutex_unlock(g_observerLock);
 }
 
 /*
@@ -652,11 +1159,15 @@ HandleVirtualObserveRequest(OCServerRequest *request)
     if (request->observationOption == OC_OBSERVE_REGISTER)
     {
         OIC_LOG(INFO, TAG, "Observation registration requested");
+        // Held until the observer is added, so a retransmission dispatched meanwhile
+        // cannot add it twice.
+        oc_mutex_lock(g_observerLock);
         ResourceObserver *obs = GetObserverUsingToken (resourcePtr,
                                                        request->requestToken,
                                                        request->tokenLength);
         if (obs)
         {
+            oc_mutex_unlock(g_observerLock);
             OIC_LOG (INFO, TAG, "Observer with this token already present");
             OIC_LOG (INFO, TAG, "Possibly re-transmitted CON OBS request");
             OIC_LOG (INFO, TAG, "Not adding observer. Not responding to client");
@@ -674,6 +1185,7 @@ HandleVirtualObserveRequest(OCServerRequest *request)
                                   resourcePtr, request->qos, request->acceptFormat,
                                   request->acceptVersion, &request->devAddr);
         }
+        oc_mutex_unlock(g_observerLock);
         if (result == OC_STACK_OK)
         {
             OIC_LOG(INFO, TAG, "Added observer successfully");
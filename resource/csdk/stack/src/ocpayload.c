@@ -30,6 +30,7 @@
 #include "oic_malloc.h"
 #include "oic_string.h"
 #include "ocstackinternal.h"
+#include "ocpayloadcbor.h"
 #include "ocresource.h"
 #include "experimental/logger.h"
 #include "ocendpoint.h"
@@ -68,6 +69,9 @@ void OC_CALL OCPayloadDestroy(OCPayload* payload)
         case PAYLOAD_TYPE_INTROSPECTION:
             OCIntrospectionPayloadDestroy((OCIntrospectionPayload*)payload);
             break;
+        case PAYLOAD_TYPE_ENCODED:
+            OCEncodedPayloadDestroy((OCEncodedPayload*)payload);
+            break;
         default:
             OIC_LOG_V(ERROR, TAG, "Unsupported payload type in destroy: %d", payload->type);
             OICFree(payload);
@@ -1725,6 +1729,129 @@ void OC_CALL OCIntrospectionPayloadDestroy(OCIntrospectionPayload* payload)
     OICFree(payload);
 }
 
+OCEncodedPayload* OC_CALL OCEncodedPayloadCreate(const uint8_t* cborData, size_t size)
+{
+    if (!cborData || !size)
+    {
+        return NULL;
+    }
+
+    uint8_t* bytes = (uint8_t*)OICMalloc(size);
+    if (!bytes)
+    {
+        return NULL;
+    }
+    memcpy(bytes, cborData, size);
+
+    OCEncodedPayload* payload = OCEncodedPayloadCreateAsOwner(bytes, size);
+    if (!payload)
+    {
+        OICFree(bytes);
+    }
+    return payload;
+}
+
+OCEncodedPayload* OC_CALL OCEncodedPayloadCreateAsOwner(uint8_t* cborData, size_t size)
+{
+    if (!cborData || !size)
+    {
+        return NULL;
+    }
+
+    OCEncodedPayload* payload = (OCEncodedPayload*)OICCalloc(1, sizeof(OCEncodedPayload));
+    if (!payload)
+    {
+        return NULL;
+    }
+
+    payload->base.type = PAYLOAD_TYPE_ENCODED;
+    payload->cborPayload.bytes = cborData;
+    payload->cborPayload.len = size;
+
+    return payload;
+}
+
+OCEncodedPayload* OC_CALL OCEncodedPayloadCreateProduced(size_t size, OCPayloadProducer producer,
+                                                         void* context, OCPayloadRelease release)
+{
+    OCEncodedPayload* payload = NULL;
+    if (producer && size)
+    {
+        payload = (OCEncodedPayload*)OICCalloc(1, sizeof(OCEncodedPayload));
+    }
+    if (!payload)
+    {
+        if (release)
+        {
+            release(context);
+        }
+        return NULL;
+    }
+
+    payload->base.type = PAYLOAD_TYPE_ENCODED;
+    payload->cborPayload.len = size;
+    payload->producer = producer;
+    payload->producerContext = context;
+    payload->release = release;
+
+    return payload;
+}
+
+void OC_CALL OCEncodedPayloadDestroy(OCEncodedPayload* payload)
+{
+    if (!payload)
+    {
+        return;
+    }
+
+    if (payload->release)
+    {
+        payload->release(payload->producerContext);
+    }
+    OICFree(payload->cborPayload.bytes);
+    OICFree(payload);
+}
+
+OCStackResult OC_CALL OCEncodedPayloadParse(const OCEncodedPayload* payload,
+                                            OCRepPayload** outPayload)
+{
+    if (!payload || !outPayload)
+    {
+        return OC_STACK_INVALID_PARAM;
+    }
+
+    *outPayload = NULL;
+    const uint8_t* bytes = payload->cborPayload.bytes;
+    uint8_t* produced = NULL;
+    if (!bytes && payload->producer)
+    {
+        produced = (uint8_t*)OICMalloc(payload->cborPayload.len);
+        if (!produced)
+        {
+            return OC_STACK_NO_MEMORY;
+        }
+        if (!payload->producer(payload->producerContext, 0, produced, payload->cborPayload.len))
+        {
+            OICFree(produced);
+            return OC_STACK_ERROR;
+        }
+        bytes = produced;
+    }
+
+    OCPayload* parsed = NULL;
+    OCStackResult result = OCParsePayload(&parsed, OC_FORMAT_CBOR, PAYLOAD_TYPE_REPRESENTATION,
+                                          bytes, payload->cborPayload.len);
+    OICFree(produced);
+    if (OC_STACK_OK != result)
+    {
+        OCPayloadDestroy(parsed);
+        return result;
+    }
+
+    *outPayload = (OCRepPayload*)parsed;
+    return OC_STACK_OK;
+}
+
 size_t OC_CALL OCDiscoveryPayloadGetResourceCount(OCDiscoveryPayload* payload)
 {
     size_t i = 0;
@@ -60,9 +60,13 @@ static int64_t OCConvertSecurityPayload(OCSecurityPayload *payload, uint8_t *out
         size_t *size);
 static int64_t OCConvertIntrospectionPayload(OCIntrospectionPayload *payload, uint8_t *outPayload,
         size_t *size);
+static int64_t OCConvertEncodedPayload(OCEncodedPayload *payload, uint8_t *outPayload,
+        size_t *size);
 static int64_t OCConvertSingleRepPayloadValue(CborEncoder *parent, const OCRepPayloadValue *value);
 static int64_t OCConvertSingleRepPayload(CborEncoder *parent, const OCRepPayload *payload);
 static int64_t OCConvertArray(CborEncoder *parent, const OCRepPayloadValueArray *valArray);
+static bool OCRepMapIsArray(const OCRepPayload *payload, size_t *arrayLength);
+static size_t OCEstimatePayloadSize(OCPayload *payload, OCPayloadFormat format);
 
 static int64_t AddTextStringToMap(CborEncoder *map, const char *key, size_t keylen,
         const char *value);
@@ -83,6 +87,7 @@ OCStackResult OCConvertPayload(OCPayload* payload, OCPayloadFormat format,
     int64_t err = CborErrorOutOfMemory;
     uint8_t *out = NULL;
     size_t curSize = INIT_SIZE;
+    size_t allocSize = 0;
 
     VERIFY_PARAM_NON_NULL(TAG, payload, "Input param, payload is NULL");
     VERIFY_PARAM_NON_NULL(TAG, outPayload, "OutPayload parameter is NULL");
@@ -97,7 +102,7 @@ OCStackResult OCConvertPayload(OCPayload* payload, OCPayloadFormat format,
             curSize = securityPayloadSize;
         }
     }
-    if (PAYLOAD_TYPE_INTROSPECTION == payload->type)
+    else if (PAYLOAD_TYPE_INTROSPECTION == payload->type)
     {
         size_t introspectionPayloadSize = ((OCIntrospectionPayload *)payload)->cborPayload.len;
         if (introspectionPayloadSize > 0)
@@ -105,11 +110,31 @@ OCStackResult OCConvertPayload(OCPayload* payload, OCPayloadFormat format,
             curSize = introspectionPayloadSize;
         }
     }
+    else if (PAYLOAD_TYPE_ENCODED == payload->type)
+    {
+        size_t encodedPayloadSize = ((OCEncodedPayload *)payload)->cborPayload.len;
+        if (encodedPayloadSize > 0)
+        {
+            curSize = encodedPayloadSize;
+        }
+    }
+
+    else
+    {
+        // Size the buffer from the payload so that it is encoded only once.  The estimate
+        // never falls short for the types it knows, the retry below is only a safety net.
+        size_t estimate = OCEstimatePayloadSize(payload, format);
+        if (estimate > 0)
+        {
+            curSize = estimate;
+        }
+    }
 
     ret = OC_STACK_NO_MEMORY;
 
     for (;;)
     {
+        allocSize = curSize;
         out = (uint8_t *)OICCalloc(1, curSize);
         VERIFY_PARAM_NON_NULL(TAG, out, "Failed to allocate payload");
         err = OCConvertPayloadHelper(payload, format, out, &curSize);
@@ -124,9 +149,10 @@ OCStackResult OCConvertPayload(OCPayload* payload, OCPayloadFormat format,
 
     if (err == CborNoError)
     {
-        if ((curSize < INIT_SIZE) &&
+        if ((curSize < allocSize) &&
             (PAYLOAD_TYPE_SECURITY != payload->type) &&
-            (PAYLOAD_TYPE_INTROSPECTION != payload->type))
+            (PAYLOAD_TYPE_INTROSPECTION != payload->type) &&
+            (PAYLOAD_TYPE_ENCODED != payload->type))
         {
             uint8_t *out2 = (uint8_t *)OICRealloc(out, curSize);
             VERIFY_PARAM_NON_NULL(TAG, out2, "Failed to increase payload size");
@@ -167,6 +193,8 @@ static int64_t OCConvertPayloadHelper(OCPayload* payload, OCPayloadFormat format
         case PAYLOAD_TYPE_INTROSPECTION:
             return OCConvertIntrospectionPayload((OCIntrospectionPayload*)payload,
                                                  outPayload, size);
+        case PAYLOAD_TYPE_ENCODED:
+            return OCConvertEncodedPayload((OCEncodedPayload*)payload, outPayload, size);
         default:
             OIC_LOG_V(INFO, TAG, "ConvertPayload default %d", payload->type);
             return CborErrorUnknownType;
@@ -210,6 +238,27 @@ static int64_t OCConvertIntrospectionPayload(OCIntrospectionPayload *payload,
     return CborNoError;
 }
 
+static int64_t OCConvertEncodedPayload(OCEncodedPayload *payload, uint8_t *outPayload,
+        size_t *size)
+{
+    if (!payload->cborPayload.bytes && payload->producer)
+    {
+        // Sent without a producer after all, e.g. to several endpoints, so produce it whole.
+        if (!payload->producer(payload->producerContext, 0, outPayload,
+                               payload->cborPayload.len))
+        {
+            return CborErrorInternalError;
+        }
+    }
+    else
+    {
+        memcpy(outPayload, payload->cborPayload.bytes, payload->cborPayload.len);
+    }
+    *size = payload->cborPayload.len;
+
+    return CborNoError;
+}
+
 static int64_t OCStringLLJoin(CborEncoder *map, char *type, OCStringLL *val)
 {
     uint16_t count = 0;
@@ -815,28 +864,32 @@ exit:
     return err;
 }
 
-static int64_t OCConvertRepMap(CborEncoder *map, const OCRepPayload *payload)
+// Encode payload as an array when value names are consecutive
+// non-negative integers.  Otherwise encode as a map.
+static bool OCRepMapIsArray(const OCRepPayload *payload, size_t *arrayLength)
 {
-    int64_t err = CborNoError;
-    CborEncoder encoder;
-    OCRepPayloadValue *value = NULL;
-    size_t arrayLength = 0;
-
-    // Encode payload as an array when value names are consecutive
-    // non-negative integers.  Otherwise encode as a map.
-    arrayLength = 0;
-    for (value = payload->values; value; value = value->next)
+    *arrayLength = 0;
+    for (const OCRepPayloadValue *value = payload->values; value; value = value->next)
     {
         char *endp = NULL;
         long i = strtol(value->name, &endp, 0);
-        if (*endp != '\0' || i < 0 || arrayLength != (size_t)i)
+        if (*endp != '\0' || i < 0 || *arrayLength != (size_t)i)
         {
-            break;
+            return false;
         }
-        ++arrayLength;
+        ++*arrayLength;
     }
+    return true;
+}
 
-    if (value)
+static int64_t OCConvertRepMap(CborEncoder *map, const OCRepPayload *payload)
+{
+    int64_t err = CborNoError;
+    CborEncoder encoder;
+    OCRepPayloadValue *value = NULL;
+    size_t arrayLength = 0;
+
+    if (!OCRepMapIsArray(payload, &arrayLength))
     {
         err |= cbor_encoder_create_map(map, &encoder, CborIndefiniteLength);
         VERIFY_CBOR_SUCCESS_OR_OUT_OF_MEMORY(TAG, err, "Failed creating rep map");
@@ -1065,3 +1118,323 @@ static int64_t ConditionalAddTextStringToMap(CborEncoder* map, const char* key,
 {
     return value ? AddTextStringToMap(map, key, keylen, value) : 0;
 }
+
+// Size of the initial byte of a CBOR item plus the argument that follows it.
+static size_t CborHeadSize(uint64_t value)
+{
+    if (value < 24)
+    {
+        return 1;
+    }
+    if (value <= UINT8_MAX)
+    {
+        return 2;
+    }
+    if (value <= UINT16_MAX)
+    {
+        return 3;
+    }
+    if (value <= UINT32_MAX)
+    {
+        return 5;
+    }
+    return 9;
+}
+
+static size_t CborIntSize(int64_t value)
+{
+    // Negative integers carry -1 - value, which is what the bitwise complement yields.
+    return CborHeadSize((value < 0) ? ~(uint64_t)value : (uint64_t)value);
+}
+
+static size_t CborTextSize(const char *str)
+{
+    size_t len = str ? strlen(str) : 0;
+    return CborHeadSize(len) + len;
+}
+
+// Indefinite length containers take a start byte and a break byte.
+#define CBOR_INDEFINITE_CONTAINER_SIZE (2)
+#define CBOR_DOUBLE_SIZE (9)
+#define CBOR_SIMPLE_SIZE (1)
+
+static size_t OCEstimateStringLL(const char *type, const OCStringLL *val)
+{
+    size_t count = 0;
+    size_t size = 0;
+    for (; val; val = val->next)
+    {
+        ++count;
+        size += CborTextSize(val->value);
+    }
+    return count ? CborTextSize(type) + CborHeadSize(count) + size : 0;
+}
+
+static size_t OCEstimateRepMap(const OCRepPayload *payload);
+
+static size_t OCEstimateArrayItem(const OCRepPayloadValueArray *valArray, size_t index)
+{
+    switch (valArray->type)
+    {
+        case OCREP_PROP_INT:
+            return valArray->iArray ? CborIntSize(valArray->iArray[index]) : 0;
+        case OCREP_PROP_DOUBLE:
+            return valArray->dArray ? CBOR_DOUBLE_SIZE : 0;
+        case OCREP_PROP_BOOL:
+            return valArray->bArray ? CBOR_SIMPLE_SIZE : 0;
+        case OCREP_PROP_STRING:
+            if (!valArray->strArray)
+            {
+                return 0;
+            }
+            return valArray->strArray[index] ? CborTextSize(valArray->strArray[index])
+                                             : CBOR_SIMPLE_SIZE;
+        case OCREP_PROP_BYTE_STRING:
+            return CborHeadSize(valArray->ocByteStrArray[index].len) +
+                   valArray->ocByteStrArray[index].len;
+        case OCREP_PROP_OBJECT:
+            if (!valArray->objArray)
+            {
+                return 0;
+            }
+            return valArray->objArray[index] ? OCEstimateRepMap(valArray->objArray[index])
+                                             : CBOR_SIMPLE_SIZE;
+        default:
+            // Not encodable, the conversion itself reports the error.
+            return 0;
+    }
+}
+
+static size_t OCEstimateArray(const OCRepPayloadValueArray *valArray)
+{
+    size_t size = CborHeadSize(valArray->dimensions[0]);
+    for (size_t i = 0; i < valArray->dimensions[0]; ++i)
+    {
+        if (0 == valArray->dimensions[1])
+        {
+            size += OCEstimateArrayItem(valArray, i);
+            continue;
+        }
+        size += CborHeadSize(valArray->dimensions[1]);
+        for (size_t j = 0; j < valArray->dimensions[1]; ++j)
+        {
+            if (0 == valArray->dimensions[2])
+            {
+                size += OCEstimateArrayItem(valArray, i * valArray->dimensions[1] + j);
+                continue;
+            }
+            size += CborHeadSize(valArray->dimensions[2]);
+            for (size_t k = 0; k < valArray->dimensions[2]; ++k)
+            {
+                size += OCEstimateArrayItem(valArray,
+                        j * valArray->dimensions[2] +
+                        i * valArray->dimensions[2] * valArray->dimensions[1] +
+                        k);
+            }
+        }
+    }
+    return size;
+}
+
+static size_t OCEstimateSingleRepPayloadValue(const OCRepPayloadValue *value)
+{
+    switch (value->type)
+    {
+        case OCREP_PROP_NULL:
+        case OCREP_PROP_BOOL:
+            return CBOR_SIMPLE_SIZE;
+        case OCREP_PROP_INT:
+            return CborIntSize(value->i);
+        case OCREP_PROP_DOUBLE:
+            return CBOR_DOUBLE_SIZE;
+        case OCREP_PROP_STRING:
+            return CborTextSize(value->str);
+        case OCREP_PROP_BYTE_STRING:
+            return CborHeadSize(value->ocByteStr.len) + value->ocByteStr.len;
+        case OCREP_PROP_OBJECT:
+            return value->obj ? OCEstimateRepMap(value->obj) : 0;
+        case OCREP_PROP_ARRAY:
+            return OCEstimateArray(&value->arr);
+        default:
+            return 0;
+    }
+}
+
+static size_t OCEstimateSingleRepPayload(const OCRepPayload *payload)
+{
+    size_t size = 0;
+    if (payload->uri && strlen(payload->uri) > 0)
+    {
+        size += CborTextSize(OC_RSRVD_HREF) + CborTextSize(payload->uri);
+    }
+    size += OCEstimateStringLL(OC_RSRVD_RESOURCE_TYPE, payload->types);
+    size += OCEstimateStringLL(OC_RSRVD_INTERFACE, payload->interfaces);
+    for (const OCRepPayloadValue *value = payload->values; value; value = value->next)
+    {
+        size += CborTextSize(value->name) + OCEstimateSingleRepPayloadValue(value);
+    }
+    return size;
+}
+
+static size_t OCEstimateRepMap(const OCRepPayload *payload)
+{
+    size_t arrayLength = 0;
+    if (!OCRepMapIsArray(payload, &arrayLength))
+    {
+        return CBOR_INDEFINITE_CONTAINER_SIZE + OCEstimateSingleRepPayload(payload);
+    }
+
+    size_t size = CborHeadSize(arrayLength);
+    for (const OCRepPayloadValue *value = payload->values; value; value = value->next)
+    {
+        size += OCEstimateSingleRepPayloadValue(value);
+    }
+    return size;
+}
+
+static size_t OCEstimateRepPayload(const OCRepPayload *payload)
+{
+    size_t arrayCount = 0;
+    size_t size = 0;
+    for (; payload; payload = payload->next)
+    {
+        ++arrayCount;
+        size += CBOR_INDEFINITE_CONTAINER_SIZE + OCEstimateSingleRepPayload(payload);
+    }
+    return (arrayCount > 1) ? CborHeadSize(arrayCount) + size : size;
+}
+
+// Upper bound of the string OCCreateEndpointString() builds, "tps://[addr]:port".
+static size_t OCEstimateEndpointString(const OCEndpointPayload *endpoint)
+{
+    size_t len = (endpoint->tps ? strlen(endpoint->tps) : 0) +
+                 (endpoint->addr ? strlen(endpoint->addr) : 0) +
+                 sizeof("://[]:65535") - 1;
+    return CborHeadSize(len) + len;
+}
+
+// Policy map of a link: bitmap, secure flag and the ports that may follow them.
+static size_t OCEstimatePolicy(const OCResourcePayload *resource)
+{
+    return CborTextSize(OC_RSRVD_POLICY) + CBOR_INDEFINITE_CONTAINER_SIZE +
+           CborTextSize(OC_RSRVD_BITMAP) + CborHeadSize(resource->bitmap) +
+           CborTextSize(OC_RSRVD_SECURE) + CBOR_SIMPLE_SIZE +
+           CborTextSize(OC_RSRVD_HOSTING_PORT) + CborHeadSize(UINT16_MAX) +
+           CborTextSize(OC_RSRVD_TCP_PORT) + CborHeadSize(UINT16_MAX);
+}
+
+static size_t OCEstimateDiscoveryLink(const OCResourcePayload *resource,
+                                      const OCEndpointPayload *endpoint)
+{
+    size_t uriLen = (resource->uri ? strlen(resource->uri) : 0);
+    if (endpoint)
+    {
+        uriLen += OCEstimateEndpointString(endpoint);
+    }
+    return CborHeadSize(LINKS_MAP_LEN + 1) +
+           CborTextSize(OC_RSRVD_HREF) + CborHeadSize(uriLen) + uriLen +
+           (resource->rel ? CborTextSize(OC_RSRVD_REL) + CborTextSize(resource->rel) : 0) +
+           OCEstimateStringLL(OC_RSRVD_RESOURCE_TYPE, resource->types) +
+           OCEstimateStringLL(OC_RSRVD_INTERFACE, resource->interfaces) +
+           OCEstimatePolicy(resource);
+}
+
+static size_t OCEstimateDiscoveryPayloadCbor(const OCDiscoveryPayload *payload)
+{
+    size_t arrayCount = 0;
+    size_t size = 0;
+    for (; payload; payload = payload->next)
+    {
+        ++arrayCount;
+        size += CBOR_INDEFINITE_CONTAINER_SIZE +
+                (payload->name ? CborTextSize(OC_RSRVD_DEVICE_NAME) +
+                                 CborTextSize(payload->name) : 0) +
+                CborTextSize(OC_RSRVD_DEVICE_ID) + CborTextSize(payload->sid) +
+                OCEstimateStringLL(OC_RSRVD_RESOURCE_TYPE, payload->type) +
+                OCEstimateStringLL(OC_RSRVD_INTERFACE, payload->iface) +
+                CborTextSize(OC_RSRVD_LINKS) + CBOR_INDEFINITE_CONTAINER_SIZE;
+
+        // Links of remote resources are repeated for every endpoint; sizing them all as
+        // such keeps this an upper bound without looking up the server's own device ID.
+        for (const OCResourcePayload *resource = payload->resources; resource;
+             resource = resource->next)
+        {
+            size += OCEstimateDiscoveryLink(resource, NULL);
+            for (const OCEndpointPayload *ep = resource->eps; ep; ep = ep->next)
+            {
+                size += OCEstimateDiscoveryLink(resource, ep);
+            }
+        }
+    }
+    return CborHeadSize(arrayCount) + size;
+}
+
+static size_t OCEstimateDiscoveryPayloadVndOcfCbor(const OCDiscoveryPayload *payload)
+{
+    size_t size = CBOR_INDEFINITE_CONTAINER_SIZE;
+    if (payload->name || payload->type || payload->iface)
+    {
+        size += CborHeadSize(1) + CBOR_INDEFINITE_CONTAINER_SIZE +
+                (payload->name ? CborTextSize(OC_RSRVD_DEVICE_NAME) +
+                                 CborTextSize(payload->name) : 0) +
+                OCEstimateStringLL(OC_RSRVD_RESOURCE_TYPE, payload->type) +
+                OCEstimateStringLL(OC_RSRVD_INTERFACE, payload->iface) +
+                CborTextSize(OC_RSRVD_LINKS);
+    }
+
+    for (; payload; payload = payload->next)
+    {
+        size_t anchorLen = sizeof("ocf://") - 1 + (payload->sid ? strlen(payload->sid) : 0);
+        for (const OCResourcePayload *resource = payload->resources; resource;
+             resource = resource->next)
+        {
+            size += CBOR_INDEFINITE_CONTAINER_SIZE +
+                    CborTextSize(OC_RSRVD_HREF) + CborTextSize(resource->uri) +
+                    (resource->rel ? CborTextSize(OC_RSRVD_REL) +
+                                     CborTextSize(resource->rel) : 0) +
+                    CborTextSize(OC_RSRVD_URI) + CborHeadSize(anchorLen) + anchorLen +
+                    OCEstimateStringLL(OC_RSRVD_RESOURCE_TYPE, resource->types) +
+                    OCEstimateStringLL(OC_RSRVD_INTERFACE, resource->interfaces) +
+                    CborTextSize(OC_RSRVD_POLICY) + CBOR_INDEFINITE_CONTAINER_SIZE +
+                    CborTextSize(OC_RSRVD_BITMAP) + CborHeadSize(resource->bitmap);
+
+            size_t epsCount = 0;
+            for (const OCEndpointPayload *ep = resource->eps; ep; ep = ep->next)
+            {
+                ++epsCount;
+                size += CborHeadSize(EP_MAP_LEN) +
+                        CborTextSize(OC_RSRVD_ENDPOINT) + OCEstimateEndpointString(ep) +
+                        CborTextSize(OC_RSRVD_PRIORITY) + CborHeadSize(ep->pri);
+            }
+            if (epsCount > 0)
+            {
+                size += CborTextSize(OC_RSRVD_ENDPOINTS) + CborHeadSize(epsCount);
+            }
+        }
+    }
+    return size;
+}
+
+/**
+ * Walk a payload the way its converter does and add up the size of every item, without
+ * encoding anything.  Representations are sized exactly; discovery payloads are sized
+ * from above, as endpoint strings and policy ports are only known while encoding.
+ *
+ * @return the size to allocate, or 0 for payload types that are not sized up front.
+ */
+static size_t OCEstimatePayloadSize(OCPayload *payload, OCPayloadFormat format)
+{
+    switch (payload->type)
+    {
+        case PAYLOAD_TYPE_REPRESENTATION:
+            return OCEstimateRepPayload((OCRepPayload *)payload);
+        case PAYLOAD_TYPE_DISCOVERY:
+            if (OC_FORMAT_VND_OCF_CBOR == format)
+            {
+                return OCEstimateDiscoveryPayloadVndOcfCbor((OCDiscoveryPayload *)payload);
+            }
+            return OCEstimateDiscoveryPayloadCbor((OCDiscoveryPayload *)payload);
+        default:
+            return 0;
+    }
+}
@@ -52,6 +52,8 @@ static OCStackResult OCParseRepPayload(OCPayload **outPayload, CborValue *arrayV
 static OCStackResult OCParsePresencePayload(OCPayload **outPayload, CborValue *arrayVal);
 static OCStackResult OCParseDiagnosticPayload(OCPayload **outPayload, CborValue *arrayVal);
 static OCStackResult OCParseSecurityPayload(OCPayload **outPayload, const uint8_t *payload, size_t size);
+static OCStackResult OCParseEncodedPayload(OCPayload **outPayload, CborValue *rootValue,
+        const uint8_t *payload, size_t size);
 
 OCStackResult OCParsePayload(OCPayload **outPayload, OCPayloadFormat payloadFormat,
         OCPayloadType payloadType, const uint8_t *payload, size_t payloadSize)
@@ -88,6 +90,9 @@ OCStackResult OCParsePayload(OCPayload **outPayload, OCPayloadFormat payloadForm
         case PAYLOAD_TYPE_SECURITY:
             result = OCParseSecurityPayload(outPayload, payload, payloadSize);
             break;
+        case PAYLOAD_TYPE_ENCODED:
+            result = OCParseEncodedPayload(outPayload, &rootValue, payload, payloadSize);
+            break;
         default:
             OIC_LOG_V(ERROR, TAG, "ParsePayload Type default: %d", payloadType);
             result = OC_STACK_INVALID_PARAM;
@@ -114,6 +119,32 @@ static OCStackResult OCParseSecurityPayload(OCPayload** outPayload, const uint8_
     return OC_STACK_OK;
 }
 
+static OCStackResult OCParseEncodedPayload(OCPayload **outPayload, CborValue *rootValue,
+        const uint8_t *payload, size_t size)
+{
+    // The receiver decodes the bytes itself, only the root item is checked here.
+    if (!cbor_value_is_map(rootValue) && !cbor_value_is_array(rootValue))
+    {
+        OIC_LOG(ERROR, TAG, "Encoded payload is not a map or an array");
+        *outPayload = NULL;
+        return OC_STACK_MALFORMED_RESPONSE;
+    }
+
+    if (size > 0)
+    {
+        *outPayload = (OCPayload *)OCEncodedPayloadCreate(payload, size);
+        if (!*outPayload)
+        {
+            return OC_STACK_NO_MEMORY;
+        }
+    }
+    else
+    {
+        *outPayload = NULL;
+    }
+    return OC_STACK_OK;
+}
+
 static char* InPlaceStringTrim(char* str)
 {
     while (str[0] == ' ')
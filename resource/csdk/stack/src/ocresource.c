@@ -40,6 +40,8 @@
 #include <coap/coap.h>
 
 #include "ocresource.h"
+#include "ocresourceindex.h"
+#include "ocdiscoverycache.h"
 #include "ocresourcehandler.h"
 #include "ocobserve.h"
 #include "occollection.h"
@@ -1303,17 +1305,14 @@ OCResource *OC_CALL FindResourceByUri(const char* resourceUri)
         return NULL;
     }
 
-    OCResource * pointer = headResource;
-    while (pointer)
+    LockResourceList();
+    OCResource *pointer = OCResourceIndexFindByUri(resourceUri);
+    UnlockResourceList();
+    if (!pointer)
     {
-        if (strcmp(resourceUri, pointer->uri) == 0)
-        {
-            return pointer;
-        }
-        pointer = pointer->next;
+        OIC_LOG_V(INFO, TAG, "Resource %s not found", resourceUri);
     }
-    OIC_LOG_V(INFO, TAG, "Resource %s not found", resourceUri);
-    return NULL;
+    return pointer;
 }
 
 OCStackResult CheckRequestsEndpoint(const OCDevAddr *reqDevAddr,
@@ -1616,6 +1615,42 @@ static bool includeThisResourceInResponse(OCResource *resource,
            resourceMatchesRTFilter(resource, resourceTypeFilter);
 }
 
+/*
+ * Narrow the resources a discovery request has to look at using the type and interface
+ * indexes. Returns false if every resource has to be considered, in which case the caller
+ * walks the resource list.
+ */
+static bool getDiscoveryCandidates(const char *interfaceFilter, const char *resourceTypeFilter,
+                                   OCResource * const **candidates, size_t *count)
+{
+    if (resourceTypeFilter && *resourceTypeFilter)
+    {
+        return OCResourceIndexFindByType(resourceTypeFilter, candidates, count);
+    }
+    // Every resource implements the baseline interface and oic.if.ll matches all of them.
+    if (!resourceTypeFilter && interfaceFilter && *interfaceFilter &&
+        0 != strcmp(interfaceFilter, OC_RSRVD_INTERFACE_LL) &&
+        0 != strcmp(interfaceFilter, OC_RSRVD_INTERFACE_DEFAULT))
+    {
+        return OCResourceIndexFindByInterface(interfaceFilter, candidates, count);
+    }
+    return false;
+}
+
+/*
+ * Advance through the candidates returned by getDiscoveryCandidates, or through the resource
+ * list if there are none.
+ */
+static OCResource *nextDiscoveryCandidate(OCResource *resource, OCResource * const *candidates,
+                                          size_t count, size_t *index)
+{
+    if (!candidates)
+    {
+        return resource->next;
+    }
+    return (++(*index) < count) ? candidates[*index] : NULL;
+}
+
 static OCStackResult SendNonPersistantDiscoveryResponse(OCServerRequest *request,
                                 OCPayload *discoveryPayload, OCEntityHandlerResult ehResult)
 {
@@ -1691,6 +1726,22 @@ static OCStackResult findResourcesAtRD(const char *interfaceQuery,
 }
 #endif
 
+/**
+ * Check whether discovery responses can be served from the discovery cache.
+ *
+ * @return false if the responses include resources the stack is not told about when they
+ * change, true otherwise.
+ */
+static bool isDiscoveryCacheable(void)
+{
+#ifdef RD_SERVER
+    // Resources published to the resource directory are added to every response.
+    return NULL == OCGetResourceHandleAtUri(OC_RSRVD_RD_URI);
+#else
+    return true;
+#endif
+}
+
 /**
  * Creates a discovery payload and add device id information. This information is included in all
  * /oic/res response.
@@ -1805,11 +1856,15 @@ static OCStackResult HandleVirtualObserveRequest(OCServerRequest *request)
     if (request->observationOption == OC_OBSERVE_REGISTER)
     {
         OIC_LOG(INFO, TAG, "Observation registration requested");
+        // Held until the observer is added, so a retransmission dispatched meanwhile
+        // cannot add it twice.
+        LockObserverLists();
         ResourceObserver *obs = GetObserverUsingToken (resourcePtr,
                                                        request->requestToken,
                                                        request->tokenLength);
         if (obs)
         {
+            UnlockObserverLists();
             OIC_LOG (INFO, TAG, "Observer with this token already present");
             OIC_LOG (INFO, TAG, "Possibly re-transmitted CON OBS request");
             OIC_LOG (INFO, TAG, "Not adding observer. Not responding to client");
@@ -1827,6 +1882,7 @@ static OCStackResult HandleVirtualObserveRequest(OCServerRequest *request)
                                   resourcePtr, request->qos, request->acceptFormat,
                                   request->acceptVersion, &request->devAddr);
         }
+        UnlockObserverLists();
         if (result == OC_STACK_OK)
         {
             OIC_LOG(INFO, TAG, "Added observer successfully");
@@ -1882,6 +1938,9 @@ static OCStackResult HandleVirtualResource (OCServerRequest *request, OCResource
     OCPayload* payload = NULL;
     char *interfaceQuery = NULL;
     char *resourceTypeQuery = NULL;
+    OCDiscoveryCacheKey cacheKey = { .uri = OC_UNKNOWN_URI };
+    bool useDiscoveryCache = false;
+    int32_t cacheGeneration = 0;
 
     OIC_LOG(INFO, TAG, "Entering HandleVirtualResource");
 
@@ -1936,16 +1995,6 @@ static OCStackResult HandleVirtualResource (OCServerRequest *request, OCResource
             goto exit;
         }
 
-        CAEndpoint_t *networkInfo = NULL;
-        size_t infoSize = 0;
-
-        CAResult_t caResult = CAGetNetworkInformation(&networkInfo, &infoSize);
-        if (CA_STATUS_FAILED == caResult)
-        {
-            OIC_LOG(ERROR, TAG, "CAGetNetworkInformation has error on parsing network infomation");
-            return OC_STACK_ERROR;
-        }
-
         discoveryResult = getQueryParamsForFiltering (virtualUriInRequest, request->query,
                 &interfaceQuery, &resourceTypeQuery);
         VERIFY_SUCCESS(discoveryResult);
@@ -1956,6 +2005,28 @@ static OCStackResult HandleVirtualResource (OCServerRequest *request, OCResource
             interfaceQuery = OICStrdup(OC_RSRVD_INTERFACE_LL);
         }
 
+        cacheKey.uri = virtualUriInRequest;
+        cacheKey.interfaceQuery = interfaceQuery;
+        cacheKey.resourceTypeQuery = resourceTypeQuery;
+        useDiscoveryCache = isDiscoveryCacheable();
+        if (useDiscoveryCache && OCDiscoveryCacheSend(request, &cacheKey))
+        {
+            discoveryResult = OC_STACK_OK;
+            goto exit;
+        }
+        cacheGeneration = OCDiscoveryCacheGetGeneration();
+
+        CAEndpoint_t *networkInfo = NULL;
+        size_t infoSize = 0;
+
+        CAResult_t caResult = CAGetNetworkInformation(&networkInfo, &infoSize);
+        if (CA_STATUS_FAILED == caResult)
+        {
+            OIC_LOG(ERROR, TAG, "CAGetNetworkInformation has error on parsing network infomation");
+            discoveryResult = OC_STACK_ERROR;
+            goto exit;
+        }
+
         discoveryResult = discoveryPayloadCreateAndAddDeviceId(&payload);
         VERIFY_PARAM_NON_NULL(TAG, payload, "Failed creating Discovery Payload.");
         VERIFY_SUCCESS(discoveryResult);
@@ -1970,7 +2041,22 @@ static OCStackResult HandleVirtualResource (OCServerRequest *request, OCResource
 #ifdef MQ_BROKER
         prop = (OC_MQ_BROKER_URI == virtualUriInRequest) ? OC_MQ_BROKER : prop;
 #endif
-        for (; resource && discoveryResult == OC_STACK_OK; resource = resource->next)
+        OCResource * const *candidates = NULL;
+        size_t candidateCount = 0;
+        size_t candidateIndex = 0;
+        LockResourceList();
+        if (getDiscoveryCandidates(interfaceQuery, resourceTypeQuery,
+                                   &candidates, &candidateCount))
+        {
+            resource = candidateCount ? candidates[0] : NULL;
+        }
+        else
+        {
+            candidates = NULL;
+        }
+        for (; resource && discoveryResult == OC_STACK_OK;
+             resource = nextDiscoveryCandidate(resource, candidates, candidateCount,
+                                               &candidateIndex))
         {
             // This case will handle when no resource type and it is oic.if.ll.
             // Do not assume check if the query is ll
@@ -2000,6 +2086,7 @@ static OCStackResult HandleVirtualResource (OCServerRequest *request, OCResource
                 discoveryResult = OC_STACK_OK;
             }
         }
+        UnlockResourceList();
         if (discPayload->resources == NULL)
         {
             discoveryResult = OC_STACK_NO_RESOURCE;
@@ -2096,7 +2183,11 @@ static OCStackResult HandleVirtualResource (OCServerRequest *request, OCResource
 #endif
     {
         OIC_LOG_PAYLOAD(DEBUG, payload);
-        if(discoveryResult == OC_STACK_OK)
+        if (discoveryResult == OC_STACK_OK && useDiscoveryCache)
+        {
+            OCDiscoveryCacheSendAndStore(request, &cacheKey, cacheGeneration, payload);
+        }
+        else if(discoveryResult == OC_STACK_OK)
         {
             SendNonPersistantDiscoveryResponse(request, payload, OC_EH_OK);
         }
@@ -2193,6 +2284,11 @@ HandleResourceWithEntityHandler(OCServerRequest *request,
     {
         type = PAYLOAD_TYPE_SECURITY;
     }
+    else if (OCIsEncodedEntityHandler(resource->entityHandler))
+    {
+        // The entity handler decodes the representation itself.
+        type = PAYLOAD_TYPE_ENCODED;
+    }
 
     result = EHRequest(&ehRequest, type, request, resource);
     VERIFY_SUCCESS(result);
@@ -2206,11 +2302,15 @@ HandleResourceWithEntityHandler(OCServerRequest *request,
     {
         OIC_LOG(INFO, TAG, "Observation registration requested");
 
+        // Held until the observer is added, so a retransmission dispatched meanwhile
+        // cannot add it twice.
+        LockObserverLists();
         ResourceObserver *obs = GetObserverUsingToken(resource,
                                                       request->requestToken, request->tokenLength);
 
         if (obs)
         {
+            UnlockObserverLists();
             OIC_LOG (INFO, TAG, "Observer with this token already present");
             OIC_LOG (INFO, TAG, "Possibly re-transmitted CON OBS request");
             OIC_LOG (INFO, TAG, "Not adding observer. Not responding to client");
@@ -2225,13 +2325,20 @@ HandleResourceWithEntityHandler(OCServerRequest *request,
         }
 
         result = GenerateObserverId(&ehRequest.obsInfo.obsId);
-        VERIFY_SUCCESS(result);
-
-        result = AddObserver ((const char*)(request->resourceUrl),
-                (const char *)(request->query),
-                ehRequest.obsInfo.obsId, request->requestToken, request->tokenLength,
-                resource, request->qos, request->acceptFormat,
-                request->acceptVersion, &request->devAddr);
+        if (OC_STACK_OK == result)
+        {
+            result = AddObserver ((const char*)(request->resourceUrl),
+                    (const char *)(request->query),
+                    ehRequest.obsInfo.obsId, request->requestToken, request->tokenLength,
+                    resource, request->qos, request->acceptFormat,
+                    request->acceptVersion, &request->devAddr);
+        }
+        else
+        {
+            UnlockObserverLists();
+            goto exit;
+        }
+        UnlockObserverLists();
 
         if(result == OC_STACK_OK)
         {
@@ -2261,11 +2368,14 @@ HandleResourceWithEntityHandler(OCServerRequest *request,
     {
         OIC_LOG(INFO, TAG, "Deregistering observation requested");
 
+        // Held from the lookup to the removal, so the observer cannot be freed in between.
+        LockObserverLists();
         resObs = GetObserverUsingToken (resource,
                                         request->requestToken, request->tokenLength);
 
         if (NULL == resObs)
         {
+            UnlockObserverLists();
             // Stack does not contain this observation request
             // Either token is incorrect or observation list is corrupted
             result = OC_STACK_ERROR;
@@ -2276,6 +2386,7 @@ HandleResourceWithEntityHandler(OCServerRequest *request,
 
         result = DeleteObserverUsingToken (resource,
                                            request->requestToken, request->tokenLength);
+        UnlockObserverLists();
 
         if(result == OC_STACK_OK)
         {
@@ -2648,6 +2759,9 @@ static OCStackResult SetAttributeInternal(OCResource *resource,
     }
     VERIFY_PARAM_NON_NULL(TAG, resAttrib->attrValue, "Failed allocating attribute value");
 
+    // Baseline discovery responses carry the attributes of /oic/res.
+    OCDiscoveryCacheInvalidate();
+
     // The resource has changed from what is stored in the database. Update the database to
     // reflect the new value.
     if (updateDatabase)
@@ -2771,15 +2885,21 @@ OCStackResult OC_CALL OCSetPropertyValue(OCPayloadType type, const char *prop, c
 
 bool IsObservationIdExisting(const OCObservationId observationId)
 {
+    bool found = false;
     OCResource *resource = NULL;
+    LockObserverLists();
+    LockResourceList();
     LL_FOREACH(headResource, resource)
     {
         if (NULL != GetObserverUsingId(resource, observationId))
         {
-            return true;
+            found = true;
+            break;
         }
     }
-    return false;
+    UnlockResourceList();
+    UnlockObserverLists();
+    return found;
 }
 
 bool GetObserverFromResourceList(OCResource **outResource, ResourceObserver **outObserver,
@@ -2787,22 +2907,40 @@ bool GetObserverFromResourceList(OCResource **outResource, ResourceObserver **ou
 {
     OCResource *resPtr = NULL;
     ResourceObserver* obsPtr = NULL;
+    LockObserverLists();
+    LockResourceList();
     LL_FOREACH(headResource, resPtr)
     {
         obsPtr = GetObserverUsingToken(resPtr, token, tokenLength);
         if (obsPtr)
         {
+            UnlockResourceList();
+            UnlockObserverLists();
             *outResource = resPtr;
             *outObserver = obsPtr;
             return true;
         }
     }
+    UnlockResourceList();
+    UnlockObserverLists();
 
     *outResource = NULL;
     *outObserver = NULL;
     return false;
 }
 
+/**
+ * Copy of the token of an observer.
+ */
+typedef struct ObserverToken
+{
+    /** token of the observe request.*/
+    char token[CA_MAX_TOKEN_LEN];
+
+    /** token length of the observe request.*/
+    uint8_t tokenLength;
+} ObserverToken;
+
 void GiveStackFeedBackObserverNotInterested(const OCDevAddr *devAddr)
 {
     if (!devAddr)
@@ -2815,20 +2953,54 @@ void GiveStackFeedBackObserverNotInterested(const OCDevAddr *devAddr)
 
     OCResource *resource = NULL;
     ResourceObserver *observer = NULL;
-    ResourceObserver *tmp = NULL;
+    size_t count = 0;
 
+    // The entity handlers are told without the observer lock, so the tokens are copied first.
+    LockObserverLists();
+    LockResourceList();
     LL_FOREACH(headResource, resource)
     {
-        LL_FOREACH_SAFE(resource->observersHead, observer, tmp)
+        LL_FOREACH(resource->observersHead, observer)
         {
             if ((strcmp(observer->devAddr.addr, devAddr->addr) == 0)
                     && observer->devAddr.port == devAddr->port)
             {
-                OCStackFeedBack(observer->token, observer->tokenLength,
-                                OC_OBSERVER_NOT_INTERESTED);
+                count++;
             }
         }
     }
+
+    ObserverToken *tokens = count ? (ObserverToken *) OICCalloc(count, sizeof(ObserverToken))
+                                  : NULL;
+    size_t i = 0;
+    LL_FOREACH(headResource, resource)
+    {
+        LL_FOREACH(resource->observersHead, observer)
+        {
+            if (tokens && (strcmp(observer->devAddr.addr, devAddr->addr) == 0)
+                    && observer->devAddr.port == devAddr->port)
+            {
+                tokens[i].tokenLength = observer->tokenLength <= CA_MAX_TOKEN_LEN ?
+                                        observer->tokenLength : CA_MAX_TOKEN_LEN;
+                memcpy(tokens[i].token, observer->token, tokens[i].tokenLength);
+                i++;
+            }
+        }
+    }
+    UnlockResourceList();
+    UnlockObserverLists();
+
+    if (count && !tokens)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to allocate observer tokens");
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        OCStackFeedBack(tokens[i].token, tokens[i].tokenLength,
+                        OC_OBSERVER_NOT_INTERESTED);
+    }
+    OICFree(tokens);
 }
 
 
@@ -0,0 +1,345 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <stdint.h>
+#include <string.h>
+#include "ocstack.h"
+#include "ocstackinternal.h"
+#include "ocresource.h"
+#include "ocresourceindex.h"
+#include "oic_malloc.h"
+#include "oic_string.h"
+#include "ochashtable.h"
+#include "experimental/logger.h"
+
+#define TAG "OIC_RI_RESOURCEINDEX"
+
+/** Number of buckets a table starts with; always a power of two.*/
+#define INDEX_INITIAL_BUCKETS (64)
+
+/**
+ * One key of an index together with the resources stored under it.
+ * Entries of the handle index only use @c handle; the other indexes key on @c key.
+ */
+typedef struct IndexEntry
+{
+    /** Link into the table; carries the hash of the key.*/
+    OCHashLink link;
+
+    /** Owned copy of the string key, or NULL for the handle index.*/
+    char *key;
+
+    /** Key of the handle index. Never dereferenced.*/
+    const OCResource *handle;
+
+    /** Resources stored under the key, in insertion order.*/
+    OCResource **resources;
+
+    /** Number of resources stored under the key.*/
+    size_t count;
+
+    /** Allocated size of @c resources.*/
+    size_t capacity;
+} IndexEntry;
+
+static OCHashTable g_handleIndex = OC_HASH_TABLE_INITIALIZER(INDEX_INITIAL_BUCKETS);
+static OCHashTable g_uriIndex = OC_HASH_TABLE_INITIALIZER(INDEX_INITIAL_BUCKETS);
+static OCHashTable g_typeIndex = OC_HASH_TABLE_INITIALIZER(INDEX_INITIAL_BUCKETS);
+static OCHashTable g_interfaceIndex = OC_HASH_TABLE_INITIALIZER(INDEX_INITIAL_BUCKETS);
+
+/**
+ * Set to false if a resource type or interface could not be recorded, in which case the
+ * filter indexes are incomplete and discovery has to walk the resource list.
+ */
+static bool g_filterIndexComplete = true;
+
+static uint32_t HashKey(const char *key, const OCResource *handle)
+{
+    return key ? OCHashString(OC_HASH_INIT, key) : OCHashPointer(handle);
+}
+
+static IndexEntry *FindEntry(const OCHashTable *table, uint32_t hash, const char *key,
+                             const OCResource *handle)
+{
+    for (OCHashLink *link = OCHashTableFirst(table, hash); link; link = OCHashTableNext(link))
+    {
+        IndexEntry *entry = OC_HASH_ENTRY(link, IndexEntry, link);
+        if (key ? (entry->key && (0 == strcmp(entry->key, key))) : (entry->handle == handle))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void FreeEntry(IndexEntry *entry)
+{
+    OICFree(entry->key);
+    OICFree(entry->resources);
+    OICFree(entry);
+}
+
+static IndexEntry *GetOrCreateEntry(OCHashTable *table, uint32_t hash, const char *key,
+                                    const OCResource *handle)
+{
+    IndexEntry *entry = FindEntry(table, hash, key, handle);
+    if (entry)
+    {
+        return entry;
+    }
+
+    entry = (IndexEntry *)OICCalloc(1, sizeof(IndexEntry));
+    if (!entry)
+    {
+        return NULL;
+    }
+    if (key)
+    {
+        entry->key = OICStrdup(key);
+        if (!entry->key)
+        {
+            OICFree(entry);
+            return NULL;
+        }
+    }
+    entry->handle = handle;
+
+    if (!OCHashTableInsert(table, &entry->link, hash))
+    {
+        FreeEntry(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+static void DeleteEntry(OCHashTable *table, IndexEntry *entry)
+{
+    OCHashTableRemove(table, &entry->link);
+    FreeEntry(entry);
+}
+
+static bool EntryAppend(IndexEntry *entry, OCResource *resource)
+{
+    if (entry->count == entry->capacity)
+    {
+        size_t newCapacity = entry->capacity ? entry->capacity * 2 : 1;
+        OCResource **resources = (OCResource **)OICRealloc(entry->resources,
+                                                           newCapacity * sizeof(OCResource *));
+        if (!resources)
+        {
+            return false;
+        }
+        entry->resources = resources;
+        entry->capacity = newCapacity;
+    }
+    entry->resources[entry->count++] = resource;
+    return true;
+}
+
+static bool TableAdd(OCHashTable *table, const char *key, OCResource *resource)
+{
+    uint32_t hash = HashKey(key, resource);
+    IndexEntry *entry = GetOrCreateEntry(table, hash, key, resource);
+    if (!entry)
+    {
+        return false;
+    }
+    if (!EntryAppend(entry, resource))
+    {
+        if (0 == entry->count)
+        {
+            DeleteEntry(table, entry);
+        }
+        return false;
+    }
+    return true;
+}
+
+static void TableRemove(OCHashTable *table, const char *key, const OCResource *resource)
+{
+    uint32_t hash = HashKey(key, resource);
+    IndexEntry *entry = FindEntry(table, hash, key, resource);
+    if (!entry)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < entry->count; ++i)
+    {
+        if (entry->resources[i] == resource)
+        {
+            // Keep the binding order, discovery responses list resources in that order.
+            memmove(&entry->resources[i], &entry->resources[i + 1],
+                    (entry->count - i - 1) * sizeof(OCResource *));
+            entry->count--;
+            break;
+        }
+    }
+
+    if (0 == entry->count)
+    {
+        DeleteEntry(table, entry);
+    }
+}
+
+static void TableClear(OCHashTable *table)
+{
+    OCHashLink *link;
+    while (NULL != (link = OCHashTablePop(table)))
+    {
+        FreeEntry(OC_HASH_ENTRY(link, IndexEntry, link));
+    }
+    OCHashTableClear(table);
+}
+
+static bool TableLookup(const OCHashTable *table, const char *key,
+                        OCResource * const **resources, size_t *count)
+{
+    static OCResource * const noResources[1] = { NULL };
+
+    if (!g_filterIndexComplete)
+    {
+        return false;
+    }
+
+    IndexEntry *entry = FindEntry(table, HashKey(key, NULL), key, NULL);
+    *resources = entry ? entry->resources : noResources;
+    *count = entry ? entry->count : 0;
+    return true;
+}
+
+OCStackResult OCResourceIndexAdd(OCResource *resource)
+{
+    if (!resource || !resource->uri)
+    {
+        return OC_STACK_INVALID_PARAM;
+    }
+
+    if (!TableAdd(&g_handleIndex, NULL, resource))
+    {
+        OIC_LOG(ERROR, TAG, "Failed to index resource handle");
+        return OC_STACK_NO_MEMORY;
+    }
+    if (!TableAdd(&g_uriIndex, resource->uri, resource))
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to index resource %s", resource->uri);
+        TableRemove(&g_handleIndex, NULL, resource);
+        return OC_STACK_NO_MEMORY;
+    }
+    return OC_STACK_OK;
+}
+
+void OCResourceIndexRemove(OCResource *resource)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    TableRemove(&g_handleIndex, NULL, resource);
+    if (resource->uri)
+    {
+        TableRemove(&g_uriIndex, resource->uri, resource);
+    }
+    for (OCResourceType *type = resource->rsrcType; type; type = type->next)
+    {
+        TableRemove(&g_typeIndex, type->resourcetypename, resource);
+    }
+    for (OCResourceInterface *iface = resource->rsrcInterface; iface; iface = iface->next)
+    {
+        TableRemove(&g_interfaceIndex, iface->name, resource);
+    }
+}
+
+void OCResourceIndexAddType(OCResource *resource, const char *typeName)
+{
+    if (!resource || !typeName)
+    {
+        return;
+    }
+    if (!TableAdd(&g_typeIndex, typeName, resource))
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to index type %s, filtering falls back to a scan",
+                  typeName);
+        g_filterIndexComplete = false;
+    }
+}
+
+void OCResourceIndexAddInterface(OCResource *resource, const char *interfaceName)
+{
+    if (!resource || !interfaceName)
+    {
+        return;
+    }
+    if (!TableAdd(&g_interfaceIndex, interfaceName, resource))
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to index interface %s, filtering falls back to a scan",
+                  interfaceName);
+        g_filterIndexComplete = false;
+    }
+}
+
+bool OCResourceIndexContains(const OCResource *resource)
+{
+    if (!resource)
+    {
+        return false;
+    }
+    return NULL != FindEntry(&g_handleIndex, HashKey(NULL, resource), NULL, resource);
+}
+
+OCResource *OCResourceIndexFindByUri(const char *uri)
+{
+    if (!uri)
+    {
+        return NULL;
+    }
+    IndexEntry *entry = FindEntry(&g_uriIndex, HashKey(uri, NULL), uri, NULL);
+    return (entry && entry->count) ? entry->resources[0] : NULL;
+}
+
+bool OCResourceIndexFindByType(const char *typeName, OCResource * const **resources,
+                               size_t *count)
+{
+    if (!typeName || !resources || !count)
+    {
+        return false;
+    }
+    return TableLookup(&g_typeIndex, typeName, resources, count);
+}
+
+bool OCResourceIndexFindByInterface(const char *interfaceName,
+                                    OCResource * const **resources, size_t *count)
+{
+    if (!interfaceName || !resources || !count)
+    {
+        return false;
+    }
+    return TableLookup(&g_interfaceIndex, interfaceName, resources, count);
+}
+
+void OCResourceIndexClear(void)
+{
+    TableClear(&g_handleIndex);
+    TableClear(&g_uriIndex);
+    TableClear(&g_typeIndex);
+    TableClear(&g_interfaceIndex);
+    g_filterIndexComplete = true;
+}
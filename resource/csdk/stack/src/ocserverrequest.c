@@ -18,6 +18,7 @@
  *
  ******************************************************************/
 
+#include <assert.h>
 #include <string.h>
 
 #include "ocstack.h"
@@ -29,6 +30,7 @@
 #include "ocpayload.h"
 #include "ocpayloadcbor.h"
 #include "experimental/logger.h"
+#include "octhread.h"
 
 #if defined (ROUTING_GATEWAY) || defined (ROUTING_EP)
 #include "routingutility.h"
@@ -73,6 +75,12 @@ RB_HEAD(ServerResponseTree, OCServerResponse) g_serverResponseTree =
                                                             RB_INITIALIZER(&g_serverResponseTree);
 RB_GENERATE(ServerResponseTree, OCServerResponse, entry, RBResponseTokenCmp)
 
+/**
+ * Guards both trees, which request dispatch threads and the application thread that sends
+ * notifications and slow responses modify concurrently.
+ */
+static oc_mutex g_serverRequestLock = NULL;
+
 //-------------------------------------------------------------------------------------------------
 // Local functions
 //-------------------------------------------------------------------------------------------------
@@ -100,7 +108,9 @@ static OCStackResult AddServerResponse (OCServerResponse ** response, OCRequestH
 
     *response = serverResponse;
 
+    oc_mutex_lock(g_serverRequestLock);
     RB_INSERT(ServerResponseTree, &g_serverResponseTree, serverResponse);
+    oc_mutex_unlock(g_serverRequestLock);
     OIC_LOG(INFO, TAG, "Server Response Added");
     return OC_STACK_OK;
 
@@ -128,7 +138,9 @@ static OCServerResponse * GetServerResponseUsingHandle (const OCServerRequest *
     OCServerResponse tmpFind, *out = NULL;
 
     tmpFind.requestHandle = (OCRequestHandle)handle;
+    oc_mutex_lock(g_serverRequestLock);
     out = RB_FIND(ServerResponseTree, &g_serverResponseTree, &tmpFind);
+    oc_mutex_unlock(g_serverRequestLock);
 
     if (!out)
     {
@@ -149,7 +161,9 @@ static void DeleteServerResponse (OCServerResponse * serverResponse)
 {
     if (serverResponse)
     {
+        oc_mutex_lock(g_serverRequestLock);
         RB_REMOVE(ServerResponseTree, &g_serverResponseTree, serverResponse);
+        oc_mutex_unlock(g_serverRequestLock);
         OICFree(serverResponse);
         serverResponse = NULL;
         OIC_LOG(INFO, TAG, "Server Response Removed!!");
@@ -173,6 +187,12 @@ static OCStackResult OCSendResponse (const CAEndpoint_t *object, CAResponseInfo_
     if(OC_STACK_OK != rmResult)
     {
         OIC_LOG(ERROR, TAG, "Add option failed");
+        if (responseInfo->info.payloadRelease)
+        {
+            // CA did not get to own the producer context.
+            responseInfo->info.payloadRelease(responseInfo->info.payloadProducerContext);
+            responseInfo->info.payloadRelease = NULL;
+        }
         return rmResult;
     }
 #endif
@@ -188,6 +208,26 @@ static OCStackResult OCSendResponse (const CAEndpoint_t *object, CAResponseInfo_
     return OC_STACK_OK;
 }
 
+/**
+ * Check whether a response is sent with a single OCSendResponse() call, so that the producer
+ * of its payload can be handed over to CA.
+ *
+ * @param[in]  endpoint         CA remote endpoint of the response.
+ *
+ * @return true if the response is sent once.
+ */
+static bool IsSingleSend(const CAEndpoint_t *endpoint)
+{
+#ifdef WITH_PRESENCE
+    // The response is sent once for every adapter, see HandleSingleResponse().
+    CATransportAdapter_t adapter = endpoint->adapter;
+    return (CA_DEFAULT_ADAPTER != adapter) && !(adapter & (adapter - 1));
+#else
+    OC_UNUSED(endpoint);
+    return true;
+#endif
+}
+
 static CAPayloadFormat_t OCToCAPayloadFormat (OCPayloadFormat ocFormat)
 {
     switch (ocFormat)
@@ -277,6 +317,27 @@ static CAResponseResult_t ConvertEHResultToCAResult (OCEntityHandlerResult resul
 //-------------------------------------------------------------------------------------------------
 // Internal APIs
 //-------------------------------------------------------------------------------------------------
+OCStackResult InitializeServerRequestList()
+{
+    assert(g_serverRequestLock == NULL);
+
+    g_serverRequestLock = oc_mutex_new();
+    if (g_serverRequestLock == NULL)
+    {
+        return OC_STACK_ERROR;
+    }
+    return OC_STACK_OK;
+}
+
+void TerminateServerRequestList()
+{
+    if (g_serverRequestLock != NULL)
+    {
+        oc_mutex_free(g_serverRequestLock);
+        g_serverRequestLock = NULL;
+    }
+}
+
 OCStackResult AddServerRequest (OCServerRequest ** request,
                                 uint16_t coapMessageID,
                                 uint8_t delayedResNeeded,
@@ -363,7 +424,9 @@ OCStackResult AddServerRequest (OCServerRequest ** request,
 
     *request = serverRequest;
 
+    oc_mutex_lock(g_serverRequestLock);
     RBL_INSERT(ServerRequestTree, &g_serverRequestTree, serverRequest);
+    oc_mutex_unlock(g_serverRequestLock);
     OIC_LOG(INFO, TAG, "Server Request Added");
     return OC_STACK_OK;
 
@@ -392,7 +455,9 @@ OCServerRequest * GetServerRequestUsingToken (const CAToken_t token, uint8_t tok
 
     tmpFind.requestToken = token;
     tmpFind.tokenLength = tokenLength;
+    oc_mutex_lock(g_serverRequestLock);
     out = RB_FIND(ServerRequestTree, &g_serverRequestTree, &tmpFind);
+    oc_mutex_unlock(g_serverRequestLock);
 
     if (!out)
     {
@@ -408,7 +473,9 @@ void DeleteServerRequest(OCServerRequest * serverRequest)
 {
     if (serverRequest)
     {
+        oc_mutex_lock(g_serverRequestLock);
         RBL_REMOVE(ServerRequestTree, &g_serverRequestTree, serverRequest);
+        oc_mutex_unlock(g_serverRequestLock);
         OICFree(serverRequest->requestToken);
         OICFree(serverRequest);
         serverRequest = NULL;
@@ -416,6 +483,40 @@ void DeleteServerRequest(OCServerRequest * serverRequest)
     }
 }
 
+void DetachNotificationCache(const OCNotificationCache *cache)
+{
+    if (!cache)
+    {
+        return;
+    }
+
+    OCServerRequest *node = NULL;
+    oc_mutex_lock(g_serverRequestLock);
+    RB_FOREACH(node, ServerRequestTree, &g_serverRequestTree)
+    {
+        // Requests sharing a token are chained off the tree node.
+        for (OCServerRequest *link = node; link; link = link->entry.next)
+        {
+            if (link->notificationCache == cache)
+            {
+                link->notificationCache = NULL;
+            }
+        }
+    }
+    oc_mutex_unlock(g_serverRequestLock);
+}
+
+void ClearNotificationCache(OCNotificationCache *cache)
+{
+    if (cache)
+    {
+        OICFree(cache->payload);
+        cache->payload = NULL;
+        cache->payloadSize = 0;
+        cache->valid = false;
+    }
+}
+
 OCStackResult FormOCEntityHandlerRequest(OCEntityHandlerRequest * entityHandlerRequest,
                                          OCRequestHandle request,
                                          OCMethod method,
@@ -487,6 +588,8 @@ OCStackResult HandleSingleResponse(OCEntityHandlerResponse * ehResponse)
     }
 
     OCServerRequest *serverRequest = (OCServerRequest *)ehResponse->requestHandle;
+    OCNotificationCache *notificationCache = serverRequest->notificationCache;
+    bool payloadOwnedByCache = false;
 
     CopyDevAddrToEndpoint(&serverRequest->devAddr, &responseEndpoint);
 
@@ -731,13 +834,51 @@ OCStackResult HandleSingleResponse(OCEntityHandlerResponse * ehResponse)
                 // No preference set by the client, so default to CBOR then
             case OC_FORMAT_CBOR:
             case OC_FORMAT_VND_OCF_CBOR:
-                if((result = OCConvertPayload(ehResponse->payload, serverRequest->acceptFormat,
-                                &responseInfo.info.payload, &responseInfo.info.payloadSize))
-                        != OC_STACK_OK)
+                if (notificationCache && notificationCache->valid)
+                {
+                    // Another observer of this fan-out already paid for the encoding.
+                    responseInfo.info.payload = notificationCache->payload;
+                    responseInfo.info.payloadSize = notificationCache->payloadSize;
+                    payloadOwnedByCache = true;
+                }
+                else if (!notificationCache &&
+                         PAYLOAD_TYPE_ENCODED == ehResponse->payload->type &&
+                         ((OCEncodedPayload *)ehResponse->payload)->producer &&
+                         IsSingleSend(&responseEndpoint))
+                {
+                    // CA produces the payload block by block as it sends it, and releases
+                    // the producer context once it is done with it.
+                    OCEncodedPayload *encoded = (OCEncodedPayload *)ehResponse->payload;
+                    responseInfo.info.payloadProducer = encoded->producer;
+                    responseInfo.info.payloadProducerContext = encoded->producerContext;
+                    responseInfo.info.payloadRelease = encoded->release;
+                    responseInfo.info.payloadSize = encoded->cborPayload.len;
+                    encoded->release = NULL;
+                }
+                else
                 {
-                    OIC_LOG(ERROR, TAG, "Error converting payload");
-                    OICFree(responseInfo.info.options);
-                    return result;
+                    if((result = OCConvertPayload(ehResponse->payload, serverRequest->acceptFormat,
+                                    &responseInfo.info.payload, &responseInfo.info.payloadSize))
+                            != OC_STACK_OK)
+                    {
+                        OIC_LOG(ERROR, TAG, "Error converting payload");
+                        OICFree(responseInfo.info.options);
+                        return result;
+                    }
+                    if (notificationCache)
+                    {
+                        notificationCache->valid = true;
+                        notificationCache->ehResult = ehResponse->ehResult;
+                        notificationCache->payloadType = ehResponse->payload->type;
+                        notificationCache->numSendVendorSpecificHeaderOptions =
+                                ehResponse->numSendVendorSpecificHeaderOptions;
+                        memcpy(notificationCache->sendVendorSpecificHeaderOptions,
+                               ehResponse->sendVendorSpecificHeaderOptions,
+                               sizeof(notificationCache->sendVendorSpecificHeaderOptions));
+                        notificationCache->payload = responseInfo.info.payload;
+                        notificationCache->payloadSize = responseInfo.info.payloadSize;
+                        payloadOwnedByCache = true;
+                    }
                 }
                 // Add CONTENT_FORMAT OPT if payload exist
                 if (ehResponse->payload->type != PAYLOAD_TYPE_DIAGNOSTIC &&
@@ -825,7 +966,10 @@ OCStackResult HandleSingleResponse(OCEntityHandlerResponse * ehResponse)
     result = OCSendResponse(&responseEndpoint, &responseInfo);
 #endif
 
-    OICFree(responseInfo.info.payload);
+    if (!payloadOwnedByCache)
+    {
+        OICFree(responseInfo.info.payload);
+    }
     OICFree(responseInfo.info.options);
     //Delete the request
     DeleteServerRequest(serverRequest);
@@ -861,14 +1005,30 @@ OCStackResult HandleAggregateResponse(OCEntityHandlerResponse * ehResponse)
             VERIFY_NON_NULL(serverResponse);
         }
 
-        if(ehResponse->payload->type != PAYLOAD_TYPE_REPRESENTATION)
+        OCPayload *repPayload = ehResponse->payload;
+        OCRepPayload *parsedPayload = NULL;
+        if (repPayload->type == PAYLOAD_TYPE_ENCODED)
+        {
+            // The fragments are merged as OCRepPayloads, so parse an encoded response here.
+            if (OC_STACK_OK != OCEncodedPayloadParse((OCEncodedPayload *)repPayload,
+                                                     &parsedPayload) || !parsedPayload)
+            {
+                stackRet = OC_STACK_ERROR;
+                OIC_LOG(ERROR, TAG, "Error parsing encoded payload");
+                goto exit;
+            }
+            repPayload = (OCPayload *)parsedPayload;
+        }
+
+        if(repPayload->type != PAYLOAD_TYPE_REPRESENTATION)
         {
             stackRet = OC_STACK_ERROR;
             OIC_LOG(ERROR, TAG, "Error adding payload, as it was the incorrect type");
             goto exit;
         }
 
-        OCRepPayload *newPayload = OCRepPayloadBatchClone((OCRepPayload *)ehResponse->payload);
+        OCRepPayload *newPayload = OCRepPayloadBatchClone((OCRepPayload *)repPayload);
+        OCRepPayloadDestroy(parsedPayload);
 
         if(!serverResponse->payload)
         {
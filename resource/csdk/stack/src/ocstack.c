@@ -56,6 +56,8 @@
 #include "experimental/logger.h"
 #include "trace.h"
 #include "ocserverrequest.h"
+#include "ocresourceindex.h"
+#include "ocdiscoverycache.h"
 #include "secureresourcemanager.h"
 #include "psinterface.h"
 #include "experimental/doxmresource.h"
@@ -69,6 +71,7 @@
 #include "oicgroup.h"
 #include "ocendpoint.h"
 #include "ocatomic.h"
+#include "octhread.h"
 #include "platform_features.h"
 #include "oic_platform.h"
 
@@ -136,6 +139,11 @@ static OCStackState stackState = OC_STACK_UNINITIALIZED;
 
 OCResource *headResource = NULL;
 static OCResource *tailResource = NULL;
+/**
+ * Guards headResource, tailResource and the resource index. Resources are only unlinked
+ * while the observer list lock is held as well, so either lock keeps the list walkable.
+ */
+static oc_mutex g_resourceListLock = NULL;
 static OCResourceHandle platformResource = {0};
 static OCResourceHandle deviceResource = {0};
 static OCResourceHandle introspectionResource = {0};
@@ -159,6 +167,44 @@ static bool gRASetInfo = false;
 #endif
 OCDeviceEntityHandler defaultDeviceHandler;
 void* defaultDeviceHandlerCallbackParameter = NULL;
+// Handlers that take representations as OCEncodedPayload, see OCRegisterEncodedResponseHandler
+// and OCRegisterEncodedEntityHandler.  A language binding registers a handful of these.  The
+// used entries come first.
+#define MAX_ENCODED_HANDLERS (8)
+static OCClientResponseHandler g_encodedResponseHandlers[MAX_ENCODED_HANDLERS] = {0};
+static OCEntityHandler g_encodedEntityHandlers[MAX_ENCODED_HANDLERS] = {0};
+// Block data handlers of response and entity handlers, see OCRegisterBlockResponseHandler and
+// OCRegisterBlockEntityHandler.  The used entries come first.
+typedef struct
+{
+    OCClientResponseHandler responseHandler;
+    OCBlockDataHandler blockHandler;
+} BlockResponseHandler;
+typedef struct
+{
+    OCEntityHandler entityHandler;
+    OCBlockDataHandler blockHandler;
+} BlockEntityHandler;
+static BlockResponseHandler g_blockResponseHandlers[MAX_ENCODED_HANDLERS] = {{0}};
+static BlockEntityHandler g_blockEntityHandlers[MAX_ENCODED_HANDLERS] = {{0}};
+/**
+ * Guards the handler tables.  Handlers may be registered before OCInit(), so this is a
+ * spin lock that needs no initialization instead of an oc_mutex.
+ */
+static volatile int32_t g_handlerTablesLock = 0;
+// Requests whose responses are offered to a block data handler, keyed by token.  CA offers
+// the blocks on its receive thread, where the client callback list can not be used.
+typedef struct BlockStream
+{
+    CAToken_t token;
+    uint8_t tokenLength;
+    OCDoHandle handle;
+    OCBlockDataHandler blockHandler;
+    void *context;
+    struct BlockStream *next;
+} BlockStream;
+static BlockStream *g_blockStreams = NULL;
+static oc_mutex g_blockStreamLock = NULL;
 static const char COAP_TCP_SCHEME[] = "coap+tcp:";
 static const char COAPS_TCP_SCHEME[] = "coaps+tcp:";
 static const char CORESPEC[] = "core";
@@ -312,6 +358,19 @@ static OCStackResult deleteResource(OCResource *resource);
  */
 static void deleteAllResources();
 
+/**
+ * Create the locks that let request dispatch threads share the resource list, the observer
+ * lists and the server request list with the application.
+ *
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+static OCStackResult InitializeStackLists();
+
+/**
+ * Free the locks created by InitializeStackLists().
+ */
+static void TerminateStackLists();
+
 /**
  * Increment resource sequence number.  Handles rollover.
  *
@@ -381,6 +440,31 @@ static void HandleCAResponses(const CAEndpoint_t* endPoint,
 static void HandleCARequests(const CAEndpoint_t* endPoint,
         const CARequestInfo_t* requestInfo);
 
+/**
+ * This function will be called back by CA layer with the blocks of block-wise transfers.
+ *
+ * @param endPoint CA remote endpoint.
+ * @param requestInfo CA request info, NULL for a response.
+ * @param responseInfo CA response info, NULL for a request.
+ * @param offset Offset of the block in the payload.
+ * @param data Payload of the block.
+ * @param length Length of the block.
+ * @param totalLength Length of the payload if known, 0 otherwise.
+ * @return true if a block data handler takes the transfer.
+ */
+static bool HandleCABlockData(const CAEndpoint_t *endPoint, const CARequestInfo_t *requestInfo,
+        const CAResponseInfo_t *responseInfo, size_t offset, const uint8_t *data,
+        size_t length, size_t totalLength);
+
+/**
+ * Offer the blocks of the responses to a request to the block data handler of its
+ * response handler, if it has one.
+ *
+ * @param clientCB Client callback of the request.
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+static OCStackResult AddBlockStream(const ClientCB *clientCB);
+
 /**
  * Extract query from a URI.
  *
@@ -484,6 +568,12 @@ static OCStackResult OCInitializeInternal(OCMode mode, OCTransportFlags serverFl
  */
 static OCStackResult OCDeInitializeInternal();
 
+/**
+ * Remove the registrations of encoded and block data handlers, they last until the stack
+ * is stopped.
+ */
+static void ClearHandlerTables();
+
 //-----------------------------------------------------------------------------
 // Internal functions
 //-----------------------------------------------------------------------------
@@ -528,6 +618,25 @@ static void OCLeaveInitializer()
     OC_VERIFY(oc_atomic_decrement(&g_ocStackStartStopThreadCount) >= 0);
 }
 
+static void LockHandlerTables()
+{
+    while (!oc_atomic_cmpxchg(&g_handlerTablesLock, 0, 1))
+    {
+#if !defined(ARDUINO)
+        // Yield execution to the thread that is holding the lock.
+        sleep(0);
+#else // ARDUINO
+        assert(!"Not expecting the handler tables to be locked on Arduino");
+        break;
+#endif // ARDUINO
+    }
+}
+
+static void UnlockHandlerTables()
+{
+    OC_VERIFY(oc_atomic_cmpxchg(&g_handlerTablesLock, 1, 0));
+}
+
 bool checkProxyUri(OCHeaderOption *options, uint8_t numOptions)
 {
     if (!options || 0 == numOptions)
@@ -690,12 +799,23 @@ static OCStackResult OCSendRequest(const CAEndpoint_t *object, CARequestInfo_t *
 // Internal API function
 //-----------------------------------------------------------------------------
 
-// This internal function is called to update the stack with the status of
-// observers and communication failures
-OCStackResult OCStackFeedBack(CAToken_t token, uint8_t tokenLength, uint8_t status)
+/**
+ * Update the observer of a token with the status of its notifications. Called with the
+ * observer lists locked.
+ *
+ * @param token Token of the observer.
+ * @param tokenLength Length of the token.
+ * @param status Status of the observer.
+ * @param deregistered Retained resource of an observer that was deregistered, whose entity
+ *                     handler has to be told once the observer lists are unlocked.
+ * @param devAddr Address of the deregistered observer.
+ * @param observeId Observation ID of the deregistered observer.
+ * @return ::OC_STACK_OK on success, some other value upon failure.
+ */
+static OCStackResult HandleStackFeedBack(CAToken_t token, uint8_t tokenLength, uint8_t status,
+                                         OCResource **deregistered, OCDevAddr *devAddr,
+                                         OCObservationId *observeId)
 {
-    OCStackResult result = OC_STACK_ERROR;
-    OCEntityHandlerRequest ehRequest = {0};
     OCResource *resource = NULL;
     ResourceObserver *observer = NULL;
 
@@ -711,81 +831,78 @@ OCStackResult OCStackFeedBack(CAToken_t token, uint8_t tokenLength, uint8_t stat
     {
     case OC_OBSERVER_NOT_INTERESTED:
         OIC_LOG(DEBUG, TAG, "observer not interested in our notifications");
-        result = FormOCEntityHandlerRequest(&ehRequest,
-                                            (OCRequestHandle)NULL,
-                                            OC_REST_NOMETHOD,
-                                            &observer->devAddr,
-                                            (OCResourceHandle)NULL,
-                                            NULL,
-                                            PAYLOAD_TYPE_REPRESENTATION, OC_FORMAT_CBOR,
-                                            NULL, 0, 0, NULL,
-                                            OC_OBSERVE_DEREGISTER,
-                                            observer->observeId,
-                                            0);
-        if (result != OC_STACK_OK)
-        {
-            return result;
-        }
-
-        if (resource->entityHandler)
-        {
-            resource->entityHandler(OC_OBSERVE_FLAG, &ehRequest,
-                                    resource->entityHandlerCallbackParam);
-        }
-
-        DeleteObserverUsingToken(resource, token, tokenLength);
         break;
 
     case OC_OBSERVER_STILL_INTERESTED:
         OIC_LOG(DEBUG, TAG, "observer still interested, reset the failedCount");
         observer->forceHighQos = 0;
         observer->failedCommCount = 0;
-        result = OC_STACK_OK;
-        break;
+        return OC_STACK_OK;
 
     case OC_OBSERVER_FAILED_COMM:
         OIC_LOG(DEBUG, TAG, "observer is unreachable");
-        if (MAX_OBSERVER_FAILED_COMM <= observer->failedCommCount)
-        {
-            result = FormOCEntityHandlerRequest(&ehRequest,
-                                                (OCRequestHandle)NULL,
-                                                OC_REST_NOMETHOD,
-                                                &observer->devAddr,
-                                                (OCResourceHandle)NULL,
-                                                NULL,
-                                                PAYLOAD_TYPE_REPRESENTATION, OC_FORMAT_CBOR,
-                                                NULL, 0, 0, NULL,
-                                                OC_OBSERVE_DEREGISTER,
-                                                observer->observeId,
-                                                0);
-            if (result != OC_STACK_OK)
-            {
-                return OC_STACK_ERROR;
-            }
-
-            if (resource->entityHandler)
-            {
-                resource->entityHandler(OC_OBSERVE_FLAG, &ehRequest,
-                                        resource->entityHandlerCallbackParam);
-            }
-
-            DeleteObserverUsingToken(resource, token, tokenLength);
-        }
-        else
+        if (MAX_OBSERVER_FAILED_COMM > observer->failedCommCount)
         {
             observer->failedCommCount++;
             observer->forceHighQos = 1;
             OIC_LOG_V(DEBUG, TAG, "Failure counter for this observer is %d",
                       observer->failedCommCount);
-            result = OC_STACK_CONTINUE;
+            return OC_STACK_CONTINUE;
         }
         break;
 
     default:
         OIC_LOG(ERROR, TAG, "Unknown status");
-        result = OC_STACK_ERROR;
-        break;
+        return OC_STACK_ERROR;
+    }
+
+    // The observer is deregistered here and the entity handler told once the lock is released.
+    *devAddr = observer->devAddr;
+    *observeId = observer->observeId;
+    DeleteObserverUsingToken(resource, token, tokenLength);
+    LockResourceList();
+    RetainResource(resource);
+    UnlockResourceList();
+    *deregistered = resource;
+    return OC_STACK_OK;
+}
+
+// This internal function is called to update the stack with the status of
+// observers and communication failures
+OCStackResult OCStackFeedBack(CAToken_t token, uint8_t tokenLength, uint8_t status)
+{
+    OCResource *resource = NULL;
+    OCDevAddr devAddr = {0};
+    OCObservationId observeId = 0;
+
+    // The observer must not be deleted by a request dispatch thread while it is in use.
+    LockObserverLists();
+    OCStackResult result = HandleStackFeedBack(token, tokenLength, status,
+                                               &resource, &devAddr, &observeId);
+    UnlockObserverLists();
+    if (!resource)
+    {
+        return result;
     }
+
+    OCEntityHandlerRequest ehRequest = {0};
+    result = FormOCEntityHandlerRequest(&ehRequest,
+                                        (OCRequestHandle)NULL,
+                                        OC_REST_NOMETHOD,
+                                        &devAddr,
+                                        (OCResourceHandle)NULL,
+                                        NULL,
+                                        PAYLOAD_TYPE_REPRESENTATION, OC_FORMAT_CBOR,
+                                        NULL, 0, 0, NULL,
+                                        OC_OBSERVE_DEREGISTER,
+                                        observeId,
+                                        0);
+    if (result == OC_STACK_OK && resource->entityHandler)
+    {
+        resource->entityHandler(OC_OBSERVE_FLAG, &ehRequest,
+                                resource->entityHandlerCallbackParam);
+    }
+    ReleaseResource(resource);
     return result;
 }
 
@@ -1831,9 +1948,20 @@ void OC_CALL OCHandleResponse(const CAEndpoint_t* endPoint, const CAResponseInfo
                 if (OCResultToSuccess(response->result) || PAYLOAD_TYPE_REPRESENTATION == type ||
                         PAYLOAD_TYPE_DIAGNOSTIC == type)
                 {
+                    // Hand the CBOR over as it is to handlers that decode it themselves.
+                    // Batch responses are still parsed, they are rewritten below.
+                    OCPayloadType parseType = type;
+                    if (PAYLOAD_TYPE_REPRESENTATION == type &&
+                        OCIsEncodedResponseHandler(cbNode->callBack) &&
+                        !(cbNode->requestUri &&
+                          strstr(cbNode->requestUri, OC_RSRVD_INTERFACE_BATCH)))
+                    {
+                        parseType = PAYLOAD_TYPE_ENCODED;
+                    }
+
                     if (OC_STACK_OK != OCParsePayload(&response->payload,
                             CAToOCPayloadFormat(responseInfo->info.payloadFormat),
-                            type,
+                            parseType,
                             responseInfo->info.payload,
                             responseInfo->info.payloadSize))
                     {
@@ -1967,8 +2095,8 @@ void OC_CALL OCHandleResponse(const CAEndpoint_t* endPoint, const CAResponseInfo
                 else
                 {
                     // To keep discovery callbacks active.
-                    cbNode->TTL = GetTicks(MAX_CB_TIMEOUT_SECONDS *
-                                            MILLISECONDS_PER_SECOND);
+                    SetClientCBTimeout(cbNode, GetTicks(MAX_CB_TIMEOUT_SECONDS *
+                                                        MILLISECONDS_PER_SECOND));
                 }
             }
 
@@ -2322,10 +2450,19 @@ OCStackResult HandleStackRequests(OCServerProtocolRequest * protocolRequest)
         OIC_LOG(INFO, TAG, "This Server Request is complete");
         ResourceHandling resHandling = OC_RESOURCE_VIRTUAL;
         OCResource *resource = NULL;
+        // Requests may be dispatched on several threads, so the resource is retained until
+        // the request is processed in case another thread deletes it meanwhile.
+        LockResourceList();
         result = DetermineResourceHandling (request, &resHandling, &resource);
         if (result == OC_STACK_OK)
+        {
+            RetainResource(resource);
+        }
+        UnlockResourceList();
+        if (result == OC_STACK_OK)
         {
             result = ProcessRequest(resHandling, resource, request);
+            ReleaseResource(resource);
         }
     }
     else
@@ -2755,6 +2892,9 @@ OCStackResult OCInitializeInternal(OCMode mode, OCTransportFlags serverFlags,
     result = InitializeScheduleResourceList();
     VERIFY_SUCCESS(result, OC_STACK_OK);
 
+    result = InitializeStackLists();
+    VERIFY_SUCCESS(result, OC_STACK_OK);
+
     result = CAResultToOCResult(CAInitialize((CATransportAdapter_t)transportType));
     VERIFY_SUCCESS(result, OC_STACK_OK);
 
@@ -2789,6 +2929,16 @@ OCStackResult OCInitializeInternal(OCMode mode, OCTransportFlags serverFlags,
     }
     VERIFY_SUCCESS(result, OC_STACK_OK);
 
+    {
+        // Block data handlers only get blocks if CA is built with block-wise transfer.
+        CAResult_t caResult = CARegisterBlockDataHandler(HandleCABlockData);
+        if (CA_NOT_SUPPORTED != caResult)
+        {
+            result = CAResultToOCResult(caResult);
+        }
+    }
+    VERIFY_SUCCESS(result, OC_STACK_OK);
+
 #ifdef TCP_ADAPTER
     CARegisterKeepAliveHandler(HandleKeepAliveConnCB);
 #endif
@@ -2838,6 +2988,7 @@ exit:
         TerminateScheduleResourceList();
         deleteAllResources();
         CATerminate();
+        TerminateStackLists();
         stackState = OC_STACK_UNINITIALIZED;
     }
     return result;
@@ -2910,6 +3061,10 @@ OCStackResult OCDeInitializeInternal()
     DeleteClientCBList();
     // Terminate connectivity-abstraction layer.
     CATerminate();
+    // Request dispatch threads have stopped with CA, so the lists need no more locking.
+    TerminateStackLists();
+    // Handlers registered for this run of the stack are forgotten.
+    ClearHandlerTables();
 
 #if defined(TCP_ADAPTER) && defined(WITH_CLOUD)
     // Terminate the Connection Manager
@@ -3607,6 +3762,12 @@ OCStackResult OC_CALL OCDoRequest(OCDoHandle *handle,
     resourceUri = NULL;   // Client CB list entry now owns it
     resourceType = NULL;  // Client CB list entry now owns it
 
+    result = AddBlockStream(clientCB);
+    if (OC_STACK_OK != result)
+    {
+        goto exit;
+    }
+
 #ifdef WITH_PRESENCE
     if (method == OC_REST_PRESENCE)
     {
@@ -3845,6 +4006,16 @@ OCStackResult OC_CALL OCRegisterPersistentStorageHandler(OCPersistentStorage* pe
     return OC_STACK_OK;
 }
 
+OCStackResult OC_CALL OCSetPersistentStorageJournal(bool enabled, uint32_t coalesceMs)
+{
+    if (stackState != OC_STACK_UNINITIALIZED)
+    {
+        OIC_LOG(ERROR, TAG, "The persistent storage journal must be set before OCInit");
+        return OC_STACK_ERROR;
+    }
+    return SetPSJournal(enabled, coalesceMs);
+}
+
 OCPersistentStorage *OC_CALL OCGetPersistentStorageHandler()
 {
     return g_PersistentStorageHandler;
@@ -3960,6 +4131,12 @@ OCStackResult OC_CALL OCProcess()
 #endif
     CAHandleRequestResponse();
 
+    // Queued while the observer lock was held, sent without it.
+    SendTimedOutObserverNotifications();
+
+    // Expire after handling input, so a response that is already queued still gets through.
+    DeleteTimedOutClientCBs();
+
 #ifdef ROUTING_GATEWAY
     RMProcess();
 #endif
@@ -3967,9 +4144,136 @@ OCStackResult OC_CALL OCProcess()
 #ifdef TCP_ADAPTER
     ProcessKeepAlive();
 #endif
+
+    FlushPendingPSUpdates(false);
     return OC_STACK_OK;
 }
 
+/**
+ * Milliseconds from now until a deadline in coap ticks; 0 once it has passed.
+ */
+static uint32_t TicksToTimeout(uint32_t now, uint32_t deadline)
+{
+    if (deadline <= now)
+    {
+        return 0;
+    }
+    uint64_t ms = ((uint64_t)(deadline - now) * MILLISECONDS_PER_SECOND + COAP_TICKS_PER_SECOND - 1)
+                  / COAP_TICKS_PER_SECOND;
+    return (ms < UINT32_MAX) ? (uint32_t)ms : UINT32_MAX - 1;
+}
+
+#ifdef WITH_PRESENCE
+/**
+ * Earliest point, in coap ticks, at which OCProcessPresence() has a presence callback to
+ * time out or a server to poll.
+ */
+static bool GetEarliestPresenceTimeout(uint32_t *deadline)
+{
+    bool found = false;
+    ClientCB *cbNode = NULL;
+
+    LL_FOREACH(g_cbList, cbNode)
+    {
+        if (OC_REST_PRESENCE != cbNode->method || !cbNode->presence ||
+            cbNode->presence->TTLlevel > PresenceTimeOutSize)
+        {
+            continue;
+        }
+
+        // At the last level the timeout is reported to the application right away.
+        uint32_t next = (cbNode->presence->TTLlevel < PresenceTimeOutSize) ?
+                        cbNode->presence->timeOut[cbNode->presence->TTLlevel] : 0;
+        if (!found || next < *deadline)
+        {
+            *deadline = next;
+            found = true;
+        }
+    }
+    return found;
+}
+#endif // WITH_PRESENCE
+
+uint32_t OC_CALL OCGetProcessTimeout()
+{
+    if (stackState != OC_STACK_INITIALIZED)
+    {
+        return 0;
+    }
+
+    uint32_t timeout = UINT32_MAX;
+    uint32_t now = GetTicks(0);
+    uint32_t deadline = 0;
+
+    // Timed out callbacks are deleted once their TTL is strictly in the past.
+    if (GetEarliestClientCBTTL(&deadline))
+    {
+        timeout = TicksToTimeout(now, (UINT32_MAX == deadline) ? deadline : deadline + 1);
+    }
+#ifdef WITH_PRESENCE
+    if (GetEarliestPresenceTimeout(&deadline))
+    {
+        uint32_t presenceTimeout = TicksToTimeout(now, deadline);
+        timeout = (presenceTimeout < timeout) ? presenceTimeout : timeout;
+    }
+#endif
+#ifdef ROUTING_GATEWAY
+    // The routing manager keeps its own timers; look at them at least once a second.
+    timeout = (MILLISECONDS_PER_SECOND < timeout) ? MILLISECONDS_PER_SECOND : timeout;
+#endif
+#ifdef TCP_ADAPTER
+    uint32_t keepAliveTimeout = GetKeepAliveTimeout();
+    timeout = (keepAliveTimeout < timeout) ? keepAliveTimeout : timeout;
+#endif
+    uint32_t psFlushTimeout = GetPSFlushTimeout();
+    timeout = (psFlushTimeout < timeout) ? psFlushTimeout : timeout;
+    return timeout;
+}
+
+int OC_CALL OCGetProcessFd()
+{
+    return CAGetWakeupFd();
+}
+
+OCStackResult OC_CALL OCWaitForProcess(uint32_t timeoutMs)
+{
+    if (stackState != OC_STACK_INITIALIZED)
+    {
+        OIC_LOG(ERROR, TAG, "OCWaitForProcess has failed. ocstack is not initialized");
+        return OC_STACK_ERROR;
+    }
+
+    if (0 == timeoutMs)
+    {
+        return OC_STACK_TIMEOUT;
+    }
+
+    CAResult_t caResult = CAWaitForWakeup(timeoutMs);
+    if (CA_STATUS_NOT_INITIALIZED == caResult)
+    {
+        return OC_STACK_ERROR;
+    }
+    return (CA_STATUS_OK == caResult) ? OC_STACK_OK : OC_STACK_TIMEOUT;
+}
+
+OCStackResult OC_CALL OCProcessWait(uint32_t maxWaitMs)
+{
+    if (stackState == OC_STACK_UNINITIALIZED)
+    {
+        OIC_LOG(ERROR, TAG, "OCProcessWait has failed. ocstack is not initialized");
+        return OC_STACK_ERROR;
+    }
+
+    uint32_t timeout = OCGetProcessTimeout();
+    OCWaitForProcess((maxWaitMs < timeout) ? maxWaitMs : timeout);
+    return OCProcess();
+}
+
+OCStackResult OC_CALL OCWakeProcess()
+{
+    return (CA_STATUS_OK == CAWakeup()) ? OC_STACK_OK : OC_STACK_ERROR;
+}
+
 #ifdef WITH_PRESENCE
 OCStackResult OC_CALL OCStartPresence(const uint32_t ttl)
 {
@@ -4065,66 +4369,442 @@ OCStackResult OC_CALL OCSetDefaultDeviceEntityHandler(OCDeviceEntityHandler enti
     return OC_STACK_OK;
 }
 
-OCTpsSchemeFlags OC_CALL OCGetSupportedEndpointTpsFlags()
+OCStackResult OC_CALL OCRegisterEncodedResponseHandler(OCClientResponseHandler responseHandler)
 {
-    return OCGetSupportedTpsFlags();
-}
+    VERIFY_NON_NULL(responseHandler, ERROR, OC_STACK_INVALID_PARAM);
 
-OCStackResult OC_CALL OCCreateResource(OCResourceHandle *handle,
-        const char *resourceTypeName,
-        const char *resourceInterfaceName,
-        const char *uri, OCEntityHandler entityHandler,
-        void *callbackParam,
-        uint8_t resourceProperties)
-{
-    return OCCreateResourceWithEp(handle,
-                                  resourceTypeName,
-                                  resourceInterfaceName,
-                                  uri, entityHandler,
-                                  callbackParam,
-                                  resourceProperties,
-                                  OC_ALL);
+    OCStackResult result = OC_STACK_NO_MEMORY;
+    LockHandlerTables();
+    for (size_t i = 0; i < MAX_ENCODED_HANDLERS; i++)
+    {
+        if (!g_encodedResponseHandlers[i] || g_encodedResponseHandlers[i] == responseHandler)
+        {
+            g_encodedResponseHandlers[i] = responseHandler;
+            result = OC_STACK_OK;
+            break;
+        }
+    }
+    UnlockHandlerTables();
+
+    if (OC_STACK_OK != result)
+    {
+        OIC_LOG(ERROR, TAG, "Too many encoded response handlers");
+    }
+    return result;
 }
 
-OCStackResult OC_CALL OCCreateResourceWithEp(OCResourceHandle *handle,
-        const char *resourceTypeName,
-        const char *resourceInterfaceName,
-        const char *uri, OCEntityHandler entityHandler,
-        void *callbackParam,
-        uint8_t resourceProperties,
-        OCTpsSchemeFlags resourceTpsTypes)
+OCStackResult OC_CALL OCUnregisterEncodedResponseHandler(OCClientResponseHandler responseHandler)
 {
+    VERIFY_NON_NULL(responseHandler, ERROR, OC_STACK_INVALID_PARAM);
 
-    OCResource *pointer = NULL;
-    OCStackResult result = OC_STACK_ERROR;
-
-    OIC_LOG(INFO, TAG, "Entering OCCreateResource");
-
-    if(myStackMode == OC_CLIENT)
+    LockHandlerTables();
+    for (size_t i = 0; i < MAX_ENCODED_HANDLERS && g_encodedResponseHandlers[i]; i++)
     {
-        return OC_STACK_INVALID_PARAM;
-    }
-    // Validate parameters
-    if(!uri || uri[0]=='\0' || strlen(uri)>=MAX_URI_LENGTH )
-    {
-        OIC_LOG(ERROR, TAG, "URI is empty or too long");
-        return OC_STACK_INVALID_URI;
+        if (g_encodedResponseHandlers[i] == responseHandler)
+        {
+            // Keep the used entries first.
+            size_t last = i;
+            while (last + 1 < MAX_ENCODED_HANDLERS && g_encodedResponseHandlers[last + 1])
+            {
+                last++;
+            }
+            g_encodedResponseHandlers[i] = g_encodedResponseHandlers[last];
+            g_encodedResponseHandlers[last] = NULL;
+            break;
+        }
     }
-    // Is it presented during resource discovery?
-    if (!handle || !resourceTypeName || resourceTypeName[0] == '\0' )
+    UnlockHandlerTables();
+    return OC_STACK_OK;
+}
+
+OCStackResult OC_CALL OCRegisterEncodedEntityHandler(OCEntityHandler entityHandler)
+{
+    VERIFY_NON_NULL(entityHandler, ERROR, OC_STACK_INVALID_PARAM);
+
+    OCStackResult result = OC_STACK_NO_MEMORY;
+    LockHandlerTables();
+    for (size_t i = 0; i < MAX_ENCODED_HANDLERS; i++)
     {
-        OIC_LOG(ERROR, TAG, "Input parameter is NULL");
-        return OC_STACK_INVALID_PARAM;
+        if (!g_encodedEntityHandlers[i] || g_encodedEntityHandlers[i] == entityHandler)
+        {
+            g_encodedEntityHandlers[i] = entityHandler;
+            result = OC_STACK_OK;
+            break;
+        }
     }
+    UnlockHandlerTables();
 
-    if (!resourceInterfaceName || strlen(resourceInterfaceName) == 0)
+    if (OC_STACK_OK != result)
     {
-        resourceInterfaceName = OC_RSRVD_INTERFACE_DEFAULT;
+        OIC_LOG(ERROR, TAG, "Too many encoded entity handlers");
     }
+    return result;
+}
 
-#ifdef MQ_PUBLISHER
-    resourceProperties = resourceProperties | OC_MQ_PUBLISHER;
-#endif
+OCStackResult OC_CALL OCUnregisterEncodedEntityHandler(OCEntityHandler entityHandler)
+{
+    VERIFY_NON_NULL(entityHandler, ERROR, OC_STACK_INVALID_PARAM);
+
+    LockHandlerTables();
+    for (size_t i = 0; i < MAX_ENCODED_HANDLERS && g_encodedEntityHandlers[i]; i++)
+    {
+        if (g_encodedEntityHandlers[i] == entityHandler)
+        {
+            // Keep the used entries first.
+            size_t last = i;
+            while (last + 1 < MAX_ENCODED_HANDLERS && g_encodedEntityHandlers[last + 1])
+            {
+                last++;
+            }
+            g_encodedEntityHandlers[i] = g_encodedEntityHandlers[last];
+            g_encodedEntityHandlers[last] = NULL;
+            break;
+        }
+    }
+    UnlockHandlerTables();
+    return OC_STACK_OK;
+}
+
+bool OCIsEncodedResponseHandler(OCClientResponseHandler responseHandler)
+{
+    bool encoded = false;
+    LockHandlerTables();
+    for (size_t i = 0; i < MAX_ENCODED_HANDLERS && g_encodedResponseHandlers[i]; i++)
+    {
+        if (g_encodedResponseHandlers[i] == responseHandler)
+        {
+            encoded = true;
+            break;
+        }
+    }
+    UnlockHandlerTables();
+    return encoded;
+}
+
+bool OCIsEncodedEntityHandler(OCEntityHandler entityHandler)
+{
+    bool encoded = false;
+    LockHandlerTables();
+    for (size_t i = 0; i < MAX_ENCODED_HANDLERS && g_encodedEntityHandlers[i]; i++)
+    {
+        if (g_encodedEntityHandlers[i] == entityHandler)
+        {
+            encoded = true;
+            break;
+        }
+    }
+    UnlockHandlerTables();
+    return encoded;
+}
+
+static void ClearHandlerTables()
+{
+    LockHandlerTables();
+    memset(g_encodedResponseHandlers, 0, sizeof(g_encodedResponseHandlers));
+    memset(g_encodedEntityHandlers, 0, sizeof(g_encodedEntityHandlers));
+    memset(g_blockResponseHandlers, 0, sizeof(g_blockResponseHandlers));
+    memset(g_blockEntityHandlers, 0, sizeof(g_blockEntityHandlers));
+    UnlockHandlerTables();
+}
+
+OCStackResult OC_CALL OCRegisterBlockResponseHandler(OCClientResponseHandler responseHandler,
+                                                     OCBlockDataHandler blockHandler)
+{
+    VERIFY_NON_NULL(responseHandler, ERROR, OC_STACK_INVALID_PARAM);
+
+    OCStackResult result = blockHandler ? OC_STACK_NO_MEMORY : OC_STACK_OK;
+    LockHandlerTables();
+    size_t i = 0;
+    while (i < MAX_ENCODED_HANDLERS && g_blockResponseHandlers[i].responseHandler &&
+           g_blockResponseHandlers[i].responseHandler != responseHandler)
+    {
+        i++;
+    }
+    if (i < MAX_ENCODED_HANDLERS)
+    {
+        if (blockHandler)
+        {
+            g_blockResponseHandlers[i].responseHandler = responseHandler;
+            g_blockResponseHandlers[i].blockHandler = blockHandler;
+            result = OC_STACK_OK;
+        }
+        else if (g_blockResponseHandlers[i].responseHandler)
+        {
+            // Keep the used entries first.
+            size_t last = i;
+            while (last + 1 < MAX_ENCODED_HANDLERS &&
+                   g_blockResponseHandlers[last + 1].responseHandler)
+            {
+                last++;
+            }
+            g_blockResponseHandlers[i] = g_blockResponseHandlers[last];
+            memset(&g_blockResponseHandlers[last], 0, sizeof(g_blockResponseHandlers[last]));
+        }
+    }
+    UnlockHandlerTables();
+
+    if (OC_STACK_OK != result)
+    {
+        OIC_LOG(ERROR, TAG, "Too many block response handlers");
+    }
+    return result;
+}
+
+OCStackResult OC_CALL OCRegisterBlockEntityHandler(OCEntityHandler entityHandler,
+                                                   OCBlockDataHandler blockHandler)
+{
+    VERIFY_NON_NULL(entityHandler, ERROR, OC_STACK_INVALID_PARAM);
+
+    OCStackResult result = blockHandler ? OC_STACK_NO_MEMORY : OC_STACK_OK;
+    LockHandlerTables();
+    size_t i = 0;
+    while (i < MAX_ENCODED_HANDLERS && g_blockEntityHandlers[i].entityHandler &&
+           g_blockEntityHandlers[i].entityHandler != entityHandler)
+    {
+        i++;
+    }
+    if (i < MAX_ENCODED_HANDLERS)
+    {
+        if (blockHandler)
+        {
+            g_blockEntityHandlers[i].entityHandler = entityHandler;
+            g_blockEntityHandlers[i].blockHandler = blockHandler;
+            result = OC_STACK_OK;
+        }
+        else if (g_blockEntityHandlers[i].entityHandler)
+        {
+            // Keep the used entries first.
+            size_t last = i;
+            while (last + 1 < MAX_ENCODED_HANDLERS &&
+                   g_blockEntityHandlers[last + 1].entityHandler)
+            {
+                last++;
+            }
+            g_blockEntityHandlers[i] = g_blockEntityHandlers[last];
+            memset(&g_blockEntityHandlers[last], 0, sizeof(g_blockEntityHandlers[last]));
+        }
+    }
+    UnlockHandlerTables();
+
+    if (OC_STACK_OK != result)
+    {
+        OIC_LOG(ERROR, TAG, "Too many block entity handlers");
+    }
+    return result;
+}
+
+static OCBlockDataHandler GetBlockResponseHandler(OCClientResponseHandler responseHandler)
+{
+    OCBlockDataHandler blockHandler = NULL;
+    LockHandlerTables();
+    for (size_t i = 0; i < MAX_ENCODED_HANDLERS && g_blockResponseHandlers[i].responseHandler;
+         i++)
+    {
+        if (g_blockResponseHandlers[i].responseHandler == responseHandler)
+        {
+            blockHandler = g_blockResponseHandlers[i].blockHandler;
+            break;
+        }
+    }
+    UnlockHandlerTables();
+    return blockHandler;
+}
+
+static OCBlockDataHandler GetBlockEntityHandler(OCEntityHandler entityHandler)
+{
+    OCBlockDataHandler blockHandler = NULL;
+    LockHandlerTables();
+    for (size_t i = 0; i < MAX_ENCODED_HANDLERS && g_blockEntityHandlers[i].entityHandler; i++)
+    {
+        if (g_blockEntityHandlers[i].entityHandler == entityHandler)
+        {
+            blockHandler = g_blockEntityHandlers[i].blockHandler;
+            break;
+        }
+    }
+    UnlockHandlerTables();
+    return blockHandler;
+}
+
+static OCStackResult AddBlockStream(const ClientCB *clientCB)
+{
+    OCBlockDataHandler blockHandler = GetBlockResponseHandler(clientCB->callBack);
+    if (!blockHandler)
+    {
+        return OC_STACK_OK;
+    }
+
+    BlockStream *stream = (BlockStream *)OICCalloc(1, sizeof(BlockStream));
+    VERIFY_NON_NULL(stream, FATAL, OC_STACK_NO_MEMORY);
+    stream->token = (CAToken_t)OICMalloc(clientCB->tokenLength);
+    if (!stream->token)
+    {
+        OIC_LOG(FATAL, TAG, "Failed to allocate the block stream token");
+        OICFree(stream);
+        return OC_STACK_NO_MEMORY;
+    }
+    memcpy(stream->token, clientCB->token, clientCB->tokenLength);
+    stream->tokenLength = clientCB->tokenLength;
+    stream->handle = clientCB->handle;
+    stream->blockHandler = blockHandler;
+    stream->context = clientCB->context;
+
+    oc_mutex_lock(g_blockStreamLock);
+    LL_PREPEND(g_blockStreams, stream);
+    oc_mutex_unlock(g_blockStreamLock);
+    return OC_STACK_OK;
+}
+
+void OCRemoveBlockStream(OCDoHandle handle)
+{
+    if (!g_blockStreamLock)
+    {
+        return;
+    }
+
+    BlockStream *stream = NULL;
+    oc_mutex_lock(g_blockStreamLock);
+    LL_FOREACH(g_blockStreams, stream)
+    {
+        if (stream->handle == handle)
+        {
+            LL_DELETE(g_blockStreams, stream);
+            break;
+        }
+    }
+    oc_mutex_unlock(g_blockStreamLock);
+
+    if (stream)
+    {
+        OICFree(stream->token);
+        OICFree(stream);
+    }
+}
+
+static bool HandleCABlockData(const CAEndpoint_t *endPoint, const CARequestInfo_t *requestInfo,
+        const CAResponseInfo_t *responseInfo, size_t offset, const uint8_t *data,
+        size_t length, size_t totalLength)
+{
+    OCBlockData block = {.offset = offset, .data = data, .length = length,
+                         .totalLength = totalLength};
+    CopyEndpointToDevAddr(endPoint, &block.devAddr);
+    bool taken = false;
+
+    if (responseInfo)
+    {
+        // The stream lock is held during the call, so that the request can not be deleted
+        // with its context meanwhile.
+        oc_mutex_lock(g_blockStreamLock);
+        BlockStream *stream = NULL;
+        LL_FOREACH(g_blockStreams, stream)
+        {
+            if (stream->tokenLength == responseInfo->info.tokenLength &&
+                0 == memcmp(stream->token, responseInfo->info.token, stream->tokenLength))
+            {
+                block.handle = stream->handle;
+                taken = stream->blockHandler(&block, stream->context);
+                break;
+            }
+        }
+        oc_mutex_unlock(g_blockStreamLock);
+    }
+    else if (requestInfo && requestInfo->info.resourceUri)
+    {
+#if defined(__WITH_DTLS__) || defined(__WITH_TLS__)
+        // Access to the resource is only checked once the request is reassembled, so no
+        // block is handed out before that.
+        OC_UNUSED(block);
+#else
+        char uri[MAX_URI_LENGTH] = { 0 };
+        OICStrcpy(uri, sizeof(uri), requestInfo->info.resourceUri);
+        char *query = strchr(uri, '?');
+        if (query)
+        {
+            *query = '\0';
+        }
+
+        // The resource is retained while its handler runs, like for a request dispatch.
+        LockResourceList();
+        OCResource *resource = OCResourceIndexFindByUri(uri);
+        OCBlockDataHandler blockHandler =
+            resource ? GetBlockEntityHandler(resource->entityHandler) : NULL;
+        if (blockHandler)
+        {
+            RetainResource(resource);
+        }
+        UnlockResourceList();
+
+        if (blockHandler)
+        {
+            block.resource = (OCResourceHandle)resource;
+            taken = blockHandler(&block, resource->entityHandlerCallbackParam);
+            ReleaseResource(resource);
+        }
+#endif
+    }
+    return taken;
+}
+
+OCTpsSchemeFlags OC_CALL OCGetSupportedEndpointTpsFlags()
+{
+    return OCGetSupportedTpsFlags();
+}
+
+OCStackResult OC_CALL OCCreateResource(OCResourceHandle *handle,
+        const char *resourceTypeName,
+        const char *resourceInterfaceName,
+        const char *uri, OCEntityHandler entityHandler,
+        void *callbackParam,
+        uint8_t resourceProperties)
+{
+    return OCCreateResourceWithEp(handle,
+                                  resourceTypeName,
+                                  resourceInterfaceName,
+                                  uri, entityHandler,
+                                  callbackParam,
+                                  resourceProperties,
+                                  OC_ALL);
+}
+
+OCStackResult OC_CALL OCCreateResourceWithEp(OCResourceHandle *handle,
+        const char *resourceTypeName,
+        const char *resourceInterfaceName,
+        const char *uri, OCEntityHandler entityHandler,
+        void *callbackParam,
+        uint8_t resourceProperties,
+        OCTpsSchemeFlags resourceTpsTypes)
+{
+
+    OCResource *pointer = NULL;
+    OCStackResult result = OC_STACK_ERROR;
+
+    OIC_LOG(INFO, TAG, "Entering OCCreateResource");
+
+    if(myStackMode == OC_CLIENT)
+    {
+        return OC_STACK_INVALID_PARAM;
+    }
+    // Validate parameters
+    if(!uri || uri[0]=='\0' || strlen(uri)>=MAX_URI_LENGTH )
+    {
+        OIC_LOG(ERROR, TAG, "URI is empty or too long");
+        return OC_STACK_INVALID_URI;
+    }
+    // Is it presented during resource discovery?
+    if (!handle || !resourceTypeName || resourceTypeName[0] == '\0' )
+    {
+        OIC_LOG(ERROR, TAG, "Input parameter is NULL");
+        return OC_STACK_INVALID_PARAM;
+    }
+
+    if (!resourceInterfaceName || strlen(resourceInterfaceName) == 0)
+    {
+        resourceInterfaceName = OC_RSRVD_INTERFACE_DEFAULT;
+    }
+
+#ifdef MQ_PUBLISHER
+    resourceProperties = resourceProperties | OC_MQ_PUBLISHER;
+#endif
     // Make sure resourceProperties bitmask has allowed properties specified
     if (resourceProperties
             > (OC_ACTIVE | OC_DISCOVERABLE | OC_OBSERVABLE | OC_SLOW | OC_NONSECURE | OC_SECURE |
@@ -4170,21 +4850,15 @@ OCStackResult OC_CALL OCCreateResourceWithEp(OCResourceHandle *handle,
         return OC_STACK_INVALID_PARAM;
     }
 
-    // If the headResource is NULL, then no resources have been created...
-    pointer = headResource;
-    if (pointer)
+    // The resource is only visible to request dispatch threads once it is complete.
+    LockResourceList();
+
+    // Repeated URLs are not allowed.  If a repeat is found, exit with an error
+    if (OCResourceIndexFindByUri(uri))
     {
-        // At least one resources is in the resource list, so we need to search for
-        // repeated URLs, which are not allowed.  If a repeat is found, exit with an error
-        while (pointer)
-        {
-            if (strncmp(uri, pointer->uri, MAX_URI_LENGTH) == 0)
-            {
-                OIC_LOG_V(ERROR, TAG, "Resource %s already exists", uri);
-                return OC_STACK_INVALID_PARAM;
-            }
-            pointer = pointer->next;
-        }
+        UnlockResourceList();
+        OIC_LOG_V(ERROR, TAG, "Resource %s already exists", uri);
+        return OC_STACK_INVALID_PARAM;
     }
     // Create the pointer and insert it into the resource list
     pointer = (OCResource *) OICCalloc(1, sizeof(OCResource));
@@ -4205,6 +4879,12 @@ OCStackResult OC_CALL OCCreateResourceWithEp(OCResourceHandle *handle,
         goto exit;
     }
 
+    result = OCResourceIndexAdd(pointer);
+    if (result != OC_STACK_OK)
+    {
+        goto exit;
+    }
+
     // Set resource to nonsecure if caller did not specify
     if ((resourceProperties & OC_MASK_RESOURCE_SECURE) == 0)
     {
@@ -4259,6 +4939,16 @@ OCStackResult OC_CALL OCCreateResourceWithEp(OCResourceHandle *handle,
 
     *handle = pointer;
     result = OC_STACK_OK;
+    OCDiscoveryCacheInvalidate();
+
+exit:
+    UnlockResourceList();
+    if (result != OC_STACK_OK)
+    {
+        // Deep delete of resource and other dynamic elements that it contains
+        deleteResource(pointer);
+        return result;
+    }
 
 #ifdef WITH_PRESENCE
     if (presenceResource.handle)
@@ -4267,12 +4957,6 @@ OCStackResult OC_CALL OCCreateResourceWithEp(OCResourceHandle *handle,
         SendPresenceNotification(pointer->rsrcType, OC_PRESENCE_TRIGGER_CREATE);
     }
 #endif
-exit:
-    if (result != OC_STACK_OK)
-    {
-        // Deep delete of resource and other dynamic elements that it contains
-        deleteResource(pointer);
-    }
     return result;
 }
 
@@ -4334,6 +5018,7 @@ OCStackResult OC_CALL OCBindResource(
     }
 
     OIC_LOG(INFO, TAG, "resource bound");
+    OCDiscoveryCacheInvalidate();
 
 #ifdef WITH_PRESENCE
     if (presenceResource.handle)
@@ -4411,6 +5096,7 @@ OCStackResult OC_CALL OCUnBindResource(
             }
 
             OIC_LOG(INFO, TAG, "resource unbound");
+            OCDiscoveryCacheInvalidate();
 
             // Send notification when resource is unbounded successfully.
 #ifdef WITH_PRESENCE
@@ -4610,14 +5296,17 @@ OCStackResult OC_CALL OCBindResourceTypeToResource(OCResourceHandle handle,
     OCStackResult result = OC_STACK_ERROR;
     OCResource *resource = NULL;
 
+    LockResourceList();
     resource = findResource((OCResource *) handle);
     if (!resource)
     {
+        UnlockResourceList();
         OIC_LOG(ERROR, TAG, "Resource not found");
         return OC_STACK_ERROR;
     }
 
     result = BindResourceTypeToResource(resource, resourceTypeName);
+    UnlockResourceList();
 
 #ifdef WITH_PRESENCE
     if(presenceResource.handle)
@@ -4637,14 +5326,17 @@ OCStackResult OC_CALL OCBindResourceInterfaceToResource(OCResourceHandle handle,
     OCStackResult result = OC_STACK_ERROR;
     OCResource *resource = NULL;
 
+    LockResourceList();
     resource = findResource((OCResource *) handle);
     if (!resource)
     {
+        UnlockResourceList();
         OIC_LOG(ERROR, TAG, "Resource not found");
         return OC_STACK_ERROR;
     }
 
     result = BindResourceInterfaceToResource(resource, resourceInterfaceName);
+    UnlockResourceList();
 
 #ifdef WITH_PRESENCE
     if (presenceResource.handle)
@@ -4659,26 +5351,30 @@ OCStackResult OC_CALL OCBindResourceInterfaceToResource(OCResourceHandle handle,
 
 OCStackResult OC_CALL OCGetNumberOfResources(uint8_t *numResources)
 {
-    OCResource *pointer = headResource;
-
     VERIFY_NON_NULL(numResources, ERROR, OC_STACK_INVALID_PARAM);
+
+    LockResourceList();
+    OCResource *pointer = headResource;
     *numResources = 0;
     while (pointer)
     {
         *numResources = *numResources + 1;
         pointer = pointer->next;
     }
+    UnlockResourceList();
     return OC_STACK_OK;
 }
 
 OCResourceHandle OC_CALL OCGetResourceHandle(uint8_t index)
 {
+    LockResourceList();
     OCResource *pointer = headResource;
 
     for( uint8_t i = 0; i < index && pointer; ++i)
     {
         pointer = pointer->next;
     }
+    UnlockResourceList();
     return (OCResourceHandle) pointer;
 }
 
@@ -4741,6 +5437,7 @@ OCStackResult OC_CALL OCSetResourceProperties(OCResourceHandle handle, uint8_t r
         return OC_STACK_NO_RESOURCE;
     }
     resource->resourceProperties = (OCResourceProperty) (resource->resourceProperties | resourceProperties);
+    OCDiscoveryCacheInvalidate();
     return OC_STACK_OK;
 }
 
@@ -4755,6 +5452,7 @@ OCStackResult OC_CALL OCClearResourceProperties(OCResourceHandle handle, uint8_t
         return OC_STACK_NO_RESOURCE;
     }
     resource->resourceProperties = (OCResourceProperty) (resource->resourceProperties & ~resourceProperties);
+    OCDiscoveryCacheInvalidate();
     return OC_STACK_OK;
 }
 
@@ -5004,7 +5702,7 @@ OCStackResult OC_CALL OCNotifyAllObservers(OCResourceHandle handle, OCQualityOfS
 OCStackResult
 OC_CALL OCNotifyListOfObservers (OCResourceHandle handle,
                                  OCObservationId  *obsIdList,
-                                 uint8_t          numberOfIds,
+                                 size_t           numberOfIds,
                                  const OCRepPayload       *payload,
                                  OCQualityOfService qos)
 {
@@ -5108,6 +5806,7 @@ OCStackResult initResources()
 
     headResource = NULL;
     tailResource = NULL;
+    OCResourceIndexClear();
     // Init Virtual Resources
 #ifdef WITH_PRESENCE
     presenceResource.presenceTTL = OC_DEFAULT_PRESENCE_TTL_SECONDS;
@@ -5249,6 +5948,102 @@ OCStackResult initResources()
     return result;
 }
 
+void LockResourceList()
+{
+    oc_mutex_lock(g_resourceListLock);
+}
+
+void UnlockResourceList()
+{
+    oc_mutex_unlock(g_resourceListLock);
+}
+
+void RetainResource(OCResource *resource)
+{
+    if (resource)
+    {
+        resource->dispatchRefCount++;
+    }
+}
+
+void ReleaseResource(OCResource *resource)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    // Resources are only freed with the observer list lock held, see LockObserverLists().
+    LockObserverLists();
+    LockResourceList();
+    assert(resource->dispatchRefCount > 0);
+    resource->dispatchRefCount--;
+    bool doFree = (0 == resource->dispatchRefCount) && resource->deletePending;
+    UnlockResourceList();
+
+    if (doFree)
+    {
+        OIC_LOG_V(INFO, TAG, "Freeing deleted resource %s", resource->uri);
+        deleteResourceElements(resource);
+        OICFree(resource);
+    }
+    UnlockObserverLists();
+}
+
+OCStackResult InitializeStackLists()
+{
+    assert(g_resourceListLock == NULL);
+
+    g_resourceListLock = oc_mutex_new_recursive();
+    if (g_resourceListLock == NULL)
+    {
+        return OC_STACK_ERROR;
+    }
+
+    // Recursive, as a block data handler may cancel its request.
+    g_blockStreamLock = oc_mutex_new_recursive();
+    if (g_blockStreamLock == NULL)
+    {
+        TerminateStackLists();
+        return OC_STACK_ERROR;
+    }
+
+    OCStackResult result = InitializeObserverLists();
+    if (result == OC_STACK_OK)
+    {
+        result = InitializeServerRequestList();
+    }
+    if (result == OC_STACK_OK)
+    {
+        result = InitializeDiscoveryCache();
+    }
+    if (result != OC_STACK_OK)
+    {
+        TerminateStackLists();
+    }
+    return result;
+}
+
+void TerminateStackLists()
+{
+    // Cached responses are detached from the server requests that still use them.
+    TerminateDiscoveryCache();
+    TerminateServerRequestList();
+    TerminateObserverLists();
+    if (g_resourceListLock != NULL)
+    {
+        oc_mutex_free(g_resourceListLock);
+        g_resourceListLock = NULL;
+    }
+    // The client callbacks, and with them the block streams, are deleted by now.
+    assert(g_blockStreams == NULL);
+    if (g_blockStreamLock != NULL)
+    {
+        oc_mutex_free(g_blockStreamLock);
+        g_blockStreamLock = NULL;
+    }
+}
+
 void insertResource(OCResource *resource)
 {
     if (!headResource)
@@ -5266,17 +6061,10 @@ void insertResource(OCResource *resource)
 
 OCResource *findResource(OCResource *resource)
 {
-    OCResource *pointer = headResource;
-
-    while (pointer)
-    {
-        if (pointer == resource)
-        {
-            return resource;
-        }
-        pointer = pointer->next;
-    }
-    return NULL;
+    LockResourceList();
+    bool found = OCResourceIndexContains(resource);
+    UnlockResourceList();
+    return found ? resource : NULL;
 }
 
 void deleteAllResources()
@@ -5306,6 +6094,9 @@ void deleteAllResources()
 
     SRMDeInitSecureResources();
 
+    // Write out secure resource updates still held back in the coalescing window.
+    FlushPendingPSUpdates(true);
+
 #ifdef WITH_PRESENCE
     // Ensure that the last resource to be deleted is the presence resource. This allows for all
     // presence notification attributed to their deletion to be processed.
@@ -5326,62 +6117,86 @@ OCStackResult deleteResource(OCResource *resource)
 
     OIC_LOG_V (INFO, TAG, "Deleting resource %s", resource->uri);
 
-    temp = headResource;
-    while (temp)
+    LockResourceList();
+    for (temp = headResource; temp && temp != resource; temp = temp->next)
     {
-        if (temp == resource)
-        {
-            // Invalidate all Resource Properties.
-            resource->resourceProperties = (OCResourceProperty) 0;
+    }
+    UnlockResourceList();
+    if (!temp)
+    {
+        return OC_STACK_ERROR;
+    }
+
+    // Invalidate all Resource Properties.
+    resource->resourceProperties = (OCResourceProperty) 0;
 #ifdef WITH_PRESENCE
-            if(resource != (OCResource *) presenceResource.handle)
-            {
+    if(resource != (OCResource *) presenceResource.handle)
+    {
 #endif // WITH_PRESENCE
-                OCNotifyAllObservers((OCResourceHandle)resource, OC_HIGH_QOS);
+        OCNotifyAllObservers((OCResourceHandle)resource, OC_HIGH_QOS);
 #ifdef WITH_PRESENCE
-            }
+    }
 
-            if(presenceResource.handle)
-            {
-                ((OCResource *)presenceResource.handle)->sequenceNum = OCGetRandom();
-                SendPresenceNotification(resource->rsrcType, OC_PRESENCE_TRIGGER_DELETE);
-            }
+    if(presenceResource.handle)
+    {
+        ((OCResource *)presenceResource.handle)->sequenceNum = OCGetRandom();
+        SendPresenceNotification(resource->rsrcType, OC_PRESENCE_TRIGGER_DELETE);
+    }
 #endif
-            // Only resource in list.
-            if (temp == headResource && temp == tailResource)
-            {
-                headResource = NULL;
-                tailResource = NULL;
-            }
-            // Deleting head.
-            else if (temp == headResource)
-            {
-                headResource = temp->next;
-            }
-            // Deleting tail.
-            else if (temp == tailResource && prev)
-            {
-                tailResource = prev;
-                tailResource->next = NULL;
-            }
-            else if (prev)
-            {
-                prev->next = temp->next;
-            }
 
-            deleteResourceElements(temp);
-            OICFree(temp);
-            temp = NULL;
-            return OC_STACK_OK;
-        }
-        else
-        {
-            prev = temp;
-            temp = temp->next;
-        }
+    // Observers are notified without the resource list lock, so the resource is looked up
+    // again in case another thread deleted it meanwhile.
+    LockObserverLists();
+    LockResourceList();
+    temp = headResource;
+    while (temp && temp != resource)
+    {
+        prev = temp;
+        temp = temp->next;
+    }
+    if (!temp)
+    {
+        UnlockResourceList();
+        UnlockObserverLists();
+        return OC_STACK_ERROR;
     }
 
-    return OC_STACK_ERROR;
+    OCResourceIndexRemove(temp);
+    OCDiscoveryCacheInvalidate();
+
+    // Only resource in list.
+    if (temp == headResource && temp == tailResource)
+    {
+        headResource = NULL;
+        tailResource = NULL;
+    }
+    // Deleting head.
+    else if (temp == headResource)
+    {
+        headResource = temp->next;
+    }
+    // Deleting tail.
+    else if (temp == tailResource && prev)
+    {
+        tailResource = prev;
+        tailResource->next = NULL;
+    }
+    else if (prev)
+    {
+        prev->next = temp->next;
+    }
+    // A request dispatch thread still using the resource frees it when it is done.
+    bool inUse = (temp->dispatchRefCount > 0);
+    temp->deletePending = inUse;
+    UnlockResourceList();
+
+    if (!inUse)
+    {
+        deleteResourceElements(temp);
+        OICFree(temp);
+    }
+    UnlockObserverLists();
+    return OC_STACK_OK;
 }
 
 void deleteResourceElements(OCResource *resource)
@@ -5502,6 +6317,8 @@ void insertResourceType(OCResource *resource, OCResourceType *resourceType)
         }
     }
     resourceType->next = NULL;
+    OCResourceIndexAddType(resource, resourceType->resourcetypename);
+    OCDiscoveryCacheInvalidate();
 
     OIC_LOG_V(INFO, TAG, "Added type %s to %s", resourceType->resourcetypename, resource->uri);
 }
@@ -5585,10 +6402,13 @@ void insertResourceInterface(OCResource *resource, OCResourceInterface *newInter
                 OICFree(newInterface);
                 return;
             }
-            if (*firstInterface)
+            if (!*firstInterface)
             {
-                (*firstInterface)->next = newInterface;
+                OICFree(newInterface->name);
+                OICFree(newInterface);
+                return;
             }
+            (*firstInterface)->next = newInterface;
         }
     }
     // If once add oic.if.baseline, later too below code take care of freeing memory.
@@ -5627,6 +6447,9 @@ void insertResourceInterface(OCResource *resource, OCResourceInterface *newInter
             previous->next = newInterface;
         }
     }
+
+    OCResourceIndexAddInterface(resource, newInterface->name);
+    OCDiscoveryCacheInvalidate();
 }
 
 OCResourceInterface *findResourceInterfaceAtIndex(OCResourceHandle handle,
@@ -5872,6 +6695,11 @@ OCStackResult OC_CALL OCSetProxyURI(const char *uri)
     return CAResultToOCResult(CASetProxyUri(uri));
 }
 
+OCStackResult OC_CALL OCSetDispatchShardCount(uint8_t count)
+{
+    return CAResultToOCResult(CASetDispatchShardCount(count));
+}
+
 #if defined(RD_CLIENT) || defined(RD_SERVER)
 OCStackResult OC_CALL OCBindResourceInsToResource(OCResourceHandle handle, int64_t ins)
 {
@@ -6037,18 +6865,14 @@ OCResourceHandle OC_CALL OCGetResourceHandleAtUri(const char *uri)
         return NULL;
     }
 
-    OCResource *pointer = headResource;
-
-    while (pointer)
+    LockResourceList();
+    OCResource *pointer = OCResourceIndexFindByUri(uri);
+    UnlockResourceList();
+    if (pointer)
     {
-        if (strncmp(uri, pointer->uri, MAX_URI_LENGTH) == 0)
-        {
-            OIC_LOG_V(DEBUG, TAG, "Found Resource %s", uri);
-            return pointer;
-        }
-        pointer = pointer->next;
+        OIC_LOG_V(DEBUG, TAG, "Found Resource %s", uri);
     }
-    return NULL;
+    return pointer;
 }
 
 static OCStackResult SetHeaderOption(CAHeaderOption_t *caHdrOpt, size_t numOptions,
@@ -6163,6 +6987,9 @@ void OCDefaultAdapterStateChangedHandler(CATransportAdapter_t adapter, bool enab
 
     OC_UNUSED(adapter);
     OC_UNUSED(enabled);
+
+    // The endpoints listed in discovery responses come from the network interfaces.
+    OCDiscoveryCacheInvalidate();
 }
 
 void OCDefaultConnectionStateChangedHandler(const CAEndpoint_t *info, bool isConnected)
@@ -6213,6 +7040,11 @@ OCStackResult OC_CALL OCSetDeviceId(const OCUUIdentity *deviceId)
         OIC_LOG_V(INFO, TAG, "Set Device Id %x", oicUuid.id[i]);
     }
     ret = SetDoxmDeviceID(&oicUuid);
+    if (OC_STACK_OK == ret)
+    {
+        // Discovery responses carry the device ID.
+        OCDiscoveryCacheInvalidate();
+    }
     return ret;
 }
 
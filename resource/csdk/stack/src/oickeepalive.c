@@ -72,6 +72,11 @@ static const uint64_t USECS_PER_SEC = 1000000;
  */
 #define KEEPALIVE_MAX_INTERVAL 64
 
+/**
+ * Shortest wait GetKeepAliveTimeout() reports, in milliseconds.
+ */
+#define KEEPALIVE_MIN_WAIT_MS 10
+
 /**
  * Default counts of interval value.
  */
@@ -617,6 +622,56 @@ void ProcessKeepAlive()
     }
 }
 
+uint32_t GetKeepAliveTimeout()
+{
+    if (!g_isKeepAliveInitialized)
+    {
+        return UINT32_MAX;
+    }
+
+    uint64_t currentTime = OICGetCurrentTime(TIME_IN_US);
+    uint64_t earliest = UINT64_MAX;
+    size_t len = u_arraylist_length(g_keepAliveConnectionTable);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        KeepAliveEntry_t *entry = (KeepAliveEntry_t *)u_arraylist_get(g_keepAliveConnectionTable,
+                                                                      i);
+        if (NULL == entry)
+        {
+            continue;
+        }
+
+        // Same deadlines as ProcessKeepAlive().
+        uint64_t timeout = KEEPALIVE_RESPONSE_TIMEOUT_SEC * USECS_PER_SEC;
+        if (!(OC_CLIENT == entry->mode && entry->sentPingMsg))
+        {
+            timeout *= entry->interval;
+        }
+
+        uint64_t deadline = entry->timeStamp + timeout;
+        if (deadline < earliest)
+        {
+            earliest = deadline;
+        }
+    }
+
+    if (UINT64_MAX == earliest)
+    {
+        return UINT32_MAX;
+    }
+
+    // An overdue entry stays in the table until its disconnect completes, so recheck it at
+    // the old polling rate rather than spinning.
+    if (earliest <= currentTime + KEEPALIVE_MIN_WAIT_MS * 1000)
+    {
+        return KEEPALIVE_MIN_WAIT_MS;
+    }
+
+    uint64_t waitMs = (earliest - currentTime + 999) / 1000;
+    return (waitMs < UINT32_MAX) ? (uint32_t)waitMs : UINT32_MAX - 1;
+}
+
 void IncreaseInterval(KeepAliveEntry_t *entry)
 {
     VERIFY_NON_NULL_NR(entry, FATAL);
@@ -775,6 +830,9 @@ KeepAliveEntry_t *AddKeepAliveEntry(const CAEndpoint_t *endpoint, OCMode mode,
         return NULL;
     }
 
+    // Connections come up on adapter threads; let a blocked OCProcess pick up the new timer.
+    CAWakeup();
+
     return entry;
 }
 
@@ -433,3 +433,69 @@ TEST(CborEmptyArrayTest, EmptyArrayArraySetGetTest)
     OCRepPayloadDestroy(payload_in);
 }
 
+
+struct ProducedCbor
+{
+    uint8_t* bytes;
+    size_t size;
+    int releaseCount;
+};
+
+static bool produceCbor(void* context, size_t offset, uint8_t* buffer, size_t length)
+{
+    ProducedCbor* produced = (ProducedCbor*)context;
+    if (offset + length > produced->size)
+    {
+        return false;
+    }
+    memcpy(buffer, produced->bytes + offset, length);
+    return true;
+}
+
+static void releaseCbor(void* context)
+{
+    ((ProducedCbor*)context)->releaseCount++;
+}
+
+TEST(CborEncodedPayloadTest, ProducedConvertParseTest)
+{
+    OCRepPayload* payload_in = OCRepPayloadCreate();
+    ASSERT_TRUE(payload_in != NULL);
+    OCRepPayloadSetPropInt(payload_in, "scale", 4);
+
+    ProducedCbor produced = { NULL, 0, 0 };
+    EXPECT_EQ(OC_STACK_OK, OCConvertPayload((OCPayload*)payload_in, OC_FORMAT_CBOR,
+                                            &produced.bytes, &produced.size));
+    OCRepPayloadDestroy(payload_in);
+
+    OCEncodedPayload* encoded = OCEncodedPayloadCreateProduced(produced.size, produceCbor,
+                                                               &produced, releaseCbor);
+    ASSERT_TRUE(encoded != NULL);
+
+    // Sent whole, the payload is produced into the message buffer.
+    uint8_t* payload_cbor = NULL;
+    size_t payload_size = 0;
+    EXPECT_EQ(OC_STACK_OK, OCConvertPayload((OCPayload*)encoded, OC_FORMAT_CBOR,
+                                            &payload_cbor, &payload_size));
+    ASSERT_EQ(produced.size, payload_size);
+    EXPECT_EQ(0, memcmp(produced.bytes, payload_cbor, payload_size));
+
+    OCRepPayload* payload_out = NULL;
+    EXPECT_EQ(OC_STACK_OK, OCEncodedPayloadParse(encoded, &payload_out));
+    int64_t scale = 0;
+    EXPECT_TRUE(OCRepPayloadGetPropInt(payload_out, "scale", &scale));
+    EXPECT_EQ(4, scale);
+
+    EXPECT_EQ(0, produced.releaseCount);
+    OCPayloadDestroy((OCPayload*)encoded);
+    EXPECT_EQ(1, produced.releaseCount);
+
+    // The context is released even if the payload can not be created.
+    EXPECT_TRUE(OCEncodedPayloadCreateProduced(0, produceCbor, &produced, releaseCbor) == NULL);
+    EXPECT_EQ(2, produced.releaseCount);
+
+    // Cleanup
+    OCPayloadDestroy((OCPayload*)payload_out);
+    OICFree(payload_cbor);
+    OICFree(produced.bytes);
+}
@@ -0,0 +1,146 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Throughput benchmark of request dispatch. A client in the same process keeps a window of
+// GET requests outstanding against resources whose entity handlers burn CPU, and the
+// request rate is reported with requests handled in OCProcess() and with requests spread
+// over dispatch threads.
+
+extern "C"
+{
+    #include "ocstack.h"
+    #include "ocpayload.h"
+    #include "cautilinterface.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest_helper.h"
+
+namespace itst = iotivity::test;
+
+namespace
+{
+    const size_t RESOURCE_COUNT = 8;
+    const size_t REQUEST_COUNT = 4000;
+    const size_t WINDOW = 32;
+    const std::chrono::microseconds HANDLER_WORK(200);
+    const uint8_t SHARD_COUNTS[] = { 0, 2, 4 };
+
+    std::atomic<size_t> g_responses(0);
+
+    OCEntityHandlerResult busyEntityHandler(OCEntityHandlerFlag /*flag*/,
+            OCEntityHandlerRequest *entityHandlerRequest, void * /*callbackParam*/)
+    {
+        auto until = std::chrono::steady_clock::now() + HANDLER_WORK;
+        while (std::chrono::steady_clock::now() < until)
+        {
+        }
+
+        OCRepPayload *payload = OCRepPayloadCreate();
+        OCRepPayloadSetPropInt(payload, "value", 1);
+
+        OCEntityHandlerResponse response = OCEntityHandlerResponse();
+        response.requestHandle = entityHandlerRequest->requestHandle;
+        response.ehResult = OC_EH_OK;
+        response.payload = reinterpret_cast<OCPayload *>(payload);
+        OCStackResult result = OCDoResponse(&response);
+        OCRepPayloadDestroy(payload);
+        return (OC_STACK_OK == result) ? OC_EH_OK : OC_EH_ERROR;
+    }
+
+    OCStackApplicationResult responseCallback(void * /*ctx*/, OCDoHandle /*handle*/,
+                                              OCClientResponse * /*clientResponse*/)
+    {
+        ++g_responses;
+        return OC_STACK_DELETE_TRANSACTION;
+    }
+
+    double measure(uint8_t shardCount)
+    {
+        EXPECT_EQ(OC_STACK_OK, OCSetDispatchShardCount(shardCount));
+        EXPECT_EQ(OC_STACK_OK, OCInit(NULL, 0, OC_CLIENT_SERVER));
+
+        std::vector<std::string> uris;
+        for (size_t i = 0; i < RESOURCE_COUNT; ++i)
+        {
+            char uri[MAX_URI_LENGTH];
+            snprintf(uri, sizeof(uri), "/bench/dispatch/%zu", i);
+            uris.push_back(uri);
+
+            OCResourceHandle handle = NULL;
+            EXPECT_EQ(OC_STACK_OK, OCCreateResource(&handle, "x.org.bench.dispatch",
+                                                    OC_RSRVD_INTERFACE_DEFAULT, uri,
+                                                    busyEntityHandler, NULL, OC_DISCOVERABLE));
+        }
+
+        OCDevAddr server = OCDevAddr();
+        server.adapter = OC_ADAPTER_IP;
+        server.flags = OC_IP_USE_V4;
+        server.port = CAGetAssignedPortNumber(CA_ADAPTER_IP, CA_IPV4);
+        snprintf(server.addr, sizeof(server.addr), "127.0.0.1");
+
+        OCCallbackData cbData = OCCallbackData();
+        cbData.cb = responseCallback;
+
+        g_responses = 0;
+        size_t sent = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (g_responses < REQUEST_COUNT)
+        {
+            while (sent < REQUEST_COUNT && sent - g_responses < WINDOW)
+            {
+                EXPECT_EQ(OC_STACK_OK, OCDoResource(NULL, OC_REST_GET,
+                                                    uris[sent % uris.size()].c_str(),
+                                                    &server, NULL, CT_ADAPTER_IP, OC_LOW_QOS,
+                                                    &cbData, NULL, 0));
+                ++sent;
+            }
+            OCProcess();
+        }
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        EXPECT_EQ(OC_STACK_OK, OCStop());
+        EXPECT_EQ(OC_STACK_OK, OCSetDispatchShardCount(0));
+        return REQUEST_COUNT / seconds;
+    }
+}
+
+TEST(DispatchBenchmark, CpuBoundHandlersVersusDispatchThreads)
+{
+    itst::DeadmanTimer killSwitch(std::chrono::seconds(300));
+
+    for (uint8_t shardCount : SHARD_COUNTS)
+    {
+        double rate = measure(shardCount);
+        std::cout << "dispatch threads=" << static_cast<int>(shardCount)
+                  << " resources=" << RESOURCE_COUNT
+                  << " handler work=" << HANDLER_WORK.count() << "us"
+                  << " requests/s=" << rate << std::endl;
+    }
+}
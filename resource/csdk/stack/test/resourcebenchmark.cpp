@@ -0,0 +1,177 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Microbenchmark of resource lookup and discovery filtering against the number of
+// resources hosted by the stack. The indexed lookups are compared with a walk of the
+// resource list, which is what every request paid before the indexes existed.
+
+extern "C"
+{
+    #include "ocstack.h"
+    #include "ocstackinternal.h"
+    #include "ocresource.h"
+    #include "ocresourcehandler.h"
+    #include "ocresourceindex.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest_helper.h"
+
+namespace itst = iotivity::test;
+
+extern "C" OCResource *headResource;
+
+namespace
+{
+    const size_t RESOURCE_COUNTS[] = { 100, 1000, 5000 };
+    const size_t TYPE_COUNT = 16;
+    const size_t LOOKUP_ROUNDS = 5;
+
+    OCEntityHandlerResult benchEntityHandler(OCEntityHandlerFlag /*flag*/,
+            OCEntityHandlerRequest * /*entityHandlerRequest*/, void * /*callbackParam*/)
+    {
+        return OC_EH_OK;
+    }
+
+    std::string benchUri(size_t i)
+    {
+        char uri[MAX_URI_LENGTH];
+        snprintf(uri, sizeof(uri), "/bench/resource/%zu", i);
+        return uri;
+    }
+
+    std::string benchType(size_t i)
+    {
+        char type[64];
+        snprintf(type, sizeof(type), "x.org.bench.type%zu", i % TYPE_COUNT);
+        return type;
+    }
+
+    OCResource *scanByUri(const char *uri)
+    {
+        for (OCResource *resource = headResource; resource; resource = resource->next)
+        {
+            if (0 == strcmp(uri, resource->uri))
+            {
+                return resource;
+            }
+        }
+        return NULL;
+    }
+
+    size_t scanByType(const char *type)
+    {
+        size_t matches = 0;
+        for (OCResource *resource = headResource; resource; resource = resource->next)
+        {
+            for (OCResourceType *rt = resource->rsrcType; rt; rt = rt->next)
+            {
+                if (0 == strcmp(type, rt->resourcetypename))
+                {
+                    ++matches;
+                    break;
+                }
+            }
+        }
+        return matches;
+    }
+
+    double nanosPer(std::chrono::steady_clock::duration elapsed, size_t operations)
+    {
+        return std::chrono::duration<double, std::nano>(elapsed).count() / operations;
+    }
+}
+
+TEST(ResourceBenchmark, LookupAndDiscoveryVersusResourceCount)
+{
+    itst::DeadmanTimer killSwitch(std::chrono::seconds(300));
+
+    for (size_t resourceCount : RESOURCE_COUNTS)
+    {
+        ASSERT_EQ(OC_STACK_OK, OCInit(NULL, 0, OC_SERVER));
+
+        std::vector<std::string> uris;
+        for (size_t i = 0; i < resourceCount; ++i)
+        {
+            OCResourceHandle handle = NULL;
+            uris.push_back(benchUri(i));
+            ASSERT_EQ(OC_STACK_OK, OCCreateResource(&handle, benchType(i).c_str(),
+                                                    OC_RSRVD_INTERFACE_DEFAULT,
+                                                    uris.back().c_str(), benchEntityHandler,
+                                                    NULL, OC_DISCOVERABLE));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < LOOKUP_ROUNDS; ++round)
+        {
+            for (const std::string &uri : uris)
+            {
+                ASSERT_TRUE(NULL != FindResourceByUri(uri.c_str()));
+            }
+        }
+        double indexedLookup = nanosPer(std::chrono::steady_clock::now() - start,
+                                        LOOKUP_ROUNDS * uris.size());
+
+        start = std::chrono::steady_clock::now();
+        for (const std::string &uri : uris)
+        {
+            ASSERT_TRUE(NULL != scanByUri(uri.c_str()));
+        }
+        double scannedLookup = nanosPer(std::chrono::steady_clock::now() - start, uris.size());
+
+        std::string type = benchType(0);
+        size_t expected = (resourceCount + TYPE_COUNT - 1) / TYPE_COUNT;
+
+        start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < LOOKUP_ROUNDS; ++round)
+        {
+            OCResource * const *candidates = NULL;
+            size_t count = 0;
+            ASSERT_TRUE(OCResourceIndexFindByType(type.c_str(), &candidates, &count));
+            ASSERT_EQ(expected, count);
+        }
+        double indexedFilter = nanosPer(std::chrono::steady_clock::now() - start,
+                                        LOOKUP_ROUNDS);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < LOOKUP_ROUNDS; ++round)
+        {
+            ASSERT_EQ(expected, scanByType(type.c_str()));
+        }
+        double scannedFilter = nanosPer(std::chrono::steady_clock::now() - start,
+                                        LOOKUP_ROUNDS);
+
+        std::cout << "resources=" << resourceCount
+                  << " uri lookup indexed=" << indexedLookup << "ns"
+                  << " scanned=" << scannedLookup << "ns"
+                  << " | rt= filter indexed=" << indexedFilter << "ns"
+                  << " scanned=" << scannedFilter << "ns" << std::endl;
+
+        ASSERT_EQ(OC_STACK_OK, OCStop());
+    }
+}
@@ -29,7 +29,13 @@ extern "C"
     #include "oic_string.h"
     #include "oic_time.h"
     #include "ocresourcehandler.h"
+    #include "ocresourceindex.h"
+    #include "ocdiscoverycache.h"
+    #include "ocpayloadcbor.h"
+    #include "ocserverrequest.h"
+    #include "occlientcb.h"
     #include "occollection.h"
+    #include "ocobserve.h"
     #include "mbedtls/ssl_ciphersuites.h"
     #include "octypes.h"
 #if defined (WITH_POSIX) && (defined (__WITH_DTLS__) || defined(__WITH_TLS__))
@@ -53,7 +59,12 @@ extern "C"
 #include <stdio.h>
 #include <string.h>
 
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 #include <stdint.h>
 
 #include "gtest_helper.h"
@@ -299,6 +310,60 @@ TEST(StackStart, StackStartSuccessiveInits)
     EXPECT_EQ(0u, g_ocStackStartCount);
 }
 
+TEST(StackProcessWait, NotInitialized)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    EXPECT_EQ(-1, OCGetProcessFd());
+    EXPECT_EQ(0u, OCGetProcessTimeout());
+    EXPECT_EQ(OC_STACK_ERROR, OCWaitForProcess(10));
+    EXPECT_EQ(OC_STACK_ERROR, OCProcessWait(10));
+}
+
+TEST(StackProcessWait, WakeProcess)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    EXPECT_EQ(OC_STACK_OK, OCInit("127.0.0.1", 5683, OC_CLIENT_SERVER));
+#ifdef __linux__
+    EXPECT_LE(0, OCGetProcessFd());
+#endif
+
+    // A pending wakeup ends an unbounded wait right away.
+    EXPECT_EQ(OC_STACK_OK, OCWakeProcess());
+    EXPECT_EQ(OC_STACK_OK, OCWaitForProcess(UINT32_MAX));
+    EXPECT_EQ(OC_STACK_OK, OCProcess());
+
+    // Woken up from another thread while waiting.
+    std::thread waker([]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        OCWakeProcess();
+    });
+    EXPECT_EQ(OC_STACK_OK, OCProcessWait(UINT32_MAX));
+    waker.join();
+
+    EXPECT_EQ(OC_STACK_TIMEOUT, OCWaitForProcess(0));
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+}
+
+TEST(StackProcessWait, TimeoutFollowsClientCallbackTTL)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    EXPECT_EQ(OC_STACK_OK, OCInit("127.0.0.1", 5683, OC_CLIENT));
+
+    OCCallbackData cbData = OCCallbackData();
+    cbData.cb = asyncDoResourcesCallback;
+    OCDoHandle handle = NULL;
+    EXPECT_EQ(OC_STACK_OK, OCDoResource(&handle, OC_REST_GET, OC_RSRVD_WELL_KNOWN_URI, NULL, NULL,
+                                        CT_ADAPTER_IP, OC_LOW_QOS, &cbData, NULL, 0));
+
+    uint32_t timeout = OCGetProcessTimeout();
+    EXPECT_LT(0u, timeout);
+    EXPECT_GE(static_cast<uint32_t>(MAX_CB_TIMEOUT_SECONDS * 1000), timeout);
+
+    EXPECT_EQ(OC_STACK_OK, OCCancel(handle, OC_LOW_QOS, NULL, 0));
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+}
+
 TEST(StackStart, SetPlatformInfoValid)
 {
     itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
@@ -960,6 +1025,385 @@ TEST(StackResource, CreateResourceFailDuplicateUri)
     EXPECT_EQ(OC_STACK_OK, OCStop());
 }
 
+TEST(StackResource, ResourceIndexFollowsCreateBindAndDelete)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    OIC_LOG(INFO, TAG, "Starting ResourceIndexFollowsCreateBindAndDelete test");
+    InitStack(OC_SERVER);
+
+    OCResourceHandle handle1;
+    EXPECT_EQ(OC_STACK_OK, OCCreateResource(&handle1, "core.led", "core.rw", "/a/led1",
+                                            0, NULL, OC_DISCOVERABLE|OC_OBSERVABLE));
+    OCResourceHandle handle2;
+    EXPECT_EQ(OC_STACK_OK, OCCreateResource(&handle2, "core.led", "core.rw", "/a/led2",
+                                            0, NULL, OC_DISCOVERABLE|OC_OBSERVABLE));
+    EXPECT_EQ(OC_STACK_OK, OCBindResourceTypeToResource(handle2, "core.brightled"));
+
+    EXPECT_EQ(handle1, (OCResourceHandle) FindResourceByUri("/a/led1"));
+    EXPECT_EQ(handle2, OCGetResourceHandleAtUri("/a/led2"));
+
+    OCResource * const *resources = NULL;
+    size_t count = 0;
+    ASSERT_TRUE(OCResourceIndexFindByType("core.led", &resources, &count));
+    ASSERT_EQ(2u, count);
+    EXPECT_EQ(handle1, (OCResourceHandle) resources[0]);
+    EXPECT_EQ(handle2, (OCResourceHandle) resources[1]);
+    ASSERT_TRUE(OCResourceIndexFindByType("core.brightled", &resources, &count));
+    ASSERT_EQ(1u, count);
+    EXPECT_EQ(handle2, (OCResourceHandle) resources[0]);
+    ASSERT_TRUE(OCResourceIndexFindByInterface("core.rw", &resources, &count));
+    EXPECT_EQ(2u, count);
+
+    EXPECT_EQ(OC_STACK_OK, OCDeleteResource(handle1));
+    EXPECT_TRUE(NULL == FindResourceByUri("/a/led1"));
+    EXPECT_FALSE(OCResourceIndexContains((OCResource *) handle1));
+    ASSERT_TRUE(OCResourceIndexFindByType("core.led", &resources, &count));
+    ASSERT_EQ(1u, count);
+    EXPECT_EQ(handle2, (OCResourceHandle) resources[0]);
+
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+}
+
+TEST(StackResource, DiscoveryCacheInvalidatedByResourceChanges)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    OIC_LOG(INFO, TAG, "Starting DiscoveryCacheInvalidatedByResourceChanges test");
+    InitStack(OC_SERVER);
+
+    int32_t generation = OCDiscoveryCacheGetGeneration();
+    OCResourceHandle handle;
+    EXPECT_EQ(OC_STACK_OK, OCCreateResource(&handle, "core.led", "core.rw", "/a/led",
+                                            0, NULL, OC_DISCOVERABLE|OC_OBSERVABLE));
+    EXPECT_NE(generation, OCDiscoveryCacheGetGeneration());
+
+    generation = OCDiscoveryCacheGetGeneration();
+    EXPECT_EQ(OC_STACK_OK, OCBindResourceTypeToResource(handle, "core.brightled"));
+    EXPECT_NE(generation, OCDiscoveryCacheGetGeneration());
+
+    generation = OCDiscoveryCacheGetGeneration();
+    EXPECT_EQ(OC_STACK_OK, OCBindResourceInterfaceToResource(handle, "core.r"));
+    EXPECT_NE(generation, OCDiscoveryCacheGetGeneration());
+
+    generation = OCDiscoveryCacheGetGeneration();
+    EXPECT_EQ(OC_STACK_OK, OCClearResourceProperties(handle, OC_DISCOVERABLE));
+    EXPECT_NE(generation, OCDiscoveryCacheGetGeneration());
+
+    generation = OCDiscoveryCacheGetGeneration();
+    EXPECT_EQ(OC_STACK_OK, OCSetResourceProperties(handle, OC_DISCOVERABLE));
+    EXPECT_NE(generation, OCDiscoveryCacheGetGeneration());
+
+    generation = OCDiscoveryCacheGetGeneration();
+    EXPECT_EQ(OC_STACK_OK, OCSetPropertyValue(PAYLOAD_TYPE_DEVICE, OC_RSRVD_DEVICE_NAME,
+                                              "discovery cache test"));
+    EXPECT_NE(generation, OCDiscoveryCacheGetGeneration());
+
+    generation = OCDiscoveryCacheGetGeneration();
+    uint8_t numResources = 0;
+    EXPECT_EQ(OC_STACK_OK, OCGetNumberOfResources(&numResources));
+    EXPECT_EQ(generation, OCDiscoveryCacheGetGeneration());
+
+    EXPECT_EQ(OC_STACK_OK, OCDeleteResource(handle));
+    EXPECT_NE(generation, OCDiscoveryCacheGetGeneration());
+
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+}
+
+static OCServerRequest *AddTestDiscoveryRequest(uint16_t messageId)
+{
+    OCDevAddr devAddr = {};
+    devAddr.adapter = OC_ADAPTER_IP;
+    devAddr.flags = OC_IP_USE_V4;
+    OICStrcpy(devAddr.addr, sizeof(devAddr.addr), "127.0.0.1");
+    devAddr.port = 5683;
+
+    char token[] = "discovery";
+    char url[] = OC_RSRVD_WELL_KNOWN_URI;
+    OCServerRequest *request = NULL;
+    EXPECT_EQ(OC_STACK_OK, AddServerRequest(&request, messageId, 0, 0, OC_REST_GET, 0,
+                                            OC_OBSERVE_NO_OPTION, OC_LOW_QOS, NULL, NULL,
+                                            OC_FORMAT_UNDEFINED, NULL, token,
+                                            (uint8_t)strlen(token), url, 0, OC_FORMAT_CBOR,
+                                            0, &devAddr));
+    return request;
+}
+
+static bool blockDataHandler(const OCBlockData * /*block*/, void * /*context*/)
+{
+    return false;
+}
+
+TEST(StackResource, RegisterBlockEntityHandler)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    OIC_LOG(INFO, TAG, "Starting RegisterBlockEntityHandler test");
+
+    EXPECT_EQ(OC_STACK_INVALID_PARAM, OCRegisterBlockEntityHandler(NULL, blockDataHandler));
+    EXPECT_EQ(OC_STACK_OK, OCRegisterBlockEntityHandler(entityHandler, blockDataHandler));
+    // Registering again replaces the block data handler.
+    EXPECT_EQ(OC_STACK_OK, OCRegisterBlockEntityHandler(entityHandler, blockDataHandler));
+    EXPECT_EQ(OC_STACK_OK, OCRegisterBlockEntityHandler(entityHandler, NULL));
+    // Removing a handler that is not registered is harmless.
+    EXPECT_EQ(OC_STACK_OK, OCRegisterBlockEntityHandler(entityHandler, NULL));
+}
+
+TEST(StackResource, RegisterEncodedHandlers)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    OIC_LOG(INFO, TAG, "Starting RegisterEncodedHandlers test");
+
+    EXPECT_EQ(OC_STACK_INVALID_PARAM, OCRegisterEncodedEntityHandler(NULL));
+    EXPECT_EQ(OC_STACK_INVALID_PARAM, OCUnregisterEncodedResponseHandler(NULL));
+
+    // Handlers may be registered before the stack is started.
+    EXPECT_EQ(OC_STACK_OK, OCRegisterEncodedEntityHandler(entityHandler));
+    EXPECT_EQ(OC_STACK_OK, OCRegisterEncodedResponseHandler(asyncDoResourcesCallback));
+    EXPECT_EQ(OC_STACK_OK, OCRegisterEncodedResponseHandler(discoveryCallback));
+    EXPECT_TRUE(OCIsEncodedEntityHandler(entityHandler));
+    EXPECT_TRUE(OCIsEncodedResponseHandler(asyncDoResourcesCallback));
+
+    // Removing one keeps the others.
+    EXPECT_EQ(OC_STACK_OK, OCUnregisterEncodedResponseHandler(asyncDoResourcesCallback));
+    EXPECT_FALSE(OCIsEncodedResponseHandler(asyncDoResourcesCallback));
+    EXPECT_TRUE(OCIsEncodedResponseHandler(discoveryCallback));
+    EXPECT_EQ(OC_STACK_OK, OCUnregisterEncodedResponseHandler(asyncDoResourcesCallback));
+
+    // Stopping the stack forgets the registrations.
+    InitStack(OC_SERVER);
+    EXPECT_TRUE(OCIsEncodedEntityHandler(entityHandler));
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+    EXPECT_FALSE(OCIsEncodedEntityHandler(entityHandler));
+    EXPECT_FALSE(OCIsEncodedResponseHandler(discoveryCallback));
+}
+
+TEST(StackResource, DiscoveryCacheKeepsEncodedPayload)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    OIC_LOG(INFO, TAG, "Starting DiscoveryCacheKeepsEncodedPayload test");
+    InitStack(OC_SERVER);
+
+    OCDiscoveryCacheKey key = { OC_WELL_KNOWN_URI, OC_RSRVD_INTERFACE_LL, NULL };
+    OCRepPayload *payload = OCRepPayloadCreate();
+    ASSERT_TRUE(payload != NULL);
+    EXPECT_TRUE(OCRepPayloadSetPropString(payload, "name", "discovery cache test"));
+
+    uint8_t *expected = NULL;
+    size_t expectedSize = 0;
+    ASSERT_EQ(OC_STACK_OK, OCConvertPayload((OCPayload *)payload, OC_FORMAT_CBOR,
+                                            &expected, &expectedSize));
+
+    OCServerRequest *request = AddTestDiscoveryRequest(1);
+    ASSERT_TRUE(request != NULL);
+    int32_t generation = OCDiscoveryCacheGetGeneration();
+    OCDiscoveryCacheSendAndStore(request, &key, generation, (OCPayload *)payload);
+
+    OCNotificationCache copy;
+    request = AddTestDiscoveryRequest(2);
+    ASSERT_TRUE(request != NULL);
+    ASSERT_TRUE(OCDiscoveryCacheCopy(request, &key, &copy));
+    EXPECT_EQ(PAYLOAD_TYPE_REPRESENTATION, copy.payloadType);
+    ASSERT_EQ(expectedSize, copy.payloadSize);
+    EXPECT_EQ(0, memcmp(expected, copy.payload, expectedSize));
+    ClearNotificationCache(&copy);
+
+    // Another filter is another entry.
+    OCDiscoveryCacheKey otherKey = { OC_WELL_KNOWN_URI, OC_RSRVD_INTERFACE_DEFAULT, NULL };
+    EXPECT_FALSE(OCDiscoveryCacheCopy(request, &otherKey, &copy));
+
+    OCDiscoveryCacheInvalidate();
+    EXPECT_FALSE(OCDiscoveryCacheCopy(request, &key, &copy));
+    DeleteServerRequest(request);
+
+    OICFree(expected);
+    OCRepPayloadDestroy(payload);
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+}
+
+static ClientCB *AddTestClientCB(const char *token, uint8_t tokenLength, OCMethod method,
+                                 uint32_t ttl)
+{
+    OCCallbackData cbData = { NULL, NULL, NULL };
+    CAToken_t tokenCopy = (CAToken_t) OICMalloc(tokenLength);
+    memcpy(tokenCopy, token, tokenLength);
+    OCDoHandle handle = (OCDoHandle) OICMalloc(1);
+    ClientCB *cbNode = NULL;
+    EXPECT_EQ(OC_STACK_OK, AddClientCB(&cbNode, &cbData, CA_MSG_NONCONFIRM, tokenCopy,
+                                       tokenLength, NULL, 0, NULL, 0, CA_FORMAT_UNDEFINED,
+                                       &handle, method, NULL, OICStrdup("/a/light"), NULL,
+                                       ttl));
+    return cbNode;
+}
+
+TEST(StackClientCB, LookupByTokenHandleAndTimeout)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    OIC_LOG(INFO, TAG, "Starting LookupByTokenHandleAndTimeout test");
+    InitStack(OC_CLIENT);
+
+    char token[] = "0123456789";
+    char observeToken[] = "abcdefgh";
+    ClientCB *shortToken = AddTestClientCB(token, 4, OC_REST_GET, 0);
+    ClientCB *longToken = AddTestClientCB(token, 8, OC_REST_GET, 1);
+    ClientCB *observe = AddTestClientCB(observeToken, 8, OC_REST_OBSERVE, 1);
+    ASSERT_TRUE(NULL != shortToken);
+    ASSERT_TRUE(NULL != longToken);
+    ASSERT_TRUE(NULL != observe);
+
+    // Tokens that share a prefix must not be confused with each other.
+    EXPECT_EQ(shortToken, GetClientCBUsingToken(token, 4));
+    EXPECT_EQ(longToken, GetClientCBUsingToken(token, 8));
+    EXPECT_TRUE(NULL == GetClientCBUsingToken(token, 6));
+    EXPECT_EQ(observe, GetClientCBUsingHandle(observe->handle));
+
+    // Only the node with a TTL in the past expires; TTL 0 never does.
+    DeleteTimedOutClientCBs();
+    EXPECT_TRUE(NULL == GetClientCBUsingToken(token, 8));
+    EXPECT_EQ(shortToken, GetClientCBUsingToken(token, 4));
+    EXPECT_EQ(observe, GetClientCBUsingToken(observeToken, 8));
+
+    SetClientCBTimeout(observe, 1);
+    DeleteTimedOutClientCBs();
+    EXPECT_TRUE(NULL == GetClientCBUsingToken(observeToken, 8));
+
+    DeleteClientCB(shortToken);
+    EXPECT_TRUE(NULL == GetClientCBUsingToken(token, 4));
+
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+}
+
+TEST(StackObserve, ObserversFoundByIdBeyond255)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    OIC_LOG(INFO, TAG, "Starting ObserversFoundByIdBeyond255 test");
+    InitStack(OC_SERVER);
+
+    OCResourceHandle handle;
+    ASSERT_EQ(OC_STACK_OK, OCCreateResource(&handle, "core.led", "core.rw", "/a/led",
+                                            0, NULL, OC_DISCOVERABLE|OC_OBSERVABLE));
+    OCResource *resource = (OCResource *) handle;
+
+    const uint32_t observers = 1000;
+    OCDevAddr devAddr = OCDevAddr();
+    std::vector<OCObservationId> ids;
+    std::set<OCObservationId> uniqueIds;
+    for (uint32_t i = 0; i < observers; i++)
+    {
+        OCObservationId id = 0;
+        ASSERT_EQ(OC_STACK_OK, GenerateObserverId(&id));
+        char token[sizeof(i)];
+        memcpy(token, &i, sizeof(i));
+        ASSERT_EQ(OC_STACK_OK, AddObserver("/a/led", NULL, id, token, sizeof(token), resource,
+                                           OC_LOW_QOS, OC_FORMAT_CBOR, 0, &devAddr));
+        ids.push_back(id);
+        uniqueIds.insert(id);
+    }
+    EXPECT_EQ(observers, uniqueIds.size());
+
+    // The first IDs still fit the 8 bit IDs of older bindings.
+    for (size_t i = 0; i < 100; i++)
+    {
+        EXPECT_GT(256u, ids[i]);
+    }
+
+    for (uint32_t i = 0; i < observers; i++)
+    {
+        ResourceObserver *observer = GetObserverUsingId(resource, ids[i]);
+        ASSERT_TRUE(NULL != observer);
+        EXPECT_EQ(ids[i], observer->observeId);
+    }
+
+    for (uint32_t i = 0; i < observers; i += 2)
+    {
+        char token[sizeof(i)];
+        memcpy(token, &i, sizeof(i));
+        EXPECT_EQ(OC_STACK_OK, DeleteObserverUsingToken(resource, token, sizeof(token)));
+    }
+    for (uint32_t i = 0; i < observers; i++)
+    {
+        EXPECT_EQ(0 != (i % 2), NULL != GetObserverUsingId(resource, ids[i]));
+    }
+    EXPECT_EQ(observers / 2, resource->observersById.count);
+
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+}
+
+// Stands in for the lock the C++ stack takes around the C stack calls.
+static std::recursive_mutex g_notifyAppLock;
+static std::promise<void> *g_notifyHandlerEntered = NULL;
+
+static OCEntityHandlerResult NotifyingEntityHandler(OCEntityHandlerFlag flag,
+        OCEntityHandlerRequest *request, void *ctx)
+{
+    OC_UNUSED(ctx);
+    if (!(flag & OC_REQUEST_FLAG) || !request)
+    {
+        return OC_EH_OK;
+    }
+    if (g_notifyHandlerEntered)
+    {
+        g_notifyHandlerEntered->set_value();
+        g_notifyHandlerEntered = NULL;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(g_notifyAppLock);
+    OCEntityHandlerResponse response;
+    memset(&response, 0, sizeof(response));
+    response.requestHandle = request->requestHandle;
+    response.ehResult = OC_EH_OK;
+    response.payload = (OCPayload*) OCRepPayloadCreate();
+    OCDoResponse(&response);
+    OCRepPayloadDestroy((OCRepPayload*) response.payload);
+    return OC_EH_OK;
+}
+
+TEST(StackObserve, NotifyObserversWithoutObserverLock)
+{
+    itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
+    OIC_LOG(INFO, TAG, "Starting NotifyObserversWithoutObserverLock test");
+    InitStack(OC_SERVER);
+
+    OCResourceHandle handle;
+    ASSERT_EQ(OC_STACK_OK, OCCreateResource(&handle, "core.led", "core.rw", "/a/led",
+                                            NotifyingEntityHandler, NULL,
+                                            OC_DISCOVERABLE|OC_OBSERVABLE));
+    OCResource *resource = (OCResource *) handle;
+
+    OCDevAddr devAddr = OCDevAddr();
+    devAddr.adapter = OC_ADAPTER_IP;
+    devAddr.flags = OC_IP_USE_V4;
+    OICStrcpy(devAddr.addr, sizeof(devAddr.addr), "127.0.0.1");
+    devAddr.port = 5683;
+    OCObservationId id = 0;
+    ASSERT_EQ(OC_STACK_OK, GenerateObserverId(&id));
+    char token[] = { 1, 2, 3, 4 };
+    ASSERT_EQ(OC_STACK_OK, AddObserver("/a/led", NULL, id, token, sizeof(token), resource,
+                                       OC_LOW_QOS, OC_FORMAT_CBOR, 0, &devAddr));
+
+    // The handler runs on another thread and waits for the application lock held here,
+    // while this thread keeps processing and registering observers.
+    std::promise<void> entered;
+    g_notifyHandlerEntered = &entered;
+    g_notifyAppLock.lock();
+    std::thread notifier([handle]()
+    {
+        OCNotifyAllObservers(handle, OC_NA_QOS);
+    });
+    entered.get_future().wait();
+
+    EXPECT_EQ(OC_STACK_OK, OCProcess());
+    OCObservationId otherId = 0;
+    EXPECT_EQ(OC_STACK_OK, GenerateObserverId(&otherId));
+    char otherToken[] = { 5, 6, 7, 8 };
+    EXPECT_EQ(OC_STACK_OK, AddObserver("/a/led", NULL, otherId, otherToken, sizeof(otherToken),
+                                       resource, OC_LOW_QOS, OC_FORMAT_CBOR, 0, &devAddr));
+    EXPECT_EQ(OC_STACK_OK, DeleteObserverUsingToken(resource, token, sizeof(token)));
+    EXPECT_TRUE(NULL == GetObserverUsingId(resource, id));
+
+    g_notifyAppLock.unlock();
+    notifier.join();
+
+    EXPECT_EQ(OC_STACK_OK, OCStop());
+}
+
 TEST(StackResource, CreateResourceMultipleResources)
 {
     itst::DeadmanTimer killSwitch(SHORT_TEST_TIMEOUT);
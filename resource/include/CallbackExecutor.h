@@ -0,0 +1,90 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+/**
+ * @file
+ *
+ * This file contains the executor the client wrapper hands application callbacks to.
+ */
+
+#ifndef OC_CALLBACK_EXECUTOR_H_
+#define OC_CALLBACK_EXECUTOR_H_
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <OCApi.h>
+
+namespace OC
+{
+    /**
+     * Runs application callbacks in the way chosen by PlatformConfig::callbackExecution.
+     * Destroying the executor runs every callback that was already posted.
+     */
+    class CallbackExecutor
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        CallbackExecutor(CallbackExecution mode, size_t threadCount);
+        ~CallbackExecutor();
+
+        CallbackExecutor(const CallbackExecutor&) = delete;
+        CallbackExecutor& operator=(const CallbackExecutor&) = delete;
+
+        /**
+         * Run a callback, in no particular order with respect to other callbacks.
+         */
+        void post(Task task);
+
+        /**
+         * Run a callback after every callback posted earlier for the same strand has returned.
+         * Only the SerialStrands mode keeps that order; the other modes behave like post(task).
+         *
+         * @param strand    Key of the strand, such as the context of an observation.
+         * @param task      Callback to run.
+         */
+        void post(const void* strand, Task task);
+
+        CallbackExecution mode() const
+        {
+            return m_mode;
+        }
+
+    private:
+        struct State;
+
+        static void invoke(const Task& task);
+        static void scheduleStrand(const std::shared_ptr<State>& state, const void* strand);
+        static void runStrand(const std::shared_ptr<State>& state, const void* strand);
+        static void workerLoop(std::shared_ptr<State> state);
+
+        const CallbackExecution m_mode;
+
+        // Shared with the workers, so that a worker that ends up destroying the executor
+        // from inside a callback can still leave its loop safely.
+        std::shared_ptr<State> m_state;
+        std::vector<std::thread> m_workers;
+    };
+}
+
+#endif // OC_CALLBACK_EXECUTOR_H_
@@ -131,6 +131,31 @@ namespace OC
         NaQos       = OC_NA_QOS
     };
 
+    /**
+     * How the client wrapper runs application callbacks for discovery results, responses and
+     * observe notifications.
+     */
+    enum class CallbackExecution
+    {
+        /** Start a detached thread for every callback. */
+        ThreadPerCallback,
+
+        /** Run callbacks on the thread that processes the stack, one at a time. */
+        Inline,
+
+        /** Run callbacks on a fixed number of worker threads, in no particular order. */
+        WorkerPool,
+
+        /**
+         * Run callbacks on a fixed number of worker threads. Notifications of one observation
+         * run one at a time and in the order they arrived.
+         */
+        SerialStrands
+    };
+
+    /** Number of worker threads used by the pooled callback execution modes. */
+    const size_t DEFAULT_CALLBACK_THREAD_COUNT = 4;
+
     /**
      *  Data structure to provide the configuration.
      */
@@ -175,6 +200,12 @@ namespace OC
          */
         bool                       useLegacyCleanup;
 
+        /** how client callbacks are run. Defaults to a thread per callback. */
+        CallbackExecution          callbackExecution;
+
+        /** worker threads used when callbacks run on a pool. */
+        size_t                     callbackThreadCount;
+
         public:
             PlatformConfig(const ServiceType serviceType_,
             const ModeType mode_,
@@ -188,7 +219,9 @@ namespace OC
                 port(0),
                 QoS(QualityOfService::NaQos),
                 ps(ps_),
-                useLegacyCleanup(false)
+                useLegacyCleanup(false),
+                callbackExecution(CallbackExecution::ThreadPerCallback),
+                callbackThreadCount(DEFAULT_CALLBACK_THREAD_COUNT)
         {}
             /* @deprecated: Use a non deprecated constructor. */
             PlatformConfig()
@@ -201,7 +234,9 @@ namespace OC
                 port(0),
                 QoS(QualityOfService::NaQos),
                 ps(nullptr),
-                useLegacyCleanup(true)
+                useLegacyCleanup(true),
+                callbackExecution(CallbackExecution::ThreadPerCallback),
+                callbackThreadCount(DEFAULT_CALLBACK_THREAD_COUNT)
         {}
             /* @deprecated: Use a non deprecated constructor. */
             PlatformConfig(const ServiceType serviceType_,
@@ -219,7 +254,9 @@ namespace OC
                 port(0),
                 QoS(QoS_),
                 ps(ps_),
-                useLegacyCleanup(true)
+                useLegacyCleanup(true),
+                callbackExecution(CallbackExecution::ThreadPerCallback),
+                callbackThreadCount(DEFAULT_CALLBACK_THREAD_COUNT)
         {}
             /* @deprecated: Use a non deprecated constructor. */
             PlatformConfig(const ServiceType serviceType_,
@@ -237,7 +274,9 @@ namespace OC
                 port(port_),
                 QoS(QoS_),
                 ps(ps_),
-                useLegacyCleanup(true)
+                useLegacyCleanup(true),
+                callbackExecution(CallbackExecution::ThreadPerCallback),
+                callbackThreadCount(DEFAULT_CALLBACK_THREAD_COUNT)
         {}
             /* @deprecated: Use a non deprecated constructor. */
             PlatformConfig(const ServiceType serviceType_,
@@ -255,7 +294,10 @@ namespace OC
                 ipAddress(ipAddress_),
                 port(port_),
                 QoS(QoS_),
-                ps(ps_)
+                ps(ps_),
+                useLegacyCleanup(true),
+                callbackExecution(CallbackExecution::ThreadPerCallback),
+                callbackThreadCount(DEFAULT_CALLBACK_THREAD_COUNT)
         {}
             PlatformConfig(const ServiceType serviceType_,
             const ModeType mode_,
@@ -271,7 +313,9 @@ namespace OC
                 port(0),
                 QoS(QoS_),
                 ps(ps_),
-                useLegacyCleanup(true)
+                useLegacyCleanup(true),
+                callbackExecution(CallbackExecution::ThreadPerCallback),
+                callbackThreadCount(DEFAULT_CALLBACK_THREAD_COUNT)
         {}
             /* @deprecated: Use a non deprecated constructor. */
             PlatformConfig(const ServiceType serviceType_,
@@ -290,7 +334,9 @@ namespace OC
                 port(0),
                 QoS(QoS_),
                 ps(ps_),
-                useLegacyCleanup(true)
+                useLegacyCleanup(true),
+                callbackExecution(CallbackExecution::ThreadPerCallback),
+                callbackThreadCount(DEFAULT_CALLBACK_THREAD_COUNT)
         {}
 
     };
@@ -65,6 +65,10 @@ namespace OC
 
             OCRepPayload* getPayload() const;
 
+            void setPayload(const OCEncodedPayload* payload);
+
+            OCEncodedPayload* getEncodedPayload() const;
+
             const std::vector<OCRepresentation>& representations() const;
 
             void addRepresentation(const OCRepresentation& rep);
@@ -435,6 +439,7 @@ namespace OC
         private:
             friend class OCResourceResponse;
             friend class MessageContainer;
+            friend class OCRepresentationCodecAccess;
 
             template<typename T>
             void payload_array_helper(const OCRepPayloadValue* pl, size_t depth);
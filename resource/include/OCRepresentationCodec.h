@@ -0,0 +1,80 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+/**
+ * @file
+ *
+ * This file contains the codec that converts OCRepresentation to and from CBOR without
+ * going through an OCRepPayload.
+ */
+
+#ifndef OC_REPRESENTATION_CODEC_H_
+#define OC_REPRESENTATION_CODEC_H_
+
+#include <vector>
+
+#include <octypes.h>
+#include <OCRepresentation.h>
+
+namespace OC
+{
+    /**
+     * Encodes and decodes representations the way OCConvertPayload and OCParsePayload do for
+     * an OCRepPayload, so both ends of a connection can use either path.
+     */
+    class OCRepresentationCodec
+    {
+    public:
+        /**
+         * Encode a representation and its children.  The children follow the root in a CBOR
+         * array, as MessageContainer::getPayload() would link them.
+         *
+         * @param root      First representation.
+         * @param children  Representations that follow the first one.
+         *
+         * @return Payload owning the CBOR.  Throws OCException if encoding fails.
+         */
+        static OCEncodedPayload* encode(const OCRepresentation& root,
+                                        const std::vector<OCRepresentation>& children);
+
+        /**
+         * Encode a list of representations, the first one being the root.
+         *
+         * @return Payload owning the CBOR, or nullptr for an empty list.
+         */
+        static OCEncodedPayload* encode(const std::vector<OCRepresentation>& reps);
+
+        /**
+         * Decode CBOR into representations, appending them to reps.
+         *
+         * Only the common shapes are decoded here.  Anything the C parser treats in a special
+         * way (arrays of mixed types, arrays of byte strings, malformed input) makes this
+         * return false without touching reps, and the caller falls back to OCEncodedPayloadParse.
+         *
+         * @return true if the CBOR was decoded.
+         */
+        static bool decode(const uint8_t* data, size_t size, std::vector<OCRepresentation>& reps);
+
+    private:
+        static OCEncodedPayload* encode(const OCRepresentation* const* reps, size_t count);
+    };
+}
+
+#endif // OC_REPRESENTATION_CODEC_H_
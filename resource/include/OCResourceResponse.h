@@ -32,6 +32,7 @@
 #include <IServerWrapper.h>
 #include <ocstack.h>
 #include <OCRepresentation.h>
+#include <OCRepresentationCodec.h>
 
 namespace OC
 {
@@ -232,6 +233,13 @@ namespace OC
 
             return inf.getPayload();
         }
+
+        // The interface type does not change what is encoded, so this skips the copies above.
+        OCEncodedPayload* getEncodedPayload() const
+        {
+            return OCRepresentationCodec::encode(m_representation,
+                                                 m_representation.getChildren());
+        }
     public:
 
         /**
@@ -0,0 +1,191 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include "CallbackExecutor.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace OC
+{
+    struct CallbackExecutor::State
+    {
+        std::mutex mutex;
+        std::condition_variable cond;
+
+        /** Callbacks and strand runners waiting for a worker. */
+        std::deque<Task> queue;
+
+        /**
+         * Callbacks of every strand that has work, oldest first. A strand is in the map
+         * exactly while one runner for it is queued or running.
+         */
+        std::unordered_map<const void*, std::deque<Task>> strands;
+
+        bool stopping = false;
+    };
+
+    void CallbackExecutor::invoke(const Task& task)
+    {
+        try
+        {
+            task();
+        }
+        catch (std::exception& e)
+        {
+            oclog() << "Exception in client callback: " << e.what() << std::flush;
+        }
+    }
+
+    void CallbackExecutor::scheduleStrand(const std::shared_ptr<State>& state, const void* strand)
+    {
+        state->queue.push_back([state, strand]() { runStrand(state, strand); });
+        state->cond.notify_one();
+    }
+
+    void CallbackExecutor::runStrand(const std::shared_ptr<State>& state, const void* strand)
+    {
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            task = state->strands[strand].front();
+        }
+
+        invoke(task);
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto it = state->strands.find(strand);
+        it->second.pop_front();
+        if (it->second.empty())
+        {
+            state->strands.erase(it);
+        }
+        else
+        {
+            // Requeue rather than drain, so one busy strand cannot hold a worker.
+            scheduleStrand(state, strand);
+        }
+    }
+
+    void CallbackExecutor::workerLoop(std::shared_ptr<State> state)
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        for (;;)
+        {
+            state->cond.wait(lock, [&state]()
+                    {
+                        return state->stopping || !state->queue.empty();
+                    });
+            if (state->queue.empty())
+            {
+                return;
+            }
+
+            Task task = std::move(state->queue.front());
+            state->queue.pop_front();
+
+            lock.unlock();
+            invoke(task);
+            lock.lock();
+        }
+    }
+
+    CallbackExecutor::CallbackExecutor(CallbackExecution mode, size_t threadCount)
+        : m_mode(mode), m_state(std::make_shared<State>())
+    {
+        if (m_mode != CallbackExecution::WorkerPool && m_mode != CallbackExecution::SerialStrands)
+        {
+            return;
+        }
+
+        if (0 == threadCount)
+        {
+            threadCount = 1;
+        }
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            m_workers.push_back(std::thread(workerLoop, m_state));
+        }
+    }
+
+    CallbackExecutor::~CallbackExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            m_state->stopping = true;
+        }
+        m_state->cond.notify_all();
+
+        for (std::thread& worker : m_workers)
+        {
+            if (worker.get_id() == std::this_thread::get_id())
+            {
+                // The last reference went away inside a callback; that worker finishes
+                // the queue on its own.
+                worker.detach();
+            }
+            else
+            {
+                worker.join();
+            }
+        }
+    }
+
+    void CallbackExecutor::post(Task task)
+    {
+        switch (m_mode)
+        {
+            case CallbackExecution::Inline:
+                invoke(task);
+                break;
+            case CallbackExecution::WorkerPool:
+            case CallbackExecution::SerialStrands:
+                {
+                    std::lock_guard<std::mutex> lock(m_state->mutex);
+                    m_state->queue.push_back(std::move(task));
+                }
+                m_state->cond.notify_one();
+                break;
+            case CallbackExecution::ThreadPerCallback:
+            default:
+                std::thread(task).detach();
+                break;
+        }
+    }
+
+    void CallbackExecutor::post(const void* strand, Task task)
+    {
+        if (m_mode != CallbackExecution::SerialStrands)
+        {
+            post(std::move(task));
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        std::deque<Task>& pending = m_state->strands[strand];
+        pending.push_back(std::move(task));
+        if (1 == pending.size())
+        {
+            scheduleStrand(m_state, strand);
+        }
+    }
+}
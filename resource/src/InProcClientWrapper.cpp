@@ -26,6 +26,7 @@
 #include "OCPlatform.h"
 #include "OCResource.h"
 #include "ocpayload.h"
+#include "OCRepresentationCodec.h"
 #include <OCSerialization.h>
 #include "experimental/logger.h"
 
@@ -35,10 +36,21 @@ using namespace std;
 
 namespace OC
 {
+    OCStackApplicationResult listenDeviceCallback(void* ctx, OCDoHandle handle,
+                                                  OCClientResponse* clientResponse);
+    OCStackApplicationResult getResourceCallback(void* ctx, OCDoHandle handle,
+                                                 OCClientResponse* clientResponse);
+    OCStackApplicationResult setResourceCallback(void* ctx, OCDoHandle handle,
+                                                 OCClientResponse* clientResponse);
+    OCStackApplicationResult observeResourceCallback(void* ctx, OCDoHandle handle,
+                                                     OCClientResponse* clientResponse);
+
     InProcClientWrapper::InProcClientWrapper(
         std::weak_ptr<std::recursive_mutex> csdkLock, PlatformConfig cfg)
             : m_threadRun(false), m_csdkLock(csdkLock),
-              m_cfg { cfg }
+              m_cfg { cfg },
+              m_executor(std::make_shared<CallbackExecutor>(cfg.callbackExecution,
+                                                            cfg.callbackThreadCount))
     {
         // if the config type is server, we ought to never get called.  If the config type
         // is both, we count on the server to run the thread and do the initialize
@@ -55,12 +67,24 @@ namespace OC
         {
             oclog() << "Exception in stop"<< e.what() << std::flush;
         }
+
+        OCUnregisterEncodedResponseHandler(listenDeviceCallback);
+        OCUnregisterEncodedResponseHandler(getResourceCallback);
+        OCUnregisterEncodedResponseHandler(setResourceCallback);
+        OCUnregisterEncodedResponseHandler(observeResourceCallback);
     }
 
     OCStackResult InProcClientWrapper::start()
     {
         OIC_LOG(INFO, TAG, "start");
 
+        // These callbacks decode representations straight from the CBOR of the response.
+        // OCStop() forgets them, so they are registered each time the stack is started.
+        OCRegisterEncodedResponseHandler(listenDeviceCallback);
+        OCRegisterEncodedResponseHandler(getResourceCallback);
+        OCRegisterEncodedResponseHandler(setResourceCallback);
+        OCRegisterEncodedResponseHandler(observeResourceCallback);
+
         if (m_cfg.mode == ModeType::Client)
         {
             if (false == m_threadRun)
@@ -79,6 +103,7 @@ namespace OC
         if (m_threadRun && m_listeningThread.joinable())
         {
             m_threadRun = false;
+            OCWakeProcess();
             m_listeningThread.join();
         }
         return OC_STACK_OK;
@@ -89,11 +114,13 @@ namespace OC
         while(m_threadRun)
         {
             OCStackResult result;
+            uint32_t timeout = 0;
             auto cLock = m_csdkLock.lock();
             if (cLock)
             {
                 std::lock_guard<std::recursive_mutex> lock(*cLock);
                 result = OCProcess();
+                timeout = OCGetProcessTimeout();
             }
             else
             {
@@ -105,8 +132,12 @@ namespace OC
                 // TODO: do something with result if failed?
             }
 
-            // To minimize CPU utilization we may wish to do this with sleep
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            // Sleep until the stack has work; wait without the lock so requests can be sent.
+            // OCProcess() consumes wakeups, so look at the stop flag again first.
+            if (m_threadRun && OC_STACK_ERROR == OCWaitForProcess(timeout))
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
         }
     }
 
@@ -114,7 +145,8 @@ namespace OC
     {
         if (clientResponse->payload == nullptr ||
                 (
-                    clientResponse->payload->type != PAYLOAD_TYPE_REPRESENTATION
+                    clientResponse->payload->type != PAYLOAD_TYPE_REPRESENTATION &&
+                    clientResponse->payload->type != PAYLOAD_TYPE_ENCODED
                 )
           )
         {
@@ -215,8 +247,7 @@ namespace OC
 
             for(auto resource : container.Resources())
             {
-                std::thread exec(context->callback, resource);
-                exec.detach();
+                context->executor->post(std::bind(context->callback, resource));
             }
         }
         catch (std::exception &e)
@@ -267,16 +298,14 @@ namespace OC
             // loop to ensure valid construction of all resources
             for (auto resource : container.Resources())
             {
-                std::thread exec(context->callback, resource);
-                exec.detach();
+                context->executor->post(std::bind(context->callback, resource));
             }
             return OC_STACK_KEEP_TRANSACTION;
         }
 
         OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
         std::string resourceURI = clientResponse->resourceUri;
-        std::thread exec(context->errorCallback, resourceURI, result);
-        exec.detach();
+        context->executor->post(std::bind(context->errorCallback, resourceURI, result));
         return OC_STACK_KEEP_TRANSACTION;
     }
 
@@ -296,7 +325,7 @@ namespace OC
         resourceUri << serviceUrl << resourceType;
 
         ClientCallbackContext::ListenContext* context =
-            new ClientCallbackContext::ListenContext(callback, shared_from_this());
+            new ClientCallbackContext::ListenContext(callback, shared_from_this(), m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(context),
         cbdata.cb      = listenCallback;
@@ -338,7 +367,7 @@ namespace OC
 
         ClientCallbackContext::ListenErrorContext* context =
             new ClientCallbackContext::ListenErrorContext(callback, errorCallback,
-                                                          shared_from_this());
+                                                          shared_from_this(), m_executor);
         if (!context)
         {
             return OC_STACK_ERROR;
@@ -415,8 +444,7 @@ namespace OC
                     reinterpret_cast< OCDiscoveryPayload* >(clientResponse->payload));
 
             OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
-            std::thread exec(context->callback, container.Resources());
-            exec.detach();
+            context->executor->post(std::bind(context->callback, container.Resources()));
         }
         catch (std::exception &e)
         {
@@ -443,7 +471,8 @@ namespace OC
         resourceUri << serviceUrl << resourceType;
 
         ClientCallbackContext::ListenResListContext* context =
-            new ClientCallbackContext::ListenResListContext(callback, shared_from_this());
+            new ClientCallbackContext::ListenResListContext(callback, shared_from_this(),
+                                                            m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(context),
         cbdata.cb      = listenResListCallback;
@@ -487,8 +516,7 @@ namespace OC
 
             //send the error callback
             std::string uri = clientResponse->resourceUri;
-            std::thread exec(context->errorCallback, uri, result);
-            exec.detach();
+            context->executor->post(std::bind(context->errorCallback, uri, result));
             return OC_STACK_KEEP_TRANSACTION;
         }
 
@@ -517,8 +545,7 @@ namespace OC
                     reinterpret_cast< OCDiscoveryPayload* >(clientResponse->payload));
 
             OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
-            std::thread exec(context->callback, container.Resources());
-            exec.detach();
+            context->executor->post(std::bind(context->callback, container.Resources()));
         }
         catch (std::exception &e)
         {
@@ -547,7 +574,7 @@ namespace OC
 
         ClientCallbackContext::ListenResListWithErrorContext* context =
             new ClientCallbackContext::ListenResListWithErrorContext(callback, errorCallback,
-                                                          shared_from_this());
+                                                          shared_from_this(), m_executor);
         if (!context)
         {
             return OC_STACK_ERROR;
@@ -596,9 +623,8 @@ namespace OC
                     << clientResponse->result
                     << std::flush;
 
-            std::thread exec(context->callback, clientResponse->result,
-                             resourceURI, nullptr);
-            exec.detach();
+            context->executor->post(std::bind(context->callback, clientResponse->result,
+                                              resourceURI, nullptr));
 
             return OC_STACK_DELETE_TRANSACTION;
         }
@@ -619,9 +645,8 @@ namespace OC
             // loop to ensure valid construction of all resources
             for (auto resource : container.Resources())
             {
-                std::thread exec(context->callback, clientResponse->result,
-                                 resourceURI, resource);
-                exec.detach();
+                context->executor->post(std::bind(context->callback, clientResponse->result,
+                                                  resourceURI, resource));
             }
         }
         catch (std::exception &e)
@@ -648,7 +673,7 @@ namespace OC
         }
 
         ClientCallbackContext::MQTopicContext* context =
-            new ClientCallbackContext::MQTopicContext(callback, shared_from_this());
+            new ClientCallbackContext::MQTopicContext(callback, shared_from_this(), m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(context),
         cbdata.cb      = listenMQCallback;
@@ -692,8 +717,7 @@ namespace OC
         {
             OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
             OCRepresentation rep = parseGetSetCallback(clientResponse);
-            std::thread exec(context->callback, rep);
-            exec.detach();
+            context->executor->post(std::bind(context->callback, rep));
         }
         catch(OC::OCException& e)
         {
@@ -720,7 +744,8 @@ namespace OC
         deviceUri << serviceUrl << deviceURI;
 
         ClientCallbackContext::DeviceListenContext* context =
-            new ClientCallbackContext::DeviceListenContext(callback, shared_from_this());
+            new ClientCallbackContext::DeviceListenContext(callback, shared_from_this(),
+                                                           m_executor);
         OCCallbackData cbdata;
 
         cbdata.context = static_cast<void*>(context),
@@ -804,19 +829,17 @@ namespace OC
                                             createdUri);
                 for (auto resource : container.Resources())
                 {
-                    std::thread exec(context->callback, result,
-                                     createdUri,
-                                     resource);
-                    exec.detach();
+                    context->executor->post(std::bind(context->callback, result,
+                                                      createdUri,
+                                                      resource));
                 }
             }
             else
             {
                 OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
-                std::thread exec(context->callback, result,
-                                 createdUri,
-                                 nullptr);
-                exec.detach();
+                context->executor->post(std::bind(context->callback, result,
+                                                  createdUri,
+                                                  nullptr));
             }
         }
         catch (std::exception &e)
@@ -840,7 +863,7 @@ namespace OC
         }
         OCStackResult result;
         ClientCallbackContext::MQTopicContext* ctx =
-                new ClientCallbackContext::MQTopicContext(callback, shared_from_this());
+                new ClientCallbackContext::MQTopicContext(callback, shared_from_this(), m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(ctx),
         cbdata.cb      = createMQTopicCallback;
@@ -894,8 +917,7 @@ namespace OC
         }
 
         OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
-        std::thread exec(context->callback, serverHeaderOptions, rep, result);
-        exec.detach();
+        context->executor->post(std::bind(context->callback, serverHeaderOptions, rep, result));
         return OC_STACK_DELETE_TRANSACTION;
     }
 
@@ -913,7 +935,7 @@ namespace OC
 
         OCStackResult result;
         ClientCallbackContext::GetContext* ctx =
-            new ClientCallbackContext::GetContext(callback);
+            new ClientCallbackContext::GetContext(callback, m_executor);
 
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(ctx);
@@ -970,8 +992,7 @@ namespace OC
         }
 
         OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
-        std::thread exec(context->callback, serverHeaderOptions, attrs, result);
-        exec.detach();
+        context->executor->post(std::bind(context->callback, serverHeaderOptions, attrs, result));
         return OC_STACK_DELETE_TRANSACTION;
     }
 
@@ -1056,14 +1077,7 @@ namespace OC
 
     OCPayload* InProcClientWrapper::assembleSetResourcePayload(const OCRepresentation& rep)
     {
-        MessageContainer ocInfo;
-        ocInfo.addRepresentation(rep);
-        for(const OCRepresentation& r : rep.getChildren())
-        {
-            ocInfo.addRepresentation(r);
-        }
-
-        return reinterpret_cast<OCPayload*>(ocInfo.getPayload());
+        return reinterpret_cast<OCPayload*>(OCRepresentationCodec::encode(rep, rep.getChildren()));
     }
 
     OCStackResult InProcClientWrapper::PostResourceRepresentation(
@@ -1080,7 +1094,8 @@ namespace OC
         }
 
         OCStackResult result;
-        ClientCallbackContext::SetContext* ctx = new ClientCallbackContext::SetContext(callback);
+        ClientCallbackContext::SetContext* ctx =
+            new ClientCallbackContext::SetContext(callback, m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(ctx),
         cbdata.cb      = setResourceCallback;
@@ -1127,7 +1142,8 @@ namespace OC
         }
 
         OCStackResult result;
-        ClientCallbackContext::SetContext* ctx = new ClientCallbackContext::SetContext(callback);
+        ClientCallbackContext::SetContext* ctx =
+            new ClientCallbackContext::SetContext(callback, m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(ctx),
         cbdata.cb      = setResourceCallback;
@@ -1173,8 +1189,8 @@ namespace OC
         parseServerHeaderOptions(clientResponse, serverHeaderOptions);
 
         OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
-        std::thread exec(context->callback, serverHeaderOptions, clientResponse->result);
-        exec.detach();
+        context->executor->post(std::bind(context->callback, serverHeaderOptions,
+                                          clientResponse->result));
         return OC_STACK_DELETE_TRANSACTION;
     }
 
@@ -1193,7 +1209,7 @@ namespace OC
 
         OCStackResult result;
         ClientCallbackContext::DeleteContext* ctx =
-            new ClientCallbackContext::DeleteContext(callback);
+            new ClientCallbackContext::DeleteContext(callback, m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(ctx),
         cbdata.cb      = deleteResourceCallback;
@@ -1248,9 +1264,8 @@ namespace OC
         }
 
         OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
-        std::thread exec(context->callback, serverHeaderOptions, attrs,
-                    result, sequenceNumber);
-        exec.detach();
+        context->executor->post(context, std::bind(context->callback, serverHeaderOptions, attrs,
+                                                   result, sequenceNumber));
         if (sequenceNumber == MAX_SEQUENCE_NUMBER + 1)
         {
             return OC_STACK_DELETE_TRANSACTION;
@@ -1273,7 +1288,7 @@ namespace OC
         OCStackResult result;
 
         ClientCallbackContext::ObserveContext* ctx =
-            new ClientCallbackContext::ObserveContext(callback);
+            new ClientCallbackContext::ObserveContext(callback, m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(ctx),
         cbdata.cb      = observeResourceCallback;
@@ -1366,10 +1381,8 @@ namespace OC
         std::string url = clientResponse->devAddr.addr;
 
         OIC_LOG_V(DEBUG, TAG, "%s: call response callback", __func__);
-        std::thread exec(context->callback, clientResponse->result,
-                    clientResponse->sequenceNumber, url);
-
-        exec.detach();
+        context->executor->post(context, std::bind(context->callback, clientResponse->result,
+                                                   clientResponse->sequenceNumber, url));
 
         return OC_STACK_KEEP_TRANSACTION;
     }
@@ -1384,7 +1397,7 @@ namespace OC
         }
 
         ClientCallbackContext::SubscribePresenceContext* ctx =
-            new ClientCallbackContext::SubscribePresenceContext(presenceHandler);
+            new ClientCallbackContext::SubscribePresenceContext(presenceHandler, m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(ctx),
         cbdata.cb      = subscribePresenceCallback;
@@ -1445,7 +1458,7 @@ namespace OC
         OCStackResult result;
 
         ClientCallbackContext::ObserveContext* ctx =
-            new ClientCallbackContext::ObserveContext(callback);
+            new ClientCallbackContext::ObserveContext(callback, m_executor);
         OCCallbackData cbdata;
         cbdata.context = static_cast<void*>(ctx),
         cbdata.cb      = observeResourceCallback;
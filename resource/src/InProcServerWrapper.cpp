@@ -205,7 +205,15 @@ OCEntityHandlerResult EntityHandlerWrapper(OCEntityHandlerFlag flag,
 
     auto pRequest = std::make_shared<OC::OCResourceRequest>();
 
-    formResourceRequest(flag, entityHandlerRequest, pRequest);
+    try
+    {
+        formResourceRequest(flag, entityHandlerRequest, pRequest);
+    }
+    catch (OC::OCException& e)
+    {
+        oclog() << "Malformed request payload: " << e.reason() << endl;
+        return OC_EH_BAD_REQ;
+    }
 
     std::map <OCResourceHandle, std::string>::iterator resourceUriEntry;
     std::map <OCResourceHandle, std::string>::iterator resourceUriEnd;
@@ -269,6 +277,10 @@ namespace OC
     {
         OIC_LOG(INFO, TAG, "start");
 
+        // Requests to resources created here are decoded straight from their CBOR. OCStop()
+        // forgets the handler, so it is registered each time the stack is started.
+        OCRegisterEncodedEntityHandler(EntityHandlerWrapper);
+
         if (false == m_threadRun)
         {
             m_threadRun = true;
@@ -284,6 +296,7 @@ namespace OC
         if(m_processThread.joinable())
         {
             m_threadRun = false;
+            OCWakeProcess();
             m_processThread.join();
         }
 
@@ -296,10 +309,12 @@ namespace OC
         while(cLock && m_threadRun)
         {
             OCStackResult result;
+            uint32_t timeout;
 
             {
                 std::lock_guard<std::recursive_mutex> lock(*cLock);
                 result = OCProcess();
+                timeout = OCGetProcessTimeout();
             }
 
             if(OC_STACK_ERROR == result)
@@ -308,7 +323,13 @@ namespace OC
                 // ...the value of variable result is simply ignored for now.
             }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            // Sleep until the stack has work; wait without the lock so entity handlers and
+            // notifications from other threads are not held up. OCProcess() consumes wakeups,
+            // so look at the stop flag again first.
+            if(m_threadRun && OC_STACK_ERROR == OCWaitForProcess(timeout))
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
         }
     }
 
@@ -624,7 +645,7 @@ namespace OC
             response.requestHandle = pResponse->getRequestHandle();
             response.ehResult = pResponse->getResponseResult();
 
-            response.payload = reinterpret_cast<OCPayload*>(pResponse->getPayload());
+            response.payload = reinterpret_cast<OCPayload*>(pResponse->getEncodedPayload());
 
             response.persistentBufferFlag = 0;
 
@@ -721,5 +742,7 @@ namespace OC
         {
             oclog() << "Exception in stop"<< e.what() << std::flush;
         }
+
+        OCUnregisterEncodedEntityHandler(EntityHandlerWrapper);
     }
 }
@@ -27,6 +27,7 @@
 
 
 #include <OCRepresentation.h>
+#include <OCRepresentationCodec.h>
 
 #include <boost/lexical_cast.hpp>
 #include <algorithm>
@@ -56,6 +57,9 @@ namespace OC
             case PAYLOAD_TYPE_REPRESENTATION:
                 setPayload(reinterpret_cast<const OCRepPayload*>(rep));
                 break;
+            case PAYLOAD_TYPE_ENCODED:
+                setPayload(reinterpret_cast<const OCEncodedPayload*>(rep));
+                break;
             default:
                 throw OC::OCException("Invalid Payload type in setPayload");
                 break;
@@ -75,6 +79,43 @@ namespace OC
         }
     }
 
+    void MessageContainer::setPayload(const OCEncodedPayload* payload)
+    {
+        if (payload == nullptr)
+        {
+            return;
+        }
+
+        const OCByteString& cbor = payload->cborPayload;
+        if (OCRepresentationCodec::decode(cbor.bytes, cbor.len, m_reps))
+        {
+            return;
+        }
+
+        // Shapes the codec leaves to the C parser.
+        OCRepPayload* rep = nullptr;
+        if (OC_STACK_OK != OCEncodedPayloadParse(payload, &rep))
+        {
+            throw OC::OCException("Malformed representation payload",
+                                  OC_STACK_MALFORMED_RESPONSE);
+        }
+        try
+        {
+            setPayload(rep);
+        }
+        catch (...)
+        {
+            OCRepPayloadDestroy(rep);
+            throw;
+        }
+        OCRepPayloadDestroy(rep);
+    }
+
+    OCEncodedPayload* MessageContainer::getEncodedPayload() const
+    {
+        return OCRepresentationCodec::encode(m_reps);
+    }
+
     OCRepPayload* MessageContainer::getPayload() const
     {
         OCRepPayload* root = nullptr;
@@ -0,0 +1,1030 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+/**
+ * @file
+ *
+ * This file contains the implementation of the direct CBOR codec for OCRepresentation.
+ *
+ * The encoder writes the same bytes as OCRepresentation::getPayload() followed by
+ * OCConvertPayload(), and the decoder builds the same representations as OCParsePayload()
+ * followed by MessageContainer::setPayload().  Keep them in step with ocpayloadconvert.c
+ * and ocpayloadparse.c.
+ */
+
+#include <OCRepresentationCodec.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include <boost/variant.hpp>
+
+#include "cbor.h"
+#include "ocpayload.h"
+#include "oic_malloc.h"
+
+namespace OC
+{
+    namespace
+    {
+        // Arbitrarily chosen, matches the first guess of OCConvertPayload.
+        const size_t INIT_SIZE = 255;
+
+        // Size of the last encoded payload, representations tend to come in similar sizes.
+        std::atomic<size_t> g_sizeHint(INIT_SIZE);
+
+        // Errors are or-ed like in ocpayloadconvert.c, so that running out of buffer still
+        // walks the whole representation and tells how many bytes are missing.
+        typedef int64_t EncodeResult;
+
+        EncodeResult encodeRepMap(CborEncoder* parent, const OCRepresentation& rep);
+
+        EncodeResult encodeText(CborEncoder* encoder, const std::string& str)
+        {
+            // The C path strdup()s the value, which stops at the first NUL.
+            return cbor_encode_text_string(encoder, str.c_str(), strlen(str.c_str()));
+        }
+
+        EncodeResult encodeItem(CborEncoder* encoder, int value)
+        {
+            return cbor_encode_int(encoder, value);
+        }
+
+        EncodeResult encodeItem(CborEncoder* encoder, double value)
+        {
+            return cbor_encode_double(encoder, value);
+        }
+
+        EncodeResult encodeItem(CborEncoder* encoder, bool value)
+        {
+            return cbor_encode_boolean(encoder, value);
+        }
+
+        EncodeResult encodeItem(CborEncoder* encoder, const std::string& value)
+        {
+            return encodeText(encoder, value);
+        }
+
+        EncodeResult encodeItem(CborEncoder* encoder, const OCByteString& value)
+        {
+            return cbor_encode_byte_string(encoder, value.bytes, value.len);
+        }
+
+        EncodeResult encodeItem(CborEncoder* encoder, const OCRepresentation& value)
+        {
+            return encodeRepMap(encoder, value);
+        }
+
+        // Arrays are sent with the dimensions of the largest sub-array; the padding holds the
+        // zeroed value of the C array, which is null for strings and objects.
+        template<typename T>
+        EncodeResult encodePadding(CborEncoder* encoder);
+
+        template<>
+        EncodeResult encodePadding<int>(CborEncoder* encoder)
+        {
+            return cbor_encode_int(encoder, 0);
+        }
+
+        template<>
+        EncodeResult encodePadding<double>(CborEncoder* encoder)
+        {
+            return cbor_encode_double(encoder, 0.0);
+        }
+
+        template<>
+        EncodeResult encodePadding<bool>(CborEncoder* encoder)
+        {
+            return cbor_encode_boolean(encoder, false);
+        }
+
+        template<>
+        EncodeResult encodePadding<std::string>(CborEncoder* encoder)
+        {
+            return cbor_encode_null(encoder);
+        }
+
+        template<>
+        EncodeResult encodePadding<OCByteString>(CborEncoder* encoder)
+        {
+            return cbor_encode_byte_string(encoder, nullptr, 0);
+        }
+
+        template<>
+        EncodeResult encodePadding<OCRepresentation>(CborEncoder* encoder)
+        {
+            return cbor_encode_null(encoder);
+        }
+
+        template<typename T>
+        EncodeResult encodePaddingArray(CborEncoder* parent, size_t length)
+        {
+            CborEncoder array;
+            EncodeResult err = cbor_encoder_create_array(parent, &array, length);
+            for (size_t i = 0; i < length; ++i)
+            {
+                err |= encodePadding<T>(&array);
+            }
+            err |= cbor_encoder_close_container(parent, &array);
+            return err;
+        }
+
+        struct encode_value: boost::static_visitor<EncodeResult>
+        {
+            explicit encode_value(CborEncoder* encoder): m_encoder(encoder) {}
+
+            EncodeResult operator()(const NullType&) const
+            {
+                return cbor_encode_null(m_encoder);
+            }
+
+            EncodeResult operator()(const std::vector<uint8_t>& binary) const
+            {
+                return cbor_encode_byte_string(m_encoder, binary.data(), binary.size());
+            }
+
+            template<typename T>
+            EncodeResult operator()(const T& value) const
+            {
+                return encodeItem(m_encoder, value);
+            }
+
+            template<typename T>
+            EncodeResult operator()(const std::vector<T>& arr) const
+            {
+                CborEncoder array;
+                EncodeResult err = cbor_encoder_create_array(m_encoder, &array, arr.size());
+                for (size_t i = 0; i < arr.size(); ++i)
+                {
+                    err |= encodeItem(&array, static_cast<const T&>(arr[i]));
+                }
+                err |= cbor_encoder_close_container(m_encoder, &array);
+                return err;
+            }
+
+            template<typename T>
+            EncodeResult operator()(const std::vector<std::vector<T>>& arr) const
+            {
+                size_t dim1 = 0;
+                for (const auto& row : arr)
+                {
+                    dim1 = std::max(dim1, row.size());
+                }
+
+                CborEncoder array;
+                EncodeResult err = cbor_encoder_create_array(m_encoder, &array, arr.size());
+                for (const auto& row : arr)
+                {
+                    if (0 == dim1)
+                    {
+                        err |= encodePadding<T>(&array);
+                        continue;
+                    }
+
+                    CborEncoder array2;
+                    err |= cbor_encoder_create_array(&array, &array2, dim1);
+                    for (size_t j = 0; j < dim1; ++j)
+                    {
+                        err |= (j < row.size()) ? encodeItem(&array2, static_cast<const T&>(row[j]))
+                                                : encodePadding<T>(&array2);
+                    }
+                    err |= cbor_encoder_close_container(&array, &array2);
+                }
+                err |= cbor_encoder_close_container(m_encoder, &array);
+                return err;
+            }
+
+            template<typename T>
+            EncodeResult operator()(const std::vector<std::vector<std::vector<T>>>& arr) const
+            {
+                size_t dim1 = 0;
+                size_t dim2 = 0;
+                for (const auto& row : arr)
+                {
+                    dim1 = std::max(dim1, row.size());
+                    for (const auto& column : row)
+                    {
+                        dim2 = std::max(dim2, column.size());
+                    }
+                }
+
+                CborEncoder array;
+                EncodeResult err = cbor_encoder_create_array(m_encoder, &array, arr.size());
+                for (const auto& row : arr)
+                {
+                    if (0 == dim1)
+                    {
+                        err |= encodePadding<T>(&array);
+                        continue;
+                    }
+
+                    CborEncoder array2;
+                    err |= cbor_encoder_create_array(&array, &array2, dim1);
+                    for (size_t j = 0; j < dim1; ++j)
+                    {
+                        if (0 == dim2)
+                        {
+                            err |= encodePadding<T>(&array2);
+                        }
+                        else if (j >= row.size())
+                        {
+                            err |= encodePaddingArray<T>(&array2, dim2);
+                        }
+                        else
+                        {
+                            CborEncoder array3;
+                            err |= cbor_encoder_create_array(&array2, &array3, dim2);
+                            for (size_t k = 0; k < dim2; ++k)
+                            {
+                                err |= (k < row[j].size())
+                                    ? encodeItem(&array3, static_cast<const T&>(row[j][k]))
+                                    : encodePadding<T>(&array3);
+                            }
+                            err |= cbor_encoder_close_container(&array2, &array3);
+                        }
+                    }
+                    err |= cbor_encoder_close_container(&array, &array2);
+                }
+                err |= cbor_encoder_close_container(m_encoder, &array);
+                return err;
+            }
+
+            CborEncoder* m_encoder;
+        };
+
+        EncodeResult encodeStringList(CborEncoder* map, const char* key,
+                                      const std::vector<std::string>& list)
+        {
+            if (list.empty())
+            {
+                return CborNoError;
+            }
+
+            CborEncoder array;
+            EncodeResult err = cbor_encode_text_string(map, key, strlen(key));
+            err |= cbor_encoder_create_array(map, &array, list.size());
+            for (const std::string& str : list)
+            {
+                err |= encodeText(&array, str);
+            }
+            err |= cbor_encoder_close_container(map, &array);
+            return err;
+        }
+
+        // OCRepMapIsArray(): value names that count up from zero make a nested representation
+        // an array.  An empty one is an empty array.
+        bool isArray(const std::map<std::string, AttributeValue>& values)
+        {
+            size_t length = 0;
+            for (const auto& value : values)
+            {
+                char* endp = nullptr;
+                long i = strtol(value.first.c_str(), &endp, 0);
+                if (*endp != '\0' || i < 0 || length != static_cast<size_t>(i))
+                {
+                    return false;
+                }
+                ++length;
+            }
+            return true;
+        }
+
+        EncodeResult encodeValues(CborEncoder* map, const std::map<std::string, AttributeValue>& values)
+        {
+            EncodeResult err = CborNoError;
+            for (const auto& value : values)
+            {
+                err |= encodeText(map, value.first);
+                err |= boost::apply_visitor(encode_value(map), value.second);
+            }
+            return err;
+        }
+    }
+
+    // Befriended by OCRepresentation, so the codec reads and fills its members in place.
+    class OCRepresentationCodecAccess
+    {
+    public:
+        static EncodeResult encodeSingleRep(CborEncoder* map, const OCRepresentation& rep)
+        {
+            EncodeResult err = CborNoError;
+            if (!rep.m_uri.empty())
+            {
+                err |= cbor_encode_text_string(map, OC_RSRVD_HREF, sizeof(OC_RSRVD_HREF) - 1);
+                err |= encodeText(map, rep.m_uri);
+            }
+            err |= encodeStringList(map, OC_RSRVD_RESOURCE_TYPE, rep.m_resourceTypes);
+            err |= encodeStringList(map, OC_RSRVD_INTERFACE, rep.m_interfaces);
+            err |= encodeValues(map, rep.m_values);
+            return err;
+        }
+
+        static EncodeResult encodeRepMap(CborEncoder* parent, const OCRepresentation& rep)
+        {
+            CborEncoder container;
+            EncodeResult err = CborNoError;
+            if (isArray(rep.m_values))
+            {
+                err |= cbor_encoder_create_array(parent, &container, rep.m_values.size());
+                for (const auto& value : rep.m_values)
+                {
+                    err |= boost::apply_visitor(encode_value(&container), value.second);
+                }
+            }
+            else
+            {
+                err |= cbor_encoder_create_map(parent, &container, CborIndefiniteLength);
+                err |= encodeSingleRep(&container, rep);
+            }
+            err |= cbor_encoder_close_container(parent, &container);
+            return err;
+        }
+
+        static bool decodeRep(CborValue* map, OCRepresentation& rep, bool isRoot);
+        static bool decodeValue(CborValue* it, AttributeValue& value);
+    };
+
+    namespace
+    {
+        EncodeResult encodeRepMap(CborEncoder* parent, const OCRepresentation& rep)
+        {
+            return OCRepresentationCodecAccess::encodeRepMap(parent, rep);
+        }
+
+        EncodeResult encodeRoot(CborEncoder* encoder, const OCRepresentation* const* reps,
+                                size_t count)
+        {
+            EncodeResult err = CborNoError;
+            CborEncoder rootArray;
+            CborEncoder* parent = encoder;
+            if (count > 1)
+            {
+                err |= cbor_encoder_create_array(encoder, &rootArray, count);
+                parent = &rootArray;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                CborEncoder rootMap;
+                err |= cbor_encoder_create_map(parent, &rootMap, CborIndefiniteLength);
+                err |= OCRepresentationCodecAccess::encodeSingleRep(&rootMap, *reps[i]);
+                err |= cbor_encoder_close_container(parent, &rootMap);
+            }
+
+            if (count > 1)
+            {
+                err |= cbor_encoder_close_container(encoder, &rootArray);
+            }
+            return err;
+        }
+    }
+
+    OCEncodedPayload* OCRepresentationCodec::encode(const OCRepresentation* const* reps,
+                                                    size_t count)
+    {
+        size_t size = std::max(INIT_SIZE, g_sizeHint.load(std::memory_order_relaxed));
+
+        for (;;)
+        {
+            uint8_t* buffer = static_cast<uint8_t*>(OICMalloc(size));
+            if (!buffer)
+            {
+                throw std::bad_alloc();
+            }
+
+            CborEncoder encoder;
+            cbor_encoder_init(&encoder, buffer, size, 0);
+            EncodeResult err = encodeRoot(&encoder, reps, count);
+
+            if (CborErrorOutOfMemory == err)
+            {
+                size += cbor_encoder_get_extra_bytes_needed(&encoder);
+                OICFree(buffer);
+                continue;
+            }
+            if (CborNoError != err)
+            {
+                OICFree(buffer);
+                throw OCException("Failed to encode representation");
+            }
+
+            size_t used = cbor_encoder_get_buffer_size(&encoder, buffer);
+            g_sizeHint.store(used, std::memory_order_relaxed);
+            if (used < size)
+            {
+                uint8_t* shrunk = static_cast<uint8_t*>(OICRealloc(buffer, used));
+                if (shrunk)
+                {
+                    buffer = shrunk;
+                }
+            }
+
+            OCEncodedPayload* payload = OCEncodedPayloadCreateAsOwner(buffer, used);
+            if (!payload)
+            {
+                OICFree(buffer);
+                throw std::bad_alloc();
+            }
+            return payload;
+        }
+    }
+
+    OCEncodedPayload* OCRepresentationCodec::encode(const OCRepresentation& root,
+                                                    const std::vector<OCRepresentation>& children)
+    {
+        std::vector<const OCRepresentation*> reps;
+        reps.reserve(children.size() + 1);
+        reps.push_back(&root);
+        for (const OCRepresentation& child : children)
+        {
+            reps.push_back(&child);
+        }
+        return encode(reps.data(), reps.size());
+    }
+
+    OCEncodedPayload* OCRepresentationCodec::encode(const std::vector<OCRepresentation>& reps)
+    {
+        if (reps.empty())
+        {
+            return nullptr;
+        }
+
+        std::vector<const OCRepresentation*> list;
+        list.reserve(reps.size());
+        for (const OCRepresentation& rep : reps)
+        {
+            list.push_back(&rep);
+        }
+        return encode(list.data(), list.size());
+    }
+
+    namespace
+    {
+        // Copy a text string the way cbor_value_dup_text_string() followed by std::string(char*)
+        // does, which stops at the first NUL.
+        bool readText(CborValue* it, std::string& str)
+        {
+            size_t length = 0;
+            if (CborNoError != cbor_value_calculate_string_length(it, &length))
+            {
+                return false;
+            }
+
+            str.resize(length);
+            if (CborNoError != cbor_value_copy_text_string(it, &str[0], &length, it))
+            {
+                return false;
+            }
+            str.resize(strlen(str.c_str()));
+            return true;
+        }
+
+        bool readBytes(CborValue* it, std::vector<uint8_t>& bytes)
+        {
+            size_t length = 0;
+            if (CborNoError != cbor_value_calculate_string_length(it, &length))
+            {
+                return false;
+            }
+
+            bytes.resize(length);
+            return CborNoError == cbor_value_copy_byte_string(it, bytes.data(), &length, it);
+        }
+
+        // OCParseStringLL(): text strings up to the first other item, split on spaces.
+        bool readStringList(const CborValue* value, std::vector<std::string>& list)
+        {
+            if (!cbor_value_is_array(value))
+            {
+                return true;
+            }
+
+            CborValue it;
+            if (CborNoError != cbor_value_enter_container(value, &it))
+            {
+                return false;
+            }
+
+            while (cbor_value_is_text_string(&it))
+            {
+                std::string str;
+                if (!readText(&it, str))
+                {
+                    return false;
+                }
+
+                size_t pos = 0;
+                while (pos < str.size())
+                {
+                    size_t end = str.find(' ', pos);
+                    if (end == std::string::npos)
+                    {
+                        end = str.size();
+                    }
+                    if (end > pos)
+                    {
+                        list.push_back(str.substr(pos, end - pos));
+                    }
+                    pos = end + 1;
+                }
+            }
+            return true;
+        }
+
+        enum class ElementType
+        {
+            None,
+            Integer,
+            Double,
+            Boolean,
+            String,
+            Object
+        };
+
+        // OCParseArrayFindDimensionsAndType(), without the shapes the C parser is lenient
+        // about: sub-arrays next to plain items, arrays deeper than three levels, mixed types,
+        // and byte strings (which it hands out as OCByteStrings into freed memory).
+        struct ArrayShape
+        {
+            size_t dimensions[MAX_REP_ARRAY_DEPTH] = {0, 0, 0};
+            // Per level, whether the items seen so far were arrays (1) or values (0).
+            int nested[MAX_REP_ARRAY_DEPTH] = {-1, -1, -1};
+            // Per level, whether a null was seen.  Null is only taken in place of a value.
+            bool nulls[MAX_REP_ARRAY_DEPTH] = {false, false, false};
+            ElementType type = ElementType::None;
+        };
+
+        bool scanArray(const CborValue* array, size_t level, ArrayShape& shape)
+        {
+            CborValue it;
+            if (CborNoError != cbor_value_enter_container(array, &it))
+            {
+                return false;
+            }
+
+            size_t count = 0;
+            while (cbor_value_is_valid(&it))
+            {
+                ElementType type = ElementType::None;
+                switch (cbor_value_get_type(&it))
+                {
+                    case CborNullType:
+                        if (1 == shape.nested[level])
+                        {
+                            return false;
+                        }
+                        shape.nulls[level] = true;
+                        break;
+                    case CborArrayType:
+                        if (level + 1 >= MAX_REP_ARRAY_DEPTH || 0 == shape.nested[level] ||
+                            shape.nulls[level])
+                        {
+                            return false;
+                        }
+                        shape.nested[level] = 1;
+                        if (!scanArray(&it, level + 1, shape))
+                        {
+                            return false;
+                        }
+                        break;
+                    case CborIntegerType:
+                        type = ElementType::Integer;
+                        break;
+                    case CborDoubleType:
+                    case CborFloatType:
+                        type = ElementType::Double;
+                        break;
+                    case CborBooleanType:
+                        type = ElementType::Boolean;
+                        break;
+                    case CborTextStringType:
+                        type = ElementType::String;
+                        break;
+                    case CborMapType:
+                        type = ElementType::Object;
+                        break;
+                    default:
+                        return false;
+                }
+
+                if (type != ElementType::None)
+                {
+                    if (1 == shape.nested[level] ||
+                        (shape.type != ElementType::None && shape.type != type))
+                    {
+                        return false;
+                    }
+                    shape.nested[level] = 0;
+                    shape.type = type;
+                }
+
+                ++count;
+                if (CborNoError != cbor_value_advance(&it))
+                {
+                    return false;
+                }
+            }
+
+            shape.dimensions[level] = std::max(shape.dimensions[level], count);
+            return true;
+        }
+
+        bool readElement(CborValue* it, int& value)
+        {
+            int64_t i = 0;
+            if (CborNoError != cbor_value_get_int64(it, &i))
+            {
+                return false;
+            }
+            value = static_cast<int>(i);
+            return CborNoError == cbor_value_advance_fixed(it);
+        }
+
+        bool readElement(CborValue* it, double& value)
+        {
+            if (cbor_value_is_double(it))
+            {
+                if (CborNoError != cbor_value_get_double(it, &value))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                float f = 0;
+                if (CborNoError != cbor_value_get_float(it, &f))
+                {
+                    return false;
+                }
+                value = f;
+            }
+            return CborNoError == cbor_value_advance_fixed(it);
+        }
+
+        bool readElement(CborValue* it, bool& value)
+        {
+            if (CborNoError != cbor_value_get_boolean(it, &value))
+            {
+                return false;
+            }
+            return CborNoError == cbor_value_advance_fixed(it);
+        }
+
+        bool readElement(CborValue* it, std::string& value)
+        {
+            return readText(it, value);
+        }
+
+        bool readElement(CborValue* it, OCRepresentation& value)
+        {
+            return OCRepresentationCodecAccess::decodeRep(it, value, false);
+        }
+
+        // The fill functions step over the whole array and leave it iterator on the next item.
+        template<typename T>
+        bool fillArray(CborValue* array, std::vector<T>& out)
+        {
+            CborValue it;
+            if (CborNoError != cbor_value_enter_container(array, &it))
+            {
+                return false;
+            }
+
+            for (size_t i = 0; cbor_value_is_valid(&it); ++i)
+            {
+                if (cbor_value_is_null(&it))
+                {
+                    if (CborNoError != cbor_value_advance_fixed(&it))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+
+                T value{};
+                if (!readElement(&it, value))
+                {
+                    return false;
+                }
+                out[i] = std::move(value);
+            }
+            return CborNoError == cbor_value_leave_container(array, &it);
+        }
+
+        template<typename T>
+        bool fillArray(CborValue* array, std::vector<std::vector<T>>& out)
+        {
+            CborValue it;
+            if (CborNoError != cbor_value_enter_container(array, &it))
+            {
+                return false;
+            }
+
+            for (size_t i = 0; cbor_value_is_valid(&it); ++i)
+            {
+                if (cbor_value_is_null(&it))
+                {
+                    if (CborNoError != cbor_value_advance_fixed(&it))
+                    {
+                        return false;
+                    }
+                }
+                else if (!fillArray(&it, out[i]))
+                {
+                    return false;
+                }
+            }
+            return CborNoError == cbor_value_leave_container(array, &it);
+        }
+
+        // payload_array_helper(): every row is sized to the largest one.
+        template<typename T>
+        bool readArray(CborValue* array, const ArrayShape& shape, AttributeValue& value)
+        {
+            const size_t* dims = shape.dimensions;
+            if (0 == dims[1])
+            {
+                std::vector<T> out(dims[0]);
+                if (!fillArray(array, out))
+                {
+                    return false;
+                }
+                value = std::move(out);
+            }
+            else if (0 == dims[2])
+            {
+                std::vector<std::vector<T>> out(dims[0], std::vector<T>(dims[1]));
+                if (!fillArray(array, out))
+                {
+                    return false;
+                }
+                value = std::move(out);
+            }
+            else
+            {
+                std::vector<std::vector<std::vector<T>>> out(dims[0],
+                        std::vector<std::vector<T>>(dims[1], std::vector<T>(dims[2])));
+                if (!fillArray(array, out))
+                {
+                    return false;
+                }
+                value = std::move(out);
+            }
+            return true;
+        }
+
+        bool decodeArray(CborValue* array, AttributeValue& value)
+        {
+            ArrayShape shape;
+            if (!scanArray(array, 0, shape))
+            {
+                return false;
+            }
+
+            switch (shape.type)
+            {
+                case ElementType::None:
+                    // Empty and all-null arrays carry no type.
+                    value = NullType();
+                    return CborNoError == cbor_value_advance(array);
+                case ElementType::Integer:
+                    return readArray<int>(array, shape, value);
+                case ElementType::Double:
+                    return readArray<double>(array, shape, value);
+                case ElementType::Boolean:
+                    return readArray<bool>(array, shape, value);
+                case ElementType::String:
+                    return readArray<std::string>(array, shape, value);
+                case ElementType::Object:
+                    return readArray<OCRepresentation>(array, shape, value);
+            }
+            return false;
+        }
+    }
+
+    bool OCRepresentationCodecAccess::decodeValue(CborValue* it, AttributeValue& value)
+    {
+        switch (cbor_value_get_type(it))
+        {
+            case CborNullType:
+                value = NullType();
+                return CborNoError == cbor_value_advance_fixed(it);
+            case CborIntegerType:
+            {
+                int i = 0;
+                if (!readElement(it, i))
+                {
+                    return false;
+                }
+                value = i;
+                return true;
+            }
+            case CborDoubleType:
+            {
+                // A lone float or half float is rejected by the C parser.
+                double d = 0;
+                if (!readElement(it, d))
+                {
+                    return false;
+                }
+                value = d;
+                return true;
+            }
+            case CborBooleanType:
+            {
+                bool b = false;
+                if (!readElement(it, b))
+                {
+                    return false;
+                }
+                value = b;
+                return true;
+            }
+            case CborTextStringType:
+            {
+                std::string str;
+                if (!readText(it, str))
+                {
+                    return false;
+                }
+                value = std::move(str);
+                return true;
+            }
+            case CborByteStringType:
+            {
+                std::vector<uint8_t> bytes;
+                if (!readBytes(it, bytes))
+                {
+                    return false;
+                }
+                value = std::move(bytes);
+                return true;
+            }
+            case CborMapType:
+            {
+                OCRepresentation rep;
+                if (!decodeRep(it, rep, false))
+                {
+                    return false;
+                }
+                value = std::move(rep);
+                return true;
+            }
+            case CborArrayType:
+                return decodeArray(it, value);
+            default:
+                return false;
+        }
+    }
+
+    // OCParseRepPayload() and OCParseSingleRepPayload(): the root map takes href, rt and if
+    // from their first occurrence and skips every occurrence as a value.
+    bool OCRepresentationCodecAccess::decodeRep(CborValue* map, OCRepresentation& rep, bool isRoot)
+    {
+        if (!cbor_value_is_map(map))
+        {
+            return false;
+        }
+
+        CborValue it;
+        if (CborNoError != cbor_value_enter_container(map, &it))
+        {
+            return false;
+        }
+
+        bool seenHref = false;
+        bool seenTypes = false;
+        bool seenInterfaces = false;
+        std::string name;
+        while (cbor_value_is_valid(&it))
+        {
+            if (!cbor_value_is_text_string(&it) || !readText(&it, name) ||
+                !cbor_value_is_valid(&it))
+            {
+                return false;
+            }
+
+            if (isRoot)
+            {
+                bool isHref = (name == OC_RSRVD_HREF);
+                bool isTypes = (name == OC_RSRVD_RESOURCE_TYPE);
+                bool isInterfaces = (name == OC_RSRVD_INTERFACE);
+                if (isHref || isTypes || isInterfaces)
+                {
+                    if (isHref && !seenHref)
+                    {
+                        seenHref = true;
+                        CborValue value = it;
+                        if (cbor_value_is_text_string(&value) && !readText(&value, rep.m_uri))
+                        {
+                            return false;
+                        }
+                    }
+                    else if (isTypes && !seenTypes)
+                    {
+                        seenTypes = true;
+                        if (!readStringList(&it, rep.m_resourceTypes))
+                        {
+                            return false;
+                        }
+                    }
+                    else if (isInterfaces && !seenInterfaces)
+                    {
+                        seenInterfaces = true;
+                        if (!readStringList(&it, rep.m_interfaces))
+                        {
+                            return false;
+                        }
+                    }
+
+                    if (CborNoError != cbor_value_advance(&it))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+            }
+
+            if (!decodeValue(&it, rep.m_values[name]))
+            {
+                return false;
+            }
+        }
+
+        return CborNoError == cbor_value_leave_container(map, &it);
+    }
+
+    bool OCRepresentationCodec::decode(const uint8_t* data, size_t size,
+                                       std::vector<OCRepresentation>& reps)
+    {
+        if (!data || !size)
+        {
+            return false;
+        }
+
+        CborParser parser;
+        CborValue root;
+        if (CborNoError != cbor_parser_init(data, size, 0, &parser, &root))
+        {
+            return false;
+        }
+
+        std::vector<OCRepresentation> decoded;
+        if (cbor_value_is_map(&root))
+        {
+            decoded.emplace_back();
+            if (!OCRepresentationCodecAccess::decodeRep(&root, decoded.back(), true))
+            {
+                return false;
+            }
+        }
+        else if (cbor_value_is_array(&root))
+        {
+            CborValue it;
+            if (CborNoError != cbor_value_enter_container(&root, &it))
+            {
+                return false;
+            }
+            while (cbor_value_is_valid(&it))
+            {
+                decoded.emplace_back();
+                if (!OCRepresentationCodecAccess::decodeRep(&it, decoded.back(), true))
+                {
+                    return false;
+                }
+            }
+            if (CborNoError != cbor_value_leave_container(&root, &it))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        reps.insert(reps.end(), std::make_move_iterator(decoded.begin()),
+                    std::make_move_iterator(decoded.end()));
+        return true;
+    }
+}
@@ -0,0 +1,203 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include <gtest/gtest.h>
+#include <CallbackExecutor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+namespace CallbackExecutorTest
+{
+    using namespace OC;
+
+    // Size of a notification burst, and the number of observations it is spread over.
+    const size_t BURST_SIZE = 500;
+    const size_t OBSERVATION_COUNT = 5;
+    const std::chrono::microseconds CALLBACK_WORK(200);
+
+    size_t processThreadCount()
+    {
+        size_t count = 0;
+#ifdef __linux__
+        DIR* tasks = opendir("/proc/self/task");
+        if (tasks)
+        {
+            while (struct dirent* entry = readdir(tasks))
+            {
+                if (entry->d_name[0] != '.')
+                {
+                    ++count;
+                }
+            }
+            closedir(tasks);
+        }
+#endif
+        return count;
+    }
+
+    class Burst
+    {
+    public:
+        Burst() : m_done(0), m_peakThreads(0), m_totalLatencyUs(0), m_maxLatencyUs(0)
+        {
+            m_order.resize(OBSERVATION_COUNT);
+        }
+
+        CallbackExecutor::Task notification(size_t observation, size_t sequence)
+        {
+            auto posted = std::chrono::steady_clock::now();
+            return [this, observation, sequence, posted]()
+            {
+                auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - posted).count();
+                std::this_thread::sleep_for(CALLBACK_WORK);
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_order[observation].push_back(sequence);
+                m_totalLatencyUs += latency;
+                m_maxLatencyUs = std::max<long long>(m_maxLatencyUs, latency);
+                m_peakThreads = std::max(m_peakThreads, processThreadCount());
+                ++m_done;
+                m_cond.notify_all();
+            };
+        }
+
+        void run(CallbackExecutor& executor)
+        {
+            for (size_t i = 0; i < BURST_SIZE; ++i)
+            {
+                size_t observation = i % OBSERVATION_COUNT;
+                const void* strand = &m_order[observation];
+                executor.post(strand, notification(observation, i / OBSERVATION_COUNT));
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            ASSERT_TRUE(m_cond.wait_for(lock, std::chrono::seconds(30),
+                        [this]() { return m_done == BURST_SIZE; }));
+        }
+
+        bool inOrder()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const std::vector<size_t>& order : m_order)
+            {
+                if (!std::is_sorted(order.begin(), order.end()))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void report(const char* mode)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::cout << mode << ": peak threads=" << m_peakThreads
+                      << " mean latency=" << m_totalLatencyUs / BURST_SIZE << "us"
+                      << " max latency=" << m_maxLatencyUs << "us" << std::endl;
+        }
+
+        size_t peakThreads()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_peakThreads;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::vector<std::vector<size_t>> m_order;
+        size_t m_done;
+        size_t m_peakThreads;
+        long long m_totalLatencyUs;
+        long long m_maxLatencyUs;
+    };
+
+    TEST(CallbackExecutorTest, InlineRunsOnCallingThread)
+    {
+        CallbackExecutor executor(CallbackExecution::Inline, 0);
+        std::thread::id ran;
+        executor.post([&ran]() { ran = std::this_thread::get_id(); });
+        EXPECT_EQ(std::this_thread::get_id(), ran);
+    }
+
+    TEST(CallbackExecutorTest, DestructionRunsPostedCallbacks)
+    {
+        std::atomic<size_t> ran(0);
+        {
+            CallbackExecutor executor(CallbackExecution::SerialStrands, 2);
+            for (size_t i = 0; i < 100; ++i)
+            {
+                executor.post(&ran, [&ran]() { ++ran; });
+                executor.post([&ran]() { ++ran; });
+            }
+        }
+        EXPECT_EQ(200u, ran);
+    }
+
+    TEST(CallbackExecutorTest, ThreadPerCallbackBurst)
+    {
+        Burst burst;
+        CallbackExecutor executor(CallbackExecution::ThreadPerCallback, 0);
+        burst.run(executor);
+        burst.report("thread per callback");
+    }
+
+    TEST(CallbackExecutorTest, WorkerPoolBurstUsesFixedThreads)
+    {
+        size_t before = processThreadCount();
+        Burst burst;
+        {
+            CallbackExecutor executor(CallbackExecution::WorkerPool, DEFAULT_CALLBACK_THREAD_COUNT);
+            burst.run(executor);
+        }
+        burst.report("worker pool");
+#ifdef __linux__
+        EXPECT_GE(before + DEFAULT_CALLBACK_THREAD_COUNT, burst.peakThreads());
+#endif
+    }
+
+    TEST(CallbackExecutorTest, SerialStrandsBurstKeepsObserveOrder)
+    {
+        size_t before = processThreadCount();
+        Burst burst;
+        {
+            CallbackExecutor executor(CallbackExecution::SerialStrands,
+                                      DEFAULT_CALLBACK_THREAD_COUNT);
+            burst.run(executor);
+        }
+        burst.report("serial strands");
+        EXPECT_TRUE(burst.inOrder());
+#ifdef __linux__
+        EXPECT_GE(before + DEFAULT_CALLBACK_THREAD_COUNT, burst.peakThreads());
+#endif
+    }
+}
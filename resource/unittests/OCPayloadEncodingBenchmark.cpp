@@ -0,0 +1,196 @@
+//******************************************************************
+//
+// Copyright 2017 IoTivity Project All Rights Reserved.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+// Encode throughput of OCConvertPayload for representations of a few dozen bytes, of a few
+// hundred bytes and of several kilobytes, the last two being larger than the initial
+// buffer the encoder used to start from.  The same representations are then taken through
+// the OCRepPayload path and through OCRepresentationCodec in both directions.
+
+#include <gtest/gtest.h>
+#include <OCApi.h>
+#include <OCRepresentation.h>
+#include <OCRepresentationCodec.h>
+#include <octypes.h>
+#include <ocstack.h>
+#include <ocpayload.h>
+#include <ocpayloadcbor.h>
+#include <oic_malloc.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace OCPayloadEncodingBenchmark
+{
+    const size_t ENCODE_ROUNDS = 20000;
+
+    OC::OCRepresentation smallRepresentation()
+    {
+        OC::OCRepresentation rep;
+        rep.setUri("/a/light");
+        rep.setValue("power", true);
+        rep.setValue("brightness", 42);
+        return rep;
+    }
+
+    OC::OCRepresentation mediumRepresentation()
+    {
+        OC::OCRepresentation rep;
+        rep.setUri("/a/thermostat");
+        rep.addResourceType("oic.r.temperature");
+        rep.addResourceInterface("oic.if.baseline");
+        for (int i = 0; i < 16; ++i)
+        {
+            rep.setValue("sensor" + std::to_string(i), 20.5 + i);
+        }
+        rep.setValue("units", std::string("C"));
+        std::vector<int> range = { -40, 125 };
+        rep.setValue("range", range);
+        return rep;
+    }
+
+    OC::OCRepresentation largeRepresentation()
+    {
+        OC::OCRepresentation rep;
+        rep.setUri("/a/log");
+        std::vector<std::string> entries;
+        for (int i = 0; i < 64; ++i)
+        {
+            entries.push_back("entry " + std::to_string(i) + ": " + std::string(48, 'x'));
+        }
+        rep.setValue("entries", entries);
+        std::vector<OC::OCRepresentation> children;
+        for (int i = 0; i < 8; ++i)
+        {
+            children.push_back(mediumRepresentation());
+        }
+        rep.setValue("children", children);
+        return rep;
+    }
+
+    void measure(const char *name, const OC::OCRepresentation &rep)
+    {
+        OCRepPayload *payload = rep.getPayload();
+        ASSERT_TRUE(NULL != payload);
+
+        size_t encodedSize = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < ENCODE_ROUNDS; ++round)
+        {
+            uint8_t *cborData = NULL;
+            size_t cborSize = 0;
+            ASSERT_EQ(OC_STACK_OK, OCConvertPayload((OCPayload *)payload, OC_FORMAT_CBOR,
+                                                    &cborData, &cborSize));
+            encodedSize = cborSize;
+            OICFree(cborData);
+        }
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        std::cout << name << " size=" << encodedSize << "B"
+                  << " encodes/s=" << ENCODE_ROUNDS / seconds
+                  << " MB/s=" << (ENCODE_ROUNDS * encodedSize) / seconds / 1e6 << std::endl;
+
+        OCRepPayloadDestroy(payload);
+    }
+
+    template<typename Round>
+    double roundsPerSecond(Round round)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ENCODE_ROUNDS; ++i)
+        {
+            round();
+        }
+        double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        return ENCODE_ROUNDS / seconds;
+    }
+
+    void measureCodec(const char *name, const OC::OCRepresentation &rep)
+    {
+        OC::MessageContainer container;
+        container.addRepresentation(rep);
+
+        // OCRepresentation -> OCRepPayload -> CBOR, as the wrappers used to send it.
+        double classicEncodes = roundsPerSecond([&]()
+        {
+            OCRepPayload *payload = container.getPayload();
+            uint8_t *cborData = NULL;
+            size_t cborSize = 0;
+            EXPECT_EQ(OC_STACK_OK, OCConvertPayload((OCPayload *)payload, OC_FORMAT_CBOR,
+                                                    &cborData, &cborSize));
+            OICFree(cborData);
+            OCRepPayloadDestroy(payload);
+        });
+
+        double codecEncodes = roundsPerSecond([&]()
+        {
+            OCEncodedPayload *payload = container.getEncodedPayload();
+            EXPECT_TRUE(NULL != payload);
+            OCPayloadDestroy((OCPayload *)payload);
+        });
+
+        OCEncodedPayload *encoded = container.getEncodedPayload();
+        ASSERT_TRUE(NULL != encoded);
+        const uint8_t *cborData = encoded->cborPayload.bytes;
+        size_t cborSize = encoded->cborPayload.len;
+
+        // CBOR -> OCRepPayload -> OCRepresentation, as the wrappers used to receive it.
+        double classicDecodes = roundsPerSecond([&]()
+        {
+            OCPayload *parsed = NULL;
+            EXPECT_EQ(OC_STACK_OK, OCParsePayload(&parsed, OC_FORMAT_CBOR,
+                                                  PAYLOAD_TYPE_REPRESENTATION,
+                                                  cborData, cborSize));
+            OC::MessageContainer decoded;
+            decoded.setPayload(parsed);
+            OCPayloadDestroy(parsed);
+        });
+
+        double codecDecodes = roundsPerSecond([&]()
+        {
+            std::vector<OC::OCRepresentation> decoded;
+            EXPECT_TRUE(OC::OCRepresentationCodec::decode(cborData, cborSize, decoded));
+        });
+
+        std::cout << name << " size=" << cborSize << "B"
+                  << " encodes/s payload=" << classicEncodes << " codec=" << codecEncodes
+                  << " decodes/s payload=" << classicDecodes << " codec=" << codecDecodes
+                  << std::endl;
+
+        OCPayloadDestroy((OCPayload *)encoded);
+    }
+
+    TEST(OCPayloadEncodingBenchmark, EncodeThroughputVersusPayloadSize)
+    {
+        measure("small", smallRepresentation());
+        measure("medium", mediumRepresentation());
+        measure("large", largeRepresentation());
+    }
+
+    TEST(OCPayloadEncodingBenchmark, RepresentationCodecThroughput)
+    {
+        measureCodec("small", smallRepresentation());
+        measureCodec("medium", mediumRepresentation());
+        measureCodec("large", largeRepresentation());
+    }
+}
@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 #include <OCApi.h>
 #include <OCRepresentation.h>
+#include <OCRepresentationCodec.h>
 #include <octypes.h>
 #include <ocstack.h>
 #include <ocpayload.h>
@@ -1638,4 +1639,193 @@ namespace OCRepresentationEncodingTest
         OCRepPayloadDestroy(repPayload);
         OCPayloadDestroy(cparsed);
     }
+
+    // The codec has to write the bytes OCConvertPayload writes for the OCRepPayload of a
+    // representation, and read them back as OCParsePayload and setPayload would.
+    void expectCodecMatchesPayload(const OC::OCRepresentation& rep)
+    {
+        OC::MessageContainer mc1;
+        mc1.addRepresentation(rep);
+        for (const OC::OCRepresentation& child : rep.getChildren())
+        {
+            mc1.addRepresentation(child);
+        }
+
+        OCRepPayload* cstart = mc1.getPayload();
+        uint8_t* cborData = NULL;
+        size_t cborSize = 0;
+        OCPayload* cparsed = NULL;
+        EXPECT_EQ(OC_STACK_OK, OCConvertPayload((OCPayload*)cstart, OC_FORMAT_CBOR, &cborData, &cborSize));
+        EXPECT_EQ(OC_STACK_OK, OCParsePayload(&cparsed, OC_FORMAT_CBOR, PAYLOAD_TYPE_REPRESENTATION,
+                    cborData, cborSize));
+        OCPayloadDestroy((OCPayload*)cstart);
+
+        OCEncodedPayload* encoded = OC::OCRepresentationCodec::encode(rep, rep.getChildren());
+        ASSERT_NE((OCEncodedPayload*)NULL, encoded);
+        EXPECT_EQ(PAYLOAD_TYPE_ENCODED, encoded->base.type);
+        ASSERT_EQ(cborSize, encoded->cborPayload.len);
+        EXPECT_EQ(0, memcmp(cborData, encoded->cborPayload.bytes, cborSize));
+
+        OC::MessageContainer mc2;
+        mc2.setPayload(cparsed);
+        std::vector<OC::OCRepresentation> decoded;
+        EXPECT_TRUE(OC::OCRepresentationCodec::decode(cborData, cborSize, decoded));
+        EXPECT_EQ(mc2.representations(), decoded);
+
+        OICFree(cborData);
+        OCPayloadDestroy(cparsed);
+        OCPayloadDestroy((OCPayload*)encoded);
+    }
+
+    TEST(RepresentationCodec, BaseAttributeTypes)
+    {
+        OC::OCRepresentation rep;
+        rep.setUri("/a/light");
+        rep.addResourceType("core.light");
+        rep.addResourceType("core.brightlight");
+        rep.addResourceInterface("oic.if.baseline");
+        rep.setNULL("NullAttr");
+        rep.setValue("IntAttr", -77);
+        rep.setValue("DoubleAttr", 3.333);
+        rep.setValue("BoolAttr", true);
+        rep.setValue("StringAttr", std::string("String attr"));
+        rep.setValue("EmptyStringAttr", std::string(""));
+        uint8_t binval[] = {0x1, 0x2, 0x3, 0x0, 0x5};
+        OCByteString byteString = {binval, sizeof(binval)};
+        rep.setValue("ByteStringAttr", byteString);
+        rep.setValue("BinaryAttr", std::vector<uint8_t>(300, 0xAB));
+
+        expectCodecMatchesPayload(rep);
+    }
+
+    TEST(RepresentationCodec, NestedRepresentations)
+    {
+        OC::OCRepresentation inner;
+        inner.setUri("/inner");
+        inner.addResourceType("inner.type");
+        inner.setValue("IntAttr", 5);
+
+        OC::OCRepresentation indexed;
+        indexed.setValue("0", 1);
+        indexed.setValue("1", std::string("one"));
+
+        OC::OCRepresentation rep;
+        rep.setValue("Inner", inner);
+        rep.setValue("Indexed", indexed);
+        rep.setValue("Empty", OC::OCRepresentation());
+
+        expectCodecMatchesPayload(rep);
+
+        std::vector<OC::OCRepresentation> decoded;
+        OCEncodedPayload* encoded = OC::OCRepresentationCodec::encode(rep, rep.getChildren());
+        ASSERT_TRUE(OC::OCRepresentationCodec::decode(encoded->cborPayload.bytes,
+                    encoded->cborPayload.len, decoded));
+        ASSERT_EQ(1u, decoded.size());
+        // Nested maps keep href and rt as values, as OCParsePayload does.
+        OC::OCRepresentation inner2 = decoded[0].getValue<OC::OCRepresentation>("Inner");
+        EXPECT_EQ("", inner2.getUri());
+        EXPECT_EQ("/inner", inner2.getValue<std::string>("href"));
+        EXPECT_EQ(5, inner2.getValue<int>("IntAttr"));
+        EXPECT_TRUE(decoded[0].isNULL("Empty"));
+        OCPayloadDestroy((OCPayload*)encoded);
+    }
+
+    TEST(RepresentationCodec, JaggedArrays)
+    {
+        OC::OCRepresentation sub1;
+        sub1.setValue("IntAttr", 1);
+        OC::OCRepresentation sub2;
+        sub2.setUri("/sub2");
+        sub2.setValue("StringAttr", std::string("two"));
+
+        OC::OCRepresentation rep;
+        rep["EmptyAttr"] = std::vector<int>();
+        rep["IntArr"] = std::vector<int>{1, -2, 300000};
+        rep["DoubleArr"] = std::vector<double>{1.5, 2.25};
+        rep["BoolArr"] = std::vector<bool>{true, false, true};
+        rep["StrArr"] = std::vector<std::string>{"a", "", "ccc"};
+        rep["RepArr"] = std::vector<OC::OCRepresentation>{sub1, sub2};
+        rep["IntArr2"] = std::vector<std::vector<int>>{{1, 2, 3}, {4}, {}};
+        rep["StrArr2"] = std::vector<std::vector<std::string>>{{"x"}, {"y", "z"}};
+        rep["RepArr2"] = std::vector<std::vector<OC::OCRepresentation>>{{sub1}, {sub1, sub2}};
+        rep["DoubleArr3"] = std::vector<std::vector<std::vector<double>>>{
+            {{1.0, 2.0}, {3.0}}, {{4.0, 5.0, 6.0}}};
+        rep["BoolArr3"] = std::vector<std::vector<std::vector<bool>>>{
+            {{true}}, {{false, true}, {true}, {false}}};
+
+        expectCodecMatchesPayload(rep);
+    }
+
+    TEST(RepresentationCodec, Children)
+    {
+        OC::OCRepresentation rep;
+        rep.setUri("/a/collection");
+        rep.addResourceType("oic.wk.col");
+        rep.setValue("IntAttr", 1);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            OC::OCRepresentation child;
+            child.setUri("/a/child" + std::to_string(i));
+            child.addResourceInterface("oic.if.baseline");
+            child.setValue("Index", i);
+            rep.addChild(child);
+        }
+
+        expectCodecMatchesPayload(rep);
+
+        OC::MessageContainer mc;
+        mc.addRepresentation(rep);
+        for (const OC::OCRepresentation& child : rep.getChildren())
+        {
+            mc.addRepresentation(child);
+        }
+        OCEncodedPayload* encoded = mc.getEncodedPayload();
+        ASSERT_NE((OCEncodedPayload*)NULL, encoded);
+
+        OC::MessageContainer mc2;
+        mc2.setPayload((OCPayload*)encoded);
+        ASSERT_EQ(4u, mc2.representations().size());
+        EXPECT_EQ("/a/collection", mc2.representations()[0].getUri());
+        EXPECT_EQ("/a/child2", mc2.representations()[3].getUri());
+        EXPECT_EQ(2, mc2.representations()[3].getValue<int>("Index"));
+        OCPayloadDestroy((OCPayload*)encoded);
+    }
+
+    TEST(RepresentationCodec, FallsBackToPayloadParser)
+    {
+        uint8_t binval[] = {0x1, 0x2};
+        OC::OCRepresentation rep;
+        rep.setValue("IntAttr", 1);
+        rep["ByteStrArr"] = std::vector<OCByteString>{{binval, sizeof(binval)}};
+
+        OCEncodedPayload* encoded = OC::OCRepresentationCodec::encode(rep, rep.getChildren());
+        ASSERT_NE((OCEncodedPayload*)NULL, encoded);
+
+        std::vector<OC::OCRepresentation> decoded;
+        EXPECT_FALSE(OC::OCRepresentationCodec::decode(encoded->cborPayload.bytes,
+                     encoded->cborPayload.len, decoded));
+        EXPECT_TRUE(decoded.empty());
+
+        OC::MessageContainer mc;
+        mc.setPayload((OCPayload*)encoded);
+        ASSERT_EQ(1u, mc.representations().size());
+        EXPECT_EQ(1, mc.representations()[0].getValue<int>("IntAttr"));
+        OCPayloadDestroy((OCPayload*)encoded);
+    }
+
+    TEST(RepresentationCodec, MalformedPayload)
+    {
+        // A map that ends in the middle of a text string.
+        const uint8_t cborData[] = {0xbf, 0x63, 'a', 'b'};
+
+        std::vector<OC::OCRepresentation> decoded;
+        EXPECT_FALSE(OC::OCRepresentationCodec::decode(cborData, sizeof(cborData), decoded));
+
+        OCEncodedPayload* encoded = OCEncodedPayloadCreate(cborData, sizeof(cborData));
+        ASSERT_NE((OCEncodedPayload*)NULL, encoded);
+        OC::MessageContainer mc;
+        EXPECT_THROW(mc.setPayload((OCPayload*)encoded), OC::OCException);
+        OCPayloadDestroy((OCPayload*)encoded);
+    }
 }
@@ -67,8 +67,8 @@ typedef struct
 typedef struct
 {
     char id[NS_UUID_STRING_SIZE];
-    int syncObId; // sync resource observer ID for local consumer
-    int messageObId; // message resource observer ID for local consumer
+    OCObservationId syncObId; // sync resource observer ID for local consumer
+    OCObservationId messageObId; // message resource observer ID for local consumer
     bool isWhite; // access state -> True: allowed / False: blocked
 
 } NSCacheSubData;
@@ -131,7 +131,7 @@ OCEntityHandlerResult NSEntityHandlerMessageCb(OCEntityHandlerFlag flag,
         {
             NS_LOG(DEBUG, "NSEntityHandlerMessageCb - OC_OBSERVE_REGISTER");
             NS_LOG_V(DEBUG, "NSEntityHandlerMessageCb\n"
-                    "Register message observerID : %d\n", entityHandlerRequest->obsInfo.obsId);
+                    "Register message observerID : %u\n", entityHandlerRequest->obsInfo.obsId);
 
             NSPushQueue(SUBSCRIPTION_SCHEDULER, TASK_RECV_SUBSCRIPTION,
                     NSCopyOCEntityHandlerRequest(entityHandlerRequest));
@@ -141,7 +141,7 @@ OCEntityHandlerResult NSEntityHandlerMessageCb(OCEntityHandlerFlag flag,
         {
             NS_LOG(DEBUG, "NSEntityHandlerMessageCb - OC_OBSERVE_DEREGISTER");
             NS_LOG_V(DEBUG, "NSEntityHandlerMessageCb\n - "
-                    "Deregister Message observerID : %d\n", entityHandlerRequest->obsInfo.obsId);
+                    "Deregister Message observerID : %u\n", entityHandlerRequest->obsInfo.obsId);
             NSPushQueue(SUBSCRIPTION_SCHEDULER, TASK_RECV_UNSUBSCRIPTION,
                     NSCopyOCEntityHandlerRequest(entityHandlerRequest));
             ehResult = OC_EH_OK;
@@ -226,7 +226,7 @@ OCEntityHandlerResult NSEntityHandlerSyncCb(OCEntityHandlerFlag flag,
         {
             NS_LOG(DEBUG, "NSEntityHandlerSyncCb - OC_OBSERVE_REGISTER");
             NS_LOG_V(DEBUG, "NSEntityHandlerSyncCb\n - "
-                    "Register Sync observerID : %d\n", entityHandlerRequest->obsInfo.obsId);
+                    "Register Sync observerID : %u\n", entityHandlerRequest->obsInfo.obsId);
             NSPushQueue(SUBSCRIPTION_SCHEDULER, TASK_SYNC_SUBSCRIPTION,
                     NSCopyOCEntityHandlerRequest(entityHandlerRequest));
         }
@@ -234,7 +234,7 @@ OCEntityHandlerResult NSEntityHandlerSyncCb(OCEntityHandlerFlag flag,
         {
             NS_LOG(DEBUG, "NSEntityHandlerSyncCb - OC_OBSERVE_DEREGISTER");
             NS_LOG_V(DEBUG, "NSEntityHandlerSyncCb\n - "
-                    "Deregister Sync observerID : %d\n", entityHandlerRequest->obsInfo.obsId);
+                    "Deregister Sync observerID : %u\n", entityHandlerRequest->obsInfo.obsId);
             NSPushQueue(SUBSCRIPTION_SCHEDULER, TASK_RECV_UNSUBSCRIPTION,
                     NSCopyOCEntityHandlerRequest(entityHandlerRequest));
         }
@@ -19,6 +19,7 @@
 //-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
 #include "NSProviderMemoryCache.h"
+#include <stdlib.h>
 #include <string.h>
 
 #define NS_PROVIDER_DELETE_REGISTERED_TOPIC_DATA(it, topicData, newObj) \
@@ -109,8 +110,8 @@ NSResult NSCacheUpdateSubScriptionState(NSCacheList * list, char * id, bool stat
             NS_LOG(DEBUG, "Update Data - IN");
 
             NS_LOG_V(INFO_PRIVATE, "currData_ID = %s", itData->id);
-            NS_LOG_V(DEBUG, "currData_MsgObID = %d", itData->messageObId);
-            NS_LOG_V(DEBUG, "currData_SyncObID = %d", itData->syncObId);
+            NS_LOG_V(DEBUG, "currData_MsgObID = %u", itData->messageObId);
+            NS_LOG_V(DEBUG, "currData_SyncObID = %u", itData->syncObId);
             NS_LOG_V(DEBUG, "currData_IsWhite = %d", itData->isWhite);
 
             NS_LOG_V(DEBUG, "update state = %d", state);
@@ -163,13 +164,13 @@ NSResult NSProviderStorageWrite(NSCacheList * list, NSCacheElement * newObj)
                 NS_LOG(DEBUG, "Update Data - IN");
 
                 NS_LOG_V(INFO_PRIVATE, "currData_ID = %s", itData->id);
-                NS_LOG_V(DEBUG, "currData_MsgObID = %d", itData->messageObId);
-                NS_LOG_V(DEBUG, "currData_SyncObID = %d", itData->syncObId);
+                NS_LOG_V(DEBUG, "currData_MsgObID = %u", itData->messageObId);
+                NS_LOG_V(DEBUG, "currData_SyncObID = %u", itData->syncObId);
                 NS_LOG_V(DEBUG, "currData_IsWhite = %d", itData->isWhite);
 
                 NS_LOG_V(INFO_PRIVATE, "subData_ID = %s", subData->id);
-                NS_LOG_V(DEBUG, "subData_MsgObID = %d", subData->messageObId);
-                NS_LOG_V(DEBUG, "subData_SyncObID = %d", subData->syncObId);
+                NS_LOG_V(DEBUG, "subData_MsgObID = %u", subData->messageObId);
+                NS_LOG_V(DEBUG, "subData_SyncObID = %u", subData->syncObId);
                 NS_LOG_V(DEBUG, "subData_IsWhite = %d", subData->isWhite);
 
                 if (subData->messageObId != 0)
@@ -265,7 +266,10 @@ bool NSProviderCompareIdCacheData(NSCacheType type, void * data, const char * id
         return false;
     }
 
-    NS_LOG_V(INFO_PRIVATE, "Data(compData) = [%s]", id);
+    if (type != NS_PROVIDER_CACHE_SUBSCRIBER_OBSERVE_ID)
+    {
+        NS_LOG_V(INFO_PRIVATE, "Data(compData) = [%s]", id);
+    }
 
     if (type == NS_PROVIDER_CACHE_SUBSCRIBER)
     {
@@ -288,7 +292,10 @@ bool NSProviderCompareIdCacheData(NSCacheType type, void * data, const char * id
 
         NS_LOG_V(INFO_PRIVATE, "Data(subData) = [%s]", subData->id);
 
-        OCObservationId currID = *id;
+        // The ID is passed by address through the string key of the cache.
+        OCObservationId currID = 0;
+        memcpy(&currID, id, sizeof(currID));
+        NS_LOG_V(INFO_PRIVATE, "Data(compData) = [%u]", currID);
 
         if (NSIsSameObId(subData, currID))
         {
@@ -651,3 +658,102 @@ NSResult NSProviderDeleteConsumerTopic(NSCacheList * conTopicList,
     pthread_mutex_unlock(&NSCacheMutex);
     return NS_FAIL;
 }
+
+static int NSCompareConsumerId(const void * a, const void * b)
+{
+    return strcmp(*(const char * const *) a, *(const char * const *) b);
+}
+
+// Gathers the message (or sync) observation IDs of the allowed consumers, only those
+// subscribed to topicName if it is set. The caller frees *ids.
+NSResult NSProviderGetObserverIds(NSCacheList * subList, NSCacheList * conTopicList,
+        const char * topicName, bool isSync, OCObservationId ** ids, size_t * count)
+{
+    if (!subList || !ids || !count)
+    {
+        return NS_ERROR;
+    }
+
+    pthread_mutex_lock(&NSCacheMutex);
+
+    *ids = NULL;
+    *count = 0;
+
+    size_t subCount = 0;
+    for (NSCacheElement * it = subList->head; it; it = it->next)
+    {
+        subCount++;
+    }
+
+    // Consumers of the topic, sorted so that every subscriber is found by a binary search
+    // instead of a walk of the whole consumer topic list.
+    const char ** topicConsumers = NULL;
+    size_t topicCount = 0;
+    if (topicName && conTopicList)
+    {
+        for (NSCacheElement * it = conTopicList->head; it; it = it->next)
+        {
+            NSCacheTopicSubData * curr = (NSCacheTopicSubData *) it->data;
+            if (strcmp(curr->topicName, topicName) == 0)
+            {
+                topicCount++;
+            }
+        }
+
+        if (topicCount)
+        {
+            topicConsumers = (const char **) OICMalloc(topicCount * sizeof(const char *));
+            if (!topicConsumers)
+            {
+                pthread_mutex_unlock(&NSCacheMutex);
+                return NS_ERROR;
+            }
+
+            size_t i = 0;
+            for (NSCacheElement * it = conTopicList->head; it; it = it->next)
+            {
+                NSCacheTopicSubData * curr = (NSCacheTopicSubData *) it->data;
+                if (strcmp(curr->topicName, topicName) == 0)
+                {
+                    topicConsumers[i++] = curr->id;
+                }
+            }
+            qsort(topicConsumers, topicCount, sizeof(const char *), NSCompareConsumerId);
+        }
+    }
+
+    if (subCount && (!topicName || topicCount))
+    {
+        *ids = (OCObservationId *) OICMalloc(subCount * sizeof(OCObservationId));
+        if (!*ids)
+        {
+            NSOICFree(topicConsumers);
+            pthread_mutex_unlock(&NSCacheMutex);
+            return NS_ERROR;
+        }
+    }
+
+    for (NSCacheElement * it = subList->head; it && *ids; it = it->next)
+    {
+        NSCacheSubData * subData = (NSCacheSubData *) it->data;
+        OCObservationId id = isSync ? subData->syncObId : subData->messageObId;
+
+        if (!subData->isWhite || id == 0)
+        {
+            continue;
+        }
+
+        const char * consumerId = subData->id;
+        if (topicName && !bsearch(&consumerId, topicConsumers, topicCount,
+                                  sizeof(const char *), NSCompareConsumerId))
+        {
+            continue;
+        }
+
+        (*ids)[(*count)++] = id;
+    }
+
+    NSOICFree(topicConsumers);
+    pthread_mutex_unlock(&NSCacheMutex);
+    return NS_OK;
+}
@@ -57,6 +57,9 @@ bool NSProviderIsTopicSubScribed(NSCacheElement * conTopicList, char * cId, char
 NSResult NSProviderDeleteConsumerTopic(NSCacheList * conTopicList,
         NSCacheTopicSubData * topicSubData);
 
+NSResult NSProviderGetObserverIds(NSCacheList * subList, NSCacheList * conTopicList,
+        const char * topicName, bool isSync, OCObservationId ** ids, size_t * count);
+
 pthread_mutex_t NSCacheMutex;
 pthread_mutexattr_t NSCacheMutexAttr;
 
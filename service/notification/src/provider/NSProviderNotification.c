@@ -108,7 +108,7 @@ NSResult NSSendNotification(NSMessage *msg)
     NS_LOG(DEBUG, "NSSendMessage - IN");
 
     OCResourceHandle rHandle = NULL;
-    OCObservationId obArray[255] = { 0, };
+    OCObservationId * obArray = NULL;
     size_t obCount = 0;
 
     if (NSPutMessageResource(msg, &rHandle) != NS_OK)
@@ -140,55 +140,42 @@ NSResult NSSendNotification(NSMessage *msg)
         return NS_ERROR;
     }
 
-    NSCacheElement * it = consumerSubList->head;
-
-    while (it)
+    char * topicName = NULL;
+    if (msg->topic && (msg->topic)[0] != '\0')
     {
-        NSCacheSubData * subData = (NSCacheSubData *) it->data;
-        NS_LOG_V(INFO_PRIVATE, "message subData->id = %s", subData->id);
-        NS_LOG_V(DEBUG, "subData->messageId = %d", subData->messageObId);
-        NS_LOG_V(DEBUG, "subData->syncId = %d", subData->syncObId);
-        NS_LOG_V(DEBUG, "subData->isWhite = %d", subData->isWhite);
-
-        if (subData->isWhite)
-        {
-            if(subData->messageObId != 0)
-            {
-                if (msg->topic && (msg->topic)[0] != '\0')
-                {
-                    NS_LOG_V(DEBUG, "this is topic message: %s", msg->topic);
+        NS_LOG_V(DEBUG, "this is topic message: %s", msg->topic);
+        topicName = msg->topic;
+    }
 
-                    if (NSProviderIsTopicSubScribed(consumerTopicList->head, subData->id, msg->topic))
-                    {
-                        obArray[obCount++] = subData->messageObId;
-                    }
-                }
-                else
-                {
-                    obArray[obCount++] = subData->messageObId;
-                }
-            }
-        }
-        it = it->next;
+    if (NSProviderGetObserverIds(consumerSubList, consumerTopicList, topicName, false,
+            &obArray, &obCount) != NS_OK)
+    {
+        NS_LOG(ERROR, "fail to get observer IDs");
+        OCRepPayloadDestroy(payload);
+        msg->extraInfo = NULL;
+        return NS_ERROR;
     }
 
     for (size_t i = 0; i < obCount; ++i)
     {
         NS_LOG(DEBUG, "-------------------------------------------------------message\n");
-        NS_LOG_V(DEBUG, "SubScription WhiteList[%" PRIuPTR "] = %d", i, obArray[i]);
+        NS_LOG_V(DEBUG, "SubScription WhiteList[%" PRIuPTR "] = %u", i, obArray[i]);
         NS_LOG(DEBUG, "-------------------------------------------------------message\n");
     }
 
     if (!obCount)
     {
         NS_LOG(ERROR, "observer count is zero");
+        NSOICFree(obArray);
         OCRepPayloadDestroy(payload);
         msg->extraInfo = NULL;
         return NS_ERROR;
     }
 
+    // The payload is encoded once and the bytes are reused for every consumer.
     OCStackResult ocstackResult = OCNotifyListOfObservers(rHandle, obArray, obCount, payload,
             OC_LOW_QOS);
+    NSOICFree(obArray);
 
     NS_LOG_V(DEBUG, "Message ocstackResult = %d", ocstackResult);
 
@@ -211,7 +198,7 @@ NSResult NSSendSync(NSSyncInfo *sync)
 {
     NS_LOG(DEBUG, "NSSendSync - IN");
 
-    OCObservationId obArray[255] = { 0, };
+    OCObservationId * obArray = NULL;
     size_t obCount = 0;
 
     OCResourceHandle rHandle = NULL;
@@ -221,30 +208,18 @@ NSResult NSSendSync(NSSyncInfo *sync)
         return NS_ERROR;
     }
 
-    NSCacheElement * it = consumerSubList->head;
-
-    while (it)
+    if (NSProviderGetObserverIds(consumerSubList, NULL, NULL, true,
+            &obArray, &obCount) != NS_OK)
     {
-        NSCacheSubData * subData = (NSCacheSubData *) it->data;
-        NS_LOG_V(INFO_PRIVATE, "sync subData->id = %s", subData->id);
-        NS_LOG_V(DEBUG, "subData->messageId = %d", subData->messageObId);
-        NS_LOG_V(DEBUG, "subData->syncId = %d", subData->syncObId);
-        NS_LOG_V(DEBUG, "subData->isWhite = %d", subData->isWhite);
-
-        if (subData->isWhite)
-        {
-            if (subData->syncObId != 0)
-            {
-                obArray[obCount++] = subData->syncObId;
-            }
-        }
-        it = it->next;
+        NS_LOG(ERROR, "fail to get observer IDs");
+        return NS_ERROR;
     }
 
     OCRepPayload* payload = NULL;
     if (NSSetSyncPayload(sync, &payload) != NS_OK)
     {
         NS_LOG(ERROR, "Failed to allocate payload");
+        NSOICFree(obArray);
         return NS_ERROR;
     }
 
@@ -271,12 +246,13 @@ NSResult NSSendSync(NSSyncInfo *sync)
     for (size_t i = 0; i < obCount; ++i)
     {
         NS_LOG(DEBUG, "-------------------------------------------------------message\n");
-        NS_LOG_V(DEBUG, "Sync WhiteList[%" PRIuPTR "] = %d", i, obArray[i]);
+        NS_LOG_V(DEBUG, "Sync WhiteList[%" PRIuPTR "] = %u", i, obArray[i]);
         NS_LOG(DEBUG, "-------------------------------------------------------message\n");
     }
 
     OCStackResult ocstackResult = OCNotifyListOfObservers(rHandle, obArray,
             obCount, payload, OC_LOW_QOS);
+    NSOICFree(obArray);
 
     NS_LOG_V(DEBUG, "Sync ocstackResult = %d", ocstackResult);
     if (ocstackResult != OC_STACK_OK)
@@ -152,7 +152,7 @@ void NSHandleSubscription(OCEntityHandlerRequest *entityHandlerRequest, NSResour
 
         NS_LOG(DEBUG, "Requested by local consumer");
         subData->messageObId = entityHandlerRequest->obsInfo.obsId;
-        NS_LOG_V(DEBUG, "SubList message observation ID = [%d]", subData->messageObId);
+        NS_LOG_V(DEBUG, "SubList message observation ID = [%u]", subData->messageObId);
 
         subData->isWhite = false;
         subData->syncObId = 0;
@@ -197,7 +197,7 @@ void NSHandleSubscription(OCEntityHandlerRequest *entityHandlerRequest, NSResour
 
         NS_LOG(DEBUG, "Requested by local consumer");
         subData->syncObId = entityHandlerRequest->obsInfo.obsId;
-        NS_LOG_V(DEBUG, "SubList sync observation ID = [%d]", subData->syncObId);
+        NS_LOG_V(DEBUG, "SubList sync observation ID = [%u]", subData->syncObId);
 
 
         subData->isWhite = false;
@@ -276,7 +276,7 @@ NSResult NSSendResponse(const char * id, bool accepted)
 
     NSCacheSubData * subData = (NSCacheSubData*) element->data;
 
-    if (OCNotifyListOfObservers(rHandle, (OCObservationId*)&subData->messageObId, 1,
+    if (OCNotifyListOfObservers(rHandle, &subData->messageObId, 1,
             payload, OC_LOW_QOS) != OC_STACK_OK)
     {
         NS_LOG(ERROR, "fail to send Acceptance");
@@ -141,30 +141,21 @@ NSResult NSSendTopicUpdation()
     OCRepPayloadSetPropInt(payload, NS_ATTRIBUTE_MESSAGE_ID, NS_TOPIC);
     OCRepPayloadSetPropString(payload, NS_ATTRIBUTE_PROVIDER_ID, NSGetProviderInfo()->providerId);
 
-    OCObservationId obArray[255] =
-    { 0, };
+    OCObservationId * obArray = NULL;
     size_t obCount = 0;
 
-    NSCacheElement * it = consumerSubList->head;
-
-    while (it)
+    if (NSProviderGetObserverIds(consumerSubList, NULL, NULL, false,
+            &obArray, &obCount) != NS_OK)
     {
-        NSCacheSubData * subData = (NSCacheSubData *) it->data;
-
-        if (subData->isWhite)
-        {
-            if (subData->messageObId != 0)
-            {
-                obArray[obCount++] = subData->messageObId;
-            }
-        }
-
-        it = it->next;
+        NS_LOG(ERROR, "fail to get observer IDs");
+        OCRepPayloadDestroy(payload);
+        return NS_ERROR;
     }
 
     if (!obCount)
     {
         NS_LOG(ERROR, "observer count is zero");
+        NSOICFree(obArray);
         OCRepPayloadDestroy(payload);
         return NS_ERROR;
     }
@@ -172,10 +163,12 @@ NSResult NSSendTopicUpdation()
     if (OCNotifyListOfObservers(rHandle, obArray, obCount, payload, OC_HIGH_QOS) != OC_STACK_OK)
     {
         NS_LOG(ERROR, "fail to send topic updation");
+        NSOICFree(obArray);
         OCRepPayloadDestroy(payload);
         return NS_ERROR;
 
     }
+    NSOICFree(obArray);
     OCRepPayloadDestroy(payload);
 
     NS_LOG(DEBUG, "NSSendTopicUpdation - OUT");
@@ -217,7 +210,7 @@ NSResult NSSendTopicUpdationToConsumer(char *consumerId)
 
     NSCacheSubData * subData = (NSCacheSubData*) element->data;
 
-    if (OCNotifyListOfObservers(rHandle, (OCObservationId*) &subData->messageObId, 1, payload,
+    if (OCNotifyListOfObservers(rHandle, &subData->messageObId, 1, payload,
             OC_HIGH_QOS) != OC_STACK_OK)
     {
         NS_LOG(ERROR, "fail to send topic updation");